@@ -73,10 +73,11 @@ std::optional<fs::path> ObtainInstaller(bool& isUpToDate)
             return std::nullopt;
         }
 
-        // Cleanup old updates before downloading the latest
-        updating::cleanup_updates();
+        const auto& download_info = std::get<new_version_download_info>(*new_version_info);
 
-        auto downloaded_installer = download_new_version(std::get<new_version_download_info>(*new_version_info)).get();
+        // The installer downloaded already, or part of it, is picked up by the pipeline, which removes the other
+        // installers once it stages this one
+        auto downloaded_installer = download_new_version(download_info).get();
         if (!downloaded_installer)
         {
             Logger::error("Couldn't download new installer");
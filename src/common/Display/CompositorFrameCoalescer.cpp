@@ -0,0 +1,68 @@
+#include "CompositorFrameCoalescer.h"
+
+#include <chrono>
+
+#include <dwmapi.h>
+
+#pragma comment(lib, "dwmapi.lib")
+
+CompositorFrameCoalescer::CompositorFrameCoalescer(const HWND window, const UINT message) :
+    _window{ window }, _message{ message }
+{
+    _thread = std::thread{ [this] { Run(); } };
+}
+
+CompositorFrameCoalescer::~CompositorFrameCoalescer()
+{
+    {
+        std::unique_lock lock{ _mutex };
+        _stop = true;
+    }
+    _condition.notify_one();
+    _thread.join();
+}
+
+void CompositorFrameCoalescer::Request() noexcept
+{
+    if (_requested.exchange(true))
+    {
+        return;
+    }
+
+    {
+        std::unique_lock lock{ _mutex };
+        _pending = true;
+    }
+    _condition.notify_one();
+}
+
+void CompositorFrameCoalescer::Acknowledge() noexcept
+{
+    _requested = false;
+}
+
+void CompositorFrameCoalescer::Run()
+{
+    while (true)
+    {
+        {
+            std::unique_lock lock{ _mutex };
+            _condition.wait(lock, [this] { return _pending || _stop; });
+            if (_stop)
+            {
+                return;
+            }
+            _pending = false;
+        }
+
+        // Blocks until the compositor presented the next frame. Without composition, keep to a typical refresh rate.
+        if (FAILED(DwmFlush()))
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds{ 16 });
+        }
+        if (!PostMessageW(_window, _message, 0, 0))
+        {
+            _requested = false;
+        }
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <Windows.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Turns a stream of update requests into at most one message per compositor frame. Request can be called for every
+// input event; the window then receives the message once the next frame has been composed, and applies the latest
+// state in a single update.
+class CompositorFrameCoalescer
+{
+public:
+    CompositorFrameCoalescer(HWND window, UINT message);
+    CompositorFrameCoalescer(const CompositorFrameCoalescer&) = delete;
+    CompositorFrameCoalescer& operator=(const CompositorFrameCoalescer&) = delete;
+    ~CompositorFrameCoalescer();
+
+    void Request() noexcept;
+
+    // To be called when the message is received, before reading the state to apply, so that a request made while
+    // the update runs schedules the next one.
+    void Acknowledge() noexcept;
+
+private:
+    HWND _window;
+    UINT _message;
+
+    // Set from the request until the message is acknowledged
+    std::atomic_bool _requested = false;
+
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    bool _pending = false;
+    bool _stop = false;
+    std::thread _thread;
+
+    void Run();
+};
@@ -0,0 +1,159 @@
+#include "MonitorTopology.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+namespace
+{
+    std::vector<LONG> SortedEdges(std::vector<LONG> edges)
+    {
+        std::sort(begin(edges), end(edges));
+        edges.erase(std::unique(begin(edges), end(edges)), end(edges));
+        return edges;
+    }
+
+    // Index of the interval [edges[i], edges[i + 1]) containing value, or -1
+    int IntervalIndex(const std::vector<LONG>& edges, const LONG value) noexcept
+    {
+        if (edges.empty() || value < edges.front() || value >= edges.back())
+        {
+            return -1;
+        }
+        return static_cast<int>(std::upper_bound(begin(edges), end(edges), value) - begin(edges)) - 1;
+    }
+
+    int64_t SquaredDistance(const RECT& rect, const POINT point) noexcept
+    {
+        const int64_t dx = point.x < rect.left ? rect.left - point.x : (point.x >= rect.right ? point.x - rect.right + 1 : 0);
+        const int64_t dy = point.y < rect.top ? rect.top - point.y : (point.y >= rect.bottom ? point.y - rect.bottom + 1 : 0);
+        return dx * dx + dy * dy;
+    }
+}
+
+MonitorTopology::MonitorTopology(std::vector<Monitor> monitors) :
+    _monitors{ std::move(monitors) }
+{
+    if (_monitors.empty())
+    {
+        return;
+    }
+
+    std::vector<LONG> columns;
+    std::vector<LONG> rows;
+    RECT virtualScreen = _monitors.front().rect.rect;
+    for (const auto& monitor : _monitors)
+    {
+        const RECT& rect = monitor.rect.rect;
+        columns.insert(end(columns), { rect.left, rect.right });
+        rows.insert(end(rows), { rect.top, rect.bottom });
+        virtualScreen.left = std::min(virtualScreen.left, rect.left);
+        virtualScreen.top = std::min(virtualScreen.top, rect.top);
+        virtualScreen.right = std::max(virtualScreen.right, rect.right);
+        virtualScreen.bottom = std::max(virtualScreen.bottom, rect.bottom);
+    }
+    _virtualScreen = Box{ virtualScreen };
+    _columns = SortedEdges(std::move(columns));
+    _rows = SortedEdges(std::move(rows));
+
+    const size_t width = _columns.size() - 1;
+    const size_t height = _rows.size() - 1;
+    _cells.assign(width * height, -1);
+    for (size_t y = 0; y < height; ++y)
+    {
+        for (size_t x = 0; x < width; ++x)
+        {
+            const POINT cell{ _columns[x], _rows[y] };
+            for (size_t i = 0; i < _monitors.size(); ++i)
+            {
+                const RECT& rect = _monitors[i].rect.rect;
+                // Cells never straddle a monitor edge, so checking their corner is enough
+                if (rect.left <= cell.x && cell.x < rect.right && rect.top <= cell.y && cell.y < rect.bottom)
+                {
+                    _cells[y * width + x] = static_cast<int>(i);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+MonitorTopology MonitorTopology::Capture()
+{
+    std::vector<Monitor> monitors;
+    for (const auto& monitor : MonitorInfo::GetMonitors(true))
+    {
+        monitors.push_back({ .handle = monitor.GetHandle(),
+                             .rect = monitor.GetScreenSize(true),
+                             .workArea = monitor.GetScreenSize(false),
+                             .primary = monitor.IsPrimary() });
+    }
+    return MonitorTopology{ std::move(monitors) };
+}
+
+const MonitorTopology::Monitor* MonitorTopology::MonitorFromPoint(const POINT point) const noexcept
+{
+    const int x = IntervalIndex(_columns, point.x);
+    const int y = IntervalIndex(_rows, point.y);
+    if (x >= 0 && y >= 0)
+    {
+        const int index = _cells[static_cast<size_t>(y) * (_columns.size() - 1) + x];
+        if (index >= 0)
+        {
+            return &_monitors[index];
+        }
+    }
+    return NearestMonitor(point);
+}
+
+const MonitorTopology::Monitor* MonitorTopology::NearestMonitor(const POINT point) const noexcept
+{
+    const Monitor* nearest = nullptr;
+    int64_t nearestDistance = std::numeric_limits<int64_t>::max();
+    for (const auto& monitor : _monitors)
+    {
+        const auto distance = SquaredDistance(monitor.rect.rect, point);
+        if (distance < nearestDistance)
+        {
+            nearest = &monitor;
+            nearestDistance = distance;
+        }
+    }
+    return nearest;
+}
+
+std::shared_ptr<const MonitorTopology> MonitorTopologyCache::Current()
+{
+    std::unique_lock lock{ _mutex };
+    if (!_topology)
+    {
+        _topology = std::make_shared<const MonitorTopology>(MonitorTopology::Capture());
+    }
+    return _topology;
+}
+
+void MonitorTopologyCache::Invalidate() noexcept
+{
+    std::unique_lock lock{ _mutex };
+    _topology.reset();
+}
+
+bool MonitorTopologyCache::HandleMessage(const UINT message, const WPARAM wParam) noexcept
+{
+    switch (message)
+    {
+    case WM_DISPLAYCHANGE:
+    case WM_DPICHANGED:
+        Invalidate();
+        return true;
+    case WM_SETTINGCHANGE:
+        if (wParam == SPI_SETWORKAREA)
+        {
+            Invalidate();
+            return true;
+        }
+        return false;
+    default:
+        return false;
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <Windows.h>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "monitors.h"
+
+// Immutable snapshot of the monitor layout. Point to monitor queries are answered from a grid built over the monitor
+// edges, so code running on every mouse move doesn't have to call MonitorFromPoint and GetMonitorInfo.
+class MonitorTopology
+{
+public:
+    struct Monitor
+    {
+        HMONITOR handle = nullptr;
+        Box rect{};
+        Box workArea{};
+        bool primary = false;
+    };
+
+    MonitorTopology() = default;
+    explicit MonitorTopology(std::vector<Monitor> monitors);
+
+    // Snapshot of the monitors currently attached to the desktop
+    static MonitorTopology Capture();
+
+    const std::vector<Monitor>& Monitors() const noexcept
+    {
+        return _monitors;
+    }
+
+    // Bounding box of all the monitors, same as the SM_*VIRTUALSCREEN metrics
+    const Box& VirtualScreen() const noexcept
+    {
+        return _virtualScreen;
+    }
+
+    // Returns the monitor containing the point, or the nearest one like MONITOR_DEFAULTTONEAREST.
+    // nullptr if there are no monitors.
+    const Monitor* MonitorFromPoint(POINT point) const noexcept;
+
+private:
+    std::vector<Monitor> _monitors;
+    Box _virtualScreen;
+
+    // Sorted distinct monitor edges. They divide the virtual screen into cells which are covered by a single
+    // monitor, or by none of them.
+    std::vector<LONG> _columns;
+    std::vector<LONG> _rows;
+    // Index of the monitor covering each cell, -1 for gaps between monitors. One row after the other.
+    std::vector<int> _cells;
+
+    const Monitor* NearestMonitor(POINT point) const noexcept;
+};
+
+// Keeps the current MonitorTopology, captured again only after the display configuration changed.
+// Snapshots stay valid for their holders when a newer one replaces them.
+class MonitorTopologyCache
+{
+public:
+    std::shared_ptr<const MonitorTopology> Current();
+
+    void Invalidate() noexcept;
+
+    // To be called from the window procedure. Invalidates the snapshot and returns true if the message reports
+    // a change of the monitors, of their DPI or of their work areas.
+    bool HandleMessage(UINT message, WPARAM wParam) noexcept;
+
+private:
+    std::mutex _mutex;
+    std::shared_ptr<const MonitorTopology> _topology;
+};
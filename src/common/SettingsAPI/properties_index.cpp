@@ -0,0 +1,586 @@
+#include "pch.h"
+#include "properties_index.h"
+
+#include <algorithm>
+#include <charconv>
+#include <unordered_map>
+
+namespace PowerToysSettings
+{
+    namespace
+    {
+        constexpr uint32_t Empty = UINT32_MAX;
+        // Deeper nesting is rejected instead of running out of stack
+        constexpr int MaxDepth = 128;
+        // Names per bucket of the perfect hash, on average
+        constexpr uint32_t BucketSize = 4;
+        // Seeds tried for a bucket before giving the names more room
+        constexpr uint32_t MaxSeed = 1 << 16;
+
+        uint64_t mix(uint64_t x) noexcept
+        {
+            x ^= x >> 30;
+            x *= 0xBF58476D1CE4E5B9ull;
+            x ^= x >> 27;
+            x *= 0x94D049BB133111EBull;
+            return x ^ (x >> 31);
+        }
+
+        uint64_t hash_name(std::wstring_view name) noexcept
+        {
+            // FNV-1a over the UTF-16 code units
+            uint64_t hash = 14695981039346656037ull;
+            for (const wchar_t c : name)
+            {
+                hash = (hash ^ static_cast<uint16_t>(c)) * 1099511628211ull;
+            }
+            return mix(hash);
+        }
+
+        // Maps 32 bits of hash to [0, n) without a division
+        uint32_t reduce(uint64_t hash, size_t n) noexcept
+        {
+            return static_cast<uint32_t>(((hash & 0xFFFFFFFF) * n) >> 32);
+        }
+
+        uint32_t bucket_of(uint64_t hash, size_t bucketCount) noexcept
+        {
+            return reduce(hash, bucketCount);
+        }
+
+        uint32_t slot_of(uint64_t hash, uint32_t seed, size_t slotCount) noexcept
+        {
+            return reduce(mix(hash + (seed + 1ull) * 0x9E3779B97F4A7C15ull) >> 32, slotCount);
+        }
+
+        struct Value
+        {
+            PropertiesIndex::Type type = PropertiesIndex::Type::Null;
+            bool boolean = false;
+            double number = 0;
+        };
+
+        // Just enough of a json parser to pick the values of the properties out of the settings: everything else is
+        // validated and skipped.
+        class Parser
+        {
+        public:
+            explicit Parser(std::wstring_view json) :
+                m_json{ json }
+            {
+            }
+
+            // Calls on_properties() for each "properties" member of the settings, as only the last one counts, and
+            // on_property(name, value, string) for each of its properties having a value, string being the value
+            // of string properties.
+            template<typename OnProperties, typename OnProperty>
+            bool parse_settings(OnProperties&& on_properties, OnProperty&& on_property)
+            {
+                skip_whitespace();
+                if (peek() != L'{')
+                {
+                    return false;
+                }
+
+                const bool parsed = parse_object(0, [&](const std::wstring& member) {
+                    if (member != L"properties")
+                    {
+                        return skip_value(1);
+                    }
+                    on_properties();
+                    if (peek() != L'{')
+                    {
+                        return skip_value(1);
+                    }
+
+                    return parse_object(1, [&](const std::wstring& name) {
+                        if (peek() != L'{')
+                        {
+                            return skip_value(2);
+                        }
+
+                        std::optional<Value> value;
+                        const bool valid = parse_object(2, [&](const std::wstring& field) {
+                            if (field != L"value")
+                            {
+                                return skip_value(3);
+                            }
+                            value.emplace();
+                            return parse_value(3, *value, m_string);
+                        });
+                        if (valid && value)
+                        {
+                            on_property(name, *value, m_string);
+                        }
+                        return valid;
+                    });
+                });
+
+                skip_whitespace();
+                return parsed && m_position == m_json.size();
+            }
+
+        private:
+            wchar_t peek() const noexcept
+            {
+                return m_position < m_json.size() ? m_json[m_position] : L'\0';
+            }
+
+            void skip_whitespace() noexcept
+            {
+                while (m_position < m_json.size())
+                {
+                    const wchar_t c = m_json[m_position];
+                    if (c != L' ' && c != L'\t' && c != L'\n' && c != L'\r')
+                    {
+                        break;
+                    }
+                    ++m_position;
+                }
+            }
+
+            bool consume(wchar_t c) noexcept
+            {
+                skip_whitespace();
+                if (peek() != c)
+                {
+                    return false;
+                }
+                ++m_position;
+                return true;
+            }
+
+            // Calls on_member(key) with the position at the value of each member, which it parses
+            template<typename OnMember>
+            bool parse_object(int depth, OnMember&& on_member)
+            {
+                if (depth >= MaxDepth || !consume(L'{'))
+                {
+                    return false;
+                }
+                if (consume(L'}'))
+                {
+                    return true;
+                }
+
+                std::wstring key;
+                do
+                {
+                    skip_whitespace();
+                    if (!parse_string(key) || !consume(L':'))
+                    {
+                        return false;
+                    }
+                    skip_whitespace();
+                    if (!on_member(key))
+                    {
+                        return false;
+                    }
+                } while (consume(L','));
+                return consume(L'}');
+            }
+
+            bool parse_array(int depth)
+            {
+                if (depth >= MaxDepth || !consume(L'['))
+                {
+                    return false;
+                }
+                if (consume(L']'))
+                {
+                    return true;
+                }
+
+                do
+                {
+                    skip_whitespace();
+                    if (!skip_value(depth + 1))
+                    {
+                        return false;
+                    }
+                } while (consume(L','));
+                return consume(L']');
+            }
+
+            // The value at the position, and its text for strings. Arrays and objects are only checked.
+            bool parse_value(int depth, Value& value, std::wstring& string)
+            {
+                using Type = PropertiesIndex::Type;
+                switch (peek())
+                {
+                case L'{':
+                    value.type = Type::Object;
+                    return skip_value(depth);
+                case L'[':
+                    value.type = Type::Array;
+                    return parse_array(depth);
+                case L'"':
+                    value.type = Type::String;
+                    return parse_string(string);
+                case L't':
+                    value.type = Type::Boolean;
+                    value.boolean = true;
+                    return parse_literal(L"true");
+                case L'f':
+                    value.type = Type::Boolean;
+                    return parse_literal(L"false");
+                case L'n':
+                    value.type = Type::Null;
+                    return parse_literal(L"null");
+                default:
+                    value.type = Type::Number;
+                    return parse_number(value.number);
+                }
+            }
+
+            bool skip_value(int depth)
+            {
+                if (peek() == L'{')
+                {
+                    return parse_object(depth, [&](const std::wstring&) { return skip_value(depth + 1); });
+                }
+
+                Value value;
+                return parse_value(depth, value, m_skipped);
+            }
+
+            bool parse_literal(std::wstring_view literal) noexcept
+            {
+                if (m_json.substr(m_position, literal.size()) != literal)
+                {
+                    return false;
+                }
+                m_position += literal.size();
+                return true;
+            }
+
+            bool parse_string(std::wstring& string)
+            {
+                if (peek() != L'"')
+                {
+                    return false;
+                }
+                ++m_position;
+                string.clear();
+
+                while (m_position < m_json.size())
+                {
+                    // Copy the run up to the next quote, escape or control character at once
+                    const size_t start = m_position;
+                    while (m_position < m_json.size() && m_json[m_position] != L'"' && m_json[m_position] != L'\\' && m_json[m_position] >= 0x20)
+                    {
+                        ++m_position;
+                    }
+                    string.append(m_json, start, m_position - start);
+                    if (m_position == m_json.size() || m_json[m_position] < 0x20)
+                    {
+                        return false;
+                    }
+                    if (m_json[m_position++] == L'"')
+                    {
+                        return true;
+                    }
+
+                    if (m_position == m_json.size())
+                    {
+                        return false;
+                    }
+                    switch (const wchar_t escaped = m_json[m_position++])
+                    {
+                    case L'"':
+                    case L'\\':
+                    case L'/':
+                        string += escaped;
+                        break;
+                    case L'b':
+                        string += L'\b';
+                        break;
+                    case L'f':
+                        string += L'\f';
+                        break;
+                    case L'n':
+                        string += L'\n';
+                        break;
+                    case L'r':
+                        string += L'\r';
+                        break;
+                    case L't':
+                        string += L'\t';
+                        break;
+                    case L'u':
+                    {
+                        // Surrogates stay code units, as in the json
+                        uint32_t unit = 0;
+                        for (int i = 0; i < 4; ++i, ++m_position)
+                        {
+                            const wchar_t c = peek();
+                            const int digit = c >= L'0' && c <= L'9' ? c - L'0' :
+                                              c >= L'a' && c <= L'f' ? c - L'a' + 10 :
+                                              c >= L'A' && c <= L'F' ? c - L'A' + 10 :
+                                                                       -1;
+                            if (digit < 0)
+                            {
+                                return false;
+                            }
+                            unit = unit << 4 | static_cast<uint32_t>(digit);
+                        }
+                        string += static_cast<wchar_t>(unit);
+                        break;
+                    }
+                    default:
+                        return false;
+                    }
+                }
+                return false;
+            }
+
+            bool parse_number(double& number)
+            {
+                const size_t start = m_position;
+                auto digits = [&] {
+                    const size_t first = m_position;
+                    while (peek() >= L'0' && peek() <= L'9')
+                    {
+                        ++m_position;
+                    }
+                    return m_position - first;
+                };
+
+                if (peek() == L'-')
+                {
+                    ++m_position;
+                }
+                const bool leadingZero = peek() == L'0';
+                const size_t integerDigits = digits();
+                if (integerDigits == 0 || (leadingZero && integerDigits > 1))
+                {
+                    return false;
+                }
+                if (peek() == L'.')
+                {
+                    ++m_position;
+                    if (digits() == 0)
+                    {
+                        return false;
+                    }
+                }
+                if (peek() == L'e' || peek() == L'E')
+                {
+                    ++m_position;
+                    if (peek() == L'+' || peek() == L'-')
+                    {
+                        ++m_position;
+                    }
+                    if (digits() == 0)
+                    {
+                        return false;
+                    }
+                }
+
+                // Only ASCII left, and from_chars doesn't depend on the locale
+                m_number.assign(m_json.begin() + start, m_json.begin() + m_position);
+                const auto [end, error] = std::from_chars(m_number.data(), m_number.data() + m_number.size(), number);
+                return error == std::errc{} && end == m_number.data() + m_number.size();
+            }
+
+            std::wstring_view m_json;
+            size_t m_position = 0;
+            std::wstring m_string;
+            std::wstring m_skipped;
+            std::string m_number;
+        };
+    }
+
+    std::optional<PropertiesIndex> PropertiesIndex::parse(std::wstring_view json)
+    {
+        if (json.size() >= Empty)
+        {
+            return std::nullopt;
+        }
+
+        PropertiesIndex index;
+        // Every interned string comes from a distinct string of the json, which isn't shorter once decoded, so the
+        // views into the buffer stay valid
+        index.m_strings.reserve(json.size());
+        std::unordered_map<std::wstring_view, StringRef> interned;
+        auto intern = [&](const std::wstring& string) {
+            if (const auto it = interned.find(string); it != interned.end())
+            {
+                return it->second;
+            }
+            const StringRef ref{ static_cast<uint32_t>(index.m_strings.size()), static_cast<uint32_t>(string.size()) };
+            index.m_strings += string;
+            interned.emplace(index.view(ref), ref);
+            return ref;
+        };
+
+        // Entry of each name, by the offset of the interned name
+        std::unordered_map<uint32_t, uint32_t> positions;
+        Parser parser{ json };
+        const bool parsed = parser.parse_settings(
+            [&] {
+                index.m_entries.clear();
+                positions.clear();
+            },
+            [&](const std::wstring& name, const Value& value, const std::wstring& string) {
+                Entry entry;
+                entry.name = intern(name);
+                entry.type = value.type;
+                entry.boolean = value.boolean;
+                entry.number = value.number;
+                if (value.type == Type::String)
+                {
+                    entry.string = intern(string);
+                }
+
+                const auto [it, inserted] = positions.try_emplace(entry.name.offset, static_cast<uint32_t>(index.m_entries.size()));
+                if (inserted)
+                {
+                    index.m_entries.push_back(entry);
+                }
+                else
+                {
+                    index.m_entries[it->second] = entry;
+                }
+            });
+        if (!parsed)
+        {
+            return std::nullopt;
+        }
+
+        index.m_strings.shrink_to_fit();
+        index.build_table();
+        return index;
+    }
+
+    void PropertiesIndex::build_table()
+    {
+        const size_t count = m_entries.size();
+        std::vector<uint64_t> hashes(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            hashes[i] = hash_name(view(m_entries[i].name));
+        }
+
+        const size_t bucketCount = (std::max)(size_t{ 1 }, (count + BucketSize - 1) / BucketSize);
+        std::vector<std::vector<uint32_t>> buckets(bucketCount);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            buckets[bucket_of(hashes[i], bucketCount)].push_back(i);
+        }
+        // The fullest buckets first, while most slots are free
+        std::vector<uint32_t> order(bucketCount);
+        for (uint32_t i = 0; i < bucketCount; ++i)
+        {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return buckets[a].size() > buckets[b].size(); });
+
+        // A fifth of the slots left empty keeps the search for seeds short
+        for (size_t slotCount = count + count / 4 + 1;; slotCount *= 2)
+        {
+            m_slots.assign(slotCount, Empty);
+            m_seeds.assign(bucketCount, 0);
+
+            bool placed = true;
+            for (const uint32_t bucket : order)
+            {
+                const auto& names = buckets[bucket];
+                if (names.empty())
+                {
+                    break;
+                }
+
+                uint32_t seed = 0;
+                for (; seed < MaxSeed; ++seed)
+                {
+                    size_t taken = 0;
+                    for (; taken < names.size(); ++taken)
+                    {
+                        uint32_t& slot = m_slots[slot_of(hashes[names[taken]], seed, slotCount)];
+                        if (slot != Empty)
+                        {
+                            break;
+                        }
+                        slot = names[taken];
+                    }
+                    if (taken == names.size())
+                    {
+                        break;
+                    }
+                    while (taken--)
+                    {
+                        m_slots[slot_of(hashes[names[taken]], seed, slotCount)] = Empty;
+                    }
+                }
+
+                if (seed == MaxSeed)
+                {
+                    placed = false;
+                    break;
+                }
+                m_seeds[bucket] = seed;
+            }
+
+            if (placed)
+            {
+                return;
+            }
+        }
+    }
+
+    const PropertiesIndex::Entry* PropertiesIndex::find(std::wstring_view name) const noexcept
+    {
+        if (m_entries.empty())
+        {
+            return nullptr;
+        }
+
+        const uint64_t hash = hash_name(name);
+        const uint32_t index = m_slots[slot_of(hash, m_seeds[bucket_of(hash, m_seeds.size())], m_slots.size())];
+        if (index == Empty || view(m_entries[index].name) != name)
+        {
+            return nullptr;
+        }
+        return &m_entries[index];
+    }
+
+    std::optional<PropertiesIndex::Type> PropertiesIndex::get_type(std::wstring_view name) const noexcept
+    {
+        if (const Entry* entry = find(name))
+        {
+            return entry->type;
+        }
+        return std::nullopt;
+    }
+
+    std::optional<bool> PropertiesIndex::get_bool(std::wstring_view name) const noexcept
+    {
+        const Entry* entry = find(name);
+        if (!entry || entry->type != Type::Boolean)
+        {
+            return std::nullopt;
+        }
+        return entry->boolean;
+    }
+
+    std::optional<double> PropertiesIndex::get_number(std::wstring_view name) const noexcept
+    {
+        const Entry* entry = find(name);
+        if (!entry || entry->type != Type::Number)
+        {
+            return std::nullopt;
+        }
+        return entry->number;
+    }
+
+    std::optional<std::wstring_view> PropertiesIndex::get_string(std::wstring_view name) const noexcept
+    {
+        const Entry* entry = find(name);
+        if (!entry || entry->type != Type::String)
+        {
+            return std::nullopt;
+        }
+        return view(entry->string);
+    }
+}
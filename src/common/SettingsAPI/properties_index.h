@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace PowerToysSettings
+{
+    // The "properties" of a PowerToy's settings json, flattened into a read-only table of their typed values.
+    // Parsed straight from the json text, without WinRT. The names and strings are interned in a single buffer and
+    // the names are perfect-hashed, so a lookup hashes the name once and compares it with a single entry.
+    class PropertiesIndex
+    {
+    public:
+        // The type of the "value" of a property, as in json::JsonValueType
+        enum class Type : uint8_t
+        {
+            Null,
+            Boolean,
+            Number,
+            String,
+            Array,
+            Object,
+        };
+
+        // Indexes the properties of the settings in json. Returns nullopt when json isn't a valid json object.
+        // Properties which aren't objects or don't have a "value" are left out, like the duplicates of a name but
+        // the last one.
+        static std::optional<PropertiesIndex> parse(std::wstring_view json);
+
+        std::optional<Type> get_type(std::wstring_view name) const noexcept;
+        std::optional<bool> get_bool(std::wstring_view name) const noexcept;
+        std::optional<double> get_number(std::wstring_view name) const noexcept;
+        // Valid as long as the index
+        std::optional<std::wstring_view> get_string(std::wstring_view name) const noexcept;
+
+        size_t size() const noexcept { return m_entries.size(); }
+        // Characters stored for all the names and strings, each distinct one once
+        size_t interned_length() const noexcept { return m_strings.size(); }
+
+    private:
+        struct StringRef
+        {
+            uint32_t offset = 0;
+            uint32_t length = 0;
+        };
+
+        struct Entry
+        {
+            StringRef name;
+            Type type = Type::Null;
+            bool boolean = false;
+            StringRef string;
+            double number = 0;
+        };
+
+        PropertiesIndex() = default;
+
+        std::wstring_view view(StringRef ref) const noexcept { return { m_strings.data() + ref.offset, ref.length }; }
+        const Entry* find(std::wstring_view name) const noexcept;
+        void build_table();
+
+        std::wstring m_strings;
+        std::vector<Entry> m_entries;
+        // Hash and displace: the name picks a bucket, the seed of the bucket sends it to its own slot
+        std::vector<uint32_t> m_seeds;
+        // Index in m_entries of the name in each slot, or Empty
+        std::vector<uint32_t> m_slots;
+    };
+}
@@ -1,6 +1,9 @@
 #include "pch.h"
 #include "settings_objects.h"
 #include "settings_helpers.h"
+#include "properties_index.h"
+
+#include <mutex>
 
 namespace PowerToysSettings
 {
@@ -277,7 +280,26 @@ namespace PowerToysSettings
         return L"RESOURCE ID NOT FOUND: " + std::to_wstring(resource_id);
     }
 
-    PowerToyValues::PowerToyValues(std::wstring_view powertoy_name, std::wstring_view powertoy_key)
+    struct PowerToyValues::PropertiesCache
+    {
+        std::mutex mutex;
+        // The text m_json was parsed from, indexed rather than m_json serialized again. Dropped once m_json changes.
+        std::wstring source;
+        // Null when m_json couldn't be indexed
+        std::shared_ptr<const PropertiesIndex> index;
+        bool current = false;
+        // Set once get_raw_json handed m_json out: it can change behind the index from then on, so the getters read it
+        // directly
+        bool exposed = false;
+    };
+
+    PowerToyValues::PowerToyValues() :
+        m_properties{ std::make_shared<PropertiesCache>() }
+    {
+    }
+
+    PowerToyValues::PowerToyValues(std::wstring_view powertoy_name, std::wstring_view powertoy_key) :
+        m_properties{ std::make_shared<PropertiesCache>() }
     {
         _key = powertoy_key;
         set_version();
@@ -294,7 +316,8 @@ namespace PowerToysSettings
             throw winrt::hresult_error(E_NOT_SET, L"name field not set");
         }
 
-        result.m_json = json::JsonValue::Parse(json).GetObjectW();
+        result.m_json = std::move(jsonObject);
+        result.m_properties->source = json;
         result._key = powertoy_key;
         return result;
     }
@@ -302,7 +325,12 @@ namespace PowerToysSettings
     PowerToyValues PowerToyValues::load_from_settings_file(std::wstring_view powertoy_key)
     {
         PowerToyValues result = PowerToyValues();
-        result.m_json = PTSettingsHelper::load_module_settings(powertoy_key);
+        // Keeping the text for the index
+        if (auto settings = json::from_file_with_text(PTSettingsHelper::get_module_save_file_location(powertoy_key)))
+        {
+            result.m_json = std::move(settings->object);
+            result.m_properties->source = std::move(settings->text);
+        }
         result._key = powertoy_key;
         return result;
     }
@@ -313,8 +341,37 @@ namespace PowerToysSettings
         return json::has(props, name) && json::has(props.GetNamedObject(name), L"value", type);
     }
 
+    std::shared_ptr<const PropertiesIndex> PowerToyValues::indexed_properties() const
+    {
+        std::scoped_lock lock{ m_properties->mutex };
+        if (m_properties->exposed)
+        {
+            return nullptr;
+        }
+        if (!m_properties->current)
+        {
+            auto index = m_properties->source.empty() ? PropertiesIndex::parse(m_json.Stringify()) : PropertiesIndex::parse(m_properties->source);
+            m_properties->source = {};
+            m_properties->index = index ? std::make_shared<const PropertiesIndex>(std::move(*index)) : nullptr;
+            m_properties->current = true;
+        }
+        return m_properties->index;
+    }
+
+    void PowerToyValues::invalidate_properties()
+    {
+        std::scoped_lock lock{ m_properties->mutex };
+        m_properties->source = {};
+        m_properties->index = nullptr;
+        m_properties->current = false;
+    }
+
     std::optional<bool> PowerToyValues::get_bool_value(std::wstring_view property_name) const
     {
+        if (const auto properties = indexed_properties())
+        {
+            return properties->get_bool(property_name);
+        }
         if (!has_property(m_json, property_name, json::JsonValueType::Boolean))
         {
             return std::nullopt;
@@ -324,6 +381,11 @@ namespace PowerToysSettings
 
     std::optional<int> PowerToyValues::get_int_value(std::wstring_view property_name) const
     {
+        if (const auto properties = indexed_properties())
+        {
+            const auto number = properties->get_number(property_name);
+            return number ? std::optional<int>{ static_cast<int>(*number) } : std::nullopt;
+        }
         if (!has_property(m_json, property_name, json::JsonValueType::Number))
         {
             return std::nullopt;
@@ -333,6 +395,11 @@ namespace PowerToysSettings
 
     std::optional<std::wstring> PowerToyValues::get_string_value(std::wstring_view property_name) const
     {
+        if (const auto properties = indexed_properties())
+        {
+            const auto string = properties->get_string(property_name);
+            return string ? std::optional<std::wstring>{ *string } : std::nullopt;
+        }
         if (!has_property(m_json, property_name, json::JsonValueType::String))
         {
             return std::nullopt;
@@ -351,6 +418,12 @@ namespace PowerToysSettings
 
     json::JsonObject PowerToyValues::get_raw_json()
     {
+        {
+            std::scoped_lock lock{ m_properties->mutex };
+            m_properties->exposed = true;
+            m_properties->source = {};
+            m_properties->index = nullptr;
+        }
         return m_json;
     }
 
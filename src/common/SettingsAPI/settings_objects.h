@@ -3,10 +3,12 @@
 #include "../utils/json.h"
 
 #include <cwctype>
+#include <memory>
 
 namespace PowerToysSettings
 {
     class HotkeyObject;
+    class PropertiesIndex;
 
     class Settings
     {
@@ -79,12 +81,14 @@ namespace PowerToysSettings
             json::JsonObject prop_value;
             prop_value.SetNamedValue(L"value", json::value(value));
             m_json.GetNamedObject(L"properties").SetNamedValue(name, prop_value);
+            invalidate_properties();
         }
 
         std::optional<bool> get_bool_value(std::wstring_view property_name) const;
         std::optional<int> get_int_value(std::wstring_view property_name) const;
         std::optional<std::wstring> get_string_value(std::wstring_view property_name) const;
         std::optional<json::JsonObject> get_json(std::wstring_view property_name) const;
+        // The settings themselves. The typed getters stop using the index once they're handed out.
         json::JsonObject get_raw_json();
 
         std::wstring serialize();
@@ -95,7 +99,15 @@ namespace PowerToysSettings
         void set_version();
         json::JsonObject m_json;
         std::wstring _key;
-        PowerToyValues() {}
+
+        // The properties of m_json flattened for the typed getters once they're needed, shared with the copies as
+        // m_json is
+        struct PropertiesCache;
+        std::shared_ptr<PropertiesCache> m_properties;
+        std::shared_ptr<const PropertiesIndex> indexed_properties() const;
+        void invalidate_properties();
+
+        PowerToyValues();
     };
 
     class CustomActionObject
@@ -0,0 +1,118 @@
+#include "theme_broadcaster.h"
+#include "theme_registry_source.h"
+
+#include <algorithm>
+
+ThemeBroadcaster::ThemeBroadcaster(std::unique_ptr<ThemeSource> source, std::chrono::milliseconds debounce) :
+    _source(std::move(source)),
+    _debounce((std::max)(debounce, std::chrono::milliseconds{ 1 }))
+{
+    _snapshot.Write(_source->Read());
+    _thread = std::thread([this] { Run(); });
+}
+
+ThemeBroadcaster::~ThemeBroadcaster()
+{
+    _source->Cancel();
+    if (_thread.joinable())
+    {
+        _thread.join();
+    }
+}
+
+ThemeBroadcaster& ThemeBroadcaster::Instance()
+{
+    static ThemeBroadcaster instance(std::make_unique<RegistryThemeSource>());
+    return instance;
+}
+
+ThemeBroadcaster::SubscriptionId ThemeBroadcaster::Subscribe(Callback callback)
+{
+    auto subscriber = std::make_shared<Subscriber>();
+    subscriber->callback = std::move(callback);
+
+    std::scoped_lock lock{ _subscribersMutex };
+    subscriber->id = ++_lastId;
+    _subscribers.push_back(std::move(subscriber));
+    return _lastId;
+}
+
+void ThemeBroadcaster::Unsubscribe(SubscriptionId id)
+{
+    {
+        std::scoped_lock lock{ _subscribersMutex };
+        auto it = std::find_if(_subscribers.begin(), _subscribers.end(), [id](const auto& subscriber) { return subscriber->id == id; });
+        if (it == _subscribers.end())
+        {
+            return;
+        }
+        (*it)->active = false;
+        _subscribers.erase(it);
+    }
+
+    // Wait for a call in progress on the broadcaster thread to end
+    if (std::this_thread::get_id() != _thread.get_id())
+    {
+        std::scoped_lock dispatch{ _dispatchMutex };
+    }
+}
+
+void ThemeBroadcaster::Run()
+{
+    using clock = std::chrono::steady_clock;
+
+    for (;;)
+    {
+        auto result = _source->Wait(ThemeSource::Infinite);
+        if (result == ThemeSourceWait::Cancelled)
+        {
+            return;
+        }
+        if (result != ThemeSourceWait::Changed)
+        {
+            continue;
+        }
+
+        // Let the burst settle, without letting an endless one delay the update forever
+        const auto deadline = clock::now() + _debounce * MaxDebounceFactor;
+        for (auto now = clock::now(); now < deadline; now = clock::now())
+        {
+            const auto timeout = (std::min)(_debounce, std::chrono::ceil<std::chrono::milliseconds>(deadline - now));
+            result = _source->Wait(timeout);
+            if (result == ThemeSourceWait::Cancelled)
+            {
+                return;
+            }
+            if (result == ThemeSourceWait::Timeout)
+            {
+                break;
+            }
+        }
+
+        Publish(_source->Read());
+    }
+}
+
+void ThemeBroadcaster::Publish(const ThemeSnapshot& snapshot)
+{
+    // Only the broadcaster thread writes the snapshot
+    if (_snapshot.Read() == snapshot)
+    {
+        return;
+    }
+    _snapshot.Write(snapshot);
+
+    std::scoped_lock dispatch{ _dispatchMutex };
+    std::vector<std::shared_ptr<Subscriber>> subscribers;
+    {
+        std::scoped_lock lock{ _subscribersMutex };
+        subscribers = _subscribers;
+    }
+    for (const auto& subscriber : subscribers)
+    {
+        if (subscriber->active)
+        {
+            subscriber->callback(snapshot);
+        }
+    }
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "theme_helpers.h"
+#include "../utils/seqlock.h"
+
+// Everything about the look of Windows that PowerToys follows, read in one go
+struct ThemeSnapshot
+{
+    AppTheme appTheme = AppTheme::Light;
+    AppTheme systemTheme = AppTheme::Light;
+
+    // Colors are 0x00RRGGBB, like the accent palette of the personalization settings
+    uint32_t accentColor = 0;
+    // Light1 to Light3 and Dark1 to Dark3, each further away from the accent color
+    std::array<uint32_t, 3> accentLight{};
+    std::array<uint32_t, 3> accentDark{};
+
+    bool highContrast = false;
+
+    bool operator==(const ThemeSnapshot&) const = default;
+};
+
+enum class ThemeSourceWait
+{
+    Changed,
+    Timeout,
+    Cancelled,
+};
+
+// Where the theme comes from. An interface so that tests can simulate notification storms.
+class ThemeSource
+{
+public:
+    static constexpr std::chrono::milliseconds Infinite = (std::chrono::milliseconds::max)();
+
+    virtual ~ThemeSource() = default;
+
+    virtual ThemeSnapshot Read() = 0;
+
+    // Waits for a change notification. Notifications that arrive before the call are not lost, and the ones
+    // that arrive together may be reported once.
+    virtual ThemeSourceWait Wait(std::chrono::milliseconds timeout) = 0;
+
+    // Makes the pending and future Wait calls return Cancelled. Called from another thread than Wait.
+    virtual void Cancel() = 0;
+};
+
+// Watches the theme from a single thread and publishes it to the whole process. A burst of notifications, like the
+// dozen registry writes of switching to dark mode, is read once after the debounce interval without any new
+// notification, and at the latest after MaxDebounceFactor intervals. The current snapshot can be read from any
+// thread without a lock. Subscribers are called on the broadcaster thread when the snapshot changes.
+class ThemeBroadcaster
+{
+public:
+    using SubscriptionId = uint64_t;
+    using Callback = std::function<void(const ThemeSnapshot&)>;
+
+    static constexpr std::chrono::milliseconds DefaultDebounce{ 50 };
+    static constexpr int MaxDebounceFactor = 8;
+
+    explicit ThemeBroadcaster(std::unique_ptr<ThemeSource> source, std::chrono::milliseconds debounce = DefaultDebounce);
+    ~ThemeBroadcaster();
+
+    ThemeBroadcaster(const ThemeBroadcaster&) = delete;
+    ThemeBroadcaster& operator=(const ThemeBroadcaster&) = delete;
+
+    // The broadcaster of the registry of the current user, started on first use
+    static ThemeBroadcaster& Instance();
+
+    // The version starts at 1 and grows with each change
+    ThemeSnapshot Current(uint64_t* version = nullptr) const noexcept
+    {
+        return _snapshot.Read(version);
+    }
+
+    SubscriptionId Subscribe(Callback callback);
+
+    // The callback isn't called anymore once this returns, unless called from the callback itself
+    void Unsubscribe(SubscriptionId id);
+
+private:
+    struct Subscriber
+    {
+        SubscriptionId id;
+        Callback callback;
+        std::atomic<bool> active = true;
+    };
+
+    void Run();
+    void Publish(const ThemeSnapshot& snapshot);
+
+    std::unique_ptr<ThemeSource> _source;
+    std::chrono::milliseconds _debounce;
+    SeqLock<ThemeSnapshot> _snapshot;
+
+    std::mutex _subscribersMutex;
+    std::vector<std::shared_ptr<Subscriber>> _subscribers;
+    SubscriptionId _lastId = 0;
+    // Held while calling the subscribers
+    std::mutex _dispatchMutex;
+
+    std::thread _thread;
+};
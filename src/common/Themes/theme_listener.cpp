@@ -1,62 +1,50 @@
 #include "theme_listener.h"
 
-#define HKEY_WINDOWS_THEME L"Software\\Microsoft\\Windows\\CurrentVersion\\Themes\\Personalize"
+#include <algorithm>
 
-// disabling warning 4702 - unreachable code
-// prevent the warning after the call off a infinite loop function
-#pragma warning(push)
-#pragma warning(disable : 4702)
-DWORD WINAPI _checkTheme(LPVOID lpParam)
+ThemeListener::ThemeListener()
 {
-    auto listener = static_cast<ThemeListener*>(lpParam);
-    listener->CheckTheme();
-    return 0;
+    auto& broadcaster = ThemeBroadcaster::Instance();
+    subscription = broadcaster.Subscribe([this](const ThemeSnapshot& snapshot) { OnThemeChanged(snapshot); });
+    AppTheme = broadcaster.Current().appTheme;
+}
+
+ThemeListener::~ThemeListener()
+{
+    ThemeBroadcaster::Instance().Unsubscribe(subscription);
 }
-#pragma warning(pop)
 
 void ThemeListener::AddChangedHandler(THEME_HANDLE handle)
 {
+    std::scoped_lock lock{ handlesMutex };
     handles.push_back(handle);
 }
 
 void ThemeListener::DelChangedHandler(THEME_HANDLE handle)
 {
+    std::scoped_lock lock{ handlesMutex };
     auto it = std::find(handles.begin(), handles.end(), handle);
-    handles.erase(it);
+    if (it != handles.end())
+    {
+        handles.erase(it);
+    }
 }
 
-void ThemeListener::CheckTheme()
+void ThemeListener::OnThemeChanged(const ThemeSnapshot& snapshot)
 {
-    HANDLE hEvent;
-    HKEY hKey;
-
-    // Open the Key to listen
-    RegOpenKeyEx(HKEY_CURRENT_USER, HKEY_WINDOWS_THEME, 0, KEY_NOTIFY, &hKey);
-
-    while (true)
+    if (AppTheme == snapshot.appTheme)
     {
-        // Create an event.
-        hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
-        if (hEvent != 0)
-        {
-            // Watch the registry key for a change of value.
-            RegNotifyChangeKeyValue(hKey,
-                                    TRUE,
-                                    REG_NOTIFY_CHANGE_LAST_SET,
-                                    hEvent,
-                                    TRUE);
-
-            WaitForSingleObject(hEvent, INFINITE);
+        return;
+    }
+    AppTheme = snapshot.appTheme;
 
-            auto _theme = ThemeHelpers::GetAppTheme();
-            if (AppTheme != _theme)
-            {
-                AppTheme = _theme;
-                for (int i = 0; i < handles.size(); i++)
-                {
-                    handles[i]();
-                }
-            }
-        }
+    std::vector<THEME_HANDLE> changedHandlers;
+    {
+        std::scoped_lock lock{ handlesMutex };
+        changedHandlers = handles;
     }
-}
\ No newline at end of file
+    for (auto handle : changedHandlers)
+    {
+        handle();
+    }
+}
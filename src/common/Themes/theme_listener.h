@@ -1,34 +1,28 @@
-#include "theme_helpers.h"
-#include "dwmapi.h"
-#include <windows.h>
-#include <iostream>
+#pragma once
+
+#include <mutex>
 #include <vector>
 
+#include "theme_broadcaster.h"
+
 typedef void (*THEME_HANDLE)();
-DWORD WINAPI _checkTheme(LPVOID lpParam);
 
-#pragma once
+// Calls the handlers when the app theme changes. All the listeners of the process share the thread of
+// ThemeBroadcaster::Instance(), where the handlers are called.
 class ThemeListener
 {
 public:
-    ThemeListener()
-    {
-        AppTheme = ThemeHelpers::GetAppTheme();
-        dwThreadHandle = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)_checkTheme, this, 0, &dwThreadId);
-    }
-    ~ThemeListener()
-    {
-        CloseHandle(dwThreadHandle);
-        dwThreadId = 0;
-    }
+    ThemeListener();
+    ~ThemeListener();
 
     AppTheme AppTheme;
-    void ThemeListener::AddChangedHandler(THEME_HANDLE handle);
-    void ThemeListener::DelChangedHandler(THEME_HANDLE handle);
-    void CheckTheme();
+    void AddChangedHandler(THEME_HANDLE handle);
+    void DelChangedHandler(THEME_HANDLE handle);
 
 private:
-    HANDLE dwThreadHandle;
-    DWORD dwThreadId;
+    void OnThemeChanged(const ThemeSnapshot& snapshot);
+
+    ThemeBroadcaster::SubscriptionId subscription;
+    std::mutex handlesMutex;
     std::vector<THEME_HANDLE> handles;
-};
\ No newline at end of file
+};
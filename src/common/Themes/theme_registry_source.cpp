@@ -0,0 +1,136 @@
+#include "theme_registry_source.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace // Strings in this namespace should not be localized
+{
+    const wchar_t PERSONALIZE_KEY[] = L"Software\\Microsoft\\Windows\\CurrentVersion\\Themes\\Personalize";
+    const wchar_t ACCENT_KEY[] = L"Software\\Microsoft\\Windows\\CurrentVersion\\Explorer\\Accent";
+    const wchar_t HIGH_CONTRAST_KEY[] = L"Control Panel\\Accessibility\\HighContrast";
+
+    AppTheme ReadTheme(const wchar_t* value)
+    {
+        DWORD light = 1;
+        DWORD size = sizeof(light);
+        if (RegGetValueW(HKEY_CURRENT_USER, PERSONALIZE_KEY, value, RRF_RT_REG_DWORD, nullptr, &light, &size) != ERROR_SUCCESS)
+        {
+            return AppTheme::Light;
+        }
+        return light ? AppTheme::Light : AppTheme::Dark;
+    }
+
+    uint32_t PaletteColor(const BYTE* rgba)
+    {
+        return static_cast<uint32_t>(rgba[0]) << 16 | static_cast<uint32_t>(rgba[1]) << 8 | rgba[2];
+    }
+}
+
+RegistryThemeSource::RegistryThemeSource() :
+    _cancelled(CreateEventW(nullptr, TRUE, FALSE, nullptr))
+{
+    const wchar_t* paths[] = { PERSONALIZE_KEY, ACCENT_KEY, HIGH_CONTRAST_KEY };
+    for (size_t i = 0; i < _keys.size(); ++i)
+    {
+        auto& watched = _keys[i];
+        if (RegOpenKeyExW(HKEY_CURRENT_USER, paths[i], 0, KEY_NOTIFY, &watched.key) != ERROR_SUCCESS)
+        {
+            watched.key = nullptr;
+            continue;
+        }
+        watched.changed = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+        Arm(watched);
+    }
+}
+
+RegistryThemeSource::~RegistryThemeSource()
+{
+    for (auto& watched : _keys)
+    {
+        if (watched.key)
+        {
+            RegCloseKey(watched.key);
+        }
+        if (watched.changed)
+        {
+            CloseHandle(watched.changed);
+        }
+    }
+    if (_cancelled)
+    {
+        CloseHandle(_cancelled);
+    }
+}
+
+bool RegistryThemeSource::Arm(WatchedKey& watched)
+{
+    return watched.key && watched.changed &&
+           RegNotifyChangeKeyValue(watched.key, TRUE, REG_NOTIFY_CHANGE_LAST_SET | REG_NOTIFY_THREAD_AGNOSTIC, watched.changed, TRUE) == ERROR_SUCCESS;
+}
+
+ThemeSnapshot RegistryThemeSource::Read()
+{
+    ThemeSnapshot snapshot;
+    snapshot.appTheme = ReadTheme(L"AppsUseLightTheme");
+    snapshot.systemTheme = ReadTheme(L"SystemUsesLightTheme");
+
+    // Light3, Light2, Light1, the accent color, Dark1, Dark2 and Dark3, as RGBA
+    BYTE palette[8 * 4] = {};
+    DWORD size = sizeof(palette);
+    if (RegGetValueW(HKEY_CURRENT_USER, ACCENT_KEY, L"AccentPalette", RRF_RT_REG_BINARY, nullptr, palette, &size) == ERROR_SUCCESS &&
+        size >= 7 * 4)
+    {
+        for (size_t i = 0; i < 3; ++i)
+        {
+            snapshot.accentLight[i] = PaletteColor(palette + (2 - i) * 4);
+            snapshot.accentDark[i] = PaletteColor(palette + (4 + i) * 4);
+        }
+        snapshot.accentColor = PaletteColor(palette + 3 * 4);
+    }
+
+    HIGHCONTRASTW highContrast{ sizeof(highContrast) };
+    snapshot.highContrast = SystemParametersInfoW(SPI_GETHIGHCONTRAST, sizeof(highContrast), &highContrast, 0) &&
+                            (highContrast.dwFlags & HCF_HIGHCONTRASTON) != 0;
+    return snapshot;
+}
+
+ThemeSourceWait RegistryThemeSource::Wait(std::chrono::milliseconds timeout)
+{
+    std::vector<HANDLE> handles{ _cancelled };
+    std::vector<WatchedKey*> keys{ nullptr };
+    for (auto& watched : _keys)
+    {
+        if (watched.changed)
+        {
+            handles.push_back(watched.changed);
+            keys.push_back(&watched);
+        }
+    }
+
+    const DWORD milliseconds = timeout == Infinite ? INFINITE : static_cast<DWORD>((std::min)(timeout.count(), std::chrono::milliseconds::rep{ INFINITE - 1 }));
+    const DWORD result = WaitForMultipleObjects(static_cast<DWORD>(handles.size()), handles.data(), FALSE, milliseconds);
+    if (result == WAIT_TIMEOUT)
+    {
+        return ThemeSourceWait::Timeout;
+    }
+
+    const DWORD index = result - WAIT_OBJECT_0;
+    if (index == 0 || index >= handles.size())
+    {
+        return ThemeSourceWait::Cancelled;
+    }
+
+    // Rearmed before the values are read, so that a change while reading isn't missed
+    ResetEvent(keys[index]->changed);
+    if (!Arm(*keys[index]))
+    {
+        CloseHandle(keys[index]->changed);
+        keys[index]->changed = nullptr;
+    }
+    return ThemeSourceWait::Changed;
+}
+
+void RegistryThemeSource::Cancel()
+{
+    SetEvent(_cancelled);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <windows.h>
+
+#include <array>
+
+#include "theme_broadcaster.h"
+
+// Reads the theme from the registry of the current user and waits for changes of its keys
+class RegistryThemeSource : public ThemeSource
+{
+public:
+    RegistryThemeSource();
+    ~RegistryThemeSource();
+
+    RegistryThemeSource(const RegistryThemeSource&) = delete;
+    RegistryThemeSource& operator=(const RegistryThemeSource&) = delete;
+
+    ThemeSnapshot Read() override;
+    ThemeSourceWait Wait(std::chrono::milliseconds timeout) override;
+    void Cancel() override;
+
+private:
+    struct WatchedKey
+    {
+        HKEY key = nullptr;
+        HANDLE changed = nullptr;
+    };
+
+    // Asks for the next change of the key, the notification is one-shot
+    static bool Arm(WatchedKey& watched);
+
+    std::array<WatchedKey, 3> _keys;
+    HANDLE _cancelled = nullptr;
+};
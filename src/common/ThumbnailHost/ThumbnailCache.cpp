@@ -0,0 +1,234 @@
+#include "ThumbnailCache.h"
+
+#include <cstring>
+#include <cwctype>
+#include <filesystem>
+#include <format>
+#include <optional>
+
+#include <wil/resource.h>
+
+namespace
+{
+    constexpr wchar_t IndexFileName[] = L"index.dat";
+    constexpr wchar_t PixelsExtension[] = L".pixels";
+
+    std::wstring MutexName(const std::wstring& directory)
+    {
+        std::wstring normalized = directory;
+        for (auto& c : normalized)
+        {
+            c = static_cast<wchar_t>(std::towlower(c));
+        }
+        return std::format(L"Local\\PowerToys.ThumbnailCache.{:016x}", ThumbnailContentHash(normalized.data(), normalized.size() * sizeof(wchar_t)));
+    }
+
+    // Maps a whole file for reading
+    struct MappedFile
+    {
+        wil::unique_hfile file;
+        wil::unique_handle section;
+        wil::unique_mapview_ptr<void> view;
+        uint64_t size = 0;
+
+        bool Open(const std::wstring& path)
+        {
+            file.reset(CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
+            LARGE_INTEGER fileSize{};
+            if (!file || !GetFileSizeEx(file.get(), &fileSize) || fileSize.QuadPart == 0)
+            {
+                return false;
+            }
+            size = fileSize.QuadPart;
+            section.reset(CreateFileMappingW(file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+            if (!section)
+            {
+                return false;
+            }
+            view.reset(MapViewOfFile(section.get(), FILE_MAP_READ, 0, 0, 0));
+            return view != nullptr;
+        }
+    };
+}
+
+HBITMAP CreateThumbnailBitmap(const uint32_t width, const uint32_t height, const void* pixels) noexcept
+{
+    BITMAPINFO info{};
+    info.bmiHeader.biSize = sizeof(info.bmiHeader);
+    info.bmiHeader.biWidth = width;
+    info.bmiHeader.biHeight = -static_cast<LONG>(height);
+    info.bmiHeader.biPlanes = 1;
+    info.bmiHeader.biBitCount = 32;
+    info.bmiHeader.biCompression = BI_RGB;
+    void* bits = nullptr;
+    HBITMAP bitmap = CreateDIBSection(nullptr, &info, DIB_RGB_COLORS, &bits, nullptr, 0);
+    if (bitmap)
+    {
+        std::memcpy(bits, pixels, static_cast<size_t>(width) * height * 4);
+    }
+    return bitmap;
+}
+
+struct ThumbnailCache::State
+{
+    wil::unique_mutex_nothrow mutex;
+    wil::unique_hfile indexFile;
+    wil::unique_handle indexSection;
+    wil::unique_mapview_ptr<void> indexView;
+    std::optional<ThumbnailCacheIndex> index;
+
+    // Taken for every access to the index, also between the threads of a process
+    [[nodiscard]] auto Lock()
+    {
+        // An abandoned mutex still grants ownership. At worst the index lost track of a thumbnail.
+        WaitForSingleObject(mutex.get(), INFINITE);
+        return wil::scope_exit([this] { mutex.ReleaseMutex(); });
+    }
+};
+
+ThumbnailCacheKey ThumbnailCache::MakeKey(const void* content, const size_t size, const uint32_t cx) noexcept
+{
+    return { ThumbnailContentHash(content, size), size, cx };
+}
+
+ThumbnailCache::ThumbnailCache(std::wstring directory, const uint64_t maxBytes, const uint32_t slotCount) :
+    _directory{ std::move(directory) }, _maxBytes{ maxBytes }
+{
+    std::error_code error;
+    std::filesystem::create_directories(_directory, error);
+    if (error)
+    {
+        return;
+    }
+
+    auto state = std::make_unique<State>();
+    if (FAILED(state->mutex.create(MutexName(_directory).c_str())))
+    {
+        return;
+    }
+    auto lock = state->Lock();
+
+    const std::wstring indexPath = _directory + L"\\" + IndexFileName;
+    state->indexFile.reset(CreateFileW(indexPath.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+    if (!state->indexFile)
+    {
+        return;
+    }
+    const uint64_t indexSize = ThumbnailCacheIndex::SizeFor(slotCount);
+    state->indexSection.reset(CreateFileMappingW(state->indexFile.get(), nullptr, PAGE_READWRITE, static_cast<DWORD>(indexSize >> 32), static_cast<DWORD>(indexSize), nullptr));
+    if (!state->indexSection)
+    {
+        return;
+    }
+    state->indexView.reset(MapViewOfFile(state->indexSection.get(), FILE_MAP_ALL_ACCESS, 0, 0, static_cast<SIZE_T>(indexSize)));
+    if (!state->indexView)
+    {
+        return;
+    }
+    state->index.emplace(state->indexView.get(), slotCount);
+
+    // A new or incompatible index doesn't know about the pixels left around
+    if (state->index->Formatted())
+    {
+        for (const auto& file : std::filesystem::directory_iterator(_directory, error))
+        {
+            if (file.path().extension() == PixelsExtension)
+            {
+                std::filesystem::remove(file.path(), error);
+            }
+        }
+    }
+
+    lock.reset();
+    _state = std::move(state);
+}
+
+ThumbnailCache::~ThumbnailCache() = default;
+
+bool ThumbnailCache::Available() const noexcept
+{
+    return _state != nullptr;
+}
+
+std::wstring ThumbnailCache::PixelsPath(const ThumbnailCacheKey& key) const
+{
+    return std::format(L"{}\\{:016x}-{:x}-{}{}", _directory, key.hash, key.inputSize, key.cx, PixelsExtension);
+}
+
+bool ThumbnailCache::Lookup(const ThumbnailCacheKey& key, HBITMAP* bitmap)
+{
+    if (!_state)
+    {
+        return false;
+    }
+
+    uint32_t width = 0;
+    uint32_t height = 0;
+    {
+        auto lock = _state->Lock();
+        const auto entry = _state->index->Find(key);
+        if (!entry)
+        {
+            return false;
+        }
+        width = entry->width;
+        height = entry->height;
+    }
+
+    MappedFile pixels;
+    if (!pixels.Open(PixelsPath(key)) || pixels.size != static_cast<uint64_t>(width) * height * 4)
+    {
+        auto lock = _state->Lock();
+        _state->index->Remove(key);
+        return false;
+    }
+    *bitmap = CreateThumbnailBitmap(width, height, pixels.view.get());
+    return *bitmap != nullptr;
+}
+
+void ThumbnailCache::Store(const ThumbnailCacheKey& key, const uint32_t width, const uint32_t height, const void* pixels)
+{
+    if (!_state)
+    {
+        return;
+    }
+
+    // Written aside and moved in place, so that a lookup never maps a partial file
+    const std::wstring path = PixelsPath(key);
+    const std::wstring temporaryPath = path + L"." + std::to_wstring(GetCurrentProcessId()) + L"." + std::to_wstring(GetCurrentThreadId());
+    {
+        wil::unique_hfile file{ CreateFileW(temporaryPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr) };
+        if (!file)
+        {
+            return;
+        }
+        const DWORD size = width * height * 4;
+        DWORD written = 0;
+        if (!WriteFile(file.get(), pixels, size, &written, nullptr) || written != size)
+        {
+            file.reset();
+            DeleteFileW(temporaryPath.c_str());
+            return;
+        }
+    }
+
+    auto lock = _state->Lock();
+    if (!MoveFileExW(temporaryPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING))
+    {
+        DeleteFileW(temporaryPath.c_str());
+        return;
+    }
+    auto result = _state->index->Insert(key, width, height, _maxBytes);
+    if (!result.stored)
+    {
+        DeleteFileW(path.c_str());
+    }
+    for (const auto& evicted : result.evicted)
+    {
+        // Replaced by the pixels just deleted
+        if (evicted != key)
+        {
+            DeleteFileW(PixelsPath(evicted).c_str());
+        }
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <Windows.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "ThumbnailCacheIndex.h"
+
+// Creates the top-down 32bpp ARGB DIB handed to the shell from width * height pixels
+HBITMAP CreateThumbnailBitmap(uint32_t width, uint32_t height, const void* pixels) noexcept;
+
+// Rendered thumbnails stored on disk, addressed by the hash of the file contents and the requested size. The index is
+// a file mapped by every process using the directory, guarded by a named mutex, and the pixels of each thumbnail are
+// kept in a file of their own. The least recently used thumbnails are deleted to keep the pixels within maxBytes.
+class ThumbnailCache
+{
+public:
+    static constexpr uint64_t DefaultMaxBytes = 256ull << 20;
+    static constexpr uint32_t DefaultSlotCount = 1 << 15;
+
+    static ThumbnailCacheKey MakeKey(const void* content, size_t size, uint32_t cx) noexcept;
+
+    explicit ThumbnailCache(std::wstring directory, uint64_t maxBytes = DefaultMaxBytes, uint32_t slotCount = DefaultSlotCount);
+    ThumbnailCache(const ThumbnailCache&) = delete;
+    ThumbnailCache& operator=(const ThumbnailCache&) = delete;
+    ~ThumbnailCache();
+
+    // False if the directory couldn't be set up, in which case lookups miss and nothing is stored
+    bool Available() const noexcept;
+
+    bool Lookup(const ThumbnailCacheKey& key, HBITMAP* bitmap);
+    void Store(const ThumbnailCacheKey& key, uint32_t width, uint32_t height, const void* pixels);
+
+private:
+    struct State;
+
+    std::wstring PixelsPath(const ThumbnailCacheKey& key) const;
+
+    std::wstring _directory;
+    uint64_t _maxBytes;
+    std::unique_ptr<State> _state;
+};
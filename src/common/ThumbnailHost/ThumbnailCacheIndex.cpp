@@ -0,0 +1,306 @@
+#include "ThumbnailCacheIndex.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    constexpr uint64_t Prime1 = 11400714785074694791ull;
+    constexpr uint64_t Prime2 = 14029467366897019727ull;
+    constexpr uint64_t Prime3 = 1609587929392839161ull;
+    constexpr uint64_t Prime4 = 9650029242287828579ull;
+    constexpr uint64_t Prime5 = 2870177450012600261ull;
+
+    inline uint64_t RotateLeft(const uint64_t value, const int bits) noexcept
+    {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    inline uint64_t Read64(const unsigned char* data) noexcept
+    {
+        uint64_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    inline uint32_t Read32(const unsigned char* data) noexcept
+    {
+        uint32_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    inline uint64_t Round(uint64_t accumulator, const uint64_t input) noexcept
+    {
+        accumulator += input * Prime2;
+        return RotateLeft(accumulator, 31) * Prime1;
+    }
+
+    inline uint64_t Merge(const uint64_t accumulator, const uint64_t value) noexcept
+    {
+        return (accumulator ^ Round(0, value)) * Prime1 + Prime4;
+    }
+
+    // Entries are kept below these loads, so that probing always ends on an empty slot
+    constexpr uint32_t MaxUsed(const uint32_t slotCount) noexcept
+    {
+        return slotCount / 4 * 3;
+    }
+
+    constexpr uint32_t MaxOccupied(const uint32_t slotCount) noexcept
+    {
+        return slotCount / 8 * 7;
+    }
+}
+
+uint64_t ThumbnailContentHash(const void* data, const size_t size, const uint64_t seed) noexcept
+{
+    auto input = static_cast<const unsigned char*>(data);
+    const auto end = input + size;
+    uint64_t hash;
+
+    if (size >= 32)
+    {
+        uint64_t v1 = seed + Prime1 + Prime2;
+        uint64_t v2 = seed + Prime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - Prime1;
+        const auto limit = end - 32;
+        do
+        {
+            v1 = Round(v1, Read64(input));
+            v2 = Round(v2, Read64(input + 8));
+            v3 = Round(v3, Read64(input + 16));
+            v4 = Round(v4, Read64(input + 24));
+            input += 32;
+        } while (input <= limit);
+
+        hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+        hash = Merge(hash, v1);
+        hash = Merge(hash, v2);
+        hash = Merge(hash, v3);
+        hash = Merge(hash, v4);
+    }
+    else
+    {
+        hash = seed + Prime5;
+    }
+
+    hash += size;
+    for (; input + 8 <= end; input += 8)
+    {
+        hash ^= Round(0, Read64(input));
+        hash = RotateLeft(hash, 27) * Prime1 + Prime4;
+    }
+    if (input + 4 <= end)
+    {
+        hash ^= Read32(input) * Prime1;
+        hash = RotateLeft(hash, 23) * Prime2 + Prime3;
+        input += 4;
+    }
+    for (; input < end; ++input)
+    {
+        hash ^= *input * Prime5;
+        hash = RotateLeft(hash, 11) * Prime1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= Prime2;
+    hash ^= hash >> 29;
+    hash *= Prime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+size_t ThumbnailCacheIndex::SizeFor(const uint32_t slotCount) noexcept
+{
+    return sizeof(Header) + static_cast<size_t>(slotCount) * sizeof(Entry);
+}
+
+ThumbnailCacheIndex::ThumbnailCacheIndex(void* memory, const uint32_t slotCount) noexcept :
+    _header{ static_cast<Header*>(memory) },
+    _entries{ reinterpret_cast<Entry*>(static_cast<char*>(memory) + sizeof(Header)) },
+    _slotCount{ slotCount }
+{
+    if (_header->magic != Magic || _header->version != Version || _header->slotCount != slotCount || !Consistent())
+    {
+        std::memset(memory, 0, SizeFor(slotCount));
+        *_header = Header{ .magic = Magic, .version = Version, .slotCount = slotCount };
+        _formatted = true;
+    }
+}
+
+// Whether the counters of the header match the entries
+bool ThumbnailCacheIndex::Consistent() const noexcept
+{
+    uint64_t used = 0;
+    uint64_t removed = 0;
+    uint64_t totalBytes = 0;
+    for (uint32_t i = 0; i < _slotCount; ++i)
+    {
+        const Entry& entry = _entries[i];
+        if (entry.state == Used)
+        {
+            ++used;
+            totalBytes += entry.Bytes();
+        }
+        else if (entry.state == Removed)
+        {
+            ++removed;
+        }
+        else if (entry.state != Empty)
+        {
+            return false;
+        }
+    }
+    return used == _header->count && removed == _header->tombstones && totalBytes == _header->totalBytes &&
+           used + removed <= MaxOccupied(_slotCount);
+}
+
+size_t ThumbnailCacheIndex::Home(const uint64_t hash) const noexcept
+{
+    return static_cast<size_t>(hash % _slotCount);
+}
+
+ThumbnailCacheIndex::Entry* ThumbnailCacheIndex::Lookup(const ThumbnailCacheKey& key) noexcept
+{
+    const size_t slotCount = _slotCount;
+    for (size_t i = 0, slot = Home(key.hash); i < slotCount; ++i, slot = (slot + 1) % slotCount)
+    {
+        Entry& entry = _entries[slot];
+        if (entry.state == Empty)
+        {
+            return nullptr;
+        }
+        if (entry.state == Used && entry.Key() == key)
+        {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+const ThumbnailCacheIndex::Entry* ThumbnailCacheIndex::Find(const ThumbnailCacheKey& key) noexcept
+{
+    Entry* entry = Lookup(key);
+    if (entry)
+    {
+        entry->lastUse = ++_header->clock;
+    }
+    return entry;
+}
+
+void ThumbnailCacheIndex::Erase(Entry& entry) noexcept
+{
+    _header->totalBytes -= entry.Bytes();
+    --_header->count;
+    ++_header->tombstones;
+    entry.state = Removed;
+}
+
+void ThumbnailCacheIndex::Remove(const ThumbnailCacheKey& key) noexcept
+{
+    if (Entry* entry = Lookup(key))
+    {
+        Erase(*entry);
+    }
+}
+
+// Only fails if another process filled every slot behind our back
+bool ThumbnailCacheIndex::Place(const Entry& entry) noexcept
+{
+    const size_t slotCount = _slotCount;
+    for (size_t i = 0, slot = Home(entry.hash); i < slotCount; ++i, slot = (slot + 1) % slotCount)
+    {
+        Entry& target = _entries[slot];
+        if (target.state != Used)
+        {
+            if (target.state == Removed)
+            {
+                --_header->tombstones;
+            }
+            target = entry;
+            target.state = Used;
+            ++_header->count;
+            _header->totalBytes += entry.Bytes();
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<ThumbnailCacheIndex::Entry*> ThumbnailCacheIndex::UsedEntries()
+{
+    std::vector<Entry*> used;
+    used.reserve((std::min)(_header->count, _slotCount));
+    for (uint32_t i = 0; i < _slotCount; ++i)
+    {
+        if (_entries[i].state == Used)
+        {
+            used.push_back(&_entries[i]);
+        }
+    }
+    return used;
+}
+
+void ThumbnailCacheIndex::Rebuild()
+{
+    std::vector<Entry> used;
+    for (const Entry* entry : UsedEntries())
+    {
+        used.push_back(*entry);
+    }
+
+    std::memset(_entries, 0, static_cast<size_t>(_slotCount) * sizeof(Entry));
+    _header->count = 0;
+    _header->tombstones = 0;
+    _header->totalBytes = 0;
+    for (const auto& entry : used)
+    {
+        Place(entry);
+    }
+}
+
+ThumbnailCacheIndex::InsertResult ThumbnailCacheIndex::Insert(const ThumbnailCacheKey& key, const uint32_t width, const uint32_t height, const uint64_t maxBytes)
+{
+    InsertResult result;
+    const uint64_t bytes = static_cast<uint64_t>(width) * height * 4;
+    Entry* existing = Lookup(key);
+    if (existing)
+    {
+        Erase(*existing);
+    }
+    if (bytes > maxBytes || MaxUsed(_slotCount) == 0)
+    {
+        // The thumbnail it replaces is gone as well
+        if (existing)
+        {
+            result.evicted.push_back(key);
+        }
+        return result;
+    }
+
+    if (_header->totalBytes + bytes > maxBytes || _header->count + 1 > MaxUsed(_slotCount))
+    {
+        auto used = UsedEntries();
+        std::sort(used.begin(), used.end(), [](const Entry* a, const Entry* b) { return a->lastUse < b->lastUse; });
+        for (Entry* entry : used)
+        {
+            if (_header->totalBytes + bytes <= maxBytes && _header->count + 1 <= MaxUsed(_slotCount))
+            {
+                break;
+            }
+            result.evicted.push_back(entry->Key());
+            Erase(*entry);
+        }
+    }
+
+    if (_header->count + _header->tombstones + 1 > MaxOccupied(_slotCount))
+    {
+        Rebuild();
+    }
+
+    Entry entry{ .hash = key.hash, .inputSize = key.inputSize, .cx = key.cx, .width = width, .height = height, .lastUse = ++_header->clock };
+    result.stored = Place(entry);
+    return result;
+}
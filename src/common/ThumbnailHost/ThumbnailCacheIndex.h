@@ -0,0 +1,105 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// XXH64 of the content, used to address cached thumbnails by what they were rendered from
+uint64_t ThumbnailContentHash(const void* data, size_t size, uint64_t seed = 0) noexcept;
+
+struct ThumbnailCacheKey
+{
+    uint64_t hash = 0;
+    uint64_t inputSize = 0;
+    uint32_t cx = 0;
+
+    bool operator==(const ThumbnailCacheKey&) const = default;
+};
+
+// Hash table of the cached thumbnails, laid out in a caller provided block of memory so that it can live in a file
+// mapping shared by the processes using the cache. Entries are ordered for eviction by their last use. Not
+// synchronized.
+class ThumbnailCacheIndex
+{
+public:
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t slotCount;
+        uint32_t count;
+        uint32_t tombstones;
+        uint32_t reserved;
+        uint64_t totalBytes;
+        uint64_t clock;
+    };
+    static_assert(sizeof(Header) == 40);
+
+    struct Entry
+    {
+        uint64_t hash;
+        uint64_t inputSize;
+        uint32_t cx;
+        uint32_t state;
+        uint32_t width;
+        uint32_t height;
+        uint64_t lastUse;
+
+        ThumbnailCacheKey Key() const noexcept { return { hash, inputSize, cx }; }
+        uint64_t Bytes() const noexcept { return static_cast<uint64_t>(width) * height * 4; }
+    };
+    static_assert(sizeof(Entry) == 40);
+
+    struct InsertResult
+    {
+        bool stored = false;
+        // Entries removed to make room, whose pixels are to be deleted
+        std::vector<ThumbnailCacheKey> evicted;
+    };
+
+    static size_t SizeFor(uint32_t slotCount) noexcept;
+
+    // memory must hold SizeFor(slotCount) bytes. It's formatted unless it already holds a consistent index of that
+    // size, see Formatted. The memory may be written by other processes at any time, so its header is never trusted
+    // for bounds.
+    ThumbnailCacheIndex(void* memory, uint32_t slotCount) noexcept;
+
+    // Whether the memory had to be formatted, dropping what it held
+    bool Formatted() const noexcept { return _formatted; }
+
+    // Marks the entry as the most recently used one
+    const Entry* Find(const ThumbnailCacheKey& key) noexcept;
+
+    // Adds or updates the entry for a width * height thumbnail, evicting the least recently used ones to stay within
+    // maxBytes of pixels. A thumbnail larger than maxBytes isn't stored, and the one it replaces is evicted.
+    InsertResult Insert(const ThumbnailCacheKey& key, uint32_t width, uint32_t height, uint64_t maxBytes);
+
+    void Remove(const ThumbnailCacheKey& key) noexcept;
+
+    uint32_t Count() const noexcept { return _header->count; }
+    uint64_t TotalBytes() const noexcept { return _header->totalBytes; }
+
+private:
+    static constexpr uint32_t Magic = 0x58494354;
+    static constexpr uint32_t Version = 1;
+
+    enum State : uint32_t
+    {
+        Empty = 0,
+        Used = 1,
+        Removed = 2,
+    };
+
+    Entry* Lookup(const ThumbnailCacheKey& key) noexcept;
+    void Erase(Entry& entry) noexcept;
+    bool Place(const Entry& entry) noexcept;
+    void Rebuild();
+    size_t Home(uint64_t hash) const noexcept;
+    std::vector<Entry*> UsedEntries();
+    bool Consistent() const noexcept;
+
+    Header* _header;
+    Entry* _entries;
+    // Size of the mapping, fixed when it's opened
+    uint32_t _slotCount;
+    bool _formatted = false;
+};
@@ -0,0 +1,434 @@
+#include "ThumbnailHost.h"
+
+#include <algorithm>
+#include <cstring>
+#include <optional>
+
+#include <objbase.h>
+#include <wil/result.h>
+
+namespace
+{
+    // Data sections are allocated in steps, and the large ones are dropped once the request is done. Mirrored by
+    // ThumbnailHostServer.cs.
+    constexpr uint64_t SectionGranularity = 1 << 20;
+    constexpr uint64_t RetainedCapacity = 16 << 20;
+
+    std::wstring WorkerName()
+    {
+        GUID guid{};
+        wchar_t guidString[40]{};
+        if (FAILED(CoCreateGuid(&guid)) || !StringFromGUID2(guid, guidString, ARRAYSIZE(guidString)))
+        {
+            static LONG counter = 0;
+            return L"Local\\PowerToys.ThumbnailHost." + std::to_wstring(GetCurrentProcessId()) + L"." + std::to_wstring(InterlockedIncrement(&counter));
+        }
+        return L"Local\\PowerToys.ThumbnailHost." + std::to_wstring(GetCurrentProcessId()) + L"." + guidString;
+    }
+
+    wil::unique_handle CreateSection(const std::wstring& name, const uint64_t size)
+    {
+        return wil::unique_handle{ CreateFileMappingW(INVALID_HANDLE_VALUE,
+                                                      nullptr,
+                                                      PAGE_READWRITE | SEC_COMMIT,
+                                                      static_cast<DWORD>(size >> 32),
+                                                      static_cast<DWORD>(size),
+                                                      name.c_str()) };
+    }
+
+    // Size of what's left to read from the stream, if it can tell
+    bool RemainingSize(IStream* stream, uint64_t& size)
+    {
+        STATSTG stat{};
+        ULARGE_INTEGER position{};
+        if (FAILED(stream->Stat(&stat, STATFLAG_NONAME)) || FAILED(stream->Seek({}, STREAM_SEEK_CUR, &position)))
+        {
+            return false;
+        }
+        size = stat.cbSize.QuadPart > position.QuadPart ? stat.cbSize.QuadPart - position.QuadPart : 0;
+        return true;
+    }
+
+    HRESULT ReadExactly(IStream* stream, char* destination, uint64_t size)
+    {
+        while (size > 0)
+        {
+            ULONG read = 0;
+            const ULONG chunk = static_cast<ULONG>((std::min<uint64_t>)(size, 1 << 30));
+            const HRESULT hr = stream->Read(destination, chunk, &read);
+            if (FAILED(hr))
+            {
+                return hr;
+            }
+            if (read == 0)
+            {
+                return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+            }
+            destination += read;
+            size -= read;
+        }
+        return S_OK;
+    }
+
+    // Runs the workers as child processes. They are assigned to a job object, so they are killed along with the host.
+    class ProcessLauncher : public ThumbnailHost::IWorkerLauncher
+    {
+    public:
+        explicit ProcessLauncher(std::wstring workerPath) :
+            _workerPath{ std::move(workerPath) }
+        {
+            _job.reset(CreateJobObjectW(nullptr, nullptr));
+            if (_job)
+            {
+                JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits{};
+                limits.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE;
+                if (!SetInformationJobObject(_job.get(), JobObjectExtendedLimitInformation, &limits, sizeof(limits)))
+                {
+                    _job.reset();
+                }
+            }
+        }
+
+        HRESULT Launch(const std::wstring& name, wil::unique_handle& exited) override
+        {
+            std::wstring commandLine = L"\"" + _workerPath + L"\" --host " + name;
+            STARTUPINFOW startupInfo{ sizeof(startupInfo) };
+            PROCESS_INFORMATION processInfo{};
+            if (!CreateProcessW(_workerPath.c_str(),
+                                commandLine.data(),
+                                nullptr,
+                                nullptr,
+                                FALSE,
+                                CREATE_SUSPENDED | CREATE_NO_WINDOW,
+                                nullptr,
+                                nullptr,
+                                &startupInfo,
+                                &processInfo))
+            {
+                return HRESULT_FROM_WIN32(GetLastError());
+            }
+            exited.reset(processInfo.hProcess);
+            if (_job)
+            {
+                AssignProcessToJobObject(_job.get(), processInfo.hProcess);
+            }
+            ResumeThread(processInfo.hThread);
+            CloseHandle(processInfo.hThread);
+            return S_OK;
+        }
+
+        void Terminate(const HANDLE exited) override
+        {
+            TerminateProcess(exited, 1);
+        }
+
+    private:
+        std::wstring _workerPath;
+        wil::unique_handle _job;
+    };
+
+    HRESULT ReadToEnd(IStream* stream, std::vector<char>& buffer)
+    {
+        char chunk[64 * 1024];
+        while (true)
+        {
+            ULONG read = 0;
+            const HRESULT hr = stream->Read(chunk, sizeof(chunk), &read);
+            if (FAILED(hr))
+            {
+                return hr;
+            }
+            buffer.insert(buffer.end(), chunk, chunk + read);
+            if (hr == S_FALSE || read == 0)
+            {
+                return S_OK;
+            }
+        }
+    }
+
+    // Reads what's left of the stream into memory
+    HRESULT ReadContents(IStream* stream, std::vector<char>& contents)
+    {
+        try
+        {
+            uint64_t size = 0;
+            if (!RemainingSize(stream, size))
+            {
+                return ReadToEnd(stream, contents);
+            }
+            contents.resize(static_cast<size_t>(size));
+            return ReadExactly(stream, contents.data(), size);
+        }
+        catch (const std::bad_alloc&)
+        {
+            return E_OUTOFMEMORY;
+        }
+    }
+}
+
+struct ThumbnailHost::Worker
+{
+    std::wstring name;
+    wil::unique_handle control;
+    wil::unique_mapview_ptr<Header> header;
+    wil::unique_event_nothrow request;
+    wil::unique_event_nothrow response;
+    wil::unique_handle data;
+    wil::unique_mapview_ptr<char> view;
+    // Signaled once the worker stopped, null if it was never started
+    wil::unique_handle exited;
+    bool busy = false;
+
+    HRESULT Open()
+    {
+        name = WorkerName();
+        control = CreateSection(name + L".Control", sizeof(Header));
+        if (!control)
+        {
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+        header.reset(static_cast<Header*>(MapViewOfFile(control.get(), FILE_MAP_ALL_ACCESS, 0, 0, sizeof(Header))));
+        if (!header)
+        {
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+        RETURN_IF_FAILED(request.create(wil::EventOptions::None, (name + L".Request").c_str()));
+        RETURN_IF_FAILED(response.create(wil::EventOptions::None, (name + L".Response").c_str()));
+        *header = Header{ .magic = HeaderMagic, .status = StatusPending };
+        return S_OK;
+    }
+
+    // The worker maps the new section when it sees the generation change
+    HRESULT Reserve(const uint64_t size)
+    {
+        if (view && header->capacity >= size)
+        {
+            return S_OK;
+        }
+        const uint64_t capacity = (std::max)(SectionGranularity, (size + SectionGranularity - 1) / SectionGranularity * SectionGranularity);
+        view.reset();
+        data.reset();
+        const uint32_t generation = header->generation + 1;
+        data = CreateSection(name + L".Data." + std::to_wstring(generation), capacity);
+        if (!data)
+        {
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+        view.reset(static_cast<char*>(MapViewOfFile(data.get(), FILE_MAP_ALL_ACCESS, 0, 0, static_cast<SIZE_T>(capacity))));
+        if (!view)
+        {
+            data.reset();
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+        header->generation = generation;
+        header->capacity = capacity;
+        return S_OK;
+    }
+
+    void Trim()
+    {
+        if (header->capacity > RetainedCapacity)
+        {
+            view.reset();
+            data.reset();
+            header->capacity = 0;
+        }
+    }
+
+    bool Running() const
+    {
+        return exited && WaitForSingleObject(exited.get(), 0) == WAIT_TIMEOUT;
+    }
+
+    void Terminate(IWorkerLauncher& launcher)
+    {
+        if (exited)
+        {
+            launcher.Terminate(exited.get());
+            exited.reset();
+        }
+    }
+};
+
+ThumbnailHost::ThumbnailHost(std::wstring workerPath, std::shared_ptr<ThumbnailCache> cache, const size_t maxWorkers, const std::chrono::milliseconds timeout) :
+    ThumbnailHost{ std::make_unique<ProcessLauncher>(std::move(workerPath)), std::move(cache), maxWorkers, timeout }
+{
+}
+
+ThumbnailHost::ThumbnailHost(std::unique_ptr<IWorkerLauncher> launcher, std::shared_ptr<ThumbnailCache> cache, const size_t maxWorkers, const std::chrono::milliseconds timeout) :
+    _launcher{ std::move(launcher) }, _cache{ std::move(cache) }, _timeout{ timeout }
+{
+    const LONG count = static_cast<LONG>((std::max<size_t>)(maxWorkers, 1));
+    _available.reset(CreateSemaphoreW(nullptr, count, count, nullptr));
+    for (LONG i = 0; i < count; ++i)
+    {
+        _workers.push_back(std::make_unique<Worker>());
+    }
+}
+
+ThumbnailHost::~ThumbnailHost()
+{
+    for (auto& worker : _workers)
+    {
+        worker->Terminate(*_launcher);
+    }
+}
+
+ThumbnailHost::Worker* ThumbnailHost::AcquireWorker()
+{
+    if (!_available || WaitForSingleObject(_available.get(), static_cast<DWORD>(_timeout.count())) != WAIT_OBJECT_0)
+    {
+        return nullptr;
+    }
+
+    // Prefer a worker that is already running
+    std::unique_lock lock{ _mutex };
+    Worker* idle = nullptr;
+    for (auto& worker : _workers)
+    {
+        if (!worker->busy && (!idle || (!idle->Running() && worker->Running())))
+        {
+            idle = worker.get();
+        }
+    }
+    idle->busy = true;
+    return idle;
+}
+
+void ThumbnailHost::ReleaseWorker(Worker* worker)
+{
+    {
+        std::unique_lock lock{ _mutex };
+        worker->busy = false;
+    }
+    ReleaseSemaphore(_available.get(), 1, nullptr);
+}
+
+HRESULT ThumbnailHost::StartWorker(Worker& worker)
+{
+    worker.Terminate(*_launcher);
+    if (!worker.header)
+    {
+        RETURN_IF_FAILED(worker.Open());
+    }
+    return _launcher->Launch(worker.name, worker.exited);
+}
+
+HRESULT ThumbnailHost::GetThumbnail(IStream* stream, const UINT cx, HBITMAP* bitmap, WTS_ALPHATYPE* alpha)
+{
+    if (!stream || !bitmap || !alpha || cx == 0 || cx > MaxThumbnailSize)
+    {
+        return E_INVALIDARG;
+    }
+    *bitmap = nullptr;
+
+    // With a cache, the contents are read and hashed before taking a worker, so that hits neither wait for one nor
+    // touch its section
+    std::vector<char> contents;
+    std::optional<ThumbnailCacheKey> key;
+    if (_cache)
+    {
+        RETURN_IF_FAILED(ReadContents(stream, contents));
+        key = ThumbnailCache::MakeKey(contents.data(), contents.size(), cx);
+        if (_cache->Lookup(*key, bitmap))
+        {
+            *alpha = WTSAT_ARGB;
+            return S_OK;
+        }
+    }
+
+    Worker* worker = AcquireWorker();
+    if (!worker)
+    {
+        return HRESULT_FROM_WIN32(ERROR_TIMEOUT);
+    }
+    auto release = wil::scope_exit([&] { ReleaseWorker(worker); });
+
+    if (!worker->header)
+    {
+        RETURN_IF_FAILED(worker->Open());
+    }
+
+    // Without a cache, the stream is copied straight into the shared section when its size is known. The section
+    // also receives the pixels, which fit in cx * cx.
+    const uint64_t pixelsSize = static_cast<uint64_t>(cx) * cx * 4;
+    uint64_t inputSize = 0;
+    if (!key && RemainingSize(stream, inputSize))
+    {
+        RETURN_IF_FAILED(worker->Reserve((std::max)(inputSize, pixelsSize)));
+        RETURN_IF_FAILED(ReadExactly(stream, worker->view.get(), inputSize));
+    }
+    else
+    {
+        if (!key)
+        {
+            RETURN_IF_FAILED(ReadContents(stream, contents));
+        }
+        inputSize = contents.size();
+        RETURN_IF_FAILED(worker->Reserve((std::max)(inputSize, pixelsSize)));
+        std::memcpy(worker->view.get(), contents.data(), contents.size());
+    }
+    worker->header->inputSize = inputSize;
+    worker->header->cx = cx;
+
+    const HRESULT hr = Render(*worker, cx, bitmap);
+    if (SUCCEEDED(hr))
+    {
+        *alpha = WTSAT_ARGB;
+        if (key)
+        {
+            _cache->Store(*key, worker->header->width, worker->header->height, worker->view.get());
+        }
+    }
+    worker->Trim();
+    return hr;
+}
+
+HRESULT ThumbnailHost::Render(Worker& worker, const UINT cx, HBITMAP* bitmap)
+{
+    // A worker exits after being idle for a while, possibly just as the request was sent. Try again with a new
+    // one then.
+    for (int attempt = 0; attempt < 2; ++attempt)
+    {
+        if (!worker.Running())
+        {
+            RETURN_IF_FAILED(StartWorker(worker));
+        }
+
+        worker.header->status = StatusPending;
+        worker.response.ResetEvent();
+        worker.request.SetEvent();
+
+        const HANDLE handles[] = { worker.response.get(), worker.exited.get() };
+        const DWORD result = WaitForMultipleObjects(ARRAYSIZE(handles), handles, FALSE, static_cast<DWORD>(_timeout.count()));
+        if (result == WAIT_OBJECT_0 + 1)
+        {
+            worker.exited.reset();
+            continue;
+        }
+        if (result != WAIT_OBJECT_0)
+        {
+            worker.Terminate(*_launcher);
+            worker.request.ResetEvent();
+            return HRESULT_FROM_WIN32(ERROR_TIMEOUT);
+        }
+
+        const Header& header = *worker.header;
+        if (header.status != StatusSucceeded)
+        {
+            return E_FAIL;
+        }
+        if (header.width == 0 || header.height == 0 || header.width > cx || header.height > cx)
+        {
+            return E_UNEXPECTED;
+        }
+
+        *bitmap = CreateThumbnailBitmap(header.width, header.height, worker.view.get());
+        if (!*bitmap)
+        {
+            return E_OUTOFMEMORY;
+        }
+        return S_OK;
+    }
+    return E_FAIL;
+}
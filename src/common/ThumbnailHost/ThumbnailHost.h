@@ -0,0 +1,95 @@
+#pragma once
+#include <Windows.h>
+#include <objidl.h>
+#include <thumbcache.h>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <wil/resource.h>
+
+#include "ThumbnailCache.h"
+
+// Thumbnails rendered by the managed helper executables (PowerToys.QoiThumbnailProvider.exe and its Gcode, Stl, Pdf
+// and Svg counterparts). Rather than starting the helper for every thumbnail, the host keeps a few of them running in
+// host mode and exchanges the file contents and the rendered pixels with them through shared memory. Thumbnails
+// already rendered from the same contents are served from the cache, if any.
+class ThumbnailHost
+{
+public:
+    // Layout of the control section shared with a worker, mirrored by ThumbnailHostServer.cs
+    struct Header
+    {
+        uint32_t magic;
+        // Generation of the data section, named <name>.Data.<generation>
+        uint32_t generation;
+        uint64_t capacity;
+        uint64_t inputSize;
+        uint32_t cx;
+        int32_t status;
+        // Size of the 32bpp ARGB top-down pixels written to the data section on success
+        uint32_t width;
+        uint32_t height;
+    };
+    static_assert(sizeof(Header) == 40);
+
+    static constexpr uint32_t HeaderMagic = 0x48545450;
+    static constexpr int32_t StatusPending = -1;
+    static constexpr int32_t StatusSucceeded = 0;
+    static constexpr int32_t StatusFailed = 1;
+
+    // cx is limited like in the helpers, which keeps the pixel buffer of a request below 400 MB
+    static constexpr UINT MaxThumbnailSize = 10000;
+
+    // Starts the workers, so they can be replaced in tests
+    class IWorkerLauncher
+    {
+    public:
+        virtual ~IWorkerLauncher() = default;
+
+        // Starts a worker serving the shared objects named after name. exited is signaled once the worker stopped.
+        virtual HRESULT Launch(const std::wstring& name, wil::unique_handle& exited) = 0;
+
+        // Stops the worker which signals exited, without waiting for it
+        virtual void Terminate(HANDLE exited) = 0;
+    };
+
+    // Runs workerPath in host mode for every worker
+    ThumbnailHost(std::wstring workerPath,
+                  std::shared_ptr<ThumbnailCache> cache = nullptr,
+                  size_t maxWorkers = 2,
+                  std::chrono::milliseconds timeout = std::chrono::seconds{ 30 });
+    ThumbnailHost(std::unique_ptr<IWorkerLauncher> launcher,
+                  std::shared_ptr<ThumbnailCache> cache = nullptr,
+                  size_t maxWorkers = 2,
+                  std::chrono::milliseconds timeout = std::chrono::seconds{ 30 });
+    ThumbnailHost(const ThumbnailHost&) = delete;
+    ThumbnailHost& operator=(const ThumbnailHost&) = delete;
+    ~ThumbnailHost();
+
+    // Reads the stream from its current position and renders it with one of the workers, unless the cache already
+    // holds its thumbnail. Waits for a free worker and for the thumbnail up to the timeout; a worker that doesn't
+    // answer in time is terminated.
+    HRESULT GetThumbnail(IStream* stream, UINT cx, HBITMAP* bitmap, WTS_ALPHATYPE* alpha);
+
+private:
+    struct Worker;
+
+    Worker* AcquireWorker();
+    void ReleaseWorker(Worker* worker);
+    HRESULT StartWorker(Worker& worker);
+    HRESULT Render(Worker& worker, UINT cx, HBITMAP* bitmap);
+
+    std::unique_ptr<IWorkerLauncher> _launcher;
+    std::shared_ptr<ThumbnailCache> _cache;
+    std::chrono::milliseconds _timeout;
+    // Counts the idle workers, bounding the number of thumbnails rendered at once
+    wil::unique_handle _available;
+
+    std::mutex _mutex;
+    std::vector<std::unique_ptr<Worker>> _workers;
+};
@@ -0,0 +1,308 @@
+#include "pch.h"
+#include <common/updating/chunkedDownload.h>
+#include "TestHelpers.h"
+
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace updating;
+
+namespace UnitTestsCommonLib
+{
+    namespace
+    {
+        sha256_digest Digest(const void* data, size_t size)
+        {
+            sha256_hasher hasher;
+            hasher.update(data, size);
+            return hasher.finish();
+        }
+
+        sha256_digest Digest(const std::vector<uint8_t>& bytes)
+        {
+            return Digest(bytes.data(), bytes.size());
+        }
+
+        chunked_download_options Options(uint64_t chunk_size, unsigned parallel_chunks = 4)
+        {
+            chunked_download_options options;
+            options.chunk_size = chunk_size;
+            options.parallel_chunks = parallel_chunks;
+            options.retry_delay = std::chrono::milliseconds{ 0 };
+            return options;
+        }
+    }
+
+    TEST_CLASS (ChunkedDownloadTests)
+    {
+    public:
+        TEST_METHOD (Sha256_KnownDigests)
+        {
+            const std::string message = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+            Assert::AreEqual(std::wstring{ L"e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" }, sha256_to_hex(Digest("", 0)));
+            Assert::AreEqual(std::wstring{ L"ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" }, sha256_to_hex(Digest("abc", 3)));
+            Assert::AreEqual(std::wstring{ L"248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" }, sha256_to_hex(Digest(message.data(), message.size())));
+
+            sha256_hasher hasher;
+            const std::string a(1000, 'a');
+            for (int i = 0; i < 1000; ++i)
+            {
+                hasher.update(a.data(), a.size());
+            }
+            Assert::AreEqual(std::wstring{ L"cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0" }, sha256_to_hex(hasher.finish()));
+        }
+
+        TEST_METHOD (Sha256_AnySplitGivesTheSameDigest)
+        {
+            const auto bytes = RandomBytes(1000, 1);
+            const auto expected = Digest(bytes);
+            for (const size_t piece : { 1, 3, 63, 64, 65, 127, 999 })
+            {
+                sha256_hasher hasher;
+                for (size_t offset = 0; offset < bytes.size(); offset += piece)
+                {
+                    hasher.update(bytes.data() + offset, (std::min)(piece, bytes.size() - offset));
+                }
+                Assert::IsTrue(expected == hasher.finish());
+            }
+        }
+
+        TEST_METHOD (Sha256_ParsesHex)
+        {
+            const auto digest = Digest("abc", 3);
+            Assert::IsTrue(sha256_from_hex(L"BA7816BF8F01CFEA414140DE5DAE2223B00361A396177A9CB410FF61F20015AD") == digest);
+            Assert::IsFalse(sha256_from_hex(L"ba7816bf").has_value());
+            Assert::IsFalse(sha256_from_hex(L"ga7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad").has_value());
+        }
+
+        TEST_METHOD (Download_WritesTheVerifiedFile)
+        {
+            TemporaryDirectory directory;
+            const auto destination = directory.path / L"installer.exe";
+            for (const size_t size : { 0, 1, 1000, 64 * 1024, 64 * 1024 + 1 })
+            {
+                FakeServer server{ RandomBytes(size, static_cast<uint32_t>(size)) };
+                std::mutex progress_mutex;
+                uint64_t last_progress = 0;
+                uint64_t progress_total = 0;
+                auto options = Options(4096);
+                options.progress = [&](uint64_t downloaded, uint64_t total) {
+                    std::scoped_lock lock{ progress_mutex };
+                    last_progress = (std::max)(last_progress, downloaded);
+                    progress_total = total;
+                };
+
+                Assert::IsTrue(download_in_chunks(server, destination, Digest(server.content), options) == chunked_download_result::success);
+                Assert::IsTrue(server.content == ReadFile(destination));
+                Assert::AreEqual(uint64_t{ size }, last_progress);
+                Assert::AreEqual(uint64_t{ size }, progress_total);
+                Assert::IsFalse(std::filesystem::exists(partial_download_path(destination)));
+                Assert::IsFalse(std::filesystem::exists(download_journal_path(destination)));
+            }
+
+            // Without a digest to check against
+            FakeServer server{ RandomBytes(10000, 2) };
+            Assert::IsTrue(download_in_chunks(server, destination, std::nullopt, Options(1024)) == chunked_download_result::success);
+            Assert::IsTrue(server.content == ReadFile(destination));
+        }
+
+        TEST_METHOD (Download_RetriesDroppedChunks)
+        {
+            TemporaryDirectory directory;
+            const auto destination = directory.path / L"installer.exe";
+            FakeServer server{ RandomBytes(1024 * 1024, 3) };
+            server.drop_every = 3;
+            server.piece_size = 1000;
+
+            Assert::IsTrue(download_in_chunks(server, destination, Digest(server.content), Options(32 * 1024)) == chunked_download_result::success);
+            Assert::IsTrue(server.content == ReadFile(destination));
+            Assert::IsTrue(server.requests > 32);
+        }
+
+        TEST_METHOD (Download_ResumesAfterAnInterruption)
+        {
+            TemporaryDirectory directory;
+            const auto destination = directory.path / L"installer.exe";
+            FakeServer server{ RandomBytes(1024 * 1024, 4) };
+            const auto digest = Digest(server.content);
+            const uint64_t chunk_size = 64 * 1024;
+            server.failing_offsets = { 5 * chunk_size, 11 * chunk_size };
+
+            // One chunk at a time, so that the download stops at the first failing chunk
+            Assert::IsTrue(download_in_chunks(server, destination, digest, Options(chunk_size, 1)) == chunked_download_result::network_error);
+            Assert::IsFalse(std::filesystem::exists(destination));
+            Assert::IsTrue(std::filesystem::exists(download_journal_path(destination)));
+            Assert::AreEqual(uint64_t{ 5 * chunk_size }, server.served.load());
+
+            // A new download of the same file, as after a restart, only fetches what's missing
+            server.failing_offsets.clear();
+            server.fetched.clear();
+            server.served = 0;
+            Assert::IsTrue(download_in_chunks(server, destination, digest, Options(chunk_size)) == chunked_download_result::success);
+            Assert::IsTrue(server.content == ReadFile(destination));
+            Assert::AreEqual(server.content.size() - 5 * chunk_size, server.served.load());
+            Assert::IsFalse(server.fetched.contains(4 * chunk_size));
+        }
+
+        TEST_METHOD (Download_StartsOverForAnotherFile)
+        {
+            TemporaryDirectory directory;
+            const auto destination = directory.path / L"installer.exe";
+            FakeServer previous{ RandomBytes(256 * 1024, 5) };
+            previous.failing_offsets = { 128 * 1024 };
+            Assert::IsTrue(download_in_chunks(previous, destination, Digest(previous.content), Options(16 * 1024, 1)) == chunked_download_result::network_error);
+
+            FakeServer server{ RandomBytes(256 * 1024, 6) };
+            Assert::IsTrue(download_in_chunks(server, destination, Digest(server.content), Options(16 * 1024)) == chunked_download_result::success);
+            Assert::IsTrue(server.content == ReadFile(destination));
+            Assert::AreEqual(uint64_t{ server.content.size() }, server.served.load());
+        }
+
+        TEST_METHOD (Download_DiscardsACorruptedFile)
+        {
+            TemporaryDirectory directory;
+            const auto destination = directory.path / L"installer.exe";
+            FakeServer server{ RandomBytes(512 * 1024, 7) };
+            const auto digest = Digest(server.content);
+            server.corrupt_request = 3;
+
+            Assert::IsTrue(download_in_chunks(server, destination, digest, Options(32 * 1024)) == chunked_download_result::digest_mismatch);
+            Assert::IsFalse(std::filesystem::exists(destination));
+            Assert::IsFalse(std::filesystem::exists(partial_download_path(destination)));
+            Assert::IsFalse(std::filesystem::exists(download_journal_path(destination)));
+
+            Assert::IsTrue(download_in_chunks(server, destination, digest, Options(32 * 1024)) == chunked_download_result::success);
+            Assert::IsTrue(server.content == ReadFile(destination));
+        }
+
+        TEST_METHOD (Download_FailsWhenTheServerDoes)
+        {
+            TemporaryDirectory directory;
+            const auto destination = directory.path / L"installer.exe";
+            FakeServer server{ RandomBytes(100000, 8) };
+            server.unreachable = true;
+            Assert::IsTrue(download_in_chunks(server, destination, Digest(server.content), Options(4096)) == chunked_download_result::network_error);
+            Assert::IsFalse(std::filesystem::exists(destination));
+            // Failing to get the size isn't taken for a server that doesn't give it
+            Assert::AreEqual(size_t{ 1 }, server.length_requests.load());
+            Assert::AreEqual(size_t{ 0 }, server.downloads.load());
+
+            server.unreachable = false;
+            server.failing_offsets = { 0 };
+            auto options = Options(4096);
+            options.attempts_per_chunk = 5;
+            Assert::IsTrue(download_in_chunks(server, destination, Digest(server.content), options) == chunked_download_result::network_error);
+            Assert::IsFalse(std::filesystem::exists(destination));
+        }
+
+        TEST_METHOD (Download_WithoutTheSize_DownloadsTheWholeFile)
+        {
+            TemporaryDirectory directory;
+            const auto destination = directory.path / L"installer.exe";
+            FakeServer server{ RandomBytes(100000, 12) };
+            server.sized = false;
+
+            Assert::IsTrue(download_in_chunks(server, destination, Digest(server.content), Options(4096)) == chunked_download_result::success);
+            Assert::IsTrue(server.content == ReadFile(destination));
+            Assert::AreEqual(size_t{ 1 }, server.downloads.load());
+            Assert::AreEqual(size_t{ 0 }, server.requests.load());
+            Assert::IsFalse(std::filesystem::exists(partial_download_path(destination)));
+        }
+
+        TEST_METHOD (Download_WithoutRanges_DownloadsTheWholeFile)
+        {
+            TemporaryDirectory directory;
+            const auto destination = directory.path / L"installer.exe";
+            FakeServer server{ RandomBytes(100000, 13) };
+            server.ranges = false;
+            auto options = Options(4096);
+            options.attempts_per_chunk = 5;
+
+            Assert::IsTrue(download_in_chunks(server, destination, Digest(server.content), options) == chunked_download_result::success);
+            Assert::IsTrue(server.content == ReadFile(destination));
+            Assert::AreEqual(size_t{ 1 }, server.downloads.load());
+            // Not retried once the server answered with the whole file
+            Assert::IsTrue(server.requests <= options.parallel_chunks);
+            Assert::IsFalse(std::filesystem::exists(partial_download_path(destination)));
+            Assert::IsFalse(std::filesystem::exists(download_journal_path(destination)));
+        }
+
+        TEST_METHOD (Download_WholeFile_IsVerified)
+        {
+            TemporaryDirectory directory;
+            const auto destination = directory.path / L"installer.exe";
+            FakeServer server{ RandomBytes(100000, 14) };
+            server.sized = false;
+
+            Assert::IsTrue(download_in_chunks(server, destination, Digest(RandomBytes(100000, 15)), Options(4096)) == chunked_download_result::digest_mismatch);
+            Assert::IsFalse(std::filesystem::exists(destination));
+            Assert::IsFalse(std::filesystem::exists(partial_download_path(destination)));
+
+            server.dropping_downloads = true;
+            Assert::IsTrue(download_in_chunks(server, destination, Digest(server.content), Options(4096)) == chunked_download_result::network_error);
+            Assert::AreEqual(size_t{ 2 }, server.downloads.load());
+            Assert::IsFalse(std::filesystem::exists(destination));
+            Assert::IsFalse(std::filesystem::exists(partial_download_path(destination)));
+        }
+
+        TEST_METHOD (Download_StopsWhenCancelled)
+        {
+            TemporaryDirectory directory;
+            const auto destination = directory.path / L"installer.exe";
+            FakeServer server{ RandomBytes(1024 * 1024, 10) };
+            const auto digest = Digest(server.content);
+            const uint64_t chunk_size = 64 * 1024;
+
+            std::stop_source cancellation;
+            auto options = Options(chunk_size, 1);
+            options.cancellation = cancellation.get_token();
+            options.progress = [&](uint64_t downloaded, uint64_t) {
+                if (downloaded >= 4 * chunk_size)
+                {
+                    cancellation.request_stop();
+                }
+            };
+            Assert::IsTrue(download_in_chunks(server, destination, digest, options) == chunked_download_result::cancelled);
+            Assert::IsFalse(std::filesystem::exists(destination));
+            Assert::AreEqual(uint64_t{ 4 * chunk_size }, server.served.load());
+
+            // Cancelled already: nothing is fetched, and what's on disk is kept
+            Assert::IsTrue(download_in_chunks(server, destination, digest, options) == chunked_download_result::cancelled);
+            Assert::AreEqual(uint64_t{ 4 * chunk_size }, server.served.load());
+
+            server.served = 0;
+            Assert::IsTrue(download_in_chunks(server, destination, digest, Options(chunk_size)) == chunked_download_result::success);
+            Assert::IsTrue(server.content == ReadFile(destination));
+            Assert::AreEqual(server.content.size() - 4 * chunk_size, server.served.load());
+        }
+
+        TEST_METHOD (Download_CancellingStopsTheRetries)
+        {
+            TemporaryDirectory directory;
+            FakeServer server{ RandomBytes(100000, 11) };
+            server.failing_offsets = { 0 };
+
+            std::stop_source cancellation;
+            auto options = Options(4096, 1);
+            options.attempts_per_chunk = 5;
+            options.retry_delay = std::chrono::seconds{ 30 };
+            options.cancellation = cancellation.get_token();
+            std::thread canceller([&] {
+                std::this_thread::sleep_for(std::chrono::milliseconds{ 50 });
+                cancellation.request_stop();
+            });
+
+            const auto start = std::chrono::steady_clock::now();
+            const auto result = download_in_chunks(server, directory.path / L"installer.exe", Digest(server.content), options);
+            canceller.join();
+            Assert::IsTrue(result == chunked_download_result::cancelled);
+            Assert::IsTrue(std::chrono::steady_clock::now() - start < std::chrono::seconds{ 10 });
+        }
+    };
+}
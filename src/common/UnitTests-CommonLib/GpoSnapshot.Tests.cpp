@@ -0,0 +1,170 @@
+#include "pch.h"
+#include <common/utils/gpo.h>
+
+#include <map>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace powertoys_gpo;
+
+namespace UnitTestsCommonLib
+{
+    namespace
+    {
+        const std::wstring ListName = L"PowerLauncherIndividualPluginEnabledList";
+
+        // Policies kept in memory, counting the registry reads
+        class InMemoryPolicyRegistry : public PolicyRegistry
+        {
+        public:
+            std::map<std::pair<HKEY, std::wstring>, PolicyKeyContents> keys;
+            bool canWatch = true;
+            bool changed = false;
+            int reads = 0;
+            int watches = 0;
+
+            PolicyKeyContents& Key(HKEY scope, const std::wstring& path)
+            {
+                auto& key = keys[{ scope, policyName(path) }];
+                key.status = ERROR_SUCCESS;
+                return key;
+            }
+
+            void SetNumber(HKEY scope, const std::wstring& name, DWORD value)
+            {
+                Key(scope, POLICIES_PATH).numbers[policyName(name)] = value;
+            }
+
+            void SetListString(HKEY scope, const std::wstring& name, const std::wstring& value)
+            {
+                auto& root = Key(scope, POLICIES_PATH);
+                if (root.subkeys.empty())
+                {
+                    root.subkeys.push_back(ListName);
+                }
+                Key(scope, POLICIES_PATH + L"\\" + ListName).strings[policyName(name)] = value;
+            }
+
+            PolicyKeyContents ReadKey(HKEY scope, const std::wstring& path) override
+            {
+                ++reads;
+                if (auto key = keys.find({ scope, policyName(path) }); key != keys.end())
+                {
+                    return key->second;
+                }
+                return {};
+            }
+
+            bool WatchChanges() override
+            {
+                ++watches;
+                changed = false;
+                return canWatch;
+            }
+
+            bool HasChanged() override
+            {
+                return changed;
+            }
+        };
+
+        PolicySnapshot Snapshot(InMemoryPolicyRegistry& registry)
+        {
+            return PolicySnapshot::Read(registry, POLICIES_PATH);
+        }
+    }
+
+    TEST_CLASS (GpoSnapshotTests)
+    {
+    public:
+        TEST_METHOD (ConfiguredValue_MachineHasPrecedenceOverUser)
+        {
+            InMemoryPolicyRegistry registry;
+            registry.SetNumber(POLICIES_SCOPE_MACHINE, POLICY_CONFIGURE_ENABLED_AWAKE, 0);
+            registry.SetNumber(POLICIES_SCOPE_USER, POLICY_CONFIGURE_ENABLED_AWAKE, 1);
+            registry.SetNumber(POLICIES_SCOPE_USER, POLICY_CONFIGURE_ENABLED_PEEK, 1);
+            registry.SetNumber(POLICIES_SCOPE_USER, POLICY_CONFIGURE_ENABLED_FANCYZONES, 7);
+
+            const auto snapshot = Snapshot(registry);
+            Assert::AreEqual<int>(gpo_rule_configured_disabled, snapshot.ConfiguredValue(POLICY_CONFIGURE_ENABLED_AWAKE));
+            Assert::AreEqual<int>(gpo_rule_configured_enabled, snapshot.ConfiguredValue(POLICY_CONFIGURE_ENABLED_PEEK));
+            Assert::AreEqual<int>(gpo_rule_configured_wrong_value, snapshot.ConfiguredValue(POLICY_CONFIGURE_ENABLED_FANCYZONES));
+            Assert::AreEqual<int>(gpo_rule_configured_not_configured, snapshot.ConfiguredValue(POLICY_CONFIGURE_ENABLED_COLOR_PICKER));
+            // Registry value names are case insensitive
+            Assert::AreEqual<int>(gpo_rule_configured_enabled, snapshot.ConfiguredValue(L"configureenabledutilitypeek"));
+        }
+
+        TEST_METHOD (ConfiguredValue_ReportsMissingAndUnavailableKeys)
+        {
+            InMemoryPolicyRegistry registry;
+            Assert::AreEqual<int>(gpo_rule_configured_not_configured, Snapshot(registry).ConfiguredValue(POLICY_CONFIGURE_ENABLED_AWAKE));
+
+            registry.Key(POLICIES_SCOPE_USER, POLICIES_PATH).status = ERROR_ACCESS_DENIED;
+            Assert::AreEqual<int>(gpo_rule_configured_unavailable, Snapshot(registry).ConfiguredValue(POLICY_CONFIGURE_ENABLED_AWAKE));
+
+            // A machine value doesn't need the user key
+            registry.SetNumber(POLICIES_SCOPE_MACHINE, POLICY_CONFIGURE_ENABLED_AWAKE, 1);
+            Assert::AreEqual<int>(gpo_rule_configured_enabled, Snapshot(registry).ConfiguredValue(POLICY_CONFIGURE_ENABLED_AWAKE));
+        }
+
+        TEST_METHOD (ListValue_DoesNotMixMachineAndUserLists)
+        {
+            const auto listPath = POLICIES_PATH + L"\\" + ListName;
+            InMemoryPolicyRegistry registry;
+            registry.SetListString(POLICIES_SCOPE_USER, L"plugin1", L"0");
+            registry.SetListString(POLICIES_SCOPE_USER, L"plugin2", L"1");
+
+            auto snapshot = Snapshot(registry);
+            Assert::IsTrue(snapshot.ListValue(listPath, L"plugin1") == std::optional<std::wstring>{ L"0" });
+            Assert::IsTrue(snapshot.ListValue(listPath, L"PLUGIN2") == std::optional<std::wstring>{ L"1" });
+            Assert::IsFalse(snapshot.ListValue(listPath, L"plugin3").has_value());
+            Assert::IsFalse(snapshot.ListValue(POLICIES_PATH + L"\\OtherList", L"plugin1").has_value());
+
+            // Once the machine has a list, the user list is ignored
+            registry.SetListString(POLICIES_SCOPE_MACHINE, L"plugin2", L"2");
+            snapshot = Snapshot(registry);
+            Assert::IsFalse(snapshot.ListValue(listPath, L"plugin1").has_value());
+            Assert::IsTrue(snapshot.ListValue(listPath, L"plugin2") == std::optional<std::wstring>{ L"2" });
+        }
+
+        TEST_METHOD (Cache_ReadsRegistryOnlyAfterChanges)
+        {
+            auto owned = std::make_unique<InMemoryPolicyRegistry>();
+            auto& registry = *owned;
+            registry.SetNumber(POLICIES_SCOPE_MACHINE, POLICY_CONFIGURE_ENABLED_AWAKE, 1);
+            PolicySnapshotCache cache(std::move(owned), POLICIES_PATH);
+
+            const auto first = cache.current();
+            const int readsPerSnapshot = registry.reads;
+            for (int i = 0; i < 100; ++i)
+            {
+                Assert::IsTrue(cache.current() == first);
+            }
+            Assert::AreEqual(readsPerSnapshot, registry.reads);
+            Assert::AreEqual(1, registry.watches);
+
+            registry.SetNumber(POLICIES_SCOPE_MACHINE, POLICY_CONFIGURE_ENABLED_AWAKE, 0);
+            registry.changed = true;
+            const auto second = cache.current();
+            Assert::IsTrue(second != first);
+            Assert::AreEqual(2 * readsPerSnapshot, registry.reads);
+            Assert::AreEqual(2, registry.watches);
+            Assert::AreEqual<int>(gpo_rule_configured_disabled, second->ConfiguredValue(POLICY_CONFIGURE_ENABLED_AWAKE));
+            // Snapshots held by callers stay unchanged
+            Assert::AreEqual<int>(gpo_rule_configured_enabled, first->ConfiguredValue(POLICY_CONFIGURE_ENABLED_AWAKE));
+        }
+
+        TEST_METHOD (Cache_ReadsEveryTimeWithoutChangeNotifications)
+        {
+            auto owned = std::make_unique<InMemoryPolicyRegistry>();
+            auto& registry = *owned;
+            registry.canWatch = false;
+            PolicySnapshotCache cache(std::move(owned), POLICIES_PATH);
+
+            cache.current();
+            const int readsPerSnapshot = registry.reads;
+            cache.current();
+            cache.current();
+            Assert::AreEqual(3 * readsPerSnapshot, registry.reads);
+        }
+    };
+}
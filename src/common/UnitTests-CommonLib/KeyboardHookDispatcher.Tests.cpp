@@ -0,0 +1,235 @@
+#include "pch.h"
+#include <common/hooks/KeyboardHookDispatcher.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTestsCommonLib
+{
+    namespace
+    {
+        constexpr uint8_t VkA = 'A';
+        constexpr uint8_t VkB = 'B';
+        constexpr uint8_t VkC = 'C';
+
+        KeyboardHookDispatcher::Event KeyDown(const uint8_t vkCode)
+        {
+            return { .vkCode = vkCode, .keyDown = true };
+        }
+
+        KeyboardHookDispatcher::Event KeyUp(const uint8_t vkCode)
+        {
+            return { .vkCode = vkCode, .keyDown = false };
+        }
+
+        uint8_t NoModifiers()
+        {
+            return 0;
+        }
+
+        // Records the order in which the subscribers are called
+        struct CallLog
+        {
+            std::vector<std::wstring> calls;
+
+            KeyboardHookDispatcher::Handler Handler(std::wstring name, const bool swallow = false)
+            {
+                return [this, name = std::move(name), swallow](const KeyboardHookDispatcher::Event&) {
+                    calls.push_back(name);
+                    return swallow;
+                };
+            }
+        };
+    }
+
+    TEST_CLASS (KeyboardHookDispatcherTests)
+    {
+    public:
+        TEST_METHOD (Dispatch_OnlyReachesSubscribersOfTheKey)
+        {
+            KeyboardHookDispatcher dispatcher;
+            CallLog log;
+            dispatcher.Subscribe(L"a", KeyboardHookDispatcher::DefaultPriority, { .keys = { VkA } }, log.Handler(L"a"));
+            dispatcher.Subscribe(L"ab", KeyboardHookDispatcher::DefaultPriority, { .keys = { VkA, VkB, VkA } }, log.Handler(L"ab"));
+            dispatcher.Subscribe(L"all", KeyboardHookDispatcher::DefaultPriority, {}, log.Handler(L"all"));
+
+            Assert::IsFalse(dispatcher.Dispatch(KeyDown(VkA), NoModifiers));
+            Assert::IsTrue(log.calls == std::vector<std::wstring>{ L"a", L"ab", L"all" });
+
+            log.calls.clear();
+            dispatcher.Dispatch(KeyDown(VkB), NoModifiers);
+            Assert::IsTrue(log.calls == std::vector<std::wstring>{ L"ab", L"all" });
+
+            log.calls.clear();
+            dispatcher.Dispatch(KeyDown(VkC), NoModifiers);
+            Assert::IsTrue(log.calls == std::vector<std::wstring>{ L"all" });
+        }
+
+        TEST_METHOD (Dispatch_FollowsPriorityAndStopsWhenSwallowed)
+        {
+            KeyboardHookDispatcher dispatcher;
+            CallLog log;
+            dispatcher.Subscribe(L"low", -10, {}, log.Handler(L"low"));
+            dispatcher.Subscribe(L"first", KeyboardHookDispatcher::DefaultPriority, {}, log.Handler(L"first"));
+            dispatcher.Subscribe(L"observer", KeyboardHookDispatcher::ObserverPriority, {}, log.Handler(L"observer"));
+            dispatcher.Subscribe(L"second", KeyboardHookDispatcher::DefaultPriority, { .keys = { VkA } }, log.Handler(L"second", true));
+
+            Assert::IsTrue(dispatcher.Dispatch(KeyDown(VkA), NoModifiers));
+            Assert::IsTrue(log.calls == std::vector<std::wstring>{ L"observer", L"first", L"second" });
+
+            log.calls.clear();
+            Assert::IsFalse(dispatcher.Dispatch(KeyDown(VkB), NoModifiers));
+            Assert::IsTrue(log.calls == std::vector<std::wstring>{ L"observer", L"first", L"low" });
+        }
+
+        TEST_METHOD (Dispatch_FiltersKeyDownAndKeyUp)
+        {
+            KeyboardHookDispatcher dispatcher;
+            CallLog log;
+            dispatcher.Subscribe(L"down", KeyboardHookDispatcher::DefaultPriority, {}, log.Handler(L"down"));
+            dispatcher.Subscribe(L"up", KeyboardHookDispatcher::DefaultPriority, { .keyDown = false, .keyUp = true }, log.Handler(L"up"));
+            dispatcher.Subscribe(L"both", KeyboardHookDispatcher::DefaultPriority, { .keyDown = true, .keyUp = true }, log.Handler(L"both"));
+
+            dispatcher.Dispatch(KeyDown(VkA), NoModifiers);
+            dispatcher.Dispatch(KeyUp(VkA), NoModifiers);
+            Assert::IsTrue(log.calls == std::vector<std::wstring>{ L"down", L"both", L"up", L"both" });
+        }
+
+        TEST_METHOD (Dispatch_MatchesModifiersAndOnlyReadsThemWhenFiltered)
+        {
+            KeyboardHookDispatcher dispatcher;
+            CallLog log;
+            constexpr uint8_t winShift = KeyboardHookDispatcher::ModifierWin | KeyboardHookDispatcher::ModifierShift;
+            dispatcher.Subscribe(L"win+shift+A", KeyboardHookDispatcher::DefaultPriority, { .keys = { VkA }, .modifiersMask = KeyboardHookDispatcher::AllModifiers, .modifiers = winShift }, log.Handler(L"win+shift+A"));
+            dispatcher.Subscribe(L"ctrl+A", KeyboardHookDispatcher::DefaultPriority, { .keys = { VkA }, .modifiersMask = KeyboardHookDispatcher::AllModifiers, .modifiers = KeyboardHookDispatcher::ModifierCtrl }, log.Handler(L"ctrl+A"));
+            dispatcher.Subscribe(L"A with win", KeyboardHookDispatcher::DefaultPriority, { .keys = { VkA }, .modifiersMask = KeyboardHookDispatcher::ModifierWin, .modifiers = KeyboardHookDispatcher::ModifierWin }, log.Handler(L"A with win"));
+            dispatcher.Subscribe(L"B", KeyboardHookDispatcher::DefaultPriority, { .keys = { VkB } }, log.Handler(L"B"));
+
+            int reads = 0;
+            uint8_t held = winShift;
+            const auto readModifiers = [&] {
+                ++reads;
+                return held;
+            };
+
+            dispatcher.Dispatch(KeyDown(VkA), readModifiers);
+            Assert::AreEqual(1, reads);
+            Assert::IsTrue(log.calls == std::vector<std::wstring>{ L"win+shift+A", L"A with win" });
+
+            log.calls.clear();
+            held = KeyboardHookDispatcher::ModifierCtrl | KeyboardHookDispatcher::ModifierAlt;
+            dispatcher.Dispatch(KeyDown(VkA), readModifiers);
+            Assert::IsTrue(log.calls.empty());
+
+            log.calls.clear();
+            dispatcher.Dispatch(KeyDown(VkB), readModifiers);
+            dispatcher.Dispatch(KeyDown(VkC), readModifiers);
+            Assert::AreEqual(2, reads);
+            Assert::IsTrue(log.calls == std::vector<std::wstring>{ L"B" });
+        }
+
+        TEST_METHOD (Unsubscribe_DuringDispatchTakesEffectOnNextEvent)
+        {
+            KeyboardHookDispatcher dispatcher;
+            CallLog log;
+            const auto first = dispatcher.Subscribe(L"first", KeyboardHookDispatcher::DefaultPriority, { .keys = { VkA } }, log.Handler(L"first"));
+
+            // Unsubscribes itself and the first subscriber while the event is being dispatched
+            KeyboardHookDispatcher::SubscriptionId self{};
+            self = dispatcher.Subscribe(L"once", KeyboardHookDispatcher::DefaultPriority, { .keys = { VkA } }, [&](const auto&) {
+                log.calls.push_back(L"once");
+                dispatcher.Unsubscribe(self);
+                dispatcher.Unsubscribe(first);
+                return false;
+            });
+            dispatcher.Subscribe(L"last", KeyboardHookDispatcher::DefaultPriority, { .keys = { VkA } }, log.Handler(L"last"));
+
+            dispatcher.Dispatch(KeyDown(VkA), NoModifiers);
+            Assert::IsTrue(log.calls == std::vector<std::wstring>{ L"first", L"once", L"last" });
+
+            log.calls.clear();
+            dispatcher.Dispatch(KeyDown(VkA), NoModifiers);
+            Assert::IsTrue(log.calls == std::vector<std::wstring>{ L"last" });
+            Assert::AreEqual<size_t>(1, dispatcher.Statistics().size());
+
+            // Unknown ids are ignored
+            dispatcher.Unsubscribe(first);
+            dispatcher.Unsubscribe({});
+        }
+
+        TEST_METHOD (Statistics_MeasureEachSubscriber)
+        {
+            KeyboardHookDispatcher dispatcher;
+            const auto slow = dispatcher.Subscribe(L"slow", KeyboardHookDispatcher::ObserverPriority, { .keys = { VkA } }, [](const auto&) {
+                std::this_thread::sleep_for(std::chrono::milliseconds{ 2 });
+                return false;
+            });
+            const auto swallowing = dispatcher.Subscribe(L"swallowing", KeyboardHookDispatcher::DefaultPriority, {}, [](const auto& event) {
+                return event.vkCode == VkA;
+            });
+
+            for (int i = 0; i < 3; ++i)
+            {
+                dispatcher.Dispatch(KeyDown(VkA), NoModifiers);
+                dispatcher.Dispatch(KeyDown(VkB), NoModifiers);
+            }
+
+            const auto statistics = dispatcher.Statistics();
+            Assert::AreEqual<size_t>(2, statistics.size());
+
+            Assert::AreEqual(slow, statistics[0].id);
+            Assert::AreEqual(std::wstring{ L"slow" }, statistics[0].name);
+            Assert::AreEqual<uint64_t>(3, statistics[0].calls);
+            Assert::AreEqual<uint64_t>(0, statistics[0].swallowed);
+            Assert::IsTrue(statistics[0].max >= std::chrono::milliseconds{ 2 });
+            Assert::IsTrue(statistics[0].total >= 3 * std::chrono::milliseconds{ 2 });
+            Assert::IsTrue(statistics[0].max <= statistics[0].total);
+
+            Assert::AreEqual(swallowing, statistics[1].id);
+            Assert::AreEqual<uint64_t>(6, statistics[1].calls);
+            Assert::AreEqual<uint64_t>(3, statistics[1].swallowed);
+        }
+
+        // Many subscribers interested in other keys don't slow down the events of a key
+        TEST_METHOD (Dispatch_DoesNotVisitSubscribersOfOtherKeys)
+        {
+            int calls = 0;
+            KeyboardHookDispatcher dispatcher;
+            dispatcher.Subscribe(L"A", KeyboardHookDispatcher::DefaultPriority, { .keys = { VkA } }, [&](const auto&) {
+                ++calls;
+                return false;
+            });
+
+            // Each of them would swallow the event and read the modifiers if it were visited
+            for (uint8_t vkCode = 0x30; vkCode < 0x30 + 64; ++vkCode)
+            {
+                if (vkCode != VkA)
+                {
+                    dispatcher.Subscribe(L"other", KeyboardHookDispatcher::DefaultPriority, { .keys = { vkCode }, .modifiersMask = KeyboardHookDispatcher::AllModifiers }, [](const auto&) {
+                        return true;
+                    });
+                }
+            }
+
+            int modifierReads = 0;
+            for (int i = 0; i < 1000; ++i)
+            {
+                Assert::IsFalse(dispatcher.Dispatch(KeyDown(VkA), [&] {
+                    ++modifierReads;
+                    return NoModifiers();
+                }));
+            }
+
+            Assert::AreEqual(1000, calls);
+            Assert::AreEqual(0, modifierReads);
+            for (const auto& statistics : dispatcher.Statistics())
+            {
+                Assert::AreEqual(statistics.name == L"A" ? uint64_t{ 1000 } : uint64_t{ 0 }, statistics.calls);
+            }
+        }
+    };
+}
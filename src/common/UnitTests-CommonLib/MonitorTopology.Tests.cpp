@@ -0,0 +1,134 @@
+#include "pch.h"
+#include <common/Display/MonitorTopology.h>
+
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTestsCommonLib
+{
+    namespace
+    {
+        MonitorTopology::Monitor MakeMonitor(const LONG left, const LONG top, const LONG right, const LONG bottom, const bool primary = false)
+        {
+            const RECT rect{ left, top, right, bottom };
+            return { .handle = nullptr, .rect = Box{ rect }, .workArea = Box{ rect }, .primary = primary };
+        }
+
+        // Layout with monitors of different sizes, negative coordinates and gaps in the bounding box:
+        //
+        //            [ 1 ]
+        //   [   0   ][   2   ]
+        //                     [3]
+        MonitorTopology MakeTopology()
+        {
+            return MonitorTopology{ { MakeMonitor(-1920, 0, 0, 1080),
+                                      MakeMonitor(0, -600, 800, 0),
+                                      MakeMonitor(0, 0, 2560, 1440, true),
+                                      MakeMonitor(2560, 1000, 3280, 1400) } };
+        }
+
+        // What MonitorFromPoint computes, without the lookup
+        const MonitorTopology::Monitor* ReferenceMonitorFromPoint(const MonitorTopology& topology, const POINT point)
+        {
+            for (const auto& monitor : topology.Monitors())
+            {
+                const RECT& rect = monitor.rect.rect;
+                if (rect.left <= point.x && point.x < rect.right && rect.top <= point.y && point.y < rect.bottom)
+                {
+                    return &monitor;
+                }
+            }
+
+            const MonitorTopology::Monitor* nearest = nullptr;
+            int64_t nearestDistance = INT64_MAX;
+            for (const auto& monitor : topology.Monitors())
+            {
+                const RECT& rect = monitor.rect.rect;
+                const int64_t dx = point.x < rect.left ? rect.left - point.x : (point.x >= rect.right ? point.x - rect.right + 1 : 0);
+                const int64_t dy = point.y < rect.top ? rect.top - point.y : (point.y >= rect.bottom ? point.y - rect.bottom + 1 : 0);
+                if (dx * dx + dy * dy < nearestDistance)
+                {
+                    nearest = &monitor;
+                    nearestDistance = dx * dx + dy * dy;
+                }
+            }
+            return nearest;
+        }
+    }
+
+    TEST_CLASS (MonitorTopologyTests)
+    {
+    public:
+        TEST_METHOD (VirtualScreen_BoundsAllMonitors)
+        {
+            const auto topology = MakeTopology();
+            const auto& virtualScreen = topology.VirtualScreen();
+            Assert::AreEqual(-1920, virtualScreen.left());
+            Assert::AreEqual(-600, virtualScreen.top());
+            Assert::AreEqual(3280, virtualScreen.right());
+            Assert::AreEqual(1440, virtualScreen.bottom());
+        }
+
+        TEST_METHOD (MonitorFromPoint_FindsContainingMonitor)
+        {
+            const auto topology = MakeTopology();
+            const auto& monitors = topology.Monitors();
+
+            Assert::IsTrue(topology.MonitorFromPoint({ -1920, 0 }) == &monitors[0]);
+            Assert::IsTrue(topology.MonitorFromPoint({ -1, 1079 }) == &monitors[0]);
+            Assert::IsTrue(topology.MonitorFromPoint({ 0, -1 }) == &monitors[1]);
+            Assert::IsTrue(topology.MonitorFromPoint({ 0, 0 }) == &monitors[2]);
+            Assert::IsTrue(topology.MonitorFromPoint({ 2559, 1439 }) == &monitors[2]);
+            Assert::IsTrue(topology.MonitorFromPoint({ 2560, 1000 }) == &monitors[3]);
+        }
+
+        TEST_METHOD (MonitorFromPoint_FallsBackToNearestMonitor)
+        {
+            const auto topology = MakeTopology();
+            const auto& monitors = topology.Monitors();
+
+            // In the gaps of the bounding box
+            Assert::IsTrue(topology.MonitorFromPoint({ -5, -100 }) == &monitors[1]);
+            Assert::IsTrue(topology.MonitorFromPoint({ 2000, -10 }) == &monitors[2]);
+            Assert::IsTrue(topology.MonitorFromPoint({ 2700, 950 }) == &monitors[3]);
+            // Outside of it
+            Assert::IsTrue(topology.MonitorFromPoint({ -5000, 500 }) == &monitors[0]);
+            Assert::IsTrue(topology.MonitorFromPoint({ 10000, 1200 }) == &monitors[3]);
+        }
+
+        TEST_METHOD (MonitorFromPoint_MatchesReferenceEverywhere)
+        {
+            const auto topology = MakeTopology();
+            for (LONG y = -700; y < 1500; y += 7)
+            {
+                for (LONG x = -2000; x < 3400; x += 13)
+                {
+                    Assert::IsTrue(topology.MonitorFromPoint({ x, y }) == ReferenceMonitorFromPoint(topology, { x, y }));
+                }
+            }
+        }
+
+        TEST_METHOD (MonitorFromPoint_WithoutMonitors)
+        {
+            const MonitorTopology topology;
+            Assert::IsTrue(topology.MonitorFromPoint({ 0, 0 }) == nullptr);
+            Assert::IsTrue(topology.Monitors().empty());
+        }
+
+        TEST_METHOD (Cache_InvalidatesOnDisplayMessages)
+        {
+            MonitorTopologyCache cache;
+            Assert::IsTrue(cache.HandleMessage(WM_DISPLAYCHANGE, 0));
+            Assert::IsTrue(cache.HandleMessage(WM_DPICHANGED, 0));
+            Assert::IsTrue(cache.HandleMessage(WM_SETTINGCHANGE, SPI_SETWORKAREA));
+            Assert::IsFalse(cache.HandleMessage(WM_SETTINGCHANGE, SPI_SETDESKWALLPAPER));
+            Assert::IsFalse(cache.HandleMessage(WM_MOUSEMOVE, 0));
+
+            const auto first = cache.Current();
+            Assert::IsTrue(cache.Current() == first);
+            cache.HandleMessage(WM_DISPLAYCHANGE, 0);
+            Assert::IsTrue(cache.Current() != first);
+        }
+    };
+}
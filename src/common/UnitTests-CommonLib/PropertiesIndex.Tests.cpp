@@ -0,0 +1,319 @@
+#include "pch.h"
+#include <common/SettingsAPI/properties_index.h>
+#include <common/SettingsAPI/settings_objects.h>
+
+#include <chrono>
+#include <format>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace PowerToysSettings;
+
+namespace UnitTestsCommonLib
+{
+    namespace
+    {
+        using Type = PropertiesIndex::Type;
+
+        const std::wstring SettingsJson = L"{\"name\":\"Module Name\",\"properties\" : {\"bool_toggle_true\":{\"value\":true},\"bool_toggle_false\":{\"value\":false},\"color_picker\" : {\"value\":\"#ff8d12\"},\"int_spinner\" : {\"value\":10},\"string_text\" : {\"value\":\"a quick fox\"}},\"version\" : \"1.0\" }";
+
+        PropertiesIndex Parse(const std::wstring& json)
+        {
+            auto index = PropertiesIndex::parse(json);
+            Assert::IsTrue(index.has_value());
+            return std::move(*index);
+        }
+
+        std::wstring PropertyName(size_t i)
+        {
+            return std::format(L"property_{}", i);
+        }
+
+        // Settings the way the modules write them, with count properties cycling through the editor types
+        std::wstring SyntheticSettings(size_t count)
+        {
+            std::wstring json = L"{\"name\":\"Synthetic\",\"version\":\"1.0\",\"properties\":{";
+            for (size_t i = 0; i < count; ++i)
+            {
+                json += std::format(L"{}\"{}\":{{\"display_name\":\"Property {}\",\"order\":{},", i ? L"," : L"", PropertyName(i), i, i);
+                switch (i % 4)
+                {
+                case 0:
+                    json += std::format(L"\"editor_type\":\"bool_toggle\",\"value\":{}}}", i % 8 == 0 ? L"true" : L"false");
+                    break;
+                case 1:
+                    json += std::format(L"\"editor_type\":\"int_spinner\",\"min\":0,\"max\":100000,\"value\":{}}}", i);
+                    break;
+                case 2:
+                    json += std::format(L"\"editor_type\":\"color_picker\",\"value\":\"#{:06x}\"}}", i % 16);
+                    break;
+                default:
+                    json += L"\"editor_type\":\"hotkey\",\"value\":{\"win\":true,\"ctrl\":false,\"alt\":false,\"shift\":true,\"code\":84,\"key\":\"T\"}}";
+                    break;
+                }
+            }
+            return json + L"}}";
+        }
+    }
+
+    TEST_CLASS (PropertiesIndexTests)
+    {
+    public:
+        TEST_METHOD (Parse_ReadsTypedValues)
+        {
+            const auto index = Parse(SettingsJson);
+            Assert::AreEqual(size_t{ 5 }, index.size());
+            Assert::IsTrue(index.get_bool(L"bool_toggle_true").value());
+            Assert::IsFalse(index.get_bool(L"bool_toggle_false").value());
+            Assert::AreEqual(10.0, index.get_number(L"int_spinner").value());
+            Assert::IsTrue(index.get_string(L"color_picker") == L"#ff8d12");
+            Assert::IsTrue(index.get_string(L"string_text") == L"a quick fox");
+        }
+
+        TEST_METHOD (Parse_MissingAndMistypedPropertiesHaveNoValue)
+        {
+            const auto index = Parse(SettingsJson);
+            Assert::IsFalse(index.get_bool(L"int_spinner").has_value());
+            Assert::IsFalse(index.get_number(L"string_text").has_value());
+            Assert::IsFalse(index.get_string(L"bool_toggle_true").has_value());
+            Assert::IsFalse(index.get_type(L"missing").has_value());
+            Assert::IsFalse(index.get_type(L"name").has_value());
+            Assert::IsFalse(index.get_type(L"").has_value());
+            Assert::IsFalse(index.get_type(L"int_spinne").has_value());
+        }
+
+        TEST_METHOD (Parse_KeepsOnlyPropertiesWithValues)
+        {
+            const auto index = Parse(LR"({"properties":{
+                "number":1, "no_value":{"display_name":"x"}, "null":{"value":null},
+                "object":{"value":{"value":true,"nested":[1,{"a":[]}]}}, "array":{"value":[true,"x"]},
+                "after_value":{"value":"kept","display_name":"skipped","options":[{"key":"a","text":"b"}]}}})");
+            Assert::AreEqual(size_t{ 4 }, index.size());
+            Assert::IsFalse(index.get_type(L"number").has_value());
+            Assert::IsFalse(index.get_type(L"no_value").has_value());
+            Assert::IsTrue(index.get_type(L"null") == Type::Null);
+            Assert::IsTrue(index.get_type(L"object") == Type::Object);
+            Assert::IsTrue(index.get_type(L"array") == Type::Array);
+            Assert::IsTrue(index.get_string(L"after_value") == L"kept");
+        }
+
+        TEST_METHOD (Parse_DecodesStrings)
+        {
+            const auto index = Parse(LR"({"properties":{"caf\u00e9 \"quoted\"":{"value":"tab\tnew\nline \\ \/ \ud83d\ude00 \u00C9"}}})");
+            Assert::IsTrue(index.get_string(L"caf\u00e9 \"quoted\"") == L"tab\tnew\nline \\ / \xD83D\xDE00 \u00C9");
+        }
+
+        TEST_METHOD (Parse_ReadsNumbers)
+        {
+            const auto index = Parse(LR"({"properties":{"a":{"value":-0},"b":{"value":12.5e1},"c":{"value":-3.75},"d":{"value":1E-2},"e":{"value":2147483647}}})");
+            Assert::AreEqual(0.0, index.get_number(L"a").value());
+            Assert::AreEqual(125.0, index.get_number(L"b").value());
+            Assert::AreEqual(-3.75, index.get_number(L"c").value());
+            Assert::AreEqual(0.01, index.get_number(L"d").value());
+            Assert::AreEqual(2147483647.0, index.get_number(L"e").value());
+        }
+
+        TEST_METHOD (Parse_LastDuplicateWins)
+        {
+            const auto index = Parse(LR"({"properties":{"a":{"value":1},"b":{"value":true},"a":{"value":"two","value":"three"}},
+                                          "properties":{"b":{"value":false},"c":{"value":3}}})");
+            Assert::AreEqual(size_t{ 2 }, index.size());
+            Assert::IsFalse(index.get_type(L"a").has_value());
+            Assert::IsFalse(index.get_bool(L"b").value());
+            Assert::AreEqual(3.0, index.get_number(L"c").value());
+
+            const auto properties = Parse(LR"({"properties":{"a":{"value":1},"a":{"value":"two","value":"three"}}})");
+            Assert::IsTrue(properties.get_string(L"a") == L"three");
+        }
+
+        TEST_METHOD (Parse_RejectsMalformedJson)
+        {
+            const std::wstring malformed[] = {
+                L"",
+                L"[]",
+                L"\"properties\"",
+                L"{\"properties\":{}",
+                L"{\"properties\":{}} {}",
+                L"{\"properties\":{\"a\":{\"value\":tru}}}",
+                L"{\"properties\":{\"a\":{\"value\":01}}}",
+                L"{\"properties\":{\"a\":{\"value\":1.}}}",
+                L"{\"properties\":{\"a\":{\"value\":+1}}}",
+                L"{\"properties\":{\"a\":{\"value\":1e}}}",
+                L"{\"properties\":{\"a\":{\"value\":1e999}}}",
+                L"{\"properties\":{\"a\":{\"value\":\"\\x\"}}}",
+                L"{\"properties\":{\"a\":{\"value\":\"\\u12g4\"}}}",
+                L"{\"properties\":{\"a\":{\"value\":\"line\nbreak\"}}}",
+                L"{\"properties\":{\"a\":{\"value\":[1,]}}}",
+                L"{\"properties\":{\"a\":{\"value\":1,}}}",
+                L"{\"properties\":{\"a\" {\"value\":1}}}",
+                L"{\"other\":[1 2],\"properties\":{}}",
+                L"{'properties':{}}",
+                L"{\"nested\":" + std::wstring(1000, L'[') + std::wstring(1000, L']') + L"}",
+            };
+            for (const auto& json : malformed)
+            {
+                Assert::IsFalse(PropertiesIndex::parse(json).has_value(), json.c_str());
+            }
+
+            Assert::AreEqual(size_t{ 0 }, Parse(L" {} ").size());
+            Assert::AreEqual(size_t{ 0 }, Parse(L"{\"properties\":[]}").size());
+            Assert::AreEqual(size_t{ 0 }, Parse(L"{\"nested\":" + std::wstring(100, L'[') + std::wstring(100, L']') + L"}").size());
+        }
+
+        TEST_METHOD (Parse_FindsEveryName)
+        {
+            for (const size_t count : { 1, 2, 7, 100, 20000 })
+            {
+                const auto index = Parse(SyntheticSettings(count));
+                Assert::AreEqual(count, index.size());
+                for (size_t i = 0; i < count; ++i)
+                {
+                    const auto name = PropertyName(i);
+                    switch (i % 4)
+                    {
+                    case 0:
+                        Assert::AreEqual(i % 8 == 0, index.get_bool(name).value());
+                        break;
+                    case 1:
+                        Assert::AreEqual(static_cast<double>(i), index.get_number(name).value());
+                        break;
+                    case 2:
+                        Assert::IsTrue(index.get_string(name) == std::format(L"#{:06x}", i % 16));
+                        break;
+                    default:
+                        Assert::IsTrue(index.get_type(name) == Type::Object);
+                        break;
+                    }
+                    Assert::IsFalse(index.get_type(PropertyName(i + count)).has_value());
+                }
+            }
+        }
+
+        TEST_METHOD (Parse_InternsStrings)
+        {
+            // 16 colors and 10000 names, some also used as values
+            std::wstring json = LR"({"properties":{)";
+            for (size_t i = 0; i < 10000; ++i)
+            {
+                json += std::format(LR"({}"{}":{{"value":"{}"}})", i ? L"," : L"", PropertyName(i), i % 2 ? PropertyName(i % 10) : std::format(L"#{:06x}", i % 16));
+            }
+            const auto index = Parse(json + L"}}");
+
+            size_t expected = 8 * 7;
+            for (size_t i = 0; i < 10000; ++i)
+            {
+                expected += PropertyName(i).size();
+            }
+            Assert::AreEqual(expected, index.interned_length());
+            Assert::IsTrue(index.get_string(PropertyName(9999)) == PropertyName(9));
+            Assert::IsTrue(index.get_string(PropertyName(9998)) == L"#00000e");
+        }
+
+        TEST_METHOD (PowerToyValues_GettersFollowChanges)
+        {
+            auto values = PowerToyValues::from_json_string(SettingsJson, L"Module Key");
+            Assert::AreEqual(10, values.get_int_value(L"int_spinner").value());
+            Assert::IsFalse(values.get_int_value(L"missing").has_value());
+
+            const auto copy = values;
+            values.add_property(L"int_spinner", 42);
+            values.add_property(L"added", std::wstring{ L"text" });
+            Assert::AreEqual(42, values.get_int_value(L"int_spinner").value());
+            Assert::AreEqual(42, copy.get_int_value(L"int_spinner").value());
+            Assert::AreEqual(std::wstring{ L"text" }, values.get_string_value(L"added").value());
+
+            // The raw json is live, including changes made after the getters ran again
+            auto raw = values.get_raw_json();
+            raw.GetNamedObject(L"properties").Remove(L"added");
+            Assert::IsFalse(values.get_string_value(L"added").has_value());
+            Assert::IsTrue(values.get_bool_value(L"bool_toggle_true").value());
+            raw.GetNamedObject(L"properties").GetNamedObject(L"bool_toggle_true").SetNamedValue(L"value", json::value(false));
+            Assert::IsFalse(values.get_bool_value(L"bool_toggle_true").value());
+            Assert::IsFalse(copy.get_bool_value(L"bool_toggle_true").value());
+        }
+
+        // Every property of 2000 read twice through the json objects, as the getters did, and through the index,
+        // building it included
+        BEGIN_TEST_METHOD_ATTRIBUTE(Benchmark_Lookups2000Properties)
+            TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD (Benchmark_Lookups2000Properties)
+        {
+            using clock = std::chrono::steady_clock;
+            constexpr size_t count = 2000;
+            const auto json = SyntheticSettings(count);
+            std::vector<std::wstring> names;
+            for (size_t i = 0; i < count; ++i)
+            {
+                names.push_back(PropertyName(i));
+            }
+
+            size_t found = 0;
+            auto start = clock::now();
+            const auto object = json::JsonValue::Parse(json).GetObjectW();
+            const auto parsed = clock::now() - start;
+            start = clock::now();
+            for (int pass = 0; pass < 2; ++pass)
+            {
+                for (const auto& name : names)
+                {
+                    const auto properties = object.GetNamedObject(L"properties", json::JsonObject{});
+                    if (json::has(properties, name) && json::has(properties.GetNamedObject(name), L"value", json::JsonValueType::Number))
+                    {
+                        found += static_cast<int>(properties.GetNamedObject(name).GetNamedNumber(L"value")) >= 0;
+                    }
+                }
+            }
+            const auto dom = clock::now() - start;
+
+            start = clock::now();
+            const auto index = PropertiesIndex::parse(object.Stringify());
+            const auto indexed = clock::now() - start;
+            start = clock::now();
+            for (int pass = 0; pass < 2; ++pass)
+            {
+                for (const auto& name : names)
+                {
+                    const auto number = index->get_number(name);
+                    found -= number && static_cast<int>(*number) >= 0;
+                }
+            }
+            const auto lookups = clock::now() - start;
+
+            using ms = std::chrono::duration<double, std::milli>;
+            Logger::WriteMessage(std::format(L"Json objects: {:.2f} ms parsing, {:.2f} ms for {} lookups\n", ms(parsed).count(), ms(dom).count(), 2 * count).c_str());
+            Logger::WriteMessage(std::format(L"Index: {:.2f} ms stringifying and indexing, {:.2f} ms for {} lookups\n", ms(indexed).count(), ms(lookups).count(), 2 * count).c_str());
+            Assert::AreEqual(size_t{ 0 }, found);
+        }
+
+        // Flattening a large settings file, with no WinRT involved
+        BEGIN_TEST_METHOD_ATTRIBUTE(Benchmark_Index100kProperties)
+            TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD (Benchmark_Index100kProperties)
+        {
+            using clock = std::chrono::steady_clock;
+            constexpr size_t count = 100000;
+            const auto json = SyntheticSettings(count);
+
+            auto start = clock::now();
+            const auto index = PropertiesIndex::parse(json);
+            const auto parsed = clock::now() - start;
+
+            start = clock::now();
+            size_t found = 0;
+            for (size_t i = 0; i < count; ++i)
+            {
+                found += index->get_type(PropertyName(i)).has_value();
+            }
+            const auto lookups = clock::now() - start;
+
+            using ms = std::chrono::duration<double, std::milli>;
+            Logger::WriteMessage(std::format(L"{:.1f} MB indexed in {:.1f} ms, {} lookups in {:.1f} ms\n", json.size() * sizeof(wchar_t) / (1024.0 * 1024.0), ms(parsed).count(), count, ms(lookups).count()).c_str());
+            Assert::AreEqual(count, found);
+        }
+    };
+}
@@ -0,0 +1,163 @@
+#include "pch.h"
+#include <common/utils/seqlock.h>
+
+#include <array>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTestsCommonLib
+{
+    namespace
+    {
+        // Every field is derived from the first one, so a torn read is detectable
+        struct Payload
+        {
+            uint64_t counter = 0;
+            std::array<uint64_t, 5> derived = {};
+            uint8_t tail = 0;
+
+            static Payload Make(const uint64_t counter)
+            {
+                Payload payload;
+                payload.counter = counter;
+                for (size_t i = 0; i < payload.derived.size(); ++i)
+                {
+                    payload.derived[i] = counter * (i + 2);
+                }
+                payload.tail = static_cast<uint8_t>(counter);
+                return payload;
+            }
+
+            bool IsConsistent() const
+            {
+                for (size_t i = 0; i < derived.size(); ++i)
+                {
+                    if (derived[i] != counter * (i + 2))
+                    {
+                        return false;
+                    }
+                }
+                return tail == static_cast<uint8_t>(counter);
+            }
+        };
+    }
+
+    TEST_CLASS (SeqLockUnitTests)
+    {
+    public:
+        TEST_METHOD (DefaultValue)
+        {
+            SeqLock<Payload> lock;
+            uint64_t version = 1;
+            const auto value = lock.Read(&version);
+            Assert::AreEqual<uint64_t>(0, value.counter);
+            Assert::AreEqual<uint64_t>(0, version);
+        }
+
+        TEST_METHOD (WriteAdvancesVersion)
+        {
+            SeqLock<Payload> lock{ Payload::Make(7) };
+            Assert::AreEqual<uint64_t>(7, lock.Read().counter);
+
+            Assert::AreEqual<uint64_t>(1, lock.Write(Payload::Make(8)));
+            Assert::AreEqual<uint64_t>(2, lock.Write(Payload::Make(9)));
+
+            uint64_t version = 0;
+            const auto value = lock.Read(&version);
+            Assert::AreEqual<uint64_t>(9, value.counter);
+            Assert::AreEqual<uint64_t>(2, version);
+            Assert::AreEqual<uint64_t>(2, lock.Version());
+        }
+
+        TEST_METHOD (ModifyKeepsOtherFields)
+        {
+            SeqLock<Payload> lock{ Payload::Make(3) };
+            const auto version = lock.Modify([](Payload& payload) { payload.tail = 42; });
+
+            const auto value = lock.Read();
+            Assert::AreEqual<uint64_t>(1, version);
+            Assert::AreEqual<uint64_t>(3, value.counter);
+            Assert::AreEqual<uint64_t>(6, value.derived[0]);
+            Assert::AreEqual<int>(42, value.tail);
+        }
+
+        TEST_METHOD (ConcurrentReadersNeverSeeTornValues)
+        {
+            constexpr uint64_t writes = 200000;
+            constexpr size_t readers = 4;
+
+            SeqLock<Payload> lock;
+            std::atomic_bool done = false;
+            std::atomic_size_t tornReads = 0;
+            std::atomic_size_t backwardReads = 0;
+
+            std::vector<std::thread> threads;
+            for (size_t i = 0; i < readers; ++i)
+            {
+                threads.emplace_back([&] {
+                    uint64_t lastCounter = 0;
+                    while (!done)
+                    {
+                        const auto value = lock.Read();
+                        if (!value.IsConsistent())
+                        {
+                            ++tornReads;
+                        }
+                        if (value.counter < lastCounter)
+                        {
+                            ++backwardReads;
+                        }
+                        lastCounter = value.counter;
+                    }
+                });
+            }
+
+            for (uint64_t i = 1; i <= writes; ++i)
+            {
+                lock.Write(Payload::Make(i));
+            }
+            done = true;
+
+            for (auto& thread : threads)
+            {
+                thread.join();
+            }
+
+            Assert::AreEqual<size_t>(0, tornReads);
+            Assert::AreEqual<size_t>(0, backwardReads);
+            Assert::AreEqual(writes, lock.Read().counter);
+            Assert::AreEqual(writes, lock.Version());
+        }
+
+        TEST_METHOD (ConcurrentWritersAreSerialized)
+        {
+            constexpr uint64_t incrementsPerWriter = 50000;
+            constexpr size_t writers = 4;
+
+            SeqLock<Payload> lock;
+            std::vector<std::thread> threads;
+            for (size_t i = 0; i < writers; ++i)
+            {
+                threads.emplace_back([&] {
+                    for (uint64_t j = 0; j < incrementsPerWriter; ++j)
+                    {
+                        lock.Modify([](Payload& payload) { payload = Payload::Make(payload.counter + 1); });
+                    }
+                });
+            }
+
+            for (auto& thread : threads)
+            {
+                thread.join();
+            }
+
+            const auto value = lock.Read();
+            Assert::IsTrue(value.IsConsistent());
+            Assert::AreEqual(incrementsPerWriter * writers, value.counter);
+            Assert::AreEqual(incrementsPerWriter * writers, lock.Version());
+        }
+    };
+}
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <common/updating/chunkedDownload.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+// Helpers shared by the tests of the updater and the thumbnail cache
+namespace UnitTestsCommonLib
+{
+    // A server in the process, serving ranges of a file in pieces and failing on request
+    class FakeServer : public updating::range_transport
+    {
+    public:
+        explicit FakeServer(std::vector<uint8_t> bytes) :
+            content{ std::move(bytes) }
+        {
+        }
+
+        bool content_length(std::optional<uint64_t>& length) override
+        {
+            ++length_requests;
+            if (unreachable)
+            {
+                return false;
+            }
+            length = sized ? std::optional<uint64_t>{ content.size() } : std::nullopt;
+            return true;
+        }
+
+        bool fetch(uint64_t offset, uint64_t length, const std::function<bool(const uint8_t* data, size_t size)>& sink) override
+        {
+            const size_t request = requests++;
+            if (unreachable || !ranges || offset + length > content.size())
+            {
+                return false;
+            }
+            // The connection drops half way through the first request of every drop_every-th range, whichever
+            // thread asks for it
+            bool drop = false;
+            {
+                std::scoped_lock lock{ mutex };
+                drop = drop_every && fetched.insert(offset).second && fetched.size() % drop_every == 0;
+                if (failing_offsets.contains(offset))
+                {
+                    return false;
+                }
+            }
+
+            const uint64_t end = drop ? offset + length / 2 : offset + length;
+            std::vector<uint8_t> piece;
+            for (uint64_t position = offset; position < end; position += piece.size())
+            {
+                piece.assign(content.begin() + position, content.begin() + (std::min)(end, position + piece_size));
+                if (request == corrupt_request)
+                {
+                    piece[0] ^= 0x5A;
+                }
+                served += piece.size();
+                if (!sink(piece.data(), piece.size()))
+                {
+                    return false;
+                }
+            }
+            return !drop;
+        }
+
+        bool serves_ranges() override
+        {
+            return ranges;
+        }
+
+        bool download(const std::filesystem::path& path) override
+        {
+            ++downloads;
+            if (unreachable || dropping_downloads)
+            {
+                return false;
+            }
+            std::ofstream file{ path, std::ios::binary | std::ios::trunc };
+            file.write(reinterpret_cast<const char*>(content.data()), static_cast<std::streamsize>(content.size()));
+            served += content.size();
+            return static_cast<bool>(file.flush());
+        }
+
+        std::vector<uint8_t> content;
+        size_t piece_size = 16 * 1024;
+        size_t drop_every = 0;
+        size_t corrupt_request = SIZE_MAX;
+        std::atomic<bool> unreachable = false;
+        // Fails the requests for the whole file only
+        std::atomic<bool> dropping_downloads = false;
+        // Whether the size of the file is given, and ranges of it served
+        std::atomic<bool> sized = true;
+        std::atomic<bool> ranges = true;
+
+        std::mutex mutex;
+        // Offsets of the ranges always failing
+        std::set<uint64_t> failing_offsets;
+        // Offsets of the ranges asked for
+        std::set<uint64_t> fetched;
+        std::atomic<size_t> requests = 0;
+        std::atomic<size_t> length_requests = 0;
+        // Requests for the whole file
+        std::atomic<size_t> downloads = 0;
+        std::atomic<uint64_t> served = 0;
+    };
+
+    // A connection to a FakeServer, for code that takes ownership of its transport
+    class FakeConnection : public updating::range_transport
+    {
+    public:
+        explicit FakeConnection(FakeServer& server) :
+            _server{ server }
+        {
+        }
+
+        bool content_length(std::optional<uint64_t>& length) override
+        {
+            return _server.content_length(length);
+        }
+
+        bool fetch(uint64_t offset, uint64_t length, const std::function<bool(const uint8_t* data, size_t size)>& sink) override
+        {
+            return _server.fetch(offset, length, sink);
+        }
+
+        bool serves_ranges() override
+        {
+            return _server.serves_ranges();
+        }
+
+        bool download(const std::filesystem::path& path) override
+        {
+            return _server.download(path);
+        }
+
+    private:
+        FakeServer& _server;
+    };
+
+    // Directory created empty for a test and removed along with it
+    struct TemporaryDirectory
+    {
+        TemporaryDirectory() :
+            path{ std::filesystem::temp_directory_path() / (L"PowerToys.UnitTests-CommonLib." + std::to_wstring(GetCurrentProcessId()) + L"." + std::to_wstring(++count)) }
+        {
+            std::filesystem::remove_all(path);
+            std::filesystem::create_directories(path);
+        }
+
+        ~TemporaryDirectory()
+        {
+            std::error_code error;
+            std::filesystem::remove_all(path, error);
+        }
+
+        TemporaryDirectory(const TemporaryDirectory&) = delete;
+        TemporaryDirectory& operator=(const TemporaryDirectory&) = delete;
+
+        std::filesystem::path path;
+
+    private:
+        static inline std::atomic<unsigned> count = 0;
+    };
+
+    inline std::vector<uint8_t> RandomBytes(size_t size, uint32_t seed)
+    {
+        std::mt19937 rng{ seed };
+        std::vector<uint8_t> bytes(size);
+        for (auto& byte : bytes)
+        {
+            byte = static_cast<uint8_t>(rng());
+        }
+        return bytes;
+    }
+
+    inline std::vector<uint8_t> ReadFile(const std::filesystem::path& path)
+    {
+        std::ifstream file{ path, std::ios::binary };
+        return { std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+    }
+}
@@ -0,0 +1,301 @@
+#include "pch.h"
+#include <common/Themes/theme_broadcaster.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <format>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTestsCommonLib
+{
+    namespace
+    {
+        // A registry in memory. Notifications raised while nobody waits are kept, like a signaled event.
+        class FakeThemeSource : public ThemeSource
+        {
+        public:
+            explicit FakeThemeSource(std::atomic<int>& readCount) :
+                reads{ readCount }
+            {
+            }
+
+            ThemeSnapshot Read() override
+            {
+                ++reads;
+                std::scoped_lock lock{ mutex };
+                return values;
+            }
+
+            ThemeSourceWait Wait(std::chrono::milliseconds timeout) override
+            {
+                std::unique_lock lock{ mutex };
+                auto signaled = [this] { return pending || cancelled; };
+                if (timeout == Infinite)
+                {
+                    changed.wait(lock, signaled);
+                }
+                else if (!changed.wait_for(lock, timeout, signaled))
+                {
+                    return ThemeSourceWait::Timeout;
+                }
+                if (cancelled)
+                {
+                    return ThemeSourceWait::Cancelled;
+                }
+                pending = false;
+                return ThemeSourceWait::Changed;
+            }
+
+            void Cancel() override
+            {
+                {
+                    std::scoped_lock lock{ mutex };
+                    cancelled = true;
+                }
+                changed.notify_all();
+            }
+
+            // Changes the values and notifies, like a registry write
+            template<typename Fn>
+            void Write(Fn&& fn)
+            {
+                {
+                    std::scoped_lock lock{ mutex };
+                    fn(values);
+                    pending = true;
+                }
+                changed.notify_all();
+            }
+
+        private:
+            std::atomic<int>& reads;
+            std::mutex mutex;
+            std::condition_variable changed;
+            ThemeSnapshot values;
+            bool pending = false;
+            bool cancelled = false;
+        };
+
+        struct TestBroadcaster
+        {
+            explicit TestBroadcaster(std::chrono::milliseconds debounce)
+            {
+                auto fake = std::make_unique<FakeThemeSource>(reads);
+                source = fake.get();
+                broadcaster = std::make_unique<ThemeBroadcaster>(std::move(fake), debounce);
+            }
+
+            std::atomic<int> reads = 0;
+            FakeThemeSource* source = nullptr;
+            std::unique_ptr<ThemeBroadcaster> broadcaster;
+        };
+
+        template<typename Fn>
+        bool WaitUntil(Fn&& condition, std::chrono::milliseconds timeout = std::chrono::seconds{ 5 })
+        {
+            const auto deadline = std::chrono::steady_clock::now() + timeout;
+            while (!condition())
+            {
+                if (std::chrono::steady_clock::now() > deadline)
+                {
+                    return false;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+            }
+            return true;
+        }
+    }
+
+    TEST_CLASS (ThemeBroadcasterTests)
+    {
+    public:
+        TEST_METHOD (Current_IsReadBeforeConstructorReturns)
+        {
+            TestBroadcaster test{ std::chrono::milliseconds{ 10 } };
+
+            uint64_t version = 0;
+            const auto snapshot = test.broadcaster->Current(&version);
+            Assert::IsTrue(snapshot == ThemeSnapshot{});
+            Assert::AreEqual(uint64_t{ 1 }, version);
+            Assert::AreEqual(1, test.reads.load());
+        }
+
+        TEST_METHOD (Storm_IsReadOnceAndPublishedOnce)
+        {
+            std::atomic<int> calls = 0;
+            ThemeSnapshot received;
+            std::mutex receivedMutex;
+            TestBroadcaster test{ std::chrono::milliseconds{ 100 } };
+            test.broadcaster->Subscribe([&](const ThemeSnapshot& snapshot) {
+                std::scoped_lock lock{ receivedMutex };
+                received = snapshot;
+                ++calls;
+            });
+
+            // Switching to dark mode writes many values in a row
+            for (uint32_t i = 1; i <= 1000; ++i)
+            {
+                test.source->Write([i](ThemeSnapshot& values) {
+                    values.appTheme = AppTheme::Dark;
+                    values.accentColor = i;
+                });
+            }
+
+            Assert::IsTrue(WaitUntil([&] { return calls > 0; }));
+            std::this_thread::sleep_for(std::chrono::milliseconds{ 300 });
+            Assert::AreEqual(1, calls.load());
+            Assert::AreEqual(2, test.reads.load());
+
+            uint64_t version = 0;
+            const auto current = test.broadcaster->Current(&version);
+            Assert::AreEqual(uint64_t{ 2 }, version);
+            Assert::IsTrue(current.appTheme == AppTheme::Dark);
+            Assert::AreEqual(1000u, current.accentColor);
+            std::scoped_lock lock{ receivedMutex };
+            Assert::IsTrue(received == current);
+        }
+
+        TEST_METHOD (EndlessStorm_StillPublishes)
+        {
+            const std::chrono::milliseconds debounce{ 10 };
+            std::atomic<int> calls = 0;
+            TestBroadcaster test{ debounce };
+            test.broadcaster->Subscribe([&](const ThemeSnapshot&) { ++calls; });
+
+            // A notification every 2 ms never lets the debounce interval pass
+            const auto end = std::chrono::steady_clock::now() + debounce * ThemeBroadcaster::MaxDebounceFactor * 10;
+            for (uint32_t i = 1; std::chrono::steady_clock::now() < end; ++i)
+            {
+                test.source->Write([i](ThemeSnapshot& values) { values.accentColor = i; });
+                std::this_thread::sleep_for(std::chrono::milliseconds{ 2 });
+            }
+
+            Assert::IsTrue(calls >= 2, std::format(L"{} publications", calls.load()).c_str());
+            Assert::IsTrue(test.reads < 20, std::format(L"{} reads", test.reads.load()).c_str());
+        }
+
+        TEST_METHOD (UnchangedValues_AreNotPublished)
+        {
+            std::atomic<int> calls = 0;
+            TestBroadcaster test{ std::chrono::milliseconds{ 5 } };
+            test.broadcaster->Subscribe([&](const ThemeSnapshot&) { ++calls; });
+
+            test.source->Write([](ThemeSnapshot&) {});
+            Assert::IsTrue(WaitUntil([&] { return test.reads == 2; }));
+            std::this_thread::sleep_for(std::chrono::milliseconds{ 50 });
+
+            Assert::AreEqual(0, calls.load());
+            uint64_t version = 0;
+            test.broadcaster->Current(&version);
+            Assert::AreEqual(uint64_t{ 1 }, version);
+        }
+
+        TEST_METHOD (EachChange_IsPublished)
+        {
+            std::vector<ThemeSnapshot> received;
+            std::mutex receivedMutex;
+            TestBroadcaster test{ std::chrono::milliseconds{ 5 } };
+            test.broadcaster->Subscribe([&](const ThemeSnapshot& snapshot) {
+                std::scoped_lock lock{ receivedMutex };
+                received.push_back(snapshot);
+            });
+
+            auto changes = [&] {
+                std::scoped_lock lock{ receivedMutex };
+                return received.size();
+            };
+            test.source->Write([](ThemeSnapshot& values) { values.highContrast = true; });
+            Assert::IsTrue(WaitUntil([&] { return changes() == 1; }));
+            test.source->Write([](ThemeSnapshot& values) { values.systemTheme = AppTheme::Dark; });
+            Assert::IsTrue(WaitUntil([&] { return changes() == 2; }));
+
+            std::scoped_lock lock{ receivedMutex };
+            Assert::IsTrue(received[0].highContrast);
+            Assert::IsTrue(received[0].systemTheme == AppTheme::Light);
+            Assert::IsTrue(received[1].highContrast);
+            Assert::IsTrue(received[1].systemTheme == AppTheme::Dark);
+        }
+
+        TEST_METHOD (Unsubscribe_StopsCallbacks)
+        {
+            std::atomic<int> kept = 0;
+            std::atomic<int> removed = 0;
+            TestBroadcaster test{ std::chrono::milliseconds{ 5 } };
+            test.broadcaster->Subscribe([&](const ThemeSnapshot&) { ++kept; });
+            const auto id = test.broadcaster->Subscribe([&](const ThemeSnapshot&) { ++removed; });
+
+            test.source->Write([](ThemeSnapshot& values) { values.accentColor = 1; });
+            Assert::IsTrue(WaitUntil([&] { return kept == 1 && removed == 1; }));
+
+            test.broadcaster->Unsubscribe(id);
+            test.source->Write([](ThemeSnapshot& values) { values.accentColor = 2; });
+            Assert::IsTrue(WaitUntil([&] { return kept == 2; }));
+            Assert::AreEqual(1, removed.load());
+        }
+
+        TEST_METHOD (Unsubscribe_FromCallback)
+        {
+            std::atomic<int> calls = 0;
+            std::atomic<ThemeBroadcaster::SubscriptionId> id = 0;
+            TestBroadcaster test{ std::chrono::milliseconds{ 5 } };
+            id = test.broadcaster->Subscribe([&](const ThemeSnapshot&) {
+                ++calls;
+                test.broadcaster->Unsubscribe(id);
+            });
+
+            test.source->Write([](ThemeSnapshot& values) { values.accentColor = 1; });
+            Assert::IsTrue(WaitUntil([&] { return calls == 1; }));
+            test.source->Write([](ThemeSnapshot& values) { values.accentColor = 2; });
+            Assert::IsTrue(WaitUntil([&] { return test.broadcaster->Current().accentColor == 2; }));
+            Assert::AreEqual(1, calls.load());
+        }
+
+        TEST_METHOD (Readers_NeverSeeTornSnapshots)
+        {
+            TestBroadcaster test{ std::chrono::milliseconds{ 1 } };
+            std::atomic<bool> stop = false;
+            std::atomic<int> torn = 0;
+            std::vector<std::thread> readers;
+            for (int i = 0; i < 4; ++i)
+            {
+                readers.emplace_back([&] {
+                    while (!stop)
+                    {
+                        // Every write makes all the colors equal
+                        const auto snapshot = test.broadcaster->Current();
+                        for (size_t j = 0; j < 3; ++j)
+                        {
+                            if (snapshot.accentLight[j] != snapshot.accentColor || snapshot.accentDark[j] != snapshot.accentColor)
+                            {
+                                ++torn;
+                            }
+                        }
+                    }
+                });
+            }
+
+            for (uint32_t i = 1; i <= 50; ++i)
+            {
+                test.source->Write([i](ThemeSnapshot& values) {
+                    values.accentColor = i;
+                    values.accentLight.fill(i);
+                    values.accentDark.fill(i);
+                });
+                WaitUntil([&] { return test.broadcaster->Current().accentColor == i; });
+            }
+            stop = true;
+            for (auto& reader : readers)
+            {
+                reader.join();
+            }
+
+            Assert::AreEqual(0, torn.load());
+            Assert::AreEqual(50u, test.broadcaster->Current().accentColor);
+        }
+    };
+}
@@ -0,0 +1,371 @@
+#include "pch.h"
+#include <common/ThumbnailHost/ThumbnailCache.h>
+#include "TestHelpers.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <list>
+#include <random>
+#include <string_view>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTestsCommonLib
+{
+    namespace
+    {
+        ThumbnailCacheKey MakeKey(const uint64_t hash, const uint32_t cx = 256)
+        {
+            return { hash, hash * 7, cx };
+        }
+
+        // An index living in a plain buffer
+        struct IndexMemory
+        {
+            explicit IndexMemory(const uint32_t slots) :
+                slotCount{ slots }, buffer(ThumbnailCacheIndex::SizeFor(slots))
+            {
+            }
+
+            ThumbnailCacheIndex Open() { return ThumbnailCacheIndex{ buffer.data(), slotCount }; }
+
+            uint32_t slotCount;
+            std::vector<char> buffer;
+        };
+
+        const uint32_t* BitmapPixels(const HBITMAP bitmap, LONG& width, LONG& height)
+        {
+            DIBSECTION dib{};
+            if (GetObjectW(bitmap, sizeof(dib), &dib) != sizeof(dib))
+            {
+                return nullptr;
+            }
+            width = dib.dsBm.bmWidth;
+            height = dib.dsBm.bmHeight;
+            return static_cast<const uint32_t*>(dib.dsBm.bmBits);
+        }
+    }
+
+    TEST_CLASS (ThumbnailCacheTests)
+    {
+    public:
+        TEST_METHOD (ContentHash_MatchesXxh64)
+        {
+            constexpr std::string_view empty = "";
+            constexpr std::string_view abc = "abc";
+            constexpr std::string_view sentence = "Nobody inspects the spammish repetition";
+            Assert::AreEqual(0xEF46DB3751D8E999ull, ThumbnailContentHash(empty.data(), empty.size()));
+            Assert::AreEqual(0x44BC2CF5AD770999ull, ThumbnailContentHash(abc.data(), abc.size()));
+            Assert::AreEqual(0xFBCEA83C8A378BF1ull, ThumbnailContentHash(sentence.data(), sentence.size()));
+        }
+
+        TEST_METHOD (Index_FindsInsertedEntries)
+        {
+            IndexMemory memory{ 64 };
+            auto index = memory.Open();
+            Assert::IsTrue(index.Formatted());
+
+            Assert::IsTrue(index.Insert(MakeKey(1), 16, 8, 1 << 20).stored);
+            Assert::IsTrue(index.Insert(MakeKey(1, 96), 8, 8, 1 << 20).stored);
+            Assert::AreEqual(2u, index.Count());
+            Assert::AreEqual(uint64_t{ (16 * 8 + 8 * 8) * 4 }, index.TotalBytes());
+
+            const auto entry = index.Find(MakeKey(1));
+            Assert::IsNotNull(entry);
+            Assert::AreEqual(16u, entry->width);
+            Assert::AreEqual(8u, entry->height);
+            Assert::IsNull(index.Find(MakeKey(2)));
+            Assert::IsNull(index.Find({ 1, 8, 256 }));
+
+            // Updating an entry replaces it
+            Assert::IsTrue(index.Insert(MakeKey(1), 4, 4, 1 << 20).stored);
+            Assert::AreEqual(2u, index.Count());
+            Assert::AreEqual(4u, index.Find(MakeKey(1))->width);
+
+            index.Remove(MakeKey(1));
+            Assert::IsNull(index.Find(MakeKey(1)));
+            Assert::IsNotNull(index.Find(MakeKey(1, 96)));
+        }
+
+        TEST_METHOD (Index_ReopensExistingMemory)
+        {
+            IndexMemory memory{ 64 };
+            memory.Open().Insert(MakeKey(5), 2, 2, 1 << 20);
+
+            auto reopened = memory.Open();
+            Assert::IsFalse(reopened.Formatted());
+            Assert::IsNotNull(reopened.Find(MakeKey(5)));
+
+            // An index of another size is dropped
+            auto resized = ThumbnailCacheIndex{ memory.buffer.data(), 32 };
+            Assert::IsTrue(resized.Formatted());
+            Assert::IsNull(resized.Find(MakeKey(5)));
+        }
+
+        TEST_METHOD (Index_FormatsMemoryWithInconsistentHeader)
+        {
+            IndexMemory memory{ 64 };
+            auto header = reinterpret_cast<ThumbnailCacheIndex::Header*>(memory.buffer.data());
+            memory.Open().Insert(MakeKey(5), 2, 2, 1 << 20);
+            header->count = 1000000;
+            Assert::IsTrue(memory.Open().Formatted());
+
+            memory.Open().Insert(MakeKey(5), 2, 2, 1 << 20);
+            header->totalBytes = 1ull << 40;
+            Assert::IsTrue(memory.Open().Formatted());
+        }
+
+        TEST_METHOD (Index_StaysInBounds_WhenHeaderIsChangedAfterOpening)
+        {
+            IndexMemory memory{ 64 };
+            auto index = memory.Open();
+            index.Insert(MakeKey(5), 2, 2, 1 << 20);
+
+            // Another process may write anything to the shared memory
+            auto header = reinterpret_cast<ThumbnailCacheIndex::Header*>(memory.buffer.data());
+            header->slotCount = 0xFFFFFFFF;
+            header->count = 0xFFFFFFFF;
+            header->tombstones = 0;
+            Assert::IsNotNull(index.Find(MakeKey(5)));
+            Assert::IsNull(index.Find(MakeKey(6)));
+            for (uint64_t hash = 0; hash < 200; ++hash)
+            {
+                index.Insert(MakeKey(hash), 2, 2, 1 << 20);
+            }
+
+            // Even with every slot taken, inserting gives up rather than probing forever
+            auto entries = reinterpret_cast<ThumbnailCacheIndex::Entry*>(memory.buffer.data() + sizeof(ThumbnailCacheIndex::Header));
+            for (uint32_t i = 0; i < memory.slotCount; ++i)
+            {
+                entries[i].state = 1;
+            }
+            header->count = 0;
+            header->tombstones = 0;
+            header->totalBytes = 0;
+            Assert::IsFalse(index.Insert(MakeKey(1000), 2, 2, 1 << 20).stored);
+        }
+
+        TEST_METHOD (Index_EvictsLeastRecentlyUsed)
+        {
+            IndexMemory memory{ 64 };
+            auto index = memory.Open();
+            constexpr uint64_t maxBytes = 3 * 16 * 16 * 4;
+            index.Insert(MakeKey(1), 16, 16, maxBytes);
+            index.Insert(MakeKey(2), 16, 16, maxBytes);
+            index.Insert(MakeKey(3), 16, 16, maxBytes);
+            index.Find(MakeKey(1));
+
+            auto result = index.Insert(MakeKey(4), 16, 16, maxBytes);
+            Assert::IsTrue(result.stored);
+            Assert::AreEqual(size_t{ 1 }, result.evicted.size());
+            Assert::IsTrue(result.evicted[0] == MakeKey(2));
+            Assert::IsNull(index.Find(MakeKey(2)));
+            Assert::IsNotNull(index.Find(MakeKey(1)));
+            Assert::AreEqual(maxBytes, index.TotalBytes());
+
+            // Too large to be cached at all
+            result = index.Insert(MakeKey(5), 64, 64, maxBytes);
+            Assert::IsFalse(result.stored);
+            Assert::IsTrue(result.evicted.empty());
+            Assert::AreEqual(3u, index.Count());
+        }
+
+        TEST_METHOD (Index_EvictsEntryReplacedByOversizedThumbnail)
+        {
+            IndexMemory memory{ 64 };
+            auto index = memory.Open();
+            constexpr uint64_t maxBytes = 2 * 16 * 16 * 4;
+            index.Insert(MakeKey(1), 16, 16, maxBytes);
+            index.Insert(MakeKey(2), 16, 16, maxBytes);
+
+            const auto result = index.Insert(MakeKey(1), 64, 64, maxBytes);
+            Assert::IsFalse(result.stored);
+            Assert::AreEqual(size_t{ 1 }, result.evicted.size());
+            Assert::IsTrue(result.evicted[0] == MakeKey(1));
+            Assert::IsNull(index.Find(MakeKey(1)));
+            Assert::IsNotNull(index.Find(MakeKey(2)));
+            Assert::AreEqual(1u, index.Count());
+            Assert::AreEqual(uint64_t{ 16 * 16 * 4 }, index.TotalBytes());
+        }
+
+        TEST_METHOD (Index_MatchesLruModelUnderChurn)
+        {
+            IndexMemory memory{ 64 };
+            auto index = memory.Open();
+            constexpr uint64_t maxBytes = 40 * 8 * 8 * 4;
+
+            // Most recently used first
+            std::list<uint64_t> model;
+            std::mt19937 rng{ 7 };
+            for (int i = 0; i < 20000; ++i)
+            {
+                const uint64_t hash = rng() % 200;
+                if (rng() % 2)
+                {
+                    const bool found = index.Find(MakeKey(hash)) != nullptr;
+                    const auto modelEntry = std::find(model.begin(), model.end(), hash);
+                    Assert::AreEqual(modelEntry != model.end(), found);
+                    if (found)
+                    {
+                        model.splice(model.begin(), model, modelEntry);
+                    }
+                }
+                else
+                {
+                    const auto result = index.Insert(MakeKey(hash), 8, 8, maxBytes);
+                    Assert::IsTrue(result.stored);
+                    model.remove(hash);
+                    for (const auto& evicted : result.evicted)
+                    {
+                        Assert::IsTrue(evicted == MakeKey(model.back()));
+                        model.pop_back();
+                    }
+                    model.push_front(hash);
+                }
+                Assert::AreEqual(static_cast<uint32_t>(model.size()), index.Count());
+            }
+            // Bounded by the bytes, and by the load of the table
+            Assert::IsTrue(index.Count() <= 40u);
+            Assert::IsTrue(index.TotalBytes() <= maxBytes);
+        }
+
+        TEST_METHOD (Cache_ServesStoredPixelsAcrossInstances)
+        {
+            TemporaryDirectory directory;
+            std::vector<uint32_t> pixels(24 * 10);
+            for (size_t i = 0; i < pixels.size(); ++i)
+            {
+                pixels[i] = static_cast<uint32_t>(i * 2654435761u);
+            }
+            const std::string content = "qoif contents";
+            const auto key = ThumbnailCache::MakeKey(content.data(), content.size(), 24);
+
+            {
+                ThumbnailCache cache{ directory.path.wstring() };
+                Assert::IsTrue(cache.Available());
+                HBITMAP bitmap = nullptr;
+                Assert::IsFalse(cache.Lookup(key, &bitmap));
+                cache.Store(key, 24, 10, pixels.data());
+            }
+
+            ThumbnailCache cache{ directory.path.wstring() };
+            HBITMAP bitmap = nullptr;
+            Assert::IsTrue(cache.Lookup(key, &bitmap));
+            LONG width = 0;
+            LONG height = 0;
+            const uint32_t* bits = BitmapPixels(bitmap, width, height);
+            Assert::IsNotNull(bits);
+            Assert::AreEqual(24L, width);
+            Assert::AreEqual(10L, height);
+            Assert::IsTrue(std::equal(pixels.begin(), pixels.end(), bits));
+            DeleteObject(bitmap);
+
+            // Another size of the same file is another thumbnail
+            Assert::IsFalse(cache.Lookup(ThumbnailCache::MakeKey(content.data(), content.size(), 32), &bitmap));
+        }
+
+        TEST_METHOD (Cache_MissesWhenPixelsAreGone)
+        {
+            TemporaryDirectory directory;
+            ThumbnailCache cache{ directory.path.wstring() };
+            const uint32_t pixels[4]{};
+            const auto key = ThumbnailCache::MakeKey(pixels, sizeof(pixels), 2);
+            cache.Store(key, 2, 2, pixels);
+
+            for (const auto& file : std::filesystem::directory_iterator(directory.path))
+            {
+                if (file.path().extension() == L".pixels")
+                {
+                    std::filesystem::remove(file.path());
+                }
+            }
+            HBITMAP bitmap = nullptr;
+            Assert::IsFalse(cache.Lookup(key, &bitmap));
+        }
+
+        TEST_METHOD (Cache_DeletesPixelsReplacedByOversizedThumbnail)
+        {
+            TemporaryDirectory directory;
+            ThumbnailCache cache{ directory.path.wstring(), 8 * 8 * 4 };
+            const std::vector<uint32_t> pixels(16 * 16);
+            const auto key = ThumbnailCache::MakeKey(pixels.data(), 16, 16);
+            cache.Store(key, 8, 8, pixels.data());
+            HBITMAP bitmap = nullptr;
+            Assert::IsTrue(cache.Lookup(key, &bitmap));
+            DeleteObject(bitmap);
+
+            cache.Store(key, 16, 16, pixels.data());
+            Assert::IsFalse(cache.Lookup(key, &bitmap));
+            for (const auto& file : std::filesystem::directory_iterator(directory.path))
+            {
+                Assert::IsFalse(file.path().extension() == L".pixels");
+            }
+        }
+
+        // Scrolls twice through a folder of 10k files. The first pass renders and stores every thumbnail, the second
+        // one only hashes the contents and reads the pixels back.
+        BEGIN_TEST_METHOD_ATTRIBUTE(Benchmark_ScrollFolderTwice_10k)
+            TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD (Benchmark_ScrollFolderTwice_10k)
+        {
+            using clock = std::chrono::steady_clock;
+            constexpr size_t fileCount = 10000;
+            constexpr uint32_t cx = 96;
+            TemporaryDirectory directory;
+            ThumbnailCache cache{ directory.path.wstring(), 1ull << 30 };
+
+            std::mt19937 rng{ 3 };
+            std::vector<std::vector<char>> files(fileCount);
+            for (auto& file : files)
+            {
+                file.resize(8 * 1024 + rng() % (56 * 1024));
+                for (auto& byte : file)
+                {
+                    byte = static_cast<char>(rng());
+                }
+            }
+
+            // Stands in for decoding: every pixel depends on the whole file
+            std::vector<uint32_t> pixels(cx * cx);
+            auto render = [&](const std::vector<char>& file) {
+                uint64_t state = ThumbnailContentHash(file.data(), file.size(), 1);
+                for (auto& pixel : pixels)
+                {
+                    state = state * 6364136223846793005ull + 1442695040888963407ull;
+                    pixel = static_cast<uint32_t>(state >> 32) | 0xFF000000;
+                }
+            };
+
+            size_t hits[2]{};
+            clock::duration durations[2]{};
+            for (int pass = 0; pass < 2; ++pass)
+            {
+                const auto start = clock::now();
+                for (const auto& file : files)
+                {
+                    const auto key = ThumbnailCache::MakeKey(file.data(), file.size(), cx);
+                    HBITMAP bitmap = nullptr;
+                    if (cache.Lookup(key, &bitmap))
+                    {
+                        ++hits[pass];
+                        DeleteObject(bitmap);
+                        continue;
+                    }
+                    render(file);
+                    cache.Store(key, cx, cx, pixels.data());
+                }
+                durations[pass] = clock::now() - start;
+            }
+
+            Assert::AreEqual(size_t{ 0 }, hits[0]);
+            Assert::AreEqual(fileCount, hits[1]);
+            const auto ms = [](const clock::duration duration) { return std::chrono::duration_cast<std::chrono::milliseconds>(duration).count(); };
+            Logger::WriteMessage(std::format(L"10k thumbnails: first scroll {} ms, second scroll {} ms\n", ms(durations[0]), ms(durations[1])).c_str());
+        }
+    };
+}
@@ -0,0 +1,300 @@
+#include "pch.h"
+#include <common/ThumbnailHost/ThumbnailHost.h>
+#include "TestHelpers.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std::chrono_literals;
+
+namespace UnitTestsCommonLib
+{
+    namespace
+    {
+        uint32_t Checksum(const char* data, const uint64_t size)
+        {
+            uint32_t checksum = 2166136261u;
+            for (uint64_t i = 0; i < size; ++i)
+            {
+                checksum = (checksum ^ static_cast<uint8_t>(data[i])) * 16777619u;
+            }
+            return checksum;
+        }
+
+        // Serves the requests of a ThumbnailHost from threads rather than processes, following the protocol of
+        // ThumbnailHostServer.cs. Every thumbnail is a single pixel holding the checksum of the input.
+        class FakeWorkerLauncher : public ThumbnailHost::IWorkerLauncher
+        {
+        public:
+            // Workers leave a request unanswered until they are terminated
+            std::atomic_bool hang = false;
+            // Number of requests the workers exit on without answering
+            std::atomic_int crashes = 0;
+
+            std::atomic_int launches = 0;
+            std::atomic_int terminations = 0;
+            std::atomic_int requests = 0;
+            // Number of data sections the workers mapped
+            std::atomic_int sectionsMapped = 0;
+
+            ~FakeWorkerLauncher() override
+            {
+                std::unique_lock lock{ _mutex };
+                for (auto& worker : _workers)
+                {
+                    worker->stop.SetEvent();
+                    worker->thread.join();
+                }
+            }
+
+            HRESULT Launch(const std::wstring& name, wil::unique_handle& exited) override
+            {
+                auto worker = std::make_unique<Worker>();
+                const HRESULT hr = worker->stop.create(wil::EventOptions::ManualReset);
+                if (FAILED(hr))
+                {
+                    return hr;
+                }
+                worker->thread = std::thread{ [this, name, stop = worker->stop.get()] { Serve(name, stop); } };
+                if (!DuplicateHandle(GetCurrentProcess(), worker->thread.native_handle(), GetCurrentProcess(), exited.put(), SYNCHRONIZE, FALSE, 0))
+                {
+                    worker->stop.SetEvent();
+                    worker->thread.join();
+                    return HRESULT_FROM_WIN32(GetLastError());
+                }
+
+                ++launches;
+                std::unique_lock lock{ _mutex };
+                _workers.push_back(std::move(worker));
+                return S_OK;
+            }
+
+            void Terminate(const HANDLE exited) override
+            {
+                ++terminations;
+                std::unique_lock lock{ _mutex };
+                for (auto& worker : _workers)
+                {
+                    if (GetThreadId(worker->thread.native_handle()) == GetThreadId(exited))
+                    {
+                        worker->stop.SetEvent();
+                    }
+                }
+            }
+
+        private:
+            struct Worker
+            {
+                wil::unique_event_nothrow stop;
+                std::thread thread;
+            };
+
+            std::mutex _mutex;
+            std::vector<std::unique_ptr<Worker>> _workers;
+
+            void Serve(const std::wstring& name, const HANDLE stop)
+            {
+                wil::unique_handle control{ OpenFileMappingW(FILE_MAP_ALL_ACCESS, FALSE, (name + L".Control").c_str()) };
+                wil::unique_mapview_ptr<ThumbnailHost::Header> header{ static_cast<ThumbnailHost::Header*>(MapViewOfFile(control.get(), FILE_MAP_ALL_ACCESS, 0, 0, sizeof(ThumbnailHost::Header))) };
+                wil::unique_event_nothrow request;
+                wil::unique_event_nothrow response;
+                if (!header || !request.try_open((name + L".Request").c_str()) || !response.try_open((name + L".Response").c_str()))
+                {
+                    return;
+                }
+
+                wil::unique_handle data;
+                wil::unique_mapview_ptr<char> view;
+                uint32_t generation = 0;
+                const HANDLE handles[] = { stop, request.get() };
+                while (WaitForMultipleObjects(ARRAYSIZE(handles), handles, FALSE, INFINITE) == WAIT_OBJECT_0 + 1)
+                {
+                    ++requests;
+                    if (hang)
+                    {
+                        WaitForSingleObject(stop, INFINITE);
+                        return;
+                    }
+                    if (crashes.fetch_sub(1) > 0)
+                    {
+                        return;
+                    }
+                    crashes = 0;
+
+                    if (!view || generation != header->generation)
+                    {
+                        view.reset();
+                        data.reset(OpenFileMappingW(FILE_MAP_ALL_ACCESS, FALSE, (name + L".Data." + std::to_wstring(header->generation)).c_str()));
+                        view.reset(data ? static_cast<char*>(MapViewOfFile(data.get(), FILE_MAP_ALL_ACCESS, 0, 0, static_cast<SIZE_T>(header->capacity))) : nullptr);
+                        generation = header->generation;
+                        ++sectionsMapped;
+                    }
+
+                    header->status = ThumbnailHost::StatusFailed;
+                    if (view)
+                    {
+                        const uint32_t pixel = Checksum(view.get(), header->inputSize);
+                        std::memcpy(view.get(), &pixel, sizeof(pixel));
+                        header->width = 1;
+                        header->height = 1;
+                        header->status = ThumbnailHost::StatusSucceeded;
+                    }
+                    response.SetEvent();
+                }
+            }
+        };
+
+        winrt::com_ptr<IStream> MakeStream(const std::vector<char>& contents)
+        {
+            winrt::com_ptr<IStream> stream;
+            winrt::check_hresult(CreateStreamOnHGlobal(nullptr, TRUE, stream.put()));
+            winrt::check_hresult(stream->Write(contents.data(), static_cast<ULONG>(contents.size()), nullptr));
+            winrt::check_hresult(stream->Seek({}, STREAM_SEEK_SET, nullptr));
+            return stream;
+        }
+
+        std::vector<char> MakeContents(const size_t size, const char seed)
+        {
+            std::vector<char> contents(size);
+            for (size_t i = 0; i < size; ++i)
+            {
+                contents[i] = static_cast<char>(seed + i * 31);
+            }
+            return contents;
+        }
+
+        // Renders the contents and returns the pixel of the thumbnail
+        HRESULT Render(ThumbnailHost& host, const std::vector<char>& contents, uint32_t& pixel)
+        {
+            HBITMAP bitmap = nullptr;
+            WTS_ALPHATYPE alpha{};
+            const HRESULT hr = host.GetThumbnail(MakeStream(contents).get(), 16, &bitmap, &alpha);
+            if (SUCCEEDED(hr))
+            {
+                wil::unique_hbitmap owned{ bitmap };
+                DIBSECTION dib{};
+                Assert::AreEqual(static_cast<int>(sizeof(dib)), GetObjectW(bitmap, sizeof(dib), &dib));
+                Assert::AreEqual(1L, dib.dsBm.bmWidth);
+                Assert::AreEqual(1L, dib.dsBm.bmHeight);
+                pixel = *static_cast<const uint32_t*>(dib.dsBm.bmBits);
+            }
+            return hr;
+        }
+    }
+
+    TEST_CLASS (ThumbnailHostTests)
+    {
+    public:
+        TEST_METHOD (GetThumbnail_ReusesRunningWorker)
+        {
+            auto launcher = std::make_unique<FakeWorkerLauncher>();
+            auto& fake = *launcher;
+            ThumbnailHost host{ std::move(launcher), nullptr, 1, 5s };
+
+            for (char seed = 0; seed < 3; ++seed)
+            {
+                const auto contents = MakeContents(1000, seed);
+                uint32_t pixel = 0;
+                Assert::AreEqual(S_OK, Render(host, contents, pixel));
+                Assert::AreEqual(Checksum(contents.data(), contents.size()), pixel);
+            }
+            Assert::AreEqual(1, fake.launches.load());
+            Assert::AreEqual(1, fake.sectionsMapped.load());
+        }
+
+        TEST_METHOD (GetThumbnail_TerminatesWorker_WhenItTimesOut)
+        {
+            auto launcher = std::make_unique<FakeWorkerLauncher>();
+            auto& fake = *launcher;
+            ThumbnailHost host{ std::move(launcher), nullptr, 1, 200ms };
+            const auto contents = MakeContents(1000, 1);
+            uint32_t pixel = 0;
+
+            fake.hang = true;
+            const auto start = std::chrono::steady_clock::now();
+            Assert::AreEqual(HRESULT_FROM_WIN32(ERROR_TIMEOUT), Render(host, contents, pixel));
+            Assert::IsTrue(std::chrono::steady_clock::now() - start < 5s);
+            Assert::AreEqual(1, fake.terminations.load());
+
+            // The next request starts a new worker
+            fake.hang = false;
+            Assert::AreEqual(S_OK, Render(host, contents, pixel));
+            Assert::AreEqual(Checksum(contents.data(), contents.size()), pixel);
+            Assert::AreEqual(2, fake.launches.load());
+        }
+
+        TEST_METHOD (GetThumbnail_RestartsWorker_WhenItExits)
+        {
+            auto launcher = std::make_unique<FakeWorkerLauncher>();
+            auto& fake = *launcher;
+            ThumbnailHost host{ std::move(launcher), nullptr, 1, 5s };
+            const auto contents = MakeContents(1000, 2);
+            uint32_t pixel = 0;
+
+            fake.crashes = 1;
+            Assert::AreEqual(S_OK, Render(host, contents, pixel));
+            Assert::AreEqual(Checksum(contents.data(), contents.size()), pixel);
+            Assert::AreEqual(2, fake.launches.load());
+
+            // Only one restart per request
+            fake.crashes = 2;
+            Assert::AreEqual(E_FAIL, Render(host, contents, pixel));
+            Assert::AreEqual(3, fake.launches.load());
+        }
+
+        TEST_METHOD (GetThumbnail_ServesCacheHits_WithoutTakingAWorker)
+        {
+            TemporaryDirectory directory;
+            auto launcher = std::make_unique<FakeWorkerLauncher>();
+            auto& fake = *launcher;
+            ThumbnailHost host{ std::move(launcher), std::make_shared<ThumbnailCache>(directory.path.wstring()), 1, 2s };
+            const auto cached = MakeContents(1000, 6);
+            uint32_t pixel = 0;
+            Assert::AreEqual(S_OK, Render(host, cached, pixel));
+            Assert::AreEqual(1, fake.requests.load());
+
+            // Keep the only worker busy with another file
+            fake.hang = true;
+            std::thread busy{ [&] {
+                uint32_t ignored = 0;
+                Render(host, MakeContents(1000, 7), ignored);
+            } };
+            while (fake.requests < 2)
+            {
+                std::this_thread::yield();
+            }
+
+            const auto start = std::chrono::steady_clock::now();
+            Assert::AreEqual(S_OK, Render(host, cached, pixel));
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+            busy.join();
+
+            Assert::AreEqual(Checksum(cached.data(), cached.size()), pixel);
+            Assert::IsTrue(elapsed < 1s);
+            Assert::AreEqual(2, fake.requests.load());
+        }
+
+        TEST_METHOD (GetThumbnail_RemapsDataSection_WhenItIsReplaced)
+        {
+            auto launcher = std::make_unique<FakeWorkerLauncher>();
+            auto& fake = *launcher;
+            ThumbnailHost host{ std::move(launcher), nullptr, 1, 5s };
+            uint32_t pixel = 0;
+
+            // Small, then larger than the section, which is dropped after the request, then small again
+            const std::vector<char> inputs[] = { MakeContents(1000, 3), MakeContents(20 << 20, 4), MakeContents(1000, 5) };
+            for (const auto& contents : inputs)
+            {
+                Assert::AreEqual(S_OK, Render(host, contents, pixel));
+                Assert::AreEqual(Checksum(contents.data(), contents.size()), pixel);
+            }
+            Assert::AreEqual(3, fake.sectionsMapped.load());
+            Assert::AreEqual(1, fake.launches.load());
+        }
+    };
+}
@@ -0,0 +1,451 @@
+#include "pch.h"
+#include <common/notifications/toast_queue.h>
+#include <common/notifications/toast_xml.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace notifications;
+
+namespace UnitTestsCommonLib
+{
+    namespace
+    {
+        using namespace std::chrono_literals;
+
+        // Only moves when told to
+        struct FakeClock
+        {
+            toast_queue::clock::time_point now{};
+
+            toast_queue::clock_source Source()
+            {
+                return [this] { return now; };
+            }
+        };
+
+        toast_queue_options Options()
+        {
+            toast_queue_options options;
+            options.burst = 3;
+            options.refill_interval = 20s;
+            options.dedup_window = 10s;
+            options.flush_thread = false;
+            return options;
+        }
+
+        queued_toast Toast(std::wstring module_name, std::wstring title, std::optional<std::wstring> tag = std::nullopt)
+        {
+            queued_toast toast;
+            toast.module_name = std::move(module_name);
+            toast.message = L"Message of " + title;
+            toast.title = std::move(title);
+            toast.tag = std::move(tag);
+            return toast;
+        }
+
+        bool Contains(const std::wstring& xml, std::wstring_view text)
+        {
+            return xml.find(text) != std::wstring::npos;
+        }
+
+        // The title of each delivered toast, read back from its XML
+        std::vector<std::wstring> Titles(const recording_toast_delivery& delivery)
+        {
+            std::vector<std::wstring> titles;
+            for (const auto& request : delivery.delivered())
+            {
+                const std::wstring_view open = LR"(<text id="1">)";
+                const auto begin = request.xml.find(open) + open.size();
+                titles.push_back(request.xml.substr(begin, request.xml.find(L"</text>", begin) - begin));
+            }
+            return titles;
+        }
+
+        void AssertTitles(const std::vector<std::wstring>& expected, const recording_toast_delivery& delivery)
+        {
+            const auto actual = Titles(delivery);
+            std::wstring joined;
+            for (const auto& title : actual)
+            {
+                joined += title + L";";
+            }
+            Assert::IsTrue(expected == actual, joined.c_str());
+        }
+    }
+
+    TEST_CLASS (ToastTemplateTests)
+    {
+    public:
+        TEST_METHOD (Render_EscapesValues)
+        {
+            const toast_template text{ L"<text>{title}</text>", { L"title" } };
+            std::wstring xml;
+            text.render(xml, { L"Tom & \"Jerry's\" <b>" });
+            Assert::AreEqual(std::wstring{ L"<text>Tom &amp; &quot;Jerry&apos;s&quot; &lt;b&gt;</text>" }, xml);
+        }
+
+        TEST_METHOD (Render_KeepsOtherBraces)
+        {
+            const toast_template progress{ LR"(<progress title="{progressTitle}" value="{value}" />{)", { L"value" } };
+            std::wstring xml;
+            progress.render(xml, { L"0.5" });
+            Assert::AreEqual(std::wstring{ LR"(<progress title="{progressTitle}" value="0.5" />{)" }, xml);
+        }
+
+        TEST_METHOD (Render_FieldsInAnyOrder)
+        {
+            const toast_template selection{ LR"(<selection id="{id}" content="{content}" alt="{id}"/>)", { L"content", L"id" } };
+            std::wstring xml = L"<input>";
+            selection.render(xml, { L"15 minutes" });
+            Assert::AreEqual(std::wstring{ LR"(<input><selection id="" content="15 minutes" alt=""/>)" }, xml);
+        }
+
+        TEST_METHOD (RenderToastXml_WritesInputsBeforeActions)
+        {
+            const std::vector<action_t> actions = {
+                link_button{ L"Learn more", L"https://aka.ms/powertoys?a=1&b=2" },
+                background_activated_button{ L"Don't show again", true },
+                snooze_button{ L"Snooze for", { { L"1 hour", 60 }, { L"1 day", 1440 } }, L"Snooze" },
+            };
+            const auto xml = render_toast_xml(L"PowerToys", L"A <new> version", L"handler", actions, true);
+
+            Assert::AreEqual(std::wstring{ LR"(<?xml version="1.0"?><toast><visual><binding template="ToastGeneric">)"
+                                           LR"(<text id="1">PowerToys</text><text id="2">A &lt;new&gt; version</text>)"
+                                           LR"(<progress title="{progressTitle}" value="{progressValue}" valueStringOverride="{progressValueString}" status="" />)"
+                                           LR"(</binding></visual><actions>)"
+                                           LR"(<input id="snoozeTime2" type="selection" defaultInput="60" title="Snooze for">)"
+                                           LR"(<selection id="60" content="1 hour"/><selection id="1440" content="1 day"/></input>)"
+                                           LR"(<action activationType="protocol" arguments="https://aka.ms/powertoys?a=1&amp;b=2" content="Learn more" />)"
+                                           LR"(<action activationType="background" placement="contextMenu" arguments="button_id=1&amp;handler=handler" content="Don&apos;t show again" />)"
+                                           LR"(<action activationType="system" arguments="snooze" hint-inputId="snoozeTime2" content="Snooze" />)"
+                                           LR"(</actions></toast>)" },
+                             xml);
+        }
+    };
+
+    TEST_CLASS (ToastQueueTests)
+    {
+    public:
+        TEST_METHOD (Burst_IsShownRightAway)
+        {
+            FakeClock clock;
+            recording_toast_delivery delivery;
+            toast_queue queue{ delivery, Options(), clock.Source() };
+
+            for (const auto* title : { L"1", L"2", L"3" })
+            {
+                Assert::IsTrue(queue.submit(Toast(L"FancyZones", title)) == toast_submit_result::shown);
+            }
+            AssertTitles({ L"1", L"2", L"3" }, delivery);
+            Assert::IsFalse(queue.flush().has_value());
+        }
+
+        TEST_METHOD (PastTheBurst_SameTitle_IsMergedIntoASummary)
+        {
+            FakeClock clock;
+            recording_toast_delivery delivery;
+            toast_queue queue{ delivery, Options(), clock.Source() };
+
+            for (const auto* title : { L"1", L"2", L"3" })
+            {
+                queue.submit(Toast(L"FancyZones", title));
+            }
+            for (const auto* message : { L"First", L"Second", L"Third" })
+            {
+                auto toast = Toast(L"FancyZones", L"Failed");
+                toast.message = message;
+                Assert::IsTrue(queue.submit(std::move(toast)) == toast_submit_result::held);
+            }
+            AssertTitles({ L"1", L"2", L"3" }, delivery);
+
+            clock.now += 19s;
+            const auto due = queue.flush();
+            Assert::IsTrue(due == toast_queue::clock::time_point{} + 20s);
+            Assert::AreEqual(size_t{ 3 }, delivery.delivered().size());
+
+            clock.now += 1s;
+            Assert::IsFalse(queue.flush().has_value());
+            AssertTitles({ L"1", L"2", L"3", L"Failed (3)" }, delivery);
+
+            // The newest one, under a tag of the module and title so that the next summary replaces it
+            const auto summary = delivery.delivered().back();
+            Assert::IsTrue(Contains(summary.xml, L"Third"));
+            Assert::IsTrue(summary.tag.value_or(L"").starts_with(L"PTSummary"));
+
+            for (int i = 0; i < 2; ++i)
+            {
+                queue.submit(Toast(L"FancyZones", L"Failed"));
+            }
+            clock.now += 20s;
+            queue.flush();
+            AssertTitles({ L"1", L"2", L"3", L"Failed (3)", L"Failed (2)" }, delivery);
+            Assert::IsTrue(summary.tag == delivery.delivered().back().tag);
+        }
+
+        TEST_METHOD (PastTheBurst_OtherTitles_AreShownInTurn)
+        {
+            FakeClock clock;
+            recording_toast_delivery delivery;
+            toast_queue queue{ delivery, Options(), clock.Source() };
+
+            for (const auto* title : { L"1", L"2", L"3", L"4", L"5" })
+            {
+                auto toast = Toast(L"FancyZones", title);
+                toast.actions.push_back(link_button{ L"Open", std::wstring{ L"powertoys://" } + title });
+                queue.submit(std::move(toast));
+            }
+
+            // Each with its own content and actions, one per token
+            clock.now += 20s;
+            Assert::IsTrue(queue.flush() == toast_queue::clock::time_point{} + 40s);
+            AssertTitles({ L"1", L"2", L"3", L"4" }, delivery);
+            Assert::IsTrue(Contains(delivery.delivered().back().xml, L"Message of 4"));
+            Assert::IsTrue(Contains(delivery.delivered().back().xml, L"powertoys://4"));
+            Assert::IsFalse(delivery.delivered().back().tag.has_value());
+
+            clock.now += 20s;
+            Assert::IsFalse(queue.flush().has_value());
+            AssertTitles({ L"1", L"2", L"3", L"4", L"5" }, delivery);
+            Assert::IsTrue(Contains(delivery.delivered().back().xml, L"powertoys://5"));
+        }
+
+        TEST_METHOD (SingleHeldToast_IsShownAsIs)
+        {
+            FakeClock clock;
+            recording_toast_delivery delivery;
+            toast_queue queue{ delivery, Options(), clock.Source() };
+
+            for (const auto* title : { L"1", L"2", L"3", L"4" })
+            {
+                queue.submit(Toast(L"FancyZones", title));
+            }
+            clock.now += 20s;
+            queue.flush();
+
+            AssertTitles({ L"1", L"2", L"3", L"4" }, delivery);
+            Assert::IsFalse(delivery.delivered().back().tag.has_value());
+        }
+
+        TEST_METHOD (HeldToasts_AreShownBySubmitOnceDue)
+        {
+            FakeClock clock;
+            recording_toast_delivery delivery;
+            toast_queue queue{ delivery, Options(), clock.Source() };
+
+            for (const auto* title : { L"1", L"2", L"3", L"4", L"5" })
+            {
+                queue.submit(Toast(L"FancyZones", title));
+            }
+
+            // The oldest held toast goes first, and takes the only token
+            clock.now += 25s;
+            Assert::IsTrue(queue.submit(Toast(L"FancyZones", L"6")) == toast_submit_result::held);
+            AssertTitles({ L"1", L"2", L"3", L"4" }, delivery);
+            Assert::IsTrue(queue.flush() == toast_queue::clock::time_point{} + 40s);
+        }
+
+        TEST_METHOD (Tokens_RefillUpToTheBurst)
+        {
+            FakeClock clock;
+            recording_toast_delivery delivery;
+            toast_queue queue{ delivery, Options(), clock.Source() };
+
+            for (const auto* title : { L"1", L"2", L"3" })
+            {
+                queue.submit(Toast(L"FancyZones", title));
+            }
+
+            clock.now += 45s;
+            Assert::IsTrue(queue.submit(Toast(L"FancyZones", L"4")) == toast_submit_result::shown);
+            Assert::IsTrue(queue.submit(Toast(L"FancyZones", L"5")) == toast_submit_result::shown);
+            Assert::IsTrue(queue.submit(Toast(L"FancyZones", L"6")) == toast_submit_result::held);
+
+            // The 5 seconds toward the next token count
+            clock.now += 15s;
+            queue.flush();
+            AssertTitles({ L"1", L"2", L"3", L"4", L"5", L"6" }, delivery);
+
+            // Never more than the burst, however long it's been
+            clock.now += 1h;
+            for (const auto* title : { L"7", L"8", L"9" })
+            {
+                Assert::IsTrue(queue.submit(Toast(L"FancyZones", title)) == toast_submit_result::shown);
+            }
+            Assert::IsTrue(queue.submit(Toast(L"FancyZones", L"10")) == toast_submit_result::held);
+        }
+
+        TEST_METHOD (Modules_HaveTheirOwnLimit)
+        {
+            FakeClock clock;
+            recording_toast_delivery delivery;
+            toast_queue queue{ delivery, Options(), clock.Source() };
+
+            for (const auto* title : { L"1", L"2", L"3", L"4" })
+            {
+                queue.submit(Toast(L"FancyZones", title));
+            }
+            Assert::IsTrue(queue.submit(Toast(L"PowerToys", L"Update")) == toast_submit_result::shown);
+            AssertTitles({ L"1", L"2", L"3", L"Update" }, delivery);
+        }
+
+        TEST_METHOD (SameTag_IsShownOnceDuringTheWindow)
+        {
+            FakeClock clock;
+            recording_toast_delivery delivery;
+            toast_queue queue{ delivery, Options(), clock.Source() };
+
+            Assert::IsTrue(queue.submit(Toast(L"Settings", L"Cannot load", L"load")) == toast_submit_result::shown);
+            clock.now += 9s;
+            Assert::IsTrue(queue.submit(Toast(L"Settings", L"Cannot load", L"load")) == toast_submit_result::duplicate);
+
+            // A duplicate doesn't take a token
+            Assert::IsTrue(queue.submit(Toast(L"Settings", L"Cannot save", L"load")) == toast_submit_result::shown);
+            Assert::IsTrue(queue.submit(Toast(L"Settings", L"Cannot load", L"other")) == toast_submit_result::shown);
+
+            clock.now += 10s;
+            Assert::IsTrue(queue.submit(Toast(L"Settings", L"Cannot save", L"load")) == toast_submit_result::held);
+            clock.now += 20s;
+            queue.flush();
+            AssertTitles({ L"Cannot load", L"Cannot save", L"Cannot load", L"Cannot save" }, delivery);
+        }
+
+        TEST_METHOD (HeldToast_IsReplacedByItsTag)
+        {
+            FakeClock clock;
+            recording_toast_delivery delivery;
+            toast_queue queue{ delivery, Options(), clock.Source() };
+
+            for (const auto* title : { L"1", L"2", L"3" })
+            {
+                queue.submit(Toast(L"Updates", title));
+            }
+            Assert::IsTrue(queue.submit(Toast(L"Updates", L"Retrying", L"update")) == toast_submit_result::held);
+            Assert::IsTrue(queue.submit(Toast(L"Updates", L"Retrying again", L"update")) == toast_submit_result::held);
+            Assert::IsTrue(queue.submit(Toast(L"Updates", L"Failed", L"update")) == toast_submit_result::held);
+
+            clock.now += 20s;
+            queue.flush();
+            AssertTitles({ L"1", L"2", L"3", L"Failed" }, delivery);
+            Assert::AreEqual(std::wstring{ L"update" }, delivery.delivered().back().tag.value_or(L""));
+        }
+
+        TEST_METHOD (Remove_DropsHeldToastsAndAllowsShowingAgain)
+        {
+            FakeClock clock;
+            recording_toast_delivery delivery;
+            toast_queue queue{ delivery, Options(), clock.Source() };
+
+            queue.submit(Toast(L"PowerToys", L"New version", L"update"));
+            queue.submit(Toast(L"PowerToys", L"2"));
+            queue.submit(Toast(L"PowerToys", L"3"));
+            queue.submit(Toast(L"Settings", L"Held", L"held"));
+            queue.submit(Toast(L"PowerToys", L"Held", L"held"));
+
+            queue.remove(L"update");
+            queue.remove(L"held");
+            clock.now += 20s;
+            Assert::IsFalse(queue.flush().has_value());
+            Assert::IsTrue(queue.submit(Toast(L"PowerToys", L"New version", L"update")) == toast_submit_result::shown);
+            AssertTitles({ L"New version", L"2", L"3", L"Held", L"New version" }, delivery);
+        }
+
+        TEST_METHOD (ProgressToasts_AreNotRateLimited)
+        {
+            FakeClock clock;
+            recording_toast_delivery delivery;
+            toast_queue queue{ delivery, Options(), clock.Source() };
+
+            for (const auto* title : { L"1", L"2", L"3", L"4" })
+            {
+                queue.submit(Toast(L"PowerToys", title));
+            }
+            auto toast = Toast(L"PowerToys", L"Downloading", L"download");
+            toast.progress_bar = progress_bar_params{ L"Installer", 0.25f };
+            Assert::IsTrue(queue.submit(toast) == toast_submit_result::shown);
+
+            const auto shown = delivery.delivered().back();
+            Assert::IsTrue(Contains(shown.xml, L"{progressValue}"));
+            Assert::AreEqual(0.25f, shown.progress_bar->progress);
+
+            // Still only the one held before
+            clock.now += 20s;
+            queue.flush();
+            AssertTitles({ L"1", L"2", L"3", L"Downloading", L"4" }, delivery);
+        }
+
+        TEST_METHOD (ToastsPastMaxHeld_AreDropped)
+        {
+            FakeClock clock;
+            recording_toast_delivery delivery;
+            auto options = Options();
+            options.max_held = 4;
+            toast_queue queue{ delivery, options, clock.Source() };
+
+            for (int i = 1; i <= 103; ++i)
+            {
+                queue.submit(Toast(L"FancyZones", std::to_wstring(i)));
+            }
+            // Merged, so counted whatever their number
+            for (int i = 0; i < 100; ++i)
+            {
+                queue.submit(Toast(L"FancyZones", L"Failed"));
+            }
+            clock.now += 1h;
+            queue.flush();
+            AssertTitles({ L"1", L"2", L"3", L"101", L"102", L"103" }, delivery);
+            clock.now += 20s;
+            queue.flush();
+            AssertTitles({ L"1", L"2", L"3", L"101", L"102", L"103", L"Failed (100)" }, delivery);
+        }
+
+        TEST_METHOD (FlushThread_ShowsHeldToastsWhenDue)
+        {
+            recording_toast_delivery delivery;
+            auto options = Options();
+            options.burst = 1;
+            options.refill_interval = 50ms;
+            options.flush_thread = true;
+            toast_queue queue{ delivery, options };
+
+            queue.submit(Toast(L"FancyZones", L"1"));
+            queue.submit(Toast(L"FancyZones", L"2"));
+            queue.submit(Toast(L"FancyZones", L"3"));
+
+            const auto deadline = std::chrono::steady_clock::now() + 5s;
+            while (delivery.delivered().size() < 3 && std::chrono::steady_clock::now() < deadline)
+            {
+                std::this_thread::sleep_for(5ms);
+            }
+            AssertTitles({ L"1", L"2", L"3" }, delivery);
+        }
+
+        TEST_METHOD (ScheduleFlush_IsToldWhenHeldToastsAreDue)
+        {
+            FakeClock clock;
+            recording_toast_delivery delivery;
+            std::vector<toast_queue::clock::time_point> scheduled;
+            auto options = Options();
+            options.burst = 1;
+            options.schedule_flush = [&](toast_queue::clock::time_point due) { scheduled.push_back(due); };
+            toast_queue queue{ delivery, options, clock.Source() };
+
+            queue.submit(Toast(L"FancyZones", L"1"));
+            Assert::IsTrue(scheduled.empty());
+
+            clock.now += 5s;
+            queue.submit(Toast(L"FancyZones", L"2"));
+            queue.submit(Toast(L"FancyZones", L"3"));
+            Assert::AreEqual(size_t{ 2 }, scheduled.size());
+            Assert::IsTrue(scheduled[0] == toast_queue::clock::time_point{} + 20s);
+            Assert::IsTrue(scheduled[1] == scheduled[0]);
+
+            clock.now = scheduled[0];
+            Assert::IsTrue(queue.flush() == toast_queue::clock::time_point{} + 40s);
+            AssertTitles({ L"1", L"2" }, delivery);
+        }
+    };
+}
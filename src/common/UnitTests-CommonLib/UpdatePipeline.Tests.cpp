@@ -0,0 +1,429 @@
+#include "pch.h"
+#include <common/updating/updatePipeline.h>
+#include "TestHelpers.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace updating;
+
+namespace UnitTestsCommonLib
+{
+    namespace
+    {
+        // GitHub, the updates folder and UpdateState in memory, recording every state stored
+        class FakeHost : public update_host
+        {
+        public:
+            explicit FakeHost(std::filesystem::path updates) :
+                folder{ std::move(updates) }
+            {
+            }
+
+            std::optional<update_release> check() override
+            {
+                if (!check_error.empty())
+                {
+                    throw std::runtime_error(check_error);
+                }
+                return release;
+            }
+
+            std::unique_ptr<range_transport> open_installer(const update_release&) override
+            {
+                ++opened;
+                if (unreachable)
+                {
+                    return nullptr;
+                }
+                return std::make_unique<FakeConnection>(server);
+            }
+
+            std::filesystem::path updates_folder() override
+            {
+                return folder;
+            }
+
+            bool launch(const std::filesystem::path& installer) override
+            {
+                launched.push_back(installer);
+                return launch_succeeds;
+            }
+
+            UpdateState read_state() override
+            {
+                return state;
+            }
+
+            void store_state(const std::function<void(UpdateState&)>& modifier) override
+            {
+                modifier(state);
+                stored.push_back(state.stage);
+            }
+
+            std::filesystem::path folder;
+            std::optional<update_release> release;
+            // Serves the installer
+            FakeServer server{ {} };
+            std::string check_error;
+            bool unreachable = false;
+            bool launch_succeeds = true;
+
+            UpdateState state;
+            std::vector<UpdateState::Stage> stored;
+            std::vector<std::filesystem::path> launched;
+            int opened = 0;
+        };
+
+        struct RecordedEvents
+        {
+            void operator()(const update_event& event)
+            {
+                std::scoped_lock lock{ mutex };
+                events.push_back(event);
+            }
+
+            // Like "check+ check. download+ download~" for started, completed and cancelled, and "!" for failed.
+            // The progress events are left out.
+            std::wstring Summary()
+            {
+                const wchar_t* stages[] = { L"check", L"download", L"verify", L"stage", L"launch" };
+                // In the order of update_event
+                const wchar_t* marks[] = { L"+", nullptr, L".", L"!", L"~" };
+
+                std::scoped_lock lock{ mutex };
+                std::wstring summary;
+                for (const auto& event : events)
+                {
+                    if (const auto mark = marks[event.index()])
+                    {
+                        const auto stage = std::visit([](const auto& e) { return e.stage; }, event);
+                        summary += (summary.empty() ? L"" : L" ") + std::wstring{ stages[static_cast<int>(stage)] } + mark;
+                    }
+                }
+                return summary;
+            }
+
+            std::vector<stage_progress> Progress(update_stage stage)
+            {
+                std::scoped_lock lock{ mutex };
+                std::vector<stage_progress> progress;
+                for (const auto& event : events)
+                {
+                    if (const auto p = std::get_if<stage_progress>(&event); p && p->stage == stage)
+                    {
+                        progress.push_back(*p);
+                    }
+                }
+                return progress;
+            }
+
+            std::mutex mutex;
+            std::vector<update_event> events;
+        };
+
+        sha256_digest Digest(const std::vector<uint8_t>& bytes)
+        {
+            sha256_hasher hasher;
+            hasher.update(bytes.data(), bytes.size());
+            return hasher.finish();
+        }
+
+        void WriteFile(const std::filesystem::path& path, const std::vector<uint8_t>& bytes)
+        {
+            std::ofstream file{ path, std::ios::binary | std::ios::trunc };
+            file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        }
+
+        // A release of a random installer
+        void Publish(FakeHost& host, size_t size, uint32_t seed)
+        {
+            host.server.content = RandomBytes(size, seed);
+            host.release = update_release{ L"v0.99.0", L"powertoyssetup-0.99.0-x64.exe", Digest(host.server.content) };
+        }
+
+        update_pipeline_options Options(bool launch = false)
+        {
+            update_pipeline_options options;
+            options.launch = launch;
+            options.download.chunk_size = 16 * 1024;
+            options.download.parallel_chunks = 1;
+            options.download.retry_delay = std::chrono::milliseconds{ 0 };
+            return options;
+        }
+    }
+
+    TEST_CLASS (UpdatePipelineTests)
+    {
+    public:
+        TEST_METHOD (UpToDate_OnlyChecks)
+        {
+            TemporaryDirectory directory;
+            FakeHost host{ directory.path };
+            RecordedEvents events;
+            update_pipeline pipeline{ host, std::ref(events), Options() };
+
+            Assert::IsTrue(pipeline.run() == update_pipeline_result::up_to_date);
+            Assert::AreEqual(std::wstring{ L"check+ check." }, events.Summary());
+            Assert::IsTrue(host.state.state == UpdateState::upToDate);
+            Assert::IsTrue(host.state.stage == UpdateState::checked);
+            Assert::IsTrue(host.state.githubUpdateLastCheckedDate.has_value());
+            Assert::AreEqual(0, host.opened);
+        }
+
+        TEST_METHOD (NewRelease_RunsEachStageInOrder)
+        {
+            TemporaryDirectory directory;
+            FakeHost host{ directory.path };
+            Publish(host, 200 * 1024, 1);
+            RecordedEvents events;
+            update_pipeline pipeline{ host, std::ref(events), Options(true) };
+
+            Assert::IsTrue(pipeline.run() == update_pipeline_result::launched);
+            Assert::AreEqual(std::wstring{ L"check+ check. download+ download. verify+ verify. stage+ stage. launch+ launch." }, events.Summary());
+
+            const auto installer = directory.path / host.release->installer_filename;
+            Assert::IsTrue(installer == pipeline.installer());
+            Assert::IsTrue(host.server.content == ReadFile(installer));
+            Assert::AreEqual(size_t{ 1 }, host.launched.size());
+            Assert::IsTrue(installer == host.launched[0]);
+
+            const std::vector<UpdateState::Stage> expected = { UpdateState::checked, UpdateState::downloaded, UpdateState::verified, UpdateState::staged, UpdateState::launched };
+            Assert::IsTrue(expected == host.stored);
+            Assert::IsTrue(host.state.state == UpdateState::readyToInstall);
+            Assert::AreEqual(host.release->installer_filename, host.state.downloadedInstallerFilename);
+        }
+
+        TEST_METHOD (Download_ReportsProgressAndThroughput)
+        {
+            TemporaryDirectory directory;
+            FakeHost host{ directory.path };
+            Publish(host, 1024 * 1024, 2);
+            RecordedEvents events;
+            update_pipeline pipeline{ host, std::ref(events), Options() };
+
+            Assert::IsTrue(pipeline.run() == update_pipeline_result::staged);
+            const auto progress = events.Progress(update_stage::download);
+            Assert::IsTrue(progress.size() >= 2);
+            for (size_t i = 1; i < progress.size(); ++i)
+            {
+                Assert::IsTrue(progress[i].done > progress[i - 1].done);
+                Assert::AreEqual(uint64_t{ host.server.content.size() }, progress[i].total);
+            }
+            Assert::AreEqual(uint64_t{ host.server.content.size() }, progress.back().done);
+            Assert::IsTrue(progress.back().bytes_per_second > 0);
+
+            // The digest was checked while downloading
+            Assert::IsTrue(events.Progress(update_stage::verify).empty());
+        }
+
+        TEST_METHOD (Stage_LeavesTheInstallerAlone)
+        {
+            TemporaryDirectory directory;
+            FakeHost host{ directory.path };
+            Publish(host, 10000, 3);
+            WriteFile(directory.path / L"powertoyssetup-0.98.0-x64.exe", RandomBytes(100, 4));
+            WriteFile(directory.path / L"powertoyssetup-0.98.0-x64.exe.partial", RandomBytes(100, 5));
+            update_pipeline pipeline{ host, {}, Options() };
+
+            Assert::IsTrue(pipeline.run() == update_pipeline_result::staged);
+            std::vector<std::filesystem::path> files;
+            for (const auto& entry : std::filesystem::directory_iterator{ directory.path })
+            {
+                files.push_back(entry.path());
+            }
+            Assert::AreEqual(size_t{ 1 }, files.size());
+            Assert::IsTrue(pipeline.installer() == files[0]);
+            Assert::IsTrue(host.launched.empty());
+        }
+
+        TEST_METHOD (CheckFailure_IsReported)
+        {
+            TemporaryDirectory directory;
+            FakeHost host{ directory.path };
+            host.check_error = "Network error";
+            RecordedEvents events;
+            update_pipeline pipeline{ host, std::ref(events), Options() };
+
+            Assert::IsTrue(pipeline.run() == update_pipeline_result::failed);
+            Assert::AreEqual(std::wstring{ L"check+ check!" }, events.Summary());
+            Assert::AreEqual(std::wstring{ L"Network error" }, std::get<stage_failed>(events.events.back()).reason);
+            Assert::IsTrue(host.stored.empty());
+        }
+
+        TEST_METHOD (DownloadFailure_IsRetriedThenPersisted)
+        {
+            TemporaryDirectory directory;
+            FakeHost host{ directory.path };
+            Publish(host, 10000, 6);
+            host.unreachable = true;
+            RecordedEvents events;
+            auto options = Options();
+            options.download_attempts = 3;
+            update_pipeline pipeline{ host, std::ref(events), options };
+
+            Assert::IsTrue(pipeline.run() == update_pipeline_result::failed);
+            Assert::AreEqual(std::wstring{ L"check+ check. download+ download!" }, events.Summary());
+            Assert::AreEqual(3, host.opened);
+            Assert::IsTrue(host.state.state == UpdateState::errorDownloading);
+            Assert::IsTrue(host.state.stage == UpdateState::notStarted);
+        }
+
+        TEST_METHOD (Cancelled_BeforeRunning)
+        {
+            TemporaryDirectory directory;
+            FakeHost host{ directory.path };
+            Publish(host, 10000, 7);
+            RecordedEvents events;
+            update_pipeline pipeline{ host, std::ref(events), Options() };
+
+            std::stop_source cancellation;
+            cancellation.request_stop();
+            Assert::IsTrue(pipeline.run(cancellation.get_token()) == update_pipeline_result::cancelled);
+            Assert::AreEqual(std::wstring{ L"check+ check~" }, events.Summary());
+            Assert::IsTrue(host.stored.empty());
+        }
+
+        TEST_METHOD (CancelledDownload_ResumesOnTheNextRun)
+        {
+            TemporaryDirectory directory;
+            FakeHost host{ directory.path };
+            Publish(host, 512 * 1024, 8);
+
+            // Cancelled once a quarter is on disk
+            std::stop_source cancellation;
+            RecordedEvents events;
+            update_pipeline pipeline{ host, [&](const update_event& event) {
+                                         events(event);
+                                         if (const auto progress = std::get_if<stage_progress>(&event); progress && progress->done >= progress->total / 4)
+                                         {
+                                             cancellation.request_stop();
+                                         }
+                                     },
+                                      Options() };
+
+            Assert::IsTrue(pipeline.run(cancellation.get_token()) == update_pipeline_result::cancelled);
+            Assert::AreEqual(std::wstring{ L"check+ check. download+ download~" }, events.Summary());
+            Assert::IsFalse(std::filesystem::exists(pipeline.installer()));
+            Assert::IsTrue(std::filesystem::exists(download_journal_path(pipeline.installer())));
+            Assert::IsTrue(host.state.stage == UpdateState::checked);
+            const uint64_t first_run = host.server.served;
+            Assert::IsTrue(first_run < host.server.content.size());
+
+            update_pipeline next{ host, {}, Options() };
+            Assert::IsTrue(next.run() == update_pipeline_result::staged);
+            Assert::IsTrue(host.server.content == ReadFile(next.installer()));
+            Assert::AreEqual(uint64_t{ host.server.content.size() }, host.server.served.load());
+        }
+
+        TEST_METHOD (EarlierDownload_IsVerifiedInsteadOfDownloaded)
+        {
+            TemporaryDirectory directory;
+            FakeHost host{ directory.path };
+            Publish(host, 3 * 1024 * 1024, 9);
+            WriteFile(directory.path / host.release->installer_filename, host.server.content);
+            host.state.state = UpdateState::readyToInstall;
+            host.state.downloadedInstallerFilename = host.release->installer_filename;
+            host.state.stage = UpdateState::staged;
+            RecordedEvents events;
+            update_pipeline pipeline{ host, std::ref(events), Options() };
+
+            Assert::IsTrue(pipeline.run() == update_pipeline_result::staged);
+            Assert::AreEqual(std::wstring{ L"check+ check. verify+ verify. stage+ stage." }, events.Summary());
+            Assert::AreEqual(0, host.opened);
+            const auto progress = events.Progress(update_stage::verify);
+            Assert::AreEqual(size_t{ 3 }, progress.size());
+            Assert::AreEqual(uint64_t{ host.server.content.size() }, progress.back().done);
+        }
+
+        TEST_METHOD (TamperedInstaller_FailsVerification)
+        {
+            TemporaryDirectory directory;
+            FakeHost host{ directory.path };
+            Publish(host, 100000, 10);
+            auto tampered = host.server.content;
+            tampered[5000] ^= 0x5A;
+            const auto installer = directory.path / host.release->installer_filename;
+            WriteFile(installer, tampered);
+            host.state.downloadedInstallerFilename = host.release->installer_filename;
+            host.state.stage = UpdateState::verified;
+            RecordedEvents events;
+            update_pipeline pipeline{ host, std::ref(events), Options() };
+
+            Assert::IsTrue(pipeline.run() == update_pipeline_result::failed);
+            Assert::AreEqual(std::wstring{ L"check+ check. verify+ verify!" }, events.Summary());
+            Assert::IsFalse(std::filesystem::exists(installer));
+            Assert::IsTrue(host.state.state == UpdateState::errorDownloading);
+            Assert::IsTrue(host.state.downloadedInstallerFilename.empty());
+
+            // Downloaded again by the next run
+            update_pipeline next{ host, {}, Options() };
+            Assert::IsTrue(next.run() == update_pipeline_result::staged);
+            Assert::IsTrue(host.server.content == ReadFile(installer));
+        }
+
+        TEST_METHOD (AnotherRelease_IsDownloaded)
+        {
+            TemporaryDirectory directory;
+            FakeHost host{ directory.path };
+            Publish(host, 10000, 11);
+            host.state.downloadedInstallerFilename = L"powertoyssetup-0.98.0-x64.exe";
+            host.state.stage = UpdateState::staged;
+            WriteFile(directory.path / host.state.downloadedInstallerFilename, RandomBytes(100, 12));
+            update_pipeline pipeline{ host, {}, Options() };
+
+            Assert::IsTrue(pipeline.run() == update_pipeline_result::staged);
+            Assert::AreEqual(1, host.opened);
+            Assert::AreEqual(host.release->installer_filename, host.state.downloadedInstallerFilename);
+        }
+
+        TEST_METHOD (CancelledVerification_KeepsTheInstaller)
+        {
+            TemporaryDirectory directory;
+            FakeHost host{ directory.path };
+            Publish(host, 4 * 1024 * 1024, 13);
+            WriteFile(directory.path / host.release->installer_filename, host.server.content);
+            host.state.downloadedInstallerFilename = host.release->installer_filename;
+            host.state.stage = UpdateState::downloaded;
+
+            std::stop_source cancellation;
+            RecordedEvents events;
+            update_pipeline pipeline{ host, [&](const update_event& event) {
+                                         events(event);
+                                         if (std::holds_alternative<stage_progress>(event))
+                                         {
+                                             cancellation.request_stop();
+                                         }
+                                     },
+                                      Options() };
+
+            Assert::IsTrue(pipeline.run(cancellation.get_token()) == update_pipeline_result::cancelled);
+            Assert::AreEqual(std::wstring{ L"check+ check. verify+ verify~" }, events.Summary());
+            Assert::AreEqual(size_t{ 1 }, events.Progress(update_stage::verify).size());
+            Assert::IsTrue(std::filesystem::exists(pipeline.installer()));
+            Assert::IsTrue(host.state.stage == UpdateState::downloaded);
+        }
+
+        TEST_METHOD (LaunchFailure_KeepsTheUpdateStaged)
+        {
+            TemporaryDirectory directory;
+            FakeHost host{ directory.path };
+            Publish(host, 10000, 14);
+            host.launch_succeeds = false;
+            RecordedEvents events;
+            update_pipeline pipeline{ host, std::ref(events), Options(true) };
+
+            Assert::IsTrue(pipeline.run() == update_pipeline_result::failed);
+            Assert::IsTrue(events.Summary().ends_with(L"stage. launch+ launch!"));
+            Assert::IsTrue(host.state.state == UpdateState::readyToInstall);
+            Assert::IsTrue(host.state.stage == UpdateState::staged);
+            Assert::IsTrue(std::filesystem::exists(pipeline.installer()));
+        }
+    };
+}
@@ -0,0 +1,256 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Dispatches the events of a process wide low level keyboard hook to the components which subscribed to them.
+// Subscriptions are indexed by virtual key code when they change, so an event only reaches the handlers interested
+// in its key. Handlers run by descending priority, in subscription order for equal priorities, until one of them
+// swallows the event. The time spent in every handler is measured, since a slow one delays input for the whole system.
+class KeyboardHookDispatcher
+{
+public:
+    // Same values as the MOD_* flags of RegisterHotKey
+    enum Modifier : uint8_t
+    {
+        ModifierAlt = 0x1,
+        ModifierCtrl = 0x2,
+        ModifierShift = 0x4,
+        ModifierWin = 0x8,
+        AllModifiers = 0xF,
+    };
+
+    struct Event
+    {
+        uint8_t vkCode = 0;
+        bool keyDown = false;
+        // WM_SYSKEYDOWN or WM_SYSKEYUP
+        bool systemKey = false;
+        // Modifiers held when the event was generated. Only read when a subscriber of vkCode filters by modifiers.
+        uint8_t modifiers = 0;
+        uintptr_t extraInfo = 0;
+        // KBDLLHOOKSTRUCT the event was built from
+        const void* nativeEvent = nullptr;
+    };
+
+    struct Filter
+    {
+        // Virtual key codes to receive the events of, every key if empty
+        std::vector<uint8_t> keys;
+        // Only events with (modifiers & modifiersMask) == modifiers are delivered
+        uint8_t modifiersMask = 0;
+        uint8_t modifiers = 0;
+        bool keyDown = true;
+        bool keyUp = false;
+    };
+
+    // Returns true to swallow the event: lower priority subscribers and the next hooks don't receive it
+    using Handler = std::function<bool(const Event&)>;
+    using SubscriptionId = uint64_t;
+
+    // Observers see every event before handlers of the default priority get the chance to swallow it
+    static constexpr int ObserverPriority = 100;
+    static constexpr int DefaultPriority = 0;
+
+    struct SubscriberStatistics
+    {
+        SubscriptionId id = 0;
+        std::wstring name;
+        uint64_t calls = 0;
+        uint64_t swallowed = 0;
+        std::chrono::nanoseconds total{};
+        std::chrono::nanoseconds max{};
+    };
+
+    KeyboardHookDispatcher() = default;
+    KeyboardHookDispatcher(const KeyboardHookDispatcher&) = delete;
+    KeyboardHookDispatcher& operator=(const KeyboardHookDispatcher&) = delete;
+    virtual ~KeyboardHookDispatcher() = default;
+
+    // Subscribe and Unsubscribe are virtual so that modules loaded in the process run the code of the binary which
+    // owns the dispatcher: binaries linked with the static CRT don't share a heap.
+    virtual SubscriptionId Subscribe(std::wstring_view name, const int priority, const Filter& filter, Handler&& handler)
+    {
+        auto subscriber = std::make_shared<Subscriber>();
+        subscriber->name = name;
+        subscriber->priority = priority;
+        subscriber->filter = filter;
+        subscriber->handler = std::move(handler);
+
+        std::unique_lock lock{ _mutex };
+        subscriber->id = ++_lastId;
+        _subscribers.push_back(subscriber);
+        Publish();
+        return subscriber->id;
+    }
+
+    virtual void Unsubscribe(const SubscriptionId id)
+    {
+        std::unique_lock lock{ _mutex };
+        const auto removed = std::erase_if(_subscribers, [id](const auto& subscriber) { return subscriber->id == id; });
+        if (removed)
+        {
+            Publish();
+        }
+    }
+
+    // Delivers the event to the subscribers of its key. readModifiers is called at most once, and only if one of them
+    // filters by modifiers. Returns true if the event was swallowed.
+    template<typename ReadModifiers>
+    bool Dispatch(Event event, ReadModifiers&& readModifiers)
+    {
+        const auto table = _table.load(std::memory_order_acquire);
+        const auto& key = table->keys[event.vkCode];
+        if (key.subscribers.empty())
+        {
+            return false;
+        }
+
+        if (key.filtersByModifiers)
+        {
+            event.modifiers = readModifiers();
+        }
+
+        for (Subscriber* subscriber : key.subscribers)
+        {
+            if (!subscriber->Accepts(event))
+            {
+                continue;
+            }
+
+            const auto start = std::chrono::steady_clock::now();
+            const bool swallowed = subscriber->handler(event);
+            subscriber->Record(std::chrono::steady_clock::now() - start, swallowed);
+            if (swallowed)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<SubscriberStatistics> Statistics() const
+    {
+        std::vector<std::shared_ptr<Subscriber>> subscribers;
+        {
+            std::unique_lock lock{ _mutex };
+            subscribers = _subscribers;
+        }
+
+        std::vector<SubscriberStatistics> result;
+        result.reserve(subscribers.size());
+        for (const auto& subscriber : subscribers)
+        {
+            result.push_back({ .id = subscriber->id,
+                               .name = subscriber->name,
+                               .calls = subscriber->calls.load(std::memory_order_relaxed),
+                               .swallowed = subscriber->swallowed.load(std::memory_order_relaxed),
+                               .total = std::chrono::nanoseconds{ subscriber->totalNs.load(std::memory_order_relaxed) },
+                               .max = std::chrono::nanoseconds{ subscriber->maxNs.load(std::memory_order_relaxed) } });
+        }
+        return result;
+    }
+
+private:
+    struct Subscriber
+    {
+        SubscriptionId id = 0;
+        std::wstring name;
+        int priority = 0;
+        Filter filter;
+        Handler handler;
+
+        std::atomic_uint64_t calls = 0;
+        std::atomic_uint64_t swallowed = 0;
+        std::atomic_int64_t totalNs = 0;
+        std::atomic_int64_t maxNs = 0;
+
+        bool Accepts(const Event& event) const noexcept
+        {
+            return (event.keyDown ? filter.keyDown : filter.keyUp) &&
+                   (event.modifiers & filter.modifiersMask) == filter.modifiers;
+        }
+
+        void Record(const std::chrono::nanoseconds duration, const bool swallowedEvent) noexcept
+        {
+            calls.fetch_add(1, std::memory_order_relaxed);
+            swallowed.fetch_add(swallowedEvent ? 1 : 0, std::memory_order_relaxed);
+            totalNs.fetch_add(duration.count(), std::memory_order_relaxed);
+            auto max = maxNs.load(std::memory_order_relaxed);
+            while (duration.count() > max && !maxNs.compare_exchange_weak(max, duration.count(), std::memory_order_relaxed))
+            {
+            }
+        }
+    };
+
+    struct KeySubscribers
+    {
+        // Ordered by descending priority
+        std::vector<Subscriber*> subscribers;
+        bool filtersByModifiers = false;
+    };
+
+    // Immutable once published, so that Dispatch reads it without taking the lock
+    struct Table
+    {
+        std::vector<std::shared_ptr<Subscriber>> subscribers;
+        std::array<KeySubscribers, 256> keys;
+    };
+
+    // Serializes the writers, the hook thread only loads _table
+    mutable std::mutex _mutex;
+    // Ordered by id
+    std::vector<std::shared_ptr<Subscriber>> _subscribers;
+    std::atomic<std::shared_ptr<const Table>> _table = std::make_shared<const Table>();
+    SubscriptionId _lastId = 0;
+
+    // Must be called with _mutex held
+    void Publish()
+    {
+        auto table = std::make_shared<Table>();
+        table->subscribers = _subscribers;
+
+        auto ordered = _subscribers;
+        std::stable_sort(begin(ordered), end(ordered), [](const auto& lhs, const auto& rhs) {
+            return lhs->priority > rhs->priority;
+        });
+
+        for (const auto& subscriber : ordered)
+        {
+            const auto add = [&](const uint8_t vkCode) {
+                auto& key = table->keys[vkCode];
+                if (key.subscribers.empty() || key.subscribers.back() != subscriber.get())
+                {
+                    key.subscribers.push_back(subscriber.get());
+                    key.filtersByModifiers |= subscriber->filter.modifiersMask != 0;
+                }
+            };
+
+            if (subscriber->filter.keys.empty())
+            {
+                for (size_t vkCode = 0; vkCode < table->keys.size(); ++vkCode)
+                {
+                    add(static_cast<uint8_t>(vkCode));
+                }
+            }
+            else
+            {
+                for (const auto vkCode : subscriber->filter.keys)
+                {
+                    add(vkCode);
+                }
+            }
+        }
+
+        _table.store(std::move(table), std::memory_order_release);
+    }
+};
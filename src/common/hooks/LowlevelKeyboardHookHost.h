@@ -0,0 +1,100 @@
+#pragma once
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#include <common/debug_control.h>
+
+#include "KeyboardHookDispatcher.h"
+
+// Owns the WH_KEYBOARD_LL hook of a binary and hands its events to a KeyboardHookDispatcher, so that the components
+// of a process subscribe to one hook instead of each installing their own.
+class LowlevelKeyboardHookHost
+{
+public:
+    static LowlevelKeyboardHookHost& Instance()
+    {
+        static LowlevelKeyboardHookHost host;
+        return host;
+    }
+
+    KeyboardHookDispatcher& Dispatcher() noexcept
+    {
+        return _dispatcher;
+    }
+
+    // Installs the hook on the calling thread, which has to pump messages. Returns false if SetWindowsHookEx failed,
+    // GetLastError has the reason.
+    bool Start() noexcept
+    {
+#if defined(DISABLE_LOWLEVEL_HOOKS_WHEN_DEBUGGED)
+        if (IsDebuggerPresent())
+        {
+            return true;
+        }
+#endif
+        if (!_hook)
+        {
+            _hook = SetWindowsHookExW(WH_KEYBOARD_LL, HookProc, GetModuleHandleW(nullptr), 0);
+        }
+        return _hook != nullptr;
+    }
+
+    void Stop() noexcept
+    {
+        if (_hook && UnhookWindowsHookEx(_hook))
+        {
+            _hook = nullptr;
+        }
+    }
+
+private:
+    KeyboardHookDispatcher _dispatcher;
+    HHOOK _hook = nullptr;
+
+    LowlevelKeyboardHookHost() = default;
+
+    ~LowlevelKeyboardHookHost()
+    {
+        Stop();
+    }
+
+    static uint8_t ReadModifiers() noexcept
+    {
+        uint8_t modifiers = 0;
+        if ((GetAsyncKeyState(VK_LWIN) & 0x8000) || (GetAsyncKeyState(VK_RWIN) & 0x8000))
+        {
+            modifiers |= KeyboardHookDispatcher::ModifierWin;
+        }
+        if (GetAsyncKeyState(VK_CONTROL) & 0x8000)
+        {
+            modifiers |= KeyboardHookDispatcher::ModifierCtrl;
+        }
+        if (GetAsyncKeyState(VK_SHIFT) & 0x8000)
+        {
+            modifiers |= KeyboardHookDispatcher::ModifierShift;
+        }
+        if (GetAsyncKeyState(VK_MENU) & 0x8000)
+        {
+            modifiers |= KeyboardHookDispatcher::ModifierAlt;
+        }
+        return modifiers;
+    }
+
+    static LRESULT CALLBACK HookProc(int nCode, WPARAM wParam, LPARAM lParam)
+    {
+        if (nCode == HC_ACTION)
+        {
+            const auto& info = *reinterpret_cast<const KBDLLHOOKSTRUCT*>(lParam);
+            const KeyboardHookDispatcher::Event event{ .vkCode = static_cast<uint8_t>(info.vkCode),
+                                                       .keyDown = wParam == WM_KEYDOWN || wParam == WM_SYSKEYDOWN,
+                                                       .systemKey = wParam == WM_SYSKEYDOWN || wParam == WM_SYSKEYUP,
+                                                       .extraInfo = info.dwExtraInfo,
+                                                       .nativeEvent = &info };
+            if (Instance()._dispatcher.Dispatch(event, ReadModifiers))
+            {
+                return 1;
+            }
+        }
+        return CallNextHookEx(nullptr, nCode, wParam, lParam);
+    }
+};
@@ -1,12 +1,157 @@
 #include "pch.h"
 #include <array>
 #include <algorithm>
+#include <functional>
 
 #include "keyboard_layout_impl.h"
 #include "shared_constants.h"
 
 constexpr DWORD numpadOriginBit = 1ull << 31;
 
+namespace
+{
+    // Special key names like Shift, Ctrl etc because they don't have unicode mappings and key names like Enter, Space as they appear as "\r", " "
+    // Entries are applied in order, so later entries win for aliased key codes.
+    // To do: localization
+    const std::pair<DWORD, const wchar_t*> specialKeyNames[] = {
+        { VK_CANCEL, L"Break" },
+        { VK_BACK, L"Backspace" },
+        { VK_TAB, L"Tab" },
+        { VK_CLEAR, L"Clear" },
+        { VK_SHIFT, L"Shift" },
+        { VK_CONTROL, L"Ctrl" },
+        { VK_MENU, L"Alt" },
+        { VK_PAUSE, L"Pause" },
+        { VK_CAPITAL, L"Caps Lock" },
+        { VK_ESCAPE, L"Esc" },
+        { VK_SPACE, L"Space" },
+
+        { VK_LEFT, L"Left" },
+        { VK_RIGHT, L"Right" },
+        { VK_UP, L"Up" },
+        { VK_DOWN, L"Down" },
+        { VK_INSERT, L"Insert" },
+        { VK_DELETE, L"Delete" },
+        { VK_PRIOR, L"PgUp" },
+        { VK_NEXT, L"PgDn" },
+        { VK_HOME, L"Home" },
+        { VK_END, L"End" },
+        { VK_RETURN, L"Enter" },
+
+        { VK_SUBTRACT, L"- (Subtract)" },
+        { VK_SELECT, L"Select" },
+        { VK_PRINT, L"Print" },
+        { VK_EXECUTE, L"Execute" },
+        { VK_SNAPSHOT, L"Print Screen" },
+        { VK_HELP, L"Help" },
+        { VK_LWIN, L"Win (Left)" },
+        { VK_RWIN, L"Win (Right)" },
+        { VK_APPS, L"Apps/Menu" },
+        { VK_SLEEP, L"Sleep" },
+        { VK_NUMPAD0, L"NumPad 0" },
+        { VK_NUMPAD1, L"NumPad 1" },
+        { VK_NUMPAD2, L"NumPad 2" },
+        { VK_NUMPAD3, L"NumPad 3" },
+        { VK_NUMPAD4, L"NumPad 4" },
+        { VK_NUMPAD5, L"NumPad 5" },
+        { VK_NUMPAD6, L"NumPad 6" },
+        { VK_NUMPAD7, L"NumPad 7" },
+        { VK_NUMPAD8, L"NumPad 8" },
+        { VK_NUMPAD9, L"NumPad 9" },
+        { VK_SEPARATOR, L"Separator" },
+        { VK_F1, L"F1" },
+        { VK_F2, L"F2" },
+        { VK_F3, L"F3" },
+        { VK_F4, L"F4" },
+        { VK_F5, L"F5" },
+        { VK_F6, L"F6" },
+        { VK_F7, L"F7" },
+        { VK_F8, L"F8" },
+        { VK_F9, L"F9" },
+        { VK_F10, L"F10" },
+        { VK_F11, L"F11" },
+        { VK_F12, L"F12" },
+        { VK_F13, L"F13" },
+        { VK_F14, L"F14" },
+        { VK_F15, L"F15" },
+        { VK_F16, L"F16" },
+        { VK_F17, L"F17" },
+        { VK_F18, L"F18" },
+        { VK_F19, L"F19" },
+        { VK_F20, L"F20" },
+        { VK_F21, L"F21" },
+        { VK_F22, L"F22" },
+        { VK_F23, L"F23" },
+        { VK_F24, L"F24" },
+        { VK_NUMLOCK, L"Num Lock" },
+        { VK_SCROLL, L"Scroll Lock" },
+        { VK_LSHIFT, L"Shift (Left)" },
+        { VK_RSHIFT, L"Shift (Right)" },
+        { VK_LCONTROL, L"Ctrl (Left)" },
+        { VK_RCONTROL, L"Ctrl (Right)" },
+        { VK_LMENU, L"Alt (Left)" },
+        { VK_RMENU, L"Alt (Right)" },
+        { VK_BROWSER_BACK, L"Browser Back" },
+        { VK_BROWSER_FORWARD, L"Browser Forward" },
+        { VK_BROWSER_REFRESH, L"Browser Refresh" },
+        { VK_BROWSER_STOP, L"Browser Stop" },
+        { VK_BROWSER_SEARCH, L"Browser Search" },
+        { VK_BROWSER_FAVORITES, L"Browser Favorites" },
+        { VK_BROWSER_HOME, L"Browser Home" },
+        { VK_VOLUME_MUTE, L"Volume Mute" },
+        { VK_VOLUME_DOWN, L"Volume Down" },
+        { VK_VOLUME_UP, L"Volume Up" },
+        { VK_MEDIA_NEXT_TRACK, L"Next Track" },
+        { VK_MEDIA_PREV_TRACK, L"Previous Track" },
+        { VK_MEDIA_STOP, L"Stop Media" },
+        { VK_MEDIA_PLAY_PAUSE, L"Play/Pause Media" },
+        { VK_LAUNCH_MAIL, L"Start Mail" },
+        { VK_LAUNCH_MEDIA_SELECT, L"Select Media" },
+        { VK_LAUNCH_APP1, L"Start App 1" },
+        { VK_LAUNCH_APP2, L"Start App 2" },
+        { VK_PACKET, L"Packet" },
+        { VK_ATTN, L"Attn" },
+        { VK_CRSEL, L"CrSel" },
+        { VK_EXSEL, L"ExSel" },
+        { VK_EREOF, L"Erase EOF" },
+        { VK_PLAY, L"Play" },
+        { VK_ZOOM, L"Zoom" },
+        { VK_PA1, L"PA1" },
+        { VK_OEM_CLEAR, L"Clear" },
+        { 0xFF, L"Undefined" },
+        { CommonSharedConstants::VK_WIN_BOTH, L"Win" },
+        { VK_KANA, L"IME Kana" },
+        { VK_HANGEUL, L"IME Hangeul" },
+        { VK_HANGUL, L"IME Hangul" },
+        { VK_JUNJA, L"IME Junja" },
+        { VK_FINAL, L"IME Final" },
+        { VK_HANJA, L"IME Hanja" },
+        { VK_KANJI, L"IME Kanji" },
+        { VK_CONVERT, L"IME Convert" },
+        { VK_NONCONVERT, L"IME Non-Convert" },
+        { VK_ACCEPT, L"IME Kana" },
+        { VK_MODECHANGE, L"IME Mode Change" },
+        { VK_DECIMAL, L". (Numpad)" },
+        { CommonSharedConstants::VK_DISABLED, L"Disable" },
+    };
+
+    // Names of the keys which can originate from the numpad, stored in the upper half of the table
+    const std::pair<DWORD, const wchar_t*> numpadKeyNames[] = {
+        { VK_LEFT, L"Left (Numpad)" },
+        { VK_RIGHT, L"Right (Numpad)" },
+        { VK_UP, L"Up (Numpad)" },
+        { VK_DOWN, L"Down (Numpad)" },
+        { VK_INSERT, L"Insert (Numpad)" },
+        { VK_DELETE, L"Delete (Numpad)" },
+        { VK_PRIOR, L"PgUp (Numpad)" },
+        { VK_NEXT, L"PgDn (Numpad)" },
+        { VK_HOME, L"Home (Numpad)" },
+        { VK_END, L"End (Numpad)" },
+        { VK_RETURN, L"Enter (Numpad)" },
+        { VK_DIVIDE, L"/ (Numpad)" },
+    };
+}
+
 LayoutMap::LayoutMap() :
     impl(new LayoutMap::LayoutMapImpl())
 {
@@ -23,33 +168,62 @@ void LayoutMap::UpdateLayout()
 }
 
 std::wstring LayoutMap::GetKeyName(DWORD key)
+{
+    return std::wstring{ impl->GetKeyName(key) };
+}
+
+std::wstring_view LayoutMap::GetKeyNameView(DWORD key)
 {
     return impl->GetKeyName(key);
 }
 
-std::vector<DWORD> LayoutMap::GetKeyCodeList(const bool isShortcut)
+const std::vector<DWORD>& LayoutMap::GetKeyCodeList(const bool isShortcut)
 {
     return impl->GetKeyCodeList(isShortcut);
 }
 
-std::vector<std::pair<DWORD, std::wstring>> LayoutMap::GetKeyNameList(const bool isShortcut)
+const std::vector<std::pair<DWORD, std::wstring>>& LayoutMap::GetKeyNameList(const bool isShortcut)
 {
     return impl->GetKeyNameList(isShortcut);
 }
 
-// Function to return the unicode string name of the key
-std::wstring LayoutMap::LayoutMapImpl::GetKeyName(DWORD key)
+size_t LayoutMap::LayoutMapImpl::TableIndex(DWORD key) noexcept
 {
-    std::wstring result = L"Undefined";
-    std::lock_guard<std::mutex> lock(keyboardLayoutMap_mutex);
-    UpdateLayout();
+    if (key & numpadOriginBit)
+    {
+        key &= ~numpadOriginBit;
+        return key < 256 ? numpadSlots + key : tableSize;
+    }
+
+    if (key < 256)
+    {
+        return key;
+    }
+
+    if (key == CommonSharedConstants::VK_DISABLED)
+    {
+        return disabledSlot;
+    }
+
+    if (key == CommonSharedConstants::VK_WIN_BOTH)
+    {
+        return winBothSlot;
+    }
+
+    return tableSize;
+}
 
-    auto it = keyboardLayoutMap.find(key);
-    if (it != keyboardLayoutMap.end())
+// Function to return the unicode string name of the key
+std::wstring_view LayoutMap::LayoutMapImpl::GetKeyName(DWORD key)
+{
+    const auto& table = CurrentTable();
+    const size_t index = TableIndex(key);
+    if (index < tableSize && table.present[index])
     {
-        result = it->second;
+        return table.names[index];
     }
-    return result;
+
+    return L"Undefined";
 }
 
 bool mapKeycodeToUnicode(const int vCode, HKL layout, const BYTE* keyState, std::array<wchar_t, 3>& outBuffer)
@@ -62,21 +236,17 @@ bool mapKeycodeToUnicode(const int vCode, HKL layout, const BYTE* keyState, std:
     return result != 0;
 }
 
-// Update Keyboard layout according to input locale identifier
-void LayoutMap::LayoutMapImpl::UpdateLayout()
+// Build the key name table for the given layout
+std::unique_ptr<LayoutMap::LayoutMapImpl::KeyNameTable> LayoutMap::LayoutMapImpl::BuildTable(HKL layout) const
 {
-    // Get keyboard layout for current thread
-    const HKL layout = GetKeyboardLayout(0);
-    if (layout == previousLayout)
-    {
-        return;
-    }
-    previousLayout = layout;
-    if (!isKeyCodeListGenerated)
-    {
-        unicodeKeys.clear();
-        unknownKeys.clear();
-    }
+    auto table = std::make_unique<KeyNameTable>();
+    table->layout = layout;
+
+    auto setName = [&table](DWORD key, std::wstring name) {
+        const size_t index = TableIndex(key);
+        table->names[index] = std::move(name);
+        table->present.set(index);
+    };
 
     std::array<BYTE, 256> btKeys = { 0 };
     // Only set the Caps Lock key to on for the key names in uppercase
@@ -88,274 +258,175 @@ void LayoutMap::LayoutMapImpl::UpdateLayout()
         std::array<wchar_t, 3> szBuffer = { 0 };
         if (mapKeycodeToUnicode(i, layout, btKeys.data(), szBuffer))
         {
-            keyboardLayoutMap[i] = szBuffer.data();
-            if (!isKeyCodeListGenerated)
-            {
-                unicodeKeys[i] = szBuffer.data();
-            }
+            setName(i, szBuffer.data());
+            table->unicodeKeys.set(i);
             continue;
         }
 
         // Store the virtual key code as string
         std::wstring vk = L"VK ";
         vk += std::to_wstring(i);
-        keyboardLayoutMap[i] = vk;
-        if (!isKeyCodeListGenerated)
+        setName(i, std::move(vk));
+        table->unknownKeys.set(i);
+    }
+
+    // Remember the generated names, so the overridden keys can be told apart below
+    std::array<std::wstring, 256> generatedNames;
+    std::copy_n(table->names.begin(), generatedNames.size(), generatedNames.begin());
+
+    for (const auto& [key, name] : specialKeyNames)
+    {
+        setName(key, name);
+    }
+
+    for (const auto& [key, name] : numpadKeyNames)
+    {
+        setName(key | numpadOriginBit, name);
+    }
+
+    for (int i = 1; i < 256; i++)
+    {
+        if (table->names[i] != generatedNames[i])
         {
-            unknownKeys[i] = vk;
+            table->renamedKeys.set(i);
         }
     }
 
-    // Override special key names like Shift, Ctrl etc because they don't have unicode mappings and key names like Enter, Space as they appear as "\r", " "
-    // To do: localization
-    keyboardLayoutMap[VK_CANCEL] = L"Break";
-    keyboardLayoutMap[VK_BACK] = L"Backspace";
-    keyboardLayoutMap[VK_TAB] = L"Tab";
-    keyboardLayoutMap[VK_CLEAR] = L"Clear";
-    keyboardLayoutMap[VK_SHIFT] = L"Shift";
-    keyboardLayoutMap[VK_CONTROL] = L"Ctrl";
-    keyboardLayoutMap[VK_MENU] = L"Alt";
-    keyboardLayoutMap[VK_PAUSE] = L"Pause";
-    keyboardLayoutMap[VK_CAPITAL] = L"Caps Lock";
-    keyboardLayoutMap[VK_ESCAPE] = L"Esc";
-    keyboardLayoutMap[VK_SPACE] = L"Space";
-
-    keyboardLayoutMap[VK_LEFT] = L"Left";
-    keyboardLayoutMap[VK_RIGHT] = L"Right";
-    keyboardLayoutMap[VK_UP] = L"Up";
-    keyboardLayoutMap[VK_DOWN] = L"Down";
-    keyboardLayoutMap[VK_INSERT] = L"Insert";
-    keyboardLayoutMap[VK_DELETE] = L"Delete";
-    keyboardLayoutMap[VK_PRIOR] = L"PgUp";
-    keyboardLayoutMap[VK_NEXT] = L"PgDn";
-    keyboardLayoutMap[VK_HOME] = L"Home";
-    keyboardLayoutMap[VK_END] = L"End";
-    keyboardLayoutMap[VK_RETURN] = L"Enter";
-
-    keyboardLayoutMap[VK_LEFT | numpadOriginBit] = L"Left (Numpad)";
-    keyboardLayoutMap[VK_RIGHT | numpadOriginBit] = L"Right (Numpad)";
-    keyboardLayoutMap[VK_UP | numpadOriginBit] = L"Up (Numpad)";
-    keyboardLayoutMap[VK_DOWN | numpadOriginBit] = L"Down (Numpad)";
-    keyboardLayoutMap[VK_INSERT | numpadOriginBit] = L"Insert (Numpad)";
-    keyboardLayoutMap[VK_DELETE | numpadOriginBit] = L"Delete (Numpad)";
-    keyboardLayoutMap[VK_PRIOR | numpadOriginBit] = L"PgUp (Numpad)";
-    keyboardLayoutMap[VK_NEXT | numpadOriginBit] = L"PgDn (Numpad)";
-    keyboardLayoutMap[VK_HOME | numpadOriginBit] = L"Home (Numpad)";
-    keyboardLayoutMap[VK_END | numpadOriginBit] = L"End (Numpad)";
-    keyboardLayoutMap[VK_RETURN | numpadOriginBit] = L"Enter (Numpad)";
-    keyboardLayoutMap[VK_DIVIDE | numpadOriginBit] = L"/ (Numpad)";
-
-    keyboardLayoutMap[VK_SUBTRACT] = L"- (Subtract)";
-    keyboardLayoutMap[VK_SELECT] = L"Select";
-    keyboardLayoutMap[VK_PRINT] = L"Print";
-    keyboardLayoutMap[VK_EXECUTE] = L"Execute";
-    keyboardLayoutMap[VK_SNAPSHOT] = L"Print Screen";
-    keyboardLayoutMap[VK_HELP] = L"Help";
-    keyboardLayoutMap[VK_LWIN] = L"Win (Left)";
-    keyboardLayoutMap[VK_RWIN] = L"Win (Right)";
-    keyboardLayoutMap[VK_APPS] = L"Apps/Menu";
-    keyboardLayoutMap[VK_SLEEP] = L"Sleep";
-    keyboardLayoutMap[VK_NUMPAD0] = L"NumPad 0";
-    keyboardLayoutMap[VK_NUMPAD1] = L"NumPad 1";
-    keyboardLayoutMap[VK_NUMPAD2] = L"NumPad 2";
-    keyboardLayoutMap[VK_NUMPAD3] = L"NumPad 3";
-    keyboardLayoutMap[VK_NUMPAD4] = L"NumPad 4";
-    keyboardLayoutMap[VK_NUMPAD5] = L"NumPad 5";
-    keyboardLayoutMap[VK_NUMPAD6] = L"NumPad 6";
-    keyboardLayoutMap[VK_NUMPAD7] = L"NumPad 7";
-    keyboardLayoutMap[VK_NUMPAD8] = L"NumPad 8";
-    keyboardLayoutMap[VK_NUMPAD9] = L"NumPad 9";
-    keyboardLayoutMap[VK_SEPARATOR] = L"Separator";
-    keyboardLayoutMap[VK_F1] = L"F1";
-    keyboardLayoutMap[VK_F2] = L"F2";
-    keyboardLayoutMap[VK_F3] = L"F3";
-    keyboardLayoutMap[VK_F4] = L"F4";
-    keyboardLayoutMap[VK_F5] = L"F5";
-    keyboardLayoutMap[VK_F6] = L"F6";
-    keyboardLayoutMap[VK_F7] = L"F7";
-    keyboardLayoutMap[VK_F8] = L"F8";
-    keyboardLayoutMap[VK_F9] = L"F9";
-    keyboardLayoutMap[VK_F10] = L"F10";
-    keyboardLayoutMap[VK_F11] = L"F11";
-    keyboardLayoutMap[VK_F12] = L"F12";
-    keyboardLayoutMap[VK_F13] = L"F13";
-    keyboardLayoutMap[VK_F14] = L"F14";
-    keyboardLayoutMap[VK_F15] = L"F15";
-    keyboardLayoutMap[VK_F16] = L"F16";
-    keyboardLayoutMap[VK_F17] = L"F17";
-    keyboardLayoutMap[VK_F18] = L"F18";
-    keyboardLayoutMap[VK_F19] = L"F19";
-    keyboardLayoutMap[VK_F20] = L"F20";
-    keyboardLayoutMap[VK_F21] = L"F21";
-    keyboardLayoutMap[VK_F22] = L"F22";
-    keyboardLayoutMap[VK_F23] = L"F23";
-    keyboardLayoutMap[VK_F24] = L"F24";
-    keyboardLayoutMap[VK_NUMLOCK] = L"Num Lock";
-    keyboardLayoutMap[VK_SCROLL] = L"Scroll Lock";
-    keyboardLayoutMap[VK_LSHIFT] = L"Shift (Left)";
-    keyboardLayoutMap[VK_RSHIFT] = L"Shift (Right)";
-    keyboardLayoutMap[VK_LCONTROL] = L"Ctrl (Left)";
-    keyboardLayoutMap[VK_RCONTROL] = L"Ctrl (Right)";
-    keyboardLayoutMap[VK_LMENU] = L"Alt (Left)";
-    keyboardLayoutMap[VK_RMENU] = L"Alt (Right)";
-    keyboardLayoutMap[VK_BROWSER_BACK] = L"Browser Back";
-    keyboardLayoutMap[VK_BROWSER_FORWARD] = L"Browser Forward";
-    keyboardLayoutMap[VK_BROWSER_REFRESH] = L"Browser Refresh";
-    keyboardLayoutMap[VK_BROWSER_STOP] = L"Browser Stop";
-    keyboardLayoutMap[VK_BROWSER_SEARCH] = L"Browser Search";
-    keyboardLayoutMap[VK_BROWSER_FAVORITES] = L"Browser Favorites";
-    keyboardLayoutMap[VK_BROWSER_HOME] = L"Browser Home";
-    keyboardLayoutMap[VK_VOLUME_MUTE] = L"Volume Mute";
-    keyboardLayoutMap[VK_VOLUME_DOWN] = L"Volume Down";
-    keyboardLayoutMap[VK_VOLUME_UP] = L"Volume Up";
-    keyboardLayoutMap[VK_MEDIA_NEXT_TRACK] = L"Next Track";
-    keyboardLayoutMap[VK_MEDIA_PREV_TRACK] = L"Previous Track";
-    keyboardLayoutMap[VK_MEDIA_STOP] = L"Stop Media";
-    keyboardLayoutMap[VK_MEDIA_PLAY_PAUSE] = L"Play/Pause Media";
-    keyboardLayoutMap[VK_LAUNCH_MAIL] = L"Start Mail";
-    keyboardLayoutMap[VK_LAUNCH_MEDIA_SELECT] = L"Select Media";
-    keyboardLayoutMap[VK_LAUNCH_APP1] = L"Start App 1";
-    keyboardLayoutMap[VK_LAUNCH_APP2] = L"Start App 2";
-    keyboardLayoutMap[VK_PACKET] = L"Packet";
-    keyboardLayoutMap[VK_ATTN] = L"Attn";
-    keyboardLayoutMap[VK_CRSEL] = L"CrSel";
-    keyboardLayoutMap[VK_EXSEL] = L"ExSel";
-    keyboardLayoutMap[VK_EREOF] = L"Erase EOF";
-    keyboardLayoutMap[VK_PLAY] = L"Play";
-    keyboardLayoutMap[VK_ZOOM] = L"Zoom";
-    keyboardLayoutMap[VK_PA1] = L"PA1";
-    keyboardLayoutMap[VK_OEM_CLEAR] = L"Clear";
-    keyboardLayoutMap[0xFF] = L"Undefined";
-    keyboardLayoutMap[CommonSharedConstants::VK_WIN_BOTH] = L"Win";
-    keyboardLayoutMap[VK_KANA] = L"IME Kana";
-    keyboardLayoutMap[VK_HANGEUL] = L"IME Hangeul";
-    keyboardLayoutMap[VK_HANGUL] = L"IME Hangul";
-    keyboardLayoutMap[VK_JUNJA] = L"IME Junja";
-    keyboardLayoutMap[VK_FINAL] = L"IME Final";
-    keyboardLayoutMap[VK_HANJA] = L"IME Hanja";
-    keyboardLayoutMap[VK_KANJI] = L"IME Kanji";
-    keyboardLayoutMap[VK_CONVERT] = L"IME Convert";
-    keyboardLayoutMap[VK_NONCONVERT] = L"IME Non-Convert";
-    keyboardLayoutMap[VK_ACCEPT] = L"IME Kana";
-    keyboardLayoutMap[VK_MODECHANGE] = L"IME Mode Change";
-    keyboardLayoutMap[VK_DECIMAL] = L". (Numpad)";
-    keyboardLayoutMap[CommonSharedConstants::VK_DISABLED] = L"Disable";
+    return table;
 }
 
-// Function to return the list of key codes in the order for the drop down. It creates it if it doesn't exist
-std::vector<DWORD> LayoutMap::LayoutMapImpl::GetKeyCodeList(const bool isShortcut)
+// Generate the fixed order key code lists from the first table
+void LayoutMap::LayoutMapImpl::GenerateKeyCodeLists(const KeyNameTable& table)
 {
-    std::lock_guard<std::mutex> lock(keyboardLayoutMap_mutex);
-    UpdateLayout();
     std::vector<DWORD> keyCodes;
-    if (!isKeyCodeListGenerated)
-    {
-        // Add character keys
-        for (auto& it : unicodeKeys)
-        {
-            // If it was not renamed with a special name
-            if (it.second == keyboardLayoutMap[it.first])
-            {
-                keyCodes.push_back(it.first);
-            }
-        }
 
-        // Add modifier keys in alphabetical order
-        keyCodes.push_back(VK_MENU);
-        keyCodes.push_back(VK_LMENU);
-        keyCodes.push_back(VK_RMENU);
-        keyCodes.push_back(VK_CONTROL);
-        keyCodes.push_back(VK_LCONTROL);
-        keyCodes.push_back(VK_RCONTROL);
-        keyCodes.push_back(VK_SHIFT);
-        keyCodes.push_back(VK_LSHIFT);
-        keyCodes.push_back(VK_RSHIFT);
-        keyCodes.push_back(CommonSharedConstants::VK_WIN_BOTH);
-        keyCodes.push_back(VK_LWIN);
-        keyCodes.push_back(VK_RWIN);
-
-        // Add all other special keys
-        std::vector<DWORD> specialKeys;
-        for (int i = 1; i < 256; i++)
-        {
-            // If it is not already been added (i.e. it was either a modifier or had a unicode representation)
-            if (std::find(keyCodes.begin(), keyCodes.end(), i) == keyCodes.end())
-            {
-                // If it is any other key but it is not named as VK #
-                auto it = unknownKeys.find(i);
-                if (it == unknownKeys.end())
-                {
-                    specialKeys.push_back(i);
-                }
-                else if (unknownKeys[i] != keyboardLayoutMap[i])
-                {
-                    specialKeys.push_back(i);
-                }
-            }
-        }
-
-        // Add numpad keys
-        for (auto it = keyboardLayoutMap.rbegin(); it->first & numpadOriginBit; ++it)
+    // Add character keys
+    for (int i = 1; i < 256; i++)
+    {
+        // If it was not renamed with a special name
+        if (table.unicodeKeys[i] && !table.renamedKeys[i])
         {
-            keyCodes.push_back(it->first);
+            keyCodes.push_back(i);
         }
+    }
 
-        // Sort the special keys in alphabetical order
-        std::sort(specialKeys.begin(), specialKeys.end(), [&](const DWORD& lhs, const DWORD& rhs) {
-            return keyboardLayoutMap[lhs] < keyboardLayoutMap[rhs];
-        });
-        for (int i = 0; i < specialKeys.size(); i++)
-        {
-            keyCodes.push_back(specialKeys[i]);
-        }
+    // Add modifier keys in alphabetical order
+    keyCodes.push_back(VK_MENU);
+    keyCodes.push_back(VK_LMENU);
+    keyCodes.push_back(VK_RMENU);
+    keyCodes.push_back(VK_CONTROL);
+    keyCodes.push_back(VK_LCONTROL);
+    keyCodes.push_back(VK_RCONTROL);
+    keyCodes.push_back(VK_SHIFT);
+    keyCodes.push_back(VK_LSHIFT);
+    keyCodes.push_back(VK_RSHIFT);
+    keyCodes.push_back(CommonSharedConstants::VK_WIN_BOTH);
+    keyCodes.push_back(VK_LWIN);
+    keyCodes.push_back(VK_RWIN);
 
-        // Add unknown keys
-        for (auto& it : unknownKeys)
+    // Add all other special keys
+    std::vector<DWORD> specialKeys;
+    for (int i = 1; i < 256; i++)
+    {
+        // If it is not already been added (i.e. it was either a modifier or had a unicode representation)
+        if (std::find(keyCodes.begin(), keyCodes.end(), i) == keyCodes.end())
         {
-            // If it was not renamed with a special name
-            if (it.second == keyboardLayoutMap[it.first])
+            // If it is any other key but it is not named as VK #
+            if (!table.unknownKeys[i] || table.renamedKeys[i])
             {
-                keyCodes.push_back(it.first);
+                specialKeys.push_back(i);
             }
         }
-        keyCodeList = keyCodes;
-        isKeyCodeListGenerated = true;
     }
-    else
+
+    // Add numpad keys in descending key code order
+    std::vector<DWORD> numpadKeys;
+    for (const auto& [key, name] : numpadKeyNames)
     {
-        keyCodes = keyCodeList;
+        numpadKeys.push_back(key | numpadOriginBit);
     }
+    std::sort(numpadKeys.begin(), numpadKeys.end(), std::greater<DWORD>());
+    keyCodes.insert(keyCodes.end(), numpadKeys.begin(), numpadKeys.end());
 
-    // If it is a key list for the shortcut control then we add a "None" key at the start
-    if (isShortcut)
+    // Sort the special keys in alphabetical order
+    std::sort(specialKeys.begin(), specialKeys.end(), [&](const DWORD& lhs, const DWORD& rhs) {
+        return table.names[lhs] < table.names[rhs];
+    });
+    keyCodes.insert(keyCodes.end(), specialKeys.begin(), specialKeys.end());
+
+    // Add unknown keys
+    for (int i = 1; i < 256; i++)
     {
-        keyCodes.insert(keyCodes.begin(), 0);
+        // If it was not renamed with a special name
+        if (table.unknownKeys[i] && !table.renamedKeys[i])
+        {
+            keyCodes.push_back(i);
+        }
     }
 
-    return keyCodes;
+    keyCodeList = keyCodes;
+
+    // If it is a key list for the shortcut control then we add a "None" key at the start
+    shortcutKeyCodeList.reserve(keyCodes.size() + 1);
+    shortcutKeyCodeList.push_back(0);
+    shortcutKeyCodeList.insert(shortcutKeyCodeList.end(), keyCodes.begin(), keyCodes.end());
 }
 
-std::vector<std::pair<DWORD, std::wstring>> LayoutMap::LayoutMapImpl::GetKeyNameList(const bool isShortcut)
+// Return the table of the layout of the calling thread, building it if it doesn't exist
+const LayoutMap::LayoutMapImpl::KeyNameTable& LayoutMap::LayoutMapImpl::CurrentTable()
 {
-    std::vector<std::pair<DWORD, std::wstring>> keyNames;
-    std::vector<DWORD> keyCodes = GetKeyCodeList(isShortcut);
+    // Get keyboard layout for current thread
+    const HKL layout = GetKeyboardLayout(0);
+    const KeyNameTable* table = currentTable.load(std::memory_order_acquire);
+    if (table && table->layout == layout)
+    {
+        return *table;
+    }
+
     std::lock_guard<std::mutex> lock(keyboardLayoutMap_mutex);
-    // If it is a key list for the shortcut control then we add a "None" key at the start
-    if (isShortcut)
+    auto it = layoutTables.find(layout);
+    if (it == layoutTables.end())
     {
-        keyNames.push_back({ 0, L"None" });
-        for (int i = 1; i < keyCodes.size(); i++)
+        auto newTable = BuildTable(layout);
+        if (keyCodeList.empty())
         {
-            keyNames.push_back({ keyCodes[i], keyboardLayoutMap[keyCodes[i]] });
+            GenerateKeyCodeLists(*newTable);
         }
-    }
-    else
-    {
-        for (int i = 0; i < keyCodes.size(); i++)
+
+        newTable->keyNameList.reserve(keyCodeList.size());
+        for (const DWORD key : keyCodeList)
         {
-            keyNames.push_back({ keyCodes[i], keyboardLayoutMap[keyCodes[i]] });
+            newTable->keyNameList.push_back({ key, newTable->names[TableIndex(key)] });
         }
+
+        newTable->shortcutKeyNameList.reserve(keyCodeList.size() + 1);
+        newTable->shortcutKeyNameList.push_back({ 0, L"None" });
+        newTable->shortcutKeyNameList.insert(newTable->shortcutKeyNameList.end(), newTable->keyNameList.begin(), newTable->keyNameList.end());
+
+        it = layoutTables.emplace(layout, std::move(newTable)).first;
     }
 
-    return keyNames;
+    table = it->second.get();
+    currentTable.store(table, std::memory_order_release);
+    return *table;
+}
+
+// Update Keyboard layout according to input locale identifier
+void LayoutMap::LayoutMapImpl::UpdateLayout()
+{
+    CurrentTable();
+}
+
+// Function to return the list of key codes in the order for the drop down
+const std::vector<DWORD>& LayoutMap::LayoutMapImpl::GetKeyCodeList(const bool isShortcut)
+{
+    // Make sure the lists have been generated
+    CurrentTable();
+    return isShortcut ? shortcutKeyCodeList : keyCodeList;
+}
+
+const std::vector<std::pair<DWORD, std::wstring>>& LayoutMap::LayoutMapImpl::GetKeyNameList(const bool isShortcut)
+{
+    const auto& table = CurrentTable();
+    return isShortcut ? table.shortcutKeyNameList : table.keyNameList;
 }
@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
 #include <Windows.h>
@@ -11,8 +12,10 @@ public:
     ~LayoutMap();
     void UpdateLayout();
     std::wstring GetKeyName(DWORD key);
-    std::vector<DWORD> GetKeyCodeList(const bool isShortcut = false);
-    std::vector<std::pair<DWORD, std::wstring>> GetKeyNameList(const bool isShortcut = false);
+    // Returns a view into the name table of the current layout. The view stays valid for the lifetime of the LayoutMap.
+    std::wstring_view GetKeyNameView(DWORD key);
+    const std::vector<DWORD>& GetKeyCodeList(const bool isShortcut = false);
+    const std::vector<std::pair<DWORD, std::wstring>>& GetKeyNameList(const bool isShortcut = false);
 
 private:
     class LayoutMapImpl;
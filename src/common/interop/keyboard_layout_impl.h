@@ -1,34 +1,74 @@
 #pragma once
 #include "keyboard_layout.h"
-#include <string>
+#include <array>
+#include <atomic>
+#include <bitset>
 #include <map>
 #include <mutex>
+#include <string>
 
 // Wrapper class to handle keyboard layout
 class LayoutMap::LayoutMapImpl
 {
-private:
-    // Stores mappings for all the virtual key codes to the name of the key
-    std::mutex keyboardLayoutMap_mutex;
+public:
+    // 256 virtual key codes followed by their numpad-origin variants and one slot for each fake key code above 0xFF
+    static constexpr size_t numpadSlots = 256;
+    static constexpr size_t disabledSlot = 512;
+    static constexpr size_t winBothSlot = 513;
+    static constexpr size_t tableSize = 514;
+
+    // Immutable key name table of a single keyboard layout. Built once per HKL and never modified afterwards,
+    // so it can be read without taking any lock.
+    struct KeyNameTable
+    {
+        HKL layout = 0;
+
+        // Names of all the keys, indexed by TableIndex
+        std::array<std::wstring, tableSize> names;
+
+        // Stores true for the slots which have a name
+        std::bitset<tableSize> present;
+
+        // Stores the keys which have a unicode representation
+        std::bitset<256> unicodeKeys;
 
-    // Stores the previous layout
-    HKL previousLayout = 0;
+        // Stores the keys which do not have a name
+        std::bitset<256> unknownKeys;
 
-    // Stores the keys which have a unicode representation
-    std::map<DWORD, std::wstring> unicodeKeys;
+        // Stores true for the keys whose unicode or unknown name was overridden by a special name
+        std::bitset<256> renamedKeys;
 
-    // Stores the keys which do not have a name
-    std::map<DWORD, std::wstring> unknownKeys;
+        // Key name pairs in the order of the drop down key code lists
+        std::vector<std::pair<DWORD, std::wstring>> keyNameList;
+        std::vector<std::pair<DWORD, std::wstring>> shortcutKeyNameList;
+    };
 
-    // Stores true if the fixed ordering key code list has already been set
-    bool isKeyCodeListGenerated = false;
+private:
+    // Guards building new tables and switching the current one. Never taken by readers when the layout did not change.
+    std::mutex keyboardLayoutMap_mutex;
+
+    // Stores the tables of every layout seen so far. Tables are kept alive for the lifetime of the map so views handed out stay valid.
+    std::map<HKL, std::unique_ptr<const KeyNameTable>> layoutTables;
+
+    // Table of the most recently used layout
+    std::atomic<const KeyNameTable*> currentTable = nullptr;
 
     // Stores a fixed order key code list for the drop down menus. It is kept fixed to change in ordering due to languages
     std::vector<DWORD> keyCodeList;
 
-public:
-    std::map<DWORD, std::wstring> keyboardLayoutMap;
+    // Same list with a "None" key at the start, used by the shortcut controls
+    std::vector<DWORD> shortcutKeyCodeList;
 
+    // Build the key name table for the given layout
+    std::unique_ptr<KeyNameTable> BuildTable(HKL layout) const;
+
+    // Generate the fixed order key code lists from the first table
+    void GenerateKeyCodeLists(const KeyNameTable& table);
+
+    // Return the table of the layout of the calling thread, building it if it doesn't exist
+    const KeyNameTable& CurrentTable();
+
+public:
     // Update Keyboard layout according to input locale identifier
     void UpdateLayout();
 
@@ -37,12 +77,15 @@ public:
         UpdateLayout();
     }
 
+    // Returns the slot of the key in the name table, or tableSize if the key can't be represented
+    static size_t TableIndex(DWORD key) noexcept;
+
     // Function to return the unicode string name of the key
-    std::wstring GetKeyName(DWORD key);
+    std::wstring_view GetKeyName(DWORD key);
 
-    // Function to return the list of key codes in the order for the drop down. It creates it if it doesn't exist
-    std::vector<DWORD> GetKeyCodeList(const bool isShortcut);
+    // Function to return the list of key codes in the order for the drop down
+    const std::vector<DWORD>& GetKeyCodeList(const bool isShortcut);
 
     // Function to return the list of key name pairs in the order for the drop down based on the key codes
-    std::vector<std::pair<DWORD, std::wstring>> GetKeyNameList(const bool isShortcut);
-};
\ No newline at end of file
+    const std::vector<std::pair<DWORD, std::wstring>>& GetKeyNameList(const bool isShortcut);
+};
@@ -1,6 +1,7 @@
 #include "pch.h"
 
 #include "notifications.h"
+#include "toast_queue.h"
 #include "utils/com_object_factory.h"
 #include "utils/window.h"
 
@@ -35,15 +36,6 @@ using winrt::Windows::UI::Notifications::ToastNotificationManager;
 
 namespace fs = std::filesystem;
 
-template<class... Ts>
-struct overloaded : Ts...
-{
-    using Ts::operator()...;
-};
-
-template<class... Ts>
-overloaded(Ts...) -> overloaded<Ts...>;
-
 namespace // Strings in this namespace should not be localized
 {
     constexpr std::wstring_view TASK_NAME = L"PowerToysBackgroundNotificationsHandler";
@@ -143,191 +135,201 @@ void notifications::show_toast(std::wstring message, std::wstring title, toast_p
     show_toast_with_activations(std::move(message), std::move(title), {}, {}, std::move(params));
 }
 
-constexpr inline void xml_escape(std::wstring data)
+namespace
 {
-    std::wstring buffer;
-    buffer.reserve(data.size());
-    for (size_t pos = 0; pos != data.size(); ++pos)
+    class notification_center_delivery : public notifications::toast_delivery
     {
-        switch (data[pos])
+    public:
+        void show(const notifications::toast_delivery_request& request) override
         {
-        case L'&':
-            buffer.append(L"&amp;");
-            break;
-        case L'\"':
-            buffer.append(L"&quot;");
-            break;
-        case L'\'':
-            buffer.append(L"&apos;");
-            break;
-        case L'<':
-            buffer.append(L"&lt;");
-            break;
-        case L'>':
-            buffer.append(L"&gt;");
-            break;
-        default:
-            buffer.append(&data[pos], 1);
-            break;
+            // Held toasts are shown from the thread of the queue, which COM doesn't know yet
+            const HRESULT com_init = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+            try
+            {
+                show_now(request);
+            }
+            catch (...)
+            {
+            }
+            if (SUCCEEDED(com_init))
+            {
+                CoUninitialize();
+            }
         }
-    }
-    data.swap(buffer);
-}
 
-void notifications::show_toast_with_activations(std::wstring message,
-                                                std::wstring title,
-                                                std::wstring_view background_handler_id,
-                                                std::vector<action_t> actions,
-                                                toast_params params)
-{
-    // DO NOT LOCALIZE any string in this function, because they're XML tags and a subject to
-    // https://learn.microsoft.com/windows/uwp/design/shell/tiles-and-notifications/toast-xml-schema
-
-    std::wstring toast_xml;
-    toast_xml.reserve(2048);
-
-    // We must set toast's title and contents immediately, because some of the toasts we send could be snoozed.
-    // Windows instantiates the snoozed toast from scratch before showing it again, so all bindings that were set
-    // using NotificationData would be empty.
-    toast_xml += LR"(<?xml version="1.0"?><toast><visual><binding template="ToastGeneric">)";
-    toast_xml += LR"(<text id="1">)";
-    toast_xml += std::move(title);
-    toast_xml += LR"(</text>)";
-    toast_xml += LR"(<text id="2">)";
-    toast_xml += std::move(message);
-    toast_xml += LR"(</text>)";
-
-    if (params.progress_bar.has_value())
-    {
-        toast_xml += LR"(<progress title="{progressTitle}" value="{progressValue}" valueStringOverride="{progressValueString}" status="" />)";
-    }
-    toast_xml += L"</binding></visual><actions>";
-    for (size_t i = 0; i < size(actions); ++i)
-    {
-        std::visit(overloaded{
-                       [&](const snooze_button& b) {
-                           const bool has_durations = !b.durations.empty() && size(b.durations) <= 5;
-                           std::wstring selection_id = L"snoozeTime";
-                           selection_id += static_cast<wchar_t>(L'0' + i);
-                           if (has_durations)
-                           {
-                               toast_xml += LR"(<input id=")";
-                               toast_xml += selection_id;
-                               toast_xml += LR"(" type="selection" defaultInput=")";
-                               toast_xml += std::to_wstring(b.durations[0].minutes);
-                               toast_xml += L'"';
-                               if (!b.snooze_title.empty())
-                               {
-                                   toast_xml += LR"( title=")";
-                                   toast_xml += b.snooze_title;
-                                   toast_xml += L'"';
-                               }
-                               toast_xml += L'>';
-                               for (const auto& duration : b.durations)
-                               {
-                                   toast_xml += LR"(<selection id=")";
-                                   toast_xml += std::to_wstring(duration.minutes);
-                                   toast_xml += LR"(" content=")";
-                                   toast_xml += duration.label;
-                                   toast_xml += LR"("/>)";
-                               }
-                               toast_xml += LR"(</input>)";
-                           }
-                       },
-                       [](const auto&) {} },
-                   actions[i]);
-    }
+    private:
+        static void show_now(const notifications::toast_delivery_request& request)
+        {
+            XmlDocument toast_xml_doc;
+            toast_xml_doc.LoadXml(request.xml);
+            ToastNotification notification{ toast_xml_doc };
+            notification.Group(DEFAULT_TOAST_GROUP);
 
-    for (size_t i = 0; i < size(actions); ++i)
-    {
-        std::visit(overloaded{
-                       [&](const link_button& b) {
-                           toast_xml += LR"(<action activationType="protocol" )";
-                           if (b.context_menu)
-                           {
-                               toast_xml += LR"(placement="contextMenu" )";
-                           }
-                           toast_xml += LR"(arguments=")";
-                           toast_xml += b.url;
-                           toast_xml += LR"(" content=")";
-                           toast_xml += b.label;
-                           toast_xml += LR"(" />)";
-                       },
-                       [&](const background_activated_button& b) {
-                           toast_xml += LR"(<action activationType="background" )";
-                           if (b.context_menu)
-                           {
-                               toast_xml += LR"(placement="contextMenu" )";
-                           }
-                           toast_xml += LR"(arguments=")";
-                           toast_xml += L"button_id=" + std::to_wstring(i); // pass the button ID
-                           toast_xml += L"&amp;handler=";
-                           toast_xml += background_handler_id;
-                           toast_xml += LR"(" content=")";
-                           toast_xml += b.label;
-                           toast_xml += LR"(" />)";
-                       },
-                       [&](const snooze_button& b) {
-                           const bool has_durations = !b.durations.empty() && size(b.durations) <= 5;
-                           std::wstring selection_id = L"snoozeTime";
-                           selection_id += static_cast<wchar_t>(L'0' + i);
-                           toast_xml += LR"(<action activationType="system" arguments="snooze" )";
-                           if (has_durations)
-                           {
-                               toast_xml += LR"(hint-inputId=")";
-                               toast_xml += selection_id;
-                               toast_xml += '"';
-                           }
-                           toast_xml += LR"( content=")";
-                           toast_xml += b.snooze_button_title;
-                           toast_xml += LR"(" />)";
-                       } },
-                   actions[i]);
-    }
-    toast_xml += L"</actions></toast>";
+            winrt::Windows::Foundation::Collections::StringMap map;
+            if (request.progress_bar.has_value())
+            {
+                float progress = std::clamp(request.progress_bar->progress, 0.0f, 1.0f);
+                map.Insert(L"progressValue", std::to_wstring(progress));
+                map.Insert(L"progressValueString", std::to_wstring(static_cast<int>(progress * 100)) + std::wstring(L"%"));
+                map.Insert(L"progressTitle", request.progress_bar->progress_title);
+            }
+            NotificationData data{ map };
+            notification.Data(std::move(data));
 
-    XmlDocument toast_xml_doc;
-    xml_escape(toast_xml);
-    toast_xml_doc.LoadXml(toast_xml);
-    ToastNotification notification{ toast_xml_doc };
-    notification.Group(DEFAULT_TOAST_GROUP);
+            const auto notifier =
+                ToastNotificationManager::ToastNotificationManager::CreateToastNotifier(APPLICATION_ID);
 
-    winrt::Windows::Foundation::Collections::StringMap map;
-    if (params.progress_bar.has_value())
+            // Set a tag-related params if it has a valid length
+            if (request.tag.has_value() && request.tag->length() < 64)
+            {
+                notification.Tag(*request.tag);
+                if (!request.resend_if_scheduled)
+                {
+                    for (const auto& scheduled_toast : notifier.GetScheduledToastNotifications())
+                    {
+                        if (scheduled_toast.Tag() == *request.tag)
+                        {
+                            return;
+                        }
+                    }
+                }
+            }
+            notifier.Show(notification);
+        }
+    };
+
+    // Whether this code is linked into a DLL, rather than into the executable of the process
+    bool linked_into_dll()
     {
-        float progress = std::clamp(params.progress_bar->progress, 0.0f, 1.0f);
-        map.Insert(L"progressValue", std::to_wstring(progress));
-        map.Insert(L"progressValueString", std::to_wstring(static_cast<int>(progress * 100)) + std::wstring(L"%"));
-        map.Insert(L"progressTitle", params.progress_bar->progress_title);
+        HMODULE module = nullptr;
+        if (!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                                reinterpret_cast<LPCWSTR>(&linked_into_dll),
+                                &module))
+        {
+            return false;
+        }
+        return module != GetModuleHandleW(nullptr);
     }
-    NotificationData data{ map };
-    notification.Data(std::move(data));
 
-    const auto notifier =
-        ToastNotificationManager::ToastNotificationManager::CreateToastNotifier(APPLICATION_ID);
+    notifications::toast_queue& shared_queue();
 
-    // Set a tag-related params if it has a valid length
-    if (params.tag.has_value() && params.tag->length() < 64)
+    // Shows the toasts a module DLL holds once they're due. A thread of the queue could outlive the DLL, but the
+    // callbacks of this thread pool timer keep the DLL loaded while they run, and the timer is closed as the DLL
+    // unloads.
+    class dll_flush_timer
     {
-        notification.Tag(*params.tag);
-        if (!params.resend_if_scheduled)
+    public:
+        dll_flush_timer()
         {
-            for (const auto& scheduled_toast : notifier.GetScheduledToastNotifications())
+            HMODULE module = nullptr;
+            if (!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                                    reinterpret_cast<LPCWSTR>(&on_timer),
+                                    &module))
             {
-                if (scheduled_toast.Tag() == *params.tag)
-                {
-                    return;
-                }
+                return;
             }
+
+            TP_CALLBACK_ENVIRON environment;
+            InitializeThreadpoolEnvironment(&environment);
+            SetThreadpoolCallbackLibrary(&environment, module);
+            m_timer = CreateThreadpoolTimer(&on_timer, this, &environment);
+            DestroyThreadpoolEnvironment(&environment);
         }
-    }
-    try
+
+        ~dll_flush_timer()
+        {
+            if (m_timer)
+            {
+                // No callback can be running: it would hold the DLL loaded. Waiting for them under the loader lock
+                // could deadlock anyway.
+                SetThreadpoolTimer(m_timer, nullptr, 0, 0);
+                CloseThreadpoolTimer(m_timer);
+            }
+        }
+
+        dll_flush_timer(const dll_flush_timer&) = delete;
+        dll_flush_timer& operator=(const dll_flush_timer&) = delete;
+
+        // Fires once at due, unless it's set to fire sooner already
+        void schedule(notifications::toast_queue::clock::time_point due)
+        {
+            if (!m_timer)
+            {
+                return;
+            }
+
+            std::scoped_lock lock{ m_mutex };
+            if (m_due && *m_due <= due)
+            {
+                return;
+            }
+            m_due = due;
+
+            // Relative times are negative, in 100 ns units
+            const auto delay = (std::max)(due - notifications::toast_queue::clock::now(), notifications::toast_queue::clock::duration::zero());
+            const auto ticks = -std::chrono::duration_cast<std::chrono::duration<int64_t, std::ratio<1, 10'000'000>>>(delay).count();
+            ULARGE_INTEGER relative;
+            relative.QuadPart = static_cast<ULONGLONG>(ticks);
+            FILETIME dueTime{ relative.LowPart, relative.HighPart };
+            SetThreadpoolTimer(m_timer, &dueTime, 0, 0);
+        }
+
+    private:
+        static void CALLBACK on_timer(PTP_CALLBACK_INSTANCE, PVOID context, PTP_TIMER)
+        {
+            auto& self = *static_cast<dll_flush_timer*>(context);
+            {
+                std::scoped_lock lock{ self.m_mutex };
+                self.m_due.reset();
+            }
+            if (const auto next = shared_queue().flush())
+            {
+                self.schedule(*next);
+            }
+        }
+
+        PTP_TIMER m_timer = nullptr;
+        std::mutex m_mutex;
+        std::optional<notifications::toast_queue::clock::time_point> m_due;
+    };
+
+    notifications::toast_queue& shared_queue()
     {
-        notifier.Show(notification);
+        // Never destroyed, since a DLL can't join a thread while unloading. A module DLL gets no thread of the queue
+        // and flushes it from a timer instead, destroyed with the DLL.
+        static auto* delivery = new notification_center_delivery;
+        static auto* queue = [] {
+            notifications::toast_queue_options options;
+            if (linked_into_dll())
+            {
+                static dll_flush_timer timer;
+                options.flush_thread = false;
+                options.schedule_flush = [](auto due) { timer.schedule(due); };
+            }
+            return new notifications::toast_queue{ *delivery, std::move(options) };
+        }();
+        return *queue;
     }
-    catch (...)
+}
+
+void notifications::show_toast_with_activations(std::wstring message,
+                                                std::wstring title,
+                                                std::wstring_view background_handler_id,
+                                                std::vector<action_t> actions,
+                                                toast_params params)
+{
+    queued_toast toast{ .module_name = std::wstring{ params.module_name },
+                        .title = std::move(title),
+                        .message = std::move(message),
+                        .background_handler_id = std::wstring{ background_handler_id },
+                        .actions = std::move(actions),
+                        .resend_if_scheduled = params.resend_if_scheduled,
+                        .progress_bar = std::move(params.progress_bar) };
+    if (params.tag.has_value())
     {
+        toast.tag.emplace(*params.tag);
     }
+    shared_queue().submit(std::move(toast));
 }
 
 void notifications::update_toast_progress_bar(std::wstring_view tag, progress_bar_params params)
@@ -347,6 +349,8 @@ void notifications::update_toast_progress_bar(std::wstring_view tag, progress_ba
 
 void notifications::remove_toasts_by_tag(std::wstring_view tag)
 {
+    shared_queue().remove(tag);
+
     using namespace winrt::Windows::System;
     try
     {
@@ -10,6 +10,8 @@ namespace notifications
 {
     constexpr inline const wchar_t TOAST_ACTIVATED_LAUNCH_ARG[] = L"-ToastActivated";
     constexpr inline const wchar_t UPDATING_PROCESS_TOAST_TAG[] = L"PTUpdateNotifyTag";
+    // The module name of the toasts of the runner
+    constexpr inline const wchar_t RUNNER_TOAST_MODULE_NAME[] = L"PowerToys";
 
     void override_application_id(const std::wstring_view appID);
     void run_desktop_app_activator_loop();
@@ -51,6 +53,8 @@ namespace notifications
         std::optional<std::wstring_view> tag;
         bool resend_if_scheduled = true;
         std::optional<progress_bar_params> progress_bar;
+        // Toasts are rate limited per module. The ones without a module share the limit of the process.
+        std::wstring_view module_name;
     };
 
     using action_t = std::variant<link_button, background_activated_button, snooze_button>;
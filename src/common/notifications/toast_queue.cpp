@@ -0,0 +1,281 @@
+#include "pch.h"
+#include "toast_queue.h"
+#include "toast_xml.h"
+
+#include <algorithm>
+
+namespace notifications
+{
+    namespace // Strings in this namespace should not be localized
+    {
+        const wchar_t SUMMARY_TAG_PREFIX[] = L"PTSummary";
+
+        // The same for each summary of the toasts of a module with this title, so that the next one replaces it.
+        // Hashed, since longer tags than 63 characters aren't accepted by the notification center.
+        std::wstring summary_tag(std::wstring_view module_name, std::wstring_view title)
+        {
+            std::wstring key{ module_name };
+            key += L'\n';
+            key += title;
+            return SUMMARY_TAG_PREFIX + std::to_wstring(std::hash<std::wstring>{}(key));
+        }
+    }
+
+    void recording_toast_delivery::show(const toast_delivery_request& request)
+    {
+        std::scoped_lock lock{ m_mutex };
+        m_delivered.push_back(request);
+    }
+
+    std::vector<toast_delivery_request> recording_toast_delivery::delivered() const
+    {
+        std::scoped_lock lock{ m_mutex };
+        return m_delivered;
+    }
+
+    toast_queue::toast_queue(toast_delivery& delivery, toast_queue_options options, clock_source now) :
+        m_delivery{ delivery }, m_options{ std::move(options) }, m_now{ std::move(now) }
+    {
+        m_options.burst = (std::max)(m_options.burst, 1u);
+        m_options.refill_interval = (std::max)(m_options.refill_interval, std::chrono::milliseconds{ 1 });
+        m_options.max_held = (std::max)(m_options.max_held, size_t{ 1 });
+    }
+
+    toast_queue::~toast_queue()
+    {
+        {
+            std::scoped_lock lock{ m_mutex };
+            m_stopping = true;
+        }
+        m_wake.notify_all();
+        if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+    }
+
+    void toast_queue::refill(module_bucket& bucket, clock::time_point now) const
+    {
+        if (now <= bucket.refilled)
+        {
+            return;
+        }
+
+        const auto earned = (now - bucket.refilled) / m_options.refill_interval;
+        if (earned >= static_cast<int64_t>(m_options.burst - bucket.tokens))
+        {
+            bucket.tokens = m_options.burst;
+            bucket.refilled = now;
+        }
+        else
+        {
+            // Keeps the time spent toward the next token
+            bucket.tokens += static_cast<unsigned>(earned);
+            bucket.refilled += earned * m_options.refill_interval;
+        }
+    }
+
+    bool toast_queue::prepare(const queued_toast& toast, clock::time_point now, std::vector<toast_delivery_request>& requests)
+    {
+        auto xml = render_toast_xml(toast.title, toast.message, toast.background_handler_id, toast.actions, toast.progress_bar.has_value());
+        if (toast.tag)
+        {
+            auto shown = m_shown.find(*toast.tag);
+            if (shown != m_shown.end() && shown->second.xml == xml && now - shown->second.time < m_options.dedup_window)
+            {
+                return false;
+            }
+            m_shown.insert_or_assign(*toast.tag, shown_toast{ xml, now });
+        }
+        requests.push_back({ std::move(xml), toast.tag, toast.resend_if_scheduled, toast.progress_bar });
+        return true;
+    }
+
+    void toast_queue::release_held(module_bucket& bucket, clock::time_point now, std::vector<toast_delivery_request>& requests)
+    {
+        size_t released = 0;
+        for (; released < bucket.held.size() && bucket.tokens > 0; ++released)
+        {
+            auto& [toast, count] = bucket.held[released];
+            if (count > 1)
+            {
+                if (!toast.tag)
+                {
+                    toast.tag = summary_tag(toast.module_name, toast.title);
+                }
+                toast.title += L" (" + std::to_wstring(count) + L")";
+            }
+            if (prepare(toast, now, requests))
+            {
+                --bucket.tokens;
+            }
+        }
+        bucket.held.erase(bucket.held.begin(), bucket.held.begin() + released);
+    }
+
+    std::optional<toast_queue::clock::time_point> toast_queue::collect_due(clock::time_point now, std::vector<toast_delivery_request>& requests)
+    {
+        std::optional<clock::time_point> next;
+        for (auto& [module_name, bucket] : m_buckets)
+        {
+            if (bucket.held.empty())
+            {
+                continue;
+            }
+
+            refill(bucket, now);
+            release_held(bucket, now, requests);
+            if (!bucket.held.empty())
+            {
+                const auto due = bucket.refilled + m_options.refill_interval;
+                next = next ? (std::min)(*next, due) : due;
+            }
+        }
+
+        // What was shown before the window can be shown again
+        std::erase_if(m_shown, [&](const auto& shown) { return now - shown.second.time >= m_options.dedup_window; });
+        return next;
+    }
+
+    toast_submit_result toast_queue::submit(queued_toast toast)
+    {
+        std::vector<toast_delivery_request> requests;
+        toast_submit_result result{};
+        std::optional<clock::time_point> flush_due;
+        {
+            std::scoped_lock lock{ m_mutex };
+            const auto now = m_now();
+            collect_due(now, requests);
+
+            auto found = m_buckets.find(toast.module_name);
+            if (found == m_buckets.end())
+            {
+                module_bucket added;
+                added.tokens = m_options.burst;
+                added.refilled = now;
+                found = m_buckets.emplace(toast.module_name, std::move(added)).first;
+            }
+            auto& bucket = found->second;
+            refill(bucket, now);
+
+            auto held = std::find_if(bucket.held.begin(), bucket.held.end(), [&](const held_toast& other) {
+                return (toast.tag && other.toast.tag == toast.tag) || other.toast.title == toast.title;
+            });
+            if (held != bucket.held.end())
+            {
+                // A toast with the same tag is an update of the held one, not another toast to count
+                const bool replaced = toast.tag && held->toast.tag == toast.tag;
+                const size_t count = replaced ? held->count : held->count + 1;
+
+                // Moved to the end, as the newest
+                bucket.held.erase(held);
+                bucket.held.push_back({ std::move(toast), count });
+                result = toast_submit_result::held;
+            }
+            else if (toast.progress_bar || (bucket.held.empty() && bucket.tokens > 0))
+            {
+                if (!prepare(toast, now, requests))
+                {
+                    result = toast_submit_result::duplicate;
+                }
+                else
+                {
+                    if (!toast.progress_bar)
+                    {
+                        --bucket.tokens;
+                    }
+                    result = toast_submit_result::shown;
+                }
+            }
+            else
+            {
+                bucket.held.push_back({ std::move(toast) });
+                if (bucket.held.size() > m_options.max_held)
+                {
+                    bucket.held.erase(bucket.held.begin());
+                }
+                result = toast_submit_result::held;
+            }
+
+            if (result == toast_submit_result::held && m_options.flush_thread)
+            {
+                if (!m_thread.joinable())
+                {
+                    m_thread = std::thread([this] { run(); });
+                }
+                m_wake.notify_all();
+            }
+            else if (result == toast_submit_result::held && m_options.schedule_flush)
+            {
+                flush_due = bucket.refilled + m_options.refill_interval;
+            }
+        }
+
+        deliver(requests);
+        if (flush_due)
+        {
+            m_options.schedule_flush(*flush_due);
+        }
+        return result;
+    }
+
+    void toast_queue::remove(std::wstring_view tag)
+    {
+        std::scoped_lock lock{ m_mutex };
+        for (auto& [module_name, bucket] : m_buckets)
+        {
+            std::erase_if(bucket.held, [&](const held_toast& held) { return held.toast.tag == tag; });
+        }
+        if (auto shown = m_shown.find(tag); shown != m_shown.end())
+        {
+            m_shown.erase(shown);
+        }
+    }
+
+    std::optional<toast_queue::clock::time_point> toast_queue::flush()
+    {
+        std::vector<toast_delivery_request> requests;
+        std::optional<clock::time_point> next;
+        {
+            std::scoped_lock lock{ m_mutex };
+            next = collect_due(m_now(), requests);
+        }
+        deliver(requests);
+        return next;
+    }
+
+    void toast_queue::deliver(const std::vector<toast_delivery_request>& requests)
+    {
+        for (const auto& request : requests)
+        {
+            m_delivery.show(request);
+        }
+    }
+
+    void toast_queue::run()
+    {
+        std::unique_lock lock{ m_mutex };
+        while (!m_stopping)
+        {
+            std::vector<toast_delivery_request> requests;
+            const auto next = collect_due(m_now(), requests);
+            if (!requests.empty())
+            {
+                lock.unlock();
+                deliver(requests);
+                lock.lock();
+                continue;
+            }
+
+            // Woken up early by a newly held toast, which may be due sooner
+            if (next)
+            {
+                m_wake.wait_until(lock, *next);
+            }
+            else
+            {
+                m_wake.wait(lock);
+            }
+        }
+    }
+}
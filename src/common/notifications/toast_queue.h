@@ -0,0 +1,155 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "notifications.h"
+
+namespace notifications
+{
+    // A toast ready to be shown, rendered already
+    struct toast_delivery_request
+    {
+        std::wstring xml;
+        std::optional<std::wstring> tag;
+        bool resend_if_scheduled = true;
+        std::optional<progress_bar_params> progress_bar;
+    };
+
+    // Where toasts end up: the notification center, or memory in tests
+    class toast_delivery
+    {
+    public:
+        virtual ~toast_delivery() = default;
+
+        virtual void show(const toast_delivery_request& request) = 0;
+    };
+
+    // Keeps the toasts instead of showing them
+    class recording_toast_delivery : public toast_delivery
+    {
+    public:
+        void show(const toast_delivery_request& request) override;
+
+        std::vector<toast_delivery_request> delivered() const;
+
+    private:
+        mutable std::mutex m_mutex;
+        std::vector<toast_delivery_request> m_delivered;
+    };
+
+    struct queued_toast
+    {
+        // Toasts are rate limited per module
+        std::wstring module_name;
+        std::wstring title;
+        std::wstring message;
+        std::wstring background_handler_id;
+        std::vector<action_t> actions;
+        std::optional<std::wstring> tag;
+        bool resend_if_scheduled = true;
+        std::optional<progress_bar_params> progress_bar;
+    };
+
+    struct toast_queue_options
+    {
+        // A module can show this many toasts at once, then one more per refill interval
+        unsigned burst = 3;
+        std::chrono::milliseconds refill_interval = std::chrono::seconds{ 20 };
+        // A toast identical to the last one shown with its tag during this time isn't shown again
+        std::chrono::milliseconds dedup_window = std::chrono::seconds{ 10 };
+        // The oldest held toasts beyond this number are dropped
+        size_t max_held = 16;
+        // Shows the held toasts from a thread of the queue once they're due. Without it, only flush does.
+        bool flush_thread = true;
+        // Without the thread, called with when the held toasts are due each time a toast is held, so that flush can
+        // be called then by other means
+        std::function<void(std::chrono::steady_clock::time_point due)> schedule_flush;
+    };
+
+    enum class toast_submit_result
+    {
+        shown,
+        // Shown later, maybe merged with others
+        held,
+        duplicate,
+    };
+
+    // Shows toasts without flooding the notification center when a module keeps failing. Each module has a token
+    // bucket: a toast submitted without a token left is held, and the held toasts are shown oldest first as tokens
+    // come back. A toast with the tag of a held one replaces it, and one with its title is merged with it into a
+    // summary: the newest of them, with their count in its title. One identical to the last toast shown with its
+    // tag is dropped. Toasts with a progress bar are shown right away, since they're updated in place by tag
+    // afterwards.
+    class toast_queue
+    {
+    public:
+        using clock = std::chrono::steady_clock;
+        using clock_source = std::function<clock::time_point()>;
+
+        toast_queue(toast_delivery& delivery, toast_queue_options options = {}, clock_source now = &clock::now);
+        ~toast_queue();
+
+        toast_queue(const toast_queue&) = delete;
+        toast_queue& operator=(const toast_queue&) = delete;
+
+        toast_submit_result submit(queued_toast toast);
+
+        // Drops the held toasts with the tag, and forgets the last one shown so that it can be shown again
+        void remove(std::wstring_view tag);
+
+        // Shows the held toasts that are due, and returns when the next ones are
+        std::optional<clock::time_point> flush();
+
+    private:
+        struct held_toast
+        {
+            queued_toast toast;
+            // How many toasts with its title were merged into it
+            size_t count = 1;
+        };
+
+        struct module_bucket
+        {
+            unsigned tokens = 0;
+            clock::time_point refilled;
+            std::vector<held_toast> held;
+        };
+
+        struct shown_toast
+        {
+            std::wstring xml;
+            clock::time_point time;
+        };
+
+        void refill(module_bucket& bucket, clock::time_point now) const;
+        // Renders the toast, remembers it by tag and adds it to the requests to deliver, unless it's a duplicate
+        bool prepare(const queued_toast& toast, clock::time_point now, std::vector<toast_delivery_request>& requests);
+        // Shows the held toasts while there are tokens left
+        void release_held(module_bucket& bucket, clock::time_point now, std::vector<toast_delivery_request>& requests);
+        std::optional<clock::time_point> collect_due(clock::time_point now, std::vector<toast_delivery_request>& requests);
+        void deliver(const std::vector<toast_delivery_request>& requests);
+        void run();
+
+        toast_delivery& m_delivery;
+        toast_queue_options m_options;
+        clock_source m_now;
+
+        std::mutex m_mutex;
+        std::map<std::wstring, module_bucket, std::less<>> m_buckets;
+        std::map<std::wstring, shown_toast, std::less<>> m_shown;
+
+        // Started when a toast is first held
+        std::thread m_thread;
+        std::condition_variable m_wake;
+        bool m_stopping = false;
+    };
+}
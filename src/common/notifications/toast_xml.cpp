@@ -0,0 +1,212 @@
+#include "pch.h"
+#include "toast_xml.h"
+
+#include <algorithm>
+
+namespace notifications
+{
+    namespace
+    {
+        template<class... Ts>
+        struct overloaded : Ts...
+        {
+            using Ts::operator()...;
+        };
+
+        template<class... Ts>
+        overloaded(Ts...) -> overloaded<Ts...>;
+    }
+
+    namespace // Strings in this namespace should not be localized
+    {
+        // DO NOT LOCALIZE any of these, because they're XML tags and a subject to
+        // https://learn.microsoft.com/windows/uwp/design/shell/tiles-and-notifications/toast-xml-schema
+
+        // We must set toast's title and contents immediately, because some of the toasts we send could be snoozed.
+        // Windows instantiates the snoozed toast from scratch before showing it again, so all bindings that were set
+        // using NotificationData would be empty.
+        const toast_template TOAST_BEGIN{ LR"(<?xml version="1.0"?><toast><visual><binding template="ToastGeneric">)"
+                                          LR"(<text id="1">{title}</text><text id="2">{message}</text>)",
+                                          { L"title", L"message" } };
+        const toast_template PROGRESS_BAR{ LR"(<progress title="{progressTitle}" value="{progressValue}" valueStringOverride="{progressValueString}" status="" />)", {} };
+        const toast_template ACTIONS_BEGIN{ L"</binding></visual><actions>", {} };
+        const toast_template TOAST_END{ L"</actions></toast>", {} };
+
+        const toast_template SNOOZE_INPUT_BEGIN{ LR"(<input id="{id}" type="selection" defaultInput="{default}">)", { L"id", L"default" } };
+        const toast_template SNOOZE_INPUT_WITH_TITLE_BEGIN{ LR"(<input id="{id}" type="selection" defaultInput="{default}" title="{title}">)", { L"id", L"default", L"title" } };
+        const toast_template SNOOZE_SELECTION{ LR"(<selection id="{id}" content="{content}"/>)", { L"id", L"content" } };
+        const toast_template SNOOZE_INPUT_END{ L"</input>", {} };
+
+        const toast_template LINK_ACTION{ LR"(<action activationType="protocol" arguments="{url}" content="{label}" />)", { L"url", L"label" } };
+        const toast_template LINK_MENU_ACTION{ LR"(<action activationType="protocol" placement="contextMenu" arguments="{url}" content="{label}" />)", { L"url", L"label" } };
+        const toast_template BACKGROUND_ACTION{ LR"(<action activationType="background" arguments="button_id={id}&amp;handler={handler}" content="{label}" />)", { L"id", L"handler", L"label" } };
+        const toast_template BACKGROUND_MENU_ACTION{ LR"(<action activationType="background" placement="contextMenu" arguments="button_id={id}&amp;handler={handler}" content="{label}" />)", { L"id", L"handler", L"label" } };
+        const toast_template SNOOZE_ACTION{ LR"(<action activationType="system" arguments="snooze" content="{label}" />)", { L"label" } };
+        const toast_template SNOOZE_INPUT_ACTION{ LR"(<action activationType="system" arguments="snooze" hint-inputId="{input}" content="{label}" />)", { L"input", L"label" } };
+
+        // The selection box is only shown for up to 5 durations
+        bool has_durations(const snooze_button& button)
+        {
+            return !button.durations.empty() && size(button.durations) <= 5;
+        }
+
+        std::wstring snooze_input_id(size_t index)
+        {
+            std::wstring id = L"snoozeTime";
+            id += static_cast<wchar_t>(L'0' + index);
+            return id;
+        }
+    }
+
+    void append_xml_escaped(std::wstring& output, std::wstring_view text)
+    {
+        for (const wchar_t c : text)
+        {
+            switch (c)
+            {
+            case L'&':
+                output += L"&amp;";
+                break;
+            case L'\"':
+                output += L"&quot;";
+                break;
+            case L'\'':
+                output += L"&apos;";
+                break;
+            case L'<':
+                output += L"&lt;";
+                break;
+            case L'>':
+                output += L"&gt;";
+                break;
+            default:
+                output += c;
+                break;
+            }
+        }
+    }
+
+    toast_template::toast_template(std::wstring_view pattern, std::initializer_list<std::wstring_view> fields)
+    {
+        auto append_text = [this](std::wstring_view text) {
+            if (text.empty())
+            {
+                return;
+            }
+            if (m_segments.empty() || m_segments.back().field != TEXT)
+            {
+                m_segments.push_back({});
+            }
+            m_segments.back().text += text;
+            m_text_size += text.size();
+        };
+
+        size_t position = 0;
+        while (position < pattern.size())
+        {
+            const size_t open = pattern.find(L'{', position);
+            const size_t close = open == std::wstring_view::npos ? open : pattern.find(L'}', open);
+            if (close == std::wstring_view::npos)
+            {
+                break;
+            }
+
+            const auto name = pattern.substr(open + 1, close - open - 1);
+            const auto field = std::find(fields.begin(), fields.end(), name);
+            if (field == fields.end())
+            {
+                append_text(pattern.substr(position, close + 1 - position));
+            }
+            else
+            {
+                append_text(pattern.substr(position, open - position));
+                m_segments.push_back({ {}, static_cast<size_t>(field - fields.begin()) });
+            }
+            position = close + 1;
+        }
+        append_text(pattern.substr((std::min)(position, pattern.size())));
+    }
+
+    void toast_template::render(std::wstring& output, std::initializer_list<std::wstring_view> values) const
+    {
+        output.reserve(output.size() + m_text_size);
+        for (const auto& piece : m_segments)
+        {
+            if (piece.field == TEXT)
+            {
+                output += piece.text;
+            }
+            else if (piece.field < values.size())
+            {
+                append_xml_escaped(output, values.begin()[piece.field]);
+            }
+        }
+    }
+
+    std::wstring render_toast_xml(std::wstring_view title,
+                                  std::wstring_view message,
+                                  std::wstring_view background_handler_id,
+                                  const std::vector<action_t>& actions,
+                                  bool progress_bar)
+    {
+        std::wstring xml;
+        xml.reserve(2048);
+
+        TOAST_BEGIN.render(xml, { title, message });
+        if (progress_bar)
+        {
+            PROGRESS_BAR.render(xml);
+        }
+        ACTIONS_BEGIN.render(xml);
+
+        // The inputs go before all the actions
+        for (size_t i = 0; i < size(actions); ++i)
+        {
+            const auto* button = std::get_if<snooze_button>(&actions[i]);
+            if (!button || !has_durations(*button))
+            {
+                continue;
+            }
+
+            const auto id = snooze_input_id(i);
+            const auto default_minutes = std::to_wstring(button->durations[0].minutes);
+            if (button->snooze_title.empty())
+            {
+                SNOOZE_INPUT_BEGIN.render(xml, { id, default_minutes });
+            }
+            else
+            {
+                SNOOZE_INPUT_WITH_TITLE_BEGIN.render(xml, { id, default_minutes, button->snooze_title });
+            }
+            for (const auto& duration : button->durations)
+            {
+                SNOOZE_SELECTION.render(xml, { std::to_wstring(duration.minutes), duration.label });
+            }
+            SNOOZE_INPUT_END.render(xml);
+        }
+
+        for (size_t i = 0; i < size(actions); ++i)
+        {
+            std::visit(overloaded{
+                           [&](const link_button& b) {
+                               (b.context_menu ? LINK_MENU_ACTION : LINK_ACTION).render(xml, { b.url, b.label });
+                           },
+                           [&](const background_activated_button& b) {
+                               (b.context_menu ? BACKGROUND_MENU_ACTION : BACKGROUND_ACTION).render(xml, { std::to_wstring(i), background_handler_id, b.label });
+                           },
+                           [&](const snooze_button& b) {
+                               if (has_durations(b))
+                               {
+                                   SNOOZE_INPUT_ACTION.render(xml, { snooze_input_id(i), b.snooze_button_title });
+                               }
+                               else
+                               {
+                                   SNOOZE_ACTION.render(xml, { b.snooze_button_title });
+                               }
+                           } },
+                       actions[i]);
+        }
+        TOAST_END.render(xml);
+        return xml;
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "notifications.h"
+
+namespace notifications
+{
+    // Appends text with the characters XML gives a meaning to escaped, for element contents and attribute values
+    void append_xml_escaped(std::wstring& output, std::wstring_view text);
+
+    // A piece of toast XML with {name} fields, split into text and fields once so that rendering only appends.
+    // Braces around anything else than a field are kept, like the {progressValue} bindings of NotificationData.
+    class toast_template
+    {
+    public:
+        toast_template(std::wstring_view pattern, std::initializer_list<std::wstring_view> fields);
+
+        // Appends the pattern with the values escaped, in the order of the fields. Missing values are empty.
+        void render(std::wstring& output, std::initializer_list<std::wstring_view> values = {}) const;
+
+    private:
+        static constexpr size_t TEXT = static_cast<size_t>(-1);
+
+        struct segment
+        {
+            std::wstring text;
+            // Index of the field, or TEXT
+            size_t field = TEXT;
+        };
+
+        std::vector<segment> m_segments;
+        size_t m_text_size = 0;
+    };
+
+    // The XML of a toast with a title, a message and actions, and bindings for a progress bar if it has one
+    std::wstring render_toast_xml(std::wstring_view title,
+                                  std::wstring_view message,
+                                  std::wstring_view background_handler_id,
+                                  const std::vector<action_t>& actions,
+                                  bool progress_bar);
+}
@@ -0,0 +1,406 @@
+#include "pch.h"
+#include "chunkedDownload.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace updating
+{
+    namespace // Strings in this namespace should not be localized
+    {
+        const wchar_t PARTIAL_DOWNLOAD_EXTENSION[] = L".partial";
+        const wchar_t DOWNLOAD_JOURNAL_EXTENSION[] = L".progress";
+        const char NO_DIGEST[] = "-";
+
+        // Read back and hashed in pieces of at most this size
+        const size_t HASH_BUFFER_SIZE = 1024 * 1024;
+
+        // What's on disk of a download: which chunks of which file
+        struct download_journal
+        {
+            uint64_t size = 0;
+            uint64_t chunk_size = 0;
+            std::string digest;
+            // '1' for each chunk on disk, '0' for the others
+            std::string chunks;
+        };
+
+        std::optional<download_journal> read_journal(const std::filesystem::path& path)
+        {
+            std::ifstream file{ path };
+            download_journal journal;
+            std::string size, chunk_size, digest, chunks;
+            if (!(file >> size >> journal.size >> chunk_size >> journal.chunk_size >> digest >> journal.digest >> chunks >> journal.chunks) ||
+                size != "size" || chunk_size != "chunk" || digest != "sha256" || chunks != "chunks")
+            {
+                return std::nullopt;
+            }
+            return journal;
+        }
+
+        // Replaces the journal at once, so that it's never found half written
+        bool write_journal(const std::filesystem::path& path, const download_journal& journal)
+        {
+            auto temporary = path;
+            temporary += L".tmp";
+            {
+                std::ofstream file{ temporary, std::ios::trunc };
+                file << "size " << journal.size << "\nchunk " << journal.chunk_size << "\nsha256 " << journal.digest << "\nchunks " << journal.chunks << "\n";
+                if (!file.flush())
+                {
+                    return false;
+                }
+            }
+
+            std::error_code error;
+            std::filesystem::rename(temporary, path, error);
+            return !error;
+        }
+
+        std::string digest_string(const std::optional<sha256_digest>& digest)
+        {
+            if (!digest)
+            {
+                return NO_DIGEST;
+            }
+            const auto hex = sha256_to_hex(*digest);
+            return { hex.begin(), hex.end() };
+        }
+
+        // Starts a download over, with an empty partial file of the full size
+        bool start_download(const std::filesystem::path& partial, const std::filesystem::path& journal_path, const download_journal& journal)
+        {
+            {
+                std::ofstream file{ partial, std::ios::binary | std::ios::trunc };
+                if (!file)
+                {
+                    return false;
+                }
+            }
+
+            std::error_code error;
+            std::filesystem::resize_file(partial, journal.size, error);
+            return !error && write_journal(journal_path, journal);
+        }
+
+        // Replaces destination with the downloaded file, or discards it when its digest doesn't match
+        chunked_download_result finish_download(const std::filesystem::path& partial,
+                                                const std::filesystem::path& journal_path,
+                                                const std::filesystem::path& destination,
+                                                bool digest_matches)
+        {
+            std::error_code error;
+            if (!digest_matches)
+            {
+                std::filesystem::remove(partial, error);
+                std::filesystem::remove(journal_path, error);
+                return chunked_download_result::digest_mismatch;
+            }
+
+            std::filesystem::remove(destination, error);
+            std::filesystem::rename(partial, destination, error);
+            if (error)
+            {
+                return chunked_download_result::file_error;
+            }
+            std::filesystem::remove(journal_path, error);
+            return chunked_download_result::success;
+        }
+
+        // The whole file in a single request, hashed once it's on disk. Nothing is kept for the next attempt.
+        chunked_download_result download_whole(range_transport& transport,
+                                               const std::filesystem::path& destination,
+                                               const std::optional<sha256_digest>& expected_digest,
+                                               const chunked_download_options& options)
+        {
+            if (options.cancellation.stop_requested())
+            {
+                return chunked_download_result::cancelled;
+            }
+
+            const auto partial = partial_download_path(destination);
+            const auto journal_path = download_journal_path(destination);
+            std::error_code error;
+            // The chunks of an earlier download can't be completed by this one
+            std::filesystem::remove(journal_path, error);
+
+            bool downloaded = false;
+            try
+            {
+                downloaded = transport.download(partial);
+            }
+            catch (...)
+            {
+                downloaded = false;
+            }
+            if (!downloaded)
+            {
+                std::filesystem::remove(partial, error);
+                return chunked_download_result::network_error;
+            }
+
+            const auto size = std::filesystem::file_size(partial, error);
+            if (error)
+            {
+                return chunked_download_result::file_error;
+            }
+
+            sha256_hasher hasher;
+            {
+                std::ifstream file{ partial, std::ios::binary };
+                std::vector<char> buffer(HASH_BUFFER_SIZE);
+                while (file)
+                {
+                    file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                    hasher.update(buffer.data(), static_cast<size_t>(file.gcount()));
+                }
+                if (!file.eof() || file.bad())
+                {
+                    return chunked_download_result::file_error;
+                }
+            }
+            if (options.progress)
+            {
+                options.progress(size, size);
+            }
+            return finish_download(partial, journal_path, destination, !expected_digest || hasher.finish() == *expected_digest);
+        }
+    }
+
+    std::filesystem::path partial_download_path(const std::filesystem::path& destination)
+    {
+        auto path = destination;
+        return path += PARTIAL_DOWNLOAD_EXTENSION;
+    }
+
+    std::filesystem::path download_journal_path(const std::filesystem::path& destination)
+    {
+        auto path = destination;
+        return path += DOWNLOAD_JOURNAL_EXTENSION;
+    }
+
+    chunked_download_result download_in_chunks(range_transport& transport,
+                                               const std::filesystem::path& destination,
+                                               const std::optional<sha256_digest>& expected_digest,
+                                               const chunked_download_options& options)
+    {
+        std::optional<uint64_t> total;
+        if (!transport.content_length(total))
+        {
+            return chunked_download_result::network_error;
+        }
+        if (!total)
+        {
+            return download_whole(transport, destination, expected_digest, options);
+        }
+
+        const uint64_t chunk_size = (std::max)(options.chunk_size, uint64_t{ 1 });
+        const size_t chunk_count = static_cast<size_t>((*total + chunk_size - 1) / chunk_size);
+        const auto partial = partial_download_path(destination);
+        const auto journal_path = download_journal_path(destination);
+
+        download_journal journal{ *total, chunk_size, digest_string(expected_digest), std::string(chunk_count, '0') };
+        std::error_code error;
+        const auto previous = read_journal(journal_path);
+        const bool resumed = previous && previous->size == journal.size && previous->chunk_size == journal.chunk_size &&
+                             previous->digest == journal.digest && previous->chunks.size() == chunk_count &&
+                             std::filesystem::file_size(partial, error) == *total && !error;
+        if (resumed)
+        {
+            journal.chunks = previous->chunks;
+        }
+        else if (!start_download(partial, journal_path, journal))
+        {
+            return chunked_download_result::file_error;
+        }
+
+        auto chunk_length = [&](size_t chunk) {
+            return (std::min)(chunk_size, *total - chunk * chunk_size);
+        };
+
+        std::vector<size_t> missing;
+        uint64_t downloaded = 0;
+        for (size_t chunk = 0; chunk < chunk_count; ++chunk)
+        {
+            if (journal.chunks[chunk] == '1')
+            {
+                downloaded += chunk_length(chunk);
+            }
+            else
+            {
+                missing.push_back(chunk);
+            }
+        }
+        if (options.progress)
+        {
+            options.progress(downloaded, *total);
+        }
+
+        std::mutex mutex;
+        std::condition_variable chunk_written;
+        std::optional<chunked_download_result> failure;
+        std::atomic<bool> stopped = false;
+        auto fail = [&](chunked_download_result result) {
+            {
+                std::scoped_lock lock{ mutex };
+                if (!failure)
+                {
+                    failure = result;
+                }
+                stopped = true;
+            }
+            chunk_written.notify_all();
+        };
+        // Called right away when cancelled already
+        std::stop_callback on_cancel{ options.cancellation, [&] { fail(chunked_download_result::cancelled); } };
+
+        std::atomic<size_t> next_missing = 0;
+        auto download_chunks = [&] {
+            std::fstream file{ partial, std::ios::binary | std::ios::in | std::ios::out };
+            if (!file)
+            {
+                fail(chunked_download_result::file_error);
+                return;
+            }
+
+            std::vector<uint8_t> buffer;
+            while (!stopped)
+            {
+                const size_t index = next_missing++;
+                if (index >= missing.size())
+                {
+                    break;
+                }
+
+                const size_t chunk = missing[index];
+                const uint64_t offset = chunk * chunk_size;
+                const uint64_t length = chunk_length(chunk);
+                buffer.reserve(static_cast<size_t>(length));
+
+                bool fetched = false;
+                for (unsigned attempt = 0; !fetched && !stopped && transport.serves_ranges() && attempt < (std::max)(options.attempts_per_chunk, 1u); ++attempt)
+                {
+                    if (attempt > 0 && options.retry_delay.count() > 0)
+                    {
+                        // Woken up by a cancellation
+                        std::unique_lock lock{ mutex };
+                        if (chunk_written.wait_for(lock, options.retry_delay * (1 << (attempt - 1)), [&] { return stopped.load(); }))
+                        {
+                            break;
+                        }
+                    }
+
+                    buffer.clear();
+                    try
+                    {
+                        fetched = transport.fetch(offset, length, [&](const uint8_t* data, size_t size) {
+                            if (stopped || buffer.size() + size > length)
+                            {
+                                return false;
+                            }
+                            buffer.insert(buffer.end(), data, data + size);
+                            return true;
+                        });
+                    }
+                    catch (...)
+                    {
+                        fetched = false;
+                    }
+                    fetched = fetched && buffer.size() == length;
+                }
+                if (!fetched)
+                {
+                    fail(chunked_download_result::network_error);
+                    return;
+                }
+
+                file.seekp(static_cast<std::streamoff>(offset));
+                file.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+                if (!file.flush())
+                {
+                    fail(chunked_download_result::file_error);
+                    return;
+                }
+
+                uint64_t progress = 0;
+                {
+                    std::scoped_lock lock{ mutex };
+                    journal.chunks[chunk] = '1';
+                    progress = downloaded += length;
+                    if (!write_journal(journal_path, journal))
+                    {
+                        failure = failure.value_or(chunked_download_result::file_error);
+                        stopped = true;
+                    }
+                }
+                chunk_written.notify_all();
+                if (options.progress)
+                {
+                    options.progress(progress, *total);
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        const size_t thread_count = (std::min)(static_cast<size_t>((std::max)(options.parallel_chunks, 1u)), missing.size());
+        for (size_t i = 0; i < thread_count; ++i)
+        {
+            threads.emplace_back(download_chunks);
+        }
+
+        // Hash the chunks in order as they land on disk, from the file since that's what will be installed
+        sha256_hasher hasher;
+        {
+            std::ifstream file;
+            file.rdbuf()->pubsetbuf(nullptr, 0);
+            file.open(partial, std::ios::binary);
+            std::vector<char> buffer(static_cast<size_t>((std::min)(uint64_t{ HASH_BUFFER_SIZE }, (std::max)(*total, uint64_t{ 1 }))));
+            for (size_t chunk = 0; chunk < chunk_count && file; ++chunk)
+            {
+                {
+                    std::unique_lock lock{ mutex };
+                    chunk_written.wait(lock, [&] { return journal.chunks[chunk] == '1' || stopped; });
+                    if (journal.chunks[chunk] != '1')
+                    {
+                        break;
+                    }
+                }
+
+                file.seekg(static_cast<std::streamoff>(chunk * chunk_size));
+                for (uint64_t left = chunk_length(chunk); left > 0 && file;)
+                {
+                    const size_t size = static_cast<size_t>((std::min)(left, uint64_t{ buffer.size() }));
+                    file.read(buffer.data(), static_cast<std::streamsize>(size));
+                    hasher.update(buffer.data(), size);
+                    left -= size;
+                }
+            }
+            if (!file)
+            {
+                fail(chunked_download_result::file_error);
+            }
+        }
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+        if (failure == chunked_download_result::network_error && !transport.serves_ranges())
+        {
+            return download_whole(transport, destination, expected_digest, options);
+        }
+        if (failure)
+        {
+            // What's on disk is kept for the next attempt
+            return *failure;
+        }
+
+        return finish_download(partial, journal_path, destination, !expected_digest || hasher.finish() == *expected_digest);
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <stop_token>
+
+#include "sha256.h"
+
+namespace updating
+{
+    // A source of byte ranges of a file, used from several threads at once
+    class range_transport
+    {
+    public:
+        virtual ~range_transport() = default;
+
+        // Asks for the size of the file. Returns false if the request failed; length is nullopt when the server
+        // answered without giving the size.
+        virtual bool content_length(std::optional<uint64_t>& length) = 0;
+
+        // Passes the bytes in [offset, offset + length) to sink in order, as they arrive. Returns false if the
+        // transfer failed or sink returned false, in which case the range is fetched again from its start.
+        virtual bool fetch(uint64_t offset, uint64_t length, const std::function<bool(const uint8_t* data, size_t size)>& sink) = 0;
+
+        // False once the server answered a range request with the whole file
+        virtual bool serves_ranges() = 0;
+
+        // Downloads the whole file to path in a single request, for servers that don't give its size or don't serve
+        // ranges. Returns false on failure.
+        virtual bool download(const std::filesystem::path& path) = 0;
+    };
+
+    struct chunked_download_options
+    {
+        uint64_t chunk_size = 4 * 1024 * 1024;
+        unsigned parallel_chunks = 4;
+        unsigned attempts_per_chunk = 3;
+        // Waited before the second attempt at a chunk, twice as long before the third and so on
+        std::chrono::milliseconds retry_delay{ 500 };
+        // Called with the bytes downloaded and the size of the file, from any of the download threads
+        std::function<void(uint64_t downloaded, uint64_t total)> progress;
+        // Stops the download as soon as possible, keeping what's on disk for the next one
+        std::stop_token cancellation;
+    };
+
+    enum class chunked_download_result
+    {
+        success,
+        network_error,
+        file_error,
+        digest_mismatch,
+        cancelled,
+    };
+
+    // Downloads a file in chunks fetched in parallel, each retried on its own, into a partial file next to
+    // destination. A journal of the chunks on disk is kept along, so that a download interrupted even by a restart
+    // continues where it stopped. The chunks are hashed in order while the next ones download, and the file only
+    // replaces destination once its SHA-256 matches expected_digest, when there's one. A mismatch discards the
+    // partial file. When the server doesn't give the size of the file or doesn't serve ranges, the file is
+    // downloaded whole instead, and verified the same way. Failing to ask for the size is a network error.
+    chunked_download_result download_in_chunks(range_transport& transport,
+                                               const std::filesystem::path& destination,
+                                               const std::optional<sha256_digest>& expected_digest,
+                                               const chunked_download_options& options = {});
+
+    // The partial file and journal of a download to destination
+    std::filesystem::path partial_download_path(const std::filesystem::path& destination);
+    std::filesystem::path download_journal_path(const std::filesystem::path& destination);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace updating
+{
+    using sha256_digest = std::array<uint8_t, 32>;
+
+    // SHA-256 (FIPS 180-4) of data fed in pieces of any size
+    class sha256_hasher
+    {
+    public:
+        sha256_hasher() noexcept;
+
+        void update(const void* data, size_t size) noexcept;
+        // The digest of everything fed so far. The hasher can't be fed anymore.
+        sha256_digest finish() noexcept;
+
+    private:
+        void compress(const uint8_t* block) noexcept;
+
+        std::array<uint32_t, 8> m_state;
+        std::array<uint8_t, 64> m_block{};
+        size_t m_blockSize = 0;
+        uint64_t m_length = 0;
+    };
+
+    // Parses 64 hex digits, like the "sha256:" digests of GitHub release assets
+    std::optional<sha256_digest> sha256_from_hex(std::wstring_view hex);
+    std::wstring sha256_to_hex(const sha256_digest& digest);
+}
@@ -0,0 +1,335 @@
+#include "pch.h"
+#include "updatePipeline.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <vector>
+
+namespace updating
+{
+    namespace // Strings in this namespace should not be localized
+    {
+        const wchar_t CHECK_FAILED[] = L"The releases couldn't be read";
+        const wchar_t FOLDER_FAILED[] = L"The updates folder couldn't be created";
+        const wchar_t NETWORK_FAILED[] = L"The installer couldn't be downloaded";
+        const wchar_t FILE_FAILED[] = L"The installer couldn't be written";
+        const wchar_t DIGEST_MISMATCH[] = L"The installer doesn't match its published digest";
+        const wchar_t INSTALLER_MISSING[] = L"The installer is missing";
+        const wchar_t LAUNCH_FAILED[] = L"The installer couldn't be started";
+
+        // Read and hashed in pieces of this size when verifying
+        const size_t VERIFY_BUFFER_SIZE = 1024 * 1024;
+
+        // Bytes per second since the first measure
+        class throughput_meter
+        {
+        public:
+            double bytes_per_second(uint64_t done)
+            {
+                const auto now = std::chrono::steady_clock::now();
+                if (!m_baseline || done < *m_baseline)
+                {
+                    m_baseline = done;
+                    m_start = now;
+                    return 0;
+                }
+
+                const double seconds = std::chrono::duration<double>(now - m_start).count();
+                return seconds > 0 ? static_cast<double>(done - *m_baseline) / seconds : 0;
+            }
+
+        private:
+            std::optional<uint64_t> m_baseline;
+            std::chrono::steady_clock::time_point m_start;
+        };
+
+        std::wstring widen(const char* message)
+        {
+            return { message, message + std::strlen(message) };
+        }
+
+        void reset_download(UpdateState& state)
+        {
+            state.state = UpdateState::errorDownloading;
+            state.downloadedInstallerFilename = {};
+            state.stage = UpdateState::notStarted;
+        }
+    }
+
+    update_pipeline::update_pipeline(update_host& host, event_handler on_event, update_pipeline_options options) :
+        m_host{ host }, m_on_event{ std::move(on_event) }, m_options{ std::move(options) }
+    {
+    }
+
+    void update_pipeline::emit(const update_event& event)
+    {
+        if (m_on_event)
+        {
+            std::scoped_lock lock{ m_event_mutex };
+            m_on_event(event);
+        }
+    }
+
+    update_pipeline::stage_result update_pipeline::finish(update_stage stage, stage_result result, std::wstring reason)
+    {
+        switch (result)
+        {
+        case stage_result::completed:
+            emit(stage_completed{ stage });
+            break;
+        case stage_result::failed:
+            emit(stage_failed{ stage, std::move(reason) });
+            break;
+        case stage_result::cancelled:
+            emit(stage_cancelled{ stage });
+            break;
+        }
+        return result;
+    }
+
+    update_pipeline_result update_pipeline::run(std::stop_token cancellation)
+    {
+        const auto previous = m_host.read_state();
+        m_verified_while_downloading = false;
+
+        emit(stage_started{ update_stage::check });
+        if (cancellation.stop_requested())
+        {
+            finish(update_stage::check, stage_result::cancelled);
+            return update_pipeline_result::cancelled;
+        }
+
+        std::optional<update_release> release;
+        try
+        {
+            release = m_host.check();
+        }
+        catch (const std::exception& e)
+        {
+            finish(update_stage::check, stage_result::failed, widen(e.what()));
+            return update_pipeline_result::failed;
+        }
+        catch (...)
+        {
+            finish(update_stage::check, stage_result::failed, CHECK_FAILED);
+            return update_pipeline_result::failed;
+        }
+
+        if (!release)
+        {
+            m_host.store_state([](UpdateState& state) {
+                state.state = UpdateState::upToDate;
+                state.githubUpdateLastCheckedDate.emplace(std::time(nullptr));
+                state.downloadedInstallerFilename = {};
+                state.stage = UpdateState::checked;
+            });
+            finish(update_stage::check, stage_result::completed);
+            return update_pipeline_result::up_to_date;
+        }
+
+        m_installer = m_host.updates_folder() / release->installer_filename;
+        std::error_code error;
+        const bool downloaded = previous.downloadedInstallerFilename == release->installer_filename &&
+                                previous.stage >= UpdateState::downloaded && std::filesystem::is_regular_file(m_installer, error);
+        m_host.store_state([&](UpdateState& state) {
+            state.githubUpdateLastCheckedDate.emplace(std::time(nullptr));
+            if (!downloaded)
+            {
+                state.state = UpdateState::readyToDownload;
+                state.downloadedInstallerFilename = {};
+                state.stage = UpdateState::checked;
+            }
+        });
+        finish(update_stage::check, stage_result::completed);
+
+        // An installer downloaded by an earlier run isn't downloaded again, but verified again
+        stage_result result = downloaded ? stage_result::completed : download(*release, cancellation);
+        if (result == stage_result::completed)
+        {
+            result = verify(*release, cancellation);
+        }
+        if (result == stage_result::completed)
+        {
+            result = stage();
+        }
+        if (result != stage_result::completed)
+        {
+            return result == stage_result::cancelled ? update_pipeline_result::cancelled : update_pipeline_result::failed;
+        }
+
+        if (!m_options.launch)
+        {
+            return update_pipeline_result::staged;
+        }
+
+        emit(stage_started{ update_stage::launch });
+        if (cancellation.stop_requested())
+        {
+            finish(update_stage::launch, stage_result::cancelled);
+            return update_pipeline_result::cancelled;
+        }
+        if (!m_host.launch(m_installer))
+        {
+            // Still staged, for the next attempt
+            finish(update_stage::launch, stage_result::failed, LAUNCH_FAILED);
+            return update_pipeline_result::failed;
+        }
+        m_host.store_state([](UpdateState& state) { state.stage = UpdateState::launched; });
+        finish(update_stage::launch, stage_result::completed);
+        return update_pipeline_result::launched;
+    }
+
+    update_pipeline::stage_result update_pipeline::download(const update_release& release, std::stop_token cancellation)
+    {
+        emit(stage_started{ update_stage::download });
+
+        std::error_code error;
+        std::filesystem::create_directories(m_installer.parent_path(), error);
+        if (error)
+        {
+            m_host.store_state(reset_download);
+            return finish(update_stage::download, stage_result::failed, FOLDER_FAILED);
+        }
+
+        // The download threads report in any order, so that only the progress past the last one reported is
+        // passed on. Each attempt starts from what's on disk.
+        std::mutex progress_mutex;
+        throughput_meter meter;
+        std::optional<uint64_t> reported;
+        auto options = m_options.download;
+        options.cancellation = cancellation;
+        options.progress = [&](uint64_t done, uint64_t total) {
+            std::scoped_lock lock{ progress_mutex };
+            if (reported && done <= *reported)
+            {
+                return;
+            }
+            reported = done;
+            emit(stage_progress{ update_stage::download, done, total, meter.bytes_per_second(done) });
+        };
+
+        auto result = chunked_download_result::network_error;
+        for (unsigned attempt = 0; attempt < (std::max)(m_options.download_attempts, 1u); ++attempt)
+        {
+            if (cancellation.stop_requested())
+            {
+                result = chunked_download_result::cancelled;
+                break;
+            }
+
+            auto transport = m_host.open_installer(release);
+            if (!transport)
+            {
+                continue;
+            }
+
+            {
+                std::scoped_lock lock{ progress_mutex };
+                reported.reset();
+            }
+            // Continues from the chunks the previous attempts left on disk, or starts over after a digest mismatch
+            result = download_in_chunks(*transport, m_installer, release.installer_sha256, options);
+            if (result == chunked_download_result::success || result == chunked_download_result::cancelled ||
+                result == chunked_download_result::file_error)
+            {
+                break;
+            }
+        }
+
+        switch (result)
+        {
+        case chunked_download_result::success:
+            m_verified_while_downloading = release.installer_sha256.has_value();
+            m_host.store_state([&](UpdateState& state) {
+                state.downloadedInstallerFilename = release.installer_filename;
+                state.stage = UpdateState::downloaded;
+            });
+            return finish(update_stage::download, stage_result::completed);
+        case chunked_download_result::cancelled:
+            return finish(update_stage::download, stage_result::cancelled);
+        case chunked_download_result::file_error:
+            m_host.store_state(reset_download);
+            return finish(update_stage::download, stage_result::failed, FILE_FAILED);
+        case chunked_download_result::digest_mismatch:
+            m_host.store_state(reset_download);
+            return finish(update_stage::download, stage_result::failed, DIGEST_MISMATCH);
+        default:
+            m_host.store_state(reset_download);
+            return finish(update_stage::download, stage_result::failed, NETWORK_FAILED);
+        }
+    }
+
+    update_pipeline::stage_result update_pipeline::verify(const update_release& release, std::stop_token cancellation)
+    {
+        emit(stage_started{ update_stage::verify });
+
+        std::error_code error;
+        const auto size = std::filesystem::file_size(m_installer, error);
+        if (error || size == 0)
+        {
+            m_host.store_state(reset_download);
+            return finish(update_stage::verify, stage_result::failed, INSTALLER_MISSING);
+        }
+
+        // Hashed already if it was downloaded by this run, and nothing to hash against without a digest
+        if (!m_verified_while_downloading && release.installer_sha256)
+        {
+            std::ifstream file{ m_installer, std::ios::binary };
+            std::vector<char> buffer(static_cast<size_t>((std::min)(uint64_t{ VERIFY_BUFFER_SIZE }, size)));
+            sha256_hasher hasher;
+            throughput_meter meter;
+            meter.bytes_per_second(0);
+            uint64_t done = 0;
+            while (done < size && file)
+            {
+                if (cancellation.stop_requested())
+                {
+                    return finish(update_stage::verify, stage_result::cancelled);
+                }
+
+                const size_t length = static_cast<size_t>((std::min)(uint64_t{ buffer.size() }, size - done));
+                file.read(buffer.data(), static_cast<std::streamsize>(length));
+                hasher.update(buffer.data(), static_cast<size_t>(file.gcount()));
+                done += static_cast<uint64_t>(file.gcount());
+                emit(stage_progress{ update_stage::verify, done, size, meter.bytes_per_second(done) });
+            }
+            file.close();
+
+            if (done != size || hasher.finish() != *release.installer_sha256)
+            {
+                std::filesystem::remove(m_installer, error);
+                m_host.store_state(reset_download);
+                return finish(update_stage::verify, stage_result::failed, DIGEST_MISMATCH);
+            }
+        }
+
+        m_host.store_state([](UpdateState& state) { state.stage = UpdateState::verified; });
+        return finish(update_stage::verify, stage_result::completed);
+    }
+
+    update_pipeline::stage_result update_pipeline::stage()
+    {
+        emit(stage_started{ update_stage::stage });
+
+        // The installer is left alone in the folder, without the other installers and partial downloads
+        std::error_code error;
+        for (std::filesystem::directory_iterator entry{ m_installer.parent_path(), error }, end; !error && entry != end; entry.increment(error))
+        {
+            std::error_code ignored;
+            if (entry->path().filename() != m_installer.filename() && entry->is_regular_file(ignored))
+            {
+                std::filesystem::remove(entry->path(), ignored);
+            }
+        }
+
+        m_host.store_state([&](UpdateState& state) {
+            state.state = UpdateState::readyToInstall;
+            state.downloadedInstallerFilename = m_installer.filename().wstring();
+            state.stage = UpdateState::staged;
+        });
+        return finish(update_stage::stage, stage_result::completed);
+    }
+}
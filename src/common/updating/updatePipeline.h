@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <variant>
+
+#include "chunkedDownload.h"
+#include "sha256.h"
+#include "updateState.h"
+
+namespace updating
+{
+    enum class update_stage
+    {
+        check,
+        download,
+        verify,
+        stage,
+        launch,
+    };
+
+    // A release newer than the installed version
+    struct update_release
+    {
+        std::wstring version;
+        std::wstring installer_filename;
+        // Published along with the installer by recent releases
+        std::optional<sha256_digest> installer_sha256;
+    };
+
+    // Each stage that runs reports stage_started, any number of stage_progress, then one of stage_completed,
+    // stage_failed or stage_cancelled
+    struct stage_started
+    {
+        update_stage stage;
+    };
+    struct stage_progress
+    {
+        update_stage stage;
+        uint64_t done = 0;
+        uint64_t total = 0;
+        // Since the stage started, not counting what was already done before
+        double bytes_per_second = 0;
+    };
+    struct stage_completed
+    {
+        update_stage stage;
+    };
+    struct stage_failed
+    {
+        update_stage stage;
+        std::wstring reason;
+    };
+    struct stage_cancelled
+    {
+        update_stage stage;
+    };
+    using update_event = std::variant<stage_started, stage_progress, stage_completed, stage_failed, stage_cancelled>;
+
+    enum class update_pipeline_result
+    {
+        up_to_date,
+        staged,
+        launched,
+        failed,
+        cancelled,
+    };
+
+    // What the pipeline runs against: GitHub, the pending updates folder and UpdateState, or fakes in tests
+    class update_host
+    {
+    public:
+        virtual ~update_host() = default;
+
+        // The release to update to, nullopt when the installed version is the latest. Throws when the releases
+        // can't be read.
+        virtual std::optional<update_release> check() = 0;
+        // The ranges of the installer of release, nullptr on failure
+        virtual std::unique_ptr<range_transport> open_installer(const update_release& release) = 0;
+        virtual std::filesystem::path updates_folder() = 0;
+        // Starts the installer, false if it couldn't
+        virtual bool launch(const std::filesystem::path& installer) = 0;
+
+        virtual UpdateState read_state() = 0;
+        // See UpdateState::store
+        virtual void store_state(const std::function<void(UpdateState&)>& modifier) = 0;
+    };
+
+    struct update_pipeline_options
+    {
+        // Runs the installer once staged
+        bool launch = false;
+        unsigned download_attempts = 3;
+        // Its progress callback and cancellation are set by the pipeline
+        chunked_download_options download;
+    };
+
+    // Updates in stages: check for a release, download its installer, verify it, stage it as the only pending update,
+    // and launch it. Each stage persists its completion to UpdateState, and an installer downloaded by an earlier run
+    // is verified again instead of downloaded. Cancellation is checked between stages and while downloading and
+    // verifying; what's on disk is kept for the next run. Events are delivered one at a time, on the thread of run or
+    // on a download thread.
+    class update_pipeline
+    {
+    public:
+        using event_handler = std::function<void(const update_event&)>;
+
+        update_pipeline(update_host& host, event_handler on_event, update_pipeline_options options = {});
+
+        update_pipeline_result run(std::stop_token cancellation = {});
+
+        // The installer of the release, once downloaded
+        const std::filesystem::path& installer() const { return m_installer; }
+
+    private:
+        enum class stage_result
+        {
+            completed,
+            failed,
+            cancelled,
+        };
+
+        stage_result download(const update_release& release, std::stop_token cancellation);
+        stage_result verify(const update_release& release, std::stop_token cancellation);
+        stage_result stage();
+
+        void emit(const update_event& event);
+        // Reports the end of a stage, and persists a failure
+        stage_result finish(update_stage stage, stage_result result, std::wstring reason = {});
+
+        update_host& m_host;
+        event_handler m_on_event;
+        update_pipeline_options m_options;
+        std::mutex m_event_mutex;
+
+        std::filesystem::path m_installer;
+        // Whether the installer on disk was hashed against the digest while it downloaded in this run
+        bool m_verified_while_downloading = false;
+    };
+}
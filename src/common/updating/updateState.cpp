@@ -1,6 +1,7 @@
 #include "pch.h"
 #include "updateState.h"
 
+#include <common/logger/logger.h>
 #include <common/utils/json.h>
 #include <common/utils/timeutil.h>
 #include <common/version/helper.h>
@@ -12,6 +13,29 @@ namespace
     const wchar_t PERSISTENT_STATE_FILENAME[] = L"\\UpdateState.json";
     const wchar_t UPDATE_STATE_MUTEX[] = L"Local\\PowerToysRunnerUpdateStateMutex";
     const VersionHelper CURRENT_VERSION(VERSION_MAJOR, VERSION_MINOR, VERSION_REVISION);
+
+    // Written next to the file and renamed over it
+    bool write_atomically(const std::wstring& filename, const json::JsonObject& json)
+    {
+        const auto temporary = filename + L".tmp";
+        {
+            std::ofstream file{ temporary, std::ios::binary | std::ios::trunc };
+            file << winrt::to_string(json.Stringify());
+            if (!file.flush())
+            {
+                return false;
+            }
+        }
+
+        std::error_code error;
+        fs::rename(temporary, filename, error);
+        if (error)
+        {
+            fs::remove(temporary, error);
+            return false;
+        }
+        return true;
+    }
 }
 
 UpdateState deserialize(const json::JsonObject& json)
@@ -22,6 +46,7 @@ UpdateState deserialize(const json::JsonObject& json)
     result.releasePageUrl = json.GetNamedString(L"releasePageUrl", L"");
     result.githubUpdateLastCheckedDate = timeutil::from_string(json.GetNamedString(L"githubUpdateLastCheckedDate", L"invalid").c_str());
     result.downloadedInstallerFilename = json.GetNamedString(L"downloadedInstallerFilename", L"");
+    result.stage = static_cast<UpdateState::Stage>(json.GetNamedNumber(L"stage", UpdateState::notStarted));
     return result;
 }
 
@@ -36,6 +61,7 @@ json::JsonObject serialize(const UpdateState& state)
     json.SetNamedValue(L"releasePageUrl", json::value(state.releasePageUrl));
     json.SetNamedValue(L"state", json::value(static_cast<double>(state.state)));
     json.SetNamedValue(L"downloadedInstallerFilename", json::value(state.downloadedInstallerFilename));
+    json.SetNamedValue(L"stage", json::value(static_cast<double>(state.stage)));
 
     json.SetNamedValue(L"updateStateFileVersion", json::value(CURRENT_VERSION.toWstring()));
 
@@ -67,10 +93,11 @@ UpdateState UpdateState::read()
     }
     else
     {
-        std::error_code _;
-        fs::remove(filename, _);
         UpdateState new_state;
-        json::to_file(filename, serialize(new_state));
+        if (!write_atomically(filename, serialize(new_state)))
+        {
+            Logger::error(L"Couldn't reset the update state");
+        }
 
         return new_state;
     }
@@ -92,6 +119,9 @@ void UpdateState::store(std::function<void(UpdateState&)> stateModifier)
         }
         stateModifier(state);
         json.emplace(serialize(state));
-        json::to_file(filename, *json);
+        if (!write_atomically(filename, *json))
+        {
+            Logger::error(L"Couldn't store the update state");
+        }
     }
 }
@@ -3,6 +3,7 @@
 #include <ctime>
 #include <optional>
 #include <functional>
+#include <string>
 
 // All fields must be default-initialized
 struct UpdateState
@@ -18,9 +19,19 @@ struct UpdateState
     std::wstring releasePageUrl;
     std::optional<std::time_t> githubUpdateLastCheckedDate;
     std::wstring downloadedInstallerFilename;
+    // The last stage of the update pipeline completed for downloadedInstallerFilename, see updatePipeline.h
+    enum Stage
+    {
+        notStarted = 0,
+        checked = 1,
+        downloaded = 2,
+        verified = 3,
+        staged = 4,
+        launched = 5
+    } stage = notStarted;
 
     // To prevent concurrent modification of the file, we enforce this interface, which locks the file while
-    // the state_modifier is active.
+    // the state_modifier is active. The file is replaced at once, so that it's never found half written.
     static void store(std::function<void(UpdateState&)> stateModifier);
     static UpdateState read();
 };
\ No newline at end of file
@@ -6,11 +6,15 @@
 #include <common/version/helper.h>
 
 #include "updating.h"
+#include "chunkedDownload.h"
+#include "updatePipeline.h"
 
 #include <common/SettingsAPI/settings_helpers.h>
 #include <common/utils/json.h>
 #include <common/utils/registry.h>
 
+#include <atomic>
+
 using namespace registry::install_scope;
 
 namespace // Strings in this namespace should not be localized
@@ -21,7 +25,199 @@ namespace // Strings in this namespace should not be localized
     const wchar_t LOCAL_BUILD_ERROR[] = L"Local build cannot be updated";
     const wchar_t NETWORK_ERROR[] = L"Network error";
 
-    const size_t MAX_DOWNLOAD_ATTEMPTS = 3;
+    const unsigned MAX_DOWNLOAD_ATTEMPTS = 3;
+    const wchar_t SHA256_DIGEST_PREFIX[] = L"sha256:";
+}
+
+namespace
+{
+    // Ranges of a file over HTTP. The download URLs of GitHub redirect to its storage, so the ranges are requested
+    // from where the first request ended up. A server that doesn't serve ranges gets a single request instead.
+    class http_range_transport : public updating::range_transport
+    {
+    public:
+        explicit http_range_transport(winrt::Windows::Foundation::Uri url) :
+            m_url{ std::move(url) }
+        {
+            m_client.DefaultRequestHeaders().UserAgent().TryParseAdd(http::USER_AGENT);
+        }
+
+        bool content_length(std::optional<uint64_t>& length) override
+        {
+            try
+            {
+                http::HttpRequestMessage request{ http::HttpMethod::Head(), m_url };
+                const auto response = m_client.SendRequestAsync(request).get();
+                (void)response.EnsureSuccessStatusCode();
+                m_url = response.RequestMessage().RequestUri();
+                length.reset();
+                if (const auto contentLength = response.Content().Headers().ContentLength())
+                {
+                    length = contentLength.Value();
+                }
+                return true;
+            }
+            catch (...)
+            {
+                return false;
+            }
+        }
+
+        bool fetch(uint64_t offset, uint64_t length, const std::function<bool(const uint8_t* data, size_t size)>& sink) override
+        {
+            namespace streams = winrt::Windows::Storage::Streams;
+
+            http::HttpRequestMessage request{ http::HttpMethod::Get(), m_url };
+            request.Headers().TryAppendWithoutValidation(L"Range", L"bytes=" + std::to_wstring(offset) + L"-" + std::to_wstring(offset + length - 1));
+            const auto response = m_client.SendRequestAsync(request, http::HttpCompletionOption::ResponseHeadersRead).get();
+            if (response.StatusCode() != http::HttpStatusCode::PartialContent)
+            {
+                if (response.StatusCode() == http::HttpStatusCode::Ok)
+                {
+                    m_serves_ranges = false;
+                }
+                return false;
+            }
+
+            const auto content = response.Content().ReadAsInputStreamAsync().get();
+            streams::Buffer buffer{ 64 * 1024 };
+            for (;;)
+            {
+                const auto read = content.ReadAsync(buffer, buffer.Capacity(), streams::InputStreamOptions::Partial).get();
+                if (read.Length() == 0)
+                {
+                    return true;
+                }
+                if (!sink(read.data(), read.Length()))
+                {
+                    return false;
+                }
+            }
+        }
+
+        bool serves_ranges() override
+        {
+            return m_serves_ranges;
+        }
+
+        bool download(const std::filesystem::path& path) override
+        {
+            try
+            {
+                http::HttpClient client;
+                client.download(m_url, path.wstring()).get();
+                return true;
+            }
+            catch (...)
+            {
+                return false;
+            }
+        }
+
+    private:
+        winrt::Windows::Web::Http::HttpClient m_client;
+        winrt::Windows::Foundation::Uri m_url;
+        std::atomic<bool> m_serves_ranges = true;
+    };
+
+    // The release get_github_version_info_async found, downloaded to the pending updates folder. The installer is
+    // launched by PowerToys.Update, not by the pipeline.
+    class github_update_host : public updating::update_host
+    {
+    public:
+        explicit github_update_host(updating::new_version_download_info new_version) :
+            m_new_version{ std::move(new_version) }
+        {
+        }
+
+        std::optional<updating::update_release> check() override
+        {
+            return updating::update_release{ m_new_version.version.toWstring(), m_new_version.installer_filename, m_new_version.installer_sha256 };
+        }
+
+        std::unique_ptr<updating::range_transport> open_installer(const updating::update_release&) override
+        {
+            return std::make_unique<http_range_transport>(m_new_version.installer_download_url);
+        }
+
+        std::filesystem::path updates_folder() override
+        {
+            return updating::get_pending_updates_path();
+        }
+
+        bool launch(const std::filesystem::path&) override
+        {
+            return false;
+        }
+
+        UpdateState read_state() override
+        {
+            return UpdateState::read();
+        }
+
+        void store_state(const std::function<void(UpdateState&)>& modifier) override
+        {
+            UpdateState::store(modifier);
+        }
+
+    private:
+        updating::new_version_download_info m_new_version;
+    };
+
+    const wchar_t* stage_name(updating::update_stage stage)
+    {
+        switch (stage)
+        {
+        case updating::update_stage::check:
+            return L"check";
+        case updating::update_stage::download:
+            return L"download";
+        case updating::update_stage::verify:
+            return L"verify";
+        case updating::update_stage::stage:
+            return L"stage";
+        default:
+            return L"launch";
+        }
+    }
+
+    // Logs the stages, and the progress of each every tenth of the way
+    class update_event_logger
+    {
+    public:
+        void operator()(const updating::update_event& event)
+        {
+            if (const auto started = std::get_if<updating::stage_started>(&event))
+            {
+                m_logged_tenths = 0;
+                Logger::trace(L"Update stage {} started", stage_name(started->stage));
+            }
+            else if (const auto progress = std::get_if<updating::stage_progress>(&event))
+            {
+                const auto tenths = progress->total ? progress->done * 10 / progress->total : 10;
+                if (tenths > m_logged_tenths)
+                {
+                    m_logged_tenths = tenths;
+                    Logger::trace(L"Update stage {}: {} of {} bytes, {:.0f} KB/s", stage_name(progress->stage), progress->done, progress->total, progress->bytes_per_second / 1024);
+                }
+            }
+            else if (const auto completed = std::get_if<updating::stage_completed>(&event))
+            {
+                Logger::trace(L"Update stage {} completed", stage_name(completed->stage));
+            }
+            else if (const auto failed = std::get_if<updating::stage_failed>(&event))
+            {
+                Logger::warn(L"Update stage {} failed: {}", stage_name(failed->stage), failed->reason);
+            }
+            else if (const auto cancelled = std::get_if<updating::stage_cancelled>(&event))
+            {
+                Logger::info(L"Update stage {} cancelled", stage_name(cancelled->stage));
+            }
+        }
+
+    private:
+        uint64_t m_logged_tenths = 0;
+    };
 }
 
 namespace updating
@@ -43,7 +239,7 @@ namespace updating
         return VersionHelper::fromString(release_object.GetNamedString(L"tag_name"));
     }
 
-    std::pair<Uri, std::wstring> extract_installer_asset_download_info(const json::JsonObject& release_object)
+    std::tuple<Uri, std::wstring, std::optional<sha256_digest>> extract_installer_asset_download_info(const json::JsonObject& release_object)
     {
         const std::wstring_view required_architecture = get_architecture_string(get_current_architecture());
         std::wstring_view required_filename_pattern = updating::INSTALLER_FILENAME_PATTERN;
@@ -70,7 +266,14 @@ namespace updating
                 const bool asset_matched = extension_matched && architecture_matched && filename_matched;
                 if (asset_matched)
                 {
-                    return std::make_pair(Uri{ asset.GetNamedString(L"browser_download_url") }, std::move(filename_lower));
+                    // Like "sha256:0123...", on the assets of recent releases only
+                    const std::wstring digest{ asset.GetNamedString(L"digest", {}) };
+                    std::optional<sha256_digest> installer_sha256;
+                    if (digest.starts_with(SHA256_DIGEST_PREFIX))
+                    {
+                        installer_sha256 = sha256_from_hex(digest.substr(std::size(SHA256_DIGEST_PREFIX) - 1));
+                    }
+                    return { Uri{ asset.GetNamedString(L"browser_download_url") }, std::move(filename_lower), installer_sha256 };
                 }
             }
         }
@@ -130,11 +333,12 @@ namespace updating
                 co_return version_up_to_date{};
             }
 
-            auto [installer_download_url, installer_filename] = extract_installer_asset_download_info(release_object);
+            auto [installer_download_url, installer_filename, installer_sha256] = extract_installer_asset_download_info(release_object);
             co_return new_version_download_info{ extract_release_page_url(release_object),
                                                  std::move(github_version),
                                                  std::move(installer_download_url),
-                                                 std::move(installer_filename) };
+                                                 std::move(installer_filename),
+                                                 installer_sha256 };
         }
         catch (...)
         {
@@ -150,40 +354,35 @@ namespace updating
         return { std::move(path_str) };
     }
 
-    std::optional<std::filesystem::path> create_download_path()
-    {
-        auto installer_download_path = get_pending_updates_path();
-        std::error_code ec;
-        std::filesystem::create_directories(installer_download_path, ec);
-        return !ec ? std::optional{ installer_download_path } : std::nullopt;
-    }
-
-    std::future<std::optional<std::filesystem::path>> download_new_version(const new_version_download_info& new_version)
+    std::future<std::optional<std::filesystem::path>> download_new_version(new_version_download_info new_version,
+                                                                           std::stop_token cancellation,
+                                                                           std::function<void(const update_event&)> on_event)
     {
-        auto installer_download_path = create_download_path();
-        if (!installer_download_path)
+        if (!new_version.installer_sha256)
         {
-            co_return std::nullopt;
+            Logger::warn(L"No digest published for {}, the installer can't be verified", new_version.installer_filename);
         }
 
-        *installer_download_path /= new_version.installer_filename;
+        // The chunks are downloaded with blocking calls
+        co_await winrt::resume_background();
 
-        bool download_success = false;
-        for (size_t i = 0; i < MAX_DOWNLOAD_ATTEMPTS; ++i)
+        github_update_host host{ std::move(new_version) };
+        update_pipeline_options options;
+        options.download_attempts = MAX_DOWNLOAD_ATTEMPTS;
+        update_event_logger log;
+        update_pipeline pipeline{ host, [&](const update_event& event) {
+                                     log(event);
+                                     if (on_event)
+                                     {
+                                         on_event(event);
+                                     }
+                                 },
+                                  options };
+        if (pipeline.run(cancellation) != update_pipeline_result::staged)
         {
-            try
-            {
-                http::HttpClient client;
-                co_await client.download(new_version.installer_download_url, *installer_download_path);
-                download_success = true;
-                break;
-            }
-            catch (...)
-            {
-                // reattempt to download or do nothing
-            }
+            co_return std::nullopt;
         }
-        co_return download_success ? installer_download_path : std::nullopt;
+        co_return pipeline.installer();
     }
 
     void cleanup_updates()
@@ -191,13 +390,14 @@ namespace updating
         auto update_dir = updating::get_pending_updates_path();
         if (std::filesystem::exists(update_dir))
         {
-            // Msi and exe files
+            // Msi and exe files, and partial downloads
             for (const auto& entry : std::filesystem::directory_iterator(update_dir))
             {
                 auto entryPath = entry.path().wstring();
                 std::transform(entryPath.begin(), entryPath.end(), entryPath.begin(), ::towlower);
+                const bool partial_download = entryPath.ends_with(L".partial") || entryPath.ends_with(L".progress") || entryPath.ends_with(L".progress.tmp");
 
-                if (entryPath.ends_with(L".msi") || entryPath.ends_with(L".exe"))
+                if (entryPath.ends_with(L".msi") || entryPath.ends_with(L".exe") || partial_download)
                 {
                     std::error_code err;
                     std::filesystem::remove(entry, err);
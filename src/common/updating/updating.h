@@ -4,12 +4,17 @@
 #include <string>
 #include <future>
 #include <filesystem>
+#include <functional>
+#include <stop_token>
 #include <variant>
 #include <winrt/Windows.Foundation.h>
 #include <expected.hpp>
 
 #include <common/version/helper.h>
 
+#include "sha256.h"
+#include "updatePipeline.h"
+
 namespace updating
 {
     using winrt::Windows::Foundation::Uri;
@@ -22,12 +27,20 @@ namespace updating
         VersionHelper version{ 0, 0, 0 };
         Uri installer_download_url = nullptr;
         std::wstring installer_filename;
+        // Published along with the installer by recent releases
+        std::optional<sha256_digest> installer_sha256;
     };
     using github_version_info = std::variant<new_version_download_info, version_up_to_date>;
 
-    std::future<std::optional<std::filesystem::path>> download_new_version(const new_version_download_info& new_version);
+    // Runs the update pipeline for new_version up to staging its installer, which is returned. The pipeline events
+    // are logged, and passed to on_event.
+    std::future<std::optional<std::filesystem::path>> download_new_version(new_version_download_info new_version,
+                                                                           std::stop_token cancellation = {},
+                                                                           std::function<void(const update_event&)> on_event = {});
     std::filesystem::path get_pending_updates_path();
     std::future<nonstd::expected<github_version_info, std::wstring>> get_github_version_info_async(const bool prerelease = false);
+    // Removes the installers and the partial downloads. The pipeline already leaves only the staged installer when
+    // it stages one.
     void cleanup_updates();
 
     // non-localized
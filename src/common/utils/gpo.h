@@ -1,7 +1,16 @@
 #pragma once
 
 #include <Windows.h>
+
+#include <algorithm>
+#include <cstring>
+#include <cwctype>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace powertoys_gpo {
     enum gpo_rule_configured_t {
@@ -101,103 +110,314 @@ namespace powertoys_gpo {
         return string_value;
     }
 
-    inline gpo_rule_configured_t getConfiguredValue(const std::wstring& registry_value_name)
+    // Contents of a policy registry key
+    struct PolicyKeyContents
+    {
+        // Result of opening the key
+        LSTATUS status = ERROR_FILE_NOT_FOUND;
+        // Values of up to 4 bytes, as reading them into a DWORD gives them. Names are lowercase.
+        std::unordered_map<std::wstring, DWORD> numbers;
+        // REG_SZ values. Names are lowercase.
+        std::unordered_map<std::wstring, std::wstring> strings;
+        std::vector<std::wstring> subkeys;
+    };
+
+    // Registry access of the policy snapshot. An interface so that tests can provide the policies.
+    class PolicyRegistry
     {
-        HKEY key{};
-        DWORD value = 0xFFFFFFFE;
-        DWORD valueSize = sizeof(value);
+    public:
+        virtual ~PolicyRegistry() = default;
+
+        virtual PolicyKeyContents ReadKey(HKEY scope, const std::wstring& path) = 0;
 
-        bool machine_key_found = true;
-        if (auto res = RegOpenKeyExW(POLICIES_SCOPE_MACHINE, POLICIES_PATH.c_str(), 0, KEY_READ, &key); res != ERROR_SUCCESS)
+        // Starts watching the policies of both scopes for changes. Returns false if changes can't be detected.
+        virtual bool WatchChanges() = 0;
+
+        // Whether the policies changed since the last WatchChanges call
+        virtual bool HasChanged() = 0;
+    };
+
+    // Registry value names are case insensitive
+    inline std::wstring policyName(std::wstring name)
+    {
+        for (auto& c : name)
         {
-            machine_key_found = false;
+            c = static_cast<wchar_t>(std::towlower(c));
         }
+        return name;
+    }
 
-        if(machine_key_found)
+    // All the PowerToys policies of the machine and user scopes, read in one pass
+    class PolicySnapshot
+    {
+    public:
+        // Reads the values of the policies key and of its direct subkeys, which hold the policy lists
+        static PolicySnapshot Read(PolicyRegistry& registry, const std::wstring& path)
         {
-            // If the path was found in the machine, we need to check if the value for the policy exists.
-            auto res = RegQueryValueExW(key, registry_value_name.c_str(), nullptr, nullptr, reinterpret_cast<LPBYTE>(&value), &valueSize);
+            PolicySnapshot snapshot;
+            snapshot.machine = ReadScope(registry, POLICIES_SCOPE_MACHINE, path);
+            snapshot.user = ReadScope(registry, POLICIES_SCOPE_USER, path);
+            return snapshot;
+        }
 
-            RegCloseKey(key);
+        // The machine value has precedence over the user value
+        gpo_rule_configured_t ConfiguredValue(const std::wstring& registry_value_name) const
+        {
+            const auto name = policyName(registry_value_name);
+            const DWORD* value = nullptr;
+            if (machine.key.status == ERROR_SUCCESS)
+            {
+                if (auto found = machine.key.numbers.find(name); found != machine.key.numbers.end())
+                {
+                    value = &found->second;
+                }
+            }
+
+            if (!value)
+            {
+                if (user.key.status != ERROR_SUCCESS)
+                {
+                    return user.key.status == ERROR_FILE_NOT_FOUND ? gpo_rule_configured_not_configured : gpo_rule_configured_unavailable;
+                }
+                auto found = user.key.numbers.find(name);
+                if (found == user.key.numbers.end())
+                {
+                    return gpo_rule_configured_not_configured;
+                }
+                value = &found->second;
+            }
 
-            if (res != ERROR_SUCCESS) {
-                // Value not found on the path.
-                machine_key_found=false;
+            switch (*value)
+            {
+            case 0:
+                return gpo_rule_configured_disabled;
+            case 1:
+                return gpo_rule_configured_enabled;
+            default:
+                return gpo_rule_configured_wrong_value;
             }
         }
 
-        if (!machine_key_found)
+        // The user list is only checked if there's no machine list, to not mix the lists
+        std::optional<std::wstring> ListValue(const std::wstring& registry_list_path, const std::wstring& registry_list_value_name) const
         {
-            // If there's no value found on the machine scope, try to get it from the user scope.
-            if (auto res = RegOpenKeyExW(POLICIES_SCOPE_USER, POLICIES_PATH.c_str(), 0, KEY_READ, &key); res != ERROR_SUCCESS)
+            const auto path = policyName(registry_list_path);
+            for (const auto* scope : { &machine, &user })
             {
-                if (res == ERROR_FILE_NOT_FOUND) {
-                    return gpo_rule_configured_not_configured;
+                if (auto list = scope->lists.find(path); list != scope->lists.end())
+                {
+                    if (auto value = list->second.strings.find(policyName(registry_list_value_name)); value != list->second.strings.end())
+                    {
+                        return value->second;
+                    }
+                    return std::nullopt;
                 }
-                return gpo_rule_configured_unavailable;
             }
-            auto res = RegQueryValueExW(key, registry_value_name.c_str(), nullptr, nullptr, reinterpret_cast<LPBYTE>(&value), &valueSize);
-            RegCloseKey(key);
+            return std::nullopt;
+        }
 
-            if (res != ERROR_SUCCESS) {
-                return gpo_rule_configured_not_configured;
+    private:
+        struct Scope
+        {
+            PolicyKeyContents key;
+            // Keyed by full lowercase path
+            std::unordered_map<std::wstring, PolicyKeyContents> lists;
+        };
+
+        Scope machine;
+        Scope user;
+
+        static Scope ReadScope(PolicyRegistry& registry, HKEY scope, const std::wstring& path)
+        {
+            Scope result;
+            result.key = registry.ReadKey(scope, path);
+            for (const auto& subkey : result.key.subkeys)
+            {
+                auto list_path = path + L"\\" + subkey;
+                auto list = registry.ReadKey(scope, list_path);
+                if (list.status == ERROR_SUCCESS)
+                {
+                    result.lists.emplace(policyName(std::move(list_path)), std::move(list));
+                }
             }
+            return result;
+        }
+    };
+
+    // Keeps a PolicySnapshot until the registry reports a change of the policies
+    class PolicySnapshotCache
+    {
+    public:
+        PolicySnapshotCache(std::unique_ptr<PolicyRegistry> registry, std::wstring path) :
+            registry(std::move(registry)), path(std::move(path))
+        {
         }
 
-        switch (value)
+        std::shared_ptr<const PolicySnapshot> current()
         {
-        case 0:
-            return gpo_rule_configured_disabled;
-        case 1:
-            return gpo_rule_configured_enabled;
-        default:
-            return gpo_rule_configured_wrong_value;
+            std::unique_lock lock(mutex);
+            if (!snapshot || !watching || registry->HasChanged())
+            {
+                // Watch before reading, so that a change made while reading triggers another read
+                watching = registry->WatchChanges();
+                snapshot = std::make_shared<const PolicySnapshot>(PolicySnapshot::Read(*registry, path));
+            }
+            return snapshot;
         }
-    }
 
-    inline std::optional<std::wstring> getPolicyListValue(const std::wstring& registry_list_path, const std::wstring& registry_list_value_name)
+    private:
+        std::mutex mutex;
+        std::unique_ptr<PolicyRegistry> registry;
+        std::wstring path;
+        std::shared_ptr<const PolicySnapshot> snapshot;
+        bool watching = false;
+    };
+
+    class Win32PolicyRegistry : public PolicyRegistry
     {
-        // This function returns the value of an entry of an policy list. The user scope is only checked, if the list is not enabled for the machine to not mix the lists.
+    public:
+        Win32PolicyRegistry() :
+            changed(CreateEventW(nullptr, TRUE, FALSE, nullptr))
+        {
+        }
 
-        HKEY key{};
+        ~Win32PolicyRegistry()
+        {
+            CloseWatchedKeys();
+            if (changed)
+            {
+                CloseHandle(changed);
+            }
+        }
 
-        // Try to read from the machine list.
-        bool machine_list_found = false;
-        if (RegOpenKeyExW(POLICIES_SCOPE_MACHINE, registry_list_path.c_str(), 0, KEY_READ, &key) == ERROR_SUCCESS)
+        PolicyKeyContents ReadKey(HKEY scope, const std::wstring& path) override
         {
-            machine_list_found = true;
+            PolicyKeyContents contents;
+            HKEY key{};
+            contents.status = RegOpenKeyExW(scope, path.c_str(), 0, KEY_READ, &key);
+            if (contents.status != ERROR_SUCCESS)
+            {
+                return contents;
+            }
+
+            DWORD max_subkey_length = 0, max_name_length = 0, max_data_size = 0;
+            if (RegQueryInfoKeyW(key, nullptr, nullptr, nullptr, nullptr, &max_subkey_length, nullptr, nullptr, &max_name_length, &max_data_size, nullptr, nullptr) == ERROR_SUCCESS)
+            {
+                std::wstring name((std::max)(max_subkey_length, max_name_length) + 1, L'\0');
+                std::vector<BYTE> data(max_data_size + sizeof(wchar_t));
+                for (DWORD index = 0;; ++index)
+                {
+                    DWORD name_length = static_cast<DWORD>(name.size());
+                    DWORD type = 0;
+                    DWORD data_size = max_data_size;
+                    const auto status = RegEnumValueW(key, index, name.data(), &name_length, nullptr, &type, data.data(), &data_size);
+                    if (status == ERROR_MORE_DATA)
+                    {
+                        // Grew since RegQueryInfoKeyW, which also triggers a change notification
+                        continue;
+                    }
+                    if (status != ERROR_SUCCESS)
+                    {
+                        break;
+                    }
+                    auto value_name = policyName(name.substr(0, name_length));
+                    if (data_size <= sizeof(DWORD))
+                    {
+                        // Same as RegQueryValueExW into a DWORD initialized to 0xFFFFFFFE
+                        DWORD value = 0xFFFFFFFE;
+                        std::memcpy(&value, data.data(), data_size);
+                        contents.numbers.emplace(value_name, value);
+                    }
+                    if (type == REG_SZ && data_size >= sizeof(wchar_t))
+                    {
+                        std::fill(data.begin() + data_size, data.end(), BYTE{ 0 });
+                        contents.strings.emplace(value_name, reinterpret_cast<const wchar_t*>(data.data()));
+                    }
+                }
+                for (DWORD index = 0;; ++index)
+                {
+                    DWORD name_length = static_cast<DWORD>(name.size());
+                    if (RegEnumKeyExW(key, index, name.data(), &name_length, nullptr, nullptr, nullptr, nullptr) != ERROR_SUCCESS)
+                    {
+                        break;
+                    }
+                    contents.subkeys.push_back(name.substr(0, name_length));
+                }
+            }
             RegCloseKey(key);
+            return contents;
+        }
 
-            // If the path exists in the machine registry, we try to read the value.
-            auto regValueData = readRegistryStringValue(POLICIES_SCOPE_MACHINE, registry_list_path, registry_list_value_name);
+        bool WatchChanges() override
+        {
+            if (!changed)
+            {
+                return false;
+            }
+            CloseWatchedKeys();
+            ResetEvent(changed);
 
-            if (regValueData.has_value())
+            // The PowerToys key may not exist yet, watch the policies of all the applications. Without any policy
+            // in the scope, wait for the creation of the policies key instead.
+            bool watching = true;
+            for (auto [scope, key] : { std::pair{ POLICIES_SCOPE_MACHINE, &machine_key }, std::pair{ POLICIES_SCOPE_USER, &user_key } })
             {
-                // Return the value from the machine list.
-                return *regValueData;
+                bool subtree = true;
+                if (RegOpenKeyExW(scope, L"SOFTWARE\\Policies", 0, KEY_NOTIFY, key) != ERROR_SUCCESS)
+                {
+                    subtree = false;
+                    if (RegOpenKeyExW(scope, L"SOFTWARE", 0, KEY_NOTIFY, key) != ERROR_SUCCESS)
+                    {
+                        *key = nullptr;
+                        watching = false;
+                        continue;
+                    }
+                }
+                const DWORD filter = REG_NOTIFY_CHANGE_NAME | REG_NOTIFY_THREAD_AGNOSTIC | (subtree ? REG_NOTIFY_CHANGE_LAST_SET : 0);
+                watching &= RegNotifyChangeKeyValue(*key, subtree, filter, changed, TRUE) == ERROR_SUCCESS;
             }
+            return watching;
         }
 
-        // If no list exists for machine, we try to read from the user list.
-        if (!machine_list_found)
+        bool HasChanged() override
         {
-            if (RegOpenKeyExW(POLICIES_SCOPE_USER, registry_list_path.c_str(), 0, KEY_READ, &key) == ERROR_SUCCESS)
-            {
-                RegCloseKey(key);
+            return WaitForSingleObject(changed, 0) == WAIT_OBJECT_0;
+        }
 
-                // If the path exists in the user registry, we try to read the value.
-                auto regValueData = readRegistryStringValue(POLICIES_SCOPE_USER, registry_list_path, registry_list_value_name);
+    private:
+        HANDLE changed = nullptr;
+        HKEY machine_key = nullptr;
+        HKEY user_key = nullptr;
 
-                if (regValueData.has_value())
+        void CloseWatchedKeys()
+        {
+            for (auto key : { &machine_key, &user_key })
+            {
+                if (*key)
                 {
-                    // Return the value from the user list.
-                    return *regValueData;
+                    RegCloseKey(*key);
+                    *key = nullptr;
                 }
             }
         }
+    };
+
+    // Policies of the process, read again only after they changed
+    inline std::shared_ptr<const PolicySnapshot> currentPolicies()
+    {
+        static PolicySnapshotCache cache(std::make_unique<Win32PolicyRegistry>(), POLICIES_PATH);
+        return cache.current();
+    }
 
-        // No list exists for machine and user, or no value was found in the list, or an error ocurred while reading the value.
-        return std::nullopt;
+    inline gpo_rule_configured_t getConfiguredValue(const std::wstring& registry_value_name)
+    {
+        return currentPolicies()->ConfiguredValue(registry_value_name);
+    }
+
+    inline std::optional<std::wstring> getPolicyListValue(const std::wstring& registry_list_path, const std::wstring& registry_list_value_name)
+    {
+        // This function returns the value of an entry of an policy list. The user scope is only checked, if the list is not enabled for the machine to not mix the lists.
+        return currentPolicies()->ListValue(registry_list_path, registry_list_value_name);
     }
 
     inline gpo_rule_configured_t getUtilityEnabledValue(const std::wstring& utility_name)
@@ -6,12 +6,20 @@
 
 #include <optional>
 #include <fstream>
+#include <string>
 
 namespace json
 {
     using namespace winrt::Windows::Data::Json;
 
-    inline std::optional<JsonObject> from_file(std::wstring_view file_name)
+    // An object read from a file along with the text it was parsed from
+    struct FileContents
+    {
+        JsonObject object;
+        std::wstring text;
+    };
+
+    inline std::optional<FileContents> from_file_with_text(std::wstring_view file_name)
     {
         try
         {
@@ -20,7 +28,9 @@ namespace json
             {
                 using isbi = std::istreambuf_iterator<char>;
                 std::string obj_str{ isbi{ file }, isbi{} };
-                return JsonValue::Parse(winrt::to_hstring(obj_str)).GetObjectW();
+                std::wstring text{ winrt::to_hstring(obj_str) };
+                JsonObject object = JsonValue::Parse(text).GetObjectW();
+                return FileContents{ std::move(object), std::move(text) };
             }
             return std::nullopt;
         }
@@ -30,6 +40,16 @@ namespace json
         }
     }
 
+    inline std::optional<JsonObject> from_file(std::wstring_view file_name)
+    {
+        auto contents = from_file_with_text(file_name);
+        if (!contents)
+        {
+            return std::nullopt;
+        }
+        return std::move(contents->object);
+    }
+
     inline void to_file(std::wstring_view file_name, const JsonObject& obj)
     {
         std::wstring obj_str{ obj.Stringify().c_str() };
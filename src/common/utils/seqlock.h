@@ -0,0 +1,139 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+// Publishes a small trivially copyable value to any number of readers without a lock.
+// A reader copies the value and retries if a write happened in the meantime, so readers never block
+// writers and never see a torn value. Writers are expected to be rare compared to reads; concurrent
+// writers are serialized by spinning on the sequence number.
+template<typename T>
+class SeqLock
+{
+    static_assert(std::is_trivially_copyable_v<T>, "SeqLock value must be trivially copyable");
+
+    static constexpr size_t WordCount = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    using Words = std::array<uint64_t, WordCount>;
+
+    // Odd while a write is in progress. Every completed write advances it by 2.
+    std::atomic<uint64_t> sequence = 0;
+    // The value is stored as relaxed atomic words, so a reader racing with a writer reads stale words instead of
+    // triggering undefined behavior. The sequence check then discards the copy.
+    std::array<std::atomic<uint64_t>, WordCount> storage = {};
+
+    uint64_t BeginWrite() noexcept
+    {
+        uint64_t seq = sequence.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            if ((seq & 1) == 0 && sequence.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire, std::memory_order_relaxed))
+            {
+                break;
+            }
+
+            std::this_thread::yield();
+            seq = sequence.load(std::memory_order_relaxed);
+        }
+
+        std::atomic_thread_fence(std::memory_order_release);
+        return seq;
+    }
+
+    uint64_t EndWrite(const uint64_t seq) noexcept
+    {
+        sequence.store(seq + 2, std::memory_order_release);
+        return (seq + 2) / 2;
+    }
+
+    void Store(const T& value) noexcept
+    {
+        Words words = {};
+        std::memcpy(words.data(), &value, sizeof(T));
+        for (size_t i = 0; i < WordCount; ++i)
+        {
+            storage[i].store(words[i], std::memory_order_relaxed);
+        }
+    }
+
+    T Load() const noexcept
+    {
+        Words words = {};
+        for (size_t i = 0; i < WordCount; ++i)
+        {
+            words[i] = storage[i].load(std::memory_order_relaxed);
+        }
+
+        T value;
+        std::memcpy(&value, words.data(), sizeof(T));
+        return value;
+    }
+
+public:
+    SeqLock() noexcept
+    {
+        Store(T{});
+    }
+
+    explicit SeqLock(const T& value) noexcept
+    {
+        Store(value);
+    }
+
+    SeqLock(const SeqLock&) = delete;
+    SeqLock& operator=(const SeqLock&) = delete;
+
+    // Returns a consistent copy of the value and the version it was published with
+    T Read(uint64_t* version = nullptr) const noexcept
+    {
+        for (;;)
+        {
+            const uint64_t before = sequence.load(std::memory_order_acquire);
+            if (before & 1)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            T value = Load();
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == before)
+            {
+                if (version)
+                {
+                    *version = before / 2;
+                }
+
+                return value;
+            }
+        }
+    }
+
+    // Number of writes completed so far
+    uint64_t Version() const noexcept
+    {
+        return sequence.load(std::memory_order_acquire) / 2;
+    }
+
+    // Replaces the value and returns the version it was published with
+    uint64_t Write(const T& value) noexcept
+    {
+        const uint64_t seq = BeginWrite();
+        Store(value);
+        return EndWrite(seq);
+    }
+
+    // Changes a part of the value without losing a concurrent write to the rest of it
+    template<typename Fn>
+    uint64_t Modify(Fn&& fn) noexcept
+    {
+        const uint64_t seq = BeginWrite();
+        T value = Load();
+        fn(value);
+        Store(value);
+        return EndWrite(seq);
+    }
+};
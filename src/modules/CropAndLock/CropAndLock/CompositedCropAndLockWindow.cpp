@@ -0,0 +1,234 @@
+#include "pch.h"
+#include "CompositedCropAndLockWindow.h"
+#include <common/utils/winapi_error.h>
+
+const std::wstring CompositedCropAndLockWindow::ClassName = L"CropAndLock.CompositedCropAndLockWindow";
+std::once_flag CompositedCropAndLockWindowClassRegistration;
+
+namespace
+{
+    // Out of context events are delivered on the thread that set the hook, which is the UI thread
+    std::vector<std::pair<HWINEVENTHOOK, CompositedCropAndLockWindow*>> sourceWatchers;
+
+    RECT ToRect(CropGeometry::Rect const& rect)
+    {
+        return RECT{ rect.left, rect.top, rect.right, rect.bottom };
+    }
+
+    struct DwmThumbnailApi : ThumbnailApi
+    {
+        Thumbnail Register(Window destination, Window source) override
+        {
+            HTHUMBNAIL thumbnail = nullptr;
+            if (FAILED(DwmRegisterThumbnail(static_cast<HWND>(destination), static_cast<HWND>(source), &thumbnail)))
+            {
+                return nullptr;
+            }
+            return reinterpret_cast<Thumbnail>(thumbnail);
+        }
+
+        void Unregister(Thumbnail thumbnail) override
+        {
+            DwmUnregisterThumbnail(reinterpret_cast<HTHUMBNAIL>(thumbnail));
+        }
+
+        bool Update(Thumbnail thumbnail, ThumbnailProperties const& properties) override
+        {
+            DWM_THUMBNAIL_PROPERTIES dwmProperties = {};
+            if (properties.changed & ThumbnailProperties::Destination)
+            {
+                dwmProperties.dwFlags |= DWM_TNP_RECTDESTINATION;
+                dwmProperties.rcDestination = ToRect(properties.destination);
+            }
+            if (properties.changed & ThumbnailProperties::Source)
+            {
+                dwmProperties.dwFlags |= DWM_TNP_RECTSOURCE;
+                dwmProperties.rcSource = ToRect(properties.source);
+            }
+            if (properties.changed & ThumbnailProperties::Visible)
+            {
+                dwmProperties.dwFlags |= DWM_TNP_VISIBLE;
+                dwmProperties.fVisible = properties.visible;
+            }
+            if (properties.changed & ThumbnailProperties::Opacity)
+            {
+                dwmProperties.dwFlags |= DWM_TNP_OPACITY;
+                dwmProperties.opacity = properties.opacity;
+            }
+            if (properties.changed & ThumbnailProperties::SourceClientAreaOnly)
+            {
+                dwmProperties.dwFlags |= DWM_TNP_SOURCECLIENTAREAONLY;
+                dwmProperties.fSourceClientAreaOnly = properties.sourceClientAreaOnly;
+            }
+            return SUCCEEDED(DwmUpdateThumbnailProperties(reinterpret_cast<HTHUMBNAIL>(thumbnail), &dwmProperties));
+        }
+    };
+}
+
+void CompositedCropAndLockWindow::RegisterWindowClass()
+{
+    auto instance = winrt::check_pointer(GetModuleHandleW(nullptr));
+    WNDCLASSEXW wcex = {};
+    wcex.cbSize = sizeof(wcex);
+    wcex.style = CS_HREDRAW | CS_VREDRAW;
+    wcex.lpfnWndProc = WndProc;
+    wcex.hInstance = instance;
+    wcex.hIcon = LoadIconW(instance, IDI_APPLICATION);
+    wcex.hCursor = LoadCursorW(nullptr, IDC_ARROW);
+    wcex.hbrBackground = static_cast<HBRUSH>(GetStockObject(BLACK_BRUSH));
+    wcex.lpszClassName = ClassName.c_str();
+    wcex.hIconSm = LoadIconW(wcex.hInstance, IDI_APPLICATION);
+    winrt::check_bool(RegisterClassExW(&wcex));
+}
+
+CompositedCropAndLockWindow::CompositedCropAndLockWindow(std::wstring const& titleString, int width, int height)
+{
+    auto instance = winrt::check_pointer(GetModuleHandleW(nullptr));
+
+    std::call_once(CompositedCropAndLockWindowClassRegistration, []() { RegisterWindowClass(); });
+
+    auto exStyle = 0;
+    auto style = WS_OVERLAPPEDWINDOW | WS_CLIPCHILDREN;
+
+    RECT rect = { 0, 0, width, height };
+    winrt::check_bool(AdjustWindowRectEx(&rect, style, false, exStyle));
+    auto adjustedWidth = rect.right - rect.left;
+    auto adjustedHeight = rect.bottom - rect.top;
+
+    winrt::check_bool(CreateWindowExW(exStyle, ClassName.c_str(), titleString.c_str(), style,
+        CW_USEDEFAULT, CW_USEDEFAULT, adjustedWidth, adjustedHeight, nullptr, nullptr, instance, this));
+    WINRT_ASSERT(m_window);
+
+    m_thumbnailApi = std::make_unique<DwmThumbnailApi>();
+    m_compositor = std::make_unique<ThumbnailCompositor>(*m_thumbnailApi, m_window);
+}
+
+CompositedCropAndLockWindow::~CompositedCropAndLockWindow()
+{
+    for (auto const& watched : m_sourceHooks)
+    {
+        UnhookWinEvent(watched.second);
+    }
+    std::erase_if(sourceWatchers, [this](auto const& watcher) { return watcher.second == this; });
+    m_compositor.reset();
+    DestroyWindow(m_window);
+}
+
+LRESULT CompositedCropAndLockWindow::MessageHandler(UINT const message, WPARAM const wparam, LPARAM const lparam)
+{
+    switch (message)
+    {
+    case WM_DESTROY:
+        if (m_closedCallback != nullptr && !m_destroyed)
+        {
+            m_destroyed = true;
+            m_closedCallback(m_window);
+        }
+        break;
+    case WM_SIZE:
+    case WM_SIZING:
+        Layout();
+        break;
+    default:
+        return base_type::MessageHandler(message, wparam, lparam);
+    }
+    return 0;
+}
+
+void CompositedCropAndLockWindow::CropAndLock(HWND windowToCrop, RECT cropRect)
+{
+    // Adjust the crop rect to be in the window space as reported by the DWM
+    RECT windowRect = {};
+    winrt::check_hresult(DwmGetWindowAttribute(windowToCrop, DWMWA_EXTENDED_FRAME_BOUNDS, reinterpret_cast<void*>(&windowRect), sizeof(windowRect)));
+    auto clientRect = ClientAreaInScreenSpace(windowToCrop);
+    auto diffX = clientRect.left - windowRect.left;
+    auto diffY = clientRect.top - windowRect.top;
+    CropGeometry::Rect crop = { cropRect.left + diffX, cropRect.top + diffY, cropRect.right + diffX, cropRect.bottom + diffY };
+
+    if (m_compositor->AddRegion(windowToCrop, crop) == 0)
+    {
+        Logger::error(L"Couldn't register a thumbnail of the window to crop.");
+        return;
+    }
+    WatchSource(windowToCrop);
+    ResizeToContent();
+}
+
+void CompositedCropAndLockWindow::WatchSource(HWND source)
+{
+    if (std::any_of(m_sourceHooks.begin(), m_sourceHooks.end(), [source](auto const& watched) { return watched.first == source; }))
+    {
+        return;
+    }
+
+    DWORD processId = 0;
+    auto threadId = GetWindowThreadProcessId(source, &processId);
+    auto hook = SetWinEventHook(EVENT_OBJECT_DESTROY, EVENT_OBJECT_DESTROY, nullptr, OnWinEvent, processId, threadId, WINEVENT_OUTOFCONTEXT);
+    if (hook == nullptr)
+    {
+        Logger::warn(L"CropAndLock couldn't follow the closing of the cropped window. {}", get_last_error_or_default(GetLastError()));
+        return;
+    }
+    m_sourceHooks.emplace_back(source, hook);
+    sourceWatchers.emplace_back(hook, this);
+}
+
+void CALLBACK CompositedCropAndLockWindow::OnWinEvent(HWINEVENTHOOK hook, DWORD, HWND window, LONG objectId, LONG childId, DWORD, DWORD)
+{
+    if (objectId != OBJID_WINDOW || childId != CHILDID_SELF)
+    {
+        return;
+    }
+
+    auto watcher = std::find_if(sourceWatchers.begin(), sourceWatchers.end(), [hook](auto const& candidate) { return candidate.first == hook; });
+    if (watcher != sourceWatchers.end() && watcher->second->m_compositor->HasSource(window))
+    {
+        watcher->second->OnSourceClosed(window);
+    }
+}
+
+void CompositedCropAndLockWindow::OnSourceClosed(HWND source)
+{
+    m_compositor->RemoveSource(source);
+    auto watched = std::find_if(m_sourceHooks.begin(), m_sourceHooks.end(), [source](auto const& candidate) { return candidate.first == source; });
+    if (watched != m_sourceHooks.end())
+    {
+        UnhookWinEvent(watched->second);
+        std::erase_if(sourceWatchers, [hook = watched->second](auto const& watcher) { return watcher.first == hook; });
+        m_sourceHooks.erase(watched);
+    }
+
+    if (m_compositor->Empty())
+    {
+        // Closed as if by the user, once this event is handled
+        PostMessageW(m_window, WM_CLOSE, 0, 0);
+        return;
+    }
+    ResizeToContent();
+}
+
+void CompositedCropAndLockWindow::ResizeToContent()
+{
+    RECT windowRect = { 0, 0, m_compositor->ContentWidth(), m_compositor->ContentHeight() };
+    auto exStyle = static_cast<DWORD>(GetWindowLongPtrW(m_window, GWL_EXSTYLE));
+    auto style = static_cast<DWORD>(GetWindowLongPtrW(m_window, GWL_STYLE));
+    winrt::check_bool(AdjustWindowRectEx(&windowRect, style, false, exStyle));
+    auto adjustedWidth = windowRect.right - windowRect.left;
+    auto adjustedHeight = windowRect.bottom - windowRect.top;
+
+    // Pushes through WM_SIZE when the size changes, but a region added at the same size has to be pushed here
+    winrt::check_bool(SetWindowPos(m_window, HWND_TOPMOST, 0, 0, adjustedWidth, adjustedHeight, SWP_NOMOVE | SWP_SHOWWINDOW));
+    Layout();
+}
+
+void CompositedCropAndLockWindow::Layout()
+{
+    if (m_compositor == nullptr)
+    {
+        return;
+    }
+
+    RECT clientRect = {};
+    winrt::check_bool(GetClientRect(m_window, &clientRect));
+    m_compositor->Layout(clientRect.right - clientRect.left, clientRect.bottom - clientRect.top);
+}
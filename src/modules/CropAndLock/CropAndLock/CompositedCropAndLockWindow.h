@@ -0,0 +1,37 @@
+#pragma once
+#include <robmikh.common/DesktopWindow.h>
+#include "CropAndLockWindow.h"
+#include "ThumbnailCompositor.h"
+
+// Shows all the thumbnail crops in a single window, instead of a window per crop
+struct CompositedCropAndLockWindow : robmikh::common::desktop::DesktopWindow<CompositedCropAndLockWindow>, CropAndLockWindow
+{
+	static const std::wstring ClassName;
+	CompositedCropAndLockWindow(std::wstring const& titleString, int width, int height);
+	~CompositedCropAndLockWindow() override;
+	LRESULT MessageHandler(UINT const message, WPARAM const wparam, LPARAM const lparam);
+
+	HWND Handle() override { return m_window; }
+	// Adds a region to the ones already shown
+	void CropAndLock(HWND windowToCrop, RECT cropRect) override;
+	void OnClosed(std::function<void(HWND)> callback) override { m_closedCallback = callback; }
+
+private:
+	static void RegisterWindowClass();
+	static void CALLBACK OnWinEvent(HWINEVENTHOOK hook, DWORD event, HWND window, LONG objectId, LONG childId, DWORD eventThread, DWORD eventTime);
+
+	void WatchSource(HWND source);
+	// Drops the regions of a source that was closed, and closes the window once there are none left
+	void OnSourceClosed(HWND source);
+	void ResizeToContent();
+	void Layout();
+
+private:
+	std::unique_ptr<ThumbnailApi> m_thumbnailApi;
+	std::unique_ptr<ThumbnailCompositor> m_compositor;
+	// Destruction of each source, listened to on the thread that created it
+	std::vector<std::pair<HWND, HWINEVENTHOOK>> m_sourceHooks;
+
+	bool m_destroyed = false;
+	std::function<void(HWND)> m_closedCallback;
+};
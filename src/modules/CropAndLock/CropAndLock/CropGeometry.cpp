@@ -0,0 +1,41 @@
+#include "pch.h"
+#include "CropGeometry.h"
+
+namespace CropGeometry
+{
+    int32_t Scale(int32_t value, uint32_t fromDpi, uint32_t toDpi)
+    {
+        if (fromDpi == 0 || fromDpi == toDpi)
+        {
+            return value;
+        }
+
+        // Twice the quotient plus one, halved, so that an exact half rounds up in magnitude
+        const int64_t product = static_cast<int64_t>(value) * toDpi;
+        const int64_t magnitude = ((product < 0 ? -product : product) * 2 + fromDpi) / (int64_t{ fromDpi } * 2);
+        return static_cast<int32_t>(product < 0 ? -magnitude : magnitude);
+    }
+
+    Rect Scale(const Rect& rect, uint32_t fromDpi, uint32_t toDpi)
+    {
+        return {
+            Scale(rect.left, fromDpi, toDpi),
+            Scale(rect.top, fromDpi, toDpi),
+            Scale(rect.right, fromDpi, toDpi),
+            Scale(rect.bottom, fromDpi, toDpi),
+        };
+    }
+
+    Layout ComputeLayout(const Rect& cropInClient, uint32_t cropDpi, const Rect& window, const Rect& client, uint32_t dpi)
+    {
+        Layout layout;
+        layout.crop = Scale(cropInClient, cropDpi, dpi);
+
+        // The frame of the target may have changed since the crop, the crop follows the client area
+        layout.targetOffset = {
+            -(layout.crop.left + client.left - window.left),
+            -(layout.crop.top + client.top - window.top),
+        };
+        return layout;
+    }
+}
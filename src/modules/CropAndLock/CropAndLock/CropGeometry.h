@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+
+// Where the pieces of a reparented crop go, as plain functions of the target window geometry and the DPI, so that
+// the rounding can be tested without windows.
+namespace CropGeometry
+{
+	struct Point
+	{
+		int32_t x = 0;
+		int32_t y = 0;
+
+		bool operator==(const Point&) const = default;
+	};
+
+	struct Rect
+	{
+		int32_t left = 0;
+		int32_t top = 0;
+		int32_t right = 0;
+		int32_t bottom = 0;
+
+		int32_t Width() const { return right - left; }
+		int32_t Height() const { return bottom - top; }
+
+		bool operator==(const Rect&) const = default;
+	};
+
+	struct Layout
+	{
+		// The crop relative to the client area of the target, at the current DPI
+		Rect crop;
+		// Position of the target in the child window, which shows the crop at its origin
+		Point targetOffset;
+
+		bool operator==(const Layout&) const = default;
+	};
+
+	// Rounds to the nearest integer, halves away from zero, like MulDiv
+	int32_t Scale(int32_t value, uint32_t fromDpi, uint32_t toDpi);
+
+	// Scales each edge on its own, so that rects sharing an edge keep sharing it. The size may then differ by one
+	// from the scaled size.
+	Rect Scale(const Rect& rect, uint32_t fromDpi, uint32_t toDpi);
+
+	// cropInClient is relative to the client area of the target at cropDpi. window and client are the window and
+	// client rects of the target in the same coordinates, at dpi.
+	Layout ComputeLayout(const Rect& cropInClient, uint32_t cropDpi, const Rect& window, const Rect& client, uint32_t dpi);
+}
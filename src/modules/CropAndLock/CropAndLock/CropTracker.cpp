@@ -0,0 +1,106 @@
+#include "pch.h"
+#include "CropTracker.h"
+#include <common/utils/winapi_error.h>
+
+namespace
+{
+    // Out of context events are delivered on the thread that set the hook, which is the UI thread
+    std::vector<std::pair<HWINEVENTHOOK, CropTracker*>> trackers;
+
+    CropGeometry::Rect ToRect(RECT const& rect)
+    {
+        return { rect.left, rect.top, rect.right, rect.bottom };
+    }
+}
+
+CropTracker::CropTracker(HWND host, HWND child, HWND target, CropGeometry::Rect cropInClient, uint32_t cropDpi, UINT message) :
+    m_host(host), m_child(child), m_target(target), m_cropInClient(cropInClient), m_cropDpi(cropDpi), m_appliedCrop(cropInClient), m_appliedDpi(cropDpi), m_frameCoalescer(host, message)
+{
+    DWORD processId = 0;
+    auto threadId = GetWindowThreadProcessId(m_target, &processId);
+    m_hook = SetWinEventHook(EVENT_OBJECT_LOCATIONCHANGE, EVENT_OBJECT_LOCATIONCHANGE, nullptr, OnWinEvent, processId, threadId, WINEVENT_OUTOFCONTEXT);
+    if (m_hook)
+    {
+        trackers.emplace_back(m_hook, this);
+    }
+    else
+    {
+        Logger::warn(L"CropAndLock couldn't follow the location of the cropped window. {}", get_last_error_or_default(GetLastError()));
+    }
+}
+
+CropTracker::~CropTracker()
+{
+    if (m_hook)
+    {
+        UnhookWinEvent(m_hook);
+        std::erase_if(trackers, [this](auto const& tracker) { return tracker.second == this; });
+    }
+}
+
+void CALLBACK CropTracker::OnWinEvent(HWINEVENTHOOK hook, DWORD, HWND window, LONG objectId, LONG childId, DWORD, DWORD)
+{
+    if (objectId != OBJID_WINDOW || childId != CHILDID_SELF)
+    {
+        return;
+    }
+
+    for (auto& [trackerHook, tracker] : trackers)
+    {
+        if (trackerHook == hook && tracker->m_target == window)
+        {
+            tracker->m_frameCoalescer.Request();
+        }
+    }
+}
+
+void CropTracker::OnFrame()
+{
+    m_frameCoalescer.Acknowledge();
+    if (IsWindow(m_target))
+    {
+        Update();
+    }
+}
+
+void CropTracker::Update()
+{
+    RECT windowRect = {};
+    if (!GetWindowRect(m_target, &windowRect))
+    {
+        return;
+    }
+    auto clientRect = ClientAreaInScreenSpace(m_target);
+    auto dpi = GetDpiForWindow(m_host);
+    auto layout = CropGeometry::ComputeLayout(m_cropInClient, m_cropDpi, ToRect(windowRect), ToRect(clientRect), dpi);
+
+    // The target may also have moved itself in the child window
+    POINT position = { windowRect.left, windowRect.top };
+    MapWindowPoints(HWND_DESKTOP, m_child, &position, 1);
+    bool resized = layout.crop.Width() != m_appliedCrop.Width() || layout.crop.Height() != m_appliedCrop.Height() || dpi != m_appliedDpi;
+    bool moved = position.x != layout.targetOffset.x || position.y != layout.targetOffset.y;
+    if (!resized && !moved)
+    {
+        return;
+    }
+
+    // The host, the child window and the target each have a different parent, so DeferWindowPos can't move them
+    // together. They're moved without drawing anything instead, and repainted once in place.
+    auto width = layout.crop.Width();
+    auto height = layout.crop.Height();
+    if (resized)
+    {
+        RECT adjustedRect = { 0, 0, width, height };
+        auto exStyle = static_cast<DWORD>(GetWindowLongPtrW(m_host, GWL_EXSTYLE));
+        auto style = static_cast<DWORD>(GetWindowLongPtrW(m_host, GWL_STYLE));
+        winrt::check_bool(AdjustWindowRectExForDpi(&adjustedRect, style, false, exStyle, dpi));
+        SetWindowPos(m_host, nullptr, 0, 0, adjustedRect.right - adjustedRect.left, adjustedRect.bottom - adjustedRect.top, SWP_NOMOVE | SWP_NOZORDER | SWP_NOACTIVATE | SWP_NOREDRAW);
+        SetWindowPos(m_child, nullptr, 0, 0, width, height, SWP_NOMOVE | SWP_NOZORDER | SWP_NOACTIVATE | SWP_NOREDRAW);
+    }
+
+    SetWindowPos(m_target, nullptr, layout.targetOffset.x, layout.targetOffset.y, 0, 0, SWP_NOSIZE | SWP_NOZORDER | SWP_NOACTIVATE | SWP_NOREDRAW);
+    RedrawWindow(m_host, nullptr, nullptr, RDW_INVALIDATE | RDW_ERASE | RDW_FRAME | RDW_ALLCHILDREN);
+
+    m_appliedCrop = layout.crop;
+    m_appliedDpi = dpi;
+}
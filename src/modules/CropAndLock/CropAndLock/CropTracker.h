@@ -0,0 +1,38 @@
+#pragma once
+#include <common/Display/CompositorFrameCoalescer.h>
+#include "CropGeometry.h"
+
+// Keeps a reparented window cropped while it resizes, changes its frame or moves to another DPI. The location changes
+// of the target are the only events listened to, and they're applied at most once per compositor frame.
+class CropTracker
+{
+public:
+	// The host receives message once per frame with changes, and passes it to OnFrame
+	CropTracker(HWND host, HWND child, HWND target, CropGeometry::Rect cropInClient, uint32_t cropDpi, UINT message);
+	CropTracker(const CropTracker&) = delete;
+	CropTracker& operator=(const CropTracker&) = delete;
+	~CropTracker();
+
+	// The DPI of the host changed
+	void OnDpiChanged() { m_frameCoalescer.Request(); }
+	void OnFrame();
+
+private:
+	static void CALLBACK OnWinEvent(HWINEVENTHOOK hook, DWORD event, HWND window, LONG objectId, LONG childId, DWORD eventThread, DWORD eventTime);
+
+	void Update();
+
+private:
+	HWND m_host = nullptr;
+	HWND m_child = nullptr;
+	HWND m_target = nullptr;
+	CropGeometry::Rect m_cropInClient;
+	uint32_t m_cropDpi = 0;
+
+	// What the host and child window are sized for
+	CropGeometry::Rect m_appliedCrop;
+	uint32_t m_appliedDpi = 0;
+
+	CompositorFrameCoalescer m_frameCoalescer;
+	HWINEVENTHOOK m_hook = nullptr;
+};
@@ -75,6 +75,16 @@ LRESULT ReparentCropAndLockWindow::MessageHandler(UINT const message, WPARAM con
         }
         break;
     case WM_DPICHANGED:
+        if (m_cropTracker != nullptr)
+        {
+            m_cropTracker->OnDpiChanged();
+        }
+        break;
+    case WM_CROP_TRACKER_FRAME:
+        if (m_cropTracker != nullptr)
+        {
+            m_cropTracker->OnFrame();
+        }
         break;
     default:
         return base_type::MessageHandler(message, wparam, lparam);
@@ -117,6 +127,11 @@ void ReparentCropAndLockWindow::CropAndLock(HWND windowToCrop, RECT cropRect)
     adjustedCropRect.bottom += diffY;
     cropRect = adjustedCropRect;
 
+    // What the tracker keeps in place when the frame of the target changes
+    auto clientDiffX = clientRect.left - windowRect.left;
+    auto clientDiffY = clientRect.top - windowRect.top;
+    CropGeometry::Rect cropInClient = { cropRect.left - clientDiffX, cropRect.top - clientDiffY, cropRect.right - clientDiffX, cropRect.bottom - clientDiffY };
+
     auto newX = adjustedCropRect.left + windowRect.left;
     auto newY = adjustedCropRect.top + windowRect.top;
 
@@ -150,6 +165,8 @@ void ReparentCropAndLockWindow::CropAndLock(HWND windowToCrop, RECT cropRect)
     {
         MessageBoxW(nullptr, L"CropAndLock couldn't properly reparent the target window. It might not handle reparenting well.", L"CropAndLock", MB_ICONERROR);
     }
+
+    m_cropTracker = std::make_unique<CropTracker>(m_window, m_childWindow->m_window, m_currentTarget, cropInClient, dpi, WM_CROP_TRACKER_FRAME);
 }
 
 void ReparentCropAndLockWindow::Hide()
@@ -160,6 +177,7 @@ void ReparentCropAndLockWindow::Hide()
 
 void ReparentCropAndLockWindow::DisconnectTarget()
 {
+    m_cropTracker.reset();
     if (m_currentTarget != nullptr)
     {
         if (!IsWindow(m_currentTarget))
@@ -2,6 +2,7 @@
 #include <robmikh.common/DesktopWindow.h>
 #include "CropAndLockWindow.h"
 #include "ChildWindow.h"
+#include "CropTracker.h"
 
 struct ReparentCropAndLockWindow : robmikh::common::desktop::DesktopWindow<ReparentCropAndLockWindow>, CropAndLockWindow
 {
@@ -15,6 +16,8 @@ struct ReparentCropAndLockWindow : robmikh::common::desktop::DesktopWindow<Repar
 	void OnClosed(std::function<void(HWND)> callback) override { m_closedCallback = callback; }
 
 private:
+	static constexpr UINT WM_CROP_TRACKER_FRAME = WM_APP;
+
 	static void RegisterWindowClass();
 
 	void Hide();
@@ -25,6 +28,7 @@ private:
 private:
 	HWND m_currentTarget = nullptr;
 	std::unique_ptr<ChildWindow> m_childWindow;
+	std::unique_ptr<CropTracker> m_cropTracker;
 	bool m_destroyed = false;
 	std::function<void(HWND)> m_closedCallback;
 
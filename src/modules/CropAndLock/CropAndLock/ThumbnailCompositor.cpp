@@ -0,0 +1,161 @@
+#include "pch.h"
+#include "ThumbnailCompositor.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    const uint32_t AllProperties = ThumbnailProperties::Destination | ThumbnailProperties::Source | ThumbnailProperties::Visible |
+                                   ThumbnailProperties::Opacity | ThumbnailProperties::SourceClientAreaOnly;
+
+    int32_t Round(double value)
+    {
+        return static_cast<int32_t>(std::llround(value));
+    }
+}
+
+ThumbnailCompositor::ThumbnailCompositor(ThumbnailApi& api, ThumbnailApi::Window destination) :
+    m_api(api), m_destination(destination)
+{
+}
+
+ThumbnailCompositor::~ThumbnailCompositor()
+{
+    for (auto& thumbnail : m_thumbnails)
+    {
+        m_api.Unregister(thumbnail.handle);
+    }
+}
+
+ThumbnailCompositor::RegionId ThumbnailCompositor::AddRegion(ThumbnailApi::Window source, CropGeometry::Rect const& crop)
+{
+    auto shared = std::find_if(m_thumbnails.begin(), m_thumbnails.end(), [&](auto const& thumbnail) {
+        return thumbnail.source == source && thumbnail.crop == crop;
+    });
+    if (shared == m_thumbnails.end())
+    {
+        auto handle = m_api.Register(m_destination, source);
+        if (handle == nullptr)
+        {
+            return 0;
+        }
+
+        SharedThumbnail thumbnail;
+        thumbnail.source = source;
+        thumbnail.crop = crop;
+        thumbnail.handle = handle;
+        m_thumbnails.push_back(thumbnail);
+        shared = m_thumbnails.end() - 1;
+        UpdateContentSize();
+    }
+
+    shared->references++;
+    m_regions.push_back({ ++m_lastId, shared->handle });
+    return m_lastId;
+}
+
+void ThumbnailCompositor::RemoveRegion(RegionId id)
+{
+    auto region = std::find_if(m_regions.begin(), m_regions.end(), [id](auto const& candidate) { return candidate.id == id; });
+    if (region != m_regions.end())
+    {
+        auto thumbnail = region->thumbnail;
+        m_regions.erase(region);
+        Release(thumbnail);
+    }
+}
+
+size_t ThumbnailCompositor::RemoveSource(ThumbnailApi::Window source)
+{
+    size_t removed = 0;
+    for (auto thumbnail = m_thumbnails.begin(); thumbnail != m_thumbnails.end();)
+    {
+        if (thumbnail->source != source)
+        {
+            ++thumbnail;
+            continue;
+        }
+
+        auto handle = thumbnail->handle;
+        removed += std::erase_if(m_regions, [handle](auto const& region) { return region.thumbnail == handle; });
+        m_api.Unregister(handle);
+        thumbnail = m_thumbnails.erase(thumbnail);
+    }
+    UpdateContentSize();
+    return removed;
+}
+
+bool ThumbnailCompositor::HasSource(ThumbnailApi::Window source) const
+{
+    return std::any_of(m_thumbnails.begin(), m_thumbnails.end(), [source](auto const& thumbnail) { return thumbnail.source == source; });
+}
+
+void ThumbnailCompositor::Release(ThumbnailApi::Thumbnail handle)
+{
+    auto thumbnail = std::find_if(m_thumbnails.begin(), m_thumbnails.end(), [handle](auto const& candidate) { return candidate.handle == handle; });
+    if (thumbnail != m_thumbnails.end() && --thumbnail->references == 0)
+    {
+        m_api.Unregister(handle);
+        m_thumbnails.erase(thumbnail);
+        UpdateContentSize();
+    }
+}
+
+void ThumbnailCompositor::UpdateContentSize()
+{
+    m_contentWidth = 0;
+    m_contentHeight = 0;
+    for (auto const& thumbnail : m_thumbnails)
+    {
+        m_contentWidth = (std::max)(m_contentWidth, thumbnail.crop.Width());
+        m_contentHeight += thumbnail.crop.Height();
+    }
+}
+
+void ThumbnailCompositor::Layout(int32_t width, int32_t height)
+{
+    if (m_contentWidth <= 0 || m_contentHeight <= 0)
+    {
+        return;
+    }
+
+    // One scale for all the regions, so that they keep their relative sizes, centered in the client area
+    auto scale = (std::max)(0.0, (std::min)(static_cast<double>(width) / m_contentWidth, static_cast<double>(height) / m_contentHeight));
+    auto originX = (width - m_contentWidth * scale) / 2.0;
+    auto originY = (height - m_contentHeight * scale) / 2.0;
+
+    // The edges are rounded from the running total, so that the regions stay next to each other
+    double top = 0.0;
+    for (auto& thumbnail : m_thumbnails)
+    {
+        auto left = (m_contentWidth - thumbnail.crop.Width()) / 2.0;
+        auto bottom = top + thumbnail.crop.Height();
+        CropGeometry::Rect destination = {
+            Round(originX + left * scale),
+            Round(originY + top * scale),
+            Round(originX + (left + thumbnail.crop.Width()) * scale),
+            Round(originY + bottom * scale),
+        };
+        top = bottom;
+
+        ThumbnailProperties properties;
+        properties.changed = thumbnail.pushed ? ThumbnailProperties::None : AllProperties;
+        if (!thumbnail.pushed || !(thumbnail.destination == destination))
+        {
+            properties.changed |= ThumbnailProperties::Destination;
+        }
+        if (properties.changed == ThumbnailProperties::None)
+        {
+            continue;
+        }
+
+        properties.destination = destination;
+        properties.source = thumbnail.crop;
+        if (m_api.Update(thumbnail.handle, properties))
+        {
+            thumbnail.pushed = true;
+            thumbnail.destination = destination;
+        }
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "CropGeometry.h"
+
+// What the compositor pushes to a thumbnail, with a flag for each property that changed
+struct ThumbnailProperties
+{
+	enum Flags : uint32_t
+	{
+		None = 0,
+		Destination = 1 << 0,
+		Source = 1 << 1,
+		Visible = 1 << 2,
+		Opacity = 1 << 3,
+		SourceClientAreaOnly = 1 << 4,
+	};
+
+	uint32_t changed = None;
+	CropGeometry::Rect destination;
+	CropGeometry::Rect source;
+	bool visible = true;
+	uint8_t opacity = 255;
+	bool sourceClientAreaOnly = false;
+};
+
+// The part of the DWM thumbnail API the compositor uses. An interface so that tests can count the calls.
+struct ThumbnailApi
+{
+	// HWND and HTHUMBNAIL, kept opaque
+	using Window = void*;
+	using Thumbnail = void*;
+
+	virtual ~ThumbnailApi() {}
+
+	// nullptr on failure
+	virtual Thumbnail Register(Window destination, Window source) = 0;
+	virtual void Unregister(Thumbnail thumbnail) = 0;
+	// Only the properties flagged as changed are applied
+	virtual bool Update(Thumbnail thumbnail, ThumbnailProperties const& properties) = 0;
+};
+
+// Shows the crop regions of several windows in one destination window, stacked from top to bottom and scaled
+// together to fit. The same region of a source pinned again shares the thumbnail already registered for it. On
+// layout, the rects of all the regions are computed in one pass and only the properties that changed are pushed.
+class ThumbnailCompositor
+{
+public:
+	using RegionId = uint64_t;
+
+	ThumbnailCompositor(ThumbnailApi& api, ThumbnailApi::Window destination);
+	ThumbnailCompositor(const ThumbnailCompositor&) = delete;
+	ThumbnailCompositor& operator=(const ThumbnailCompositor&) = delete;
+	~ThumbnailCompositor();
+
+	// The crop is in the window space of the source as reported by the DWM. Returns 0 if the source couldn't be
+	// registered.
+	RegionId AddRegion(ThumbnailApi::Window source, CropGeometry::Rect const& crop);
+	void RemoveRegion(RegionId id);
+	// Removes the regions of a source, returns how many there were
+	size_t RemoveSource(ThumbnailApi::Window source);
+	bool HasSource(ThumbnailApi::Window source) const;
+	bool Empty() const { return m_regions.empty(); }
+
+	// Places the regions in a client area of this size. Nothing is pushed when nothing moved.
+	void Layout(int32_t width, int32_t height);
+
+	// The client size showing all the regions at their own size
+	int32_t ContentWidth() const { return m_contentWidth; }
+	int32_t ContentHeight() const { return m_contentHeight; }
+
+	size_t RegionCount() const { return m_regions.size(); }
+	size_t ThumbnailCount() const { return m_thumbnails.size(); }
+
+private:
+	struct SharedThumbnail
+	{
+		ThumbnailApi::Window source = nullptr;
+		CropGeometry::Rect crop;
+		ThumbnailApi::Thumbnail handle = nullptr;
+		size_t references = 0;
+
+		// What the DWM was last told, valid once pushed
+		bool pushed = false;
+		CropGeometry::Rect destination;
+	};
+
+	struct Region
+	{
+		RegionId id = 0;
+		ThumbnailApi::Thumbnail thumbnail = nullptr;
+	};
+
+	void Release(ThumbnailApi::Thumbnail thumbnail);
+	void UpdateContentSize();
+
+	ThumbnailApi& m_api;
+	ThumbnailApi::Window m_destination;
+	std::vector<SharedThumbnail> m_thumbnails;
+	std::vector<Region> m_regions;
+	RegionId m_lastId = 0;
+
+	int32_t m_contentWidth = 0;
+	int32_t m_contentHeight = 0;
+};
@@ -4,11 +4,13 @@
 #include "CropAndLockWindow.h"
 #include "ThumbnailCropAndLockWindow.h"
 #include "ReparentCropAndLockWindow.h"
+#include "CompositedCropAndLockWindow.h"
 #include <common/interop/shared_constants.h>
 #include <common/utils/winapi_error.h>
 #include <common/utils/logger_helper.h>
 #include <common/utils/UnhandledExceptionHandler.h>
 #include <common/utils/gpo.h>
+#include <common/SettingsAPI/settings_objects.h>
 #include "ModuleConstants.h"
 #include <common/utils/ProcessWaiter.h>
 #include "trace.h"
@@ -31,6 +33,25 @@ namespace util
 const std::wstring instanceMutexName = L"Local\\PowerToys_CropAndLock_InstanceMutex";
 bool m_running = true;
 
+namespace NonLocalizable
+{
+    const wchar_t CombineThumbnailsProperty[] = L"combine-thumbnails";
+}
+
+bool ShouldCombineThumbnails()
+{
+    try
+    {
+        auto settings = PowerToysSettings::PowerToyValues::load_from_settings_file(NonLocalizable::ModuleKey);
+        return settings.get_bool_value(NonLocalizable::CombineThumbnailsProperty).value_or(false);
+    }
+    catch (...)
+    {
+        Logger::warn(L"An exception occurred while loading the settings file");
+        return false;
+    }
+}
+
 int WINAPI wWinMain(_In_ HINSTANCE, _In_opt_ HINSTANCE, _In_ PWSTR lpCmdLine, _In_ int)
 {
     // Initialize COM
@@ -150,6 +171,25 @@ int WINAPI wWinMain(_In_ HINSTANCE, _In_opt_ HINSTANCE, _In_ PWSTR lpCmdLine, _I
                 Trace::CropAndLock::CreateReparentWindow();
                 break;
             case CropAndLockType::Thumbnail:
+                if (ShouldCombineThumbnails())
+                {
+                    // Added to the window already showing the other thumbnails, if there is one
+                    auto composited = std::find_if(croppedWindows.begin(), croppedWindows.end(), [](auto const& window) {
+                        return dynamic_cast<CompositedCropAndLockWindow*>(window.get()) != nullptr;
+                    });
+                    if (composited != croppedWindows.end())
+                    {
+                        Logger::trace(L"Adding to the composited thumbnail window");
+                        Trace::CropAndLock::CreateThumbnailWindow();
+                        (*composited)->CropAndLock(targetWindow, cropRect);
+                        return;
+                    }
+
+                    croppedWindow = std::make_shared<CompositedCropAndLockWindow>(title, 800, 600);
+                    Logger::trace(L"Creating a composited thumbnail window");
+                    Trace::CropAndLock::CreateThumbnailWindow();
+                    break;
+                }
                 croppedWindow = std::make_shared<ThumbnailCropAndLockWindow>(title, 800, 600);
                 Logger::trace(L"Creating a thumbnail window");
                 Trace::CropAndLock::CreateThumbnailWindow();
@@ -0,0 +1,169 @@
+#include "pch.h"
+
+#include <CropGeometry.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <format>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CropGeometry;
+
+namespace CropAndLockUnitTests
+{
+    namespace
+    {
+        const uint32_t Dpis[] = { 96, 120, 144, 168, 192, 240, 288 };
+
+        std::wstring Describe(const Rect& rect)
+        {
+            return std::format(L"({}, {}, {}, {})", rect.left, rect.top, rect.right, rect.bottom);
+        }
+
+        void AssertRect(const Rect& expected, const Rect& actual)
+        {
+            Assert::IsTrue(expected == actual, std::format(L"expected {}, got {}", Describe(expected), Describe(actual)).c_str());
+        }
+    }
+
+    TEST_CLASS (CropGeometryTests)
+    {
+    public:
+        TEST_METHOD (Scale_SameDpi_IsIdentity)
+        {
+            for (int32_t value : { -1000, -1, 0, 1, 7, 12345 })
+            {
+                Assert::AreEqual(value, Scale(value, 144, 144));
+            }
+        }
+
+        TEST_METHOD (Scale_RoundsHalvesAwayFromZero)
+        {
+            // 150%
+            Assert::AreEqual(2, Scale(1, 96, 144));
+            Assert::AreEqual(-2, Scale(-1, 96, 144));
+            Assert::AreEqual(5, Scale(3, 96, 144));
+            Assert::AreEqual(-5, Scale(-3, 96, 144));
+            // 125%
+            Assert::AreEqual(3, Scale(2, 96, 120));
+            Assert::AreEqual(-3, Scale(-2, 96, 120));
+            Assert::AreEqual(1, Scale(1, 96, 120));
+            Assert::AreEqual(-1, Scale(-1, 96, 120));
+            // 175% down to 100%: 7 * 96 / 168 = 4, 5 * 96 / 168 = 2.857
+            Assert::AreEqual(4, Scale(7, 168, 96));
+            Assert::AreEqual(3, Scale(5, 168, 96));
+        }
+
+        TEST_METHOD (Scale_MatchesRoundedQuotientAtAllScales)
+        {
+            for (auto from : Dpis)
+            {
+                for (auto to : Dpis)
+                {
+                    for (int32_t value = -3000; value <= 3000; ++value)
+                    {
+                        const auto expected = static_cast<int32_t>(std::llround(static_cast<double>(value) * to / from));
+                        if (Scale(value, from, to) != expected)
+                        {
+                            Assert::Fail(std::format(L"{} from {} to {} DPI: expected {}, got {}", value, from, to, expected, Scale(value, from, to)).c_str());
+                        }
+                    }
+                }
+            }
+        }
+
+        TEST_METHOD (Scale_DoesNotOverflowAtLargeCoordinates)
+        {
+            Assert::AreEqual(96000000, Scale(32000000, 96, 288));
+            Assert::AreEqual(-96000000, Scale(-32000000, 96, 288));
+        }
+
+        TEST_METHOD (Scale_UnknownDpi_IsIdentity)
+        {
+            Assert::AreEqual(42, Scale(42, 0, 144));
+        }
+
+        TEST_METHOD (ScaleRect_KeepsSharedEdges)
+        {
+            const Rect left{ 0, 0, 3, 10 };
+            const Rect right{ 3, 0, 7, 10 };
+            for (auto to : Dpis)
+            {
+                const auto scaledLeft = Scale(left, 96, to);
+                const auto scaledRight = Scale(right, 96, to);
+                Assert::AreEqual(scaledLeft.right, scaledRight.left);
+                Assert::AreEqual(Scale(7, 96, to), scaledLeft.Width() + scaledRight.Width());
+            }
+        }
+
+        TEST_METHOD (ScaleRect_SizeIsWithinOnePixelOfScaledSize)
+        {
+            // At 125%, a 2 pixel wide rect at 2 covers 2.5 to 5: 3 to 5 once rounded, narrower than 2.5
+            AssertRect({ 3, 3, 5, 5 }, Scale(Rect{ 2, 2, 4, 4 }, 96, 120));
+
+            for (auto to : Dpis)
+            {
+                for (int32_t left = -50; left < 50; ++left)
+                {
+                    for (int32_t width = 0; width < 50; ++width)
+                    {
+                        const auto scaled = Scale(Rect{ left, 0, left + width, 0 }, 96, to);
+                        const double exact = static_cast<double>(width) * to / 96;
+                        Assert::IsTrue(std::abs(scaled.Width() - exact) <= 1.0);
+                    }
+                }
+            }
+        }
+
+        TEST_METHOD (ComputeLayout_SameDpi_OffsetsByCropAndFrame)
+        {
+            const Rect window{ 100, 100, 900, 700 };
+            const Rect client{ 108, 131, 892, 692 };
+            const auto layout = ComputeLayout({ 10, 20, 210, 170 }, 96, window, client, 96);
+
+            AssertRect({ 10, 20, 210, 170 }, layout.crop);
+            Assert::AreEqual(-18, layout.targetOffset.x);
+            Assert::AreEqual(-51, layout.targetOffset.y);
+        }
+
+        TEST_METHOD (ComputeLayout_DoesNotDependOnWindowPosition)
+        {
+            const Rect crop{ 10, 20, 210, 170 };
+            const auto layout = ComputeLayout(crop, 96, { 100, 100, 900, 700 }, { 108, 131, 892, 692 }, 96);
+            const auto moved = ComputeLayout(crop, 96, { -500, 40, 300, 640 }, { -492, 71, 292, 632 }, 96);
+            Assert::IsTrue(layout == moved);
+        }
+
+        TEST_METHOD (ComputeLayout_FrameChange_KeepsClientContent)
+        {
+            // Without a caption, the client area starts 23 pixels higher in the window
+            const Rect crop{ 10, 20, 210, 170 };
+            const auto before = ComputeLayout(crop, 96, { 0, 0, 800, 600 }, { 8, 31, 792, 592 }, 96);
+            const auto after = ComputeLayout(crop, 96, { 0, 0, 800, 600 }, { 8, 8, 792, 592 }, 96);
+
+            AssertRect(before.crop, after.crop);
+            Assert::AreEqual(before.targetOffset.x, after.targetOffset.x);
+            Assert::AreEqual(before.targetOffset.y + 23, after.targetOffset.y);
+        }
+
+        TEST_METHOD (ComputeLayout_Resize_KeepsCrop)
+        {
+            const Rect crop{ 10, 20, 210, 170 };
+            const auto before = ComputeLayout(crop, 96, { 0, 0, 800, 600 }, { 8, 31, 792, 592 }, 96);
+            const auto after = ComputeLayout(crop, 96, { 0, 0, 1200, 900 }, { 8, 31, 1192, 892 }, 96);
+            Assert::IsTrue(before == after);
+        }
+
+        TEST_METHOD (ComputeLayout_DpiChange_ScalesCropNotFrame)
+        {
+            // The frame is measured at the new DPI already
+            const auto layout = ComputeLayout({ 10, 20, 211, 171 }, 96, { 0, 0, 1200, 900 }, { 12, 46, 1188, 888 }, 144);
+
+            AssertRect({ 15, 30, 317, 257 }, layout.crop);
+            Assert::AreEqual(302, layout.crop.Width());
+            Assert::AreEqual(227, layout.crop.Height());
+            Assert::AreEqual(-27, layout.targetOffset.x);
+            Assert::AreEqual(-76, layout.targetOffset.y);
+        }
+    };
+}
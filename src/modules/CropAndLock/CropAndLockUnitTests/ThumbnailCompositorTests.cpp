@@ -0,0 +1,338 @@
+#include "pch.h"
+
+#include <ThumbnailCompositor.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <format>
+#include <map>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CropGeometry;
+
+namespace CropAndLockUnitTests
+{
+    namespace
+    {
+        // Counts the calls and keeps what each thumbnail was last told
+        struct FakeThumbnailApi : ThumbnailApi
+        {
+            struct Pushed
+            {
+                Window window = nullptr;
+                Rect destination;
+                Rect source;
+                bool visible = false;
+            };
+
+            Thumbnail Register(Window, Window sourceWindow) override
+            {
+                ++registers;
+                if (failRegister)
+                {
+                    return nullptr;
+                }
+                auto thumbnail = reinterpret_cast<Thumbnail>(++lastHandle);
+                thumbnails[thumbnail].window = sourceWindow;
+                return thumbnail;
+            }
+
+            void Unregister(Thumbnail thumbnail) override
+            {
+                ++unregisters;
+                thumbnails.erase(thumbnail);
+            }
+
+            bool Update(Thumbnail thumbnail, ThumbnailProperties const& properties) override
+            {
+                ++updates;
+                changed |= properties.changed;
+                auto& pushed = thumbnails.at(thumbnail);
+                if (properties.changed & ThumbnailProperties::Destination)
+                {
+                    pushed.destination = properties.destination;
+                }
+                if (properties.changed & ThumbnailProperties::Source)
+                {
+                    pushed.source = properties.source;
+                }
+                if (properties.changed & ThumbnailProperties::Visible)
+                {
+                    pushed.visible = properties.visible;
+                }
+                return true;
+            }
+
+            void ResetCounts()
+            {
+                registers = 0;
+                unregisters = 0;
+                updates = 0;
+                changed = ThumbnailProperties::None;
+            }
+
+            int registers = 0;
+            int unregisters = 0;
+            int updates = 0;
+            uint32_t changed = ThumbnailProperties::None;
+            bool failRegister = false;
+
+            uintptr_t lastHandle = 0;
+            std::map<Thumbnail, Pushed> thumbnails;
+        };
+
+        ThumbnailApi::Window Source(uintptr_t id)
+        {
+            return reinterpret_cast<ThumbnailApi::Window>(id);
+        }
+
+        std::wstring Describe(const Rect& rect)
+        {
+            return std::format(L"({}, {}, {}, {})", rect.left, rect.top, rect.right, rect.bottom);
+        }
+
+        void AssertRect(const Rect& expected, const Rect& actual)
+        {
+            Assert::IsTrue(expected == actual, std::format(L"expected {}, got {}", Describe(expected), Describe(actual)).c_str());
+        }
+
+        const FakeThumbnailApi::Pushed& PushedFor(const FakeThumbnailApi& api, ThumbnailApi::Window window)
+        {
+            auto found = std::find_if(api.thumbnails.begin(), api.thumbnails.end(), [window](auto const& entry) { return entry.second.window == window; });
+            Assert::IsTrue(found != api.thumbnails.end(), L"no thumbnail for the window");
+            return found->second;
+        }
+    }
+
+    TEST_CLASS (ThumbnailCompositorTests)
+    {
+    public:
+        TEST_METHOD (SameRegion_SharesOneRegistration)
+        {
+            FakeThumbnailApi api;
+            ThumbnailCompositor compositor{ api, Source(1) };
+
+            const auto first = compositor.AddRegion(Source(10), { 0, 0, 100, 50 });
+            const auto second = compositor.AddRegion(Source(10), { 0, 0, 100, 50 });
+            Assert::AreNotEqual(first, second);
+            Assert::AreEqual(1, api.registers);
+            Assert::AreEqual(size_t{ 2 }, compositor.RegionCount());
+            Assert::AreEqual(size_t{ 1 }, compositor.ThumbnailCount());
+
+            // The registration lives as long as one of its regions
+            compositor.RemoveRegion(first);
+            Assert::AreEqual(0, api.unregisters);
+            compositor.RemoveRegion(second);
+            Assert::AreEqual(1, api.unregisters);
+            Assert::IsTrue(compositor.Empty());
+        }
+
+        TEST_METHOD (OtherRegions_AreRegisteredOnce)
+        {
+            FakeThumbnailApi api;
+            ThumbnailCompositor compositor{ api, Source(1) };
+
+            compositor.AddRegion(Source(10), { 0, 0, 100, 50 });
+            compositor.AddRegion(Source(10), { 0, 100, 100, 150 });
+            compositor.AddRegion(Source(20), { 0, 0, 100, 50 });
+            Assert::AreEqual(3, api.registers);
+            Assert::AreEqual(size_t{ 3 }, compositor.ThumbnailCount());
+
+            for (int32_t size = 100; size < 400; size += 10)
+            {
+                compositor.Layout(size, size * 2);
+            }
+            Assert::AreEqual(3, api.registers);
+            Assert::AreEqual(0, api.unregisters);
+        }
+
+        TEST_METHOD (FailedRegistration_AddsNothing)
+        {
+            FakeThumbnailApi api;
+            api.failRegister = true;
+            ThumbnailCompositor compositor{ api, Source(1) };
+
+            Assert::AreEqual(ThumbnailCompositor::RegionId{ 0 }, compositor.AddRegion(Source(10), { 0, 0, 100, 50 }));
+            Assert::IsTrue(compositor.Empty());
+            Assert::AreEqual(0, compositor.ContentWidth());
+        }
+
+        TEST_METHOD (ContentSize_StacksRegions)
+        {
+            FakeThumbnailApi api;
+            ThumbnailCompositor compositor{ api, Source(1) };
+
+            compositor.AddRegion(Source(10), { 10, 10, 110, 60 });
+            compositor.AddRegion(Source(20), { 0, 0, 300, 20 });
+            Assert::AreEqual(300, compositor.ContentWidth());
+            Assert::AreEqual(70, compositor.ContentHeight());
+
+            compositor.RemoveSource(Source(20));
+            Assert::AreEqual(100, compositor.ContentWidth());
+            Assert::AreEqual(50, compositor.ContentHeight());
+        }
+
+        TEST_METHOD (Layout_AtContentSize_ShowsRegionsUnscaled)
+        {
+            FakeThumbnailApi api;
+            ThumbnailCompositor compositor{ api, Source(1) };
+
+            compositor.AddRegion(Source(10), { 10, 10, 110, 60 });
+            compositor.AddRegion(Source(20), { 0, 0, 300, 20 });
+            compositor.Layout(compositor.ContentWidth(), compositor.ContentHeight());
+
+            // The narrower region is centered
+            AssertRect({ 100, 0, 200, 50 }, PushedFor(api, Source(10)).destination);
+            AssertRect({ 10, 10, 110, 60 }, PushedFor(api, Source(10)).source);
+            AssertRect({ 0, 50, 300, 70 }, PushedFor(api, Source(20)).destination);
+            Assert::IsTrue(PushedFor(api, Source(20)).visible);
+        }
+
+        TEST_METHOD (Layout_ScalesTogetherAndKeepsRegionsAdjacent)
+        {
+            FakeThumbnailApi api;
+            ThumbnailCompositor compositor{ api, Source(1) };
+
+            compositor.AddRegion(Source(10), { 0, 0, 100, 33 });
+            compositor.AddRegion(Source(20), { 0, 0, 100, 33 });
+            compositor.AddRegion(Source(30), { 0, 0, 100, 34 });
+
+            // Half the size, in a wider client area: centered horizontally
+            compositor.Layout(150, 50);
+            const auto& first = PushedFor(api, Source(10)).destination;
+            const auto& second = PushedFor(api, Source(20)).destination;
+            const auto& third = PushedFor(api, Source(30)).destination;
+            AssertRect({ 50, 0, 100, 17 }, first);
+            Assert::AreEqual(first.bottom, second.top);
+            Assert::AreEqual(second.bottom, third.top);
+            Assert::AreEqual(50, third.bottom);
+        }
+
+        TEST_METHOD (FirstLayout_PushesEverything)
+        {
+            FakeThumbnailApi api;
+            ThumbnailCompositor compositor{ api, Source(1) };
+            compositor.AddRegion(Source(10), { 0, 0, 100, 50 });
+            compositor.AddRegion(Source(20), { 0, 0, 100, 50 });
+
+            compositor.Layout(100, 100);
+            Assert::AreEqual(2, api.updates);
+            Assert::AreEqual(static_cast<uint32_t>(ThumbnailProperties::Destination | ThumbnailProperties::Source | ThumbnailProperties::Visible |
+                                                   ThumbnailProperties::Opacity | ThumbnailProperties::SourceClientAreaOnly),
+                             api.changed);
+        }
+
+        TEST_METHOD (UnchangedLayout_PushesNothing)
+        {
+            FakeThumbnailApi api;
+            ThumbnailCompositor compositor{ api, Source(1) };
+            compositor.AddRegion(Source(10), { 0, 0, 100, 50 });
+            compositor.AddRegion(Source(20), { 0, 0, 100, 50 });
+            compositor.Layout(100, 100);
+
+            api.ResetCounts();
+            for (int i = 0; i < 100; ++i)
+            {
+                compositor.Layout(100, 100);
+            }
+            Assert::AreEqual(0, api.updates);
+        }
+
+        TEST_METHOD (Resize_PushesOnlyDestinations)
+        {
+            FakeThumbnailApi api;
+            ThumbnailCompositor compositor{ api, Source(1) };
+            compositor.AddRegion(Source(10), { 0, 0, 100, 50 });
+            compositor.AddRegion(Source(20), { 0, 0, 100, 50 });
+            compositor.Layout(100, 100);
+
+            api.ResetCounts();
+            compositor.Layout(200, 200);
+            Assert::AreEqual(2, api.updates);
+            Assert::AreEqual(static_cast<uint32_t>(ThumbnailProperties::Destination), api.changed);
+            AssertRect({ 0, 100, 200, 200 }, PushedFor(api, Source(20)).destination);
+        }
+
+        TEST_METHOD (Resize_SkipsRegionsThatDidNotMove)
+        {
+            FakeThumbnailApi api;
+            ThumbnailCompositor compositor{ api, Source(1) };
+            compositor.AddRegion(Source(10), { 0, 0, 100, 50 });
+            compositor.AddRegion(Source(20), { 0, 0, 100, 50 });
+            compositor.Layout(100, 100);
+
+            // Removing the second region moves the first one to the middle
+            compositor.RemoveSource(Source(20));
+            api.ResetCounts();
+            compositor.Layout(100, 100);
+            Assert::AreEqual(1, api.updates);
+
+            // Adding a region back pushes everything to it and moves the first one back
+            compositor.AddRegion(Source(30), { 0, 0, 100, 50 });
+            api.ResetCounts();
+            compositor.Layout(100, 100);
+            Assert::AreEqual(2, api.updates);
+        }
+
+        TEST_METHOD (RemoveSource_RemovesAllItsRegions)
+        {
+            FakeThumbnailApi api;
+            ThumbnailCompositor compositor{ api, Source(1) };
+            compositor.AddRegion(Source(10), { 0, 0, 100, 50 });
+            compositor.AddRegion(Source(10), { 0, 0, 100, 50 });
+            compositor.AddRegion(Source(10), { 0, 50, 100, 100 });
+            const auto kept = compositor.AddRegion(Source(20), { 0, 0, 100, 50 });
+
+            Assert::AreEqual(size_t{ 3 }, compositor.RemoveSource(Source(10)));
+            Assert::AreEqual(2, api.unregisters);
+            Assert::AreEqual(size_t{ 1 }, compositor.RegionCount());
+
+            compositor.RemoveRegion(kept);
+            Assert::IsTrue(compositor.Empty());
+            Assert::IsTrue(api.thumbnails.empty());
+        }
+
+        // What the window does when a source is closed: its regions go, the others move up, and the window closes
+        // along with the last source
+        TEST_METHOD (ClosedSource_LeavesTheOtherRegions)
+        {
+            FakeThumbnailApi api;
+            ThumbnailCompositor compositor{ api, Source(1) };
+            compositor.AddRegion(Source(10), { 0, 0, 100, 50 });
+            compositor.AddRegion(Source(20), { 0, 0, 200, 30 });
+            compositor.AddRegion(Source(10), { 0, 50, 100, 100 });
+            compositor.Layout(compositor.ContentWidth(), compositor.ContentHeight());
+
+            Assert::AreEqual(size_t{ 2 }, compositor.RemoveSource(Source(10)));
+            Assert::IsFalse(compositor.HasSource(Source(10)));
+            Assert::IsTrue(compositor.HasSource(Source(20)));
+            Assert::IsFalse(compositor.Empty());
+            Assert::AreEqual(200, compositor.ContentWidth());
+            Assert::AreEqual(30, compositor.ContentHeight());
+
+            api.ResetCounts();
+            compositor.Layout(compositor.ContentWidth(), compositor.ContentHeight());
+            Assert::AreEqual(1, api.updates);
+            AssertRect({ 0, 0, 200, 30 }, PushedFor(api, Source(20)).destination);
+
+            Assert::AreEqual(size_t{ 1 }, compositor.RemoveSource(Source(20)));
+            Assert::IsTrue(compositor.Empty());
+            Assert::IsTrue(api.thumbnails.empty());
+
+            // Closed already
+            Assert::AreEqual(size_t{ 0 }, compositor.RemoveSource(Source(20)));
+        }
+
+        TEST_METHOD (Destructor_UnregistersEverything)
+        {
+            FakeThumbnailApi api;
+            {
+                ThumbnailCompositor compositor{ api, Source(1) };
+                compositor.AddRegion(Source(10), { 0, 0, 100, 50 });
+                compositor.AddRegion(Source(20), { 0, 0, 100, 50 });
+            }
+            Assert::AreEqual(2, api.unregisters);
+            Assert::IsTrue(api.thumbnails.empty());
+        }
+    };
+}
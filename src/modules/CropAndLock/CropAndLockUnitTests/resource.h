@@ -0,0 +1,13 @@
+//{{NO_DEPENDENCIES}}
+// Microsoft Visual C++ generated include file.
+// Used by CropAndLockUnitTests.rc
+
+//////////////////////////////
+// Non-localizable
+
+#define FILE_DESCRIPTION "PowerToys CropAndLockUnitTests"
+#define INTERNAL_NAME "CropAndLockUnitTests"
+#define ORIGINAL_FILENAME "CropAndLockUnitTests.dll"
+
+// Non-localizable
+//////////////////////////////
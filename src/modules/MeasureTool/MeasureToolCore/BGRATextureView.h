@@ -75,6 +75,65 @@ inline int64_t _mm_cvtsi128_si64(__m128i a)
 {
     return vgetq_lane_s64(a, 0);
 }
+
+inline __m128i _mm_loadu_si128(const __m128i* p)
+{
+    return vreinterpretq_s64_s32(vld1q_s32(reinterpret_cast<const int32_t*>(p)));
+}
+
+inline __m128i _mm_setr_epi32(int i0, int i1, int i2, int i3)
+{
+    const int32_t data[4] = { i0, i1, i2, i3 };
+    return vreinterpretq_s64_s32(vld1q_s32(data));
+}
+
+inline __m128i _mm_set1_epi8(signed char w)
+{
+    return vreinterpretq_s64_s8(vdupq_n_s8(w));
+}
+
+inline __m128i _mm_set1_epi32(int i)
+{
+    return vreinterpretq_s64_s32(vdupq_n_s32(i));
+}
+
+inline __m128i _mm_and_si128(__m128i a, __m128i b)
+{
+    return vreinterpretq_s64_s32(
+        vandq_s32(vreinterpretq_s32_s64(a), vreinterpretq_s32_s64(b)));
+}
+
+inline __m128i _mm_add_epi16(__m128i a, __m128i b)
+{
+    return vreinterpretq_s64_s16(
+        vaddq_s16(vreinterpretq_s16_s64(a), vreinterpretq_s16_s64(b)));
+}
+
+inline __m128i _mm_add_epi32(__m128i a, __m128i b)
+{
+    return vreinterpretq_s64_s32(
+        vaddq_s32(vreinterpretq_s32_s64(a), vreinterpretq_s32_s64(b)));
+}
+
+inline __m128i _mm_cmpgt_epi32(__m128i a, __m128i b)
+{
+    return vreinterpretq_s64_u32(
+        vcgtq_s32(vreinterpretq_s32_s64(a), vreinterpretq_s32_s64(b)));
+}
+
+#define _mm_srli_epi16(a, imm) vreinterpretq_s64_u16(vshrq_n_u16(vreinterpretq_u16_s64(a), imm))
+#define _mm_srli_epi32(a, imm) vreinterpretq_s64_u32(vshrq_n_u32(vreinterpretq_u32_s64(a), imm))
+
+inline bool is_zero_si128(__m128i a)
+{
+    return vmaxvq_u8(vreinterpretq_u8_s64(a)) == 0;
+}
+#else
+
+inline bool is_zero_si128(__m128i a)
+{
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(a, _mm_setzero_si128())) == 0xFFFF;
+}
 #endif
 
 inline __m128i distance_epu8(const __m128i a, __m128i b)
@@ -83,6 +142,46 @@ inline __m128i distance_epu8(const __m128i a, __m128i b)
                         _mm_subs_epu8(b, a));
 }
 
+// Compares 4 pixels at once against a reference pixel, using the same metrics as BGRATextureView::PixelsClose
+template<bool perChannel>
+struct PixelsClose4
+{
+    __m128i reference;
+    __m128i tolerances;
+
+    PixelsClose4(const uint32_t referencePixel, const uint8_t tolerance) :
+        reference{ _mm_set1_epi32(static_cast<int>(referencePixel)) },
+        tolerances{ perChannel ? _mm_set1_epi8(static_cast<signed char>(tolerance)) : _mm_set1_epi32(tolerance) }
+    {
+    }
+
+    // Returns zero if all the pixels are close to the reference pixel
+    inline __m128i Mismatches(const __m128i pixels) const
+    {
+        const __m128i distances = distance_epu8(reference, pixels);
+        if constexpr (perChannel)
+        {
+            // Every channel distance above tolerance stays non-zero
+            return _mm_subs_epu8(distances, tolerances);
+        }
+        else
+        {
+            // Sum channel distances of every pixel: bytes -> 16-bit pairs -> 32-bit lanes
+            const __m128i lowBytes = _mm_set1_epi32(0x00FF00FF);
+            const __m128i pairs = _mm_add_epi16(_mm_and_si128(distances, lowBytes), _mm_srli_epi16(distances, 8));
+            const __m128i sums = _mm_add_epi32(_mm_and_si128(pairs, _mm_set1_epi32(0x0000FFFF)), _mm_srli_epi32(pairs, 16));
+            // Keep only the lowest byte of the score, same as the single pixel version
+            const __m128i scores = _mm_and_si128(sums, _mm_set1_epi32(std::numeric_limits<uint8_t>::max()));
+            return _mm_cmpgt_epi32(scores, tolerances);
+        }
+    }
+
+    inline bool AllClose(const __m128i pixels) const
+    {
+        return is_zero_si128(Mismatches(pixels));
+    }
+};
+
 struct BGRATextureView
 {
     const uint32_t* pixels = nullptr;
@@ -101,6 +200,26 @@ struct BGRATextureView
         return pixels[x + pitch * y];
     }
 
+    // Loads 4 horizontally adjacent pixels starting at x
+    inline __m128i GetPixelsX4(const size_t x, const size_t y) const
+    {
+        assert(x + 3 < width);
+        assert(y < height);
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + x + pitch * y));
+    }
+
+    // Loads 4 vertically adjacent pixels starting at y
+    inline __m128i GetPixelsY4(const size_t x, const size_t y) const
+    {
+        assert(x < width);
+        assert(y + 3 < height);
+        const uint32_t* column = pixels + x + pitch * y;
+        return _mm_setr_epi32(static_cast<int>(column[0]),
+                              static_cast<int>(column[pitch]),
+                              static_cast<int>(column[pitch * 2]),
+                              static_cast<int>(column[pitch * 3]));
+    }
+
     template<bool perChannel>
     static inline bool PixelsClose(const uint32_t pixel1, const uint32_t pixel2, uint8_t tolerance)
     {
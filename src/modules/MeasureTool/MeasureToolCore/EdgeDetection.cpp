@@ -3,6 +3,25 @@
 #include "constants.h"
 #include "EdgeDetection.h"
 
+namespace
+{
+    // Lines which have more runs than 1/MIN_AVERAGE_RUN_LENGTH of their length are not indexed
+    constexpr size_t MIN_AVERAGE_RUN_LENGTH = 8;
+}
+
+template<bool IsX>
+inline __m128i GetPixels4(const BGRATextureView& texture, const long x, const long y)
+{
+    if constexpr (IsX)
+    {
+        return texture.GetPixelsX4(x, y);
+    }
+    else
+    {
+        return texture.GetPixelsY4(x, y);
+    }
+}
+
 template<bool PerChannel,
          bool IsX,
          bool Increment>
@@ -10,51 +29,76 @@ inline long FindEdge(const BGRATextureView& texture, const POINT centerPoint, co
 {
     using namespace consts;
 
-    const size_t maxDim = IsX ? texture.width : texture.height;
+    const long maxDim = static_cast<long>(IsX ? texture.width : texture.height);
 
-    long x = std::clamp<long>(centerPoint.x, 1, static_cast<long>(texture.width - 2));
-    long y = std::clamp<long>(centerPoint.y, 1, static_cast<long>(texture.height - 2));
+    const long x = std::clamp<long>(centerPoint.x, 1, static_cast<long>(texture.width - 2));
+    const long y = std::clamp<long>(centerPoint.y, 1, static_cast<long>(texture.height - 2));
 
     const uint32_t startPixel = texture.GetPixel(x, y);
-    while (true)
+    const PixelsClose4<PerChannel> close4{ startPixel, tolerance };
+
+    // Pixels are tested in blocks of 16 and then 4 while they are all close to the start pixel. The first block
+    // which contains a different pixel is resolved one pixel at a time.
+    auto blockClose = [&](const long first) {
+        return close4.AllClose(IsX ? GetPixels4<IsX>(texture, first, y) : GetPixels4<IsX>(texture, x, first));
+    };
+    auto pixelClose = [&](const long pos) {
+        const uint32_t nextPixel = IsX ? texture.GetPixel(pos, y) : texture.GetPixel(x, pos);
+        return texture.PixelsClose<PerChannel>(startPixel, nextPixel, tolerance);
+    };
+
+    long pos = IsX ? x : y;
+    if constexpr (Increment)
     {
-        long oldX = x;
-        long oldY = y;
-        if constexpr (IsX)
+        ++pos;
+        for (; pos + 16 <= maxDim; pos += 16)
         {
-            if constexpr (Increment)
-            {
-                if (++x == maxDim)
-                    break;
-            }
-            else
+            if (!(blockClose(pos) && blockClose(pos + 4) && blockClose(pos + 8) && blockClose(pos + 12)))
             {
-                if (--x == 0)
-                    break;
+                break;
             }
         }
-        else
+
+        for (; pos + 4 <= maxDim && blockClose(pos); pos += 4)
         {
-            if constexpr (Increment)
+        }
+
+        for (; pos < maxDim; ++pos)
+        {
+            if (!pixelClose(pos))
             {
-                if (++y == maxDim)
-                    break;
+                return pos - 1;
             }
-            else
+        }
+
+        return maxDim - 1;
+    }
+    else
+    {
+        // Pixel 0 is never tested, same as the edge of the texture
+        --pos;
+        for (; pos - 15 >= 1; pos -= 16)
+        {
+            if (!(blockClose(pos - 3) && blockClose(pos - 7) && blockClose(pos - 11) && blockClose(pos - 15)))
             {
-                if (--y == 0)
-                    break;
+                break;
             }
         }
 
-        const uint32_t nextPixel = texture.GetPixel(x, y);
-        if (!texture.PixelsClose<PerChannel>(startPixel, nextPixel, tolerance))
+        for (; pos - 3 >= 1 && blockClose(pos - 3); pos -= 4)
         {
-            return IsX ? oldX : oldY;
         }
-    }
 
-    return Increment ? static_cast<long>(IsX ? texture.width : texture.height) - 1 : 0;
+        for (; pos >= 1; --pos)
+        {
+            if (!pixelClose(pos))
+            {
+                return pos + 1;
+            }
+        }
+
+        return 0;
+    }
 }
 
 template<bool PerChannel>
@@ -85,3 +129,186 @@ RECT DetectEdges(const BGRATextureView& texture,
 
     return function(texture, centerPoint, tolerance);
 }
+
+EdgeDetectionIndex::EdgeDetectionIndex(const BGRATextureView& texture) :
+    texture{ &texture }
+{
+}
+
+template<bool IsX>
+EdgeDetectionIndex::Line& EdgeDetectionIndex::GetLine(const long index)
+{
+    auto& lines = IsX ? rows : columns;
+    auto [it, inserted] = lines.try_emplace(index);
+    Line& line = it->second;
+    if (!inserted)
+    {
+        return line;
+    }
+
+    const long length = static_cast<long>(IsX ? texture->width : texture->height);
+    const size_t maxRuns = length / MIN_AVERAGE_RUN_LENGTH + 1;
+    uint32_t previous = IsX ? texture->GetPixel(0, index) : texture->GetPixel(index, 0);
+    line.runStarts.push_back(0);
+    for (long pos = 1; pos < length; ++pos)
+    {
+        const uint32_t pixel = IsX ? texture->GetPixel(pos, index) : texture->GetPixel(index, pos);
+        if (pixel != previous)
+        {
+            if (line.runStarts.size() == maxRuns)
+            {
+                line.runStarts = {};
+                return line;
+            }
+
+            line.runStarts.push_back(pos);
+            previous = pixel;
+        }
+    }
+
+    line.indexed = true;
+    line.lowEdges.assign(line.runStarts.size(), UnknownEdge);
+    line.highEdges.assign(line.runStarts.size(), UnknownEdge);
+    return line;
+}
+
+template<bool PerChannel, bool IsX>
+void EdgeDetectionIndex::FindEdges(const POINT centerPoint, const uint8_t tolerance, long& low, long& high)
+{
+    // Same start pixel clamping as FindEdge, so the run lookup matches the pixel it would compare against
+    const POINT start{ std::clamp<long>(centerPoint.x, 1, static_cast<long>(texture->width - 2)),
+                       std::clamp<long>(centerPoint.y, 1, static_cast<long>(texture->height - 2)) };
+
+    Line& line = GetLine<IsX>(IsX ? start.y : start.x);
+    if (!line.indexed)
+    {
+        low = FindEdge<PerChannel, IsX, false>(*texture, start, tolerance);
+        high = FindEdge<PerChannel, IsX, true>(*texture, start, tolerance);
+        return;
+    }
+
+    const uint32_t pos = static_cast<uint32_t>(IsX ? start.x : start.y);
+    const size_t run = std::upper_bound(line.runStarts.begin(), line.runStarts.end(), pos) - line.runStarts.begin() - 1;
+    if (line.lowEdges[run] == UnknownEdge)
+    {
+        line.lowEdges[run] = FindEdge<PerChannel, IsX, false>(*texture, start, tolerance);
+    }
+
+    if (line.highEdges[run] == UnknownEdge)
+    {
+        line.highEdges[run] = FindEdge<PerChannel, IsX, true>(*texture, start, tolerance);
+    }
+
+    low = line.lowEdges[run];
+    high = line.highEdges[run];
+}
+
+RECT EdgeDetectionIndex::DetectEdges(const POINT centerPoint,
+                                     const bool perChannel,
+                                     const uint8_t tolerance)
+{
+    // Cached edges depend on the detection settings, so drop them if those change
+    if (perChannel != indexedPerChannel || tolerance != indexedTolerance)
+    {
+        rows.clear();
+        columns.clear();
+        indexedPerChannel = perChannel;
+        indexedTolerance = tolerance;
+    }
+
+    RECT result = {};
+    if (perChannel)
+    {
+        FindEdges<true, true>(centerPoint, tolerance, result.left, result.right);
+        FindEdges<true, false>(centerPoint, tolerance, result.top, result.bottom);
+    }
+    else
+    {
+        FindEdges<false, true>(centerPoint, tolerance, result.left, result.right);
+        FindEdges<false, false>(centerPoint, tolerance, result.top, result.bottom);
+    }
+
+    return result;
+}
+
+void EdgeDetectionCache::ScannedSegments(RECT& row, RECT& column) const
+{
+    // Same clamping as FindEdge. Scanning stops at the first pixel past an edge, so that pixel is included too.
+    const long x = std::clamp<long>(centerPoint.x, 1, static_cast<long>(width - 2));
+    const long y = std::clamp<long>(centerPoint.y, 1, static_cast<long>(height - 2));
+    row = RECT{ .left = std::max(edges.left - 1, 0L),
+                .top = y,
+                .right = std::min(edges.right + 1, static_cast<long>(width - 1)),
+                .bottom = y };
+    column = RECT{ .left = x,
+                   .top = std::max(edges.top - 1, 0L),
+                   .right = x,
+                   .bottom = std::min(edges.bottom + 1, static_cast<long>(height - 1)) };
+}
+
+std::optional<RECT> EdgeDetectionCache::Lookup(const BGRATextureView& texture,
+                                               const POINT centerPoint_,
+                                               const bool perChannel_,
+                                               const uint8_t tolerance_,
+                                               const bool textureChanged) const
+{
+    if (!valid || centerPoint_.x != centerPoint.x || centerPoint_.y != centerPoint.y || perChannel_ != perChannel ||
+        tolerance_ != tolerance || texture.width != width || texture.height != height)
+    {
+        return std::nullopt;
+    }
+
+    if (textureChanged)
+    {
+        RECT row, column;
+        ScannedSegments(row, column);
+
+        const uint32_t* rowStart = texture.pixels + row.left + texture.pitch * row.top;
+        if (std::memcmp(rowStart, rowPixels.data(), rowPixels.size() * sizeof(uint32_t)) != 0)
+        {
+            return std::nullopt;
+        }
+
+        for (long y = column.top; y <= column.bottom; ++y)
+        {
+            if (texture.GetPixel(column.left, y) != columnPixels[y - column.top])
+            {
+                return std::nullopt;
+            }
+        }
+    }
+
+    return edges;
+}
+
+void EdgeDetectionCache::Store(const BGRATextureView& texture,
+                               const POINT centerPoint_,
+                               const bool perChannel_,
+                               const uint8_t tolerance_,
+                               const RECT edges_)
+{
+    valid = true;
+    centerPoint = centerPoint_;
+    perChannel = perChannel_;
+    tolerance = tolerance_;
+    edges = edges_;
+    width = texture.width;
+    height = texture.height;
+
+    RECT row, column;
+    ScannedSegments(row, column);
+
+    const uint32_t* rowStart = texture.pixels + row.left + texture.pitch * row.top;
+    rowPixels.assign(rowStart, rowStart + (row.right - row.left + 1));
+
+    columnPixels.clear();
+    for (long y = column.top; y <= column.bottom; ++y)
+    {
+        columnPixels.push_back(texture.GetPixel(column.left, y));
+    }
+}
+
+void EdgeDetectionCache::Clear()
+{
+    valid = false;
+}
@@ -1,8 +1,87 @@
 #pragma once
 
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
 #include "BGRATextureView.h"
 
 RECT DetectEdges(const BGRATextureView& texture,
                  const POINT centerPoint,
                  const bool perChannel,
-                 const uint8_t tolerance);
\ No newline at end of file
+                 const uint8_t tolerance);
+
+// Answers edge queries on a texture which doesn't change, e.g. a single captured frame.
+// Every row and column the cursor visits is split into runs of identical pixels once. Since all the pixels
+// of a run share the same start pixel, they share the same edges too, so the edges are computed once per run
+// and a query becomes a hash lookup plus a binary search.
+class EdgeDetectionIndex
+{
+public:
+    explicit EdgeDetectionIndex(const BGRATextureView& texture);
+
+    RECT DetectEdges(const POINT centerPoint,
+                     const bool perChannel,
+                     const uint8_t tolerance);
+
+private:
+    struct Line
+    {
+        // Lines with too many runs, e.g. photos or gradients, are not worth indexing and are scanned directly
+        bool indexed = false;
+        std::vector<uint32_t> runStarts;
+        std::vector<long> lowEdges;
+        std::vector<long> highEdges;
+    };
+
+    static constexpr long UnknownEdge = -1;
+
+    const BGRATextureView* texture = nullptr;
+    std::unordered_map<long, Line> rows;
+    std::unordered_map<long, Line> columns;
+    bool indexedPerChannel = false;
+    uint8_t indexedTolerance = 0;
+
+    template<bool IsX>
+    Line& GetLine(const long index);
+
+    template<bool PerChannel, bool IsX>
+    void FindEdges(const POINT centerPoint, const uint8_t tolerance, long& low, long& high);
+};
+
+// Remembers the edges detected last and the pixels they were detected from. Edges only depend on the pixels
+// scanned along the row and the column of the cursor, so a new frame which is identical to the previous one on those
+// segments can't change the result, no matter what changed elsewhere on the screen.
+class EdgeDetectionCache
+{
+public:
+    // Returns the last detected edges if detecting them again with the given input would give the same result.
+    // Pass textureChanged = false when the texture is known to be the same one the edges were detected on.
+    std::optional<RECT> Lookup(const BGRATextureView& texture,
+                               const POINT centerPoint,
+                               const bool perChannel,
+                               const uint8_t tolerance,
+                               const bool textureChanged) const;
+
+    void Store(const BGRATextureView& texture,
+               const POINT centerPoint,
+               const bool perChannel,
+               const uint8_t tolerance,
+               const RECT edges);
+
+    void Clear();
+
+private:
+    bool valid = false;
+    POINT centerPoint = {};
+    bool perChannel = false;
+    uint8_t tolerance = 0;
+    RECT edges = {};
+    size_t width = 0;
+    size_t height = 0;
+    std::vector<uint32_t> rowPixels;
+    std::vector<uint32_t> columnPixels;
+
+    // Returns the segments of the row and the column which were scanned to find the edges
+    void ScannedSegments(RECT& row, RECT& column) const;
+};
@@ -57,8 +57,13 @@ LRESULT CALLBACK MeasureToolWndProc(HWND window, UINT message, WPARAM wparam, LP
     {
         if (auto state = GetWindowParam<Serialized<MeasureToolState>*>(window))
         {
-            state->Access([&](MeasureToolState& s) {
-                s.perScreen[window].measuredEdges = {};
+            state->Read([&](const MeasureToolState& s) {
+                if (auto it = s.perScreen.find(window); it != end(s.perScreen))
+                {
+                    it->second.snapshot.Modify([](MeasureToolState::PerScreen::Snapshot& snapshot) {
+                        snapshot.measuredEdges = {};
+                    });
+                }
             });
         }
         break;
@@ -135,13 +140,14 @@ void DrawMeasureToolTick(const CommonState& commonState,
         if (auto it = state.perScreen.find(window); it != end(state.perScreen))
         {
             const auto& perScreen = it->second;
-            if (!perScreen.measuredEdges)
+            const auto snapshot = perScreen.snapshot.Read();
+            if (!snapshot.measuredEdges)
             {
                 return;
             }
 
             gotMeasurement = true;
-            measuredEdges = *perScreen.measuredEdges;
+            measuredEdges = *snapshot.measuredEdges;
 
             if (continuousCapture)
                 return;
@@ -75,6 +75,16 @@ namespace winrt::PowerToys::MeasureToolCore::implementation
             }
         }
         _screenCaptureThreads.clear();
+
+        auto& counters = _commonState.captureCounters;
+        if (const auto captured = counters.framesCaptured.exchange(0))
+        {
+            Logger::trace(L"Measure session frames: captured {}, skipped {}, processed {}",
+                          captured,
+                          counters.framesSkipped.exchange(0),
+                          counters.framesProcessed.exchange(0));
+        }
+
         _measureToolState.Reset();
         _measureToolState.Access([&](MeasureToolState& s) {
             s.commonState = &_commonState;
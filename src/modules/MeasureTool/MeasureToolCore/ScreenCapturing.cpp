@@ -268,32 +268,69 @@ void D3DCaptureState::StopCapture()
     }
 }
 
-void UpdateCaptureState(const CommonState& commonState,
-                        Serialized<MeasureToolState>& state,
-                        HWND window,
-                        const MappedTextureView& textureView)
+using MeasureSnapshot = SeqLock<MeasureToolState::PerScreen::Snapshot>;
+
+// Edge detection state of a single screen, owned by its capturing thread
+struct CapturePipeline
 {
+    const CommonState& commonState;
+    Serialized<MeasureToolState>& state;
+    HWND window;
+    MeasureSnapshot& snapshot;
+    EdgeDetectionCache cache;
+    // Version of the last snapshot we published. If it's different, someone else has changed the snapshot since.
+    uint64_t publishedVersion = 0;
+
+    void ProcessFrame(const MappedTextureView& textureView,
+                      const bool textureChanged,
+                      EdgeDetectionIndex* edgeIndex = nullptr);
+
+    // Can be called from any thread
+    void ClearMeasurement();
+};
+
+void CapturePipeline::ProcessFrame(const MappedTextureView& textureView,
+                                   const bool textureChanged,
+                                   EdgeDetectionIndex* edgeIndex)
+{
+    auto& counters = commonState.captureCounters;
+    counters.framesCaptured.fetch_add(1, std::memory_order_relaxed);
+
     const auto cursorPos = convert::FromSystemToWindow(window, commonState.cursorPosSystemSpace);
-    const bool cursorInLeftScreenHalf = cursorPos.x < textureView.view.width / 2;
-    const bool cursorInTopScreenHalf = cursorPos.y < textureView.view.height / 2;
     uint8_t pixelTolerance = {};
     bool perColorChannelEdgeDetection = {};
-    state.Access([&](MeasureToolState& state) {
-        state.perScreen[window].cursorInLeftScreenHalf = cursorInLeftScreenHalf;
-        state.perScreen[window].cursorInTopScreenHalf = cursorInTopScreenHalf;
+    state.Read([&](const MeasureToolState& state) {
         pixelTolerance = state.global.pixelTolerance;
         perColorChannelEdgeDetection = state.global.perColorChannelEdgeDetection;
     });
 
+    if (snapshot.Version() != publishedVersion)
+    {
+        cache.Clear();
+    }
+
+    // Skip the frame if neither the cursor nor the pixels along its row and column have changed
+    if (cache.Lookup(textureView.view, cursorPos, perColorChannelEdgeDetection, pixelTolerance, textureChanged))
+    {
+        counters.framesSkipped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
     // Every one of 4 edges is a coordinate of the last similar pixel in a row
     // Example: given a 5x5 green square on a blue background with its top-left pixel
     //          at 20x100, bounds should be [20,100]-[24,104]. We don't include [25,105] or
     //          [19,99], since those pixels are blue. Thus, square dims are equal to
     //          [24-20+1,104-100+1]=[5,5].
-    const RECT bounds = DetectEdges(textureView.view,
-                                    cursorPos,
-                                    perColorChannelEdgeDetection,
-                                    pixelTolerance);
+    // A static capture is indexed, so only the first query on a row or column of a run of pixels scans the texture
+    const RECT bounds = edgeIndex ? edgeIndex->DetectEdges(cursorPos,
+                                                           perColorChannelEdgeDetection,
+                                                           pixelTolerance) :
+                                    DetectEdges(textureView.view,
+                                                cursorPos,
+                                                perColorChannelEdgeDetection,
+                                                pixelTolerance);
+    cache.Store(textureView.view, cursorPos, perColorChannelEdgeDetection, pixelTolerance, bounds);
+    counters.framesProcessed.fetch_add(1, std::memory_order_relaxed);
 
 #if defined(DEBUG_EDGES)
     char buffer[256];
@@ -309,8 +346,17 @@ void UpdateCaptureState(const CommonState& commonState,
               textureView.view.height);
     OutputDebugStringA(buffer);
 #endif
-    state.Access([&](MeasureToolState& state) {
-        state.perScreen[window].measuredEdges = Measurement{ bounds };
+    publishedVersion = snapshot.Write({ .cursorInLeftScreenHalf = cursorPos.x < textureView.view.width / 2,
+                                        .cursorInTopScreenHalf = cursorPos.y < textureView.view.height / 2,
+                                        .measuredEdges = Measurement{ bounds } });
+}
+
+void CapturePipeline::ClearMeasurement()
+{
+    // A frame callback might still be running, so the cache is left alone. The next frame sees a newer
+    // snapshot version and drops the cache itself.
+    snapshot.Modify([](MeasureToolState::PerScreen::Snapshot& s) {
+        s.measuredEdges = {};
     });
 }
 
@@ -320,7 +366,13 @@ std::thread StartCapturingThread(DxgiAPI* dxgiAPI,
                                  HWND window,
                                  MonitorInfo monitor)
 {
-    return SpawnLoggedThread(L"Screen Capture thread", [&state, &commonState, monitor, window, dxgiAPI] {
+    // Create the per-screen entry before the thread starts, so its snapshot can be published without the state lock
+    MeasureSnapshot* snapshot = nullptr;
+    state.Access([&](MeasureToolState& s) {
+        snapshot = &s.perScreen[window].snapshot;
+    });
+
+    return SpawnLoggedThread(L"Screen Capture thread", [&state, &commonState, monitor, window, dxgiAPI, snapshot] {
         bool continuousCapture = {};
         state.Read([&](const MeasureToolState& state) {
             continuousCapture = state.global.continuousCapture;
@@ -330,6 +382,7 @@ std::thread StartCapturingThread(DxgiAPI* dxgiAPI,
                                                     monitor,
                                                     winrt::DirectXPixelFormat::B8G8R8A8UIntNormalized,
                                                     continuousCapture);
+        CapturePipeline pipeline{ .commonState = commonState, .state = state, .window = window, .snapshot = *snapshot };
         const auto monitorArea = monitor.GetScreenSize(true);
         bool mouseOnMonitor = false;
         if (continuousCapture)
@@ -345,23 +398,21 @@ std::thread StartCapturingThread(DxgiAPI* dxgiAPI,
                 mouseOnMonitor = !mouseOnMonitor;
                 if (mouseOnMonitor)
                 {
-                    captureState->StartCapture([&, window](MappedTextureView textureView) {
-                        UpdateCaptureState(commonState, state, window, textureView);
+                    captureState->StartCapture([&pipeline](MappedTextureView textureView) {
+                        pipeline.ProcessFrame(textureView, true);
                     });
                 }
                 else
                 {
-                    state.Access([&](MeasureToolState& state) {
-                        state.perScreen[window].measuredEdges = {};
-                    });
-
                     captureState->StopCapture();
+                    pipeline.ClearMeasurement();
                 }
             }
         }
         else
         {
             const auto textureView = captureState->CaptureSingleFrame();
+            EdgeDetectionIndex edgeIndex{ textureView.view };
 
             state.Access([&](MeasureToolState& s) {
                 s.perScreen[window].capturedScreenTexture = &textureView;
@@ -380,14 +431,13 @@ std::thread StartCapturingThread(DxgiAPI* dxgiAPI,
                     auto path = std::filesystem::temp_directory_path() / buf;
                     textureView.view.SaveAsBitmap(path.string().c_str());
 #endif
-                    UpdateCaptureState(commonState, state, window, textureView);
+                    // The captured frame never changes, so only a cursor move or a settings change needs a detection
+                    pipeline.ProcessFrame(textureView, false, &edgeIndex);
                     mouseOnMonitor = true;
                 }
                 else if (mouseOnMonitor)
                 {
-                    state.Access([&](MeasureToolState& state) {
-                        state.perScreen[window].measuredEdges = {};
-                    });
+                    pipeline.ClearMeasurement();
                     mouseOnMonitor = false;
                 }
 
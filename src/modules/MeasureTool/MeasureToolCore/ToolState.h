@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <atomic>
 #include <functional>
 #include <mutex>
 #include <vector>
@@ -12,6 +13,7 @@
 #include <dCommon.h>
 
 #include <common/Display/monitors.h>
+#include <common/utils/seqlock.h>
 #include <common/utils/serialized.h>
 
 //#define DEBUG_OVERLAY
@@ -23,6 +25,15 @@ struct OverlayBoxText
     std::array<wchar_t, 128> buffer = {};
 };
 
+// Frames are counted once the cursor is on their screen. Every counted frame is either skipped, because it can't
+// change the last measurement, or processed.
+struct CaptureCounters
+{
+    std::atomic_uint64_t framesCaptured = 0;
+    std::atomic_uint64_t framesSkipped = 0;
+    std::atomic_uint64_t framesProcessed = 0;
+};
+
 struct CommonState
 {
     std::function<void()> sessionCompletedCallback;
@@ -34,6 +45,7 @@ struct CommonState
     mutable Serialized<OverlayBoxText> overlayBoxText;
     POINT cursorPosSystemSpace = {}; // updated atomically
     std::atomic_bool closeOnOtherMonitors = false;
+    mutable CaptureCounters captureCounters;
 };
 
 struct CursorDrag
@@ -77,9 +89,15 @@ struct MeasureToolState
 
     struct PerScreen
     {
-        bool cursorInLeftScreenHalf = false;
-        bool cursorInTopScreenHalf = false;
-        std::optional<Measurement> measuredEdges;
+        struct Snapshot
+        {
+            bool cursorInLeftScreenHalf = false;
+            bool cursorInTopScreenHalf = false;
+            std::optional<Measurement> measuredEdges;
+        };
+        // Published by the capturing thread for every processed frame. It's read and written without taking
+        // the state lock, so the entry must be created before the capturing thread starts.
+        mutable SeqLock<Snapshot> snapshot;
         // While not in a continuous capturing mode, we need to draw captured backgrounds. These are passed
         // directly from a capturing thread.
         const MappedTextureView* capturedScreenTexture = nullptr;
@@ -0,0 +1,413 @@
+#include "pch.h"
+
+#include <EdgeDetection.h>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace MeasureToolUnitTests
+{
+    // Pixel by pixel scan used by DetectEdges before it was vectorized, kept as the reference implementation
+    template<bool PerChannel, bool IsX, bool Increment>
+    long FindEdgeReference(const BGRATextureView& texture, const POINT centerPoint, const uint8_t tolerance)
+    {
+        const size_t maxDim = IsX ? texture.width : texture.height;
+
+        long x = std::clamp<long>(centerPoint.x, 1, static_cast<long>(texture.width - 2));
+        long y = std::clamp<long>(centerPoint.y, 1, static_cast<long>(texture.height - 2));
+
+        const uint32_t startPixel = texture.GetPixel(x, y);
+        while (true)
+        {
+            long oldX = x;
+            long oldY = y;
+            long& pos = IsX ? x : y;
+            if constexpr (Increment)
+            {
+                if (++pos == static_cast<long>(maxDim))
+                    break;
+            }
+            else
+            {
+                if (--pos == 0)
+                    break;
+            }
+
+            if (!texture.PixelsClose<PerChannel>(startPixel, texture.GetPixel(x, y), tolerance))
+            {
+                return IsX ? oldX : oldY;
+            }
+        }
+
+        return Increment ? static_cast<long>(maxDim) - 1 : 0;
+    }
+
+    template<bool PerChannel>
+    RECT DetectEdgesReference(const BGRATextureView& texture, const POINT centerPoint, const uint8_t tolerance)
+    {
+        return RECT{ .left = FindEdgeReference<PerChannel, true, false>(texture, centerPoint, tolerance),
+                     .top = FindEdgeReference<PerChannel, false, false>(texture, centerPoint, tolerance),
+                     .right = FindEdgeReference<PerChannel, true, true>(texture, centerPoint, tolerance),
+                     .bottom = FindEdgeReference<PerChannel, false, true>(texture, centerPoint, tolerance) };
+    }
+
+    RECT DetectEdgesReference(const BGRATextureView& texture, const POINT centerPoint, const bool perChannel, const uint8_t tolerance)
+    {
+        return perChannel ? DetectEdgesReference<true>(texture, centerPoint, tolerance) : DetectEdgesReference<false>(texture, centerPoint, tolerance);
+    }
+
+    struct SyntheticTexture
+    {
+        std::vector<uint32_t> pixels;
+        BGRATextureView view;
+
+        SyntheticTexture(const size_t width, const size_t height, const size_t pitch)
+        {
+            pixels.resize(pitch * height);
+            view.pixels = pixels.data();
+            view.pitch = pitch;
+            view.width = width;
+            view.height = height;
+        }
+    };
+
+    // Desktop-like content: a flat background with overlapping solid windows and some slightly noisy areas
+    SyntheticTexture MakeDesktopTexture(const size_t width, const size_t height, std::mt19937& rng)
+    {
+        SyntheticTexture texture{ width, height, width };
+        std::fill(texture.pixels.begin(), texture.pixels.end(), 0xFF202020);
+        for (int i = 0; i < 200; i++)
+        {
+            const size_t left = rng() % width;
+            const size_t top = rng() % height;
+            const size_t right = std::min(width, left + rng() % (width / 4));
+            const size_t bottom = std::min(height, top + rng() % (height / 4));
+            const uint32_t color = rng() | 0xFF000000;
+            const bool noisy = i % 10 == 0;
+            for (size_t y = top; y < bottom; y++)
+            {
+                for (size_t x = left; x < right; x++)
+                {
+                    texture.pixels[x + y * width] = noisy ? color ^ (rng() & 0x00070707) : color;
+                }
+            }
+        }
+
+        return texture;
+    }
+
+    std::vector<POINT> MakeCursorPath(const size_t width, const size_t height, const size_t count, std::mt19937& rng)
+    {
+        std::vector<POINT> path;
+        POINT cursor{ static_cast<long>(width / 2), static_cast<long>(height / 2) };
+        for (size_t i = 0; i < count; i++)
+        {
+            cursor.x = std::clamp<long>(cursor.x + static_cast<long>(rng() % 21) - 10, 0, static_cast<long>(width) - 1);
+            cursor.y = std::clamp<long>(cursor.y + static_cast<long>(rng() % 21) - 10, 0, static_cast<long>(height) - 1);
+            path.push_back(cursor);
+        }
+
+        return path;
+    }
+
+    void AssertSameBounds(const RECT& expected, const RECT& actual)
+    {
+        Assert::AreEqual(expected.left, actual.left);
+        Assert::AreEqual(expected.top, actual.top);
+        Assert::AreEqual(expected.right, actual.right);
+        Assert::AreEqual(expected.bottom, actual.bottom);
+    }
+
+    TEST_CLASS (EdgeDetectionTests)
+    {
+    public:
+        TEST_METHOD (DetectEdges_MatchesReference_OnRandomTextures)
+        {
+            std::mt19937 rng(42);
+            for (int iteration = 0; iteration < 300; iteration++)
+            {
+                // Odd sizes and padded rows exercise the tails of the 16 and 4 pixel blocks
+                const size_t width = 3 + rng() % 70;
+                const size_t height = 3 + rng() % 70;
+                SyntheticTexture texture{ width, height, width + rng() % 5 };
+                const uint32_t base = rng();
+                for (auto& pixel : texture.pixels)
+                {
+                    switch (iteration % 3)
+                    {
+                    case 0:
+                        pixel = rng();
+                        break;
+                    case 1:
+                        pixel = rng() % 4 == 0 ? base ^ (rng() & 0x0F0F0F0F) : base;
+                        break;
+                    default:
+                        pixel = rng() % 20 == 0 ? rng() : base;
+                        break;
+                    }
+                }
+
+                for (int query = 0; query < 100; query++)
+                {
+                    const POINT cursor{ static_cast<long>(rng() % (width + 4)) - 2, static_cast<long>(rng() % (height + 4)) - 2 };
+                    const uint8_t tolerance = static_cast<uint8_t>(rng());
+                    const bool perChannel = rng() % 2;
+                    AssertSameBounds(DetectEdgesReference(texture.view, cursor, perChannel, tolerance),
+                                     DetectEdges(texture.view, cursor, perChannel, tolerance));
+                }
+            }
+        }
+
+        TEST_METHOD (DetectEdges_FindsSolidRectangle)
+        {
+            SyntheticTexture texture{ 100, 100, 100 };
+            std::fill(texture.pixels.begin(), texture.pixels.end(), 0xFF0000FF);
+            for (size_t y = 20; y <= 24; y++)
+            {
+                for (size_t x = 20; x <= 24; x++)
+                {
+                    texture.pixels[x + y * 100] = 0xFF00FF00;
+                }
+            }
+
+            const RECT bounds = DetectEdges(texture.view, POINT{ 22, 22 }, false, 30);
+            AssertSameBounds(RECT{ 20, 20, 24, 24 }, bounds);
+        }
+
+        TEST_METHOD (EdgeDetectionIndex_MatchesReference_AlongCursorPath)
+        {
+            std::mt19937 rng(7);
+            auto texture = MakeDesktopTexture(640, 480, rng);
+            EdgeDetectionIndex index{ texture.view };
+            for (const auto& cursor : MakeCursorPath(640, 480, 5000, rng))
+            {
+                AssertSameBounds(DetectEdgesReference(texture.view, cursor, false, 30),
+                                 index.DetectEdges(cursor, false, 30));
+            }
+        }
+
+        TEST_METHOD (EdgeDetectionIndex_MatchesReference_WhenSettingsChange)
+        {
+            std::mt19937 rng(11);
+            auto texture = MakeDesktopTexture(320, 240, rng);
+            EdgeDetectionIndex index{ texture.view };
+            for (const auto& cursor : MakeCursorPath(320, 240, 2000, rng))
+            {
+                const uint8_t tolerance = static_cast<uint8_t>(rng() % 4 * 10);
+                const bool perChannel = rng() % 2;
+                AssertSameBounds(DetectEdgesReference(texture.view, cursor, perChannel, tolerance),
+                                 index.DetectEdges(cursor, perChannel, tolerance));
+            }
+        }
+
+        TEST_METHOD (EdgeDetectionIndex_MatchesReference_OnNoisyTexture)
+        {
+            std::mt19937 rng(13);
+            SyntheticTexture texture{ 200, 200, 200 };
+            for (auto& pixel : texture.pixels)
+            {
+                pixel = rng();
+            }
+
+            EdgeDetectionIndex index{ texture.view };
+            for (const auto& cursor : MakeCursorPath(200, 200, 1000, rng))
+            {
+                AssertSameBounds(DetectEdgesReference(texture.view, cursor, true, 100),
+                                 index.DetectEdges(cursor, true, 100));
+            }
+        }
+
+        // Reports the per query cost on desktop-like 4K and 8K captures, following a cursor path
+        BEGIN_TEST_METHOD_ATTRIBUTE(Benchmark_DetectEdges_4K_8K)
+            TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD (Benchmark_DetectEdges_4K_8K)
+        {
+            using clock = std::chrono::steady_clock;
+            struct Resolution
+            {
+                const wchar_t* name;
+                size_t width;
+                size_t height;
+            };
+
+            for (const auto& resolution : { Resolution{ L"4K", 3840, 2160 }, Resolution{ L"8K", 7680, 4320 } })
+            {
+                std::mt19937 rng(1);
+                auto texture = MakeDesktopTexture(resolution.width, resolution.height, rng);
+                const auto path = MakeCursorPath(resolution.width, resolution.height, 2000, rng);
+
+                long checksum = 0;
+                auto start = clock::now();
+                for (const auto& cursor : path)
+                {
+                    checksum += DetectEdgesReference(texture.view, cursor, false, 30).right;
+                }
+                const auto reference = clock::now() - start;
+
+                start = clock::now();
+                for (const auto& cursor : path)
+                {
+                    checksum -= DetectEdges(texture.view, cursor, false, 30).right;
+                }
+                const auto vectorized = clock::now() - start;
+
+                EdgeDetectionIndex index{ texture.view };
+                start = clock::now();
+                for (const auto& cursor : path)
+                {
+                    checksum += index.DetectEdges(cursor, false, 30).right;
+                }
+                const auto indexFirstPass = clock::now() - start;
+
+                start = clock::now();
+                for (const auto& cursor : path)
+                {
+                    checksum -= index.DetectEdges(cursor, false, 30).right;
+                }
+                const auto indexSecondPass = clock::now() - start;
+
+                Assert::AreEqual(0l, checksum);
+
+                auto perQuery = [&](const clock::duration duration) {
+                    return std::chrono::duration<double, std::micro>(duration).count() / path.size();
+                };
+                Logger::WriteMessage(std::format(L"{}: reference {:.2f}us, vectorized {:.2f}us, index first pass {:.2f}us, index second pass {:.2f}us per query\n",
+                                                 resolution.name,
+                                                 perQuery(reference),
+                                                 perQuery(vectorized),
+                                                 perQuery(indexFirstPass),
+                                                 perQuery(indexSecondPass))
+                                         .c_str());
+            }
+        }
+    };
+
+    TEST_CLASS (EdgeDetectionCacheTests)
+    {
+    public:
+        TEST_METHOD (Lookup_IsEmpty_BeforeStore)
+        {
+            SyntheticTexture texture{ 50, 50, 50 };
+            EdgeDetectionCache cache;
+            Assert::IsFalse(cache.Lookup(texture.view, POINT{ 10, 10 }, false, 30, true).has_value());
+        }
+
+        TEST_METHOD (Lookup_Hits_WhenChangeIsOutsideScannedSegments)
+        {
+            std::mt19937 rng(3);
+            auto texture = MakeDesktopTexture(320, 240, rng);
+            const POINT cursor{ 100, 100 };
+            const RECT bounds = DetectEdges(texture.view, cursor, false, 30);
+
+            EdgeDetectionCache cache;
+            cache.Store(texture.view, cursor, false, 30, bounds);
+
+            // Nothing changed
+            auto cached = cache.Lookup(texture.view, cursor, false, 30, true);
+            Assert::IsTrue(cached.has_value());
+            AssertSameBounds(bounds, *cached);
+
+            // A pixel off the cursor row and column changed
+            texture.pixels[(cursor.x + 1) + (cursor.y + 1) * 320] ^= 0x00FFFFFF;
+            cached = cache.Lookup(texture.view, cursor, false, 30, true);
+            Assert::IsTrue(cached.has_value());
+            AssertSameBounds(DetectEdges(texture.view, cursor, false, 30), *cached);
+        }
+
+        TEST_METHOD (Lookup_Misses_WhenInputChanges)
+        {
+            std::mt19937 rng(5);
+            auto texture = MakeDesktopTexture(320, 240, rng);
+            const POINT cursor{ 150, 120 };
+
+            EdgeDetectionCache cache;
+            cache.Store(texture.view, cursor, false, 30, DetectEdges(texture.view, cursor, false, 30));
+
+            Assert::IsFalse(cache.Lookup(texture.view, POINT{ 151, 120 }, false, 30, false).has_value());
+            Assert::IsFalse(cache.Lookup(texture.view, cursor, true, 30, false).has_value());
+            Assert::IsFalse(cache.Lookup(texture.view, cursor, false, 31, false).has_value());
+
+            // A changed pixel on the cursor row is only noticed when the texture may have changed
+            texture.pixels[cursor.x + 1 + cursor.y * 320] ^= 0x00FFFFFF;
+            Assert::IsTrue(cache.Lookup(texture.view, cursor, false, 30, false).has_value());
+            Assert::IsFalse(cache.Lookup(texture.view, cursor, false, 30, true).has_value());
+
+            cache.Store(texture.view, cursor, false, 30, DetectEdges(texture.view, cursor, false, 30));
+            cache.Clear();
+            Assert::IsFalse(cache.Lookup(texture.view, cursor, false, 30, false).has_value());
+        }
+
+        TEST_METHOD (Lookup_Misses_WhenPixelPastEdgeChanges)
+        {
+            SyntheticTexture texture{ 100, 100, 100 };
+            std::fill(texture.pixels.begin(), texture.pixels.end(), 0xFF0000FF);
+            for (size_t y = 20; y <= 24; y++)
+            {
+                for (size_t x = 20; x <= 24; x++)
+                {
+                    texture.pixels[x + y * 100] = 0xFF00FF00;
+                }
+            }
+
+            const POINT cursor{ 22, 22 };
+            EdgeDetectionCache cache;
+            cache.Store(texture.view, cursor, false, 30, DetectEdges(texture.view, cursor, false, 30));
+
+            // Recoloring the pixel right of the square grows it
+            texture.pixels[25 + 22 * 100] = 0xFF00FF00;
+            Assert::IsFalse(cache.Lookup(texture.view, cursor, false, 30, true).has_value());
+            AssertSameBounds(RECT{ 20, 20, 25, 24 }, DetectEdges(texture.view, cursor, false, 30));
+        }
+
+        // Simulates a continuous capture: every frame changes a few random areas and the cursor sometimes moves.
+        // Whenever the cache skips a frame, detecting the edges on it must give the cached result.
+        TEST_METHOD (Lookup_MatchesDetection_OnChangingFrames)
+        {
+            std::mt19937 rng(17);
+            const size_t width = 320;
+            const size_t height = 240;
+            auto texture = MakeDesktopTexture(width, height, rng);
+            const auto path = MakeCursorPath(width, height, 3000, rng);
+
+            EdgeDetectionCache cache;
+            size_t skipped = 0;
+            POINT cursor = path[0];
+            for (size_t frame = 0; frame < path.size(); frame++)
+            {
+                if (frame % 8 == 0)
+                {
+                    cursor = path[frame];
+                }
+
+                for (int change = 0; change < 3; change++)
+                {
+                    const size_t left = rng() % width;
+                    const size_t top = rng() % height;
+                    const uint32_t color = rng() % 2 ? rng() : 0xFF202020;
+                    for (size_t y = top; y < std::min(height, top + 4); y++)
+                    {
+                        for (size_t x = left; x < std::min(width, left + 4); x++)
+                        {
+                            texture.pixels[x + y * width] = color;
+                        }
+                    }
+                }
+
+                const RECT expected = DetectEdgesReference(texture.view, cursor, false, 30);
+                if (const auto cached = cache.Lookup(texture.view, cursor, false, 30, true))
+                {
+                    AssertSameBounds(expected, *cached);
+                    skipped++;
+                }
+                else
+                {
+                    cache.Store(texture.view, cursor, false, 30, expected);
+                }
+            }
+
+            // Most frames change nothing along the cursor cross
+            Assert::IsTrue(skipped > path.size() / 2);
+        }
+    };
+}
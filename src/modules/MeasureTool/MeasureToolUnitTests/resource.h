@@ -0,0 +1,13 @@
+//{{NO_DEPENDENCIES}}
+// Microsoft Visual C++ generated include file.
+// Used by MeasureToolUnitTests.rc
+
+//////////////////////////////
+// Non-localizable
+
+#define FILE_DESCRIPTION "PowerToys MeasureToolUnitTests"
+#define INTERNAL_NAME "MeasureToolUnitTests"
+#define ORIGINAL_FILENAME "MeasureToolUnitTests.dll"
+
+// Non-localizable
+//////////////////////////////
@@ -5,6 +5,12 @@
 #include "MouseHighlighter.h"
 #include "trace.h"
 
+#include <common/Display/CompositorFrameCoalescer.h>
+#include <common/Display/MonitorTopology.h>
+
+#include <algorithm>
+#include <deque>
+
 #ifdef COMPOSITION
 namespace winrt
 {
@@ -40,11 +46,16 @@ private:
     void StartDrawing();
     void StopDrawing();
     bool CreateHighlighter();
+    POINT CursorClientPosition() const;
+    winrt::CompositionSpriteShape AcquireShape(winrt::Windows::UI::Color color);
+    void ReleaseShape(winrt::CompositionSpriteShape shape);
     void AddDrawingPoint(MouseButton button);
     void UpdateDrawingPointPosition(MouseButton button);
+    void UpdateDrawingPointPositions();
     void StartDrawingPointFading(MouseButton button);
     void ClearDrawingPoint(MouseButton button);
     void ClearDrawing();
+    void UpdateWindowBounds();
     void BringToFront();
     HHOOK m_mouseHook = NULL;
     static LRESULT CALLBACK MouseHookProc(int nCode, WPARAM wParam, LPARAM lParam) noexcept;
@@ -55,6 +66,13 @@ private:
     HWND m_hwnd = NULL;
     HINSTANCE m_hinstance = NULL;
     static constexpr DWORD WM_SWITCH_ACTIVATION_MODE = WM_APP;
+    static constexpr DWORD WM_UPDATE_DRAWING_POINTS = WM_APP + 1;
+
+    // Mouse moves only request an update, applied once per compositor frame with the latest cursor position
+    std::unique_ptr<CompositorFrameCoalescer> m_frameCoalescer;
+    MonitorTopologyCache m_monitorTopology;
+    // Screen position of the window's client area
+    POINT m_windowOrigin{};
 
     winrt::DispatcherQueueController m_dispatcherQueueController{ nullptr };
     winrt::Compositor m_compositor{ nullptr };
@@ -67,6 +85,17 @@ private:
     winrt::CompositionSpriteShape m_rightPointer{ nullptr };
     winrt::CompositionSpriteShape m_alwaysPointer{ nullptr };
 
+    // Circles are recycled instead of being appended for every click, so long sessions don't grow the visual tree.
+    // Every shape has its own brush, since fading animates the brush color. They share the geometry of the current
+    // radius, which is replaced rather than changed so that circles still fading keep the radius they were drawn with.
+    static constexpr size_t MAX_SHAPES = 16;
+    winrt::CompositionEllipseGeometry m_circleGeometry{ nullptr };
+    std::vector<winrt::CompositionSpriteShape> m_freeShapes;
+    // Oldest first. The id tells apart the fade a completion belongs to, once the shape has been reused.
+    std::deque<std::pair<winrt::CompositionSpriteShape, uint64_t>> m_fadingShapes;
+    uint64_t m_lastFadeId = 0;
+    size_t m_shapeCount = 0;
+
     bool m_leftPointerEnabled = true;
     bool m_rightPointerEnabled = true;
     bool m_alwaysPointerEnabled = true;
@@ -121,6 +150,11 @@ bool Highlighter::CreateHighlighter()
         m_shape.RelativeSizeAdjustment({ 1.0f, 1.0f });
         m_root.Children().InsertAtTop(m_shape);
 
+        m_circleGeometry = m_compositor.CreateEllipseGeometry();
+        m_circleGeometry.Radius({ m_radius, m_radius });
+
+        m_frameCoalescer = std::make_unique<CompositorFrameCoalescer>(m_hwnd, WM_UPDATE_DRAWING_POINTS);
+
         return true;
     } catch (...)
     {
@@ -128,7 +162,7 @@ bool Highlighter::CreateHighlighter()
     }
 }
 
-void Highlighter::AddDrawingPoint(MouseButton button)
+POINT Highlighter::CursorClientPosition() const
 {
     POINT pt;
 
@@ -136,74 +170,132 @@ void Highlighter::AddDrawingPoint(MouseButton button)
     GetCursorPos(&pt);
 
     // Converts to client area of the Windows.
-    ScreenToClient(m_hwnd, &pt);
+    pt.x -= m_windowOrigin.x;
+    pt.y -= m_windowOrigin.y;
+    return pt;
+}
 
-    // Create circle and add it.
-    auto circleGeometry = m_compositor.CreateEllipseGeometry();
-    circleGeometry.Radius({ m_radius, m_radius });
-    auto circleShape = m_compositor.CreateSpriteShape(circleGeometry);
-    circleShape.Offset({ static_cast<float>(pt.x), static_cast<float>(pt.y) });
+winrt::CompositionSpriteShape Highlighter::AcquireShape(winrt::Windows::UI::Color color)
+{
+    if (m_circleGeometry.Radius().x != m_radius)
+    {
+        m_circleGeometry = m_compositor.CreateEllipseGeometry();
+        m_circleGeometry.Radius({ m_radius, m_radius });
+    }
+
+    winrt::CompositionSpriteShape circleShape{ nullptr };
+    if (!m_freeShapes.empty())
+    {
+        circleShape = m_freeShapes.back();
+        m_freeShapes.pop_back();
+    }
+    else if (m_shapeCount < MAX_SHAPES || m_fadingShapes.empty())
+    {
+        circleShape = m_compositor.CreateSpriteShape(m_circleGeometry);
+        circleShape.FillBrush(m_compositor.CreateColorBrush());
+        m_shape.Shapes().Append(circleShape);
+        ++m_shapeCount;
+    }
+    else
+    {
+        // Every shape is in use, cut the oldest fade short
+        circleShape = m_fadingShapes.front().first;
+        m_fadingShapes.pop_front();
+    }
+
+    if (circleShape.Geometry() != m_circleGeometry)
+    {
+        circleShape.Geometry(m_circleGeometry);
+    }
+
+    auto brush = circleShape.FillBrush().as<winrt::CompositionColorBrush>();
+    brush.StopAnimation(L"Color");
+    brush.Color(color);
+    return circleShape;
+}
+
+void Highlighter::ReleaseShape(winrt::CompositionSpriteShape shape)
+{
+    shape.FillBrush().as<winrt::CompositionColorBrush>().Color(winrt::Windows::UI::ColorHelper::FromArgb(0, 0, 0, 0));
+    m_freeShapes.push_back(shape);
+}
+
+void Highlighter::AddDrawingPoint(MouseButton button)
+{
+    const POINT pt = CursorClientPosition();
+
+    winrt::CompositionSpriteShape circleShape{ nullptr };
     if (button == MouseButton::Left)
     {
-        circleShape.FillBrush(m_compositor.CreateColorBrush(m_leftClickColor));
+        circleShape = AcquireShape(m_leftClickColor);
         m_leftPointer = circleShape;
     }
     else if (button == MouseButton::Right)
     {
-        circleShape.FillBrush(m_compositor.CreateColorBrush(m_rightClickColor));
+        circleShape = AcquireShape(m_rightClickColor);
         m_rightPointer = circleShape;
     }
     else
     {
         // always
-        circleShape.FillBrush(m_compositor.CreateColorBrush(m_alwaysColor));
+        circleShape = AcquireShape(m_alwaysColor);
         m_alwaysPointer = circleShape;
     }
-    m_shape.Shapes().Append(circleShape);
-
-    // TODO: We're leaking shapes for long drawing sessions.
-    // Perhaps add a task to the Dispatcher every X circles to clean up.
+    circleShape.Offset({ static_cast<float>(pt.x), static_cast<float>(pt.y) });
 
-    // Get back on top in case other Window is now the topmost.
-    // HACK: Draw with 1 pixel off. Otherwise Windows glitches the task bar transparency when a transparent window fill the whole screen.
-    SetWindowPos(m_hwnd, HWND_TOPMOST, GetSystemMetrics(SM_XVIRTUALSCREEN) + 1, GetSystemMetrics(SM_YVIRTUALSCREEN) + 1, GetSystemMetrics(SM_CXVIRTUALSCREEN) - 2, GetSystemMetrics(SM_CYVIRTUALSCREEN) - 2, 0);
+    if (button != MouseButton::None)
+    {
+        // Get back on top in case other Window is now the topmost.
+        BringToFront();
+    }
 }
 
 void Highlighter::UpdateDrawingPointPosition(MouseButton button)
 {
-    POINT pt;
-
-    // Applies DPIs.
-    GetCursorPos(&pt);
-
-    // Converts to client area of the Windows.
-    ScreenToClient(m_hwnd, &pt);
+    const POINT pt = CursorClientPosition();
 
-    if (button == MouseButton::Left)
+    if (button == MouseButton::Left && m_leftPointer)
     {
         m_leftPointer.Offset({ static_cast<float>(pt.x), static_cast<float>(pt.y) });
     }
-    else if (button == MouseButton::Right)
+    else if (button == MouseButton::Right && m_rightPointer)
     {
         m_rightPointer.Offset({ static_cast<float>(pt.x), static_cast<float>(pt.y) });
     }
-    else
+    else if (button == MouseButton::None && m_alwaysPointer)
     {
-        // always
         m_alwaysPointer.Offset({ static_cast<float>(pt.x), static_cast<float>(pt.y) });
     }
 }
+
+void Highlighter::UpdateDrawingPointPositions()
+{
+    if (m_leftButtonPressed)
+    {
+        UpdateDrawingPointPosition(MouseButton::Left);
+    }
+    if (m_rightButtonPressed)
+    {
+        UpdateDrawingPointPosition(MouseButton::Right);
+    }
+    if (m_alwaysPointerEnabled && !m_leftButtonPressed && !m_rightButtonPressed)
+    {
+        UpdateDrawingPointPosition(MouseButton::None);
+    }
+}
 void Highlighter::StartDrawingPointFading(MouseButton button)
 {
     winrt::Windows::UI::Composition::CompositionSpriteShape circleShape{ nullptr };
     if (button == MouseButton::Left)
     {
         circleShape = m_leftPointer;
+        m_leftPointer = nullptr;
     }
     else
     {
         // right
         circleShape = m_rightPointer;
+        m_rightPointer = nullptr;
     }
 
     auto brushColor = circleShape.FillBrush().as<winrt::Windows::UI::Composition::CompositionColorBrush>().Color();
@@ -226,17 +318,31 @@ void Highlighter::StartDrawingPointFading(MouseButton button)
     animation.Duration(timeSpan(duration));
     animation.DelayTime(timeSpan(delay));
 
+    // Give the shape back to the pool once it faded out
+    const uint64_t fadeId = ++m_lastFadeId;
+    m_fadingShapes.emplace_back(circleShape, fadeId);
+    auto batch = m_compositor.CreateScopedBatch(winrt::CompositionBatchTypes::Animation);
     circleShape.FillBrush().StartAnimation(L"Color", animation);
+    batch.End();
+    batch.Completed([this, fadeId](auto&&, auto&&) {
+        const auto fading = std::find_if(m_fadingShapes.begin(), m_fadingShapes.end(), [fadeId](const auto& entry) { return entry.second == fadeId; });
+        if (fading != m_fadingShapes.end())
+        {
+            auto shape = fading->first;
+            m_fadingShapes.erase(fading);
+            ReleaseShape(shape);
+        }
+    });
 }
 
 void Highlighter::ClearDrawingPoint(MouseButton _button)
 {
-    winrt::Windows::UI::Composition::CompositionSpriteShape circleShape{ nullptr };
-
     // always
-    circleShape = m_alwaysPointer;
-
-    circleShape.FillBrush().as<winrt::Windows::UI::Composition::CompositionColorBrush>().Color(winrt::Windows::UI::ColorHelper::FromArgb(0, 0, 0, 0));
+    if (m_alwaysPointer)
+    {
+        ReleaseShape(m_alwaysPointer);
+        m_alwaysPointer = nullptr;
+    }
 }
 
 void Highlighter::ClearDrawing()
@@ -248,6 +354,9 @@ void Highlighter::ClearDrawing()
     }
 
     m_shape.Shapes().Clear();
+    m_freeShapes.clear();
+    m_fadingShapes.clear();
+    m_shapeCount = 0;
 }
 
 LRESULT CALLBACK Highlighter::MouseHookProc(int nCode, WPARAM wParam, LPARAM lParam) noexcept
@@ -294,18 +403,7 @@ LRESULT CALLBACK Highlighter::MouseHookProc(int nCode, WPARAM wParam, LPARAM lPa
             }
             break;
         case WM_MOUSEMOVE:
-            if (instance->m_leftButtonPressed)
-            {
-                instance->UpdateDrawingPointPosition(MouseButton::Left);
-            }
-            if (instance->m_rightButtonPressed)
-            {
-                instance->UpdateDrawingPointPosition(MouseButton::Right);
-            }
-            if (instance->m_alwaysPointerEnabled && !instance->m_leftButtonPressed && !instance->m_rightButtonPressed)
-            {
-                instance->UpdateDrawingPointPosition(MouseButton::None);
-            }
+            instance->m_frameCoalescer->Request();
             break;
         case WM_LBUTTONUP:
             if (instance->m_leftButtonPressed)
@@ -344,8 +442,7 @@ void Highlighter::StartDrawing()
     Trace::StartHighlightingSession();
     m_visible = true;
 
-    // HACK: Draw with 1 pixel off. Otherwise Windows glitches the task bar transparency when a transparent window fill the whole screen.
-    SetWindowPos(m_hwnd, HWND_TOPMOST, GetSystemMetrics(SM_XVIRTUALSCREEN) + 1, GetSystemMetrics(SM_YVIRTUALSCREEN) + 1, GetSystemMetrics(SM_CXVIRTUALSCREEN) - 2, GetSystemMetrics(SM_CYVIRTUALSCREEN) - 2, 0);
+    UpdateWindowBounds();
     ClearDrawing();
     ShowWindow(m_hwnd, SW_SHOWNOACTIVATE);
     instance->AddDrawingPoint(MouseButton::None);
@@ -384,14 +481,25 @@ void Highlighter::ApplySettings(MouseHighlighterSettings settings) {
     m_alwaysPointerEnabled = settings.alwaysColor.A != 0;
 }
 
-void Highlighter::BringToFront() {
+// Covers the virtual screen with the window. Only needed when the monitors change.
+void Highlighter::UpdateWindowBounds()
+{
+    const auto topology = m_monitorTopology.Current();
+    const auto& virtualScreen = topology->VirtualScreen();
+
     // HACK: Draw with 1 pixel off. Otherwise Windows glitches the task bar transparency when a transparent window fill the whole screen.
-    SetWindowPos(m_hwnd, HWND_TOPMOST, GetSystemMetrics(SM_XVIRTUALSCREEN) + 1, GetSystemMetrics(SM_YVIRTUALSCREEN) + 1, GetSystemMetrics(SM_CXVIRTUALSCREEN) - 2, GetSystemMetrics(SM_CYVIRTUALSCREEN) - 2, 0);
+    m_windowOrigin = { virtualScreen.left() + 1, virtualScreen.top() + 1 };
+    SetWindowPos(m_hwnd, HWND_TOPMOST, m_windowOrigin.x, m_windowOrigin.y, virtualScreen.width() - 2, virtualScreen.height() - 2, 0);
+}
+
+void Highlighter::BringToFront() {
+    SetWindowPos(m_hwnd, HWND_TOPMOST, 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE);
 }
 
 void Highlighter::DestroyHighlighter()
 {
     StopDrawing();
+    m_frameCoalescer.reset();
     PostQuitMessage(0);
 }
 
@@ -416,6 +524,22 @@ LRESULT CALLBACK Highlighter::WndProc(HWND hWnd, UINT message, WPARAM wParam, LP
             instance->StartDrawing();
         }
         break;
+    case WM_UPDATE_DRAWING_POINTS:
+        instance->m_frameCoalescer->Acknowledge();
+        if (instance->m_visible)
+        {
+            instance->UpdateDrawingPointPositions();
+        }
+        break;
+    case WM_DISPLAYCHANGE:
+    case WM_DPICHANGED:
+    case WM_SETTINGCHANGE:
+        if (instance->m_monitorTopology.HandleMessage(message, wParam) && instance->m_visible)
+        {
+            instance->UpdateWindowBounds();
+            instance->UpdateDrawingPointPositions();
+        }
+        return DefWindowProc(hWnd, message, wParam, lParam);
     case WM_DESTROY:
         instance->DestroyHighlighter();
         break;
@@ -5,6 +5,9 @@
 #include "InclusiveCrosshairs.h"
 #include "trace.h"
 
+#include <common/Display/CompositorFrameCoalescer.h>
+#include <common/Display/MonitorTopology.h>
+
 #ifdef COMPOSITION
 namespace winrt
 {
@@ -39,6 +42,7 @@ private:
     void StartDrawing();
     void StopDrawing();
     bool CreateInclusiveCrosshairs();
+    void UpdateWindowBounds();
     void UpdateCrosshairsPosition();
     HHOOK m_mouseHook = NULL;
     static LRESULT CALLBACK MouseHookProc(int nCode, WPARAM wParam, LPARAM lParam) noexcept;
@@ -50,6 +54,14 @@ private:
     HWND m_hwnd = NULL;
     HINSTANCE m_hinstance = NULL;
     static constexpr DWORD WM_SWITCH_ACTIVATION_MODE = WM_APP;
+    static constexpr DWORD WM_UPDATE_CROSSHAIRS = WM_APP + 1;
+
+    // Mouse moves only request an update, applied once per compositor frame with the latest cursor position
+    std::unique_ptr<CompositorFrameCoalescer> m_frameCoalescer;
+    MonitorTopologyCache m_monitorTopology;
+    std::shared_ptr<const MonitorTopology> m_topology;
+    // Screen position of the window's client area
+    POINT m_windowOrigin{};
 
     winrt::DispatcherQueueController m_dispatcherQueueController{ nullptr };
     winrt::Compositor m_compositor{ nullptr };
@@ -167,6 +179,9 @@ bool InclusiveCrosshairs::CreateInclusiveCrosshairs()
         m_crosshairs_border_layer.Children().InsertAtTop(m_crosshairs_layer);
         m_crosshairs_layer.Opacity(1.0f);
 
+        m_frameCoalescer = std::make_unique<CompositorFrameCoalescer>(m_hwnd, WM_UPDATE_CROSSHAIRS);
+
+        UpdateWindowBounds();
         UpdateCrosshairsPosition();
 
         return true;
@@ -177,42 +192,44 @@ bool InclusiveCrosshairs::CreateInclusiveCrosshairs()
     }
 }
 
-void InclusiveCrosshairs::UpdateCrosshairsPosition()
+// Covers the virtual screen with the window. Only needed when the monitors change.
+void InclusiveCrosshairs::UpdateWindowBounds()
 {
-    POINT ptCursor;
+    m_topology = m_monitorTopology.Current();
+    const auto& virtualScreen = m_topology->VirtualScreen();
 
     // HACK: Draw with 1 pixel off. Otherwise Windows glitches the task bar transparency when a transparent window fill the whole screen.
-    SetWindowPos(m_hwnd, HWND_TOPMOST, GetSystemMetrics(SM_XVIRTUALSCREEN) + 1, GetSystemMetrics(SM_YVIRTUALSCREEN) + 1, GetSystemMetrics(SM_CXVIRTUALSCREEN) - 2, GetSystemMetrics(SM_CYVIRTUALSCREEN) - 2, 0);
+    m_windowOrigin = { virtualScreen.left() + 1, virtualScreen.top() + 1 };
+    SetWindowPos(m_hwnd, HWND_TOPMOST, m_windowOrigin.x, m_windowOrigin.y, virtualScreen.width() - 2, virtualScreen.height() - 2, 0);
+}
 
-    GetCursorPos(&ptCursor);
+void InclusiveCrosshairs::UpdateCrosshairsPosition()
+{
+    POINT ptCursor;
 
-    HMONITOR cursorMonitor = MonitorFromPoint(ptCursor, MONITOR_DEFAULTTONEAREST);
+    // Stay above windows which became topmost since the last update
+    SetWindowPos(m_hwnd, HWND_TOPMOST, 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE);
 
-    if (cursorMonitor == NULL)
-    {
-        return;
-    }
+    GetCursorPos(&ptCursor);
 
-    MONITORINFO monitorInfo;
-    monitorInfo.cbSize = sizeof(monitorInfo);
+    const auto cursorMonitor = m_topology->MonitorFromPoint(ptCursor);
 
-    if (!GetMonitorInfo(cursorMonitor, &monitorInfo))
+    if (cursorMonitor == nullptr)
     {
         return;
     }
 
-    POINT ptMonitorUpperLeft;
-    ptMonitorUpperLeft.x = monitorInfo.rcMonitor.left;
-    ptMonitorUpperLeft.y = monitorInfo.rcMonitor.top;
+    // Convert everything to client coordinates.
+    ptCursor.x -= m_windowOrigin.x;
+    ptCursor.y -= m_windowOrigin.y;
 
-    POINT ptMonitorBottomRight;
-    ptMonitorBottomRight.x = monitorInfo.rcMonitor.right;
-    ptMonitorBottomRight.y = monitorInfo.rcMonitor.bottom;
+    POINT ptMonitorUpperLeft = cursorMonitor->rect.top_left();
+    ptMonitorUpperLeft.x -= m_windowOrigin.x;
+    ptMonitorUpperLeft.y -= m_windowOrigin.y;
 
-    // Convert everything to client coordinates.
-    ScreenToClient(m_hwnd, &ptCursor);
-    ScreenToClient(m_hwnd, &ptMonitorUpperLeft);
-    ScreenToClient(m_hwnd, &ptMonitorBottomRight);
+    POINT ptMonitorBottomRight = cursorMonitor->rect.bottom_right();
+    ptMonitorBottomRight.x -= m_windowOrigin.x;
+    ptMonitorBottomRight.y -= m_windowOrigin.y;
 
     // Crosshair position should receive a minor adjustment for odd values to prevent anti-aliasing due to half pixels, while still looking like it's centered around the mouse pointer.
     float halfPixelAdjustment = m_crosshairs_thickness % 2 == 1 ? 0.5f : 0.0f;
@@ -263,10 +280,9 @@ LRESULT CALLBACK InclusiveCrosshairs::MouseHookProc(int nCode, WPARAM wParam, LP
 {
     if (nCode >= 0)
     {
-        MSLLHOOKSTRUCT* hookData = reinterpret_cast<MSLLHOOKSTRUCT*>(lParam);
         if (wParam == WM_MOUSEMOVE)
         {
-            instance->UpdateCrosshairsPosition();
+            instance->m_frameCoalescer->Request();
         }
     }
     return CallNextHookEx(0, nCode, wParam, lParam);
@@ -276,6 +292,7 @@ void InclusiveCrosshairs::StartDrawing()
 {
     Logger::info("Start drawing crosshairs.");
     Trace::StartDrawingCrosshairs();
+    UpdateWindowBounds();
     UpdateCrosshairsPosition();
 
     m_hiddenCursor = false;
@@ -384,6 +401,7 @@ void InclusiveCrosshairs::ApplySettings(InclusiveCrosshairsSettings& settings, b
 void InclusiveCrosshairs::DestroyInclusiveCrosshairs()
 {
     StopDrawing();
+    m_frameCoalescer.reset();
     PostQuitMessage(0);
 }
 
@@ -408,6 +426,25 @@ LRESULT CALLBACK InclusiveCrosshairs::WndProc(HWND hWnd, UINT message, WPARAM wP
             instance->StartDrawing();
         }
         break;
+    case WM_UPDATE_CROSSHAIRS:
+        instance->m_frameCoalescer->Acknowledge();
+        if (instance->m_drawing)
+        {
+            instance->UpdateCrosshairsPosition();
+        }
+        break;
+    case WM_DISPLAYCHANGE:
+    case WM_DPICHANGED:
+    case WM_SETTINGCHANGE:
+        if (instance->m_monitorTopology.HandleMessage(message, wParam))
+        {
+            instance->UpdateWindowBounds();
+            if (instance->m_drawing)
+            {
+                instance->UpdateCrosshairsPosition();
+            }
+        }
+        return DefWindowProc(hWnd, message, wParam, lParam);
     case WM_DESTROY:
         instance->DestroyInclusiveCrosshairs();
         break;
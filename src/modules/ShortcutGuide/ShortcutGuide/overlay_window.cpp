@@ -276,26 +276,30 @@ D2DOverlayWindow::D2DOverlayWindow() :
     background_animation = isEnabledAnimations? 0.3f : 0.f;
     global_windows_shortcuts_animation = isEnabledAnimations ? 0.3f : 0.f;
     taskbar_icon_shortcuts_animation = isEnabledAnimations ? 0.3f : 0.f;
+    tasklist.set_invalidated_callback([this] { tasklist_updater.invalidate(); });
+    // Keeps the taskbar button positions fetched in the background, so that the overlay shows them right away
     tasklist_thread = std::thread([&] {
-        while (running)
-        {
-            // Removing <std::mutex> causes C3538 on std::unique_lock lock(mutex); in show(..)
-            std::unique_lock<std::mutex> task_list_lock(tasklist_cv_mutex);
-            tasklist_cv.wait(task_list_lock, [&] { return !running || tasklist_update; });
-            if (!running)
-                return;
-            task_list_lock.unlock();
-            while (running && tasklist_update)
+        winrt::init_apartment();
+        // While shown, also look for a new tasklist in case explorer restarted
+        const auto fetch = [&](std::vector<TasklistButton>& buttons) {
+            try
             {
-                std::vector<TasklistButton> buttons;
-                if (tasklist.update_buttons(buttons))
-                {
-                    std::unique_lock lock(mutex);
-                    tasklist_buttons.swap(buttons);
-                }
-                std::this_thread::sleep_for(std::chrono::milliseconds(500));
+                tasklist.update();
             }
-        }
+            catch (...)
+            {
+                Logger::error("Failed to bind to the tasklist");
+            }
+            return tasklist.update_buttons(buttons);
+        };
+        const auto publish = [&](std::vector<TasklistButton>& buttons) {
+            // Removing <std::mutex> causes C3538 on std::unique_lock lock(mutex); in show(..)
+            std::unique_lock<std::mutex> lock(mutex);
+            tasklist_buttons.swap(buttons);
+        };
+        tasklist_updater.run(fetch, publish);
+        tasklist.reset();
+        winrt::uninit_apartment();
     });
 }
 
@@ -304,6 +308,14 @@ void D2DOverlayWindow::show(HWND window, bool snappable)
     std::unique_lock lock(mutex);
     hidden = false;
     tasklist_buttons.clear();
+    // Check if taskbar is auto-hidden. If so, don't display the number arrows
+    APPBARDATA param = {};
+    param.cbSize = sizeof(APPBARDATA);
+    const bool show_tasklist_buttons = static_cast<UINT>(SHAppBarMessage(ABM_GETSTATE, &param)) != ABS_AUTOHIDE;
+    if (show_tasklist_buttons)
+    {
+        tasklist.cached_buttons(tasklist_buttons);
+    }
     active_window = window;
     active_window_snappable = snappable;
     auto old_bck = colors.start_color_menu;
@@ -356,7 +368,6 @@ void D2DOverlayWindow::show(HWND window, bool snappable)
     total_screen.rect.right += monitor_dx;
     total_screen.rect.top += monitor_dy;
     total_screen.rect.bottom += monitor_dy;
-    tasklist.update();
     if (window)
     {
         // Ignore errors, if this fails we will just not show the thumbnail
@@ -389,15 +400,9 @@ void D2DOverlayWindow::show(HWND window, bool snappable)
     shown_start_time = std::chrono::steady_clock::now();
     lock.unlock();
     D2DWindow::show(primary_size.left(), primary_size.top(), primary_size.width(), primary_size.height());
-    // Check if taskbar is auto-hidden. If so, don't display the number arrows
-    APPBARDATA param = {};
-    param.cbSize = sizeof(APPBARDATA);
-    if (static_cast<UINT>(SHAppBarMessage(ABM_GETSTATE, &param)) != ABS_AUTOHIDE)
+    if (show_tasklist_buttons)
     {
-        tasklist_cv_mutex.lock();
-        tasklist_update = true;
-        tasklist_cv_mutex.unlock();
-        tasklist_cv.notify_one();
+        tasklist_updater.set_shown(true);
     }
 }
 
@@ -409,10 +414,7 @@ void D2DOverlayWindow::on_show()
 void D2DOverlayWindow::on_hide()
 {
     Logger::trace("D2DOverlayWindow::on_hide()");
-    tasklist_cv_mutex.lock();
-    tasklist_update = false;
-    tasklist_cv_mutex.unlock();
-    tasklist_cv.notify_one();
+    tasklist_updater.set_shown(false);
     if (thumbnail)
     {
         DwmUnregisterThumbnail(thumbnail);
@@ -430,10 +432,7 @@ void D2DOverlayWindow::on_hide()
 
 D2DOverlayWindow::~D2DOverlayWindow()
 {
-    tasklist_cv_mutex.lock();
-    running = false;
-    tasklist_cv_mutex.unlock();
-    tasklist_cv.notify_one();
+    tasklist_updater.stop();
     tasklist_thread.join();
 }
 
@@ -7,6 +7,7 @@
 #include <common/display/monitors.h>
 #include <common/themes/windows_colors.h>
 #include "tasklist_positions.h"
+#include "tasklist_updater.h"
 
 struct ScaleResult
 {
@@ -73,7 +74,6 @@ private:
     virtual void on_hide() override;
     float get_overlay_opacity();
 
-    bool running = true;
     std::vector<AnimateKeys> key_animations;
     std::vector<MonitorInfo> monitors;
     Box total_screen;
@@ -88,10 +88,8 @@ private:
     RECT window_rect = {};
     Tasklist tasklist;
     std::vector<TasklistButton> tasklist_buttons;
+    TasklistUpdater tasklist_updater;
     std::thread tasklist_thread;
-    bool tasklist_update = false;
-    std::mutex tasklist_cv_mutex;
-    std::condition_variable tasklist_cv;
 
     HTHUMBNAIL thumbnail = nullptr;
     HWND active_window = nullptr;
@@ -1,6 +1,70 @@
 #include "pch.h"
 #include "tasklist_positions.h"
 
+struct Tasklist::Invalidation
+{
+    std::atomic_bool stale = true;
+    std::mutex mutex;
+    std::function<void()> callback;
+
+    void invalidate()
+    {
+        stale = true;
+        std::unique_lock lock(mutex);
+        if (callback)
+        {
+            callback();
+        }
+    }
+};
+
+struct Tasklist::EventHandler : winrt::implements<EventHandler, IUIAutomationStructureChangedEventHandler, IUIAutomationPropertyChangedEventHandler>
+{
+    explicit EventHandler(std::shared_ptr<Invalidation> invalidation) :
+        invalidation(std::move(invalidation))
+    {
+    }
+
+    // Buttons added, removed or reordered
+    HRESULT __stdcall HandleStructureChangedEvent(IUIAutomationElement*, StructureChangeType, SAFEARRAY*) noexcept override
+    {
+        invalidation->invalidate();
+        return S_OK;
+    }
+
+    // The taskbar or its buttons moved or got resized
+    HRESULT __stdcall HandlePropertyChangedEvent(IUIAutomationElement*, PROPERTYID, VARIANT) noexcept override
+    {
+        invalidation->invalidate();
+        return S_OK;
+    }
+
+    std::shared_ptr<Invalidation> invalidation;
+};
+
+Tasklist::Tasklist() :
+    invalidation(std::make_shared<Invalidation>())
+{
+}
+
+Tasklist::~Tasklist()
+{
+    reset();
+}
+
+void Tasklist::reset()
+{
+    set_invalidated_callback(nullptr);
+    std::unique_lock lock(mutex);
+    remove_event_handlers();
+    element = nullptr;
+    tasklist_hwnd = nullptr;
+    cache_request = nullptr;
+    true_condition = nullptr;
+    automation = nullptr;
+    invalidation->stale = true;
+}
+
 void Tasklist::update()
 {
     // Get HWND of the tasklist
@@ -16,6 +80,13 @@ void Tasklist::update()
     tasklist_hwnd = FindWindowExA(tasklist_hwnd, 0, "MSTaskListWClass", nullptr);
     if (!tasklist_hwnd)
         return;
+
+    std::unique_lock lock(mutex);
+    if (tasklist_hwnd == this->tasklist_hwnd && element)
+    {
+        return;
+    }
+
     if (!automation)
     {
         winrt::check_hresult(CoCreateInstance(CLSID_CUIAutomation,
@@ -24,60 +95,108 @@ void Tasklist::update()
                                               IID_IUIAutomation,
                                               automation.put_void()));
         winrt::check_hresult(automation->CreateTrueCondition(true_condition.put()));
+
+        // Everything update_buttons reads, fetched along with the children in one call
+        winrt::check_hresult(automation->CreateCacheRequest(cache_request.put()));
+        winrt::check_hresult(cache_request->AddProperty(UIA_BoundingRectanglePropertyId));
+        winrt::check_hresult(cache_request->AddProperty(UIA_AutomationIdPropertyId));
+        winrt::check_hresult(cache_request->put_AutomationElementMode(AutomationElementMode_None));
     }
+    remove_event_handlers();
     element = nullptr;
+    this->tasklist_hwnd = nullptr;
+    invalidation->stale = true;
     winrt::check_hresult(automation->ElementFromHandle(tasklist_hwnd, element.put()));
+    this->tasklist_hwnd = tasklist_hwnd;
+
+    event_handler = winrt::make_self<EventHandler>(invalidation);
+    if (automation->AddStructureChangedEventHandler(element.get(), TreeScope_Children, nullptr, event_handler.get()) < 0)
+    {
+        Logger::warn("Failed to subscribe to the tasklist structure changes");
+        event_handler = nullptr;
+        return;
+    }
+    PROPERTYID bounding_rectangle = UIA_BoundingRectanglePropertyId;
+    if (automation->AddPropertyChangedEventHandlerNativeArray(element.get(), static_cast<TreeScope>(TreeScope_Element | TreeScope_Children), nullptr, event_handler.get(), &bounding_rectangle, 1) < 0)
+    {
+        Logger::warn("Failed to subscribe to the tasklist position changes");
+        remove_event_handlers();
+    }
+}
+
+void Tasklist::remove_event_handlers()
+{
+    if (event_handler && element)
+    {
+        automation->RemoveStructureChangedEventHandler(element.get(), event_handler.get());
+        automation->RemovePropertyChangedEventHandler(element.get(), event_handler.get());
+    }
+    event_handler = nullptr;
+}
+
+void Tasklist::set_invalidated_callback(std::function<void()> callback)
+{
+    std::unique_lock lock(invalidation->mutex);
+    invalidation->callback = std::move(callback);
+}
+
+bool Tasklist::cached_buttons(std::vector<TasklistButton>& buttons) const
+{
+    // Doesn't wait for a refresh in progress, which holds mutex
+    std::unique_lock lock(cache_mutex);
+    if (invalidation->stale)
+    {
+        return false;
+    }
+    buttons = buttons_cache;
+    return true;
 }
 
 bool Tasklist::update_buttons(std::vector<TasklistButton>& buttons)
 {
+    std::unique_lock lock(mutex);
     if (!automation || !element)
     {
         return false;
     }
+    if (cached_buttons(buttons))
+    {
+        return true;
+    }
+    // Cleared before reading, so that a change happening meanwhile triggers another refresh. Without the events
+    // the cache can't be trusted and stays stale.
+    invalidation->stale = !event_handler;
+
     winrt::com_ptr<IUIAutomationElementArray> elements;
-    if (element->FindAll(TreeScope_Children, true_condition.get(), elements.put()) < 0)
-        return false;
-    if (!elements)
+    if (element->FindAllBuildCache(TreeScope_Children, true_condition.get(), cache_request.get(), elements.put()) < 0 || !elements)
+    {
+        invalidation->stale = true;
         return false;
+    }
     int count;
     if (elements->get_Length(&count) < 0)
+    {
+        invalidation->stale = true;
         return false;
+    }
     winrt::com_ptr<IUIAutomationElement> child;
     std::vector<TasklistButton> found_buttons;
     found_buttons.reserve(count);
     for (int i = 0; i < count; ++i)
     {
         child = nullptr;
-        if (elements->GetElement(i, child.put()) < 0)
-            return false;
-        TasklistButton button;
-        if (VARIANT var_rect; child->GetCurrentPropertyValue(UIA_BoundingRectanglePropertyId, &var_rect) >= 0)
-        {
-            if (var_rect.vt == (VT_R8 | VT_ARRAY))
-            {
-                LONG pos;
-                double value;
-                pos = 0;
-                SafeArrayGetElement(var_rect.parray, &pos, &value);
-                button.x = static_cast<long>(value);
-                pos = 1;
-                SafeArrayGetElement(var_rect.parray, &pos, &value);
-                button.y = static_cast<long>(value);
-                pos = 2;
-                SafeArrayGetElement(var_rect.parray, &pos, &value);
-                button.width = static_cast<long>(value);
-                pos = 3;
-                SafeArrayGetElement(var_rect.parray, &pos, &value);
-                button.height = static_cast<long>(value);
-            }
-            VariantClear(&var_rect);
-        }
-        else
+        RECT rect;
+        if (elements->GetElement(i, child.put()) < 0 || child->get_CachedBoundingRectangle(&rect) < 0)
         {
+            invalidation->stale = true;
             return false;
         }
-        if (BSTR automation_id; child->get_CurrentAutomationId(&automation_id) >= 0)
+        TasklistButton button;
+        button.x = rect.left;
+        button.y = rect.top;
+        button.width = rect.right - rect.left;
+        button.height = rect.bottom - rect.top;
+        if (BSTR automation_id; child->get_CachedAutomationId(&automation_id) >= 0)
         {
             button.name = automation_id;
             SysFreeString(automation_id);
@@ -105,6 +224,8 @@ bool Tasklist::update_buttons(std::vector<TasklistButton>& buttons)
                 break; // no more than 10 buttons
         }
     }
+    std::unique_lock cache_lock(cache_mutex);
+    buttons_cache = buttons;
     return true;
 }
 
@@ -113,4 +234,4 @@ std::vector<TasklistButton> Tasklist::get_buttons()
     std::vector<TasklistButton> buttons;
     update_buttons(buttons);
     return buttons;
-}
\ No newline at end of file
+}
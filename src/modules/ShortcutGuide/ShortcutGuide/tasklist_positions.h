@@ -1,4 +1,8 @@
 #pragma once
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <unordered_set>
 #include <string>
@@ -15,15 +19,42 @@ struct TasklistButton
     long keynum{};
 };
 
+// Positions of the taskbar buttons, fetched from UI Automation in a single batched call and kept until the tasklist
+// reports a change of its buttons or of its position.
 class Tasklist
 {
 public:
+    Tasklist();
+    ~Tasklist();
+
+    // Binds to the current tasklist window. Cheap when it didn't change.
     void update();
     std::vector<TasklistButton> get_buttons();
+    // Fetches the buttons again if the cache is stale. Returns false if they couldn't be read.
     bool update_buttons(std::vector<TasklistButton>& buttons);
+    // Copies the cached buttons without calling into UI Automation. Returns false if the cache is stale.
+    bool cached_buttons(std::vector<TasklistButton>& buttons) const;
+    // Called from a UI Automation thread when the cached buttons become stale
+    void set_invalidated_callback(std::function<void()> callback);
+    // Unsubscribes from the tasklist events and releases the UI Automation objects. To be called from the apartment
+    // update ran in, before it's uninitialized.
+    void reset();
 
 private:
+    struct Invalidation;
+    struct EventHandler;
+
+    mutable std::mutex mutex;
+    HWND tasklist_hwnd = nullptr;
     winrt::com_ptr<IUIAutomation> automation;
     winrt::com_ptr<IUIAutomationElement> element;
     winrt::com_ptr<IUIAutomationCondition> true_condition;
+    winrt::com_ptr<IUIAutomationCacheRequest> cache_request;
+    winrt::com_ptr<EventHandler> event_handler;
+    mutable std::mutex cache_mutex;
+    std::vector<TasklistButton> buttons_cache;
+    // Shared with the event handler, which can outlive the tasklist for callbacks already in flight
+    std::shared_ptr<Invalidation> invalidation;
+
+    void remove_event_handlers();
 };
@@ -0,0 +1,60 @@
+#include "pch.h"
+#include "tasklist_updater.h"
+
+void TasklistUpdater::run(const Fetch& fetch, const Publish& publish)
+{
+    std::unique_lock lock(mutex);
+    while (running)
+    {
+        lock.unlock();
+        std::vector<TasklistButton> buttons;
+        const bool updated = fetch(buttons);
+        lock.lock();
+
+        if (updated && shown)
+        {
+            // The overlay may be hiding right now, holding its lock while waiting for ours
+            lock.unlock();
+            publish(buttons);
+            lock.lock();
+        }
+
+        const auto wake_up = [&] { return !running || refresh; };
+        if (shown)
+        {
+            cv.wait_for(lock, std::chrono::milliseconds(500), wake_up);
+        }
+        else
+        {
+            cv.wait(lock, [&] { return wake_up() || shown; });
+        }
+        refresh = false;
+    }
+}
+
+void TasklistUpdater::set_shown(bool value)
+{
+    {
+        std::scoped_lock lock(mutex);
+        shown = value;
+    }
+    cv.notify_one();
+}
+
+void TasklistUpdater::invalidate()
+{
+    {
+        std::scoped_lock lock(mutex);
+        refresh = true;
+    }
+    cv.notify_one();
+}
+
+void TasklistUpdater::stop()
+{
+    {
+        std::scoped_lock lock(mutex);
+        running = false;
+    }
+    cv.notify_one();
+}
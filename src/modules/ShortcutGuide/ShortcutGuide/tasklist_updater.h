@@ -0,0 +1,31 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "tasklist_positions.h"
+
+// Drives the tasklist thread of the overlay: the buttons are fetched every 500 ms while the overlay is shown, and
+// when the tasklist reports a change while it's hidden. The fetched buttons are published without holding the
+// updater's lock, so that the overlay can publish them under its own lock, which it also holds when hiding.
+class TasklistUpdater
+{
+public:
+    using Fetch = std::function<bool(std::vector<TasklistButton>&)>;
+    using Publish = std::function<void(std::vector<TasklistButton>&)>;
+
+    // Runs on the calling thread until stop is called
+    void run(const Fetch& fetch, const Publish& publish);
+    void set_shown(bool shown);
+    // Fetches the buttons again, even while hidden
+    void invalidate();
+    void stop();
+
+private:
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool running = true;
+    bool shown = false;
+    bool refresh = false;
+};
@@ -0,0 +1,133 @@
+#include "pch.h"
+
+#include <tasklist_updater.h>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace ShortcutGuideUnitTests
+{
+    // Stands in for the overlay window: the buttons are published under its lock, which it also holds when hiding
+    struct FakeOverlay
+    {
+        std::mutex mutex;
+        std::vector<TasklistButton> buttons;
+        TasklistUpdater updater;
+        std::atomic<int> fetches = 0;
+        std::atomic<int> publishes = 0;
+        std::atomic<bool> fetch_succeeds = true;
+        std::thread thread;
+
+        void start()
+        {
+            thread = std::thread([this] {
+                const auto fetch = [this](std::vector<TasklistButton>& fetched) {
+                    ++fetches;
+                    fetched.push_back({ L"1", 10, 20, 30, 40, 1 });
+                    return fetch_succeeds.load();
+                };
+                const auto publish = [this](std::vector<TasklistButton>& fetched) {
+                    std::unique_lock lock(mutex);
+                    buttons.swap(fetched);
+                    ++publishes;
+                };
+                updater.run(fetch, publish);
+            });
+        }
+
+        void stop()
+        {
+            updater.stop();
+            thread.join();
+        }
+    };
+
+    template<typename Predicate>
+    bool WaitFor(Predicate predicate)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!predicate())
+        {
+            if (std::chrono::steady_clock::now() > deadline)
+            {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+
+    TEST_CLASS (TasklistUpdaterTests)
+    {
+    public:
+        TEST_METHOD (Hidden_FetchesOnlyWhenInvalidated)
+        {
+            FakeOverlay overlay;
+            overlay.start();
+            Assert::IsTrue(WaitFor([&] { return overlay.fetches == 1; }));
+
+            overlay.updater.invalidate();
+            Assert::IsTrue(WaitFor([&] { return overlay.fetches == 2; }));
+            overlay.stop();
+
+            Assert::AreEqual(2, overlay.fetches.load());
+            Assert::AreEqual(0, overlay.publishes.load());
+        }
+
+        TEST_METHOD (Shown_PublishesFetchedButtons)
+        {
+            FakeOverlay overlay;
+            overlay.start();
+            overlay.updater.set_shown(true);
+            Assert::IsTrue(WaitFor([&] { return overlay.publishes > 0; }));
+            overlay.stop();
+
+            std::unique_lock lock(overlay.mutex);
+            Assert::AreEqual(size_t{ 1 }, overlay.buttons.size());
+            Assert::AreEqual(std::wstring{ L"1" }, overlay.buttons[0].name);
+            Assert::AreEqual(10L, overlay.buttons[0].x);
+        }
+
+        TEST_METHOD (Shown_DoesNotPublishFailedFetches)
+        {
+            FakeOverlay overlay;
+            overlay.fetch_succeeds = false;
+            overlay.start();
+            overlay.updater.set_shown(true);
+            overlay.updater.invalidate();
+            Assert::IsTrue(WaitFor([&] { return overlay.fetches >= 2; }));
+            overlay.stop();
+
+            Assert::AreEqual(0, overlay.publishes.load());
+        }
+
+        // show() and hide() take the overlay lock and then the updater's, while the tasklist thread publishes
+        TEST_METHOD (ShowAndHide_WhilePublishing_DoNotDeadlock)
+        {
+            // Shared with the threads, which are left behind if they deadlock
+            auto overlay = std::make_shared<FakeOverlay>();
+            overlay->start();
+
+            // Until the tasklist thread published enough times to have raced with it
+            std::packaged_task<void()> toggle([overlay] {
+                for (bool shown = true; overlay->publishes < 1000; shown = !shown)
+                {
+                    std::unique_lock lock(overlay->mutex);
+                    overlay->buttons.clear();
+                    overlay->updater.invalidate();
+                    overlay->updater.set_shown(shown);
+                }
+            });
+            auto toggled = toggle.get_future();
+            std::thread toggling(std::move(toggle));
+
+            if (toggled.wait_for(std::chrono::seconds(10)) != std::future_status::ready)
+            {
+                toggling.detach();
+                overlay->thread.detach();
+                Assert::Fail(L"Showing and hiding deadlocked with the tasklist thread");
+            }
+            toggling.join();
+            overlay->stop();
+        }
+    };
+}
@@ -0,0 +1,13 @@
+//{{NO_DEPENDENCIES}}
+// Microsoft Visual C++ generated include file.
+// Used by ShortcutGuideUnitTests.rc
+
+//////////////////////////////
+// Non-localizable
+
+#define FILE_DESCRIPTION "PowerToys ShortcutGuideUnitTests"
+#define INTERNAL_NAME "ShortcutGuideUnitTests"
+#define ORIGINAL_FILENAME "ShortcutGuideUnitTests.dll"
+
+// Non-localizable
+//////////////////////////////
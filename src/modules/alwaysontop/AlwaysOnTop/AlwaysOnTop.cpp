@@ -156,6 +156,30 @@ LRESULT AlwaysOnTop::WndProc(HWND window, UINT message, WPARAM wparam, LPARAM lp
     {
         AlwaysOnTopSettings::instance().LoadSettings();
     }
+    else if (message == WM_TIMER)
+    {
+        switch (static_cast<TimerId>(wparam))
+        {
+        case TimerId::BorderUpdate:
+        {
+            KillTimer(m_window, wparam);
+            m_borderUpdateTimerSet = false;
+            UpdateBorderPositions();
+        }
+        break;
+        case TimerId::Sweep:
+        {
+            KillTimer(m_window, wparam);
+            m_sweepTimerSet = false;
+            SweepPinnedWindows();
+        }
+        break;
+        default:
+            break;
+        }
+
+        ScheduleDeferredWork();
+    }
     
     return 0;
 }
@@ -319,13 +343,15 @@ void AlwaysOnTop::RegisterLLKH()
 void AlwaysOnTop::SubscribeToEvents()
 {
     // subscribe to windows events
-    std::array<DWORD, 7> events_to_subscribe = {
+    std::array<DWORD, 9> events_to_subscribe = {
         EVENT_OBJECT_LOCATIONCHANGE,
         EVENT_SYSTEM_MINIMIZESTART,
         EVENT_SYSTEM_MINIMIZEEND,
         EVENT_SYSTEM_MOVESIZEEND,
         EVENT_SYSTEM_FOREGROUND,
         EVENT_OBJECT_DESTROY,
+        EVENT_OBJECT_HIDE,
+        EVENT_OBJECT_CLOAKED,
         EVENT_OBJECT_FOCUS,
     };
 
@@ -421,52 +447,24 @@ void AlwaysOnTop::HandleWinHookEvent(WinHookEvent* data) noexcept
         return;
     }
 
-    std::vector<HWND> toErase{};
-    for (const auto& [window, border] : m_topmostWindows)
-    {
-        // check if the window was closed, since for some EVENT_OBJECT_DESTROY doesn't work
-        // fixes https://github.com/microsoft/PowerToys/issues/15300
-        bool visible = IsWindowVisible(window);
-        if (!visible)
-        {
-            UnpinTopmostWindow(window);
-            toErase.push_back(window);
-        }
-    }
-
-    for (const auto window : toErase)
-    {
-        m_topmostWindows.erase(window);
-    }
+    // Only the window of the event is looked at here, checks of all the pinned windows and border updates are deferred
+    auto iter = m_topmostWindows.find(data->hwnd);
+    const bool pinned = iter != m_topmostWindows.end();
+    m_tracker.OnWinEvent(data->event, data->hwnd, pinned);
 
     switch (data->event)
     {
-    case EVENT_OBJECT_LOCATIONCHANGE:
-    {
-        auto iter = m_topmostWindows.find(data->hwnd);
-        if (iter != m_topmostWindows.end())
-        {
-            const auto& border = iter->second;
-            if (border)
-            {
-                border->UpdateBorderPosition();
-            }
-        }
-    }
-    break;
     case EVENT_SYSTEM_MINIMIZESTART:
     {
-        auto iter = m_topmostWindows.find(data->hwnd);
-        if (iter != m_topmostWindows.end())
+        if (pinned)
         {
-            m_topmostWindows[data->hwnd] = nullptr;
+            iter->second = nullptr;
         }
     }
     break;
     case EVENT_SYSTEM_MINIMIZEEND:
     {
-        auto iter = m_topmostWindows.find(data->hwnd);
-        if (iter != m_topmostWindows.end())
+        if (pinned)
         {
             // pin border again, in some cases topmost flag stops working: https://github.com/microsoft/PowerToys/issues/17332
             PinTopmostWindow(data->hwnd); 
@@ -474,16 +472,12 @@ void AlwaysOnTop::HandleWinHookEvent(WinHookEvent* data) noexcept
         }
     }
     break;
-    case EVENT_SYSTEM_MOVESIZEEND:
+    case EVENT_OBJECT_DESTROY:
     {
-        auto iter = m_topmostWindows.find(data->hwnd);
-        if (iter != m_topmostWindows.end())
+        if (pinned && data->idObject == OBJID_WINDOW && data->idChild == CHILDID_SELF)
         {
-            const auto& border = iter->second;
-            if (border)
-            {
-                border->UpdateBorderPosition();
-            }
+            UnpinTopmostWindow(data->hwnd);
+            m_topmostWindows.erase(iter);
         }
     }
     break;
@@ -492,22 +486,77 @@ void AlwaysOnTop::HandleWinHookEvent(WinHookEvent* data) noexcept
         RefreshBorders();
     }
     break;
-    case EVENT_OBJECT_FOCUS:
+    default:
+        break;
+    }
+
+    ScheduleDeferredWork();
+}
+
+void AlwaysOnTop::ScheduleDeferredWork() noexcept
+{
+    if (!m_borderUpdateTimerSet && m_tracker.HasBorderUpdates())
     {
-        for (const auto& [window, border] : m_topmostWindows)
+        const auto interval = static_cast<UINT>(PinnedWindowTracker::FrameInterval.count());
+        m_borderUpdateTimerSet = SetTimer(m_window, static_cast<UINT_PTR>(TimerId::BorderUpdate), interval, nullptr) != 0;
+    }
+
+    if (!m_sweepTimerSet && m_tracker.IsSweepRequested())
+    {
+        const auto delay = std::chrono::ceil<std::chrono::milliseconds>(m_tracker.TimeUntilSweep(PinnedWindowTracker::Clock::now()));
+        const UINT interval = delay.count() > USER_TIMER_MINIMUM ? static_cast<UINT>(delay.count()) : USER_TIMER_MINIMUM;
+        m_sweepTimerSet = SetTimer(m_window, static_cast<UINT_PTR>(TimerId::Sweep), interval, nullptr) != 0;
+    }
+}
+
+void AlwaysOnTop::UpdateBorderPositions() noexcept
+{
+    for (const auto window : m_tracker.TakeBorderUpdates())
+    {
+        auto iter = m_topmostWindows.find(window);
+        if (iter != m_topmostWindows.end() && iter->second)
         {
-            // check if topmost was reset
-            // fixes https://github.com/microsoft/PowerToys/issues/19168
-            if (!IsTopmost(window))
-            {
-                Logger::trace(L"A window no longer has Topmost set and it should. Setting topmost again.");
-                PinTopmostWindow(window);
-            }
+            iter->second->UpdateBorderPosition();
         }
     }
-    break;
-    default:
-        break;
+}
+
+void AlwaysOnTop::SweepPinnedWindows() noexcept
+{
+    struct WindowQueries : PinnedWindowTracker::IWindowQueries
+    {
+        const AlwaysOnTop& owner;
+
+        WindowQueries(const AlwaysOnTop& owner) :
+            owner(owner) {}
+
+        bool IsVisible(HWND window) const noexcept override
+        {
+            return IsWindowVisible(window);
+        }
+
+        bool IsTopmost(HWND window) const noexcept override
+        {
+            return owner.IsTopmost(window);
+        }
+    };
+
+    PinnedWindowTracker::SweepResult result;
+    if (!m_tracker.Sweep(PinnedWindowTracker::Clock::now(), m_topmostWindows, WindowQueries{ *this }, result))
+    {
+        return;
+    }
+
+    for (const auto window : result.closed)
+    {
+        UnpinTopmostWindow(window);
+        m_topmostWindows.erase(window);
+    }
+
+    for (const auto window : result.lostTopmost)
+    {
+        Logger::trace(L"A window no longer has Topmost set and it should. Setting topmost again.");
+        PinTopmostWindow(window);
     }
 }
 
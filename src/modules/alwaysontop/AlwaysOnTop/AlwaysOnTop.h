@@ -1,7 +1,8 @@
 #pragma once
 
-#include <map>
+#include <unordered_map>
 
+#include <PinnedWindowTracker.h>
 #include <Settings.h>
 #include <SettingsObserver.h>
 #include <Sound.h>
@@ -39,6 +40,13 @@ private:
         Pin = 1,
     };
 
+    // IDs of the timers used to defer the work scheduled by WinEvents
+    enum class TimerId : UINT_PTR
+    {
+        BorderUpdate = 1,
+        Sweep,
+    };
+
     static inline AlwaysOnTop* s_instance = nullptr;
     std::vector<HWINEVENTHOOK> m_staticWinEventHooks{};
     Sound m_sound;
@@ -46,7 +54,10 @@ private:
 
     HWND m_window{ nullptr };
     HINSTANCE m_hinstance;
-    std::map<HWND, std::unique_ptr<WindowBorder>> m_topmostWindows{};
+    std::unordered_map<HWND, std::unique_ptr<WindowBorder>> m_topmostWindows{};
+    PinnedWindowTracker m_tracker{};
+    bool m_borderUpdateTimerSet = false;
+    bool m_sweepTimerSet = false;
     HANDLE m_hPinEvent;
     std::thread m_thread;
     const bool m_useCentralizedLLKH;
@@ -54,7 +65,10 @@ private:
 
     LRESULT WndProc(HWND, UINT, WPARAM, LPARAM) noexcept;
     void HandleWinHookEvent(WinHookEvent* data) noexcept;
-    
+    void ScheduleDeferredWork() noexcept;
+    void UpdateBorderPositions() noexcept;
+    void SweepPinnedWindows() noexcept;
+
     bool InitMainWindow();
     void RegisterHotkey() const;
     void RegisterLLKH();
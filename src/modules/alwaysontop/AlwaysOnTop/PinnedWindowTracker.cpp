@@ -0,0 +1,72 @@
+#include "pch.h"
+#include "PinnedWindowTracker.h"
+
+PinnedWindowTracker::PinnedWindowTracker(Clock::duration sweepInterval) noexcept :
+    m_sweepInterval(sweepInterval)
+{
+}
+
+void PinnedWindowTracker::OnWinEvent(DWORD event, HWND window, bool isPinned)
+{
+    if (isPinned)
+    {
+        m_validitySweepRequested = true;
+    }
+
+    switch (event)
+    {
+    case EVENT_OBJECT_DESTROY:
+    case EVENT_OBJECT_HIDE:
+    case EVENT_OBJECT_CLOAKED:
+    case EVENT_SYSTEM_FOREGROUND:
+    {
+        // a pinned window can go away without an event of its own, the foreground moving on is then the only sign of it
+        m_validitySweepRequested = true;
+    }
+    break;
+    case EVENT_OBJECT_LOCATIONCHANGE:
+    case EVENT_SYSTEM_MOVESIZEEND:
+    {
+        if (isPinned)
+        {
+            m_borderUpdates.insert(window);
+        }
+    }
+    break;
+    case EVENT_OBJECT_FOCUS:
+    {
+        m_topmostSweepRequested = true;
+    }
+    break;
+    default:
+        break;
+    }
+}
+
+bool PinnedWindowTracker::HasBorderUpdates() const noexcept
+{
+    return !m_borderUpdates.empty();
+}
+
+std::vector<HWND> PinnedWindowTracker::TakeBorderUpdates()
+{
+    std::vector<HWND> result(m_borderUpdates.begin(), m_borderUpdates.end());
+    m_borderUpdates.clear();
+    return result;
+}
+
+bool PinnedWindowTracker::IsSweepRequested() const noexcept
+{
+    return m_validitySweepRequested || m_topmostSweepRequested;
+}
+
+PinnedWindowTracker::Clock::duration PinnedWindowTracker::TimeUntilSweep(Clock::time_point now) const noexcept
+{
+    if (!m_hasSwept)
+    {
+        return Clock::duration::zero();
+    }
+
+    const auto next = m_lastSweep + m_sweepInterval;
+    return next > now ? next - now : Clock::duration::zero();
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <chrono>
+#include <unordered_set>
+#include <vector>
+
+// Keeps the cost of a single WinEvent independent of the number of pinned windows.
+// Checks which have to look at every pinned window are coalesced into a rate limited sweep,
+// and border position updates are collected and flushed once per frame.
+class PinnedWindowTracker
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr std::chrono::milliseconds FrameInterval{ 16 };
+    static constexpr std::chrono::milliseconds DefaultSweepInterval{ 100 };
+
+    // Window state queries used by the sweep, so it can be replaced in tests
+    class IWindowQueries
+    {
+    public:
+        virtual ~IWindowQueries() = default;
+        virtual bool IsVisible(HWND window) const noexcept = 0;
+        virtual bool IsTopmost(HWND window) const noexcept = 0;
+    };
+
+    struct SweepResult
+    {
+        // Pinned windows which are no longer visible, e.g. closed without EVENT_OBJECT_DESTROY
+        std::vector<HWND> closed;
+
+        // Pinned windows which no longer have the topmost flag set
+        std::vector<HWND> lostTopmost;
+    };
+
+    PinnedWindowTracker(Clock::duration sweepInterval = DefaultSweepInterval) noexcept;
+
+    // Book-keeping for a single WinEvent, it only looks at the window of the event.
+    // Pinned windows are only checked for being closed after a close-like event or an event of a pinned window.
+    void OnWinEvent(DWORD event, HWND window, bool isPinned);
+
+    bool HasBorderUpdates() const noexcept;
+
+    // Returns the windows with a queued border update and clears the queue
+    std::vector<HWND> TakeBorderUpdates();
+
+    bool IsSweepRequested() const noexcept;
+
+    // Time left until the requested sweep is allowed to run
+    Clock::duration TimeUntilSweep(Clock::time_point now) const noexcept;
+
+    // Run the requested checks over the pinned windows if the rate limit allows it. Returns false if it is too early.
+    template<typename Windows>
+    bool Sweep(Clock::time_point now, const Windows& pinnedWindows, const IWindowQueries& queries, SweepResult& result)
+    {
+        if (!IsSweepRequested() || TimeUntilSweep(now) > Clock::duration::zero())
+        {
+            return false;
+        }
+
+        for (const auto& [window, value] : pinnedWindows)
+        {
+            // check if the window was closed, since for some EVENT_OBJECT_DESTROY doesn't work
+            // fixes https://github.com/microsoft/PowerToys/issues/15300
+            if (m_validitySweepRequested && !queries.IsVisible(window))
+            {
+                result.closed.push_back(window);
+                continue;
+            }
+
+            // check if topmost was reset
+            // fixes https://github.com/microsoft/PowerToys/issues/19168
+            if (m_topmostSweepRequested && !queries.IsTopmost(window))
+            {
+                result.lostTopmost.push_back(window);
+            }
+        }
+
+        m_validitySweepRequested = false;
+        m_topmostSweepRequested = false;
+        m_lastSweep = now;
+        m_hasSwept = true;
+        return true;
+    }
+
+private:
+    Clock::duration m_sweepInterval;
+    Clock::time_point m_lastSweep{};
+    bool m_hasSwept = false;
+    bool m_validitySweepRequested = false;
+    bool m_topmostSweepRequested = false;
+    std::unordered_set<HWND> m_borderUpdates{};
+};
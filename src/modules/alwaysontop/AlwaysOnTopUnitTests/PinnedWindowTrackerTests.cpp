@@ -0,0 +1,255 @@
+#include "pch.h"
+
+#include <chrono>
+#include <format>
+#include <memory>
+#include <random>
+#include <unordered_map>
+
+#include <PinnedWindowTracker.h>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std::chrono_literals;
+
+namespace AlwaysOnTopUnitTests
+{
+    class FakeWindowQueries : public PinnedWindowTracker::IWindowQueries
+    {
+    public:
+        mutable size_t visibleQueries = 0;
+        mutable size_t topmostQueries = 0;
+        std::unordered_map<HWND, bool> hidden;
+        std::unordered_map<HWND, bool> notTopmost;
+
+        bool IsVisible(HWND window) const noexcept override
+        {
+            visibleQueries++;
+            return !hidden.contains(window);
+        }
+
+        bool IsTopmost(HWND window) const noexcept override
+        {
+            topmostQueries++;
+            return !notTopmost.contains(window);
+        }
+    };
+
+    HWND FakeWindow(size_t index)
+    {
+        return reinterpret_cast<HWND>((index + 1) * 16);
+    }
+
+    // Pinned windows keyed the same way AlwaysOnTop keeps them, the border is not needed here
+    using PinnedWindows = std::unordered_map<HWND, std::unique_ptr<int>>;
+
+    PinnedWindows MakePinnedWindows(size_t count)
+    {
+        PinnedWindows result;
+        for (size_t i = 0; i < count; i++)
+        {
+            result.emplace(FakeWindow(i), nullptr);
+        }
+
+        return result;
+    }
+
+    struct ReplayStats
+    {
+        size_t events = 0;
+        size_t sweeps = 0;
+        size_t borderUpdates = 0;
+        size_t queries = 0;
+        std::chrono::nanoseconds eventTime{};
+    };
+
+    // Replays a recorded-like stream of WinEvents through the tracker, flushing border updates every frame and sweeping when allowed
+    ReplayStats Replay(size_t pinnedCount, size_t eventCount, PinnedWindowTracker::Clock::duration eventSpacing)
+    {
+        PinnedWindowTracker tracker;
+        FakeWindowQueries queries;
+        auto pinned = MakePinnedWindows(pinnedCount);
+
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<int> kind(0, 99);
+        std::uniform_int_distribution<size_t> pinnedIndex(0, pinnedCount - 1);
+        std::uniform_int_distribution<size_t> otherIndex(pinnedCount, pinnedCount + 10000);
+
+        ReplayStats stats;
+        auto now = PinnedWindowTracker::Clock::time_point{};
+        auto nextFrame = now + PinnedWindowTracker::FrameInterval;
+        for (size_t i = 0; i < eventCount; i++)
+        {
+            const int k = kind(rng);
+            DWORD event = EVENT_OBJECT_LOCATIONCHANGE;
+            HWND window = FakeWindow(otherIndex(rng));
+            if (k < 5)
+            {
+                window = FakeWindow(pinnedIndex(rng));
+            }
+            else if (k < 10)
+            {
+                event = EVENT_OBJECT_FOCUS;
+            }
+
+            const auto start = std::chrono::steady_clock::now();
+            tracker.OnWinEvent(event, window, pinned.contains(window));
+            stats.eventTime += std::chrono::steady_clock::now() - start;
+            stats.events++;
+
+            now += eventSpacing;
+            if (now >= nextFrame)
+            {
+                stats.borderUpdates += tracker.TakeBorderUpdates().size();
+                nextFrame = now + PinnedWindowTracker::FrameInterval;
+            }
+
+            PinnedWindowTracker::SweepResult result;
+            if (tracker.Sweep(now, pinned, queries, result))
+            {
+                stats.sweeps++;
+            }
+        }
+
+        stats.queries = queries.visibleQueries + queries.topmostQueries;
+        return stats;
+    }
+
+    TEST_CLASS (PinnedWindowTrackerTests)
+    {
+    public:
+        TEST_METHOD (OnWinEvent_QueuesBorderUpdate_OnlyForPinnedWindows)
+        {
+            PinnedWindowTracker tracker;
+
+            tracker.OnWinEvent(EVENT_OBJECT_LOCATIONCHANGE, FakeWindow(0), true);
+            tracker.OnWinEvent(EVENT_OBJECT_LOCATIONCHANGE, FakeWindow(1), false);
+            tracker.OnWinEvent(EVENT_SYSTEM_MOVESIZEEND, FakeWindow(2), true);
+
+            auto updates = tracker.TakeBorderUpdates();
+            Assert::AreEqual(size_t{ 2 }, updates.size());
+            Assert::IsFalse(tracker.HasBorderUpdates());
+        }
+
+        TEST_METHOD (OnWinEvent_CoalescesBorderUpdates_WithinFrame)
+        {
+            PinnedWindowTracker tracker;
+
+            for (int i = 0; i < 100; i++)
+            {
+                tracker.OnWinEvent(EVENT_OBJECT_LOCATIONCHANGE, FakeWindow(0), true);
+            }
+
+            Assert::AreEqual(size_t{ 1 }, tracker.TakeBorderUpdates().size());
+        }
+
+        TEST_METHOD (Sweep_ReportsClosedAndResetWindows)
+        {
+            PinnedWindowTracker tracker;
+            FakeWindowQueries queries;
+            auto pinned = MakePinnedWindows(3);
+            queries.hidden[FakeWindow(0)] = true;
+            queries.notTopmost[FakeWindow(1)] = true;
+
+            tracker.OnWinEvent(EVENT_OBJECT_HIDE, FakeWindow(5), false);
+            tracker.OnWinEvent(EVENT_OBJECT_FOCUS, FakeWindow(5), false);
+
+            PinnedWindowTracker::SweepResult result;
+            Assert::IsTrue(tracker.Sweep(PinnedWindowTracker::Clock::time_point{}, pinned, queries, result));
+            Assert::AreEqual(size_t{ 1 }, result.closed.size());
+            Assert::IsTrue(result.closed[0] == FakeWindow(0));
+            Assert::AreEqual(size_t{ 1 }, result.lostTopmost.size());
+            Assert::IsTrue(result.lostTopmost[0] == FakeWindow(1));
+        }
+
+        TEST_METHOD (Sweep_SkipsTopmostChecks_WhenNoFocusEventArrived)
+        {
+            PinnedWindowTracker tracker;
+            FakeWindowQueries queries;
+            auto pinned = MakePinnedWindows(10);
+
+            tracker.OnWinEvent(EVENT_OBJECT_LOCATIONCHANGE, FakeWindow(0), true);
+
+            PinnedWindowTracker::SweepResult result;
+            Assert::IsTrue(tracker.Sweep(PinnedWindowTracker::Clock::time_point{}, pinned, queries, result));
+            Assert::AreEqual(size_t{ 10 }, queries.visibleQueries);
+            Assert::AreEqual(size_t{ 0 }, queries.topmostQueries);
+        }
+
+        TEST_METHOD (OnWinEvent_RequestsValiditySweep_OnlyForCloseEventsOrPinnedWindows)
+        {
+            PinnedWindowTracker tracker;
+
+            tracker.OnWinEvent(EVENT_OBJECT_LOCATIONCHANGE, FakeWindow(50), false);
+            tracker.OnWinEvent(EVENT_SYSTEM_MOVESIZEEND, FakeWindow(50), false);
+            tracker.OnWinEvent(EVENT_SYSTEM_MINIMIZESTART, FakeWindow(50), false);
+            Assert::IsFalse(tracker.IsSweepRequested());
+
+            for (DWORD event : { EVENT_OBJECT_DESTROY, EVENT_OBJECT_HIDE, EVENT_OBJECT_CLOAKED, EVENT_SYSTEM_FOREGROUND })
+            {
+                PinnedWindowTracker closeTracker;
+                closeTracker.OnWinEvent(event, FakeWindow(50), false);
+                Assert::IsTrue(closeTracker.IsSweepRequested());
+            }
+
+            tracker.OnWinEvent(EVENT_OBJECT_LOCATIONCHANGE, FakeWindow(0), true);
+            Assert::IsTrue(tracker.IsSweepRequested());
+        }
+
+        TEST_METHOD (Sweep_IsRateLimited)
+        {
+            PinnedWindowTracker tracker{ 100ms };
+            FakeWindowQueries queries;
+            auto pinned = MakePinnedWindows(1);
+            const auto start = PinnedWindowTracker::Clock::time_point{};
+            PinnedWindowTracker::SweepResult result;
+
+            tracker.OnWinEvent(EVENT_OBJECT_FOCUS, FakeWindow(5), false);
+            Assert::IsTrue(tracker.Sweep(start, pinned, queries, result));
+
+            tracker.OnWinEvent(EVENT_OBJECT_FOCUS, FakeWindow(5), false);
+            Assert::IsFalse(tracker.Sweep(start + 50ms, pinned, queries, result));
+            Assert::IsTrue(tracker.TimeUntilSweep(start + 50ms) == 50ms);
+            Assert::IsTrue(tracker.Sweep(start + 100ms, pinned, queries, result));
+        }
+
+        TEST_METHOD (Sweep_DoesNothing_WhenNotRequested)
+        {
+            PinnedWindowTracker tracker;
+            FakeWindowQueries queries;
+            auto pinned = MakePinnedWindows(10);
+
+            PinnedWindowTracker::SweepResult result;
+            Assert::IsFalse(tracker.Sweep(PinnedWindowTracker::Clock::time_point{}, pinned, queries, result));
+            Assert::AreEqual(size_t{ 0 }, queries.visibleQueries);
+        }
+
+        // Replays the same event stream against a growing number of pinned windows and reports the per event cost.
+        // Window queries must only scale with the number of sweeps, which are bounded by the replay duration and not by the event count.
+        TEST_METHOD (EventReplay_PerEventCost_DoesNotGrowWithPinnedWindows)
+        {
+            constexpr size_t eventCount = 100000;
+            constexpr auto eventSpacing = 100us;
+            const auto duration = eventSpacing * eventCount;
+            const size_t maxSweeps = static_cast<size_t>(duration / PinnedWindowTracker::DefaultSweepInterval) + 1;
+
+            for (size_t pinnedCount : { 1, 10, 100, 1000 })
+            {
+                auto stats = Replay(pinnedCount, eventCount, eventSpacing);
+
+                Assert::IsTrue(stats.sweeps <= maxSweeps);
+                Assert::IsTrue(stats.queries <= stats.sweeps * pinnedCount * 2);
+
+                const double nsPerEvent = static_cast<double>(stats.eventTime.count()) / stats.events;
+                const double queriesPerEvent = static_cast<double>(stats.queries) / stats.events;
+                Logger::WriteMessage(std::format(L"pinned: {}, events: {}, sweeps: {}, border updates: {}, queries/event: {:.3f}, ns/event: {:.1f}\n",
+                                                 pinnedCount,
+                                                 stats.events,
+                                                 stats.sweeps,
+                                                 stats.borderUpdates,
+                                                 queriesPerEvent,
+                                                 nsPerEvent)
+                                         .c_str());
+            }
+        }
+    };
+}
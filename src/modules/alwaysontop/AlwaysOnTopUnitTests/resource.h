@@ -0,0 +1,13 @@
+//{{NO_DEPENDENCIES}}
+// Microsoft Visual C++ generated include file.
+// Used by AlwaysOnTopUnitTests.rc
+
+//////////////////////////////
+// Non-localizable
+
+#define FILE_DESCRIPTION "PowerToys AlwaysOnTopUnitTests"
+#define INTERNAL_NAME "AlwaysOnTopUnitTests"
+#define ORIGINAL_FILENAME "AlwaysOnTopUnitTests.dll"
+
+// Non-localizable
+//////////////////////////////
@@ -32,12 +32,17 @@ FancyZonesApp::~FancyZonesApp()
         m_app->Destroy();
         m_app = nullptr;
 
-        if (s_llKeyboardHook)
+        auto& keyboardHook = LowlevelKeyboardHookHost::Instance();
+        keyboardHook.Stop();
+        keyboardHook.Dispatcher().Unsubscribe(m_keyboardSubscription);
+        for (const auto& subscriber : keyboardHook.Dispatcher().Statistics())
         {
-            if (UnhookWindowsHookEx(s_llKeyboardHook))
-            {
-                s_llKeyboardHook = nullptr;
-            }
+            Logger::info(L"Keyboard hook subscriber {}: {} events, {} swallowed, {}us total, {}us max",
+                         subscriber.name,
+                         subscriber.calls,
+                         subscriber.swallowed,
+                         std::chrono::duration_cast<std::chrono::microseconds>(subscriber.total).count(),
+                         std::chrono::duration_cast<std::chrono::microseconds>(subscriber.max).count());
         }
 
         m_staticWinEventHooks.erase(std::remove_if(begin(m_staticWinEventHooks),
@@ -66,22 +71,17 @@ void FancyZonesApp::Run()
 
 void FancyZonesApp::InitHooks()
 {
-#if defined(DISABLE_LOWLEVEL_HOOKS_WHEN_DEBUGGED)
-    const bool hook_disabled = IsDebuggerPresent();
-#else
-    const bool hook_disabled = false;
-#endif
-
-    if (!hook_disabled)
+    // Every key press, since Shift swallows all of them while dragging
+    auto& keyboardHook = LowlevelKeyboardHookHost::Instance();
+    m_keyboardSubscription = keyboardHook.Dispatcher().Subscribe(L"FancyZones", KeyboardHookDispatcher::DefaultPriority, {}, [this](const KeyboardHookDispatcher::Event& event) {
+        return HandleKeyboardHookEvent(event);
+    });
+    if (!keyboardHook.Start())
     {
-        s_llKeyboardHook = SetWindowsHookEx(WH_KEYBOARD_LL, LowLevelKeyboardProc, GetModuleHandle(NULL), NULL);
-        if (!s_llKeyboardHook)
-        {
-            DWORD errorCode = GetLastError();
-            show_last_error_message(L"SetWindowsHookEx", errorCode, GET_RESOURCE_STRING(IDS_POWERTOYS_FANCYZONES).c_str());
-            auto errorMessage = get_last_error_message(errorCode);
-            Trace::FancyZones::Error(errorCode, errorMessage.has_value() ? errorMessage.value() : L"", L"enable.SetWindowsHookEx");
-        }
+        DWORD errorCode = GetLastError();
+        show_last_error_message(L"SetWindowsHookEx", errorCode, GET_RESOURCE_STRING(IDS_POWERTOYS_FANCYZONES).c_str());
+        auto errorMessage = get_last_error_message(errorCode);
+        Trace::FancyZones::Error(errorCode, errorMessage.has_value() ? errorMessage.value() : L"", L"enable.SetWindowsHookEx");
     }
 
     std::array<DWORD, 6> events_to_subscribe = {
@@ -175,7 +175,13 @@ void FancyZonesApp::HandleWinHookEvent(WinHookEvent* data) noexcept
     }
 }
 
-intptr_t FancyZonesApp::HandleKeyboardHookEvent(LowlevelKeyboardEvent* data) noexcept
+bool FancyZonesApp::HandleKeyboardHookEvent(const KeyboardHookDispatcher::Event& event) noexcept
 {
-    return m_app.as<IFancyZonesCallback>()->OnKeyDown(data->lParam);
+    if (event.systemKey)
+    {
+        return false;
+    }
+
+    KBDLLHOOKSTRUCT info = *static_cast<const KBDLLHOOKSTRUCT*>(event.nativeEvent);
+    return m_app.as<IFancyZonesCallback>()->OnKeyDown(&info);
 }
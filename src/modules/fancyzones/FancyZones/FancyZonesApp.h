@@ -1,6 +1,6 @@
 #pragma once
 
-#include <common/hooks/LowlevelKeyboardEvent.h>
+#include <common/hooks/LowlevelKeyboardHookHost.h>
 
 #include <FancyZonesLib/FancyZones.h>
 
@@ -14,9 +14,9 @@ public:
 
 private:
     static inline FancyZonesApp* s_instance = nullptr;
-    static inline HHOOK s_llKeyboardHook = nullptr;
     
     winrt::com_ptr<IFancyZones> m_app;
+    KeyboardHookDispatcher::SubscriptionId m_keyboardSubscription{};
     HWINEVENTHOOK m_objectLocationWinEventHook = nullptr;
     std::vector<HWINEVENTHOOK> m_staticWinEventHooks;
 
@@ -25,25 +25,7 @@ private:
     void InitHooks();
 
     void HandleWinHookEvent(WinHookEvent* data) noexcept;
-    intptr_t HandleKeyboardHookEvent(LowlevelKeyboardEvent* data) noexcept;
-
-    static LRESULT CALLBACK LowLevelKeyboardProc(int nCode, WPARAM wParam, LPARAM lParam)
-    {
-        LowlevelKeyboardEvent event;
-        if (nCode == HC_ACTION && wParam == WM_KEYDOWN)
-        {
-            event.lParam = reinterpret_cast<KBDLLHOOKSTRUCT*>(lParam);
-            event.wParam = wParam;
-            if (s_instance)
-            {
-                if (s_instance->HandleKeyboardHookEvent(&event) == 1)
-                {
-                    return 1;
-                }
-            }
-        }
-        return CallNextHookEx(NULL, nCode, wParam, lParam);
-    }
+    bool HandleKeyboardHookEvent(const KeyboardHookDispatcher::Event& event) noexcept;
 
     static void CALLBACK WinHookProc(HWINEVENTHOOK winEventHook,
                                      DWORD event,
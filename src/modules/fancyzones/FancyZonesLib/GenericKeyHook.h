@@ -2,8 +2,9 @@
 
 #include "pch.h"
 #include <functional>
-#include <common/debug_control.h>
+#include <common/hooks/LowlevelKeyboardHookHost.h>
 
+// Reports presses and releases of the keys through the keyboard hook of the process
 template<int... keys>
 class GenericKeyHook
 {
@@ -14,47 +15,43 @@ public:
         callback = std::move(extCallback);
     }
 
-    void enable()
+    GenericKeyHook(const GenericKeyHook&) = delete;
+    GenericKeyHook& operator=(const GenericKeyHook&) = delete;
+
+    ~GenericKeyHook()
     {
-#if defined(DISABLE_LOWLEVEL_HOOKS_WHEN_DEBUGGED)
-        if (IsDebuggerPresent())
+        if (subscription)
         {
-            return;
+            LowlevelKeyboardHookHost::Instance().Dispatcher().Unsubscribe(subscription);
         }
-#endif
-        if (!hHook)
+    }
+
+    void enable()
+    {
+        if (!subscription)
         {
-            hHook = SetWindowsHookEx(WH_KEYBOARD_LL, GenericKeyHookProc, GetModuleHandle(NULL), 0);
+            const KeyboardHookDispatcher::Filter filter{ .keys = { static_cast<uint8_t>(keys)... }, .keyDown = true, .keyUp = true };
+            // Observes the keys before FancyZones gets the chance to swallow them
+            subscription = LowlevelKeyboardHookHost::Instance().Dispatcher().Subscribe(L"FancyZones key state", KeyboardHookDispatcher::ObserverPriority, filter, [this](const KeyboardHookDispatcher::Event& event) {
+                if (!event.systemKey)
+                {
+                    callback(event.keyDown);
+                }
+                return false;
+            });
         }
     }
 
     void disable()
     {
-        if (hHook)
+        if (subscription)
         {
-            UnhookWindowsHookEx(hHook);
-            hHook = NULL;
+            LowlevelKeyboardHookHost::Instance().Dispatcher().Unsubscribe(std::exchange(subscription, {}));
             callback(false);
         }
     }
 
 private:
-    inline static HHOOK hHook = nullptr;
-    inline static std::function<void(bool)> callback;
-
-    static LRESULT CALLBACK GenericKeyHookProc(int nCode, WPARAM wParam, LPARAM lParam)
-    {
-        if (nCode == HC_ACTION)
-        {
-            if (wParam == WM_KEYDOWN || wParam == WM_KEYUP)
-            {
-                PKBDLLHOOKSTRUCT kbdHookStruct = reinterpret_cast<PKBDLLHOOKSTRUCT>(lParam);
-                if (((kbdHookStruct->vkCode == keys) || ...))
-                {
-                    callback(wParam == WM_KEYDOWN);
-                }
-            }
-        }
-        return CallNextHookEx(hHook, nCode, wParam, lParam);
-    }
+    KeyboardHookDispatcher::SubscriptionId subscription{};
+    std::function<void(bool)> callback;
 };
@@ -4,6 +4,8 @@
 #include <common/notifications/dont_show_again.h>
 #include <common/utils/resources.h>
 
+#include <FancyZonesLib/ModuleConstants.h>
+
 namespace FancyZonesNotifications
 {
     // Non-Localizable strings
@@ -28,7 +30,8 @@ namespace FancyZonesNotifications
             show_toast_with_activations(GET_RESOURCE_STRING(IDS_CANT_DRAG_ELEVATED),
                                         GET_RESOURCE_STRING(IDS_FANCYZONES),
                                         {},
-                                        std::move(actions));
+                                        std::move(actions),
+                                        toast_params{ .module_name = ::NonLocalizable::ModuleKey });
             warning_shown = true;
         }
     }
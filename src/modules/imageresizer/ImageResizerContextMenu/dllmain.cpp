@@ -1,8 +1,6 @@
 // dllmain.cpp : Defines the entry point for the DLL application.
 #include "pch.h"
 
-#include <atlfile.h>
-#include <atlstr.h>
 #include <Shlwapi.h>
 #include <shobjidl_core.h>
 #include <string>
@@ -10,6 +8,7 @@
 #include <common/utils/elevation.h>
 #include <common/utils/process_path.h>
 #include <common/utils/resources.h>
+#include <PathHandoff.h>
 #include <Settings.h>
 #include <trace.h>
 
@@ -175,44 +174,6 @@ protected:
     ComPtr<IUnknown> m_site;
 
 private:
-    HRESULT StartNamedPipeServerAndSendData(std::wstring pipe_name)
-    {
-        hPipe = CreateNamedPipe(
-            pipe_name.c_str(),
-            PIPE_ACCESS_DUPLEX |
-                WRITE_DAC,
-            PIPE_TYPE_MESSAGE |
-                PIPE_READMODE_MESSAGE |
-                PIPE_WAIT,
-            PIPE_UNLIMITED_INSTANCES,
-            BUFSIZE,
-            BUFSIZE,
-            0,
-            NULL);
-
-        if (hPipe == NULL || hPipe == INVALID_HANDLE_VALUE)
-        {
-            return E_FAIL;
-        }
-
-        // This call blocks until a client process connects to the pipe
-        BOOL connected = ConnectNamedPipe(hPipe, NULL);
-        if (!connected)
-        {
-            if (GetLastError() == ERROR_PIPE_CONNECTED)
-            {
-                return S_OK;
-            }
-            else
-            {
-                CloseHandle(hPipe);
-            }
-            return E_FAIL;
-        }
-
-        return S_OK;
-    }
-
     HRESULT ResizePictures(IShellItemArray* psiItemArray)
     {
         // Set the application path based on the location of the dll
@@ -239,39 +200,41 @@ private:
             RpcStringFree(reinterpret_cast<RPC_WSTR*>(&uuid_chars));
             uuid_chars = nullptr;
         }
-        create_pipe_thread = std::thread(&ImageResizerContextMenuCommand::StartNamedPipeServerAndSendData, this, pipe_name);
-        RunNonElevatedEx(path.c_str(), pipe_name, get_module_folderpath(g_hInst));
-        create_pipe_thread.join();
 
-        if (hPipe != INVALID_HANDLE_VALUE)
+        HANDLE hPipe = CreateNamedPipe(
+            pipe_name.c_str(),
+            PIPE_ACCESS_DUPLEX |
+                WRITE_DAC,
+            PIPE_TYPE_MESSAGE |
+                PIPE_READMODE_MESSAGE |
+                PIPE_WAIT,
+            PIPE_UNLIMITED_INSTANCES,
+            BUFSIZE,
+            BUFSIZE,
+            0,
+            NULL);
+
+        if (hPipe == NULL || hPipe == INVALID_HANDLE_VALUE)
+        {
+            return E_FAIL;
+        }
+
+        // Waits for the resizer to connect and writes the paths in the background, so that Explorer isn't blocked
+        // by the resizer starting up and reading them
+        PathHandoff handoff{ hPipe, true };
+        if (!RunNonElevatedEx(path.c_str(), pipe_name + L" /frames", get_module_folderpath(g_hInst)))
         {
-            CAtlFile writePipe(hPipe);
-
-            //m_pdtobj will be NULL when invoked from the MSIX build as Initialize is never called (IShellExtInit functions aren't called in case of MSIX).
-            DWORD fileCount = 0;
-            // Gets the list of files currently selected using the IShellItemArray
-            psiItemArray->GetCount(&fileCount);
-            // Iterate over the list of files
-            for (DWORD i = 0; i < fileCount; i++)
-            {
-                IShellItem* shellItem;
-                psiItemArray->GetItemAt(i, &shellItem);
-                LPWSTR itemName;
-                // Retrieves the entire file system path of the file from its shell item
-                shellItem->GetDisplayName(SIGDN_FILESYSPATH, &itemName);
-                CString fileName(itemName);
-                fileName.Append(_T("\r\n"));
-                // Write the file path into the input stream for image resizer
-                writePipe.Write(fileName, fileName.GetLength() * sizeof(TCHAR));
-            }
-            writePipe.Close();
+            handoff.Cancel();
+            return E_FAIL;
         }
 
+        //m_pdtobj will be NULL when invoked from the MSIX build as Initialize is never called (IShellExtInit functions aren't called in case of MSIX).
+        handoff.AddItems(psiItemArray);
+        handoff.Finish();
+
         return S_OK;
     }
 
-    std::thread create_pipe_thread;
-    HANDLE hPipe = INVALID_HANDLE_VALUE;
     std::wstring app_name = L"ImageResizer";
 };
 
@@ -0,0 +1,166 @@
+#include "pch.h"
+#include "PathFrames.h"
+
+#include <iterator>
+
+namespace
+{
+    void Put32(std::vector<uint8_t>& bytes, const uint32_t value)
+    {
+        bytes.push_back(static_cast<uint8_t>(value));
+        bytes.push_back(static_cast<uint8_t>(value >> 8));
+        bytes.push_back(static_cast<uint8_t>(value >> 16));
+        bytes.push_back(static_cast<uint8_t>(value >> 24));
+    }
+
+    uint32_t Get32(const uint8_t* bytes)
+    {
+        return bytes[0] | bytes[1] << 8 | bytes[2] << 16 | static_cast<uint32_t>(bytes[3]) << 24;
+    }
+
+    void Set32(uint8_t* bytes, const uint32_t value)
+    {
+        bytes[0] = static_cast<uint8_t>(value);
+        bytes[1] = static_cast<uint8_t>(value >> 8);
+        bytes[2] = static_cast<uint8_t>(value >> 16);
+        bytes[3] = static_cast<uint8_t>(value >> 24);
+    }
+}
+
+namespace PathFrames
+{
+    Writer::Writer(Sink sink) :
+        _sink{ std::move(sink) }
+    {
+    }
+
+    void Writer::Add(const std::wstring_view path)
+    {
+        const size_t entrySize = 4 + path.size() * 2;
+        if (_frame.size() > 4 && _frame.size() + entrySize > FrameTargetSize)
+        {
+            Flush();
+        }
+        if (_frame.empty())
+        {
+            _frame.reserve(FrameTargetSize + entrySize);
+            // Payload size, set once complete
+            _frame.resize(4);
+        }
+
+        Put32(_frame, static_cast<uint32_t>(path.size()));
+        const size_t offset = _frame.size();
+        _frame.resize(offset + path.size() * 2);
+        uint8_t* chars = _frame.data() + offset;
+        for (const wchar_t c : path)
+        {
+            *chars++ = static_cast<uint8_t>(c);
+            *chars++ = static_cast<uint8_t>(c >> 8);
+        }
+    }
+
+    void Writer::Flush()
+    {
+        Set32(_frame.data(), static_cast<uint32_t>(_frame.size() - 4));
+        if (!_headerSent)
+        {
+            std::vector<uint8_t> header;
+            Put32(header, Magic);
+            Put32(header, Version);
+            _frame.insert(_frame.begin(), header.begin(), header.end());
+            _headerSent = true;
+        }
+        _sink(std::move(_frame));
+        _frame.clear();
+    }
+
+    void Writer::Finish()
+    {
+        if (!_frame.empty())
+        {
+            Flush();
+        }
+        // The end of the list is an empty frame
+        _frame.resize(4);
+        Flush();
+    }
+
+    Reader::Status Reader::Feed(const void* data, const size_t size, std::vector<std::wstring>& paths)
+    {
+        if (_status != Status::NeedMore)
+        {
+            return _status;
+        }
+
+        const auto bytes = static_cast<const uint8_t*>(data);
+        _pending.insert(_pending.end(), bytes, bytes + size);
+
+        size_t offset = 0;
+        if (!_headerRead)
+        {
+            if (_pending.size() < HeaderSize)
+            {
+                return _status;
+            }
+            if (Get32(_pending.data()) != Magic || Get32(_pending.data() + 4) != Version)
+            {
+                return _status = Status::Malformed;
+            }
+            _headerRead = true;
+            offset = HeaderSize;
+        }
+
+        while (_status == Status::NeedMore && _pending.size() - offset >= 4)
+        {
+            const uint32_t payloadSize = Get32(_pending.data() + offset);
+            if (payloadSize > MaxFrameSize)
+            {
+                _status = Status::Malformed;
+            }
+            else if (payloadSize == 0)
+            {
+                _status = Status::Done;
+            }
+            else if (_pending.size() - offset - 4 >= payloadSize)
+            {
+                _status = ParseFrame(_pending.data() + offset + 4, payloadSize, paths);
+                offset += 4 + payloadSize;
+            }
+            else
+            {
+                break;
+            }
+        }
+
+        _pending.erase(_pending.begin(), _pending.begin() + offset);
+        return _status;
+    }
+
+    Reader::Status Reader::ParseFrame(const uint8_t* payload, const size_t size, std::vector<std::wstring>& paths)
+    {
+        // Frames are taken whole or not at all
+        std::vector<std::wstring> framePaths;
+        size_t offset = 0;
+        while (offset < size)
+        {
+            if (size - offset < 4)
+            {
+                return Status::Malformed;
+            }
+            const size_t length = Get32(payload + offset);
+            offset += 4;
+            if ((size - offset) / 2 < length)
+            {
+                return Status::Malformed;
+            }
+            std::wstring& path = framePaths.emplace_back(length, L'\0');
+            for (size_t i = 0; i < length; ++i, offset += 2)
+            {
+                path[i] = static_cast<wchar_t>(payload[offset] | payload[offset + 1] << 8);
+            }
+        }
+
+        paths.insert(paths.end(), std::make_move_iterator(framePaths.begin()), std::make_move_iterator(framePaths.end()));
+        return Status::NeedMore;
+    }
+}
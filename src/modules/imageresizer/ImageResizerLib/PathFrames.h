@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Binary format of the list of files handed over to PowerToys.ImageResizer.exe when it's started with /frames,
+// mirrored by PathFrameReader.cs. Little endian:
+//   header:  uint32 magic, uint32 version
+//   frames:  uint32 payload size in bytes, then the paths as uint32 length in UTF-16 code units followed by the code
+//            units, as many as fit in the payload
+//   end:     a frame with an empty payload
+// Paths are gathered into frames of about FrameTargetSize bytes, which keeps the number of pipe writes low while the
+// resizer can still start on the first frames before the list is complete.
+namespace PathFrames
+{
+    constexpr uint32_t Magic = 0x52495450; // "PTIR"
+    constexpr uint32_t Version = 1;
+    constexpr size_t HeaderSize = 8;
+    constexpr size_t FrameTargetSize = 64 * 1024;
+    // Enough for FrameTargetSize plus the longest path allowed on Windows
+    constexpr size_t MaxFrameSize = 1024 * 1024;
+
+    class Writer
+    {
+    public:
+        // Receives the bytes to write, one frame at a time. The first one also holds the header.
+        using Sink = std::function<void(std::vector<uint8_t>&& bytes)>;
+
+        explicit Writer(Sink sink);
+
+        void Add(std::wstring_view path);
+        // Sends the frame in progress and the end of the list
+        void Finish();
+
+    private:
+        void Flush();
+
+        Sink _sink;
+        std::vector<uint8_t> _frame;
+        bool _headerSent = false;
+    };
+
+    class Reader
+    {
+    public:
+        enum class Status
+        {
+            NeedMore,
+            Done,
+            Malformed,
+        };
+
+        // Parses the bytes as they come, in pieces of any size. The paths of every frame completed by the bytes are
+        // appended to paths. Once Done or Malformed, the rest of the input is ignored.
+        Status Feed(const void* data, size_t size, std::vector<std::wstring>& paths);
+
+    private:
+        Status ParseFrame(const uint8_t* payload, size_t size, std::vector<std::wstring>& paths);
+
+        std::vector<uint8_t> _pending;
+        bool _headerRead = false;
+        Status _status = Status::NeedMore;
+    };
+}
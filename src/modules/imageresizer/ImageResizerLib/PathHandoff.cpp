@@ -0,0 +1,232 @@
+#include "pch.h"
+#include "PathHandoff.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace
+{
+    // Items fetched at once from the selection, each batch being a single call into the shell
+    constexpr ULONG ItemBatchSize = 256;
+}
+
+struct PathHandoff::State
+{
+    State(const HANDLE pipe, const bool connect) :
+        pipe{ pipe }, connect{ connect }
+    {
+    }
+
+    ~State()
+    {
+        if (thread)
+        {
+            CloseHandle(thread);
+        }
+        if (pipe != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(pipe);
+        }
+    }
+
+    void Push(std::vector<uint8_t>&& frame)
+    {
+        {
+            std::lock_guard lock{ mutex };
+            frames.push_back(std::move(frame));
+        }
+        changed.notify_one();
+    }
+
+    bool Write(const std::vector<uint8_t>& frame)
+    {
+        size_t offset = 0;
+        while (offset < frame.size())
+        {
+            DWORD written = 0;
+            if (canceled || !WriteFile(pipe, frame.data() + offset, static_cast<DWORD>(frame.size() - offset), &written, nullptr))
+            {
+                return false;
+            }
+            offset += written;
+        }
+        return true;
+    }
+
+    void Run()
+    {
+        if (connect && !canceled && !ConnectNamedPipe(pipe, nullptr) && GetLastError() != ERROR_PIPE_CONNECTED)
+        {
+            return;
+        }
+
+        while (true)
+        {
+            std::vector<uint8_t> frame;
+            {
+                std::unique_lock lock{ mutex };
+                changed.wait(lock, [this] { return !frames.empty() || finished || canceled; });
+                if (canceled || frames.empty())
+                {
+                    break;
+                }
+                frame = std::move(frames.front());
+                frames.pop_front();
+            }
+            if (!Write(frame))
+            {
+                return;
+            }
+        }
+
+        // Waits for the resizer to read everything before the pipe is closed
+        if (!canceled)
+        {
+            FlushFileBuffers(pipe);
+        }
+    }
+
+    HANDLE pipe;
+    bool connect;
+    HANDLE thread = nullptr;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::vector<uint8_t>> frames;
+    bool finished = false;
+    std::atomic<bool> canceled = false;
+};
+
+namespace
+{
+    struct ThreadParameter
+    {
+        std::shared_ptr<void> state;
+        HMODULE module;
+    };
+}
+
+PathHandoff::PathHandoff(const HANDLE pipe, const bool connect) :
+    _state{ std::make_shared<State>(pipe, connect) },
+    _writer{ [state = _state.get()](std::vector<uint8_t>&& frame) { state->Push(std::move(frame)); } }
+{
+    // Released by the thread on exit, so that the module isn't unloaded under it
+    HMODULE module = nullptr;
+    GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS, reinterpret_cast<LPCWSTR>(&PathHandoff::WriteFrames), &module);
+
+    auto parameter = new ThreadParameter{ _state, module };
+    _state->thread = CreateThread(nullptr, 0, &PathHandoff::WriteFrames, parameter, 0, nullptr);
+    if (!_state->thread)
+    {
+        // Written by Finish instead
+        delete parameter;
+        if (module)
+        {
+            FreeLibrary(module);
+        }
+    }
+}
+
+PathHandoff::~PathHandoff()
+{
+    Finish();
+}
+
+DWORD WINAPI PathHandoff::WriteFrames(void* parameter)
+{
+    HMODULE module = nullptr;
+    {
+        std::unique_ptr<ThreadParameter> threadParameter{ static_cast<ThreadParameter*>(parameter) };
+        module = threadParameter->module;
+        static_cast<State*>(threadParameter->state.get())->Run();
+    }
+    if (module)
+    {
+        FreeLibraryAndExitThread(module, 0);
+    }
+    return 0;
+}
+
+void PathHandoff::Add(const std::wstring_view path)
+{
+    if (!_finished)
+    {
+        _writer.Add(path);
+    }
+}
+
+HRESULT PathHandoff::AddItems(IShellItemArray* items)
+{
+    IEnumShellItems* enumItems = nullptr;
+    HRESULT hr = items->EnumItems(&enumItems);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    IShellItem* batch[ItemBatchSize];
+    ULONG fetched = 0;
+    while (SUCCEEDED(hr = enumItems->Next(ItemBatchSize, batch, &fetched)) && fetched > 0)
+    {
+        for (ULONG i = 0; i < fetched; ++i)
+        {
+            LPWSTR path = nullptr;
+            if (SUCCEEDED(batch[i]->GetDisplayName(SIGDN_FILESYSPATH, &path)))
+            {
+                Add(path);
+                CoTaskMemFree(path);
+            }
+            batch[i]->Release();
+        }
+        // S_FALSE: fewer items than asked for, the last ones
+        if (hr == S_FALSE)
+        {
+            break;
+        }
+    }
+    enumItems->Release();
+    return FAILED(hr) ? hr : S_OK;
+}
+
+void PathHandoff::Finish()
+{
+    if (_finished)
+    {
+        return;
+    }
+    _finished = true;
+
+    _writer.Finish();
+    {
+        std::lock_guard lock{ _state->mutex };
+        _state->finished = true;
+    }
+    _state->changed.notify_one();
+
+    if (!_state->thread)
+    {
+        _state->Run();
+    }
+}
+
+void PathHandoff::Cancel()
+{
+    _finished = true;
+    {
+        std::lock_guard lock{ _state->mutex };
+        _state->canceled = true;
+        _state->frames.clear();
+    }
+    _state->changed.notify_one();
+
+    // Wakes the thread up from a connect or a write blocking on the pipe
+    if (_state->thread)
+    {
+        while (WaitForSingleObject(_state->thread, 10) == WAIT_TIMEOUT)
+        {
+            CancelSynchronousIo(_state->thread);
+        }
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <Windows.h>
+#include <shobjidl_core.h>
+
+#include <memory>
+#include <string_view>
+
+#include "PathFrames.h"
+
+// Hands the files selected in Explorer over to PowerToys.ImageResizer.exe started with /frames. The paths are gathered
+// into frames, which a thread of its own writes to the pipe, so that Explorer doesn't wait for the resizer to read
+// them. The thread keeps the module loaded until it's done.
+class PathHandoff
+{
+public:
+    // Takes ownership of the write end of the pipe. With connect set, the pipe is the server end of a named pipe and
+    // the thread first waits for the resizer to connect.
+    explicit PathHandoff(HANDLE pipe, bool connect = false);
+    PathHandoff(const PathHandoff&) = delete;
+    PathHandoff& operator=(const PathHandoff&) = delete;
+    // Finishes the list, if not done yet
+    ~PathHandoff();
+
+    void Add(std::wstring_view path);
+    // Adds the file system paths of the items, enumerated in batches
+    HRESULT AddItems(IShellItemArray* items);
+    // Ends the list. The thread closes the pipe once everything is written.
+    void Finish();
+    // Drops the list and stops the thread, for when the resizer couldn't be started
+    void Cancel();
+
+private:
+    struct State;
+
+    static DWORD WINAPI WriteFrames(void* parameter);
+
+    std::shared_ptr<State> _state;
+    PathFrames::Writer _writer;
+    bool _finished = false;
+};
@@ -0,0 +1,278 @@
+#include "pch.h"
+#include "Resampling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define RESAMPLING_SSE2
+#endif
+
+namespace
+{
+    constexpr double Pi = 3.14159265358979323846;
+    constexpr int32_t Rounding = 1 << (Resampling::WeightBits - 1);
+
+    double Support(const Resampling::Filter filter) noexcept
+    {
+        return filter == Resampling::Filter::Lanczos3 ? 3.0 : 2.0;
+    }
+
+    double Kernel(const Resampling::Filter filter, double x) noexcept
+    {
+        x = std::abs(x);
+        if (filter == Resampling::Filter::Lanczos3)
+        {
+            if (x < 1e-8)
+            {
+                return 1.0;
+            }
+            if (x >= 3.0)
+            {
+                return 0.0;
+            }
+            return 3.0 * std::sin(Pi * x) * std::sin(Pi * x / 3.0) / (Pi * Pi * x * x);
+        }
+
+        // Catmull-Rom, a = -0.5
+        if (x < 1.0)
+        {
+            return (1.5 * x - 2.5) * x * x + 1.0;
+        }
+        if (x < 2.0)
+        {
+            return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+        }
+        return 0.0;
+    }
+
+    uint8_t Clamp(const int32_t sum) noexcept
+    {
+        const int32_t value = sum >> Resampling::WeightBits;
+        return static_cast<uint8_t>(value < 0 ? 0 : value > 255 ? 255 : value);
+    }
+
+#ifdef RESAMPLING_SSE2
+    // Two consecutive weights in every 32-bit lane, for _mm_madd_epi16
+    __m128i WeightPair(const int16_t* weights) noexcept
+    {
+        int32_t pair;
+        std::memcpy(&pair, weights, sizeof(pair));
+        return _mm_set1_epi32(pair);
+    }
+
+    __m128i WeightSingle(const int16_t weight) noexcept
+    {
+        return _mm_set1_epi32(static_cast<uint16_t>(weight));
+    }
+
+    // Four 32-bit sums to 4 bytes, in the low lane
+    __m128i Narrow(const __m128i sums) noexcept
+    {
+        const __m128i words = _mm_packs_epi32(_mm_srai_epi32(sums, Resampling::WeightBits), _mm_setzero_si128());
+        return _mm_packus_epi16(words, words);
+    }
+
+    // Clamps the color channels of 4 BGRA pixels to their alpha
+    __m128i ClampToAlpha(const __m128i pixels) noexcept
+    {
+        __m128i alpha = _mm_srli_epi32(pixels, 24);
+        alpha = _mm_or_si128(alpha, _mm_slli_epi32(alpha, 8));
+        alpha = _mm_or_si128(alpha, _mm_slli_epi32(alpha, 16));
+        return _mm_min_epu8(pixels, alpha);
+    }
+#endif
+}
+
+namespace Resampling
+{
+    WeightTable::WeightTable(const Filter filter, const uint32_t sourceSize, const uint32_t destinationSize)
+    {
+        const double scale = static_cast<double>(sourceSize) / destinationSize;
+        // Downscaling stretches the kernel over the source pixels falling into a destination pixel
+        const double filterScale = (std::max)(1.0, scale);
+        const double support = Support(filter) * filterScale;
+
+        _taps = (std::min)(sourceSize, static_cast<uint32_t>(std::ceil(2 * support)) + 1);
+        _first.resize(destinationSize);
+        _weights.assign(static_cast<size_t>(destinationSize) * _taps, 0);
+
+        std::vector<double> contributions(_taps);
+        for (uint32_t i = 0; i < destinationSize; ++i)
+        {
+            // Pixel centers are at half integers
+            const double center = (i + 0.5) * scale;
+            const auto left = static_cast<int64_t>(std::ceil(center - support - 0.5));
+            const auto right = static_cast<int64_t>(std::floor(center + support - 0.5));
+            const int64_t clampedLeft = std::clamp<int64_t>(left, 0, sourceSize - 1);
+            const auto first = static_cast<uint32_t>((std::min)(clampedLeft, static_cast<int64_t>(sourceSize - _taps)));
+
+            std::fill(contributions.begin(), contributions.end(), 0.0);
+            double sum = 0;
+            for (int64_t j = left; j <= right; ++j)
+            {
+                const double weight = Kernel(filter, (static_cast<double>(j) + 0.5 - center) / filterScale);
+                contributions[std::clamp<int64_t>(j, 0, sourceSize - 1) - first] += weight;
+                sum += weight;
+            }
+
+            int16_t* weights = _weights.data() + static_cast<size_t>(i) * _taps;
+            int32_t total = 0;
+            uint32_t largest = 0;
+            for (uint32_t k = 0; k < _taps; ++k)
+            {
+                weights[k] = static_cast<int16_t>(std::lround(contributions[k] / sum * (1 << WeightBits)));
+                total += weights[k];
+                if (weights[k] > weights[largest])
+                {
+                    largest = k;
+                }
+            }
+            // The rounding error goes to the largest weight, so that flat areas stay flat
+            weights[largest] = static_cast<int16_t>(weights[largest] + (1 << WeightBits) - total);
+            _first[i] = first;
+        }
+    }
+
+    void ResampleRows(const ConstImageView& source, const uint32_t sourceRow, const WeightTable& weights, const ImageView& destination) noexcept
+    {
+        const uint32_t taps = weights.Taps();
+        for (uint32_t y = 0; y < destination.height; ++y)
+        {
+            const uint8_t* sourcePixels = source.Row(sourceRow + y);
+            uint8_t* output = destination.Row(y);
+            for (uint32_t x = 0; x < destination.width; ++x, output += 4)
+            {
+                const uint8_t* pixel = sourcePixels + weights.First(x) * 4;
+                const int16_t* w = weights.Weights(x);
+                uint32_t k = 0;
+#ifdef RESAMPLING_SSE2
+                const __m128i zero = _mm_setzero_si128();
+                __m128i sums = _mm_set1_epi32(Rounding);
+                // Two pixels at a time: b0 b1 g0 g1 r0 r1 a0 a1 times w0 w1
+                for (; k + 1 < taps; k += 2, pixel += 8)
+                {
+                    const __m128i pixels = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pixel)), zero);
+                    const __m128i pairs = _mm_unpacklo_epi16(pixels, _mm_srli_si128(pixels, 8));
+                    sums = _mm_add_epi32(sums, _mm_madd_epi16(pairs, WeightPair(w + k)));
+                }
+                if (k < taps)
+                {
+                    int32_t last;
+                    std::memcpy(&last, pixel, sizeof(last));
+                    const __m128i words = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(last), zero), zero);
+                    sums = _mm_add_epi32(sums, _mm_madd_epi16(words, WeightSingle(w[k])));
+                }
+                const int32_t result = _mm_cvtsi128_si32(Narrow(sums));
+                std::memcpy(output, &result, sizeof(result));
+#else
+                int32_t sums[4] = { Rounding, Rounding, Rounding, Rounding };
+                for (; k < taps; ++k, pixel += 4)
+                {
+                    sums[0] += pixel[0] * w[k];
+                    sums[1] += pixel[1] * w[k];
+                    sums[2] += pixel[2] * w[k];
+                    sums[3] += pixel[3] * w[k];
+                }
+                for (int c = 0; c < 4; ++c)
+                {
+                    output[c] = Clamp(sums[c]);
+                }
+#endif
+            }
+        }
+    }
+
+    void ResampleColumns(const ConstImageView& intermediate, const uint32_t intermediateRow, const WeightTable& weights, const uint32_t firstRow, const ImageView& destination) noexcept
+    {
+        const uint32_t taps = weights.Taps();
+        const size_t rowBytes = static_cast<size_t>(destination.width) * 4;
+        for (uint32_t y = 0; y < destination.height; ++y)
+        {
+            const uint32_t first = weights.First(firstRow + y) - intermediateRow;
+            const int16_t* w = weights.Weights(firstRow + y);
+            uint8_t* output = destination.Row(y);
+            size_t x = 0;
+#ifdef RESAMPLING_SSE2
+            // 4 pixels at a time, each pair of rows interleaved as for the rows
+            const __m128i zero = _mm_setzero_si128();
+            for (; x + 16 <= rowBytes; x += 16)
+            {
+                __m128i sums[4] = { _mm_set1_epi32(Rounding), _mm_set1_epi32(Rounding), _mm_set1_epi32(Rounding), _mm_set1_epi32(Rounding) };
+                uint32_t k = 0;
+                for (; k + 1 < taps; k += 2)
+                {
+                    const __m128i row0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(intermediate.Row(first + k) + x));
+                    const __m128i row1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(intermediate.Row(first + k + 1) + x));
+                    const __m128i pair = WeightPair(w + k);
+                    const __m128i low0 = _mm_unpacklo_epi8(row0, zero);
+                    const __m128i low1 = _mm_unpacklo_epi8(row1, zero);
+                    const __m128i high0 = _mm_unpackhi_epi8(row0, zero);
+                    const __m128i high1 = _mm_unpackhi_epi8(row1, zero);
+                    sums[0] = _mm_add_epi32(sums[0], _mm_madd_epi16(_mm_unpacklo_epi16(low0, low1), pair));
+                    sums[1] = _mm_add_epi32(sums[1], _mm_madd_epi16(_mm_unpackhi_epi16(low0, low1), pair));
+                    sums[2] = _mm_add_epi32(sums[2], _mm_madd_epi16(_mm_unpacklo_epi16(high0, high1), pair));
+                    sums[3] = _mm_add_epi32(sums[3], _mm_madd_epi16(_mm_unpackhi_epi16(high0, high1), pair));
+                }
+                if (k < taps)
+                {
+                    const __m128i row = _mm_loadu_si128(reinterpret_cast<const __m128i*>(intermediate.Row(first + k) + x));
+                    const __m128i single = WeightSingle(w[k]);
+                    const __m128i low = _mm_unpacklo_epi8(row, zero);
+                    const __m128i high = _mm_unpackhi_epi8(row, zero);
+                    sums[0] = _mm_add_epi32(sums[0], _mm_madd_epi16(_mm_unpacklo_epi16(low, zero), single));
+                    sums[1] = _mm_add_epi32(sums[1], _mm_madd_epi16(_mm_unpackhi_epi16(low, zero), single));
+                    sums[2] = _mm_add_epi32(sums[2], _mm_madd_epi16(_mm_unpacklo_epi16(high, zero), single));
+                    sums[3] = _mm_add_epi32(sums[3], _mm_madd_epi16(_mm_unpackhi_epi16(high, zero), single));
+                }
+                const __m128i low = _mm_packs_epi32(_mm_srai_epi32(sums[0], WeightBits), _mm_srai_epi32(sums[1], WeightBits));
+                const __m128i high = _mm_packs_epi32(_mm_srai_epi32(sums[2], WeightBits), _mm_srai_epi32(sums[3], WeightBits));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(output + x), ClampToAlpha(_mm_packus_epi16(low, high)));
+            }
+#endif
+            for (; x < rowBytes; x += 4)
+            {
+                int32_t sums[4] = { Rounding, Rounding, Rounding, Rounding };
+                for (uint32_t k = 0; k < taps; ++k)
+                {
+                    const uint8_t* pixel = intermediate.Row(first + k) + x;
+                    sums[0] += pixel[0] * w[k];
+                    sums[1] += pixel[1] * w[k];
+                    sums[2] += pixel[2] * w[k];
+                    sums[3] += pixel[3] * w[k];
+                }
+                const uint8_t alpha = Clamp(sums[3]);
+                for (int c = 0; c < 3; ++c)
+                {
+                    output[x + c] = (std::min)(Clamp(sums[c]), alpha);
+                }
+                output[x + 3] = alpha;
+            }
+        }
+    }
+
+    void SourceRows(const WeightTable& weights, const uint32_t firstRow, const uint32_t lastRow, uint32_t& first, uint32_t& count) noexcept
+    {
+        // First() never decreases
+        first = weights.First(firstRow);
+        count = weights.First(lastRow) + weights.Taps() - first;
+    }
+
+    void Resize(const ConstImageView& source, const ImageView& destination, const Filter filter)
+    {
+        if (source.width == 0 || source.height == 0 || destination.width == 0 || destination.height == 0)
+        {
+            return;
+        }
+
+        const WeightTable horizontal{ filter, source.width, destination.width };
+        const WeightTable vertical{ filter, source.height, destination.height };
+
+        std::vector<uint8_t> buffer(static_cast<size_t>(destination.width) * 4 * source.height);
+        const ImageView intermediate{ buffer.data(), destination.width, source.height, static_cast<size_t>(destination.width) * 4 };
+        ResampleRows(source, 0, horizontal, intermediate);
+        ResampleColumns(intermediate, 0, vertical, 0, destination);
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Separable resampling of 32-bit premultiplied BGRA images, free of any platform API so that it can be tested and
+// measured anywhere. Rows are first resampled horizontally into an intermediate image of the destination width, then
+// vertically. Both passes use precomputed fixed point weights and SSE2 where available, with identical results either
+// way.
+namespace Resampling
+{
+    enum class Filter
+    {
+        // Catmull-Rom, 2 source pixels on each side at 1:1
+        Bicubic,
+        // 3 lobes, 3 source pixels on each side at 1:1
+        Lanczos3,
+    };
+
+    // Fraction bits of the weights. A weight of 1.0 is 1 << WeightBits.
+    constexpr int WeightBits = 14;
+
+    struct ImageView
+    {
+        uint8_t* pixels = nullptr;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        // Bytes from a row to the next
+        size_t stride = 0;
+
+        uint8_t* Row(const uint32_t y) const noexcept
+        {
+            return pixels + y * stride;
+        }
+    };
+
+    struct ConstImageView
+    {
+        const uint8_t* pixels = nullptr;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        size_t stride = 0;
+
+        ConstImageView() = default;
+        ConstImageView(const uint8_t* data, const uint32_t columns, const uint32_t rows, const size_t rowStride) noexcept :
+            pixels{ data }, width{ columns }, height{ rows }, stride{ rowStride }
+        {
+        }
+        ConstImageView(const ImageView& image) noexcept :
+            pixels{ image.pixels }, width{ image.width }, height{ image.height }, stride{ image.stride }
+        {
+        }
+
+        const uint8_t* Row(const uint32_t y) const noexcept
+        {
+            return pixels + y * stride;
+        }
+    };
+
+    // The contributions of the source pixels to every destination pixel along one axis. Every destination pixel i takes
+    // Taps() consecutive source pixels from First(i), the weights summing to exactly 1 << WeightBits. Source pixels
+    // past the edges are folded into the edge pixels.
+    class WeightTable
+    {
+    public:
+        WeightTable(Filter filter, uint32_t sourceSize, uint32_t destinationSize);
+
+        uint32_t Taps() const noexcept
+        {
+            return _taps;
+        }
+
+        uint32_t First(const uint32_t i) const noexcept
+        {
+            return _first[i];
+        }
+
+        const int16_t* Weights(const uint32_t i) const noexcept
+        {
+            return _weights.data() + static_cast<size_t>(i) * _taps;
+        }
+
+        uint32_t Size() const noexcept
+        {
+            return static_cast<uint32_t>(_first.size());
+        }
+
+    private:
+        uint32_t _taps = 0;
+        std::vector<uint32_t> _first;
+        std::vector<int16_t> _weights;
+    };
+
+    // Resamples the source rows horizontally, destination.width pixels each. destination.height rows are read from the
+    // source row sourceRow on.
+    void ResampleRows(const ConstImageView& source, uint32_t sourceRow, const WeightTable& weights, const ImageView& destination) noexcept;
+
+    // Resamples the columns of the intermediate image vertically into the destination rows firstRow to
+    // firstRow + destination.height. Row 0 of the intermediate image is source row intermediateRow. Color channels are
+    // clamped to the alpha channel, as ringing could otherwise push them over it.
+    void ResampleColumns(const ConstImageView& intermediate, uint32_t intermediateRow, const WeightTable& weights, uint32_t firstRow, const ImageView& destination) noexcept;
+
+    // The range of source rows that the destination rows firstRow to lastRow, included, are made of
+    void SourceRows(const WeightTable& weights, uint32_t firstRow, uint32_t lastRow, uint32_t& first, uint32_t& count) noexcept;
+
+    // Resizes the whole image on the calling thread
+    void Resize(const ConstImageView& source, const ImageView& destination, Filter filter);
+}
@@ -0,0 +1,78 @@
+#include "pch.h"
+#include "ResizeEngine.h"
+
+#include <algorithm>
+
+namespace
+{
+    // Resamples the destination rows firstRow to firstRow + rowCount from the source rows they need
+    void ResizeRows(const ResizeEngine::Job& job, const Resampling::WeightTable& horizontal, const Resampling::WeightTable& vertical, const uint32_t firstRow, const uint32_t rowCount)
+    {
+        uint32_t sourceRow = 0;
+        uint32_t sourceRowCount = 0;
+        Resampling::SourceRows(vertical, firstRow, firstRow + rowCount - 1, sourceRow, sourceRowCount);
+
+        const size_t stride = static_cast<size_t>(job.destination.width) * 4;
+        std::vector<uint8_t> buffer(stride * sourceRowCount);
+        const Resampling::ImageView intermediate{ buffer.data(), job.destination.width, sourceRowCount, stride };
+        Resampling::ResampleRows(job.source, sourceRow, horizontal, intermediate);
+
+        const Resampling::ImageView rows{ job.destination.Row(firstRow), job.destination.width, rowCount, job.destination.stride };
+        Resampling::ResampleColumns(intermediate, sourceRow, vertical, firstRow, rows);
+    }
+}
+
+ResizeEngine::ResizeEngine(const unsigned threadCount) :
+    _pool{ threadCount }
+{
+}
+
+void ResizeEngine::Run(const std::vector<Job>& jobs)
+{
+    TaskGroup group{ _pool };
+    for (const auto& job : jobs)
+    {
+        group.Run([this, &job] { RunJob(job); });
+    }
+    group.Wait();
+}
+
+uint32_t ResizeEngine::TileCount(const Job& job) const noexcept
+{
+    if (static_cast<uint64_t>(job.source.width) * job.source.height < TileThreshold)
+    {
+        return 1;
+    }
+
+    // A few bands per thread, for the threads finishing early to steal
+    const uint32_t bands = (std::min)(job.destination.height / MinTileRows, _pool.ThreadCount() * 4);
+    return (std::max)(bands, 1u);
+}
+
+void ResizeEngine::RunJob(const Job& job)
+{
+    if (job.source.width == 0 || job.source.height == 0 || job.destination.width == 0 || job.destination.height == 0)
+    {
+        return;
+    }
+
+    const Resampling::WeightTable horizontal{ job.filter, job.source.width, job.destination.width };
+    const Resampling::WeightTable vertical{ job.filter, job.source.height, job.destination.height };
+
+    const uint32_t tiles = TileCount(job);
+    if (tiles == 1)
+    {
+        ResizeRows(job, horizontal, vertical, 0, job.destination.height);
+        return;
+    }
+
+    // The bands are queued on this thread's queue: it runs them itself unless other threads steal them first
+    TaskGroup group{ _pool };
+    for (uint32_t i = 0; i < tiles; ++i)
+    {
+        const uint32_t firstRow = static_cast<uint32_t>(static_cast<uint64_t>(job.destination.height) * i / tiles);
+        const uint32_t lastRow = static_cast<uint32_t>(static_cast<uint64_t>(job.destination.height) * (i + 1) / tiles);
+        group.Run([&, firstRow, lastRow] { ResizeRows(job, horizontal, vertical, firstRow, lastRow - firstRow); });
+    }
+    group.Wait();
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Resampling.h"
+#include "WorkStealingPool.h"
+
+// Resizes decoded images on a work stealing pool. Every image is a task of its own, and large images are split further
+// into bands of destination rows, so that a single large image among small ones doesn't leave the other threads idle.
+class ResizeEngine
+{
+public:
+    struct Job
+    {
+        // 32-bit premultiplied BGRA
+        Resampling::ConstImageView source;
+        Resampling::ImageView destination;
+        Resampling::Filter filter = Resampling::Filter::Lanczos3;
+    };
+
+    // Images of fewer source pixels are resized as a whole
+    static constexpr uint64_t TileThreshold = 4 * 1024 * 1024;
+    // Each band of rows also resamples the source rows its first and last rows share with its neighbors, which this
+    // keeps small in comparison
+    static constexpr uint32_t MinTileRows = 64;
+
+    // One thread per hardware thread by default
+    explicit ResizeEngine(unsigned threadCount = 0);
+
+    unsigned ThreadCount() const noexcept
+    {
+        return _pool.ThreadCount();
+    }
+
+    // Returns once every image is resized. The results don't depend on the number of threads or bands.
+    void Run(const std::vector<Job>& jobs);
+
+    // The number of bands the job is split into
+    uint32_t TileCount(const Job& job) const noexcept;
+
+private:
+    void RunJob(const Job& job);
+
+    WorkStealingPool _pool;
+};
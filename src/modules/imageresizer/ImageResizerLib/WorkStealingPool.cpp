@@ -0,0 +1,213 @@
+#include "pch.h"
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+    // The pool and queue of the worker running on this thread, if any
+    thread_local const WorkStealingPool* currentPool = nullptr;
+    thread_local size_t currentQueue = 0;
+
+    constexpr size_t NoQueue = static_cast<size_t>(-1);
+
+    // How often a TaskGroup waiting on tasks running elsewhere looks for queued ones to help with
+    constexpr auto HelpInterval = std::chrono::milliseconds(1);
+}
+
+WorkStealingPool::WorkStealingPool(unsigned threadCount)
+{
+    if (threadCount == 0)
+    {
+        threadCount = (std::max)(1u, std::thread::hardware_concurrency());
+    }
+
+    for (unsigned i = 0; i < threadCount; ++i)
+    {
+        _queues.push_back(std::make_unique<Queue>());
+    }
+    for (unsigned i = 0; i < threadCount; ++i)
+    {
+        _threads.emplace_back(&WorkStealingPool::Work, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard lock{ _idleMutex };
+        _stopping = true;
+    }
+    _idle.notify_all();
+
+    for (auto& thread : _threads)
+    {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::Submit(Task task)
+{
+    const size_t index = currentPool == this ? currentQueue : _nextQueue++ % _queues.size();
+    // Counted first, so that the count never drops below the number of queued tasks
+    {
+        std::lock_guard lock{ _idleMutex };
+        ++_queued;
+    }
+    {
+        std::lock_guard lock{ _queues[index]->mutex };
+        _queues[index]->tasks.push_back(std::move(task));
+    }
+    _idle.notify_one();
+}
+
+bool WorkStealingPool::RunOne()
+{
+    Task task;
+    if (!Take(currentPool == this ? currentQueue : NoQueue, task))
+    {
+        return false;
+    }
+    task();
+    return true;
+}
+
+bool WorkStealingPool::Take(const size_t self, Task& task)
+{
+    if (_queued == 0)
+    {
+        return false;
+    }
+
+    // The newest task of our own queue first
+    if (self != NoQueue)
+    {
+        auto& queue = *_queues[self];
+        std::lock_guard lock{ queue.mutex };
+        if (!queue.tasks.empty())
+        {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            --_queued;
+            return true;
+        }
+    }
+
+    // Then the oldest of somebody else's
+    const size_t count = _queues.size();
+    const size_t start = self == NoQueue ? 0 : self + 1;
+    for (size_t i = 0; i < count; ++i)
+    {
+        auto& queue = *_queues[(start + i) % count];
+        std::lock_guard lock{ queue.mutex };
+        if (!queue.tasks.empty())
+        {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            --_queued;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::Work(const size_t index)
+{
+    currentPool = this;
+    currentQueue = index;
+
+    while (true)
+    {
+        Task task;
+        if (Take(index, task))
+        {
+            task();
+            continue;
+        }
+
+        std::unique_lock lock{ _idleMutex };
+        _idle.wait(lock, [this] { return _queued > 0 || _stopping; });
+        if (_stopping && _queued == 0)
+        {
+            return;
+        }
+    }
+}
+
+TaskGroup::TaskGroup(WorkStealingPool& pool) noexcept :
+    _pool{ pool }
+{
+}
+
+TaskGroup::~TaskGroup()
+{
+    try
+    {
+        Wait();
+    }
+    catch (...)
+    {
+    }
+}
+
+void TaskGroup::Run(WorkStealingPool::Task task)
+{
+    {
+        std::lock_guard lock{ _mutex };
+        ++_pending;
+    }
+
+    _pool.Submit([this, task = std::move(task)] {
+        std::exception_ptr exception;
+        try
+        {
+            task();
+        }
+        catch (...)
+        {
+            exception = std::current_exception();
+        }
+
+        // Notified under the lock, as the group can be gone as soon as Wait sees the count drop to 0
+        std::lock_guard lock{ _mutex };
+        if (exception && !_exception)
+        {
+            _exception = exception;
+        }
+        if (--_pending == 0)
+        {
+            _done.notify_all();
+        }
+    });
+}
+
+void TaskGroup::Wait()
+{
+    while (true)
+    {
+        {
+            std::lock_guard lock{ _mutex };
+            if (_pending == 0)
+            {
+                break;
+            }
+        }
+
+        if (!_pool.RunOne())
+        {
+            std::unique_lock lock{ _mutex };
+            _done.wait_for(lock, HelpInterval, [this] { return _pending == 0; });
+        }
+    }
+
+    std::exception_ptr exception;
+    {
+        std::lock_guard lock{ _mutex };
+        std::swap(exception, _exception);
+    }
+    if (exception)
+    {
+        std::rethrow_exception(exception);
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of threads with a queue each. Tasks submitted by a worker go to the back of its own queue, where it
+// takes them from, so that the tasks a task spawns run next and while hot in its cache. Idle workers steal from the
+// front of the other queues, where the oldest and usually largest tasks are.
+class WorkStealingPool
+{
+public:
+    using Task = std::function<void()>;
+
+    // One thread per hardware thread by default
+    explicit WorkStealingPool(unsigned threadCount = 0);
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+    // Runs the tasks left before returning
+    ~WorkStealingPool();
+
+    unsigned ThreadCount() const noexcept
+    {
+        return static_cast<unsigned>(_threads.size());
+    }
+
+    void Submit(Task task);
+
+    // Runs a queued task on the calling thread, if there is one. Lets a thread waiting for tasks help with them.
+    bool RunOne();
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    bool Take(size_t self, Task& task);
+    void Work(size_t index);
+
+    std::vector<std::unique_ptr<Queue>> _queues;
+    std::vector<std::thread> _threads;
+    std::atomic<size_t> _nextQueue = 0;
+
+    // Idle workers sleep until a task is submitted
+    std::mutex _idleMutex;
+    std::condition_variable _idle;
+    std::atomic<size_t> _queued = 0;
+    bool _stopping = false;
+};
+
+// Tasks that are waited for together. An exception thrown by a task is rethrown by Wait.
+class TaskGroup
+{
+public:
+    explicit TaskGroup(WorkStealingPool& pool) noexcept;
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+    ~TaskGroup();
+
+    void Run(WorkStealingPool::Task task);
+
+    // Returns once every task has run, running queued tasks meanwhile instead of blocking
+    void Wait();
+
+private:
+    WorkStealingPool& _pool;
+    std::mutex _mutex;
+    std::condition_variable _done;
+    size_t _pending = 0;
+    std::exception_ptr _exception;
+};
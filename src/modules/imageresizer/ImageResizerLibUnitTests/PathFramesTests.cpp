@@ -0,0 +1,301 @@
+#include "pch.h"
+
+#include <PathFrames.h>
+#include <PathHandoff.h>
+
+#include <chrono>
+#include <format>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace ImageResizerLibUnitTests
+{
+    namespace
+    {
+        std::vector<std::wstring> MakePaths(const size_t count, const uint32_t seed = 1)
+        {
+            std::mt19937 rng{ seed };
+            std::vector<std::wstring> paths;
+            paths.reserve(count);
+            for (size_t i = 0; i < count; ++i)
+            {
+                std::wstring path = L"C:\\Users\\PowerToys\\Pictures\\";
+                path.append(rng() % 40, L'a' + static_cast<wchar_t>(i % 26));
+                path += std::format(L"\\IMG_{:06}", i);
+                // Some characters outside of ASCII, and surrogate pairs
+                if (i % 7 == 0)
+                {
+                    path += L"_\u00e9t\u00e9_\xD83D\xDDBC";
+                }
+                path += L".jpg";
+                paths.push_back(std::move(path));
+            }
+            return paths;
+        }
+
+        std::vector<std::vector<uint8_t>> WriteFrames(const std::vector<std::wstring>& paths)
+        {
+            std::vector<std::vector<uint8_t>> frames;
+            PathFrames::Writer writer{ [&](std::vector<uint8_t>&& bytes) { frames.push_back(std::move(bytes)); } };
+            for (const auto& path : paths)
+            {
+                writer.Add(path);
+            }
+            writer.Finish();
+            return frames;
+        }
+
+        std::vector<uint8_t> Concatenate(const std::vector<std::vector<uint8_t>>& frames)
+        {
+            std::vector<uint8_t> bytes;
+            for (const auto& frame : frames)
+            {
+                bytes.insert(bytes.end(), frame.begin(), frame.end());
+            }
+            return bytes;
+        }
+
+        // Reads the pipe until the end of the list, like the resizer does
+        struct PipeReader
+        {
+            explicit PipeReader(const HANDLE pipe) :
+                thread{ [this, pipe] {
+                    PathFrames::Reader reader;
+                    std::vector<uint8_t> buffer(PathFrames::FrameTargetSize);
+                    DWORD read = 0;
+                    while (status == PathFrames::Reader::Status::NeedMore && ReadFile(pipe, buffer.data(), static_cast<DWORD>(buffer.size()), &read, nullptr))
+                    {
+                        status = reader.Feed(buffer.data(), read, paths);
+                    }
+                    CloseHandle(pipe);
+                } }
+            {
+            }
+
+            void Join()
+            {
+                thread.join();
+            }
+
+            PathFrames::Reader::Status status = PathFrames::Reader::Status::NeedMore;
+            std::vector<std::wstring> paths;
+            std::thread thread;
+        };
+    }
+
+    TEST_CLASS (PathFramesTests)
+    {
+    public:
+        TEST_METHOD (Writer_GathersPathsIntoFrames)
+        {
+            const auto paths = MakePaths(5000);
+            const auto frames = WriteFrames(paths);
+
+            Assert::IsTrue(frames.size() > 2);
+            Assert::AreEqual(PathFrames::Magic, *reinterpret_cast<const uint32_t*>(frames[0].data()));
+            for (size_t i = 0; i + 2 < frames.size(); ++i)
+            {
+                const size_t header = i == 0 ? PathFrames::HeaderSize : 0;
+                Assert::IsTrue(frames[i].size() - header <= 4 + PathFrames::FrameTargetSize);
+                Assert::IsTrue(frames[i].size() - header > PathFrames::FrameTargetSize / 2);
+            }
+            // The end of the list
+            Assert::AreEqual(size_t{ 4 }, frames.back().size());
+
+            std::vector<std::wstring> read;
+            PathFrames::Reader reader;
+            const auto bytes = Concatenate(frames);
+            Assert::IsTrue(reader.Feed(bytes.data(), bytes.size(), read) == PathFrames::Reader::Status::Done);
+            Assert::IsTrue(read == paths);
+        }
+
+        TEST_METHOD (Writer_EmptyList)
+        {
+            const auto bytes = Concatenate(WriteFrames({}));
+            Assert::AreEqual(PathFrames::HeaderSize + 4, bytes.size());
+
+            std::vector<std::wstring> read;
+            PathFrames::Reader reader;
+            Assert::IsTrue(reader.Feed(bytes.data(), bytes.size(), read) == PathFrames::Reader::Status::Done);
+            Assert::IsTrue(read.empty());
+        }
+
+        TEST_METHOD (Reader_AcceptsAnySplit)
+        {
+            const auto paths = MakePaths(3000, 2);
+            const auto bytes = Concatenate(WriteFrames(paths));
+
+            std::mt19937 rng{ 5 };
+            for (const size_t maxPiece : { size_t{ 1 }, size_t{ 7 }, size_t{ 4096 }, size_t{ 200000 } })
+            {
+                std::vector<std::wstring> read;
+                PathFrames::Reader reader;
+                auto status = PathFrames::Reader::Status::NeedMore;
+                for (size_t offset = 0; offset < bytes.size();)
+                {
+                    const size_t size = (std::min)(bytes.size() - offset, 1 + rng() % maxPiece);
+                    status = reader.Feed(bytes.data() + offset, size, read);
+                    offset += size;
+                }
+                Assert::IsTrue(status == PathFrames::Reader::Status::Done);
+                Assert::IsTrue(read == paths);
+            }
+        }
+
+        TEST_METHOD (Reader_ReturnsFramesBeforeTheEnd)
+        {
+            const auto paths = MakePaths(3000, 3);
+            const auto frames = WriteFrames(paths);
+
+            std::vector<std::wstring> read;
+            PathFrames::Reader reader;
+            Assert::IsTrue(reader.Feed(frames[0].data(), frames[0].size(), read) == PathFrames::Reader::Status::NeedMore);
+            Assert::IsFalse(read.empty());
+            Assert::IsTrue(std::equal(read.begin(), read.end(), paths.begin()));
+        }
+
+        TEST_METHOD (Reader_RejectsMalformedInput)
+        {
+            const auto bytes = Concatenate(WriteFrames({ L"Image1.jpg", L"Image2.jpg" }));
+            auto feed = [](std::vector<uint8_t> input, std::vector<std::wstring>& read) {
+                PathFrames::Reader reader;
+                return reader.Feed(input.data(), input.size(), read);
+            };
+            std::vector<std::wstring> read;
+
+            // A list of lines, like the resizer used to get
+            const std::wstring lines = L"Image1.jpg\r\nImage2.jpg\r\n";
+            const auto lineBytes = reinterpret_cast<const uint8_t*>(lines.data());
+            Assert::IsTrue(feed({ lineBytes, lineBytes + lines.size() * sizeof(wchar_t) }, read) == PathFrames::Reader::Status::Malformed);
+
+            auto tooLarge = bytes;
+            tooLarge[PathFrames::HeaderSize + 3] = 0x7f;
+            Assert::IsTrue(feed(tooLarge, read) == PathFrames::Reader::Status::Malformed);
+
+            // The second path runs past the end of the frame, the first one isn't taken either
+            auto overflow = bytes;
+            overflow[PathFrames::HeaderSize + 4 + 4 + 20] = 100;
+            Assert::IsTrue(feed(overflow, read) == PathFrames::Reader::Status::Malformed);
+            Assert::IsTrue(read.empty());
+        }
+
+        TEST_METHOD (Handoff_WritesThroughPipe)
+        {
+            HANDLE readPipe = nullptr;
+            HANDLE writePipe = nullptr;
+            Assert::IsTrue(CreatePipe(&readPipe, &writePipe, nullptr, 0));
+            PipeReader reader{ readPipe };
+
+            const auto paths = MakePaths(20000, 4);
+            {
+                PathHandoff handoff{ writePipe };
+                for (const auto& path : paths)
+                {
+                    handoff.Add(path);
+                }
+            }
+
+            reader.Join();
+            Assert::IsTrue(reader.status == PathFrames::Reader::Status::Done);
+            Assert::IsTrue(reader.paths == paths);
+        }
+
+        TEST_METHOD (Handoff_CancelStopsWaitingForTheResizer)
+        {
+            const std::wstring name = std::format(L"\\\\.\\pipe\\PowerToys.ImageResizerLibUnitTests.{}", GetCurrentProcessId());
+            HANDLE pipe = CreateNamedPipeW(name.c_str(), PIPE_ACCESS_OUTBOUND, PIPE_TYPE_BYTE | PIPE_WAIT, 1, 0, 0, 0, nullptr);
+            Assert::IsTrue(pipe != INVALID_HANDLE_VALUE);
+
+            // Nobody ever connects
+            PathHandoff handoff{ pipe, true };
+            handoff.Add(L"Image1.jpg");
+            Sleep(50);
+            handoff.Cancel();
+        }
+
+        // 100k paths through a pipe: the time Explorer waits in the context menu and the time until the resizer has the
+        // whole list, for a write per path delimited by CRLF as before and for the frames written in the background.
+        BEGIN_TEST_METHOD_ATTRIBUTE(Benchmark_HandOff100kPaths)
+            TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD (Benchmark_HandOff100kPaths)
+        {
+            using clock = std::chrono::steady_clock;
+            const auto paths = MakePaths(100000, 6);
+            auto ms = [](const clock::duration duration) { return std::chrono::duration<double, std::milli>(duration).count(); };
+
+            {
+                HANDLE readPipe = nullptr;
+                HANDLE writePipe = nullptr;
+                Assert::IsTrue(CreatePipe(&readPipe, &writePipe, nullptr, 0));
+
+                const auto start = clock::now();
+                clock::time_point end;
+                size_t lineCount = 0;
+                std::thread reader{ [&] {
+                    // Splitting the lines like StreamReader.ReadLine does
+                    std::vector<wchar_t> buffer(4096);
+                    std::wstring line;
+                    DWORD read = 0;
+                    while (ReadFile(readPipe, buffer.data(), static_cast<DWORD>(buffer.size() * sizeof(wchar_t)), &read, nullptr) && read > 0)
+                    {
+                        for (size_t i = 0; i < read / sizeof(wchar_t); ++i)
+                        {
+                            if (buffer[i] == L'\n')
+                            {
+                                ++lineCount;
+                                line.clear();
+                            }
+                            else if (buffer[i] != L'\r')
+                            {
+                                line += buffer[i];
+                            }
+                        }
+                    }
+                    end = clock::now();
+                    CloseHandle(readPipe);
+                } };
+
+                for (const auto& path : paths)
+                {
+                    const std::wstring line = path + L"\r\n";
+                    DWORD written = 0;
+                    WriteFile(writePipe, line.data(), static_cast<DWORD>(line.size() * sizeof(wchar_t)), &written, nullptr);
+                }
+                const auto returned = clock::now();
+                CloseHandle(writePipe);
+                reader.join();
+
+                Assert::AreEqual(paths.size(), lineCount);
+                Logger::WriteMessage(std::format(L"Lines: Explorer waits {:.1f} ms, list complete after {:.1f} ms\n", ms(returned - start), ms(end - start)).c_str());
+            }
+
+            {
+                HANDLE readPipe = nullptr;
+                HANDLE writePipe = nullptr;
+                Assert::IsTrue(CreatePipe(&readPipe, &writePipe, nullptr, 0));
+
+                const auto start = clock::now();
+                PipeReader reader{ readPipe };
+                {
+                    PathHandoff handoff{ writePipe };
+                    for (const auto& path : paths)
+                    {
+                        handoff.Add(path);
+                    }
+                }
+                const auto returned = clock::now();
+                reader.Join();
+                const auto end = clock::now();
+
+                Assert::IsTrue(reader.paths == paths);
+                Logger::WriteMessage(std::format(L"Frames: Explorer waits {:.1f} ms, list complete after {:.1f} ms\n", ms(returned - start), ms(end - start)).c_str());
+            }
+        }
+    };
+}
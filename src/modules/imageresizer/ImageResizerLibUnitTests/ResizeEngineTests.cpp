@@ -0,0 +1,341 @@
+#include "pch.h"
+
+#include <ResizeEngine.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <format>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using Resampling::Filter;
+
+namespace ImageResizerLibUnitTests
+{
+    namespace
+    {
+        struct Image
+        {
+            uint32_t width = 0;
+            uint32_t height = 0;
+            std::vector<uint8_t> pixels;
+
+            Image(const uint32_t width, const uint32_t height) :
+                width{ width }, height{ height }, pixels(static_cast<size_t>(width) * height * 4)
+            {
+            }
+
+            Resampling::ImageView View()
+            {
+                return { pixels.data(), width, height, static_cast<size_t>(width) * 4 };
+            }
+
+            Resampling::ConstImageView View() const
+            {
+                return { pixels.data(), width, height, static_cast<size_t>(width) * 4 };
+            }
+        };
+
+        // Premultiplied noise, or smooth gradients to keep ringing within the alpha
+        Image MakeImage(const uint32_t width, const uint32_t height, const uint32_t seed, const bool noise = true)
+        {
+            std::mt19937 rng{ seed };
+            Image image{ width, height };
+            uint8_t* pixel = image.pixels.data();
+            for (uint32_t y = 0; y < height; ++y)
+            {
+                for (uint32_t x = 0; x < width; ++x, pixel += 4)
+                {
+                    const uint32_t alpha = noise ? rng() % 256 : 255;
+                    pixel[0] = static_cast<uint8_t>(noise ? rng() % (alpha + 1) : x * 255 / width);
+                    pixel[1] = static_cast<uint8_t>(noise ? rng() % (alpha + 1) : y * 255 / height);
+                    pixel[2] = static_cast<uint8_t>(noise ? rng() % (alpha + 1) : (x + y) * 127 / (width + height));
+                    pixel[3] = static_cast<uint8_t>(alpha);
+                }
+            }
+            return image;
+        }
+
+        double ReferenceKernel(const Filter filter, const double x)
+        {
+            const double pi = 3.14159265358979323846;
+            const double t = std::abs(x);
+            if (filter == Filter::Bicubic)
+            {
+                const double a = -0.5;
+                return t < 1 ? (a + 2) * t * t * t - (a + 3) * t * t + 1 : t < 2 ? a * t * t * t - 5 * a * t * t + 8 * a * t - 4 * a : 0;
+            }
+            return t == 0 ? 1 : t < 3 ? std::sin(pi * t) / (pi * t) * std::sin(pi * t / 3) / (pi * t / 3) : 0;
+        }
+
+        uint8_t ReferenceRound(const double value)
+        {
+            return static_cast<uint8_t>(std::clamp(std::floor(value + 0.5), 0.0, 255.0));
+        }
+
+        // Resamples count values, step apart, into destinationSize values, in floating point
+        void ReferenceResample(const Filter filter, const uint8_t* source, const uint32_t sourceSize, const size_t sourceStep, uint8_t* destination, const uint32_t destinationSize, const size_t destinationStep)
+        {
+            const double scale = static_cast<double>(sourceSize) / destinationSize;
+            const double filterScale = (std::max)(1.0, scale);
+            const double support = (filter == Filter::Bicubic ? 2 : 3) * filterScale;
+            for (uint32_t i = 0; i < destinationSize; ++i)
+            {
+                const double center = (i + 0.5) * scale;
+                double sums[4] = {};
+                double total = 0;
+                for (auto j = static_cast<int64_t>(std::floor(center - support)); j <= static_cast<int64_t>(std::ceil(center + support)); ++j)
+                {
+                    const double weight = ReferenceKernel(filter, (j + 0.5 - center) / filterScale);
+                    const uint8_t* pixel = source + std::clamp<int64_t>(j, 0, sourceSize - 1) * sourceStep;
+                    for (int c = 0; c < 4; ++c)
+                    {
+                        sums[c] += weight * pixel[c];
+                    }
+                    total += weight;
+                }
+                for (int c = 0; c < 4; ++c)
+                {
+                    destination[i * destinationStep + c] = ReferenceRound(sums[c] / total);
+                }
+            }
+        }
+
+        // The scalar reference: rows, then columns, then color clamped to alpha
+        Image ReferenceResize(const Image& source, const uint32_t width, const uint32_t height, const Filter filter)
+        {
+            Image intermediate{ width, source.height };
+            for (uint32_t y = 0; y < source.height; ++y)
+            {
+                ReferenceResample(filter, source.pixels.data() + y * source.width * 4, source.width, 4, intermediate.pixels.data() + y * width * 4, width, 4);
+            }
+
+            Image result{ width, height };
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                ReferenceResample(filter, intermediate.pixels.data() + x * 4, source.height, width * 4, result.pixels.data() + x * 4, height, width * 4);
+            }
+            for (size_t i = 0; i < result.pixels.size(); i += 4)
+            {
+                for (int c = 0; c < 3; ++c)
+                {
+                    result.pixels[i + c] = (std::min)(result.pixels[i + c], result.pixels[i + 3]);
+                }
+            }
+            return result;
+        }
+
+        Image Resize(const Image& source, const uint32_t width, const uint32_t height, const Filter filter)
+        {
+            Image result{ width, height };
+            Resampling::Resize(source.View(), result.View(), filter);
+            return result;
+        }
+
+        int MaxDifference(const Image& a, const Image& b)
+        {
+            int difference = 0;
+            for (size_t i = 0; i < a.pixels.size(); ++i)
+            {
+                difference = (std::max)(difference, std::abs(a.pixels[i] - b.pixels[i]));
+            }
+            return difference;
+        }
+    }
+
+    TEST_CLASS (ResizeEngineTests)
+    {
+    public:
+        TEST_METHOD (WeightTable_WeightsSumToOne)
+        {
+            for (const auto filter : { Filter::Bicubic, Filter::Lanczos3 })
+            {
+                for (const auto& [source, destination] : { std::pair{ 1u, 7u }, std::pair{ 2u, 2u }, std::pair{ 5u, 3u }, std::pair{ 100u, 33u }, std::pair{ 33u, 100u }, std::pair{ 4000u, 17u } })
+                {
+                    const Resampling::WeightTable table{ filter, source, destination };
+                    Assert::AreEqual(destination, table.Size());
+                    Assert::IsTrue(table.Taps() <= source);
+                    for (uint32_t i = 0; i < destination; ++i)
+                    {
+                        Assert::IsTrue(table.First(i) + table.Taps() <= source);
+                        Assert::IsTrue(i == 0 || table.First(i) >= table.First(i - 1));
+                        int sum = 0;
+                        for (uint32_t k = 0; k < table.Taps(); ++k)
+                        {
+                            sum += table.Weights(i)[k];
+                        }
+                        Assert::AreEqual(1 << Resampling::WeightBits, sum);
+                    }
+                }
+            }
+        }
+
+        TEST_METHOD (Resize_SameSizeIsExact)
+        {
+            const auto source = MakeImage(67, 41, 1);
+            for (const auto filter : { Filter::Bicubic, Filter::Lanczos3 })
+            {
+                Assert::IsTrue(Resize(source, source.width, source.height, filter).pixels == source.pixels);
+            }
+        }
+
+        TEST_METHOD (Resize_FlatImageStaysFlat)
+        {
+            Image source{ 123, 77 };
+            for (size_t i = 0; i < source.pixels.size(); i += 4)
+            {
+                source.pixels[i] = 10;
+                source.pixels[i + 1] = 100;
+                source.pixels[i + 2] = 200;
+                source.pixels[i + 3] = 255;
+            }
+            for (const auto filter : { Filter::Bicubic, Filter::Lanczos3 })
+            {
+                const auto result = Resize(source, 50, 190, filter);
+                for (size_t i = 0; i < result.pixels.size(); i += 4)
+                {
+                    Assert::IsTrue(std::equal(result.pixels.begin() + i, result.pixels.begin() + i + 4, source.pixels.begin()));
+                }
+            }
+        }
+
+        TEST_METHOD (Resize_MatchesScalarReference)
+        {
+            uint32_t seed = 2;
+            for (const auto filter : { Filter::Bicubic, Filter::Lanczos3 })
+            {
+                for (const bool noise : { true, false })
+                {
+                    for (const auto& [width, height] : { std::pair{ 1u, 1u }, std::pair{ 3u, 2u }, std::pair{ 64u, 48u }, std::pair{ 17u, 211u }, std::pair{ 250u, 9u }, std::pair{ 301u, 199u } })
+                    {
+                        const auto source = MakeImage(97, 61, seed++, noise);
+                        const auto expected = ReferenceResize(source, width, height, filter);
+                        const auto actual = Resize(source, width, height, filter);
+                        // Fixed point weights against exact ones, rounded in both passes
+                        Assert::IsTrue(MaxDifference(expected, actual) <= 2, std::format(L"{}x{}", width, height).c_str());
+                    }
+                }
+            }
+        }
+
+        TEST_METHOD (Engine_TilesMatchWholeImage)
+        {
+            const auto source = MakeImage(2600, 1700, 3);
+            ResizeEngine engine{ 8 };
+            for (const auto& [width, height] : { std::pair{ 800u, 523u }, std::pair{ 3000u, 2000u } })
+            {
+                Image result{ width, height };
+                const ResizeEngine::Job job{ source.View(), result.View(), Filter::Lanczos3 };
+                Assert::IsTrue(engine.TileCount(job) > 1);
+                engine.Run({ job });
+                Assert::IsTrue(result.pixels == Resize(source, width, height, Filter::Lanczos3).pixels);
+            }
+        }
+
+        TEST_METHOD (Engine_ResizesEveryImage)
+        {
+            std::mt19937 rng{ 4 };
+            std::vector<Image> sources;
+            std::vector<Image> results;
+            std::vector<ResizeEngine::Job> jobs;
+            for (uint32_t i = 0; i < 40; ++i)
+            {
+                sources.push_back(MakeImage(1 + rng() % 300, 1 + rng() % 300, i));
+                results.emplace_back(1 + rng() % 200, 1 + rng() % 200);
+            }
+            for (size_t i = 0; i < sources.size(); ++i)
+            {
+                jobs.push_back({ sources[i].View(), results[i].View(), i % 2 ? Filter::Bicubic : Filter::Lanczos3 });
+            }
+
+            ResizeEngine engine{ 4 };
+            engine.Run(jobs);
+            for (size_t i = 0; i < jobs.size(); ++i)
+            {
+                Assert::IsTrue(results[i].pixels == Resize(sources[i], results[i].width, results[i].height, jobs[i].filter).pixels);
+            }
+        }
+
+        TEST_METHOD (Pool_RunsNestedTasks)
+        {
+            WorkStealingPool pool{ 3 };
+            std::atomic<int> count = 0;
+            TaskGroup outer{ pool };
+            for (int i = 0; i < 20; ++i)
+            {
+                outer.Run([&] {
+                    TaskGroup inner{ pool };
+                    for (int j = 0; j < 50; ++j)
+                    {
+                        inner.Run([&] { ++count; });
+                    }
+                    inner.Wait();
+                });
+            }
+            outer.Wait();
+            Assert::AreEqual(1000, count.load());
+        }
+
+        TEST_METHOD (Pool_RethrowsTaskExceptions)
+        {
+            WorkStealingPool pool{ 2 };
+            TaskGroup group{ pool };
+            std::atomic<int> count = 0;
+            for (int i = 0; i < 10; ++i)
+            {
+                group.Run([&, i] {
+                    ++count;
+                    if (i == 5)
+                    {
+                        throw std::runtime_error("failed");
+                    }
+                });
+            }
+            Assert::ExpectException<std::runtime_error>([&] { group.Wait(); });
+            Assert::AreEqual(10, count.load());
+        }
+
+        // A 12 megapixel photo to 1280x960 with the scalar reference, the SIMD kernel on one thread and the engine, then
+        // a batch of 16 of them through the engine
+        BEGIN_TEST_METHOD_ATTRIBUTE(Benchmark_Resize)
+            TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD (Benchmark_Resize)
+        {
+            using clock = std::chrono::steady_clock;
+            auto ms = [](const clock::duration duration) { return std::chrono::duration<double, std::milli>(duration).count(); };
+            const auto source = MakeImage(4000, 3000, 5, false);
+
+            auto start = clock::now();
+            const auto expected = ReferenceResize(source, 1280, 960, Filter::Lanczos3);
+            Logger::WriteMessage(std::format(L"Scalar reference: {:.1f} ms\n", ms(clock::now() - start)).c_str());
+
+            start = clock::now();
+            const auto single = Resize(source, 1280, 960, Filter::Lanczos3);
+            Logger::WriteMessage(std::format(L"Kernel, one thread: {:.1f} ms\n", ms(clock::now() - start)).c_str());
+            Assert::IsTrue(MaxDifference(expected, single) <= 2);
+
+            ResizeEngine engine;
+            Image result{ 1280, 960 };
+            start = clock::now();
+            engine.Run({ { source.View(), result.View(), Filter::Lanczos3 } });
+            Logger::WriteMessage(std::format(L"Engine, {} threads: {:.1f} ms\n", engine.ThreadCount(), ms(clock::now() - start)).c_str());
+            Assert::IsTrue(result.pixels == single.pixels);
+
+            std::vector<Image> results(16, Image{ 1280, 960 });
+            std::vector<ResizeEngine::Job> jobs;
+            for (auto& image : results)
+            {
+                jobs.push_back({ source.View(), image.View(), Filter::Lanczos3 });
+            }
+            start = clock::now();
+            engine.Run(jobs);
+            Logger::WriteMessage(std::format(L"Engine, 16 images: {:.1f} ms\n", ms(clock::now() - start)).c_str());
+        }
+    };
+}
@@ -0,0 +1,13 @@
+//{{NO_DEPENDENCIES}}
+// Microsoft Visual C++ generated include file.
+// Used by ImageResizerLibUnitTests.rc
+
+//////////////////////////////
+// Non-localizable
+
+#define FILE_DESCRIPTION "PowerToys ImageResizerLibUnitTests"
+#define INTERNAL_NAME "ImageResizerLibUnitTests"
+#define ORIGINAL_FILENAME "ImageResizerLibUnitTests.dll"
+
+// Non-localizable
+//////////////////////////////
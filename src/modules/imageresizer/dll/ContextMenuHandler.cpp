@@ -3,6 +3,7 @@
 #include "pch.h"
 #include "ContextMenuHandler.h"
 
+#include <PathHandoff.h>
 #include <Settings.h>
 #include <trace.h>
 
@@ -249,10 +250,8 @@ HRESULT CContextMenuHandler::ResizePictures(CMINVOKECOMMANDINFO* pici, IShellIte
         hr = HRESULT_FROM_WIN32(GetLastError());
         return hr;
     }
-    CAtlFile writePipe(hWritePipe);
-
     CString commandLine;
-    commandLine.Format(_T("\"%s\""), lpApplicationName);
+    commandLine.Format(_T("\"%s\" /frames"), lpApplicationName);
 
     // Set the output directory
     if (m_pidlFolder)
@@ -284,7 +283,7 @@ HRESULT CContextMenuHandler::ResizePictures(CMINVOKECOMMANDINFO* pici, IShellIte
     PROCESS_INFORMATION processInformation;
 
     // Start the resizer
-    CreateProcess(
+    BOOL started = CreateProcess(
         NULL,
         lpszCommandLine,
         NULL,
@@ -296,17 +295,31 @@ HRESULT CContextMenuHandler::ResizePictures(CMINVOKECOMMANDINFO* pici, IShellIte
         &startupInfo,
         &processInformation);
     delete[] lpszCommandLine;
+
+    // The resizer has its own copy of the read end. Closing ours makes writes fail if it exits early.
+    CloseHandle(hReadPipe);
+    if (!started)
+    {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+        CloseHandle(hWritePipe);
+        return hr;
+    }
     if (!CloseHandle(processInformation.hProcess))
     {
         hr = HRESULT_FROM_WIN32(GetLastError());
+        CloseHandle(hWritePipe);
         return hr;
     }
     if (!CloseHandle(processInformation.hThread))
     {
         hr = HRESULT_FROM_WIN32(GetLastError());
+        CloseHandle(hWritePipe);
         return hr;
     }
 
+    // The paths are written in the background, the resizer reading them as they come
+    PathHandoff handoff{ hWritePipe };
+
     // psiItemArray is NULL if called from InvokeCommand. This part is used for the MSI installer. It is not NULL if it is called from Invoke (MSIX).
     if (!psiItemArray)
     {
@@ -314,34 +327,21 @@ HRESULT CContextMenuHandler::ResizePictures(CMINVOKECOMMANDINFO* pici, IShellIte
         HDropIterator i(m_pdtobj);
         for (i.First(); !i.IsDone(); i.Next())
         {
-            CString fileName(i.CurrentItem());
-            fileName.Append(_T("\r\n"));
-
-            writePipe.Write(fileName, fileName.GetLength() * sizeof(TCHAR));
+            LPTSTR fileName = i.CurrentItem();
+            if (fileName)
+            {
+                handoff.Add(fileName);
+                free(fileName);
+            }
         }
     }
     else
     {
         //m_pdtobj will be NULL when invoked from the MSIX build as Initialize is never called (IShellExtInit functions aren't called in case of MSIX).
-        DWORD fileCount = 0;
-        // Gets the list of files currently selected using the IShellItemArray
-        psiItemArray->GetCount(&fileCount);
-        // Iterate over the list of files
-        for (DWORD i = 0; i < fileCount; i++)
-        {
-            IShellItem* shellItem;
-            psiItemArray->GetItemAt(i, &shellItem);
-            LPWSTR itemName;
-            // Retrieves the entire file system path of the file from its shell item
-            shellItem->GetDisplayName(SIGDN_FILESYSPATH, &itemName);
-            CString fileName(itemName);
-            fileName.Append(_T("\r\n"));
-            // Write the file path into the input stream for image resizer
-            writePipe.Write(fileName, fileName.GetLength() * sizeof(TCHAR));
-        }
+        handoff.AddItems(psiItemArray);
     }
 
-    writePipe.Close();
+    handoff.Finish();
     hr = S_OK;
     return hr;
 }
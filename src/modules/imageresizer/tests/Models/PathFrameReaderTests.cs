@@ -0,0 +1,138 @@
+﻿// Copyright (c) Microsoft Corporation
+// The Microsoft Corporation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+using System;
+using System.Buffers.Binary;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Text;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+
+namespace ImageResizer.Models
+{
+    [TestClass]
+    public class PathFrameReaderTests
+    {
+        // Writes the frames like PathFrames::Writer does
+        internal static byte[] WriteFrames(IEnumerable<IEnumerable<string>> frames, bool end = true)
+        {
+            using var stream = new MemoryStream();
+            using var writer = new BinaryWriter(stream);
+            writer.Write(PathFrameReader.Magic);
+            writer.Write(PathFrameReader.Version);
+            foreach (var frame in frames)
+            {
+                using var payload = new MemoryStream();
+                using var payloadWriter = new BinaryWriter(payload);
+                foreach (var path in frame)
+                {
+                    payloadWriter.Write((uint)path.Length);
+                    payloadWriter.Write(Encoding.Unicode.GetBytes(path));
+                }
+
+                writer.Write((uint)payload.Length);
+                writer.Write(payload.ToArray());
+            }
+
+            if (end)
+            {
+                writer.Write(0u);
+            }
+
+            return stream.ToArray();
+        }
+
+        [TestMethod]
+        public void ReadsEveryFrame()
+        {
+            var frames = new[]
+            {
+                new[] { @"C:\Pictures\Image1.jpg", @"C:\Pictures\Ünïcödé 🖼.png" },
+                new[] { string.Empty, @"\\server\share\Image2.jpg" },
+            };
+
+            var result = new PathFrameReader(new MemoryStream(WriteFrames(frames))).ReadFrames().ToList();
+
+            Assert.AreEqual(2, result.Count);
+            CollectionAssert.AreEqual(frames[0], result[0].ToArray());
+            CollectionAssert.AreEqual(frames[1], result[1].ToArray());
+        }
+
+        [TestMethod]
+        public void ReturnsFramesBeforeTheEndOfTheList()
+        {
+            var bytes = WriteFrames(new[] { new[] { "Image1.jpg" }, new[] { "Image2.jpg" } }, end: false);
+            var stream = new TrickleStream(bytes);
+
+            using var frames = new PathFrameReader(stream).ReadFrames().GetEnumerator();
+
+            Assert.IsTrue(frames.MoveNext());
+            Assert.AreEqual("Image1.jpg", frames.Current.Single());
+
+            // Only the first frame was read from the stream
+            Assert.IsTrue(stream.Position < bytes.Length);
+
+            Assert.IsTrue(frames.MoveNext());
+            Assert.AreEqual("Image2.jpg", frames.Current.Single());
+            Assert.IsFalse(frames.MoveNext());
+        }
+
+        [TestMethod]
+        public void StopsAtTruncatedFrames()
+        {
+            var bytes = WriteFrames(new[] { new[] { "Image1.jpg" }, new[] { "Image2.jpg" } });
+
+            var result = new PathFrameReader(new MemoryStream(bytes, 0, bytes.Length - 6)).ReadFrames().ToList();
+
+            Assert.AreEqual(1, result.Count);
+            Assert.AreEqual("Image1.jpg", result[0].Single());
+        }
+
+        [TestMethod]
+        public void RejectsMalformedLists()
+        {
+            Assert.ThrowsException<InvalidDataException>(() => new PathFrameReader(new MemoryStream()).ReadFrames().ToList());
+            Assert.ThrowsException<InvalidDataException>(() => new PathFrameReader(new MemoryStream(Encoding.Unicode.GetBytes("Image1.jpg\r\n"))).ReadFrames().ToList());
+
+            var bytes = WriteFrames(new[] { new[] { "Image1.jpg" } });
+
+            // Path longer than its frame
+            var overflow = (byte[])bytes.Clone();
+            BinaryPrimitives.WriteUInt32LittleEndian(overflow.AsSpan(12), 100);
+            Assert.ThrowsException<InvalidDataException>(() => new PathFrameReader(new MemoryStream(overflow)).ReadFrames().ToList());
+
+            // Frame larger than the writer produces
+            var huge = (byte[])bytes.Clone();
+            BinaryPrimitives.WriteUInt32LittleEndian(huge.AsSpan(8), PathFrameReader.MaxFrameSize + 1);
+            Assert.ThrowsException<InvalidDataException>(() => new PathFrameReader(new MemoryStream(huge)).ReadFrames().ToList());
+        }
+
+        [TestMethod]
+        public void FromCommandLineReadsFramesFromStandardInput()
+        {
+            var bytes = WriteFrames(new[] { new[] { "Image1.jpg", "Image2.jpg" } });
+
+            var result = ResizeBatch.FromCommandLine(null, () => new MemoryStream(bytes), new[] { "/frames", "/d", "OutputDir", "Image3.jpg" });
+
+            CollectionAssert.AreEquivalent(new List<string> { "Image1.jpg", "Image2.jpg", "Image3.jpg" }, result.Files.ToArray());
+            Assert.AreEqual("OutputDir", result.DestinationDirectory);
+        }
+
+        // Returns a few bytes per read, like a pipe being written to
+        private sealed class TrickleStream : MemoryStream
+        {
+            public TrickleStream(byte[] bytes)
+                : base(bytes)
+            {
+            }
+
+            public override int Read(Span<byte> buffer)
+                => base.Read(buffer.Slice(0, Math.Min(buffer.Length, 3)));
+
+            public override int Read(byte[] buffer, int offset, int count)
+                => base.Read(buffer, offset, Math.Min(count, 3));
+        }
+    }
+}
@@ -0,0 +1,113 @@
+﻿// Copyright (c) Microsoft Corporation
+// The Microsoft Corporation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+using System;
+using System.Buffers.Binary;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+
+namespace ImageResizer.Models
+{
+    /// <summary>
+    /// Reads the list of files written by the shell extensions when the resizer is started with /frames, see
+    /// PathFrames.h. Frames are returned as soon as they're received, before the rest of the list.
+    /// </summary>
+    public class PathFrameReader
+    {
+        public const uint Magic = 0x52495450;
+        public const uint Version = 1;
+        public const int MaxFrameSize = 1024 * 1024;
+
+        private readonly Stream _stream;
+        private byte[] _payload = Array.Empty<byte>();
+
+        public PathFrameReader(Stream stream)
+        {
+            _stream = stream;
+        }
+
+        public IEnumerable<IReadOnlyList<string>> ReadFrames()
+        {
+            ReadHeader();
+
+            List<string> paths;
+            while ((paths = ReadFrame()) != null)
+            {
+                yield return paths;
+            }
+        }
+
+        private void ReadHeader()
+        {
+            Span<byte> header = stackalloc byte[8];
+            if (!ReadAll(header))
+            {
+                throw new InvalidDataException("The list of files is empty.");
+            }
+
+            if (BinaryPrimitives.ReadUInt32LittleEndian(header) != Magic || BinaryPrimitives.ReadUInt32LittleEndian(header.Slice(4)) != Version)
+            {
+                throw new InvalidDataException("The list of files has an unknown format.");
+            }
+        }
+
+        // Null at the end of the list. A writer going away before the end leaves it at the files received so far.
+        private List<string> ReadFrame()
+        {
+            Span<byte> sizeBuffer = stackalloc byte[4];
+            if (!ReadAll(sizeBuffer))
+            {
+                return null;
+            }
+
+            var size = BinaryPrimitives.ReadUInt32LittleEndian(sizeBuffer);
+            if (size == 0)
+            {
+                return null;
+            }
+
+            if (size > MaxFrameSize)
+            {
+                throw new InvalidDataException("A frame of the list of files is too large.");
+            }
+
+            if (_payload.Length < size)
+            {
+                _payload = new byte[size];
+            }
+
+            var payload = _payload.AsSpan(0, (int)size);
+            return ReadAll(payload) ? ParseFrame(payload) : null;
+        }
+
+        private static List<string> ParseFrame(ReadOnlySpan<byte> payload)
+        {
+            var paths = new List<string>();
+            while (!payload.IsEmpty)
+            {
+                if (payload.Length < 4)
+                {
+                    throw new InvalidDataException("A frame of the list of files is truncated.");
+                }
+
+                var length = BinaryPrimitives.ReadUInt32LittleEndian(payload);
+                payload = payload.Slice(4);
+                if (length > payload.Length / 2)
+                {
+                    throw new InvalidDataException("A frame of the list of files is truncated.");
+                }
+
+                paths.Add(Encoding.Unicode.GetString(payload.Slice(0, (int)length * 2)));
+                payload = payload.Slice((int)length * 2);
+            }
+
+            return paths;
+        }
+
+        // False at the end of the stream, before any byte or in the middle of the buffer
+        private bool ReadAll(Span<byte> buffer)
+            => _stream.ReadAtLeast(buffer, buffer.Length, throwOnEndOfStream: false) == buffer.Length;
+    }
+}
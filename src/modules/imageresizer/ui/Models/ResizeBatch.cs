@@ -24,11 +24,17 @@ namespace ImageResizer.Models
         public ICollection<string> Files { get; } = new List<string>();
 
         public static ResizeBatch FromCommandLine(TextReader standardInput, string[] args)
+            => FromCommandLine(standardInput, Console.OpenStandardInput, args);
+
+        public static ResizeBatch FromCommandLine(TextReader standardInput, Func<Stream> openStandardInput, string[] args)
         {
             var batch = new ResizeBatch();
             const string pipeNamePrefix = "\\\\.\\pipe\\";
             string pipeName = null;
 
+            // The shell extensions write the list as binary frames rather than lines, see PathFrameReader
+            var framed = false;
+
             for (var i = 0; i < args?.Length; i++)
             {
                 if (args[i] == "/d")
@@ -36,6 +42,11 @@ namespace ImageResizer.Models
                     batch.DestinationDirectory = args[++i];
                     continue;
                 }
+                else if (args[i] == "/frames")
+                {
+                    framed = true;
+                    continue;
+                }
                 else if (args[i].Contains(pipeNamePrefix))
                 {
                     pipeName = args[i].Substring(pipeNamePrefix.Length);
@@ -47,13 +58,23 @@ namespace ImageResizer.Models
 
             if (string.IsNullOrEmpty(pipeName))
             {
-                // NB: We read these from stdin since there are limits on the number of args you can have
-                string file;
-                if (standardInput != null)
+                if (framed)
                 {
-                    while ((file = standardInput.ReadLine()) != null)
+                    using (var input = openStandardInput())
                     {
-                        batch.Files.Add(file);
+                        batch.AddFrames(input);
+                    }
+                }
+                else
+                {
+                    // NB: We read these from stdin since there are limits on the number of args you can have
+                    string file;
+                    if (standardInput != null)
+                    {
+                        while ((file = standardInput.ReadLine()) != null)
+                        {
+                            batch.Files.Add(file);
+                        }
                     }
                 }
             }
@@ -65,14 +86,21 @@ namespace ImageResizer.Models
                     // Connect to the pipe or wait until the pipe is available.
                     pipeClient.Connect();
 
-                    using (StreamReader sr = new StreamReader(pipeClient, Encoding.Unicode))
+                    if (framed)
                     {
-                        string file;
-
-                        // Display the read text to the console
-                        while ((file = sr.ReadLine()) != null)
+                        batch.AddFrames(pipeClient);
+                    }
+                    else
+                    {
+                        using (StreamReader sr = new StreamReader(pipeClient, Encoding.Unicode))
                         {
-                            batch.Files.Add(file);
+                            string file;
+
+                            // Display the read text to the console
+                            while ((file = sr.ReadLine()) != null)
+                            {
+                                batch.Files.Add(file);
+                            }
                         }
                     }
                 }
@@ -81,6 +109,15 @@ namespace ImageResizer.Models
             return batch;
         }
 
+        // Adds the files of every frame as it's received
+        private void AddFrames(Stream input)
+        {
+            foreach (var frame in new PathFrameReader(input).ReadFrames())
+            {
+                Files.AddRange(frame);
+            }
+        }
+
         public IEnumerable<ResizeError> Process(Action<int, double> reportProgress, CancellationToken cancellationToken)
         {
             double total = Files.Count;
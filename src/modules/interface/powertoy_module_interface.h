@@ -3,6 +3,8 @@
 #include <compare>
 #include <common/utils/gpo.h>
 
+class KeyboardHookDispatcher;
+
 /*
   DLL Interface for PowerToys. The powertoy_create() (see below) must return
   an object that implements this interface.
@@ -17,6 +19,7 @@
     - get_key() to get the non localized ID of the PowerToy,
     - enable() to initialize the PowerToy.
     - get_hotkeys() to register the hotkeys the PowerToy uses.
+    - set_keyboard_hook_dispatcher() to share its low level keyboard hook.
 
   While running, the runner might call the following methods between create_powertoy()
   and destroy():
@@ -125,6 +128,14 @@ public:
         return powertoys_gpo::gpo_rule_configured_not_configured;
     }
 
+    /* Called once after powertoy_create() with the dispatcher of the runner's low level keyboard hook, which outlives
+     * the PowerToy. PowerToys which need raw keyboard events should subscribe to it instead of installing their own
+     * WH_KEYBOARD_LL hook, and unsubscribe when disabled.
+     */
+    virtual void set_keyboard_hook_dispatcher(KeyboardHookDispatcher* /*dispatcher*/)
+    {
+    }
+
     // Some actions like PastePlain generate new inputs, which we don't want to catch again.
     // The flag was purposefully chose to not collide with other keyboard manager flags.
     const static inline ULONG_PTR CENTRALIZED_KEYBOARD_HOOK_DONT_TRIGGER_FLAG = 0x110;
@@ -76,7 +76,7 @@ static IAsyncOperation<bool> OrphanKeysConfirmationDialog(
     std::wstring orphanKeyString;
     for (auto k : keys)
     {
-        orphanKeyString.append(state.keyboardMap.GetKeyName(k));
+        orphanKeyString.append(state.keyboardMap.GetKeyNameView(k));
         orphanKeyString.append(L", ");
     }
 
@@ -103,23 +103,23 @@ namespace EditorHelpers
         std::vector<winrt::hstring> keys;
         if (shortcut.winKey != ModifierKey::Disabled)
         {
-            keys.push_back(winrt::to_hstring(keyboardMap.GetKeyName(shortcut.GetWinKey(ModifierKey::Both)).c_str()));
+            keys.push_back(winrt::hstring{ keyboardMap.GetKeyNameView(shortcut.GetWinKey(ModifierKey::Both)) });
         }
         if (shortcut.ctrlKey != ModifierKey::Disabled)
         {
-            keys.push_back(winrt::to_hstring(keyboardMap.GetKeyName(shortcut.GetCtrlKey()).c_str()));
+            keys.push_back(winrt::hstring{ keyboardMap.GetKeyNameView(shortcut.GetCtrlKey()) });
         }
         if (shortcut.altKey != ModifierKey::Disabled)
         {
-            keys.push_back(winrt::to_hstring(keyboardMap.GetKeyName(shortcut.GetAltKey()).c_str()));
+            keys.push_back(winrt::hstring{ keyboardMap.GetKeyNameView(shortcut.GetAltKey()) });
         }
         if (shortcut.shiftKey != ModifierKey::Disabled)
         {
-            keys.push_back(winrt::to_hstring(keyboardMap.GetKeyName(shortcut.GetShiftKey()).c_str()));
+            keys.push_back(winrt::hstring{ keyboardMap.GetKeyNameView(shortcut.GetShiftKey()) });
         }
         if (shortcut.actionKey != NULL)
         {
-            keys.push_back(winrt::to_hstring(keyboardMap.GetKeyName(shortcut.actionKey).c_str()));
+            keys.push_back(winrt::hstring{ keyboardMap.GetKeyNameView(shortcut.actionKey) });
         }
         return keys;
     }
@@ -38,12 +38,16 @@ void KeyDropDownControl::SetSelectedValue(std::wstring value)
 // Get keys name list depending if Disable is in dropdown
 std::vector<std::pair<DWORD, std::wstring>> KeyDropDownControl::GetKeyList(bool isShortcut, bool renderDisable)
 {
-    auto list = keyboardManagerState->keyboardMap.GetKeyNameList(isShortcut);
-    if (renderDisable)
+    const auto& keyNames = keyboardManagerState->keyboardMap.GetKeyNameList(isShortcut);
+    if (!renderDisable)
     {
-        list.insert(list.begin(), { CommonSharedConstants::VK_DISABLED, keyboardManagerState->keyboardMap.GetKeyName(CommonSharedConstants::VK_DISABLED) });
+        return keyNames;
     }
 
+    std::vector<std::pair<DWORD, std::wstring>> list;
+    list.reserve(keyNames.size() + 1);
+    list.push_back({ CommonSharedConstants::VK_DISABLED, std::wstring{ keyboardManagerState->keyboardMap.GetKeyNameView(CommonSharedConstants::VK_DISABLED) } });
+    list.insert(list.end(), keyNames.begin(), keyNames.end());
     return list;
 }
 
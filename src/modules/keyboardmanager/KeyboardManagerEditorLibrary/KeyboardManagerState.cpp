@@ -208,7 +208,7 @@ void KeyboardManagerState::UpdateDetectSingleKeyRemapUI()
     // Since this function is invoked from the back-end thread, in order to update the UI the dispatcher must be used.
     currentSingleKeyUI.as<StackPanel>().Dispatcher().RunAsync(Windows::UI::Core::CoreDispatcherPriority::Normal, [this]() {
         currentSingleKeyUI.as<StackPanel>().Children().Clear();
-        hstring key = winrt::to_hstring(keyboardMap.GetKeyName(detectedRemapKey).c_str());
+        hstring key{ keyboardMap.GetKeyNameView(detectedRemapKey) };
         AddKeyToLayout(currentSingleKeyUI.as<StackPanel>(), key);
         try
         {
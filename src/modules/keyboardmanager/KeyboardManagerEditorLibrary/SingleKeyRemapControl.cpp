@@ -309,8 +309,6 @@ void SingleKeyRemapControl::createDetectKeyWindow(winrt::Windows::Foundation::II
 
         if (detectedKey != NULL)
         {
-            std::vector<DWORD> keyCodeList = keyboardManagerState.keyboardMap.GetKeyCodeList();
-
             // Update the drop down list with the new language to ensure that the correct key is displayed
             linkedRemapDropDown.ItemsSource(UIHelpers::ToBoxValue(keyboardManagerState.keyboardMap.GetKeyNameList()));
             linkedRemapDropDown.SelectedValue(winrt::box_value(std::to_wstring(detectedKey)));
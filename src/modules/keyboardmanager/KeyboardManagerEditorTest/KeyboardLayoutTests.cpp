@@ -0,0 +1,88 @@
+#include "pch.h"
+
+// Suppressing 26466 - Don't use static_cast downcasts - in CppUnitTest.h
+#pragma warning(push)
+#pragma warning(disable : 26466)
+#include "CppUnitTest.h"
+#pragma warning(pop)
+
+#include <common/interop/keyboard_layout.h>
+#include <common/interop/shared_constants.h>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace KeyboardLayoutTests
+{
+    // Tests for the LayoutMap key name tables
+    TEST_CLASS (KeyboardLayoutTests)
+    {
+        LayoutMap keyboardLayout;
+
+    public:
+        // Test if the names in the precomputed key name list match the single key lookups
+        TEST_METHOD (GetKeyNameList_ShouldMatchGetKeyName_ForAllKeysInTheList)
+        {
+            // Act
+            const auto& keyNames = keyboardLayout.GetKeyNameList();
+            const auto& keyCodes = keyboardLayout.GetKeyCodeList();
+
+            // Assert
+            Assert::AreEqual(keyCodes.size(), keyNames.size());
+            for (size_t i = 0; i < keyNames.size(); i++)
+            {
+                Assert::AreEqual(keyCodes[i], keyNames[i].first);
+                Assert::AreEqual(keyboardLayout.GetKeyName(keyNames[i].first), keyNames[i].second);
+            }
+        }
+
+        // Test if the shortcut lists have a "None" key at the start followed by the regular list
+        TEST_METHOD (GetKeyNameList_ShouldStartWithNone_WhenListIsForShortcut)
+        {
+            // Act
+            const auto& keyNames = keyboardLayout.GetKeyNameList();
+            const auto& shortcutKeyNames = keyboardLayout.GetKeyNameList(true);
+            const auto& shortcutKeyCodes = keyboardLayout.GetKeyCodeList(true);
+
+            // Assert
+            Assert::AreEqual(keyNames.size() + 1, shortcutKeyNames.size());
+            Assert::AreEqual(shortcutKeyNames.size(), shortcutKeyCodes.size());
+            Assert::AreEqual((DWORD)0, shortcutKeyCodes[0]);
+            Assert::AreEqual(std::wstring(L"None"), shortcutKeyNames[0].second);
+            Assert::IsTrue(std::equal(keyNames.begin(), keyNames.end(), shortcutKeyNames.begin() + 1));
+        }
+
+        // Test if special, fake and numpad-origin keys are resolved to their names
+        TEST_METHOD (GetKeyName_ShouldReturnSpecialNames_ForSpecialFakeAndNumpadKeys)
+        {
+            // Assert
+            Assert::AreEqual(std::wstring(L"Enter"), keyboardLayout.GetKeyName(VK_RETURN));
+            Assert::AreEqual(std::wstring(L"Enter (Numpad)"), keyboardLayout.GetKeyName(VK_RETURN | (1ull << 31)));
+            Assert::AreEqual(std::wstring(L"Win"), keyboardLayout.GetKeyName(CommonSharedConstants::VK_WIN_BOTH));
+            Assert::AreEqual(std::wstring(L"Disable"), keyboardLayout.GetKeyName(CommonSharedConstants::VK_DISABLED));
+        }
+
+        // Test if keys which are not in the table are reported as undefined
+        TEST_METHOD (GetKeyName_ShouldReturnUndefined_ForKeysOutsideTheTable)
+        {
+            // Assert
+            Assert::AreEqual(std::wstring(L"Undefined"), keyboardLayout.GetKeyName(0));
+            Assert::AreEqual(std::wstring(L"Undefined"), keyboardLayout.GetKeyName(0x1000));
+            Assert::AreEqual(std::wstring(L"Undefined"), keyboardLayout.GetKeyName(VK_F1 | (1ull << 31)));
+            Assert::AreEqual(std::wstring(L"Undefined"), keyboardLayout.GetKeyName(0x125));
+            Assert::AreEqual(std::wstring(L"Undefined"), keyboardLayout.GetKeyName(CommonSharedConstants::VK_DISABLED + 0x100));
+        }
+
+        // Test if views returned for the same layout point into the same table
+        TEST_METHOD (GetKeyNameView_ShouldReturnStableViews_WhenLayoutDoesNotChange)
+        {
+            // Act
+            auto first = keyboardLayout.GetKeyNameView(VK_SPACE);
+            keyboardLayout.UpdateLayout();
+            auto second = keyboardLayout.GetKeyNameView(VK_SPACE);
+
+            // Assert
+            Assert::IsTrue(first.data() == second.data());
+            Assert::IsTrue(first == L"Space");
+        }
+    };
+}
@@ -0,0 +1,42 @@
+#include "pch.h"
+#include "PlainTextClipboard.h"
+
+namespace PlainText
+{
+    bool ReplaceWithPlainText(Clipboard& clipboard, const NormalizeOptions& options)
+    {
+        if (!clipboard.Open())
+        {
+            return false;
+        }
+
+        std::wstring_view text;
+        if (!clipboard.LockText(text))
+        {
+            clipboard.Close();
+            return false;
+        }
+
+        wchar_t* output = clipboard.AllocateText(MaxTransformedLength(text, options));
+        if (!output)
+        {
+            clipboard.UnlockText();
+            clipboard.Close();
+            return false;
+        }
+
+        // The only copy of the text, straight from the clipboard data into the new one
+        const size_t length = Transform(text, options, output);
+        clipboard.UnlockText();
+
+        if (!clipboard.SetText(length))
+        {
+            clipboard.FreeText();
+            clipboard.Close();
+            return false;
+        }
+
+        clipboard.Close();
+        return true;
+    }
+}
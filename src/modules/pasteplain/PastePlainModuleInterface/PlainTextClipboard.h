@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "PlainTextTransform.h"
+
+namespace PlainText
+{
+    struct Failure
+    {
+        // Where it failed, like L"read.OpenClipboard"
+        const wchar_t* step = nullptr;
+        uint32_t error = 0;
+    };
+
+    // The clipboard operations needed to replace the text on the clipboard with its plain version, in this order:
+    // Open, LockText, AllocateText, UnlockText, SetText or FreeText, Close.
+    class Clipboard
+    {
+    public:
+        virtual ~Clipboard() = default;
+
+        virtual bool Open() = 0;
+        virtual void Close() = 0;
+
+        // The Unicode text on the clipboard, in place and valid until UnlockText
+        virtual bool LockText(std::wstring_view& text) = 0;
+        virtual void UnlockText() = 0;
+
+        // A buffer for the new text, of capacity characters and a null terminator
+        virtual wchar_t* AllocateText(size_t capacity) = 0;
+        // Replaces the clipboard contents with the first length characters of the buffer, kept out of the clipboard
+        // history and roaming. The clipboard owns the buffer on success.
+        virtual bool SetText(size_t length) = 0;
+        // Drops the buffer after SetText failed
+        virtual void FreeText() = 0;
+
+        // The reason the last operation returning false failed
+        virtual Failure LastFailure() const = 0;
+    };
+
+    // Replaces the text on the clipboard with a copy made while it's open and the source locked, transformed on the
+    // way. Returns false on failure, the reason being the LastFailure of the clipboard.
+    bool ReplaceWithPlainText(Clipboard& clipboard, const NormalizeOptions& options);
+}
@@ -0,0 +1,94 @@
+#include "pch.h"
+#include "PlainTextTransform.h"
+
+#include <cstring>
+
+namespace
+{
+    // Everything the options may act on, checked first so that most characters take a single comparison
+    bool MayNeedWork(const wchar_t c) noexcept
+    {
+        return c <= L' ' || c == 0x00A0 || (c >= 0x2000 && c <= 0x2060) || c == 0x3000 || c == 0xFEFF;
+    }
+
+    bool IsTrailingWhitespace(const wchar_t c) noexcept
+    {
+        return c == L' ' || c == L'\t' || c == L'\v' || c == L'\f' || c == 0x00A0 || (c >= 0x2000 && c <= 0x200A) || c == 0x202F || c == 0x205F || c == 0x3000;
+    }
+
+    bool IsZeroWidth(const wchar_t c) noexcept
+    {
+        return c == 0x200B || c == 0x200C || c == 0x200D || c == 0x2060 || c == 0xFEFF;
+    }
+}
+
+namespace PlainText
+{
+    size_t MaxTransformedLength(const std::wstring_view text, const NormalizeOptions& options) noexcept
+    {
+        // Every lone CR or LF can grow into a CRLF
+        return options.normalizeLineEndings ? text.size() * 2 : text.size();
+    }
+
+    size_t Transform(const std::wstring_view text, const NormalizeOptions& options, wchar_t* output) noexcept
+    {
+        if (!options.Any())
+        {
+            std::memcpy(output, text.data(), text.size() * sizeof(wchar_t));
+            output[text.size()] = L'\0';
+            return text.size();
+        }
+
+        wchar_t* out = output;
+        // The end of the current line without its trailing whitespace, where the output goes back to when trimming
+        wchar_t* lineEnd = output;
+        const size_t size = text.size();
+        for (size_t i = 0; i < size; ++i)
+        {
+            const wchar_t c = text[i];
+            if (!MayNeedWork(c))
+            {
+                *out++ = c;
+                lineEnd = out;
+                continue;
+            }
+
+            if (c == L'\r' || c == L'\n')
+            {
+                if (options.trimTrailingWhitespace)
+                {
+                    out = lineEnd;
+                }
+                if (options.normalizeLineEndings)
+                {
+                    if (c == L'\r' && i + 1 < size && text[i + 1] == L'\n')
+                    {
+                        ++i;
+                    }
+                    *out++ = L'\r';
+                    *out++ = L'\n';
+                }
+                else
+                {
+                    *out++ = c;
+                }
+                lineEnd = out;
+            }
+            else if (!options.stripZeroWidthCharacters || !IsZeroWidth(c))
+            {
+                *out++ = c;
+                if (!IsTrailingWhitespace(c))
+                {
+                    lineEnd = out;
+                }
+            }
+        }
+
+        if (options.trimTrailingWhitespace)
+        {
+            out = lineEnd;
+        }
+        *out = L'\0';
+        return static_cast<size_t>(out - output);
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace PlainText
+{
+    // Optional clean-ups applied while the text is copied. None of them by default, the text is then pasted as is.
+    struct NormalizeOptions
+    {
+        // Spaces and tabs at the end of every line
+        bool trimTrailingWhitespace = false;
+        // Lone CR and LF become CRLF
+        bool normalizeLineEndings = false;
+        // Zero width spaces, joiners and non-joiners, word joiners and byte order marks
+        bool stripZeroWidthCharacters = false;
+
+        bool Any() const noexcept
+        {
+            return trimTrailingWhitespace || normalizeLineEndings || stripZeroWidthCharacters;
+        }
+    };
+
+    // The most characters Transform can write for the text, not counting the null terminator
+    size_t MaxTransformedLength(std::wstring_view text, const NormalizeOptions& options) noexcept;
+
+    // Copies the text to output in a single pass, applying the options on the way, and null terminates it. output
+    // holds at least MaxTransformedLength + 1 characters. Returns the number of characters written, without the null
+    // terminator.
+    size_t Transform(std::wstring_view text, const NormalizeOptions& options, wchar_t* output) noexcept;
+}
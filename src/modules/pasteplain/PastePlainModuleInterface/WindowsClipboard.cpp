@@ -0,0 +1,115 @@
+#include "pch.h"
+#include "WindowsClipboard.h"
+
+bool WindowsClipboard::Fail(const wchar_t* step)
+{
+    _failure = { step, GetLastError() };
+    return false;
+}
+
+bool WindowsClipboard::Open()
+{
+    // Get the format identifier for not adding the data to the clipboard history or roaming.
+    // https://learn.microsoft.com/windows/win32/dataxchg/clipboard-formats#cloud-clipboard-and-clipboard-history-formats
+    if (0 == (_excludeFromHistoryFormat = RegisterClipboardFormat(L"ExcludeClipboardContentFromMonitorProcessing")))
+    {
+        return Fail(L"write.RegisterClipboardFormat");
+    }
+
+    if (!OpenClipboard(NULL))
+    {
+        return Fail(L"read.OpenClipboard");
+    }
+    return true;
+}
+
+void WindowsClipboard::Close()
+{
+    CloseClipboard();
+}
+
+bool WindowsClipboard::LockText(std::wstring_view& text)
+{
+    _source = GetClipboardData(CF_UNICODETEXT);
+    if (_source == NULL)
+    {
+        return Fail(L"read.GetClipboardData");
+    }
+
+    const wchar_t* data = static_cast<const wchar_t*>(GlobalLock(_source));
+    if (NULL == data)
+    {
+        _source = nullptr;
+        return Fail(L"read.GlobalLock");
+    }
+
+    // The text ends at its null terminator, not necessarily at the end of the block
+    text = { data, wcsnlen(data, GlobalSize(_source) / sizeof(wchar_t)) };
+    return true;
+}
+
+void WindowsClipboard::UnlockText()
+{
+    if (_source)
+    {
+        GlobalUnlock(_source);
+        _source = nullptr;
+    }
+}
+
+wchar_t* WindowsClipboard::AllocateText(const size_t capacity)
+{
+    if (NULL == (_destination = GlobalAlloc(GMEM_MOVEABLE, (capacity + 1) * sizeof(wchar_t))))
+    {
+        Fail(L"write.GlobalAlloc");
+        return nullptr;
+    }
+
+    wchar_t* data = static_cast<wchar_t*>(GlobalLock(_destination));
+    if (NULL == data)
+    {
+        Fail(L"write.GlobalLock");
+        GlobalFree(_destination);
+        _destination = nullptr;
+        return nullptr;
+    }
+
+    _capacity = capacity;
+    return data;
+}
+
+bool WindowsClipboard::SetText(const size_t length)
+{
+    GlobalUnlock(_destination);
+
+    // The normalizations can leave most of the block unused, lone line breaks only being a worst case
+    if (length < _capacity)
+    {
+        if (HGLOBAL shrunk = GlobalReAlloc(_destination, (length + 1) * sizeof(wchar_t), 0))
+        {
+            _destination = shrunk;
+        }
+    }
+
+    EmptyClipboard();
+
+    if (NULL == SetClipboardData(CF_UNICODETEXT, _destination))
+    {
+        return Fail(L"write.SetClipboardData");
+    }
+    // Owned by the system from now on
+    _destination = nullptr;
+
+    // Don't show in history or allow data roaming.
+    SetClipboardData(_excludeFromHistoryFormat, 0);
+    return true;
+}
+
+void WindowsClipboard::FreeText()
+{
+    if (_destination)
+    {
+        GlobalFree(_destination);
+        _destination = nullptr;
+    }
+}
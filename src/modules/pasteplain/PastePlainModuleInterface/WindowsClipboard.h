@@ -0,0 +1,36 @@
+#pragma once
+
+#include "PlainTextClipboard.h"
+
+// The clipboard of the desktop, through the Win32 clipboard API
+class WindowsClipboard : public PlainText::Clipboard
+{
+public:
+    WindowsClipboard() = default;
+    WindowsClipboard(const WindowsClipboard&) = delete;
+    WindowsClipboard& operator=(const WindowsClipboard&) = delete;
+
+    bool Open() override;
+    void Close() override;
+
+    bool LockText(std::wstring_view& text) override;
+    void UnlockText() override;
+
+    wchar_t* AllocateText(size_t capacity) override;
+    bool SetText(size_t length) override;
+    void FreeText() override;
+
+    PlainText::Failure LastFailure() const override
+    {
+        return _failure;
+    }
+
+private:
+    bool Fail(const wchar_t* step);
+
+    UINT _excludeFromHistoryFormat = 0;
+    HANDLE _source = nullptr;
+    HGLOBAL _destination = nullptr;
+    size_t _capacity = 0;
+    PlainText::Failure _failure;
+};
@@ -9,6 +9,8 @@
 #include <common/utils/resources.h>
 
 #include "PastePlainConstants.h"
+#include "PlainTextClipboard.h"
+#include "WindowsClipboard.h"
 #include <common/interop/shared_constants.h>
 #include <common/utils/logger_helper.h>
 #include <common/utils/winapi_error.h>
@@ -43,10 +45,14 @@ namespace
     const wchar_t JSON_KEY_SHIFT[] = L"shift";
     const wchar_t JSON_KEY_CODE[] = L"code";
     const wchar_t JSON_KEY_ACTIVATION_SHORTCUT[] = L"ActivationShortcut";
+    const wchar_t JSON_KEY_TRIM_TRAILING_WHITESPACE[] = L"TrimTrailingWhitespace";
+    const wchar_t JSON_KEY_NORMALIZE_LINE_ENDINGS[] = L"NormalizeLineEndings";
+    const wchar_t JSON_KEY_STRIP_ZERO_WIDTH_CHARACTERS[] = L"StripZeroWidthCharacters";
 }
 
 struct ModuleSettings
 {
+    PlainText::NormalizeOptions normalizeOptions;
 } g_settings;
 
 class PastePlain : public PowertoyModuleIface
@@ -104,6 +110,15 @@ private:
         }
     }
 
+    void parse_normalize_options(PowerToysSettings::PowerToyValues& settings)
+    {
+        PlainText::NormalizeOptions options;
+        options.trimTrailingWhitespace = settings.get_bool_value(JSON_KEY_TRIM_TRAILING_WHITESPACE).value_or(false);
+        options.normalizeLineEndings = settings.get_bool_value(JSON_KEY_NORMALIZE_LINE_ENDINGS).value_or(false);
+        options.stripZeroWidthCharacters = settings.get_bool_value(JSON_KEY_STRIP_ZERO_WIDTH_CHARACTERS).value_or(false);
+        g_settings.normalizeOptions = options;
+    }
+
     bool is_process_running()
     {
         return WaitForSingleObject(m_hProcess, 0) == WAIT_TIMEOUT;
@@ -144,6 +159,7 @@ private:
                 PowerToysSettings::PowerToyValues::load_from_settings_file(get_key());
 
             parse_hotkey(settings);
+            parse_normalize_options(settings);
         }
         catch (std::exception&)
         {
@@ -179,119 +195,18 @@ private:
 
     void try_to_paste_as_plain_text()
     {
-        std::wstring clipboard_text;
-
-        {
-            // Read clipboard data begin
-
-            if (!OpenClipboard(NULL))
-            {
-                DWORD errorCode = GetLastError();
-                auto errorMessage = get_last_error_message(errorCode);
-                Logger::error(L"Couldn't open the clipboard to get the text. {}", errorMessage.has_value() ? errorMessage.value() : L"");
-                Trace::PastePlainError(errorCode, errorMessage.has_value() ? errorMessage.value() : L"", L"read.OpenClipboard");
-                return;
-            }
-            HANDLE h_clipboard_data = GetClipboardData(CF_UNICODETEXT);
-
-            if (h_clipboard_data == NULL)
-            {
-                DWORD errorCode = GetLastError();
-                auto errorMessage = get_last_error_message(errorCode);
-                Logger::error(L"Failed to get clipboard data. {}", errorMessage.has_value() ? errorMessage.value() : L"");
-                Trace::PastePlainError(errorCode, errorMessage.has_value() ? errorMessage.value() : L"", L"read.GetClipboardData");
-                CloseClipboard();
-                return;
-            }
-
-            wchar_t* pch_data = static_cast<wchar_t*>(GlobalLock(h_clipboard_data));
-
-            if (NULL == pch_data)
-            {
-                DWORD errorCode = GetLastError();
-                auto errorMessage = get_last_error_message(errorCode);
-                Logger::error(L"Couldn't lock the buffer to get the unformatted text from the clipboard. {}", errorMessage.has_value() ? errorMessage.value() : L"");
-                Trace::PastePlainError(errorCode, errorMessage.has_value() ? errorMessage.value() : L"", L"read.GlobalLock");
-                CloseClipboard();
-                return;
-            }
-
-            clipboard_text = pch_data;
-            GlobalUnlock(h_clipboard_data);
-
-            CloseClipboard();
-            // Read clipboard data end
-        }
-
         {
-            // Copy text to clipboard begin
-            UINT no_clipboard_history_or_roaming_format = 0;
-
-            // Get the format identifier for not adding the data to the clipboard history or roaming.
-            // https://learn.microsoft.com/windows/win32/dataxchg/clipboard-formats#cloud-clipboard-and-clipboard-history-formats
-            if (0 == (no_clipboard_history_or_roaming_format = RegisterClipboardFormat(L"ExcludeClipboardContentFromMonitorProcessing")))
-            {
-                DWORD errorCode = GetLastError();
-                auto errorMessage = get_last_error_message(errorCode);
-                Logger::error(L"Couldn't get the clipboard data format type that would allow excluding the data from the clipboard history / roaming. {}", errorMessage.has_value() ? errorMessage.value() : L"");
-                Trace::PastePlainError(errorCode, errorMessage.has_value() ? errorMessage.value() : L"", L"write.RegisterClipboardFormat");
-                return;
-            }
-
-            if (!OpenClipboard(NULL))
-            {
-                DWORD errorCode = GetLastError();
-                auto errorMessage = get_last_error_message(errorCode);
-                Logger::error(L"Couldn't open the clipboard to copy the unformatted text. {}", errorMessage.has_value() ? errorMessage.value() : L"");
-                Trace::PastePlainError(errorCode, errorMessage.has_value() ? errorMessage.value() : L"", L"write.OpenClipboard");
-                return;
-            }
-
-            HGLOBAL h_clipboard_data;
-
-            if (NULL == (h_clipboard_data = GlobalAlloc(GMEM_MOVEABLE, (clipboard_text.length() + 1) * sizeof(wchar_t))))
-            {
-                DWORD errorCode = GetLastError();
-                auto errorMessage = get_last_error_message(errorCode);
-                Logger::error(L"Couldn't allocate a buffer for the unformatted text. {}", errorMessage.has_value() ? errorMessage.value() : L"");
-                Trace::PastePlainError(errorCode, errorMessage.has_value() ? errorMessage.value() : L"", L"write.GlobalAlloc");
-                CloseClipboard();
-                return;
-            }
-            wchar_t* pch_data = static_cast<wchar_t*>(GlobalLock(h_clipboard_data));
-
-            if (NULL == pch_data)
+            // Replace the clipboard text with its plain version begin
+            WindowsClipboard clipboard;
+            if (!PlainText::ReplaceWithPlainText(clipboard, g_settings.normalizeOptions))
             {
-                DWORD errorCode = GetLastError();
-                auto errorMessage = get_last_error_message(errorCode);
-                Logger::error(L"Couldn't lock the buffer to send the unformatted text to the clipboard. {}", errorMessage.has_value() ? errorMessage.value() : L"");
-                GlobalFree(h_clipboard_data);
-                CloseClipboard();
-                Trace::PastePlainError(errorCode, errorMessage.has_value() ? errorMessage.value() : L"", L"write.GlobalLock");
+                const auto failure = clipboard.LastFailure();
+                auto errorMessage = get_last_error_message(failure.error);
+                Logger::error(L"Couldn't replace the clipboard text with the unformatted text ({}). {}", failure.step, errorMessage.has_value() ? errorMessage.value() : L"");
+                Trace::PastePlainError(failure.error, errorMessage.has_value() ? errorMessage.value() : L"", failure.step);
                 return;
             }
-
-            wcscpy_s(pch_data, clipboard_text.length() + 1, clipboard_text.c_str());
-
-            EmptyClipboard();
-
-            if (NULL == SetClipboardData(CF_UNICODETEXT, h_clipboard_data))
-            {
-                DWORD errorCode = GetLastError();
-                auto errorMessage = get_last_error_message(errorCode);
-                Logger::error(L"Couldn't set the clipboard data to the unformatted text. {}", errorMessage.has_value() ? errorMessage.value() : L"");
-                GlobalUnlock(h_clipboard_data);
-                GlobalFree(h_clipboard_data);
-                CloseClipboard();
-                Trace::PastePlainError(errorCode, errorMessage.has_value() ? errorMessage.value() : L"", L"write.SetClipboardData");
-                return;
-            }
-
-            // Don't show in history or allow data roaming.
-            SetClipboardData(no_clipboard_history_or_roaming_format, 0);
-
-            CloseClipboard();
-            // Copy text to clipboard end
+            // Replace the clipboard text with its plain version end
         }
         {
             // Clear kb state and send Ctrl+V begin
@@ -438,6 +353,7 @@ public:
                 PowerToysSettings::PowerToyValues::from_json_string(config, get_key());
 
             parse_hotkey(values);
+            parse_normalize_options(values);
             // If you don't need to do any custom processing of the settings, proceed
             // to persists the values calling:
             values.save_to_settings_file();
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <PlainTextClipboard.h>
+
+#include <string>
+#include <vector>
+
+// A clipboard in memory, which can be made to fail at any step. Counts the calls to check that the clipboard is
+// always closed and the buffers released.
+class FakeClipboard : public PlainText::Clipboard
+{
+public:
+    explicit FakeClipboard(std::wstring text) :
+        text{ std::move(text) }
+    {
+    }
+
+    bool Open() override
+    {
+        ++opened;
+        return Step(L"read.OpenClipboard") && (isOpen = true);
+    }
+
+    void Close() override
+    {
+        isOpen = false;
+    }
+
+    bool LockText(std::wstring_view& view) override
+    {
+        if (!Step(L"read.GetClipboardData"))
+        {
+            return false;
+        }
+        isLocked = true;
+        view = text;
+        return true;
+    }
+
+    void UnlockText() override
+    {
+        isLocked = false;
+    }
+
+    wchar_t* AllocateText(const size_t capacity) override
+    {
+        if (!Step(L"write.GlobalAlloc"))
+        {
+            return nullptr;
+        }
+        buffer.assign(capacity + 1, L'\xFFFF');
+        isAllocated = true;
+        return buffer.data();
+    }
+
+    bool SetText(const size_t length) override
+    {
+        if (!Step(L"write.SetClipboardData"))
+        {
+            return false;
+        }
+        Assert(buffer[length] == L'\0');
+        text.assign(buffer.data(), length);
+        isAllocated = false;
+        excludedFromHistory = true;
+        return true;
+    }
+
+    void FreeText() override
+    {
+        buffer.clear();
+        isAllocated = false;
+    }
+
+    PlainText::Failure LastFailure() const override
+    {
+        return { failAt.c_str(), 5 };
+    }
+
+    std::wstring text;
+    // The step to fail at, if any
+    std::wstring failAt;
+
+    int opened = 0;
+    bool isOpen = false;
+    bool isLocked = false;
+    bool isAllocated = false;
+    bool excludedFromHistory = false;
+    std::vector<wchar_t> buffer;
+
+private:
+    bool Step(const std::wstring_view step) const
+    {
+        Assert(step == L"read.OpenClipboard" || isOpen);
+        return step != failAt;
+    }
+
+    static void Assert(const bool condition)
+    {
+        Microsoft::VisualStudio::CppUnitTestFramework::Assert::IsTrue(condition);
+    }
+};
@@ -0,0 +1,213 @@
+#include "pch.h"
+
+#include "FakeClipboard.h"
+
+#include <PlainTextTransform.h>
+
+#include <chrono>
+#include <format>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using PlainText::NormalizeOptions;
+
+namespace PastePlainUnitTests
+{
+    namespace
+    {
+        const NormalizeOptions AllOptions{ true, true, true };
+
+        std::wstring Transform(const std::wstring& text, const NormalizeOptions& options)
+        {
+            std::vector<wchar_t> output(PlainText::MaxTransformedLength(text, options) + 1);
+            const size_t length = PlainText::Transform(text, options, output.data());
+            Assert::AreEqual(L'\0', output[length]);
+            return { output.data(), length };
+        }
+
+        // The same normalizations, a line and an option at a time
+        std::wstring Reference(const std::wstring& text, const NormalizeOptions& options)
+        {
+            const std::wstring whitespace = L" \t\v\f\u00A0\u2000\u2001\u2002\u2003\u2004\u2005\u2006\u2007\u2008\u2009\u200A\u202F\u205F\u3000";
+            const std::wstring zeroWidth = L"\u200B\u200C\u200D\u2060\uFEFF";
+
+            std::wstring result;
+            size_t start = 0;
+            while (start <= text.size())
+            {
+                const size_t end = (std::min)(text.find_first_of(L"\r\n", start), text.size());
+                std::wstring line = text.substr(start, end - start);
+                if (options.stripZeroWidthCharacters)
+                {
+                    std::erase_if(line, [&](const wchar_t c) { return zeroWidth.find(c) != std::wstring::npos; });
+                }
+                if (options.trimTrailingWhitespace)
+                {
+                    const size_t last = line.find_last_not_of(whitespace);
+                    line.erase(last == std::wstring::npos ? 0 : last + 1);
+                }
+                result += line;
+                if (end == text.size())
+                {
+                    break;
+                }
+
+                size_t next = end + 1;
+                if (!options.normalizeLineEndings)
+                {
+                    result += text[end];
+                }
+                else
+                {
+                    result += L"\r\n";
+                    if (text[end] == L'\r' && next < text.size() && text[next] == L'\n')
+                    {
+                        ++next;
+                    }
+                }
+                start = next;
+            }
+            return result;
+        }
+
+        std::wstring RandomText(const size_t length, const uint32_t seed)
+        {
+            const wchar_t alphabet[] = L"ab \t\r\n\u00A0\u200B\u200D\u2014\u3000\uFEFF\u00E9x";
+            std::mt19937 rng{ seed };
+            std::wstring text(length, L'\0');
+            for (auto& c : text)
+            {
+                c = alphabet[rng() % (std::size(alphabet) - 1)];
+            }
+            return text;
+        }
+
+        // About 100 MB of log lines: mostly ASCII, LF line endings, some trailing spaces and zero width characters
+        std::wstring LogText()
+        {
+            const std::vector<std::wstring> lines = {
+                L"2024-05-01 12:00:00.000 [INFO] Request handled in 12 ms, status 200, path /api/v1/items?page=2\n",
+                L"2024-05-01 12:00:00.010 [WARN] Retrying connection to db-01.contoso.local:5432 (attempt 2 of 5)   \n",
+                L"Name\tQuantity\tPrice\u200B\tTotal\t\n",
+                L"\uFEFF2024-05-01 12:00:00.020 [INFO] Caf\u00E9 order #4711 \u2014 3 \u00D7 espresso\r\n",
+            };
+            std::wstring text;
+            text.reserve(50 * 1024 * 1024 + 128);
+            for (size_t i = 0; text.size() < 50 * 1024 * 1024; ++i)
+            {
+                text += lines[i % lines.size()];
+            }
+            return text;
+        }
+    }
+
+    TEST_CLASS (PlainTextTransformTests)
+    {
+    public:
+        TEST_METHOD (Transform_NoOptionsCopiesAsIs)
+        {
+            const std::wstring text = L"line 1  \r\nline\u200B 2\r\n\n";
+            Assert::AreEqual(text, Transform(text, {}));
+            Assert::AreEqual(std::wstring{}, Transform(L"", AllOptions));
+        }
+
+        TEST_METHOD (Transform_TrimsTrailingWhitespace)
+        {
+            const NormalizeOptions options{ .trimTrailingWhitespace = true };
+            Assert::AreEqual(std::wstring{ L"a\r\n b\n\r\nc" }, Transform(L"a \t\r\n b\u00A0\u3000\n  \r\nc  ", options));
+            Assert::AreEqual(std::wstring{ L"a b" }, Transform(L"a b", options));
+        }
+
+        TEST_METHOD (Transform_NormalizesLineEndings)
+        {
+            const NormalizeOptions options{ .normalizeLineEndings = true };
+            Assert::AreEqual(std::wstring{ L"a\r\nb\r\nc\r\n\r\n\r\nd\r\n" }, Transform(L"a\nb\rc\r\n\n\rd\n", options));
+            Assert::AreEqual(std::wstring{ L"\r\n\r\n\r\n" }, Transform(L"\n\n\n", options));
+        }
+
+        TEST_METHOD (Transform_StripsZeroWidthCharacters)
+        {
+            const NormalizeOptions options{ .stripZeroWidthCharacters = true };
+            Assert::AreEqual(std::wstring{ L"word joiner\u2014 here " }, Transform(L"\uFEFFword\u200B \u200Cjoiner\u2060\u2014 here\u200D ", options));
+        }
+
+        TEST_METHOD (Transform_MatchesLineByLineReference)
+        {
+            for (uint32_t seed = 0; seed < 200; ++seed)
+            {
+                const auto text = RandomText(seed * 7, seed);
+                for (int i = 0; i < 8; ++i)
+                {
+                    const NormalizeOptions options{ (i & 1) != 0, (i & 2) != 0, (i & 4) != 0 };
+                    Assert::AreEqual(Reference(text, options), Transform(text, options));
+                }
+            }
+        }
+
+        TEST_METHOD (Clipboard_ReplacesTextInPlace)
+        {
+            FakeClipboard clipboard{ L"\uFEFFtrailing  \nline\r" };
+            Assert::IsTrue(PlainText::ReplaceWithPlainText(clipboard, AllOptions));
+            Assert::AreEqual(std::wstring{ L"trailing\r\nline\r\n" }, clipboard.text);
+            Assert::AreEqual(1, clipboard.opened);
+            Assert::IsFalse(clipboard.isOpen || clipboard.isLocked || clipboard.isAllocated);
+            Assert::IsTrue(clipboard.excludedFromHistory);
+        }
+
+        TEST_METHOD (Clipboard_FailuresLeaveNothingBehind)
+        {
+            for (const std::wstring step : { L"read.OpenClipboard", L"read.GetClipboardData", L"write.GlobalAlloc", L"write.SetClipboardData" })
+            {
+                FakeClipboard clipboard{ L"text  " };
+                clipboard.failAt = step;
+                Assert::IsFalse(PlainText::ReplaceWithPlainText(clipboard, AllOptions));
+                Assert::AreEqual(step, std::wstring{ clipboard.LastFailure().step });
+                Assert::AreEqual(std::wstring{ L"text  " }, clipboard.text);
+                Assert::IsFalse(clipboard.isOpen || clipboard.isLocked || clipboard.isAllocated);
+                Assert::IsFalse(clipboard.excludedFromHistory);
+            }
+        }
+
+        // 100 MB of text: copied into a string and then into the clipboard buffer as before, and transformed straight
+        // into the clipboard buffer without and with every option
+        BEGIN_TEST_METHOD_ATTRIBUTE(Benchmark_Throughput100MB)
+            TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD (Benchmark_Throughput100MB)
+        {
+            using clock = std::chrono::steady_clock;
+            const auto text = LogText();
+            const double megabytes = text.size() * sizeof(wchar_t) / (1024.0 * 1024.0);
+            auto report = [&](const wchar_t* name, const clock::duration duration) {
+                const double seconds = std::chrono::duration<double>(duration).count();
+                Logger::WriteMessage(std::format(L"{}: {:.1f} ms, {:.0f} MB/s\n", name, seconds * 1000, megabytes / seconds).c_str());
+            };
+
+            {
+                const auto start = clock::now();
+                const std::wstring copy = text.c_str();
+                std::vector<wchar_t> output(copy.size() + 1);
+                std::copy(copy.c_str(), copy.c_str() + copy.size() + 1, output.data());
+                report(L"Two copies", clock::now() - start);
+                Assert::AreEqual(L'\0', output.back());
+            }
+
+            std::vector<wchar_t> output(PlainText::MaxTransformedLength(text, AllOptions) + 1);
+            {
+                const auto start = clock::now();
+                const size_t length = PlainText::Transform(text, {}, output.data());
+                report(L"Single copy", clock::now() - start);
+                Assert::AreEqual(text.size(), length);
+            }
+            {
+                const auto start = clock::now();
+                const size_t length = PlainText::Transform(text, AllOptions, output.data());
+                report(L"Single pass with every option", clock::now() - start);
+                Assert::IsTrue(std::wstring_view(output.data(), length) == Reference(text, AllOptions));
+            }
+        }
+    };
+}
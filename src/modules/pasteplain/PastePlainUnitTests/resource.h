@@ -0,0 +1,13 @@
+//{{NO_DEPENDENCIES}}
+// Microsoft Visual C++ generated include file.
+// Used by PastePlainUnitTests.rc
+
+//////////////////////////////
+// Non-localizable
+
+#define FILE_DESCRIPTION "PowerToys PastePlainUnitTests"
+#define INTERNAL_NAME "PastePlainUnitTests"
+#define ORIGINAL_FILENAME "PastePlainUnitTests.dll"
+
+// Non-localizable
+//////////////////////////////
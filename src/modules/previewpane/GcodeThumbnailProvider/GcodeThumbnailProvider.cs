@@ -18,6 +18,11 @@ namespace Microsoft.PowerToys.ThumbnailHandler.Gcode
             Stream = new FileStream(filePath, FileMode.Open, FileAccess.Read);
         }
 
+        public GcodeThumbnailProvider(Stream stream)
+        {
+            Stream = stream;
+        }
+
         /// <summary>
         /// Gets the file path to the file creating thumbnail for.
         /// </summary>
@@ -18,6 +18,11 @@ namespace Microsoft.PowerToys.ThumbnailHandler.Qoi
             Stream = new FileStream(filePath, FileMode.Open, FileAccess.Read);
         }
 
+        public QoiThumbnailProvider(Stream stream)
+        {
+            Stream = stream;
+        }
+
         /// <summary>
         /// Gets the file path to the file creating thumbnail for.
         /// </summary>
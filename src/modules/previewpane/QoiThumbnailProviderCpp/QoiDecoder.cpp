@@ -0,0 +1,333 @@
+#include "pch.h"
+
+#include "QoiDecoder.h"
+
+#include <algorithm>
+#include <limits>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define QOI_DECODER_SSE2
+#endif
+
+namespace
+{
+    constexpr uint8_t OpIndex = 0x00;
+    constexpr uint8_t OpDiff = 0x40;
+    constexpr uint8_t OpLuma = 0x80;
+    constexpr uint8_t OpRun = 0xc0;
+    constexpr uint8_t OpRgb = 0xfe;
+    constexpr uint8_t OpRgba = 0xff;
+    constexpr uint8_t OpMask = 0xc0;
+
+    constexpr uint32_t Magic = 'q' << 24 | 'o' << 16 | 'i' << 8 | 'f';
+    constexpr uint64_t HeaderSize = 14;
+    // The most pixels a single byte encodes, with a run
+    constexpr uint64_t MaxRunLength = 62;
+
+    // Sums are divided with rounding, which must not overflow either
+    constexpr uint64_t MaxBoxPixels = std::numeric_limits<uint32_t>::max() / 256;
+
+    // Serves the bytes of the image out of chunks read from the stream
+    class ChunkReader
+    {
+    public:
+        explicit ChunkReader(const qoi::ReadFunction& read) :
+            _read{ read }, _buffer(qoi::ReadChunkSize)
+        {
+        }
+
+        // Past the end of the stream, bytes read as 0 and Failed tells so
+        inline uint8_t Next()
+        {
+            if (_next == _end && !Fill())
+            {
+                return 0;
+            }
+            return *_next++;
+        }
+
+        uint32_t Next32()
+        {
+            uint32_t value = static_cast<uint32_t>(Next()) << 24;
+            value |= Next() << 16;
+            value |= Next() << 8;
+            return value | Next();
+        }
+
+        bool Failed() const noexcept
+        {
+            return _failed;
+        }
+
+    private:
+        bool Fill()
+        {
+            const size_t read = _failed ? 0 : _read(_buffer.data(), _buffer.size());
+            if (read == 0 || read > _buffer.size())
+            {
+                _failed = true;
+                return false;
+            }
+            _next = _buffer.data();
+            _end = _next + read;
+            return true;
+        }
+
+        const qoi::ReadFunction& _read;
+        std::vector<uint8_t> _buffer;
+        const uint8_t* _next = nullptr;
+        const uint8_t* _end = nullptr;
+        bool _failed = false;
+    };
+
+    // Pixels are kept as RGBA bytes in memory order
+    inline uint32_t Pack(const uint8_t r, const uint8_t g, const uint8_t b, const uint8_t a) noexcept
+    {
+        return r | g << 8 | b << 16 | static_cast<uint32_t>(a) << 24;
+    }
+
+    inline uint32_t Hash(const uint8_t r, const uint8_t g, const uint8_t b, const uint8_t a) noexcept
+    {
+        return (r * 3 + g * 5 + b * 7 + a * 11) % 64;
+    }
+
+    // c * a / 255, rounded to the nearest
+    inline uint32_t Premultiply(const uint32_t c, const uint32_t a) noexcept
+    {
+        const uint32_t t = c * a + 128;
+        return (t + (t >> 8)) >> 8;
+    }
+
+    // Adds the premultiplied BGRA channels of the row pixels to the sums of the thumbnail columns they belong to.
+    // columns[x] is the thumbnail column of pixel x, increasing with x.
+    void AccumulateRow(const uint32_t* row, const uint32_t width, const uint32_t* columns, uint32_t* sums) noexcept
+    {
+        uint32_t x = 0;
+#ifdef QOI_DECODER_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i colorMask = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+        const __m128i alphaOne = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+        const __m128i half = _mm_set1_epi16(128);
+
+        // The sum of the current column stays in a register until the column changes
+        uint32_t column = columns[0];
+        __m128i sum = zero;
+        auto add = [&](const uint32_t pixelColumn, const __m128i pixel) {
+            if (pixelColumn != column)
+            {
+                auto target = reinterpret_cast<__m128i*>(sums + column * 4);
+                _mm_storeu_si128(target, _mm_add_epi32(_mm_loadu_si128(target), sum));
+                column = pixelColumn;
+                sum = zero;
+            }
+            sum = _mm_add_epi32(sum, pixel);
+        };
+
+        // Two pixels per 16-bit half: RGBA -> premultiplied BGRA
+        auto premultiply = [&](const __m128i pixels) {
+            __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+            alpha = _mm_or_si128(_mm_and_si128(alpha, colorMask), alphaOne);
+            __m128i t = _mm_add_epi16(_mm_mullo_epi16(pixels, alpha), half);
+            t = _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+            return _mm_shufflehi_epi16(_mm_shufflelo_epi16(t, _MM_SHUFFLE(3, 0, 1, 2)), _MM_SHUFFLE(3, 0, 1, 2));
+        };
+
+        for (; x + 4 <= width; x += 4)
+        {
+            const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x));
+            const __m128i low = premultiply(_mm_unpacklo_epi8(pixels, zero));
+            const __m128i high = premultiply(_mm_unpackhi_epi8(pixels, zero));
+            add(columns[x], _mm_unpacklo_epi16(low, zero));
+            add(columns[x + 1], _mm_unpackhi_epi16(low, zero));
+            add(columns[x + 2], _mm_unpacklo_epi16(high, zero));
+            add(columns[x + 3], _mm_unpackhi_epi16(high, zero));
+        }
+
+        auto last = reinterpret_cast<__m128i*>(sums + column * 4);
+        _mm_storeu_si128(last, _mm_add_epi32(_mm_loadu_si128(last), sum));
+#endif
+
+        for (; x < width; ++x)
+        {
+            const uint32_t pixel = row[x];
+            const uint32_t a = pixel >> 24;
+            uint32_t* target = sums + columns[x] * 4;
+            target[0] += Premultiply((pixel >> 16) & 0xff, a);
+            target[1] += Premultiply((pixel >> 8) & 0xff, a);
+            target[2] += Premultiply(pixel & 0xff, a);
+            target[3] += a;
+        }
+    }
+
+    // Averages the sums into a row of the thumbnail and clears them for the next one
+    void EmitRow(uint32_t* sums, const uint32_t* columnCounts, const uint32_t width, const uint32_t rowCount, uint32_t* output) noexcept
+    {
+        for (uint32_t x = 0; x < width; ++x, sums += 4)
+        {
+            const uint32_t count = columnCounts[x] * rowCount;
+            const uint32_t half = count / 2;
+            output[x] = (sums[0] + half) / count |
+                        (sums[1] + half) / count << 8 |
+                        (sums[2] + half) / count << 16 |
+                        (sums[3] + half) / count << 24;
+            sums[0] = sums[1] = sums[2] = sums[3] = 0;
+        }
+    }
+}
+
+namespace qoi
+{
+    void ThumbnailSize(const uint32_t width, const uint32_t height, const uint32_t cx, uint32_t& thumbnailWidth, uint32_t& thumbnailHeight) noexcept
+    {
+        const uint32_t longest = (std::max)(width, height);
+        if (longest <= cx)
+        {
+            thumbnailWidth = width;
+            thumbnailHeight = height;
+            return;
+        }
+        thumbnailWidth = (std::max)(1u, static_cast<uint32_t>(static_cast<uint64_t>(width) * cx / longest));
+        thumbnailHeight = (std::max)(1u, static_cast<uint32_t>(static_cast<uint64_t>(height) * cx / longest));
+    }
+
+    bool DecodeThumbnail(const ReadFunction& read, const uint64_t size, const uint32_t cx, Thumbnail& thumbnail)
+    {
+        ChunkReader reader{ read };
+
+        if (reader.Next32() != Magic)
+        {
+            return false;
+        }
+        Header header;
+        header.width = reader.Next32();
+        header.height = reader.Next32();
+        header.channels = reader.Next();
+        header.colorspace = reader.Next();
+        if (reader.Failed() || header.width == 0 || header.height == 0 || header.channels < 3 || header.channels > 4 ||
+            header.colorspace > 1 || header.height >= MaxPixels / header.width || cx == 0)
+        {
+            return false;
+        }
+
+        const uint32_t width = header.width;
+        const uint32_t height = header.height;
+        const uint64_t pixelCount = static_cast<uint64_t>(width) * height;
+        if (size < HeaderSize || (pixelCount + MaxRunLength - 1) / MaxRunLength > size - HeaderSize)
+        {
+            return false;
+        }
+
+        uint32_t thumbnailWidth;
+        uint32_t thumbnailHeight;
+        ThumbnailSize(width, height, cx, thumbnailWidth, thumbnailHeight);
+
+        // Image pixels are mapped to thumbnail pixels by scaling their coordinates down, so the widest column and the
+        // tallest row of a box round their share of the image up
+        const uint64_t maxColumnCount = (static_cast<uint64_t>(width) + thumbnailWidth - 1) / thumbnailWidth;
+        const uint64_t maxRowCount = (height + thumbnailHeight - 1) / thumbnailHeight;
+        if (maxColumnCount * maxRowCount > MaxBoxPixels)
+        {
+            return false;
+        }
+
+        std::vector<uint32_t> columns(width);
+        std::vector<uint32_t> columnCounts(thumbnailWidth);
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            columns[x] = static_cast<uint32_t>(static_cast<uint64_t>(x) * thumbnailWidth / width);
+            ++columnCounts[columns[x]];
+        }
+
+        thumbnail.width = thumbnailWidth;
+        thumbnail.height = thumbnailHeight;
+        thumbnail.pixels.assign(static_cast<size_t>(thumbnailWidth) * thumbnailHeight, 0);
+
+        std::vector<uint32_t> row(width);
+        std::vector<uint32_t> sums(static_cast<size_t>(thumbnailWidth) * 4);
+        uint32_t index[64]{};
+        uint8_t r = 0;
+        uint8_t g = 0;
+        uint8_t b = 0;
+        uint8_t a = 255;
+        uint32_t run = 0;
+        uint32_t thumbnailRow = 0;
+        uint32_t rowCount = 0;
+
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                if (run > 0)
+                {
+                    --run;
+                    row[x] = Pack(r, g, b, a);
+                    continue;
+                }
+
+                const uint8_t b1 = reader.Next();
+                if (b1 == OpRgb)
+                {
+                    r = reader.Next();
+                    g = reader.Next();
+                    b = reader.Next();
+                }
+                else if (b1 == OpRgba)
+                {
+                    r = reader.Next();
+                    g = reader.Next();
+                    b = reader.Next();
+                    a = reader.Next();
+                }
+                else if ((b1 & OpMask) == OpIndex)
+                {
+                    const uint32_t pixel = index[b1];
+                    r = static_cast<uint8_t>(pixel);
+                    g = static_cast<uint8_t>(pixel >> 8);
+                    b = static_cast<uint8_t>(pixel >> 16);
+                    a = static_cast<uint8_t>(pixel >> 24);
+                }
+                else if ((b1 & OpMask) == OpDiff)
+                {
+                    r = static_cast<uint8_t>(r + ((b1 >> 4) & 0x03) - 2);
+                    g = static_cast<uint8_t>(g + ((b1 >> 2) & 0x03) - 2);
+                    b = static_cast<uint8_t>(b + (b1 & 0x03) - 2);
+                }
+                else if ((b1 & OpMask) == OpLuma)
+                {
+                    const uint8_t b2 = reader.Next();
+                    const int vg = (b1 & 0x3f) - 32;
+                    r = static_cast<uint8_t>(r + vg - 8 + ((b2 >> 4) & 0x0f));
+                    g = static_cast<uint8_t>(g + vg);
+                    b = static_cast<uint8_t>(b + vg - 8 + (b2 & 0x0f));
+                }
+                else
+                {
+                    run = b1 & 0x3f;
+                }
+
+                const uint32_t pixel = Pack(r, g, b, a);
+                index[Hash(r, g, b, a)] = pixel;
+                row[x] = pixel;
+            }
+
+            if (reader.Failed())
+            {
+                return false;
+            }
+
+            AccumulateRow(row.data(), width, columns.data(), sums.data());
+            ++rowCount;
+            const bool rowDone = y + 1 == height ||
+                                 static_cast<uint64_t>(y + 1) * thumbnailHeight / height != thumbnailRow;
+            if (rowDone)
+            {
+                EmitRow(sums.data(), columnCounts.data(), thumbnailWidth, rowCount, thumbnail.pixels.data() + static_cast<size_t>(thumbnailRow) * thumbnailWidth);
+                ++thumbnailRow;
+                rowCount = 0;
+            }
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace qoi
+{
+    // Fills the buffer with up to size bytes of the image and returns how many were read, 0 at the end of the stream
+    // or on error
+    using ReadFunction = std::function<size_t(uint8_t* buffer, size_t size)>;
+
+    // The reader asks for input in chunks of this size, a few of them for a thumbnail sized image
+    constexpr size_t ReadChunkSize = 256 * 1024;
+
+    // Same limit as the managed decoder
+    constexpr uint64_t MaxPixels = 400000000;
+
+    struct Header
+    {
+        uint32_t width;
+        uint32_t height;
+        uint8_t channels;
+        uint8_t colorspace;
+    };
+
+    struct Thumbnail
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        // Top-down premultiplied BGRA, width * height pixels
+        std::vector<uint32_t> pixels;
+    };
+
+    // Size of the thumbnail of a width x height image fitting in cx x cx. Images are never upscaled.
+    void ThumbnailSize(uint32_t width, uint32_t height, uint32_t cx, uint32_t& thumbnailWidth, uint32_t& thumbnailHeight) noexcept;
+
+    // Decodes the image read from the stream in a single pass, without holding more than a row of it. Every thumbnail
+    // pixel is the average of the premultiplied image pixels mapping to it (a box filter). size is what's left in the
+    // stream: a header announcing more pixels than that many bytes can encode is rejected before anything is
+    // allocated. Returns false if the image is malformed, truncated, or too large to be averaged without overflowing.
+    bool DecodeThumbnail(const ReadFunction& read, uint64_t size, uint32_t cx, Thumbnail& thumbnail);
+}
@@ -1,25 +1,23 @@
 #include "pch.h"
 #include "QoiThumbnailProvider.h"
+#include "QoiDecoder.h"
 
 #include <filesystem>
-#include <fstream>
-#include <shellapi.h>
 #include <Shlwapi.h>
 #include <string>
 
-#include <wil/com.h>
-
-#include <common/utils/process_path.h>
 #include <common/interop/shared_constants.h>
 #include <common/logger/logger.h>
 #include <common/SettingsAPI/settings_helpers.h>
+#include <common/ThumbnailHost/ThumbnailHost.h>
+#include <common/utils/gpo.h>
 #include <common/utils/process_path.h>
 
 extern HINSTANCE g_hInst;
 extern long g_cDllRef;
 
 QoiThumbnailProvider::QoiThumbnailProvider() :
-    m_cRef(1), m_pStream(NULL), m_process(NULL)
+    m_cRef(1), m_pStream(NULL)
 {
     std::filesystem::path logFilePath(PTSettingsHelper::get_local_low_folder_location());
     logFilePath.append(LogSettings::qoiThumbLogPath);
@@ -92,101 +90,76 @@ IFACEMETHODIMP QoiThumbnailProvider::Initialize(IStream* pStream, DWORD grfMode)
 
 IFACEMETHODIMP QoiThumbnailProvider::GetThumbnail(UINT cx, HBITMAP* phbmp, WTS_ALPHATYPE* pdwAlpha)
 {
-    // Read stream into the buffer
-    char buffer[4096];
-    ULONG cbRead;
-
     Logger::trace(L"Begin");
 
-    GUID guid;
-    if (CoCreateGuid(&guid) == S_OK)
+    if (!m_pStream)
+    {
+        return E_UNEXPECTED;
+    }
+
+    if (powertoys_gpo::getConfiguredQoiThumbnailsEnabledValue() == powertoys_gpo::gpo_rule_configured_disabled)
     {
-        wil::unique_cotaskmem_string guidString;
-        if (SUCCEEDED(StringFromCLSID(guid, &guidString)))
+        // GPO is disabling this utility, don't serve cached thumbnails either.
+        m_pStream->Release();
+        m_pStream = NULL;
+        return E_FAIL;
+    }
+
+    // QOI decodes in a single pass, which is cheaper than handing the file over to the helper
+    LARGE_INTEGER start{};
+    ULARGE_INTEGER position{};
+    STATSTG stat{};
+    if (SUCCEEDED(m_pStream->Seek(start, STREAM_SEEK_CUR, &position)) && SUCCEEDED(m_pStream->Stat(&stat, STATFLAG_NONAME)) &&
+        stat.cbSize.QuadPart >= position.QuadPart)
+    {
+        qoi::Thumbnail thumbnail;
+        const auto read = [this](uint8_t* buffer, size_t size) -> size_t {
+            ULONG bytesRead = 0;
+            const HRESULT readResult = m_pStream->Read(buffer, static_cast<ULONG>(size), &bytesRead);
+            return FAILED(readResult) ? 0 : bytesRead;
+        };
+        bool decoded = false;
+        try
+        {
+            decoded = cx <= ThumbnailHost::MaxThumbnailSize && qoi::DecodeThumbnail(read, stat.cbSize.QuadPart - position.QuadPart, cx, thumbnail);
+        }
+        catch (const std::bad_alloc&)
         {
-            Logger::info(L"Read stream and save to tmp file.");
-
-            // {CLSID} -> CLSID
-            std::wstring guid = std::wstring(guidString.get()).substr(1, std::wstring(guidString.get()).size() - 2);
-            std::wstring filePath = PTSettingsHelper::get_local_low_folder_location() + L"\\QoiThumbnail-Temp\\";
-            if (!std::filesystem::exists(filePath))
-            {
-                std::filesystem::create_directories(filePath);
-            }
-
-            std::wstring fileName = filePath + guid + L".qoi";
-            
-            // Write data to tmp file
-            std::fstream file;
-            file.open(fileName, std::ios_base::out | std::ios_base::binary);
-
-            if (!file.is_open())
-            {
-                return 0;
-            }
-
-            while (true)
-            {
-                auto result = m_pStream->Read(buffer, 4096, &cbRead);
-
-                file.write(buffer, cbRead);
-                if (result == S_FALSE)
-                {               
-                    break;
-                }
-            }
-            file.close();
+            Logger::error(L"Out of memory decoding the QOI image");
+            m_pStream->Release();
+            m_pStream = NULL;
+            return E_OUTOFMEMORY;
+        }
 
+        if (decoded)
+        {
             m_pStream->Release();
             m_pStream = NULL;
 
-            try
-            {
-                Logger::info(L"Start QoiThumbnailProvider.exe");
-
-                STARTUPINFO info = { sizeof(info) };
-                std::wstring cmdLine{ L"\"" + fileName + L"\"" };
-                cmdLine += L" ";
-                cmdLine += std::to_wstring(cx);
-
-                std::wstring appPath = get_module_folderpath(g_hInst) + L"\\PowerToys.QoiThumbnailProvider.exe";
-
-                SHELLEXECUTEINFO sei{ sizeof(sei) };
-                sei.fMask = { SEE_MASK_NOCLOSEPROCESS | SEE_MASK_FLAG_NO_UI };
-                sei.lpFile = appPath.c_str();
-                sei.lpParameters = cmdLine.c_str();
-                sei.nShow = SW_SHOWDEFAULT;
-                ShellExecuteEx(&sei);
-                m_process = sei.hProcess;
-                WaitForSingleObject(m_process, INFINITE);
-                std::filesystem::remove(fileName);
-
-
-                std::wstring fileNameBmp = filePath + guid + L".bmp";
-                if (std::filesystem::exists(fileNameBmp))
-                {
-                    *phbmp = static_cast<HBITMAP>(LoadImage(NULL, fileNameBmp.c_str(), IMAGE_BITMAP, 0, 0, LR_LOADFROMFILE));
-                    *pdwAlpha = WTS_ALPHATYPE::WTSAT_ARGB;
-                    std::filesystem::remove(fileNameBmp);
-                }
-                else
-                {
-                    Logger::info(L"Bmp file not generated.");
-                    return E_FAIL;
-                }
-            }
-            catch (std::exception& e)
-            {
-                std::wstring errorMessage = std::wstring{ winrt::to_hstring(e.what()) };
-                Logger::error(L"Failed to start QoiThumbnailProvider.exe. Error: {}", errorMessage);
-            }
+            *phbmp = CreateThumbnailBitmap(thumbnail.width, thumbnail.height, thumbnail.pixels.data());
+            *pdwAlpha = WTSAT_ARGB;
+            return *phbmp ? S_OK : E_OUTOFMEMORY;
         }
+
+        Logger::warn(L"Failed to decode the QOI image, falling back to PowerToys.QoiThumbnailProvider.exe");
+        start.QuadPart = position.QuadPart;
+        m_pStream->Seek(start, STREAM_SEEK_SET, nullptr);
     }
 
+    // Shared by the thumbnails requested from this process, so that the helper is started once
+    static ThumbnailHost host{ get_module_folderpath(g_hInst) + L"\\PowerToys.QoiThumbnailProvider.exe",
+                               std::make_shared<ThumbnailCache>(PTSettingsHelper::get_local_low_folder_location() + L"\\ThumbnailCache\\Qoi") };
 
-    return S_OK;
-}
+    HRESULT hr = host.GetThumbnail(m_pStream, cx, phbmp, pdwAlpha);
+    m_pStream->Release();
+    m_pStream = NULL;
 
+    if (FAILED(hr))
+    {
+        Logger::error(L"Failed to get the thumbnail from PowerToys.QoiThumbnailProvider.exe. Error: {:#x}", static_cast<unsigned int>(hr));
+    }
+    return hr;
+}
 
 #pragma endregion
 
@@ -24,6 +24,11 @@ namespace Microsoft.PowerToys.ThumbnailHandler.Stl
             Stream = new FileStream(filePath, FileMode.Open, FileAccess.Read);
         }
 
+        public StlThumbnailProvider(Stream stream)
+        {
+            Stream = stream;
+        }
+
         /// <summary>
         /// Gets the file path to the file creating thumbnail for.
         /// </summary>
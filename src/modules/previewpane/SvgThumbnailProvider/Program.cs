@@ -3,6 +3,7 @@
 // See the LICENSE file in the project root for more information.
 
 using System.Globalization;
+using PreviewHandlerCommon.Utilities;
 
 namespace Microsoft.PowerToys.ThumbnailHandler.Svg
 {
@@ -19,7 +20,12 @@ namespace Microsoft.PowerToys.ThumbnailHandler.Svg
             ApplicationConfiguration.Initialize();
             if (args != null)
             {
-                if (args.Length == 2)
+                if (args.Length == 2 && args[0] == ThumbnailHostServer.HostArgument)
+                {
+                    // Started by the thumbnail provider, renders its requests until idle
+                    ThumbnailHostServer.Run(args[1], (stream, cx) => new SvgThumbnailProvider(stream).GetThumbnail(cx));
+                }
+                else if (args.Length == 2)
                 {
                     string filePath = args[0];
                     uint cx = Convert.ToUInt32(args[1], 10);
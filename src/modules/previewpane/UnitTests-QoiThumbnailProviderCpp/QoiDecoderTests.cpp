@@ -0,0 +1,461 @@
+#include "pch.h"
+
+#include <QoiDecoder.h>
+
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+extern "C" IMAGE_DOS_HEADER __ImageBase;
+
+namespace UnitTestsQoiThumbnailProviderCpp
+{
+    namespace
+    {
+        struct Rgba
+        {
+            uint8_t r, g, b, a;
+
+            bool operator==(const Rgba&) const = default;
+        };
+
+        struct Image
+        {
+            uint32_t width = 0;
+            uint32_t height = 0;
+            std::vector<Rgba> pixels;
+        };
+
+        int Hash(const Rgba& pixel)
+        {
+            return (pixel.r * 3 + pixel.g * 5 + pixel.b * 7 + pixel.a * 11) % 64;
+        }
+
+        void Put32(std::vector<uint8_t>& bytes, const uint32_t value)
+        {
+            bytes.push_back(static_cast<uint8_t>(value >> 24));
+            bytes.push_back(static_cast<uint8_t>(value >> 16));
+            bytes.push_back(static_cast<uint8_t>(value >> 8));
+            bytes.push_back(static_cast<uint8_t>(value));
+        }
+
+        // Encoder of the QOI specification, producing every op for the images below
+        std::vector<uint8_t> Encode(const Image& image, const uint8_t channels = 4)
+        {
+            std::vector<uint8_t> bytes{ 'q', 'o', 'i', 'f' };
+            Put32(bytes, image.width);
+            Put32(bytes, image.height);
+            bytes.push_back(channels);
+            bytes.push_back(0);
+
+            Rgba index[64]{};
+            Rgba previous{ 0, 0, 0, 255 };
+            int run = 0;
+            for (size_t i = 0; i < image.pixels.size(); ++i)
+            {
+                const Rgba pixel = image.pixels[i];
+                if (pixel == previous)
+                {
+                    if (++run == 62 || i + 1 == image.pixels.size())
+                    {
+                        bytes.push_back(static_cast<uint8_t>(0xc0 | (run - 1)));
+                        run = 0;
+                    }
+                    continue;
+                }
+                if (run > 0)
+                {
+                    bytes.push_back(static_cast<uint8_t>(0xc0 | (run - 1)));
+                    run = 0;
+                }
+
+                const int hash = Hash(pixel);
+                if (index[hash] == pixel)
+                {
+                    bytes.push_back(static_cast<uint8_t>(hash));
+                }
+                else if (index[hash] = pixel; pixel.a == previous.a)
+                {
+                    const int dr = static_cast<int8_t>(pixel.r - previous.r);
+                    const int dg = static_cast<int8_t>(pixel.g - previous.g);
+                    const int db = static_cast<int8_t>(pixel.b - previous.b);
+                    const int dgr = dr - dg;
+                    const int dgb = db - dg;
+                    if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+                    {
+                        bytes.push_back(static_cast<uint8_t>(0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+                    }
+                    else if (dgr >= -8 && dgr <= 7 && dg >= -32 && dg <= 31 && dgb >= -8 && dgb <= 7)
+                    {
+                        bytes.push_back(static_cast<uint8_t>(0x80 | (dg + 32)));
+                        bytes.push_back(static_cast<uint8_t>((dgr + 8) << 4 | (dgb + 8)));
+                    }
+                    else
+                    {
+                        bytes.insert(bytes.end(), { 0xfe, pixel.r, pixel.g, pixel.b });
+                    }
+                }
+                else
+                {
+                    bytes.insert(bytes.end(), { 0xff, pixel.r, pixel.g, pixel.b, pixel.a });
+                }
+                previous = pixel;
+            }
+
+            bytes.insert(bytes.end(), { 0, 0, 0, 0, 0, 0, 0, 1 });
+            return bytes;
+        }
+
+        // Whole image decoder of the QOI specification
+        bool DecodeReference(const std::vector<uint8_t>& bytes, Image& image)
+        {
+            if (bytes.size() < 14 + 8 || !std::equal(bytes.begin(), bytes.begin() + 4, "qoif"))
+            {
+                return false;
+            }
+            auto get32 = [&](const size_t offset) {
+                return static_cast<uint32_t>(bytes[offset]) << 24 | bytes[offset + 1] << 16 | bytes[offset + 2] << 8 | bytes[offset + 3];
+            };
+            image.width = get32(4);
+            image.height = get32(8);
+            image.pixels.assign(static_cast<size_t>(image.width) * image.height, Rgba{});
+
+            Rgba index[64]{};
+            Rgba pixel{ 0, 0, 0, 255 };
+            int run = 0;
+            size_t p = 14;
+            const size_t end = bytes.size() - 8;
+            for (auto& out : image.pixels)
+            {
+                if (run > 0)
+                {
+                    --run;
+                }
+                else if (p < end)
+                {
+                    const uint8_t b1 = bytes[p++];
+                    if (b1 == 0xfe)
+                    {
+                        pixel.r = bytes[p++];
+                        pixel.g = bytes[p++];
+                        pixel.b = bytes[p++];
+                    }
+                    else if (b1 == 0xff)
+                    {
+                        pixel = { bytes[p], bytes[p + 1], bytes[p + 2], bytes[p + 3] };
+                        p += 4;
+                    }
+                    else if ((b1 & 0xc0) == 0x00)
+                    {
+                        pixel = index[b1];
+                    }
+                    else if ((b1 & 0xc0) == 0x40)
+                    {
+                        pixel.r = static_cast<uint8_t>(pixel.r + ((b1 >> 4) & 3) - 2);
+                        pixel.g = static_cast<uint8_t>(pixel.g + ((b1 >> 2) & 3) - 2);
+                        pixel.b = static_cast<uint8_t>(pixel.b + (b1 & 3) - 2);
+                    }
+                    else if ((b1 & 0xc0) == 0x80)
+                    {
+                        const uint8_t b2 = bytes[p++];
+                        const int dg = (b1 & 0x3f) - 32;
+                        pixel.r = static_cast<uint8_t>(pixel.r + dg - 8 + ((b2 >> 4) & 0x0f));
+                        pixel.g = static_cast<uint8_t>(pixel.g + dg);
+                        pixel.b = static_cast<uint8_t>(pixel.b + dg - 8 + (b2 & 0x0f));
+                    }
+                    else
+                    {
+                        run = b1 & 0x3f;
+                    }
+                    index[Hash(pixel)] = pixel;
+                }
+                out = pixel;
+            }
+            return true;
+        }
+
+        // Box filter over the premultiplied pixels, each pixel adding to the thumbnail pixel its coordinates scale to
+        std::vector<uint32_t> ThumbnailReference(const Image& image, const uint32_t width, const uint32_t height)
+        {
+            std::vector<uint64_t> sums(static_cast<size_t>(width) * height * 4);
+            std::vector<uint64_t> counts(static_cast<size_t>(width) * height);
+            for (uint32_t y = 0; y < image.height; ++y)
+            {
+                for (uint32_t x = 0; x < image.width; ++x)
+                {
+                    const size_t target = static_cast<uint64_t>(y) * height / image.height * width + static_cast<uint64_t>(x) * width / image.width;
+                    const Rgba& pixel = image.pixels[static_cast<size_t>(y) * image.width + x];
+                    sums[target * 4] += (2 * pixel.b * pixel.a + 255) / 510;
+                    sums[target * 4 + 1] += (2 * pixel.g * pixel.a + 255) / 510;
+                    sums[target * 4 + 2] += (2 * pixel.r * pixel.a + 255) / 510;
+                    sums[target * 4 + 3] += pixel.a;
+                    ++counts[target];
+                }
+            }
+
+            std::vector<uint32_t> thumbnail(counts.size());
+            for (size_t i = 0; i < thumbnail.size(); ++i)
+            {
+                for (int c = 0; c < 4; ++c)
+                {
+                    thumbnail[i] |= static_cast<uint32_t>((2 * sums[i * 4 + c] + counts[i]) / (2 * counts[i])) << (8 * c);
+                }
+            }
+            return thumbnail;
+        }
+
+        // Regions of flat color, gradients, a small palette, noise and translucency, so that every op shows up
+        Image MakeImage(const uint32_t width, const uint32_t height, const bool opaque, const uint32_t seed)
+        {
+            Image image{ width, height, {} };
+            image.pixels.reserve(static_cast<size_t>(width) * height);
+            std::mt19937 rng{ seed };
+            const Rgba palette[]{ { 255, 0, 0, 255 }, { 0, 128, 255, 255 }, { 20, 200, 20, 128 }, { 255, 255, 255, 0 } };
+            for (uint32_t y = 0; y < height; ++y)
+            {
+                for (uint32_t x = 0; x < width; ++x)
+                {
+                    Rgba pixel;
+                    switch ((x / 13 + y / 7) % 5)
+                    {
+                    case 0:
+                        pixel = { 40, 80, 120, 255 };
+                        break;
+                    case 1:
+                        pixel = { static_cast<uint8_t>(x), static_cast<uint8_t>(x + y), static_cast<uint8_t>(y), 255 };
+                        break;
+                    case 2:
+                        pixel = palette[rng() % 4];
+                        break;
+                    case 3:
+                        pixel = { static_cast<uint8_t>(rng()), static_cast<uint8_t>(rng()), static_cast<uint8_t>(rng()), 255 };
+                        break;
+                    default:
+                        pixel = { static_cast<uint8_t>(x * 3), static_cast<uint8_t>(y * 5), 90, static_cast<uint8_t>(x * 7 + y) };
+                        break;
+                    }
+                    if (opaque)
+                    {
+                        pixel.a = 255;
+                    }
+                    image.pixels.push_back(pixel);
+                }
+            }
+            return image;
+        }
+
+        // Reads the bytes in pieces of at most maxRead
+        qoi::ReadFunction MemoryReader(const std::vector<uint8_t>& bytes, size_t& offset, const size_t maxRead = SIZE_MAX)
+        {
+            return [&bytes, &offset, maxRead](uint8_t* buffer, size_t size) -> size_t {
+                size = (std::min)({ size, maxRead, bytes.size() - offset });
+                std::copy_n(bytes.begin() + offset, size, buffer);
+                offset += size;
+                return size;
+            };
+        }
+
+        bool Decode(const std::vector<uint8_t>& bytes, const uint32_t cx, qoi::Thumbnail& thumbnail, const size_t maxRead = SIZE_MAX)
+        {
+            size_t offset = 0;
+            return qoi::DecodeThumbnail(MemoryReader(bytes, offset, maxRead), bytes.size(), cx, thumbnail);
+        }
+
+        void AssertMatchesReference(const std::vector<uint8_t>& bytes, const uint32_t cx)
+        {
+            Image image;
+            Assert::IsTrue(DecodeReference(bytes, image));
+            qoi::Thumbnail thumbnail;
+            Assert::IsTrue(Decode(bytes, cx, thumbnail));
+
+            uint32_t width;
+            uint32_t height;
+            qoi::ThumbnailSize(image.width, image.height, cx, width, height);
+            Assert::AreEqual(width, thumbnail.width);
+            Assert::AreEqual(height, thumbnail.height);
+            const auto expected = ThumbnailReference(image, width, height);
+            for (size_t i = 0; i < expected.size(); ++i)
+            {
+                if (expected[i] != thumbnail.pixels[i])
+                {
+                    Assert::Fail(std::format(L"{}x{} at {}: pixel {} is {:08x} instead of {:08x}", image.width, image.height, cx, i, thumbnail.pixels[i], expected[i]).c_str());
+                }
+            }
+        }
+
+        std::vector<uint8_t> ReadSample()
+        {
+            wchar_t modulePath[MAX_PATH]{};
+            GetModuleFileNameW(reinterpret_cast<HMODULE>(&__ImageBase), modulePath, MAX_PATH);
+            std::wstring path = modulePath;
+            path = path.substr(0, path.find_last_of(L'\\') + 1) + L"sample.qoi";
+            std::ifstream file{ path, std::ios::binary };
+            return { std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+        }
+    }
+
+    TEST_CLASS (QoiDecoderTests)
+    {
+    public:
+        TEST_METHOD (ThumbnailSize_FitsWithoutUpscaling)
+        {
+            uint32_t width;
+            uint32_t height;
+            qoi::ThumbnailSize(7680, 4320, 256, width, height);
+            Assert::AreEqual(256u, width);
+            Assert::AreEqual(144u, height);
+            qoi::ThumbnailSize(300, 1200, 256, width, height);
+            Assert::AreEqual(64u, width);
+            Assert::AreEqual(256u, height);
+            qoi::ThumbnailSize(100, 50, 256, width, height);
+            Assert::AreEqual(100u, width);
+            Assert::AreEqual(50u, height);
+            qoi::ThumbnailSize(10000, 1, 16, width, height);
+            Assert::AreEqual(16u, width);
+            Assert::AreEqual(1u, height);
+        }
+
+        TEST_METHOD (DecodesEveryOpAtFullSize)
+        {
+            AssertMatchesReference(Encode(MakeImage(97, 61, false, 1)), 256);
+            AssertMatchesReference(Encode(MakeImage(64, 64, true, 2), 3), 64);
+        }
+
+        TEST_METHOD (DownscalesLikeReference)
+        {
+            const std::pair<uint32_t, uint32_t> sizes[]{ { 1, 1 }, { 3, 2 }, { 5, 300 }, { 211, 97 }, { 640, 480 }, { 1023, 17 } };
+            for (const auto& [width, height] : sizes)
+            {
+                const auto bytes = Encode(MakeImage(width, height, width % 2 == 0, width));
+                for (const uint32_t cx : { 1u, 2u, 7u, 32u, 96u, 256u })
+                {
+                    AssertMatchesReference(bytes, cx);
+                }
+            }
+        }
+
+        TEST_METHOD (DecodesSampleImage)
+        {
+            // Written by the reference encoder, shared with the tests of the managed provider
+            const auto bytes = ReadSample();
+            Assert::IsFalse(bytes.empty());
+            for (const uint32_t cx : { 32u, 96u, 256u, 1024u })
+            {
+                AssertMatchesReference(bytes, cx);
+            }
+        }
+
+        TEST_METHOD (ReadsInChunks)
+        {
+            const auto bytes = Encode(MakeImage(1500, 1000, false, 3));
+            Assert::IsTrue(bytes.size() > 4 * qoi::ReadChunkSize);
+
+            size_t reads = 0;
+            size_t offset = 0;
+            const auto read = MemoryReader(bytes, offset);
+            qoi::Thumbnail thumbnail;
+            Assert::IsTrue(qoi::DecodeThumbnail([&](uint8_t* buffer, size_t size) { ++reads; return read(buffer, size); }, bytes.size(), 96, thumbnail));
+            Assert::IsTrue(reads <= bytes.size() / qoi::ReadChunkSize + 1);
+
+            // Short reads decode the same
+            qoi::Thumbnail trickled;
+            Assert::IsTrue(Decode(bytes, 96, trickled, 7));
+            Assert::IsTrue(thumbnail.pixels == trickled.pixels);
+        }
+
+        TEST_METHOD (DecodesImagesMadeOfRuns)
+        {
+            // 62x2 pixels in two bytes, the densest encoding, then the end marker
+            const std::vector<uint8_t> bytes{ 'q', 'o', 'i', 'f', 0, 0, 0, 62, 0, 0, 0, 2, 4, 0, 0xfd, 0xfd, 0, 0, 0, 0, 0, 0, 0, 1 };
+            qoi::Thumbnail thumbnail;
+            Assert::IsTrue(Decode(bytes, 96, thumbnail));
+            Assert::AreEqual(62u, thumbnail.width);
+            Assert::AreEqual(2u, thumbnail.height);
+            Assert::IsTrue(std::all_of(thumbnail.pixels.begin(), thumbnail.pixels.end(), [](const uint32_t pixel) { return pixel == 0xff000000; }));
+        }
+
+        TEST_METHOD (RejectsMalformedImages)
+        {
+            const auto bytes = Encode(MakeImage(40, 30, false, 4));
+            qoi::Thumbnail thumbnail;
+
+            auto patched = [&](const size_t offset, const uint8_t value) {
+                auto copy = bytes;
+                copy[offset] = value;
+                return copy;
+            };
+            Assert::IsFalse(Decode(patched(0, 'Q'), 96, thumbnail));
+            Assert::IsFalse(Decode(patched(7, 0), 96, thumbnail));
+            Assert::IsFalse(Decode(patched(11, 0), 96, thumbnail));
+            Assert::IsFalse(Decode(patched(12, 5), 96, thumbnail));
+            Assert::IsFalse(Decode(patched(13, 2), 96, thumbnail));
+            Assert::IsFalse(Decode(bytes, 0, thumbnail));
+
+            // More pixels than the managed decoder accepts
+            auto huge = bytes;
+            huge[4] = huge[8] = 0x01;
+            Assert::IsFalse(Decode(huge, 96, thumbnail));
+
+            // A header alone can't hold that many pixels, even all in runs
+            std::vector<uint8_t> header(bytes.begin(), bytes.begin() + 14);
+            header[4] = 0x17;
+            header[5] = 0xd7;
+            header[6] = 0x83;
+            header[7] = 0xff;
+            header[8] = header[9] = header[10] = 0;
+            header[11] = 1;
+            Assert::IsFalse(Decode(header, 96, thumbnail));
+
+            // Cut anywhere in the header or the pixels
+            for (const size_t size : { size_t{ 0 }, size_t{ 10 }, size_t{ 14 }, bytes.size() / 2, bytes.size() - 9 })
+            {
+                const std::vector<uint8_t> truncated(bytes.begin(), bytes.begin() + size);
+                Assert::IsFalse(Decode(truncated, 96, thumbnail));
+            }
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(Benchmark_Decode8K)
+            TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD (Benchmark_Decode8K)
+        {
+            using clock = std::chrono::steady_clock;
+            const auto image = MakeImage(7680, 4320, false, 5);
+            const auto bytes = Encode(image);
+            auto ms = [](const clock::duration duration) { return std::chrono::duration<double, std::milli>(duration).count(); };
+
+            for (const uint32_t cx : { 96u, 256u, 1024u })
+            {
+                constexpr int iterations = 5;
+                qoi::Thumbnail thumbnail;
+                const auto start = clock::now();
+                for (int i = 0; i < iterations; ++i)
+                {
+                    Assert::IsTrue(Decode(bytes, cx, thumbnail));
+                }
+                const double elapsed = ms(clock::now() - start) / iterations;
+                Logger::WriteMessage(std::format(L"7680x4320 ({} MB) to {}x{}: {:.1f} ms, {:.0f} Mpixels/s\n",
+                                                 bytes.size() >> 20,
+                                                 thumbnail.width,
+                                                 thumbnail.height,
+                                                 elapsed,
+                                                 image.pixels.size() / elapsed / 1000)
+                                         .c_str());
+            }
+
+            // Decoding the whole image first, like the managed provider does before scaling it down
+            const auto start = clock::now();
+            Image decoded;
+            Assert::IsTrue(DecodeReference(bytes, decoded));
+            Logger::WriteMessage(std::format(L"Whole image reference decode: {:.1f} ms\n", ms(clock::now() - start)).c_str());
+        }
+    };
+}
@@ -0,0 +1,13 @@
+//{{NO_DEPENDENCIES}}
+// Microsoft Visual C++ generated include file.
+// Used by UnitTests-QoiThumbnailProviderCpp.rc
+
+//////////////////////////////
+// Non-localizable
+
+#define FILE_DESCRIPTION "PowerToys UnitTests-QoiThumbnailProviderCpp"
+#define INTERNAL_NAME "UnitTests-QoiThumbnailProviderCpp"
+#define ORIGINAL_FILENAME "UnitTests-QoiThumbnailProviderCpp.dll"
+
+// Non-localizable
+//////////////////////////////
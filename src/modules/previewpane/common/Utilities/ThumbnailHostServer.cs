@@ -0,0 +1,188 @@
+// Copyright (c) Microsoft Corporation
+// The Microsoft Corporation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+using System;
+using System.Drawing;
+using System.Drawing.Drawing2D;
+using System.Drawing.Imaging;
+using System.IO;
+using System.IO.MemoryMappedFiles;
+using System.Runtime.InteropServices;
+using System.Threading;
+
+namespace PreviewHandlerCommon.Utilities
+{
+    /// <summary>
+    /// Serves the thumbnail requests of a ThumbnailHost (src/common/ThumbnailHost) from a long-lived helper process.
+    /// The file contents are read from, and the pixels written to, a section shared with the thumbnail provider.
+    /// </summary>
+    public static class ThumbnailHostServer
+    {
+        /// <summary>
+        /// Command line argument followed by the name of the shared objects.
+        /// </summary>
+        public const string HostArgument = "--host";
+
+        private const uint HeaderMagic = 0x48545450;
+        private const int StatusSucceeded = 0;
+        private const int StatusFailed = 1;
+
+        // Mirrors ThumbnailHost.cpp
+        private const ulong RetainedCapacity = 16 << 20;
+
+        /// <summary>
+        /// The worker exits once idle for that long, and is started again on the next request.
+        /// </summary>
+        private static readonly TimeSpan IdleTimeout = TimeSpan.FromMinutes(2);
+
+        /// <summary>
+        /// Layout of the control section, see ThumbnailHost::Header.
+        /// </summary>
+        [StructLayout(LayoutKind.Sequential)]
+        private struct Header
+        {
+            public uint Magic;
+            public uint Generation;
+            public ulong Capacity;
+            public ulong InputSize;
+            public uint Cx;
+            public int Status;
+            public uint Width;
+            public uint Height;
+        }
+
+        /// <summary>
+        /// Renders the requests until the worker is idle for too long.
+        /// </summary>
+        /// <param name="name">Name of the shared objects, passed after <see cref="HostArgument"/>.</param>
+        /// <param name="getThumbnail">Renders the thumbnail of a file, given its contents and the maximum thumbnail size.</param>
+        public static void Run(string name, Func<Stream, uint, Bitmap?> getThumbnail)
+        {
+            using var control = MemoryMappedFile.OpenExisting(name + ".Control");
+            using var header = control.CreateViewAccessor(0, Marshal.SizeOf<Header>());
+            using var request = EventWaitHandle.OpenExisting(name + ".Request");
+            using var response = EventWaitHandle.OpenExisting(name + ".Response");
+
+            MemoryMappedFile? data = null;
+            MemoryMappedViewAccessor? view = null;
+            uint generation = 0;
+            try
+            {
+                while (request.WaitOne(IdleTimeout))
+                {
+                    header.Read(0, out Header current);
+                    if (current.Magic != HeaderMagic)
+                    {
+                        return;
+                    }
+
+                    current.Status = StatusFailed;
+                    try
+                    {
+                        if (view == null || generation != current.Generation)
+                        {
+                            view?.Dispose();
+                            data?.Dispose();
+                            view = null;
+                            data = MemoryMappedFile.OpenExisting(name + ".Data." + current.Generation);
+                            view = data.CreateViewAccessor(0, (long)current.Capacity);
+                            generation = current.Generation;
+                        }
+
+                        using Bitmap? thumbnail = Render(view, current, getThumbnail);
+                        if (thumbnail != null)
+                        {
+                            CopyPixels(view, thumbnail);
+                            current.Width = (uint)thumbnail.Width;
+                            current.Height = (uint)thumbnail.Height;
+                            current.Status = StatusSucceeded;
+                        }
+
+                        if (current.Capacity > RetainedCapacity)
+                        {
+                            view.Dispose();
+                            data?.Dispose();
+                            view = null;
+                            data = null;
+                        }
+                    }
+                    catch (Exception)
+                    {
+                        // Reported as a failure of this request
+                    }
+
+                    header.Write(0, ref current);
+                    response.Set();
+                }
+            }
+            finally
+            {
+                view?.Dispose();
+                data?.Dispose();
+            }
+        }
+
+        /// <summary>
+        /// Renders the thumbnail and scales it down to fit in cx * cx, which the section is sized for.
+        /// </summary>
+        private static Bitmap? Render(MemoryMappedViewAccessor view, Header header, Func<Stream, uint, Bitmap?> getThumbnail)
+        {
+            Bitmap? thumbnail;
+            using (var input = new UnmanagedMemoryStream(view.SafeMemoryMappedViewHandle, view.PointerOffset, (long)header.InputSize))
+            {
+                thumbnail = getThumbnail(input, header.Cx);
+            }
+
+            if (thumbnail == null || thumbnail.Width == 0 || thumbnail.Height == 0)
+            {
+                thumbnail?.Dispose();
+                return null;
+            }
+
+            if (thumbnail.Width <= header.Cx && thumbnail.Height <= header.Cx)
+            {
+                return thumbnail;
+            }
+
+            float scale = Math.Min((float)header.Cx / thumbnail.Width, (float)header.Cx / thumbnail.Height);
+            var scaled = new Bitmap(Math.Max(1, (int)(thumbnail.Width * scale)), Math.Max(1, (int)(thumbnail.Height * scale)), PixelFormat.Format32bppArgb);
+            using (var graphics = Graphics.FromImage(scaled))
+            {
+                graphics.InterpolationMode = InterpolationMode.HighQualityBicubic;
+                graphics.PixelOffsetMode = PixelOffsetMode.HighQuality;
+                graphics.DrawImage(thumbnail, 0, 0, scaled.Width, scaled.Height);
+            }
+
+            thumbnail.Dispose();
+            return scaled;
+        }
+
+        /// <summary>
+        /// Lets GDI+ convert the pixels to top-down 32bpp ARGB straight into the shared section.
+        /// </summary>
+        private static unsafe void CopyPixels(MemoryMappedViewAccessor view, Bitmap thumbnail)
+        {
+            byte* pointer = null;
+            view.SafeMemoryMappedViewHandle.AcquirePointer(ref pointer);
+            try
+            {
+                var pixels = new BitmapData
+                {
+                    Width = thumbnail.Width,
+                    Height = thumbnail.Height,
+                    Stride = thumbnail.Width * 4,
+                    PixelFormat = PixelFormat.Format32bppArgb,
+                    Scan0 = (IntPtr)(pointer + view.PointerOffset),
+                };
+                var bounds = new Rectangle(0, 0, thumbnail.Width, thumbnail.Height);
+                thumbnail.LockBits(bounds, ImageLockMode.ReadOnly | ImageLockMode.UserInputBuffer, PixelFormat.Format32bppArgb, pixels);
+                thumbnail.UnlockBits(pixels);
+            }
+            finally
+            {
+                view.SafeMemoryMappedViewHandle.ReleasePointer();
+            }
+        }
+    }
+}
@@ -211,7 +211,8 @@ void PowerPreviewModule::show_update_warning_message()
     show_toast_with_activations(GET_RESOURCE_STRING(IDS_FILEEXPLORER_ADMIN_RESTART_WARNING_DESCRIPTION),
                                 GET_RESOURCE_STRING(IDS_FILEEXPLORER_ADMIN_RESTART_WARNING_TITLE),
                                 {},
-                                std::move(actions));
+                                std::move(actions),
+                                toast_params{ .module_name = app_key });
 }
 
 void PowerPreviewModule::apply_settings(const PowerToysSettings::PowerToyValues& settings)
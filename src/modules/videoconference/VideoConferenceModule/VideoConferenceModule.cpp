@@ -80,9 +80,11 @@ void VideoConferenceModule::reverseVirtualCameraMuteState()
     }
 
     instance->_settingsUpdateChannel->access([&muted](auto settingsMemory) {
-        auto settings = reinterpret_cast<CameraSettingsUpdateChannel*>(settingsMemory._data);
-        settings->useOverlayImage = !settings->useOverlayImage;
-        muted = settings->useOverlayImage;
+        auto channel = reinterpret_cast<CameraSettingsUpdateChannel*>(settingsMemory._data);
+        channel->update([&muted](CameraSettingsUpdateChannel::Settings& settings) {
+            settings.useOverlayImage = !settings.useOverlayImage;
+            muted = settings.useOverlayImage;
+        });
     });
 
     if (muted)
@@ -100,8 +102,8 @@ bool VideoConferenceModule::getVirtualCameraMuteState()
         return disabled;
     }
     instance->_settingsUpdateChannel->access([&disabled](auto settingsMemory) {
-        auto settings = reinterpret_cast<CameraSettingsUpdateChannel*>(settingsMemory._data);
-        disabled = settings->useOverlayImage;
+        auto channel = reinterpret_cast<CameraSettingsUpdateChannel*>(settingsMemory._data);
+        disabled = channel->settings.useOverlayImage;
     });
     return disabled;
 }
@@ -112,89 +114,144 @@ bool VideoConferenceModule::getVirtualCameraInUse()
     {
         return false;
     }
-    bool inUse = false;
-    instance->_settingsUpdateChannel->access([&inUse](auto settingsMemory) {
-        auto settings = reinterpret_cast<CameraSettingsUpdateChannel*>(settingsMemory._data);
-        inUse = settings->cameraInUse;
-    });
-    return inUse;
+    // Written by the proxy filter without taking the lock
+    auto channel = reinterpret_cast<CameraSettingsUpdateChannel*>(instance->_settingsUpdateChannel->unserialized_memory()._data);
+    return channel->cameraInUse.load(std::memory_order_acquire);
 }
 
-LRESULT CALLBACK VideoConferenceModule::LowLevelKeyboardProc(int nCode, WPARAM wParam, LPARAM lParam)
+bool VideoConferenceModule::handleKeyEvent(DWORD vkCode, bool keyDown)
 {
-    if (nCode == HC_ACTION)
+    if (keyDown)
     {
-        KBDLLHOOKSTRUCT* kbd = reinterpret_cast<KBDLLHOOKSTRUCT*>(lParam);
-        switch (wParam)
+        if (isHotkeyPressed(vkCode, settings.cameraAndMicrophoneMuteHotkey))
         {
-        case WM_KEYDOWN:
-
-            if (isHotkeyPressed(kbd->vkCode, settings.cameraAndMicrophoneMuteHotkey))
+            const bool cameraInUse = getVirtualCameraInUse();
+            const bool microphoneIsMuted = getMicrophoneMuteState();
+            const bool cameraIsMuted = cameraInUse && getVirtualCameraMuteState();
+            if (cameraInUse)
             {
-                const bool cameraInUse = getVirtualCameraInUse();
-                const bool microphoneIsMuted = getMicrophoneMuteState();
-                const bool cameraIsMuted = cameraInUse && getVirtualCameraMuteState();
-                if (cameraInUse)
+                // we're likely on a video call, so we must mute the unmuted cam/mic or reverse the mute state
+                // of everything, if cam and mic mute states are the same
+                if (microphoneIsMuted == cameraIsMuted)
                 {
-                    // we're likely on a video call, so we must mute the unmuted cam/mic or reverse the mute state
-                    // of everything, if cam and mic mute states are the same
-                    if (microphoneIsMuted == cameraIsMuted)
-                    {
-                        reverseMicrophoneMute();
-                        reverseVirtualCameraMuteState();
-                    }
-                    else if (cameraIsMuted)
-                    {
-                        reverseMicrophoneMute();
-                    }
-                    else if (microphoneIsMuted)
-                    {
-                        reverseVirtualCameraMuteState();
-                    }
+                    reverseMicrophoneMute();
+                    reverseVirtualCameraMuteState();
                 }
-                else
+                else if (cameraIsMuted)
                 {
-                    // if the camera is not in use, we just mute/unmute the mic
                     reverseMicrophoneMute();
                 }
-                return 1;
+                else if (microphoneIsMuted)
+                {
+                    reverseVirtualCameraMuteState();
+                }
             }
-            else if (isHotkeyPressed(kbd->vkCode, settings.microphoneMuteHotkey))
+            else
             {
+                // if the camera is not in use, we just mute/unmute the mic
                 reverseMicrophoneMute();
-                return 1;
             }
-            else if (isHotkeyPressed(kbd->vkCode, settings.microphonePushToTalkHotkey))
+            return true;
+        }
+        else if (isHotkeyPressed(vkCode, settings.microphoneMuteHotkey))
+        {
+            reverseMicrophoneMute();
+            return true;
+        }
+        else if (isHotkeyPressed(vkCode, settings.microphonePushToTalkHotkey))
+        {
+            if (!pushToTalkPressed)
             {
-                if (!pushToTalkPressed)
+                if (settings.pushToReverseEnabled || getMicrophoneMuteState())
                 {
-                    if (settings.pushToReverseEnabled || getMicrophoneMuteState())
-                    {
-                        reverseMicrophoneMute();
-                    }
-                    pushToTalkPressed = true;
+                    reverseMicrophoneMute();
                 }
-                return 1;
-            }
-            else if (isHotkeyPressed(kbd->vkCode, settings.cameraMuteHotkey))
-            {
-                reverseVirtualCameraMuteState();
-                return 1;
-            }
-            break;
-        case WM_KEYUP:
-            if (pushToTalkPressed && (kbd->vkCode == settings.microphonePushToTalkHotkey.get_code()))
-            {
-                reverseMicrophoneMute();
-                pushToTalkPressed = false;
-                return 1;
+                pushToTalkPressed = true;
             }
+            return true;
+        }
+        else if (isHotkeyPressed(vkCode, settings.cameraMuteHotkey))
+        {
+            reverseVirtualCameraMuteState();
+            return true;
+        }
+    }
+    else if (pushToTalkPressed && (vkCode == settings.microphonePushToTalkHotkey.get_code()))
+    {
+        reverseMicrophoneMute();
+        pushToTalkPressed = false;
+        return true;
+    }
+    return false;
+}
+
+LRESULT CALLBACK VideoConferenceModule::LowLevelKeyboardProc(int nCode, WPARAM wParam, LPARAM lParam)
+{
+    if (nCode == HC_ACTION && (wParam == WM_KEYDOWN || wParam == WM_KEYUP))
+    {
+        KBDLLHOOKSTRUCT* kbd = reinterpret_cast<KBDLLHOOKSTRUCT*>(lParam);
+        if (handleKeyEvent(kbd->vkCode, wParam == WM_KEYDOWN))
+        {
+            return 1;
         }
     }
 
     return CallNextHookEx(hook_handle, nCode, wParam, lParam);
 }
 
+void VideoConferenceModule::installKeyboardHook()
+{
+    if (!_keyboardHookDispatcher)
+    {
+#if defined(DISABLE_LOWLEVEL_HOOKS_WHEN_DEBUGGED)
+        if (IsDebuggerPresent())
+        {
+            return;
+        }
+#endif
+        if (!hook_handle)
+        {
+            hook_handle = SetWindowsHookEx(WH_KEYBOARD_LL, LowLevelKeyboardProc, GetModuleHandle(NULL), NULL);
+        }
+        return;
+    }
+
+    KeyboardHookDispatcher::Filter filter{ .keyDown = true, .keyUp = true };
+    for (const auto* hotkey : { &settings.cameraAndMicrophoneMuteHotkey, &settings.microphoneMuteHotkey, &settings.microphonePushToTalkHotkey, &settings.cameraMuteHotkey })
+    {
+        if (hotkey->get_code())
+        {
+            filter.keys.push_back(static_cast<uint8_t>(hotkey->get_code()));
+        }
+    }
+
+    uninstallKeyboardHook();
+    if (!filter.keys.empty())
+    {
+        _keyboardSubscription = _keyboardHookDispatcher->Subscribe(get_key(), KeyboardHookDispatcher::DefaultPriority, filter, [](const KeyboardHookDispatcher::Event& event) {
+            // The hotkeys are only triggered by WM_KEYDOWN and WM_KEYUP
+            return !event.systemKey && handleKeyEvent(event.vkCode, event.keyDown);
+        });
+    }
+}
+
+void VideoConferenceModule::uninstallKeyboardHook()
+{
+    if (_keyboardSubscription)
+    {
+        _keyboardHookDispatcher->Unsubscribe(std::exchange(_keyboardSubscription, {}));
+    }
+
+    if (hook_handle)
+    {
+        bool success = UnhookWindowsHookEx(hook_handle);
+        if (success)
+        {
+            hook_handle = nullptr;
+        }
+    }
+}
+
 void VideoConferenceModule::onGeneralSettingsChanged()
 {
     auto settings = PTSettingsHelper::load_general_settings();
@@ -296,6 +353,12 @@ void VideoConferenceModule::onModuleSettingsChanged()
             }
 
             toolbar.show(settings.toolbarPositionString, settings.toolbarMonitorString);
+
+            if (_keyboardHookDispatcher)
+            {
+                // The subscription only covers the keys of the previous hotkeys
+                installKeyboardHook();
+            }
         }
     }
     catch (...)
@@ -360,6 +423,9 @@ VideoConferenceModule::VideoConferenceModule()
 #pragma warning(disable : 26403)
             auto updatesChannel = new (memory._data) CameraSettingsUpdateChannel{};
 #pragma warning(pop)
+            // Start from a time based generation, so a proxy filter which outlived a previous module instance
+            // doesn't mistake the new settings for the ones it has already read
+            updatesChannel->generation = static_cast<uint32_t>(GetTickCount64()) & ~1u;
         });
     }
     sendSourceCameraNameUpdate();
@@ -381,6 +447,11 @@ const wchar_t* VideoConferenceModule::get_key()
     return L"Video Conference";
 }
 
+void VideoConferenceModule::set_keyboard_hook_dispatcher(KeyboardHookDispatcher* dispatcher)
+{
+    _keyboardHookDispatcher = dispatcher;
+}
+
 // Return the configured status for the gpo policy for the module
 powertoys_gpo::gpo_rule_configured_t VideoConferenceModule::gpo_policy_enabled_configuration()
 {
@@ -603,13 +674,7 @@ void VideoConferenceModule::enable()
 
         _enabled = true;
 
-#if defined(DISABLE_LOWLEVEL_HOOKS_WHEN_DEBUGGED)
-        if (IsDebuggerPresent())
-        {
-            return;
-        }
-#endif
-        hook_handle = SetWindowsHookEx(WH_KEYBOARD_LL, LowLevelKeyboardProc, GetModuleHandle(NULL), NULL);
+        installKeyboardHook();
     }
 }
 
@@ -646,14 +711,7 @@ void VideoConferenceModule::disable()
         _generalSettingsWatcher.reset();
         _moduleSettingsWatcher.reset();
         toggleProxyCamRegistration(false);
-        if (hook_handle)
-        {
-            bool success = UnhookWindowsHookEx(hook_handle);
-            if (success)
-            {
-                hook_handle = nullptr;
-            }
-        }
+        uninstallKeyboardHook();
 
         if (getVirtualCameraMuteState())
         {
@@ -673,6 +731,7 @@ bool VideoConferenceModule::is_enabled()
 
 void VideoConferenceModule::destroy()
 {
+    uninstallKeyboardHook();
     delete this;
     instance = nullptr;
 }
@@ -690,16 +749,18 @@ void VideoConferenceModule::sendSourceCameraNameUpdate()
     }
     _settingsUpdateChannel->access([](auto memory) {
         auto updatesChannel = reinterpret_cast<CameraSettingsUpdateChannel*>(memory._data);
-        updatesChannel->sourceCameraName.emplace();
-        std::copy(begin(settings.selectedCamera), end(settings.selectedCamera), begin(*updatesChannel->sourceCameraName));
-        if (settings.startupAction == L"Unmute")
-        {
-            updatesChannel->useOverlayImage = false;
-        }
-        else if (settings.startupAction == L"Mute")
-        {
-            updatesChannel->useOverlayImage = true;
-        }
+        updatesChannel->update([](CameraSettingsUpdateChannel::Settings& channelSettings) {
+            channelSettings.sourceCameraName.emplace();
+            std::copy(begin(settings.selectedCamera), end(settings.selectedCamera), begin(*channelSettings.sourceCameraName));
+            if (settings.startupAction == L"Unmute")
+            {
+                channelSettings.useOverlayImage = false;
+            }
+            else if (settings.startupAction == L"Mute")
+            {
+                channelSettings.useOverlayImage = true;
+            }
+        });
     });
 }
 
@@ -725,7 +786,9 @@ void VideoConferenceModule::sendOverlayImageUpdate()
     const auto imageSize = static_cast<uint32_t>(_imageOverlayChannel->size());
     _settingsUpdateChannel->access([imageSize](auto memory) {
         auto updatesChannel = reinterpret_cast<CameraSettingsUpdateChannel*>(memory._data);
-        updatesChannel->overlayImageSize.emplace(imageSize);
-        updatesChannel->newOverlayImagePosted = true;
+        updatesChannel->update([imageSize](CameraSettingsUpdateChannel::Settings& channelSettings) {
+            channelSettings.overlayImageSize.emplace(imageSize);
+            ++channelSettings.overlayImageGeneration;
+        });
     });
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <common/SettingsAPI/FileWatcher.h>
+#include <common/hooks/KeyboardHookDispatcher.h>
 
 #include <mmdeviceapi.h>
 #include <endpointvolume.h>
@@ -56,6 +57,8 @@ public:
 
     virtual const wchar_t * get_key() override;
 
+    virtual void set_keyboard_hook_dispatcher(KeyboardHookDispatcher* dispatcher) override;
+
     void sendSourceCameraNameUpdate();
     void sendOverlayImageUpdate();
 
@@ -77,12 +80,20 @@ private:
     void updateControlledMicrophones(const std::wstring_view new_mic);
     MicrophoneDevice* controlledDefaultMic();
 
+    // Subscribes to the runner's keyboard hook for the current hotkeys, or installs a hook without a dispatcher
+    void installKeyboardHook();
+    void uninstallKeyboardHook();
+
     //  all callback methods and used by callback have to be static
     static LRESULT CALLBACK LowLevelKeyboardProc(int nCode, WPARAM wParam, LPARAM lParam);
+    // Returns true if the key event triggered one of the hotkeys and has to be swallowed
+    static bool handleKeyEvent(DWORD vkCode, bool keyDown);
     static bool isKeyPressed(unsigned int keyCode);
     static bool isHotkeyPressed(DWORD code, PowerToysSettings::HotkeyObject& hotkey);
 
     static HHOOK hook_handle;
+    KeyboardHookDispatcher* _keyboardHookDispatcher = nullptr;
+    KeyboardHookDispatcher::SubscriptionId _keyboardSubscription{};
     bool _enabled = false;
 
     bool _mic_muted_state_during_disconnect = false;
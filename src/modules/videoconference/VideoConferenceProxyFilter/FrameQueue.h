@@ -0,0 +1,181 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <string>
+
+enum class FrameDropPolicy
+{
+    // Replace the oldest queued frame, so the consumer always gets the freshest frames
+    DropOldest,
+    // Reject new frames while the queue is full, so queued frames are never lost
+    DropNewest,
+};
+
+// Latency of a single pipeline stage
+class StageLatency
+{
+public:
+    void Add(const std::chrono::steady_clock::duration duration) noexcept
+    {
+        const auto us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+        _count.fetch_add(1, std::memory_order_relaxed);
+        _totalUs.fetch_add(us, std::memory_order_relaxed);
+        uint64_t max = _maxUs.load(std::memory_order_relaxed);
+        while (us > max && !_maxUs.compare_exchange_weak(max, us, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    uint64_t Count() const noexcept { return _count.load(std::memory_order_relaxed); }
+    uint64_t MaxUs() const noexcept { return _maxUs.load(std::memory_order_relaxed); }
+    uint64_t AverageUs() const noexcept
+    {
+        const uint64_t count = Count();
+        return count ? _totalUs.load(std::memory_order_relaxed) / count : 0;
+    }
+
+private:
+    std::atomic_uint64_t _count = 0;
+    std::atomic_uint64_t _totalUs = 0;
+    std::atomic_uint64_t _maxUs = 0;
+};
+
+struct FrameStatistics
+{
+    std::atomic_uint64_t received = 0;
+    std::atomic_uint64_t processed = 0;
+    std::atomic_uint64_t dropped = 0;
+
+    // From arrival to the worker picking the frame up
+    StageLatency queued;
+    // Overlaying or otherwise changing the frame
+    StageLatency processing;
+    // Handing the frame to the downstream filter
+    StageLatency delivery;
+
+    std::string ToString() const
+    {
+        auto stage = [](const char* name, const StageLatency& latency) {
+            return std::string{ name } + " avg " + std::to_string(latency.AverageUs()) + "us max " + std::to_string(latency.MaxUs()) + "us";
+        };
+        return "frames received " + std::to_string(received.load()) + ", processed " + std::to_string(processed.load()) +
+               ", dropped " + std::to_string(dropped.load()) + "; " + stage("queued", queued) + ", " +
+               stage("processing", processing) + ", " + stage("delivery", delivery);
+    }
+};
+
+// Bounded queue of in-flight frames between the capture callback and the worker thread.
+// Frame owns a reference to its sample, e.g. wil::com_ptr_nothrow<IMediaSample>. The queue never holds more than
+// Capacity frames, so a slow consumer can't starve the upstream allocator of samples, and every frame which is
+// dropped is counted and handed back to the caller to be released outside of the queue lock.
+template<typename Frame, size_t Capacity>
+class FrameQueue
+{
+    static_assert(Capacity > 0);
+
+public:
+    using clock = std::chrono::steady_clock;
+
+    struct Entry
+    {
+        Frame frame;
+        clock::time_point arrivalTime;
+    };
+
+    explicit FrameQueue(const FrameDropPolicy policy) noexcept :
+        _policy{ policy }
+    {
+    }
+
+    FrameQueue(const FrameQueue&) = delete;
+    FrameQueue& operator=(const FrameQueue&) = delete;
+
+    // Queues the frame. Returns the frame dropped to respect the capacity, if any.
+    std::optional<Frame> Push(Frame frame)
+    {
+        std::optional<Frame> dropped;
+        {
+            std::lock_guard lock{ _mutex };
+            _statistics.received.fetch_add(1, std::memory_order_relaxed);
+            if (_shutdown)
+            {
+                _statistics.dropped.fetch_add(1, std::memory_order_relaxed);
+                return std::move(frame);
+            }
+
+            if (_size == Capacity)
+            {
+                _statistics.dropped.fetch_add(1, std::memory_order_relaxed);
+                if (_policy == FrameDropPolicy::DropNewest)
+                {
+                    return std::move(frame);
+                }
+
+                dropped = std::move(_entries[_head]->frame);
+                _entries[_head].reset();
+                _head = (_head + 1) % Capacity;
+                --_size;
+            }
+
+            _entries[(_head + _size) % Capacity].emplace(Entry{ std::move(frame), clock::now() });
+            ++_size;
+        }
+
+        _cv.notify_one();
+        return dropped;
+    }
+
+    // Waits for the oldest queued frame. Returns nothing once the queue is shut down.
+    std::optional<Entry> Pop()
+    {
+        std::unique_lock lock{ _mutex };
+        _cv.wait(lock, [this] { return _size != 0 || _shutdown; });
+        if (_shutdown)
+        {
+            return std::nullopt;
+        }
+
+        std::optional<Entry> entry = std::move(_entries[_head]);
+        _entries[_head].reset();
+        _head = (_head + 1) % Capacity;
+        --_size;
+        lock.unlock();
+
+        _statistics.queued.Add(clock::now() - entry->arrivalTime);
+        return entry;
+    }
+
+    // Wakes up the consumer and rejects further frames. Queued frames are released with the queue.
+    void Shutdown()
+    {
+        {
+            std::lock_guard lock{ _mutex };
+            _shutdown = true;
+        }
+        _cv.notify_all();
+    }
+
+    size_t Size() const
+    {
+        std::lock_guard lock{ _mutex };
+        return _size;
+    }
+
+    FrameStatistics& Statistics() noexcept { return _statistics; }
+    const FrameStatistics& Statistics() const noexcept { return _statistics; }
+
+private:
+    const FrameDropPolicy _policy;
+    mutable std::mutex _mutex;
+    std::condition_variable _cv;
+    std::array<std::optional<Entry>, Capacity> _entries;
+    size_t _head = 0;
+    size_t _size = 0;
+    bool _shutdown = false;
+    FrameStatistics _statistics;
+};
@@ -0,0 +1,508 @@
+#include "OverlayFrameConversion.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define OVERLAY_FRAME_SSE2
+#endif
+
+namespace
+{
+    // Integer BT.601 limited range equations, see "Converting RGB888 to YUV 4:4:4" in the Media Foundation docs
+    inline uint8_t Luma(const int r, const int g, const int b) noexcept
+    {
+        return static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+    }
+
+    inline uint8_t Cb(const int r, const int g, const int b) noexcept
+    {
+        return static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+    }
+
+    inline uint8_t Cr(const int r, const int g, const int b) noexcept
+    {
+        return static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+    }
+
+    inline uint8_t Average(const int a, const int b) noexcept
+    {
+        return static_cast<uint8_t>((a + b + 1) >> 1);
+    }
+
+    // Writes YUY2 pixel pairs [firstPixel, width) of a row. firstPixel must be even.
+    void ConvertRowToYUY2(const uint8_t* row, const uint32_t width, const uint32_t firstPixel, uint8_t* out) noexcept
+    {
+        for (uint32_t x = firstPixel; x < width; x += 2)
+        {
+            const uint8_t* p0 = row + x * 3;
+            const uint8_t* p1 = row + std::min(x + 1, width - 1) * 3;
+            const int b = (p0[0] + p1[0] + 1) >> 1;
+            const int g = (p0[1] + p1[1] + 1) >> 1;
+            const int r = (p0[2] + p1[2] + 1) >> 1;
+
+            uint8_t* pair = out + x * 2;
+            pair[0] = Luma(p0[2], p0[1], p0[0]);
+            pair[1] = Cb(r, g, b);
+            pair[2] = Luma(p1[2], p1[1], p1[0]);
+            pair[3] = Cr(r, g, b);
+        }
+    }
+
+    // Writes NV12 luma of two rows and their shared chroma for pixels [firstPixel, width). firstPixel must be even.
+    void ConvertRowPairToNV12(const uint8_t* row0,
+                              const uint8_t* row1,
+                              const uint32_t width,
+                              const uint32_t firstPixel,
+                              uint8_t* luma0,
+                              uint8_t* luma1,
+                              uint8_t* chroma) noexcept
+    {
+        for (uint32_t x = firstPixel; x < width; x += 2)
+        {
+            const uint32_t x1 = std::min(x + 1, width - 1);
+            const uint8_t* p00 = row0 + x * 3;
+            const uint8_t* p01 = row0 + x1 * 3;
+            const uint8_t* p10 = row1 + x * 3;
+            const uint8_t* p11 = row1 + x1 * 3;
+
+            luma0[x] = Luma(p00[2], p00[1], p00[0]);
+            luma1[x] = Luma(p10[2], p10[1], p10[0]);
+            if (x1 != x)
+            {
+                luma0[x1] = Luma(p01[2], p01[1], p01[0]);
+                luma1[x1] = Luma(p11[2], p11[1], p11[0]);
+            }
+
+            const int b = (p00[0] + p01[0] + p10[0] + p11[0] + 2) >> 2;
+            const int g = (p00[1] + p01[1] + p10[1] + p11[1] + 2) >> 2;
+            const int r = (p00[2] + p01[2] + p10[2] + p11[2] + 2) >> 2;
+            chroma[x] = Cb(r, g, b);
+            chroma[x + 1] = Cr(r, g, b);
+        }
+    }
+
+    size_t NV12ChromaStride(const uint32_t width) noexcept
+    {
+        return (static_cast<size_t>(width) + 1) / 2 * 2;
+    }
+
+#if defined(OVERLAY_FRAME_SSE2)
+    // 8 pixels with one color channel per 16-bit lane
+    struct Channels
+    {
+        __m128i r;
+        __m128i g;
+        __m128i b;
+    };
+
+    // All products and sums fit into 16 bits as unsigned values, so wrapping 16-bit arithmetic is exact
+    inline __m128i Luma8(const Channels& c) noexcept
+    {
+        __m128i sum = _mm_add_epi16(_mm_mullo_epi16(c.r, _mm_set1_epi16(66)), _mm_mullo_epi16(c.g, _mm_set1_epi16(129)));
+        sum = _mm_add_epi16(sum, _mm_mullo_epi16(c.b, _mm_set1_epi16(25)));
+        sum = _mm_add_epi16(sum, _mm_set1_epi16(128));
+        return _mm_add_epi16(_mm_srli_epi16(sum, 8), _mm_set1_epi16(16));
+    }
+
+    // Chroma sums are within [-28432, 28688], so they fit into signed 16 bits and the arithmetic shift floors them
+    // the same way as the scalar equations
+    inline __m128i Cb8(const Channels& c) noexcept
+    {
+        __m128i sum = _mm_sub_epi16(_mm_mullo_epi16(c.b, _mm_set1_epi16(112)), _mm_mullo_epi16(c.r, _mm_set1_epi16(38)));
+        sum = _mm_sub_epi16(sum, _mm_mullo_epi16(c.g, _mm_set1_epi16(74)));
+        sum = _mm_add_epi16(sum, _mm_set1_epi16(128));
+        return _mm_add_epi16(_mm_srai_epi16(sum, 8), _mm_set1_epi16(128));
+    }
+
+    inline __m128i Cr8(const Channels& c) noexcept
+    {
+        __m128i sum = _mm_sub_epi16(_mm_mullo_epi16(c.r, _mm_set1_epi16(112)), _mm_mullo_epi16(c.g, _mm_set1_epi16(94)));
+        sum = _mm_sub_epi16(sum, _mm_mullo_epi16(c.b, _mm_set1_epi16(18)));
+        sum = _mm_add_epi16(sum, _mm_set1_epi16(128));
+        return _mm_add_epi16(_mm_srai_epi16(sum, 8), _mm_set1_epi16(128));
+    }
+
+    // SSE2 has no byte shuffles, so 24-bit pixels are spread into 16-bit lanes one by one
+    struct alignas(16) PixelBlock
+    {
+        int16_t r[16];
+        int16_t g[16];
+        int16_t b[16];
+
+        void Load(const uint8_t* pixels) noexcept
+        {
+            for (int i = 0; i < 16; ++i)
+            {
+                b[i] = pixels[i * 3];
+                g[i] = pixels[i * 3 + 1];
+                r[i] = pixels[i * 3 + 2];
+            }
+        }
+
+        Channels Half(const int half) const noexcept
+        {
+            return { _mm_load_si128(reinterpret_cast<const __m128i*>(r + half * 8)),
+                     _mm_load_si128(reinterpret_cast<const __m128i*>(g + half * 8)),
+                     _mm_load_si128(reinterpret_cast<const __m128i*>(b + half * 8)) };
+        }
+
+        __m128i Luma16() const noexcept
+        {
+            return _mm_packus_epi16(Luma8(Half(0)), Luma8(Half(1)));
+        }
+    };
+
+    // Average colors of horizontally adjacent pixel pairs of a block
+    inline Channels PairAverages(const PixelBlock& block) noexcept
+    {
+        alignas(16) int16_t r[8], g[8], b[8];
+        for (int i = 0; i < 8; ++i)
+        {
+            r[i] = static_cast<int16_t>((block.r[i * 2] + block.r[i * 2 + 1] + 1) >> 1);
+            g[i] = static_cast<int16_t>((block.g[i * 2] + block.g[i * 2 + 1] + 1) >> 1);
+            b[i] = static_cast<int16_t>((block.b[i * 2] + block.b[i * 2 + 1] + 1) >> 1);
+        }
+        return { _mm_load_si128(reinterpret_cast<const __m128i*>(r)),
+                 _mm_load_si128(reinterpret_cast<const __m128i*>(g)),
+                 _mm_load_si128(reinterpret_cast<const __m128i*>(b)) };
+    }
+
+    // Average colors of the 2x2 pixel quads of two blocks
+    inline Channels QuadAverages(const PixelBlock& top, const PixelBlock& bottom) noexcept
+    {
+        alignas(16) int16_t r[8], g[8], b[8];
+        for (int i = 0; i < 8; ++i)
+        {
+            r[i] = static_cast<int16_t>((top.r[i * 2] + top.r[i * 2 + 1] + bottom.r[i * 2] + bottom.r[i * 2 + 1] + 2) >> 2);
+            g[i] = static_cast<int16_t>((top.g[i * 2] + top.g[i * 2 + 1] + bottom.g[i * 2] + bottom.g[i * 2 + 1] + 2) >> 2);
+            b[i] = static_cast<int16_t>((top.b[i * 2] + top.b[i * 2 + 1] + bottom.b[i * 2] + bottom.b[i * 2 + 1] + 2) >> 2);
+        }
+        return { _mm_load_si128(reinterpret_cast<const __m128i*>(r)),
+                 _mm_load_si128(reinterpret_cast<const __m128i*>(g)),
+                 _mm_load_si128(reinterpret_cast<const __m128i*>(b)) };
+    }
+
+    // Interleaved U V bytes for 8 chroma samples
+    inline __m128i ChromaPairs(const Channels& c) noexcept
+    {
+        const __m128i cb = _mm_packus_epi16(Cb8(c), _mm_setzero_si128());
+        const __m128i cr = _mm_packus_epi16(Cr8(c), _mm_setzero_si128());
+        return _mm_unpacklo_epi8(cb, cr);
+    }
+
+    // Returns the first pixel which hasn't been converted
+    uint32_t ConvertRowToYUY2Vectorized(const uint8_t* row, const uint32_t width, uint8_t* out) noexcept
+    {
+        PixelBlock block;
+        uint32_t x = 0;
+        for (; x + 16 <= width; x += 16)
+        {
+            block.Load(row + x * 3);
+            const __m128i luma = block.Luma16();
+            const __m128i chroma = ChromaPairs(PairAverages(block));
+            // Y0 U0 Y1 V0 Y2 U1 Y3 V1 ...
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 2), _mm_unpacklo_epi8(luma, chroma));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 2 + 16), _mm_unpackhi_epi8(luma, chroma));
+        }
+        return x;
+    }
+
+    uint32_t ConvertRowPairToNV12Vectorized(const uint8_t* row0,
+                                            const uint8_t* row1,
+                                            const uint32_t width,
+                                            uint8_t* luma0,
+                                            uint8_t* luma1,
+                                            uint8_t* chroma) noexcept
+    {
+        PixelBlock top, bottom;
+        uint32_t x = 0;
+        for (; x + 16 <= width; x += 16)
+        {
+            top.Load(row0 + x * 3);
+            bottom.Load(row1 + x * 3);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(luma0 + x), top.Luma16());
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(luma1 + x), bottom.Luma16());
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(chroma + x), ChromaPairs(QuadAverages(top, bottom)));
+        }
+        return x;
+    }
+
+    // Averages every byte of two rows, rounding up like the scalar Average
+    size_t AverageRowsVectorized(const uint8_t* row0, const uint8_t* row1, const size_t bytes, uint8_t* out) noexcept
+    {
+        size_t i = 0;
+        for (; i + 16 <= bytes; i += 16)
+        {
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + i));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_avg_epu8(a, b));
+        }
+        return i;
+    }
+
+    // Blends every byte of two rows with 8-bit weights. (a * (256 - w) + b * w + 128) never exceeds 65408, so
+    // 16-bit lanes are enough.
+    size_t BlendRowsVectorized(const uint8_t* row0, const uint8_t* row1, const size_t bytes, const int weight, uint8_t* out) noexcept
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i w0 = _mm_set1_epi16(static_cast<short>(256 - weight));
+        const __m128i w1 = _mm_set1_epi16(static_cast<short>(weight));
+        const __m128i rounding = _mm_set1_epi16(128);
+        size_t i = 0;
+        for (; i + 16 <= bytes; i += 16)
+        {
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + i));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + i));
+            __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), w0), _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), w1));
+            __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), w0), _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), w1));
+            lo = _mm_srli_epi16(_mm_add_epi16(lo, rounding), 8);
+            hi = _mm_srli_epi16(_mm_add_epi16(hi, rounding), 8);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(lo, hi));
+        }
+        return i;
+    }
+#endif
+
+    template<bool Vectorized>
+    void ConvertToYUY2(const BGR24Image& image, uint8_t* frame) noexcept
+    {
+        const size_t frameStride = (static_cast<size_t>(image.width) + 1) / 2 * 4;
+        for (uint32_t y = 0; y < image.height; ++y)
+        {
+            const uint8_t* row = image.pixels.data() + y * image.Stride();
+            uint8_t* out = frame + y * frameStride;
+            uint32_t firstPixel = 0;
+#if defined(OVERLAY_FRAME_SSE2)
+            if constexpr (Vectorized)
+            {
+                firstPixel = ConvertRowToYUY2Vectorized(row, image.width, out);
+            }
+#endif
+            ConvertRowToYUY2(row, image.width, firstPixel, out);
+        }
+    }
+
+    template<bool Vectorized>
+    void ConvertToNV12(const BGR24Image& image, uint8_t* frame) noexcept
+    {
+        const size_t lumaStride = image.width;
+        uint8_t* chromaPlane = frame + lumaStride * image.height;
+        for (uint32_t y = 0; y < image.height; y += 2)
+        {
+            const uint32_t y1 = std::min(y + 1, image.height - 1);
+            const uint8_t* row0 = image.pixels.data() + y * image.Stride();
+            const uint8_t* row1 = image.pixels.data() + y1 * image.Stride();
+            uint8_t* luma0 = frame + y * lumaStride;
+            // The luma of the missing last row of odd heights is written twice, to the same place
+            uint8_t* luma1 = frame + y1 * lumaStride;
+            uint8_t* chroma = chromaPlane + (y / 2) * NV12ChromaStride(image.width);
+            uint32_t firstPixel = 0;
+#if defined(OVERLAY_FRAME_SSE2)
+            if constexpr (Vectorized)
+            {
+                firstPixel = ConvertRowPairToNV12Vectorized(row0, row1, image.width, luma0, luma1, chroma);
+            }
+#endif
+            ConvertRowPairToNV12(row0, row1, image.width, firstPixel, luma0, luma1, chroma);
+        }
+    }
+
+    template<bool Vectorized>
+    BGR24Image Halve(const BGR24Image& image)
+    {
+        BGR24Image result;
+        result.width = image.width / 2;
+        result.height = image.height / 2;
+        result.pixels.resize(result.Stride() * result.height);
+
+        // Rows are averaged first, then horizontally adjacent pixels of the averaged row
+        std::vector<uint8_t> averagedRow(static_cast<size_t>(result.width) * 6);
+        for (uint32_t y = 0; y < result.height; ++y)
+        {
+            const uint8_t* row0 = image.pixels.data() + (y * 2) * image.Stride();
+            const uint8_t* row1 = row0 + image.Stride();
+            size_t i = 0;
+#if defined(OVERLAY_FRAME_SSE2)
+            if constexpr (Vectorized)
+            {
+                i = AverageRowsVectorized(row0, row1, averagedRow.size(), averagedRow.data());
+            }
+#endif
+            for (; i < averagedRow.size(); ++i)
+            {
+                averagedRow[i] = Average(row0[i], row1[i]);
+            }
+
+            uint8_t* out = result.pixels.data() + y * result.Stride();
+            for (uint32_t x = 0; x < result.width; ++x)
+            {
+                for (uint32_t c = 0; c < 3; ++c)
+                {
+                    out[x * 3 + c] = Average(averagedRow[x * 6 + c], averagedRow[x * 6 + 3 + c]);
+                }
+            }
+        }
+        return result;
+    }
+
+    // Source position of a target pixel center in 1/256 pixel units, clamped to the image
+    struct Sample
+    {
+        uint32_t first;
+        uint32_t second;
+        int weight;
+    };
+
+    std::vector<Sample> BilinearSamples(const uint32_t sourceSize, const uint32_t targetSize)
+    {
+        std::vector<Sample> samples(targetSize);
+        const int64_t maxPosition = static_cast<int64_t>(sourceSize - 1) * 256;
+        for (uint32_t i = 0; i < targetSize; ++i)
+        {
+            const int64_t position = (static_cast<int64_t>(2 * i + 1) * sourceSize * 256) / (2 * static_cast<int64_t>(targetSize)) - 128;
+            const int64_t clamped = std::clamp<int64_t>(position, 0, maxPosition);
+            const auto first = static_cast<uint32_t>(clamped >> 8);
+            samples[i] = { first, std::min(first + 1, sourceSize - 1), static_cast<int>(clamped & 255) };
+        }
+        return samples;
+    }
+
+    template<bool Vectorized>
+    BGR24Image Bilinear(const BGR24Image& image, const uint32_t width, const uint32_t height)
+    {
+        BGR24Image result;
+        result.width = width;
+        result.height = height;
+        result.pixels.resize(result.Stride() * height);
+
+        const auto columns = BilinearSamples(image.width, width);
+        const auto rows = BilinearSamples(image.height, height);
+        std::vector<uint8_t> blendedRow(image.Stride());
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            const uint8_t* row0 = image.pixels.data() + rows[y].first * image.Stride();
+            const uint8_t* row1 = image.pixels.data() + rows[y].second * image.Stride();
+            const int weight = rows[y].weight;
+            size_t i = 0;
+#if defined(OVERLAY_FRAME_SSE2)
+            if constexpr (Vectorized)
+            {
+                i = BlendRowsVectorized(row0, row1, blendedRow.size(), weight, blendedRow.data());
+            }
+#endif
+            for (; i < blendedRow.size(); ++i)
+            {
+                blendedRow[i] = static_cast<uint8_t>((row0[i] * (256 - weight) + row1[i] * weight + 128) >> 8);
+            }
+
+            uint8_t* out = result.pixels.data() + y * result.Stride();
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                const uint8_t* p0 = blendedRow.data() + columns[x].first * 3;
+                const uint8_t* p1 = blendedRow.data() + columns[x].second * 3;
+                const int w = columns[x].weight;
+                for (uint32_t c = 0; c < 3; ++c)
+                {
+                    out[x * 3 + c] = static_cast<uint8_t>((p0[c] * (256 - w) + p1[c] * w + 128) >> 8);
+                }
+            }
+        }
+        return result;
+    }
+
+    template<bool Vectorized>
+    BGR24Image Scale(const BGR24Image& image, const uint32_t width, const uint32_t height)
+    {
+        if (image.Empty() || !width || !height)
+        {
+            return {};
+        }
+
+        // Bilinear filtering only looks at 2x2 source pixels, so large images are box filtered down first
+        if (image.width < width * 2ull || image.height < height * 2ull)
+        {
+            return Bilinear<Vectorized>(image, width, height);
+        }
+
+        BGR24Image reduced = Halve<Vectorized>(image);
+        while (reduced.width >= width * 2ull && reduced.height >= height * 2ull)
+        {
+            reduced = Halve<Vectorized>(reduced);
+        }
+        return Bilinear<Vectorized>(reduced, width, height);
+    }
+}
+
+size_t OverlayFrameSize(const OverlayPixelFormat format, const uint32_t width, const uint32_t height) noexcept
+{
+    switch (format)
+    {
+    case OverlayPixelFormat::RGB24:
+        return static_cast<size_t>(width) * height * 3;
+    case OverlayPixelFormat::YUY2:
+        return (static_cast<size_t>(width) + 1) / 2 * 4 * height;
+    case OverlayPixelFormat::NV12:
+        return static_cast<size_t>(width) * height + NV12ChromaStride(width) * ((static_cast<size_t>(height) + 1) / 2);
+    }
+    return 0;
+}
+
+BGR24Image ScaleBGR24(const BGR24Image& image, const uint32_t width, const uint32_t height)
+{
+    return Scale<true>(image, width, height);
+}
+
+void ConvertBGR24ToYUY2(const BGR24Image& image, uint8_t* frame) noexcept
+{
+    ConvertToYUY2<true>(image, frame);
+}
+
+void ConvertBGR24ToNV12(const BGR24Image& image, uint8_t* frame) noexcept
+{
+    ConvertToNV12<true>(image, frame);
+}
+
+std::vector<uint8_t> RenderOverlayFrame(const BGR24Image& image, const OverlayPixelFormat format, const uint32_t width, const uint32_t height)
+{
+    if (image.Empty() || !width || !height)
+    {
+        return {};
+    }
+
+    BGR24Image scaled = image.width == width && image.height == height ? image : ScaleBGR24(image, width, height);
+    if (format == OverlayPixelFormat::RGB24)
+    {
+        return std::move(scaled.pixels);
+    }
+
+    std::vector<uint8_t> frame(OverlayFrameSize(format, width, height));
+    if (format == OverlayPixelFormat::YUY2)
+    {
+        ConvertBGR24ToYUY2(scaled, frame.data());
+    }
+    else
+    {
+        ConvertBGR24ToNV12(scaled, frame.data());
+    }
+    return frame;
+}
+
+namespace OverlayFrameReference
+{
+    BGR24Image ScaleBGR24(const BGR24Image& image, const uint32_t width, const uint32_t height)
+    {
+        return Scale<false>(image, width, height);
+    }
+
+    void ConvertBGR24ToYUY2(const BGR24Image& image, uint8_t* frame) noexcept
+    {
+        ConvertToYUY2<false>(image, frame);
+    }
+
+    void ConvertBGR24ToNV12(const BGR24Image& image, uint8_t* frame) noexcept
+    {
+        ConvertToNV12<false>(image, frame);
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Uncompressed frame layouts the overlay image can be rendered to
+enum class OverlayPixelFormat
+{
+    // Top-down rows of B, G, R bytes, same as the image decoder output
+    RGB24,
+    // Packed Y0 U Y1 V, one chroma pair per two pixels
+    YUY2,
+    // Full resolution Y plane followed by an interleaved UV plane with one chroma pair per 2x2 block
+    NV12,
+};
+
+// Top-down, tightly packed image with 3 bytes per pixel in B, G, R order
+struct BGR24Image
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> pixels;
+
+    size_t Stride() const noexcept { return static_cast<size_t>(width) * 3; }
+    bool Empty() const noexcept { return !width || !height; }
+};
+
+// Size of a tightly packed frame with the given format and dimensions
+size_t OverlayFrameSize(OverlayPixelFormat format, uint32_t width, uint32_t height) noexcept;
+
+// Scales image to the given size: 2x2 box filtering while it's at least twice as large as the target, bilinear after that
+BGR24Image ScaleBGR24(const BGR24Image& image, uint32_t width, uint32_t height);
+
+// Converts with the integer BT.601 limited range equations. Chroma is computed from the rounded average color of
+// the pixels sharing it. Odd widths and heights reuse the last column or row.
+void ConvertBGR24ToYUY2(const BGR24Image& image, uint8_t* frame) noexcept;
+void ConvertBGR24ToNV12(const BGR24Image& image, uint8_t* frame) noexcept;
+
+// Scales the image to the frame size and converts it to format. Returns a buffer ready to be copied into frames.
+std::vector<uint8_t> RenderOverlayFrame(const BGR24Image& image, OverlayPixelFormat format, uint32_t width, uint32_t height);
+
+// Straightforward implementations of the same operations. The vectorized ones produce exactly the same output.
+namespace OverlayFrameReference
+{
+    BGR24Image ScaleBGR24(const BGR24Image& image, uint32_t width, uint32_t height);
+    void ConvertBGR24ToYUY2(const BGR24Image& image, uint8_t* frame) noexcept;
+    void ConvertBGR24ToNV12(const BGR24Image& image, uint8_t* frame) noexcept;
+}
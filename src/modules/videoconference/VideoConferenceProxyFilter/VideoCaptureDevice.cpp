@@ -422,7 +422,8 @@ std::optional<VideoStreamFormat> SelectBestMediaType(wil::com_ptr_nothrow<IPin>&
             continue;
         }
 
-        if (mt->subtype != MEDIASUBTYPE_YUY2 && mt->subtype != MEDIASUBTYPE_MJPG && mt->subtype != MEDIASUBTYPE_RGB24)
+        if (mt->subtype != MEDIASUBTYPE_YUY2 && mt->subtype != MEDIASUBTYPE_MJPG && mt->subtype != MEDIASUBTYPE_RGB24 &&
+            mt->subtype != MEDIASUBTYPE_NV12)
         {
             OLECHAR* guidString;
             StringFromCLSID(mt->subtype, &guidString);
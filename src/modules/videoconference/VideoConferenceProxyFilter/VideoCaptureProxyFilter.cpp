@@ -5,6 +5,7 @@
 #include <Shlwapi.h>
 #include <mfapi.h>
 #include <fstream>
+#include <limits>
 
 constexpr static inline wchar_t FILTER_NAME[] = L"PowerToysVCMProxyFilter";
 constexpr static inline wchar_t PIN_NAME[] = L"PowerToysVCMProxyPIN";
@@ -12,17 +13,7 @@ constexpr static inline wchar_t VENDOR[] = L"Microsoft Corporation";
 
 namespace
 {
-    constexpr float initialJpgQuality = 0.5f;
-    constexpr std::array<unsigned char, 3> overlayColor = { 0, 0, 0 };
-    // clang-format off
-    unsigned char bmpPixelData[58] = {
-	      0x42, 0x4D, 0x3A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x36, 0x00,
-	      0x00, 0x00, 0x28, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00,
-	      0x00, 0x00, 0x01, 0x00, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00,
-	      0x00, 0x00, 0xC4, 0x0E, 0x00, 0x00, 0xC4, 0x0E, 0x00, 0x00, 0x00, 0x00,
-	      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, overlayColor[0], overlayColor[1], overlayColor[2], 0x00
-    };
-    // clang-format on
+    constexpr std::array<uint8_t, 3> overlayColor = { 0, 0, 0 };
 }
 
 wil::com_ptr_nothrow<IMemAllocator> VideoCaptureProxyPin::FindAllocator()
@@ -36,9 +27,8 @@ wil::com_ptr_nothrow<IMemAllocator> VideoCaptureProxyPin::FindAllocator()
     return allocator;
 }
 
-wil::com_ptr_nothrow<IMFSample> LoadImageAsSample(wil::com_ptr_nothrow<IStream> imageStream,
-                                                  IMFMediaType* sampleMediaType,
-                                                  const float quality) noexcept;
+BGR24Image DecodeImage(wil::com_ptr_nothrow<IStream> imageStream);
+std::vector<uint8_t> PrepareOverlayFrame(const BGR24Image& image, IMFMediaType* frameMediaType, const size_t maxFrameSize);
 bool ReencodeJPGImage(BYTE* imageBuf, const DWORD imageSize, DWORD& reencodedSize);
 
 HRESULT VideoCaptureProxyPin::Connect(IPin* pReceivePin, const AM_MEDIA_TYPE*)
@@ -411,9 +401,9 @@ void ReencodeFrame(IMediaSample* frame)
     frame->SetActualDataLength(reencodedSize);
 }
 
-bool OverwriteFrame(IMediaSample* frame, wil::com_ptr_nothrow<IMFSample>& image)
+bool OverwriteFrame(IMediaSample* frame, const std::vector<uint8_t>& image)
 {
-    if (!image)
+    if (image.empty())
     {
         return false;
     }
@@ -426,37 +416,17 @@ bool OverwriteFrame(IMediaSample* frame, wil::com_ptr_nothrow<IMFSample>& image)
         return false;
     }
 
-    wil::com_ptr_nothrow<IMFMediaBuffer> imageBuf;
-    const DWORD frameSize = frame->GetSize();
-
-    image->GetBufferByIndex(0, &imageBuf);
-    if (!imageBuf)
-    {
-        LOG("VideoCaptureProxyPin::OverwriteFrame FAILED imageBuf");
-        return false;
-    }
-
-    BYTE* imageData = nullptr;
-    DWORD _ = 0, imageSize = 0;
-    imageBuf->Lock(&imageData, &_, &imageSize);
-    if (!imageData)
-    {
-        LOG("VideoCaptureProxyPin::OverwriteFrame FAILED imageData");
-        return false;
-    }
-
-    if (imageSize > frameSize && failed(frame->SetActualDataLength(imageSize)))
+    const long frameSize = frame->GetSize();
+    if (image.size() > static_cast<size_t>(frameSize))
     {
         char buf[512]{};
-        sprintf_s(buf, "VideoCaptureProxyPin::OverwriteFrame FAILED overlay image size %lu is larger than frame size %lu", imageSize, frameSize);
+        sprintf_s(buf, "VideoCaptureProxyPin::OverwriteFrame FAILED overlay image size %zu is larger than frame size %ld", image.size(), frameSize);
         LOG(buf);
-        imageBuf->Unlock();
         return false;
     }
 
-    std::copy(imageData, imageData + imageSize, frameData);
-    imageBuf->Unlock();
-    frame->SetActualDataLength(imageSize);
+    std::memcpy(frameData, image.data(), image.size());
+    frame->SetActualDataLength(static_cast<long>(image.size()));
 
     return true;
 }
@@ -519,32 +489,33 @@ VideoCaptureProxyFilter::VideoCaptureProxyFilter() :
     _worker_thread{
         std::thread{
             [this]() {
-                using namespace std::chrono_literals;
-                const auto uninitializedSleepInterval = 15ms;
-                std::vector<float> lowerJpgQualityModes = { 0.1f, 0.25f };
+                using clock = std::chrono::steady_clock;
+                auto& statistics = _frameQueue.Statistics();
                 while (!_shutdown_request)
                 {
-                    std::unique_lock<std::mutex> lock{ _worker_mutex };
-                    _worker_cv.wait(lock, [this] { return _pending_frame != nullptr || _shutdown_request; });
+                    // Frames which can't be delivered are released right away, returning them to the capture allocator
+                    auto entry = _frameQueue.Pop();
+                    if (!entry)
+                    {
+                        break;
+                    }
 
+                    std::unique_lock<std::mutex> lock{ _worker_mutex };
                     if (!_outPin || !_outPin->_connectedInputPin)
                     {
-                        lock.unlock();
-                        std::this_thread::sleep_for(uninitializedSleepInterval);
+                        statistics.dropped.fetch_add(1, std::memory_order_relaxed);
                         continue;
                     }
 
                     auto input = _outPin->_connectedInputPin.try_query<IMemInputPin>();
                     if (!input)
                     {
+                        statistics.dropped.fetch_add(1, std::memory_order_relaxed);
                         continue;
                     }
 
-                    IMediaSample* sample = _pending_frame;
-                    if (!sample)
-                    {
-                        continue;
-                    }
+                    IMediaSample* sample = entry->frame.get();
+                    const auto processingStart = clock::now();
 #if defined(DEBUG_FRAME_DATA)
                     static bool realFrameSaved = false;
                     if (!realFrameSaved)
@@ -553,44 +524,40 @@ VideoCaptureProxyFilter::VideoCaptureProxyFilter() :
                         realFrameSaved = true;
                     }
 #endif
-                    auto newSettings = SyncCurrentSettings();
-                    if (newSettings.webcamDisabled)
+                    const auto& newSettings = SyncCurrentSettings();
+                    if (newSettings.useOverlayImage)
                     {
 #if !defined(DEBUG_OVERWRITE_FRAME)
-                        bool overwritten = OverwriteFrame(_pending_frame, _overlayImage ? _overlayImage : _blankImage);
-                        while (!overwritten && _overlayImage)
+                        if (newSettings.overlayImageSize && _loadedOverlayImageGeneration != newSettings.overlayImageGeneration)
+                        {
+                            LOG("Loading newly posted overlay image");
+                            LoadOverlayImage();
+                        }
+
+                        bool overwritten = OverwriteFrame(sample, _overlayFrame);
+                        if (!overwritten && !_overlayFrame.empty() && _maxFrameSize > static_cast<size_t>(sample->GetSize()))
                         {
-                            _overlayImage.reset();
-                            newSettings = SyncCurrentSettings();
-                            if (!lowerJpgQualityModes.empty() && newSettings.overlayImage)
-                            {
-                                const float quality = lowerJpgQualityModes.back();
-                                lowerJpgQualityModes.pop_back();
-                                char buf[512]{};
-                                sprintf_s(buf, "Reload overlay image with quality %f", quality);
-                                LOG(buf);
-                                _overlayImage = LoadImageAsSample(newSettings.overlayImage, _targetMediaType.get(), quality);
-                                overwritten = OverwriteFrame(_pending_frame, _overlayImage);
-                            }
-                            else
-                            {
-                                LOG("Couldn't overwrite frame with image with all available quality modes.");
-                            }
+                            // Only compressed frames vary in size: prepare the image again once, so it fits into the samples
+                            // of this allocator
+                            LOG("Preparing the overlay image again for smaller frames");
+                            _maxFrameSize = sample->GetSize();
+                            _overlayFrame = PrepareOverlayFrame(_overlayImage, _targetMediaType.get(), _maxFrameSize);
+                            overwritten = OverwriteFrame(sample, _overlayFrame);
                         }
 #if defined(DEBUG_FRAME_DATA)
                         static bool overlayFrameSaved = false;
-                        if (!overlayFrameSaved && _overlayImage && overwritten)
+                        if (!overlayFrameSaved && overwritten)
                         {
                             DumpSample(sample, "PowerToysVCMOverlayImageFrame.binary");
                             overlayFrameSaved = true;
                         }
 #endif
-                        if (!overwritten && !_overlayImage)
+                        if (!overwritten)
                         {
-                            OverwriteFrame(_pending_frame, _blankImage);
+                            OverwriteFrame(sample, _blankFrame);
                         }
 #else
-                        DebugOverwriteFrame(_pending_frame, "R:\\frame.data");
+                        DebugOverwriteFrame(sample, "R:\\frame.data");
 #endif
                     }
 #if defined(DEBUG_REENCODE_JPG_DATA)
@@ -600,14 +567,16 @@ VideoCaptureProxyFilter::VideoCaptureProxyFilter() :
                         _targetMediaType->GetGUID(MF_MT_SUBTYPE, &subtype);
                         if (subtype == MFVideoFormat_MJPG)
                         {
-                            ReencodeFrame(_pending_frame);
+                            ReencodeFrame(sample);
                         }
                     }
 #endif
 
-                    _pending_frame = nullptr;
+                    const auto deliveryStart = clock::now();
+                    statistics.processing.Add(deliveryStart - processingStart);
                     input->Receive(sample);
-                    sample->Release();
+                    statistics.delivery.Add(clock::now() - deliveryStart);
+                    statistics.processed.fetch_add(1, std::memory_order_relaxed);
                 }
             } }
     }
@@ -698,6 +667,10 @@ GUID MapDShowSubtypeToMFT(const GUID& dshowSubtype)
     {
         return MFVideoFormat_RGB24;
     }
+    else if (dshowSubtype == MEDIASUBTYPE_NV12)
+    {
+        return MFVideoFormat_NV12;
+    }
     else
     {
         LOG("MapDShowSubtypeToMFT: Unsupported media type format provided!");
@@ -705,6 +678,17 @@ GUID MapDShowSubtypeToMFT(const GUID& dshowSubtype)
     }
 }
 
+// Frames of uncompressed formats have a fixed size, the size of compressed ones is only known once samples arrive
+size_t MaxFrameSize(const AM_MEDIA_TYPE* mediaType)
+{
+    size_t maxFrameSize = mediaType->lSampleSize;
+    if (mediaType->formattype == FORMAT_VideoInfo && mediaType->pbFormat)
+    {
+        maxFrameSize = std::max<size_t>(maxFrameSize, reinterpret_cast<const VIDEOINFOHEADER*>(mediaType->pbFormat)->bmiHeader.biSizeImage);
+    }
+    return maxFrameSize ? maxFrameSize : std::numeric_limits<size_t>::max();
+}
+
 HRESULT VideoCaptureProxyFilter::EnumPins(IEnumPins** ppEnum)
 {
     if (!ppEnum)
@@ -724,7 +708,8 @@ HRESULT VideoCaptureProxyFilter::EnumPins(IEnumPins** ppEnum)
     if (!_outPin)
     {
         LOG("VideoCaptureProxyFilter::EnumPins started pin initialization");
-        const auto newSettings = SyncCurrentSettings();
+        const auto& newSettings = SyncCurrentSettings();
+        const std::wstring newCameraName = newSettings.sourceCameraName ? newSettings.sourceCameraName->data() : L"";
         std::vector<VideoCaptureDeviceInfo> webcams;
         webcams = VideoCaptureDevice::ListAll();
         if (webcams.empty())
@@ -736,7 +721,7 @@ HRESULT VideoCaptureProxyFilter::EnumPins(IEnumPins** ppEnum)
         std::optional<size_t> selectedCamIdx;
         for (size_t i = 0; i < size(webcams); ++i)
         {
-            if (newSettings.newCameraName == webcams[i].friendlyName)
+            if (newCameraName == webcams[i].friendlyName)
             {
                 selectedCamIdx = i;
                 LOG("VideoCaptureProxyFilter::EnumPins webcam selected using settings");
@@ -748,7 +733,7 @@ HRESULT VideoCaptureProxyFilter::EnumPins(IEnumPins** ppEnum)
         {
             for (size_t i = 0; i < size(webcams); ++i)
             {
-                if (newSettings.newCameraName != CAMERA_NAME)
+                if (newCameraName != CAMERA_NAME)
                 {
                     LOG("VideoCaptureProxyFilter::EnumPins webcam selected using first fit");
                     selectedCamIdx = i;
@@ -769,11 +754,9 @@ HRESULT VideoCaptureProxyFilter::EnumPins(IEnumPins** ppEnum)
         pin->_owningFilter = this;
         _outPin.attach(pin.detach());
 
+        // Never blocks on the worker: if it falls behind, the oldest queued frame is dropped and released
         auto frameCallback = [this](IMediaSample* sample) {
-            std::unique_lock<std::mutex> lock{ _worker_mutex };
-            sample->AddRef();
-            _pending_frame = sample;
-            _worker_cv.notify_one();
+            _frameQueue.Push(wil::com_ptr_nothrow<IMediaSample>{ sample });
         };
 
         _targetMediaType.reset();
@@ -789,13 +772,10 @@ HRESULT VideoCaptureProxyFilter::EnumPins(IEnumPins** ppEnum)
         _captureDevice = VideoCaptureDevice::Create(std::move(webcam), std::move(frameCallback));
         if (_captureDevice)
         {
-            if (!_blankImage)
-            {
-                wil::com_ptr_nothrow<IStream> blackBMPImage = SHCreateMemStream(bmpPixelData, sizeof(bmpPixelData));
-                _blankImage = LoadImageAsSample(blackBMPImage, _targetMediaType.get(), initialJpgQuality);
-            }
-
-            _overlayImage = LoadImageAsSample(newSettings.overlayImage, _targetMediaType.get(), initialJpgQuality);
+            // Overlay frames are prepared once for the negotiated format, so overwriting a frame is a single copy
+            _maxFrameSize = MaxFrameSize(_outPin->_mediaFormat.get());
+            _blankFrame = PrepareOverlayFrame(BGR24Image{ 1, 1, { begin(overlayColor), end(overlayColor) } }, _targetMediaType.get(), _maxFrameSize);
+            LoadOverlayImage();
             LOG("VideoCaptureProxyFilter::EnumPins capture device created successfully");
         }
         else
@@ -867,71 +847,80 @@ VideoCaptureProxyFilter::~VideoCaptureProxyFilter()
     VERBOSE_LOG;
     _shutdown_request = true;
 
-    _worker_cv.notify_one();
+    _frameQueue.Shutdown();
     _worker_thread.join();
+    LOG("VideoCaptureProxyFilter statistics: " + _frameQueue.Statistics().ToString());
     if (_settingsUpdateChannel)
     {
-        _settingsUpdateChannel->access([](auto settingsMemory) {
-            auto settings = reinterpret_cast<CameraSettingsUpdateChannel*>(settingsMemory._data);
-            settings->cameraInUse = false;
-        });
+        auto channel = reinterpret_cast<CameraSettingsUpdateChannel*>(_settingsUpdateChannel->unserialized_memory()._data);
+        channel->cameraInUse.store(false, std::memory_order_release);
     }
 }
 
-VideoCaptureProxyFilter::SyncedSettings VideoCaptureProxyFilter::SyncCurrentSettings()
+const CameraSettingsUpdateChannel::Settings& VideoCaptureProxyFilter::SyncCurrentSettings()
 {
-    SyncedSettings result;
     if (!_settingsUpdateChannel.has_value())
     {
         _settingsUpdateChannel = SerializedSharedMemory::open(CameraSettingsUpdateChannel::endpoint(), sizeof(CameraSettingsUpdateChannel), false);
+        if (!_settingsUpdateChannel)
+        {
+            return _syncedSettings;
+        }
+
+        auto channel = reinterpret_cast<CameraSettingsUpdateChannel*>(_settingsUpdateChannel->unserialized_memory()._data);
+        if (channel->layoutVersion != CameraSettingsUpdateChannel::currentLayoutVersion)
+        {
+            LOG("VideoCaptureProxyFilter::SyncCurrentSettings settings channel layout version mismatch");
+            _settingsUpdateChannel.reset();
+            return _syncedSettings;
+        }
     }
 
-    if (!_settingsUpdateChannel)
+    // The channel isn't locked: this is called for every frame, and the module must never stall the camera pipeline.
+    // If nothing has changed, it's a single atomic load. If the module is in the middle of a write, we keep the
+    // previous settings and pick up the new ones with the next frame.
+    auto channel = reinterpret_cast<CameraSettingsUpdateChannel*>(_settingsUpdateChannel->unserialized_memory()._data);
+    if (channel->tryRead(_syncedSettingsGeneration, _syncedSettings))
     {
-        return result;
+        // A restarted module creates the channel with cameraInUse cleared
+        if (!channel->cameraInUse.load(std::memory_order_relaxed))
+        {
+            channel->cameraInUse.store(true, std::memory_order_release);
+        }
     }
 
-    _settingsUpdateChannel->access([this, &result](auto settingsMemory) {
-        auto settings = reinterpret_cast<CameraSettingsUpdateChannel*>(settingsMemory._data);
-        bool cameraNameUpdated = false;
-        result.webcamDisabled = settings->useOverlayImage;
+    return _syncedSettings;
+}
 
-        settings->cameraInUse = true;
+void VideoCaptureProxyFilter::LoadOverlayImage()
+{
+    _overlayImage = DecodeImage(LoadOverlayImageStream());
+    _overlayFrame = PrepareOverlayFrame(_overlayImage, _targetMediaType.get(), _maxFrameSize);
+}
 
-        if (settings->sourceCameraName.has_value())
-        {
-            std::wstring_view newCameraNameView{ settings->sourceCameraName->data() };
-            if (!_currentSourceCameraName.has_value() || *_currentSourceCameraName != newCameraNameView)
-            {
-                cameraNameUpdated = true;
-                result.newCameraName = newCameraNameView;
-            }
-        }
+wil::com_ptr_nothrow<IStream> VideoCaptureProxyFilter::LoadOverlayImageStream()
+{
+    const auto& settings = SyncCurrentSettings();
+    if (!settings.overlayImageSize.has_value())
+    {
+        return nullptr;
+    }
 
-        if (!settings->overlayImageSize.has_value())
-        {
-            return;
-        }
+    auto imageChannel = SerializedSharedMemory::open(CameraOverlayImageChannel::endpoint(), *settings.overlayImageSize, true);
+    if (!imageChannel)
+    {
+        return nullptr;
+    }
 
-        if (settings->newOverlayImagePosted || !_overlayImage)
-        {
-            auto imageChannel =
-                SerializedSharedMemory::open(CameraOverlayImageChannel::endpoint(), *settings->overlayImageSize, true);
-            if (!imageChannel)
-            {
-                return;
-            }
+    wil::com_ptr_nothrow<IStream> result;
+    imageChannel->access([&result](auto imageMemory) {
+        result.attach(SHCreateMemStream(imageMemory._data, static_cast<UINT>(imageMemory._size)));
+    });
 
-            imageChannel->access([this, settings, &result](auto imageMemory) {
-                result.overlayImage = SHCreateMemStream(imageMemory._data, static_cast<UINT>(imageMemory._size));
-                if (!result.overlayImage)
-                {
-                    return;
-                }
+    if (result)
+    {
+        _loadedOverlayImageGeneration = settings.overlayImageGeneration;
+    }
 
-                settings->newOverlayImagePosted = false;
-            });
-        }
-    });
     return result;
 }
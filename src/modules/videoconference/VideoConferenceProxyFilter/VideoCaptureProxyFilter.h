@@ -13,6 +13,8 @@
 #include <CameraStateUpdateChannels.h>
 #include <SerializedSharedMemory.h>
 
+#include "FrameQueue.h"
+#include "OverlayFrameConversion.h"
 #include "VideoCaptureDevice.h"
 
 #include <mutex>
@@ -28,17 +30,28 @@ struct VideoCaptureProxyFilter : winrt::implements<VideoCaptureProxyFilter, IBas
 {
     // BLOCK START: member accessed concurrently
     wil::com_ptr_nothrow<VideoCaptureProxyPin> _outPin;
-    IMediaSample* _pending_frame = nullptr;
+    // A few frames absorb the jitter of the overlay and downstream filters without holding on to too many
+    // samples of the capture device allocator
+    static constexpr size_t frameQueueCapacity = 3;
+    FrameQueue<wil::com_ptr_nothrow<IMediaSample>, frameQueueCapacity> _frameQueue{ FrameDropPolicy::DropOldest };
     std::atomic_bool _shutdown_request = false;
     std::optional<SerializedSharedMemory> _settingsUpdateChannel;
-    std::optional<std::wstring> _currentSourceCameraName;
-    wil::com_ptr_nothrow<IMFSample> _blankImage;
-    wil::com_ptr_nothrow<IMFSample> _overlayImage;
+    // Last settings copied from the settings channel
+    CameraSettingsUpdateChannel::Settings _syncedSettings;
+    // Generation of _syncedSettings, odd until the first copy
+    uint32_t _syncedSettingsGeneration = 1;
+    // overlayImageGeneration of the image _overlayImage was loaded from
+    std::optional<uint32_t> _loadedOverlayImageGeneration;
+    // Decoded overlay image, kept to prepare _overlayFrame again for smaller frames
+    BGR24Image _overlayImage;
+    // Frames in the format of _targetMediaType, ready to be copied into samples
+    std::vector<uint8_t> _overlayFrame;
+    std::vector<uint8_t> _blankFrame;
+    size_t _maxFrameSize = 0;
     wil::com_ptr_nothrow<IMFMediaType> _targetMediaType;
     // BLOCK END: member accessed concurrently
 
     std::mutex _worker_mutex;
-    std::condition_variable _worker_cv;
 
     FILTER_STATE _state = State_Stopped;
     wil::com_ptr_nothrow<IReferenceClock> _clock;
@@ -50,14 +63,12 @@ struct VideoCaptureProxyFilter : winrt::implements<VideoCaptureProxyFilter, IBas
     VideoCaptureProxyFilter();
     ~VideoCaptureProxyFilter();
 
-    struct SyncedSettings
-    {
-        bool webcamDisabled = false;
-        std::wstring newCameraName;
-        wil::com_ptr_nothrow<IStream> overlayImage;
-    };
-
-    SyncedSettings SyncCurrentSettings();
+    // Returns the current settings. Only copies them from the channel if the module has changed them.
+    const CameraSettingsUpdateChannel::Settings& SyncCurrentSettings();
+    // Decodes the posted overlay image and prepares _overlayFrame from it
+    void LoadOverlayImage();
+    // Returns a copy of the posted overlay image
+    wil::com_ptr_nothrow<IStream> LoadOverlayImageStream();
 
     HRESULT STDMETHODCALLTYPE Stop(void) override;
     HRESULT STDMETHODCALLTYPE Pause(void) override;
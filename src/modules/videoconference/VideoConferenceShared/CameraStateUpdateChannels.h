@@ -3,20 +3,74 @@
 #include <optional>
 #include <string_view>
 #include <array>
+#include <atomic>
+#include <cstring>
 
+// Settings shared between the module and every proxy filter instance. The module is the only writer of
+// settings, so proxy filters read them without taking the SerializedSharedMemory lock: a write advances
+// generation to an odd value, changes settings and advances it to the next even value. A reader which
+// sees the same even generation before and after copying settings has a consistent copy.
+// The layout is shared by 32-bit and 64-bit processes, so it must only contain fixed size members.
 struct alignas(16) CameraSettingsUpdateChannel
 {
-    bool useOverlayImage = false;
-    bool cameraInUse = false;
+    static constexpr uint32_t currentLayoutVersion = 2;
 
-    std::optional<uint32_t> overlayImageSize;
-    std::optional<std::array<wchar_t, 256>> sourceCameraName;
+    struct Settings
+    {
+        bool useOverlayImage = false;
+        std::optional<uint32_t> overlayImageSize;
+        std::optional<std::array<wchar_t, 256>> sourceCameraName;
+        // Advanced by every overlay image post, so readers can tell a new image from the one they've loaded
+        uint32_t overlayImageGeneration = 0;
+    };
 
-    bool newOverlayImagePosted = false;
+    uint32_t layoutVersion = currentLayoutVersion;
+    std::atomic_uint32_t generation = 0;
+    // Written only by proxy filters
+    std::atomic_bool cameraInUse = false;
+    Settings settings;
+
+    // Changes settings. Writers must be serialized by the caller, e.g. with SerializedSharedMemory::access.
+    template<typename UpdateFn>
+    void update(UpdateFn&& updateFn) noexcept
+    {
+        const uint32_t current = generation.load(std::memory_order_relaxed);
+        generation.store(current + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        updateFn(settings);
+        generation.store(current + 2, std::memory_order_release);
+    }
+
+    // Copies settings if they have changed since lastGeneration and updates it. A single atomic load if nothing
+    // has changed. Never waits for a writer: returns false if a write is in progress, so the caller can retry later.
+    bool tryRead(uint32_t& lastGeneration, Settings& result) const noexcept
+    {
+        const uint32_t before = generation.load(std::memory_order_acquire);
+        if (before == lastGeneration || (before & 1))
+        {
+            return false;
+        }
+
+        Settings copy;
+        std::memcpy(&copy, &settings, sizeof(Settings));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (generation.load(std::memory_order_relaxed) != before)
+        {
+            return false;
+        }
+
+        result = copy;
+        lastGeneration = before;
+        return true;
+    }
 
     static std::wstring_view endpoint();
 };
 
+static_assert(std::atomic_uint32_t::is_always_lock_free && std::atomic_bool::is_always_lock_free,
+              "CameraSettingsUpdateChannel atomics must be usable across processes");
+static_assert(std::is_trivially_copyable_v<CameraSettingsUpdateChannel::Settings>);
+
 namespace CameraOverlayImageChannel
 {
     std::wstring_view endpoint();
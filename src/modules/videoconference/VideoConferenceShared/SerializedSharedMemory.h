@@ -34,6 +34,8 @@ public:
                                                       const bool read_only) noexcept;
 
     void access(std::function<void(memory_t)> access_routine) noexcept;
+    // Access without taking the lock, for layouts which synchronize concurrent readers themselves
+    inline memory_t unserialized_memory() const noexcept { return _memory; }
     inline size_t size() const noexcept { return _memory._size; }
 
     ~SerializedSharedMemory() noexcept;
@@ -0,0 +1,231 @@
+#include "pch.h"
+
+#include <FrameQueue.h>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace VideoConferenceUnitTests
+{
+    // Stands in for a reference counted media sample: counts the frames which haven't been released yet
+    class CountedFrame
+    {
+    public:
+        CountedFrame(const int id, std::atomic_int& liveFrames) :
+            _id{ id }, _liveFrames{ &liveFrames }
+        {
+            ++*_liveFrames;
+        }
+
+        CountedFrame(CountedFrame&& other) noexcept :
+            _id{ other._id }, _liveFrames{ std::exchange(other._liveFrames, nullptr) }
+        {
+        }
+
+        CountedFrame& operator=(CountedFrame&& other) noexcept
+        {
+            Release();
+            _id = other._id;
+            _liveFrames = std::exchange(other._liveFrames, nullptr);
+            return *this;
+        }
+
+        ~CountedFrame()
+        {
+            Release();
+        }
+
+        int Id() const { return _id; }
+
+    private:
+        int _id = 0;
+        std::atomic_int* _liveFrames = nullptr;
+
+        void Release()
+        {
+            if (_liveFrames)
+            {
+                --*_liveFrames;
+                _liveFrames = nullptr;
+            }
+        }
+    };
+
+    TEST_CLASS (FrameQueueTests)
+    {
+    public:
+        TEST_METHOD (DropOldest_KeepsFreshestFrames)
+        {
+            std::atomic_int liveFrames = 0;
+            FrameQueue<CountedFrame, 3> queue{ FrameDropPolicy::DropOldest };
+
+            std::vector<int> droppedIds;
+            for (int id = 1; id <= 5; ++id)
+            {
+                if (auto dropped = queue.Push(CountedFrame{ id, liveFrames }))
+                {
+                    droppedIds.push_back(dropped->Id());
+                }
+            }
+
+            // Dropped frames are released as soon as the caller lets go of them
+            Assert::AreEqual(3, liveFrames.load());
+            Assert::IsTrue(droppedIds == std::vector<int>{ 1, 2 });
+            for (int id = 3; id <= 5; ++id)
+            {
+                Assert::AreEqual(id, queue.Pop()->frame.Id());
+            }
+
+            Assert::AreEqual(0, liveFrames.load());
+            Assert::AreEqual<uint64_t>(5, queue.Statistics().received);
+            Assert::AreEqual<uint64_t>(2, queue.Statistics().dropped);
+            Assert::AreEqual<uint64_t>(3, queue.Statistics().queued.Count());
+        }
+
+        TEST_METHOD (DropNewest_KeepsQueuedFrames)
+        {
+            std::atomic_int liveFrames = 0;
+            FrameQueue<CountedFrame, 3> queue{ FrameDropPolicy::DropNewest };
+
+            std::vector<int> droppedIds;
+            for (int id = 1; id <= 5; ++id)
+            {
+                if (auto dropped = queue.Push(CountedFrame{ id, liveFrames }))
+                {
+                    droppedIds.push_back(dropped->Id());
+                }
+            }
+
+            Assert::IsTrue(droppedIds == std::vector<int>{ 4, 5 });
+            for (int id = 1; id <= 3; ++id)
+            {
+                Assert::AreEqual(id, queue.Pop()->frame.Id());
+            }
+
+            Assert::AreEqual(0, liveFrames.load());
+            Assert::AreEqual<uint64_t>(2, queue.Statistics().dropped);
+        }
+
+        TEST_METHOD (Shutdown_ReleasesAndRejectsFrames)
+        {
+            std::atomic_int liveFrames = 0;
+            {
+                FrameQueue<CountedFrame, 4> queue{ FrameDropPolicy::DropOldest };
+                queue.Push(CountedFrame{ 1, liveFrames });
+                queue.Push(CountedFrame{ 2, liveFrames });
+
+                std::thread consumer{ [&] {
+                    // Drains the queue, then blocks until shutdown
+                    while (queue.Pop())
+                    {
+                    }
+                } };
+
+                while (queue.Size() != 0)
+                {
+                    std::this_thread::yield();
+                }
+
+                queue.Shutdown();
+                consumer.join();
+
+                Assert::IsTrue(queue.Push(CountedFrame{ 3, liveFrames }).has_value());
+                Assert::AreEqual<uint64_t>(3, queue.Statistics().received);
+                Assert::AreEqual<uint64_t>(1, queue.Statistics().dropped);
+
+                // Frames still queued on shutdown are released with the queue
+                queue.Push(CountedFrame{ 4, liveFrames });
+            }
+
+            Assert::AreEqual(0, liveFrames.load());
+        }
+
+        TEST_METHOD (ConcurrentProducerAndSlowConsumer_AccountsForEveryFrame)
+        {
+            constexpr int frames = 20000;
+            std::atomic_int liveFrames = 0;
+            FrameQueue<CountedFrame, 3> queue{ FrameDropPolicy::DropOldest };
+
+            std::atomic_uint64_t consumed = 0;
+            std::atomic_uint64_t outOfOrder = 0;
+            std::thread consumer{ [&] {
+                int lastId = 0;
+                while (auto entry = queue.Pop())
+                {
+                    // Frames are delivered in order, even when some are dropped
+                    if (entry->frame.Id() <= lastId)
+                    {
+                        ++outOfOrder;
+                    }
+                    lastId = entry->frame.Id();
+                    ++consumed;
+                    if (lastId % 64 == 0)
+                    {
+                        std::this_thread::sleep_for(std::chrono::microseconds{ 50 });
+                    }
+                }
+            } };
+
+            for (int id = 1; id <= frames; ++id)
+            {
+                queue.Push(CountedFrame{ id, liveFrames });
+            }
+
+            while (queue.Size() != 0)
+            {
+                std::this_thread::yield();
+            }
+            queue.Shutdown();
+            consumer.join();
+
+            const auto& statistics = queue.Statistics();
+            Assert::AreEqual<uint64_t>(0, outOfOrder);
+            Assert::AreEqual<uint64_t>(frames, statistics.received);
+            Assert::AreEqual<uint64_t>(frames, consumed + statistics.dropped);
+            Assert::AreEqual(0, liveFrames.load());
+        }
+
+        // A 1080p60 camera with a worker which copies every YUY2 frame, as the overlay path does when the camera is muted
+        TEST_METHOD (Pipeline_KeepsUpWith1080p60)
+        {
+            constexpr int frames = 60;
+            constexpr auto framePeriod = std::chrono::microseconds{ 1000000 / 60 };
+            constexpr size_t frameBytes = 1920 * 1080 * 2;
+
+            std::atomic_int liveFrames = 0;
+            FrameQueue<CountedFrame, 3> queue{ FrameDropPolicy::DropOldest };
+            auto& statistics = queue.Statistics();
+
+            std::thread worker{ [&] {
+                std::vector<uint8_t> source(frameBytes, 0x80);
+                std::vector<uint8_t> target(frameBytes);
+                while (auto entry = queue.Pop())
+                {
+                    const auto start = std::chrono::steady_clock::now();
+                    std::memcpy(target.data(), source.data(), frameBytes);
+                    statistics.processing.Add(std::chrono::steady_clock::now() - start);
+                    statistics.processed.fetch_add(1);
+                }
+            } };
+
+            auto nextFrame = std::chrono::steady_clock::now();
+            for (int id = 1; id <= frames; ++id)
+            {
+                queue.Push(CountedFrame{ id, liveFrames });
+                nextFrame += framePeriod;
+                std::this_thread::sleep_until(nextFrame);
+            }
+
+            while (queue.Size() != 0)
+            {
+                std::this_thread::yield();
+            }
+            queue.Shutdown();
+            worker.join();
+
+            Logger::WriteMessage(("1080p60: " + statistics.ToString() + "\n").c_str());
+            Assert::AreEqual<uint64_t>(0, statistics.dropped);
+            Assert::AreEqual<uint64_t>(frames, statistics.processed);
+            Assert::AreEqual<uint64_t>(frames, statistics.queued.Count());
+        }
+    };
+}
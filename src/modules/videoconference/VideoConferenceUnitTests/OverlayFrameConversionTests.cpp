@@ -0,0 +1,410 @@
+#include "pch.h"
+
+#include <OverlayFrameConversion.h>
+
+#include <cmath>
+#include <random>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace VideoConferenceUnitTests
+{
+    BGR24Image SolidImage(const uint32_t width, const uint32_t height, const uint8_t r, const uint8_t g, const uint8_t b)
+    {
+        BGR24Image image{ width, height, {} };
+        for (size_t i = 0; i < static_cast<size_t>(width) * height; ++i)
+        {
+            image.pixels.insert(end(image.pixels), { b, g, r });
+        }
+        return image;
+    }
+
+    BGR24Image NoiseImage(const uint32_t width, const uint32_t height, const uint32_t seed)
+    {
+        std::mt19937 generator{ seed };
+        std::uniform_int_distribution<int> distribution{ 0, 255 };
+        BGR24Image image{ width, height, std::vector<uint8_t>(static_cast<size_t>(width) * height * 3) };
+        for (auto& byte : image.pixels)
+        {
+            byte = static_cast<uint8_t>(distribution(generator));
+        }
+        return image;
+    }
+
+    // BT.601 limited range, computed independently of the converter in floating point
+    struct ExpectedYUV
+    {
+        uint8_t y, u, v;
+    };
+
+    ExpectedYUV ExpectedColor(const double r, const double g, const double b)
+    {
+        return { static_cast<uint8_t>(std::floor((66 * r + 129 * g + 25 * b + 128) / 256) + 16),
+                 static_cast<uint8_t>(std::floor((-38 * r - 74 * g + 112 * b + 128) / 256) + 128),
+                 static_cast<uint8_t>(std::floor((112 * r - 94 * g - 18 * b + 128) / 256) + 128) };
+    }
+
+    double Channel(const BGR24Image& image, const uint32_t x, const uint32_t y, const uint32_t channel)
+    {
+        return image.pixels[(static_cast<size_t>(y) * image.width + x) * 3 + channel];
+    }
+
+    double RoundedAverage(const double a, const double b)
+    {
+        return std::floor((a + b + 1) / 2);
+    }
+
+    // YUY2 frame built pixel by pixel from the floating point equations
+    std::vector<uint8_t> GoldenYUY2(const BGR24Image& image)
+    {
+        std::vector<uint8_t> frame;
+        for (uint32_t y = 0; y < image.height; ++y)
+        {
+            for (uint32_t x = 0; x < image.width; x += 2)
+            {
+                const uint32_t x1 = std::min(x + 1, image.width - 1);
+                const auto chroma = ExpectedColor(RoundedAverage(Channel(image, x, y, 2), Channel(image, x1, y, 2)),
+                                                  RoundedAverage(Channel(image, x, y, 1), Channel(image, x1, y, 1)),
+                                                  RoundedAverage(Channel(image, x, y, 0), Channel(image, x1, y, 0)));
+                frame.push_back(ExpectedColor(Channel(image, x, y, 2), Channel(image, x, y, 1), Channel(image, x, y, 0)).y);
+                frame.push_back(chroma.u);
+                frame.push_back(ExpectedColor(Channel(image, x1, y, 2), Channel(image, x1, y, 1), Channel(image, x1, y, 0)).y);
+                frame.push_back(chroma.v);
+            }
+        }
+        return frame;
+    }
+
+    // NV12 frame built pixel by pixel from the floating point equations
+    std::vector<uint8_t> GoldenNV12(const BGR24Image& image)
+    {
+        std::vector<uint8_t> frame;
+        for (uint32_t y = 0; y < image.height; ++y)
+        {
+            for (uint32_t x = 0; x < image.width; ++x)
+            {
+                frame.push_back(ExpectedColor(Channel(image, x, y, 2), Channel(image, x, y, 1), Channel(image, x, y, 0)).y);
+            }
+        }
+
+        for (uint32_t y = 0; y < image.height; y += 2)
+        {
+            const uint32_t y1 = std::min(y + 1, image.height - 1);
+            for (uint32_t x = 0; x < image.width; x += 2)
+            {
+                const uint32_t x1 = std::min(x + 1, image.width - 1);
+                double average[3];
+                for (uint32_t c = 0; c < 3; ++c)
+                {
+                    average[c] = std::floor((Channel(image, x, y, c) + Channel(image, x1, y, c) + Channel(image, x, y1, c) + Channel(image, x1, y1, c) + 2) / 4);
+                }
+
+                const auto chroma = ExpectedColor(average[2], average[1], average[0]);
+                frame.push_back(chroma.u);
+                frame.push_back(chroma.v);
+            }
+        }
+        return frame;
+    }
+
+    // Source position of a target pixel center in 1/256 pixel units, clamped to the image
+    double GoldenSamplePosition(const uint32_t index, const uint32_t sourceSize, const uint32_t targetSize)
+    {
+        const double position = std::floor((2.0 * index + 1) * sourceSize * 256 / (2.0 * targetSize)) - 128;
+        return std::clamp(position, 0.0, (sourceSize - 1) * 256.0);
+    }
+
+    double Blend(const double a, const double b, const double weight)
+    {
+        return std::floor((a * (256 - weight) + b * weight + 128) / 256);
+    }
+
+    // Scaler output computed one target pixel at a time, without the row buffers and sample tables of the implementation
+    BGR24Image GoldenScale(const BGR24Image& image, const uint32_t width, const uint32_t height)
+    {
+        BGR24Image source = image;
+        if (source.width >= width * 2ull && source.height >= height * 2ull)
+        {
+            do
+            {
+                BGR24Image halved{ source.width / 2, source.height / 2, {} };
+                for (uint32_t y = 0; y < halved.height; ++y)
+                {
+                    for (uint32_t x = 0; x < halved.width; ++x)
+                    {
+                        for (uint32_t c = 0; c < 3; ++c)
+                        {
+                            const double left = RoundedAverage(Channel(source, 2 * x, 2 * y, c), Channel(source, 2 * x, 2 * y + 1, c));
+                            const double right = RoundedAverage(Channel(source, 2 * x + 1, 2 * y, c), Channel(source, 2 * x + 1, 2 * y + 1, c));
+                            halved.pixels.push_back(static_cast<uint8_t>(RoundedAverage(left, right)));
+                        }
+                    }
+                }
+                source = std::move(halved);
+            } while (source.width >= width * 2ull && source.height >= height * 2ull);
+        }
+
+        BGR24Image result{ width, height, {} };
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            const double positionY = GoldenSamplePosition(y, source.height, height);
+            const auto y0 = static_cast<uint32_t>(positionY / 256);
+            const uint32_t y1 = std::min(y0 + 1, source.height - 1);
+            const double weightY = positionY - y0 * 256.0;
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                const double positionX = GoldenSamplePosition(x, source.width, width);
+                const auto x0 = static_cast<uint32_t>(positionX / 256);
+                const uint32_t x1 = std::min(x0 + 1, source.width - 1);
+                const double weightX = positionX - x0 * 256.0;
+                for (uint32_t c = 0; c < 3; ++c)
+                {
+                    const double left = Blend(Channel(source, x0, y0, c), Channel(source, x0, y1, c), weightY);
+                    const double right = Blend(Channel(source, x1, y0, c), Channel(source, x1, y1, c), weightY);
+                    result.pixels.push_back(static_cast<uint8_t>(Blend(left, right, weightX)));
+                }
+            }
+        }
+        return result;
+    }
+
+    TEST_CLASS (OverlayFrameConversionTests)
+    {
+    public:
+        TEST_METHOD (FrameSizes)
+        {
+            Assert::AreEqual<size_t>(1280 * 720 * 3, OverlayFrameSize(OverlayPixelFormat::RGB24, 1280, 720));
+            Assert::AreEqual<size_t>(1280 * 720 * 2, OverlayFrameSize(OverlayPixelFormat::YUY2, 1280, 720));
+            Assert::AreEqual<size_t>(1280 * 720 * 3 / 2, OverlayFrameSize(OverlayPixelFormat::NV12, 1280, 720));
+            Assert::AreEqual<size_t>(3 * 3 + 4 * 2, OverlayFrameSize(OverlayPixelFormat::NV12, 3, 3));
+        }
+
+        TEST_METHOD (YUY2_PrimaryColors)
+        {
+            struct
+            {
+                uint8_t r, g, b;
+                ExpectedYUV yuv;
+            } colors[] = {
+                { 0, 0, 0, { 16, 128, 128 } },
+                { 255, 255, 255, { 235, 128, 128 } },
+                { 255, 0, 0, { 82, 90, 240 } },
+                { 0, 255, 0, { 144, 54, 34 } },
+                { 0, 0, 255, { 41, 240, 110 } },
+            };
+
+            for (const auto& color : colors)
+            {
+                // Wide enough for both the vectorized blocks and the scalar tail
+                const auto image = SolidImage(38, 2, color.r, color.g, color.b);
+                std::vector<uint8_t> frame(OverlayFrameSize(OverlayPixelFormat::YUY2, image.width, image.height));
+                ConvertBGR24ToYUY2(image, frame.data());
+                for (size_t i = 0; i < frame.size(); i += 4)
+                {
+                    Assert::AreEqual(color.yuv.y, frame[i]);
+                    Assert::AreEqual(color.yuv.u, frame[i + 1]);
+                    Assert::AreEqual(color.yuv.y, frame[i + 2]);
+                    Assert::AreEqual(color.yuv.v, frame[i + 3]);
+                }
+            }
+        }
+
+        TEST_METHOD (YUY2_MatchesFloatingPointEquations)
+        {
+            const auto image = NoiseImage(70, 5, 1);
+            std::vector<uint8_t> frame(OverlayFrameSize(OverlayPixelFormat::YUY2, image.width, image.height));
+            ConvertBGR24ToYUY2(image, frame.data());
+
+            for (uint32_t y = 0; y < image.height; ++y)
+            {
+                for (uint32_t x = 0; x < image.width; x += 2)
+                {
+                    const uint8_t* p0 = image.pixels.data() + y * image.Stride() + x * 3;
+                    const uint8_t* p1 = p0 + 3;
+                    const uint8_t* pair = frame.data() + y * image.width * 2 + x * 2;
+                    Assert::AreEqual(ExpectedColor(p0[2], p0[1], p0[0]).y, pair[0]);
+                    Assert::AreEqual(ExpectedColor(p1[2], p1[1], p1[0]).y, pair[2]);
+
+                    const auto chroma = ExpectedColor(std::floor((p0[2] + p1[2] + 1) / 2.),
+                                                      std::floor((p0[1] + p1[1] + 1) / 2.),
+                                                      std::floor((p0[0] + p1[0] + 1) / 2.));
+                    Assert::AreEqual(chroma.u, pair[1]);
+                    Assert::AreEqual(chroma.v, pair[3]);
+                }
+            }
+        }
+
+        TEST_METHOD (NV12_PlanesMatchFloatingPointEquations)
+        {
+            const auto image = NoiseImage(52, 6, 2);
+            std::vector<uint8_t> frame(OverlayFrameSize(OverlayPixelFormat::NV12, image.width, image.height));
+            ConvertBGR24ToNV12(image, frame.data());
+
+            const uint8_t* chromaPlane = frame.data() + image.width * image.height;
+            for (uint32_t y = 0; y < image.height; y += 2)
+            {
+                for (uint32_t x = 0; x < image.width; x += 2)
+                {
+                    int sums[3] = {};
+                    for (uint32_t dy = 0; dy < 2; ++dy)
+                    {
+                        for (uint32_t dx = 0; dx < 2; ++dx)
+                        {
+                            const uint8_t* p = image.pixels.data() + (y + dy) * image.Stride() + (x + dx) * 3;
+                            Assert::AreEqual(ExpectedColor(p[2], p[1], p[0]).y, frame[(y + dy) * image.width + x + dx]);
+                            for (int c = 0; c < 3; ++c)
+                            {
+                                sums[c] += p[c];
+                            }
+                        }
+                    }
+
+                    const auto chroma = ExpectedColor(std::floor((sums[2] + 2) / 4.), std::floor((sums[1] + 2) / 4.), std::floor((sums[0] + 2) / 4.));
+                    Assert::AreEqual(chroma.u, chromaPlane[(y / 2) * image.width + x]);
+                    Assert::AreEqual(chroma.v, chromaPlane[(y / 2) * image.width + x + 1]);
+                }
+            }
+        }
+
+        TEST_METHOD (Conversions_MatchGoldenForAllSizes)
+        {
+            // Covers odd sizes and every length of the scalar tail, for both the vectorized and the scalar path
+            for (uint32_t width = 1; width <= 40; ++width)
+            {
+                for (uint32_t height = 1; height <= 3; ++height)
+                {
+                    const auto image = NoiseImage(width, height, width * 7 + height);
+
+                    const auto goldenYuy2 = GoldenYUY2(image);
+                    Assert::AreEqual(OverlayFrameSize(OverlayPixelFormat::YUY2, width, height), goldenYuy2.size());
+                    std::vector<uint8_t> yuy2(goldenYuy2.size());
+                    ConvertBGR24ToYUY2(image, yuy2.data());
+                    Assert::IsTrue(yuy2 == goldenYuy2);
+                    OverlayFrameReference::ConvertBGR24ToYUY2(image, yuy2.data());
+                    Assert::IsTrue(yuy2 == goldenYuy2);
+
+                    const auto goldenNv12 = GoldenNV12(image);
+                    Assert::AreEqual(OverlayFrameSize(OverlayPixelFormat::NV12, width, height), goldenNv12.size());
+                    std::vector<uint8_t> nv12(goldenNv12.size());
+                    ConvertBGR24ToNV12(image, nv12.data());
+                    Assert::IsTrue(nv12 == goldenNv12);
+                    OverlayFrameReference::ConvertBGR24ToNV12(image, nv12.data());
+                    Assert::IsTrue(nv12 == goldenNv12);
+                }
+            }
+        }
+
+        TEST_METHOD (Conversions_KnownFrames)
+        {
+            // 3x3 image, so both the odd column and the odd row are reused
+            const BGR24Image image{ 3, 3, { 0, 0, 0, 255, 255, 255, 0, 0, 255, 0, 255, 0, 255, 0, 0, 10, 20, 30, 200, 100, 50, 1, 2, 3, 128, 128, 128 } };
+
+            const uint8_t yuy2[] = { 16, 128, 235, 128, 82, 90, 82, 240, 144, 147, 41, 72, 35, 122, 35, 133, 99, 153, 18, 114, 126, 128, 126, 128 };
+            std::vector<uint8_t> frame(OverlayFrameSize(OverlayPixelFormat::YUY2, image.width, image.height));
+            Assert::AreEqual(std::size(yuy2), frame.size());
+            ConvertBGR24ToYUY2(image, frame.data());
+            Assert::IsTrue(std::equal(frame.begin(), frame.end(), yuy2));
+
+            const uint8_t nv12[] = { 16, 235, 82, 144, 41, 35, 99, 18, 126, 138, 100, 106, 187, 153, 114, 128, 128 };
+            frame.assign(OverlayFrameSize(OverlayPixelFormat::NV12, image.width, image.height), 0);
+            Assert::AreEqual(std::size(nv12), frame.size());
+            ConvertBGR24ToNV12(image, frame.data());
+            Assert::IsTrue(std::equal(frame.begin(), frame.end(), nv12));
+        }
+
+        TEST_METHOD (Scale_MatchesGolden)
+        {
+            const std::pair<std::pair<uint32_t, uint32_t>, std::pair<uint32_t, uint32_t>> sizes[] = {
+                { { 1, 1 }, { 640, 480 } },
+                { { 33, 17 }, { 64, 48 } },
+                { { 1920, 1080 }, { 1280, 720 } },
+                { { 4000, 3000 }, { 640, 360 } },
+                { { 100, 1000 }, { 37, 41 } },
+            };
+
+            for (const auto& [source, target] : sizes)
+            {
+                const auto image = NoiseImage(source.first, source.second, source.first);
+                const auto scaled = ScaleBGR24(image, target.first, target.second);
+                const auto expected = GoldenScale(image, target.first, target.second);
+                Assert::AreEqual(target.first, scaled.width);
+                Assert::AreEqual(target.second, scaled.height);
+                Assert::AreEqual(scaled.Stride() * scaled.height, scaled.pixels.size());
+                Assert::IsTrue(scaled.pixels == expected.pixels);
+                Assert::IsTrue(OverlayFrameReference::ScaleBGR24(image, target.first, target.second).pixels == expected.pixels);
+            }
+        }
+
+        TEST_METHOD (Scale_KnownValues)
+        {
+            // Solid colors stay solid
+            const auto solid = ScaleBGR24(SolidImage(1, 1, 10, 20, 30), 7, 5);
+            Assert::IsTrue(solid.pixels == SolidImage(7, 5, 10, 20, 30).pixels);
+
+            // Halving averages 2x2 blocks
+            BGR24Image checker = SolidImage(4, 2, 0, 0, 0);
+            for (uint32_t x = 0; x < 4; x += 2)
+            {
+                std::fill_n(checker.pixels.begin() + x * 3, 3, uint8_t{ 200 });
+            }
+            const auto halved = ScaleBGR24(checker, 2, 1);
+            Assert::IsTrue(halved.pixels == SolidImage(2, 1, 50, 50, 50).pixels);
+
+            // Upscaling a 2 pixel gradient interpolates between pixel centers
+            BGR24Image gradient = SolidImage(2, 1, 0, 0, 0);
+            std::fill_n(gradient.pixels.begin() + 3, 3, uint8_t{ 255 });
+            const auto upscaled = ScaleBGR24(gradient, 4, 1);
+            const uint8_t expected[] = { 0, 64, 191, 255 };
+            for (uint32_t x = 0; x < 4; ++x)
+            {
+                Assert::AreEqual(expected[x], upscaled.pixels[x * 3]);
+            }
+        }
+
+        TEST_METHOD (RenderOverlayFrame_ProducesFrameSizedBuffers)
+        {
+            const auto image = NoiseImage(320, 200, 3);
+            for (const auto format : { OverlayPixelFormat::RGB24, OverlayPixelFormat::YUY2, OverlayPixelFormat::NV12 })
+            {
+                const auto frame = RenderOverlayFrame(image, format, 1280, 720);
+                Assert::AreEqual(OverlayFrameSize(format, 1280, 720), frame.size());
+            }
+
+            Assert::IsTrue(RenderOverlayFrame({}, OverlayPixelFormat::NV12, 1280, 720).empty());
+            Assert::IsTrue(RenderOverlayFrame(image, OverlayPixelFormat::NV12, 0, 720).empty());
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(Benchmark_RenderOverlayFrame_4KTo1080p)
+            TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD (Benchmark_RenderOverlayFrame_4KTo1080p)
+        {
+            const auto image = NoiseImage(3840, 2160, 4);
+            for (const auto format : { OverlayPixelFormat::YUY2, OverlayPixelFormat::NV12 })
+            {
+                const auto start = std::chrono::steady_clock::now();
+                const auto frame = RenderOverlayFrame(image, format, 1920, 1080);
+                const auto vectorized = std::chrono::steady_clock::now() - start;
+
+                const auto scaled = OverlayFrameReference::ScaleBGR24(image, 1920, 1080);
+                std::vector<uint8_t> expected(frame.size());
+                if (format == OverlayPixelFormat::YUY2)
+                {
+                    OverlayFrameReference::ConvertBGR24ToYUY2(scaled, expected.data());
+                }
+                else
+                {
+                    OverlayFrameReference::ConvertBGR24ToNV12(scaled, expected.data());
+                }
+                const auto reference = std::chrono::steady_clock::now() - start - vectorized;
+                Assert::IsTrue(frame == expected);
+
+                const auto ms = [](auto duration) { return std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(duration).count()); };
+                Logger::WriteMessage(((format == OverlayPixelFormat::YUY2 ? "YUY2" : "NV12") + std::string{ " 4K to 1080p: " } +
+                                      ms(vectorized) + "ms, reference " + ms(reference) + "ms\n")
+                                         .c_str());
+            }
+        }
+    };
+}
@@ -0,0 +1,189 @@
+#include "pch.h"
+
+#include <CameraStateUpdateChannels.h>
+#include <SerializedSharedMemory.h>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace VideoConferenceUnitTests
+{
+    using Settings = CameraSettingsUpdateChannel::Settings;
+
+    // Every field is derived from the same value, so a torn copy is detectable
+    void FillSettings(Settings& settings, const uint32_t value)
+    {
+        settings.useOverlayImage = value & 1;
+        settings.overlayImageSize = value;
+        settings.sourceCameraName.emplace();
+        std::fill(begin(*settings.sourceCameraName), end(*settings.sourceCameraName) - 1, static_cast<wchar_t>(L'A' + value % 26));
+        settings.sourceCameraName->back() = L'\0';
+        settings.overlayImageGeneration = value;
+    }
+
+    bool IsConsistent(const Settings& settings)
+    {
+        if (!settings.overlayImageSize || !settings.sourceCameraName)
+        {
+            return false;
+        }
+
+        const uint32_t value = *settings.overlayImageSize;
+        const wchar_t nameChar = static_cast<wchar_t>(L'A' + value % 26);
+        return settings.useOverlayImage == static_cast<bool>(value & 1) &&
+               settings.overlayImageGeneration == value &&
+               std::all_of(begin(*settings.sourceCameraName), end(*settings.sourceCameraName) - 1, [nameChar](const wchar_t c) { return c == nameChar; }) &&
+               settings.sourceCameraName->back() == L'\0';
+    }
+
+    std::wstring UniqueChannelName(const wchar_t* testName)
+    {
+        return std::wstring{ L"Local\\PowerToysVideoConferenceUnitTests" } + testName + std::to_wstring(GetCurrentProcessId());
+    }
+
+    TEST_CLASS (SettingsChannelTests)
+    {
+    public:
+        TEST_METHOD (TryRead_CopiesOnlyNewGenerations)
+        {
+            CameraSettingsUpdateChannel channel;
+            uint32_t lastGeneration = 1;
+            Settings settings;
+
+            Assert::IsTrue(channel.tryRead(lastGeneration, settings));
+            Assert::AreEqual(0u, lastGeneration);
+            Assert::IsFalse(settings.useOverlayImage);
+
+            // Nothing changed
+            Assert::IsFalse(channel.tryRead(lastGeneration, settings));
+
+            channel.update([](Settings& s) { s.useOverlayImage = true; });
+            Assert::IsTrue(channel.tryRead(lastGeneration, settings));
+            Assert::AreEqual(2u, lastGeneration);
+            Assert::IsTrue(settings.useOverlayImage);
+            Assert::IsFalse(channel.tryRead(lastGeneration, settings));
+        }
+
+        TEST_METHOD (TryRead_DoesNotWaitForWriter)
+        {
+            CameraSettingsUpdateChannel channel;
+            uint32_t lastGeneration = 1;
+            Settings settings;
+            Assert::IsTrue(channel.tryRead(lastGeneration, settings));
+
+            // Simulate a writer which has been preempted in the middle of an update
+            channel.generation = 3;
+            channel.settings.useOverlayImage = true;
+            Assert::IsFalse(channel.tryRead(lastGeneration, settings));
+            Assert::AreEqual(0u, lastGeneration);
+            Assert::IsFalse(settings.useOverlayImage);
+
+            channel.generation = 4;
+            Assert::IsTrue(channel.tryRead(lastGeneration, settings));
+            Assert::IsTrue(settings.useOverlayImage);
+        }
+
+        // Module and proxy filters live in different processes, each with its own view of the channel.
+        // Writers and readers here map their own views of a named channel and use it concurrently.
+        TEST_METHOD (StressTest_ConcurrentWritersAndReaders)
+        {
+            constexpr uint32_t writesPerWriter = 20000;
+            constexpr uint32_t writers = 2;
+            constexpr size_t readers = 4;
+
+            const auto name = UniqueChannelName(L"Stress");
+            auto module = SerializedSharedMemory::create(name, sizeof(CameraSettingsUpdateChannel), false);
+            Assert::IsTrue(module.has_value());
+            module->access([](auto memory) {
+                auto channel = new (memory._data) CameraSettingsUpdateChannel{};
+                channel->update([](Settings& s) { FillSettings(s, 0); });
+            });
+
+            std::atomic_size_t readersReady = 0;
+            std::atomic_size_t writersDone = 0;
+            std::atomic_size_t tornReads = 0;
+            std::atomic_size_t backwardReads = 0;
+            std::atomic_size_t successfulReads = 0;
+
+            std::vector<std::thread> threads;
+            for (size_t i = 0; i < readers; ++i)
+            {
+                threads.emplace_back([&] {
+                    auto view = SerializedSharedMemory::open(name, sizeof(CameraSettingsUpdateChannel), false);
+                    ++readersReady;
+                    if (!view)
+                    {
+                        ++tornReads;
+                        return;
+                    }
+
+                    // Readers never take the lock, same as the proxy filter
+                    auto channel = reinterpret_cast<const CameraSettingsUpdateChannel*>(view->unserialized_memory()._data);
+                    uint32_t lastGeneration = 1;
+                    uint32_t previousGeneration = 0;
+                    Settings settings;
+                    while (writersDone != writers)
+                    {
+                        if (!channel->tryRead(lastGeneration, settings))
+                        {
+                            continue;
+                        }
+
+                        ++successfulReads;
+                        if (!IsConsistent(settings))
+                        {
+                            ++tornReads;
+                        }
+                        if (lastGeneration < previousGeneration)
+                        {
+                            ++backwardReads;
+                        }
+                        previousGeneration = lastGeneration;
+                    }
+                });
+            }
+
+            for (uint32_t i = 0; i < writers; ++i)
+            {
+                threads.emplace_back([&, i] {
+                    auto view = SerializedSharedMemory::open(name, sizeof(CameraSettingsUpdateChannel), false);
+                    while (readersReady != readers)
+                    {
+                        std::this_thread::yield();
+                    }
+
+                    for (uint32_t j = 0; view && j < writesPerWriter; ++j)
+                    {
+                        // Writers are serialized by the shared memory lock, exactly like the module threads are
+                        view->access([value = j * writers + i + 1](auto memory) {
+                            auto channel = reinterpret_cast<CameraSettingsUpdateChannel*>(memory._data);
+                            channel->update([value](Settings& s) { FillSettings(s, value); });
+                        });
+
+                        // Settings changes are rare compared to camera frames, give the readers a chance
+                        std::this_thread::yield();
+                    }
+                    ++writersDone;
+                });
+            }
+
+            for (auto& thread : threads)
+            {
+                thread.join();
+            }
+
+            Assert::AreEqual<size_t>(0, tornReads);
+            Assert::AreEqual<size_t>(0, backwardReads);
+            Assert::IsTrue(successfulReads > 0);
+
+            auto channel = reinterpret_cast<const CameraSettingsUpdateChannel*>(module->unserialized_memory()._data);
+            Assert::AreEqual(2u * (writesPerWriter * writers + 1), channel->generation.load());
+
+            uint32_t lastGeneration = 1;
+            Settings settings;
+            Assert::IsTrue(channel->tryRead(lastGeneration, settings));
+            Assert::IsTrue(IsConsistent(settings));
+
+            Logger::WriteMessage((L"Successful lock-free reads: " + std::to_wstring(successfulReads.load()) + L"\n").c_str());
+        }
+    };
+}
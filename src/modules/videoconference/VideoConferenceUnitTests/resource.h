@@ -0,0 +1,13 @@
+//{{NO_DEPENDENCIES}}
+// Microsoft Visual C++ generated include file.
+// Used by VideoConferenceUnitTests.rc
+
+//////////////////////////////
+// Non-localizable
+
+#define FILE_DESCRIPTION "PowerToys VideoConferenceUnitTests"
+#define INTERNAL_NAME "VideoConferenceUnitTests"
+#define ORIGINAL_FILENAME "VideoConferenceUnitTests.dll"
+
+// Non-localizable
+//////////////////////////////
@@ -42,7 +42,7 @@ void ShowNewVersionAvailable(const new_version_download_info& info)
 {
     remove_toasts_by_tag(UPDATING_PROCESS_TOAST_TAG);
 
-    toast_params toast_params{ UPDATING_PROCESS_TOAST_TAG, false };
+    toast_params toast_params{ .tag = UPDATING_PROCESS_TOAST_TAG, .resend_if_scheduled = false, .module_name = RUNNER_TOAST_MODULE_NAME };
     std::wstring contents = GET_RESOURCE_STRING(IDS_GITHUB_NEW_VERSION_AVAILABLE);
     contents += L'\n';
     contents += CurrentVersionToNextVersion(info);
@@ -61,7 +61,7 @@ void ShowOpenSettingsForUpdate()
 {
     remove_toasts_by_tag(UPDATING_PROCESS_TOAST_TAG);
 
-    toast_params toast_params{ UPDATING_PROCESS_TOAST_TAG, false };
+    toast_params toast_params{ .tag = UPDATING_PROCESS_TOAST_TAG, .resend_if_scheduled = false, .module_name = RUNNER_TOAST_MODULE_NAME };
 
     std::vector<action_t> actions = {
         link_button{ GET_RESOURCE_STRING(IDS_GITHUB_NEW_VERSION_MORE_INFO),
@@ -126,6 +126,7 @@ void ProcessNewVersionInfo(const github_version_info& version_info,
         state.state = UpdateState::upToDate;
         state.releasePageUrl = {};
         state.downloadedInstallerFilename = {};
+        state.stage = UpdateState::checked;
         Logger::trace(L"Version is up to date");
         return;
     }
@@ -160,13 +161,13 @@ void ProcessNewVersionInfo(const github_version_info& version_info,
     {
         Logger::trace(L"Downloading installer for a new version");
 
-        // Cleanup old updates before downloading the latest
-        updating::cleanup_updates();
-
+        // The installer downloaded already, or part of it, is picked up by the pipeline, which removes the other
+        // installers once it stages this one
         if (download_new_version(new_version_info).get())
         {
             state.state = UpdateState::readyToInstall;
             state.downloadedInstallerFilename = new_version_info.installer_filename;
+            state.stage = UpdateState::staged;
             if (show_notifications)
             {
                 ShowNewVersionAvailable(new_version_info);
@@ -176,6 +177,7 @@ void ProcessNewVersionInfo(const github_version_info& version_info,
         {
             state.state = UpdateState::errorDownloading;
             state.downloadedInstallerFilename = {};
+            state.stage = UpdateState::notStarted;
             Logger::error("Couldn't download new installer");
         }
     }
@@ -184,6 +186,7 @@ void ProcessNewVersionInfo(const github_version_info& version_info,
         Logger::trace(L"New version is ready to download, showing notification");
         state.state = UpdateState::readyToDownload;
         state.downloadedInstallerFilename = {};
+        state.stage = UpdateState::checked;
         if (show_notifications)
         {
             ShowOpenSettingsForUpdate();
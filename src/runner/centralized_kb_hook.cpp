@@ -1,27 +1,17 @@
 #include "pch.h"
 #include "centralized_kb_hook.h"
-#include <common/debug_control.h>
 #include <common/utils/winapi_error.h>
 #include <common/logger/logger.h>
 #include <common/interop/shared_constants.h>
+#include <common/hooks/LowlevelKeyboardHookHost.h>
+
+#include <map>
 
 namespace CentralizedKeyboardHook
 {
-    struct HotkeyDescriptor
-    {
-        Hotkey hotkey;
-        std::wstring moduleName;
-        std::function<bool()> action;
-
-        bool operator<(const HotkeyDescriptor& other) const
-        {
-            return hotkey < other.hotkey;
-        };
-    };
-
-    std::multiset<HotkeyDescriptor> hotkeyDescriptors;
+    // Subscriptions made for each module through SetHotkeyAction, removed by ClearModuleHotkeys
+    std::map<std::wstring, std::vector<KeyboardHookDispatcher::SubscriptionId>> moduleSubscriptions;
     std::mutex mutex;
-    HHOOK hHook{};
 
     // To store information about handling pressed keys.
     struct PressedKeyDescriptor
@@ -39,6 +29,8 @@ namespace CentralizedKeyboardHook
     };
     std::multiset<PressedKeyDescriptor> pressedKeyDescriptors;
     std::mutex pressedKeyMutex;
+    // Observes every key while pressedKeyDescriptors isn't empty
+    KeyboardHookDispatcher::SubscriptionId pressedKeySubscription{};
 
     // keep track of last pressed key, to detect repeated keys and if there are more keys pressed.
     const DWORD VK_DISABLED = CommonSharedConstants::VK_DISABLED;
@@ -47,14 +39,6 @@ namespace CentralizedKeyboardHook
     // Save the runner window handle for registering timers.
     HWND runnerWindow;
 
-    struct DestroyOnExit
-    {
-        ~DestroyOnExit()
-        {
-            Stop();
-        }
-    } destroyOnExitObj;
-
     // Handle the pressed key proc
     void PressedKeyTimerProc(
         HWND hwnd,
@@ -79,114 +63,97 @@ namespace CentralizedKeyboardHook
         KillTimer(hwnd, idTimer);
     }
 
-    LRESULT CALLBACK KeyboardHookProc(_In_ int nCode, _In_ WPARAM wParam, _In_ LPARAM lParam)
+    bool HandlePressedKey(const KeyboardHookDispatcher::Event& event)
     {
-        if (nCode < 0)
-        {
-            return CallNextHookEx(hHook, nCode, wParam, lParam);
-        }
-
-        const auto& keyPressInfo = *reinterpret_cast<KBDLLHOOKSTRUCT*>(lParam);
-
-        if (keyPressInfo.dwExtraInfo == PowertoyModuleIface::CENTRALIZED_KEYBOARD_HOOK_DONT_TRIGGER_FLAG)
+        if (event.extraInfo == PowertoyModuleIface::CENTRALIZED_KEYBOARD_HOOK_DONT_TRIGGER_FLAG)
         {
             // The new keystroke was generated from one of our actions. We should pass it along.
-            return CallNextHookEx(hHook, nCode, wParam, lParam);
+            return false;
         }
 
-        // Check if the keys are pressed.
-        if (!pressedKeyDescriptors.empty())
+        bool wasKeyPressed = vkCodePressed != VK_DISABLED;
+        // Hold the lock for the shortest possible duration
+        if (event.keyDown)
         {
-            bool wasKeyPressed = vkCodePressed != VK_DISABLED;
-            // Hold the lock for the shortest possible duration
-            if ((wParam == WM_KEYDOWN || wParam == WM_SYSKEYDOWN))
+            if (!wasKeyPressed)
             {
-                if (!wasKeyPressed)
-                {
-                    // If no key was pressed before, let's start a timer to take into account this new key.
-                    std::unique_lock lock{ pressedKeyMutex };
-                    PressedKeyDescriptor dummy{ .virtualKey = keyPressInfo.vkCode };
-                    auto [it, last] = pressedKeyDescriptors.equal_range(dummy);
-                    for (; it != last; ++it)
-                    {
-                        SetTimer(runnerWindow, it->idTimer, it->millisecondsToPress, PressedKeyTimerProc);
-                    }
-                }
-                else if (vkCodePressed != keyPressInfo.vkCode)
+                // If no key was pressed before, let's start a timer to take into account this new key.
+                std::unique_lock lock{ pressedKeyMutex };
+                PressedKeyDescriptor dummy{ .virtualKey = event.vkCode };
+                auto [it, last] = pressedKeyDescriptors.equal_range(dummy);
+                for (; it != last; ++it)
                 {
-                    // If a different key was pressed, let's clear the timers we have started for the previous key.
-                    std::unique_lock lock{ pressedKeyMutex };
-                    PressedKeyDescriptor dummy{ .virtualKey = vkCodePressed };
-                    auto [it, last] = pressedKeyDescriptors.equal_range(dummy);
-                    for (; it != last; ++it)
-                    {
-                        KillTimer(runnerWindow, it->idTimer);
-                    }
+                    SetTimer(runnerWindow, it->idTimer, it->millisecondsToPress, PressedKeyTimerProc);
                 }
-                vkCodePressed = keyPressInfo.vkCode;
             }
-            if (wParam == WM_KEYUP || wParam == WM_SYSKEYUP)
+            else if (vkCodePressed != event.vkCode)
             {
+                // If a different key was pressed, let's clear the timers we have started for the previous key.
                 std::unique_lock lock{ pressedKeyMutex };
-                PressedKeyDescriptor dummy{ .virtualKey = keyPressInfo.vkCode };
+                PressedKeyDescriptor dummy{ .virtualKey = vkCodePressed };
                 auto [it, last] = pressedKeyDescriptors.equal_range(dummy);
                 for (; it != last; ++it)
                 {
                     KillTimer(runnerWindow, it->idTimer);
                 }
-                vkCodePressed = 0x100;
             }
+            vkCodePressed = event.vkCode;
         }
-
-        if ((wParam != WM_KEYDOWN) && (wParam != WM_SYSKEYDOWN))
+        else
         {
-            return CallNextHookEx(hHook, nCode, wParam, lParam);
+            std::unique_lock lock{ pressedKeyMutex };
+            PressedKeyDescriptor dummy{ .virtualKey = event.vkCode };
+            auto [it, last] = pressedKeyDescriptors.equal_range(dummy);
+            for (; it != last; ++it)
+            {
+                KillTimer(runnerWindow, it->idTimer);
+            }
+            vkCodePressed = 0x100;
         }
 
-        Hotkey hotkey{
-            .win = (GetAsyncKeyState(VK_LWIN) & 0x8000) || (GetAsyncKeyState(VK_RWIN) & 0x8000),
-            .ctrl = static_cast<bool>(GetAsyncKeyState(VK_CONTROL) & 0x8000),
-            .shift = static_cast<bool>(GetAsyncKeyState(VK_SHIFT) & 0x8000),
-            .alt = static_cast<bool>(GetAsyncKeyState(VK_MENU) & 0x8000),
-            .key = static_cast<unsigned char>(keyPressInfo.vkCode)
-        };
+        // Only observes the keys
+        return false;
+    }
 
-        std::function<bool()> action;
+    bool HandleHotkey(const KeyboardHookDispatcher::Event& event, const std::function<bool()>& action)
+    {
+        if (event.extraInfo == PowertoyModuleIface::CENTRALIZED_KEYBOARD_HOOK_DONT_TRIGGER_FLAG || !action())
         {
-            // Hold the lock for the shortest possible duration
-            std::unique_lock lock{ mutex };
-            HotkeyDescriptor dummy{ .hotkey = hotkey };
-            auto it = hotkeyDescriptors.find(dummy);
-            if (it != hotkeyDescriptors.end())
-            {
-                action = it->action;
-            }
+            return false;
         }
 
-        if (action)
-        {
-            if (action())
-            {
-                // After invoking the hotkey send a dummy key to prevent Start Menu from activating
-                INPUT dummyEvent[1] = {};
-                dummyEvent[0].type = INPUT_KEYBOARD;
-                dummyEvent[0].ki.wVk = 0xFF;
-                dummyEvent[0].ki.dwFlags = KEYEVENTF_KEYUP;
-                SendInput(1, dummyEvent, sizeof(INPUT));
+        // After invoking the hotkey send a dummy key to prevent Start Menu from activating
+        INPUT dummyEvent[1] = {};
+        dummyEvent[0].type = INPUT_KEYBOARD;
+        dummyEvent[0].ki.wVk = 0xFF;
+        dummyEvent[0].ki.dwFlags = KEYEVENTF_KEYUP;
+        SendInput(1, dummyEvent, sizeof(INPUT));
 
-                // Swallow the key press
-                return 1;
-            }
-        }
+        // Swallow the key press
+        return true;
+    }
 
-        return CallNextHookEx(hHook, nCode, wParam, lParam);
+    KeyboardHookDispatcher& Dispatcher() noexcept
+    {
+        return LowlevelKeyboardHookHost::Instance().Dispatcher();
     }
 
     void SetHotkeyAction(const std::wstring& moduleName, const Hotkey& hotkey, std::function<bool()>&& action) noexcept
     {
         Logger::trace(L"Register hotkey action for {}", moduleName);
+        const uint8_t modifiers = (hotkey.win ? KeyboardHookDispatcher::ModifierWin : 0) |
+                                  (hotkey.ctrl ? KeyboardHookDispatcher::ModifierCtrl : 0) |
+                                  (hotkey.shift ? KeyboardHookDispatcher::ModifierShift : 0) |
+                                  (hotkey.alt ? KeyboardHookDispatcher::ModifierAlt : 0);
+        const KeyboardHookDispatcher::Filter filter{ .keys = { hotkey.key },
+                                                     .modifiersMask = KeyboardHookDispatcher::AllModifiers,
+                                                     .modifiers = modifiers };
+        const auto id = Dispatcher().Subscribe(moduleName, KeyboardHookDispatcher::DefaultPriority, filter, [action = std::move(action)](const auto& event) {
+            return HandleHotkey(event, action);
+        });
+
         std::unique_lock lock{ mutex };
-        hotkeyDescriptors.insert({ .hotkey = hotkey, .moduleName = moduleName, .action = std::move(action) });
+        moduleSubscriptions[moduleName].push_back(id);
     }
 
     void AddPressedKeyAction(const std::wstring& moduleName, const DWORD vk, const UINT milliseconds, std::function<bool()>&& action) noexcept
@@ -198,26 +165,29 @@ namespace CentralizedKeyboardHook
         const UINT timerId = upperId << 16 | lowerId;
         std::unique_lock lock{ pressedKeyMutex };
         pressedKeyDescriptors.insert({ .virtualKey = vk, .moduleName = moduleName, .action = std::move(action), .idTimer = timerId, .millisecondsToPress = milliseconds });
+        if (!pressedKeySubscription)
+        {
+            const KeyboardHookDispatcher::Filter everyKey{ .keyDown = true, .keyUp = true };
+            pressedKeySubscription = Dispatcher().Subscribe(L"PressedKeyActions", KeyboardHookDispatcher::ObserverPriority, everyKey, HandlePressedKey);
+        }
     }
 
     void ClearModuleHotkeys(const std::wstring& moduleName) noexcept
     {
         Logger::trace(L"UnRegister hotkey action for {}", moduleName);
+        std::vector<KeyboardHookDispatcher::SubscriptionId> subscriptions;
         {
             std::unique_lock lock{ mutex };
-            auto it = hotkeyDescriptors.begin();
-            while (it != hotkeyDescriptors.end())
+            if (auto it = moduleSubscriptions.find(moduleName); it != moduleSubscriptions.end())
             {
-                if (it->moduleName == moduleName)
-                {
-                    it = hotkeyDescriptors.erase(it);
-                }
-                else
-                {
-                    ++it;
-                }
+                subscriptions = std::move(it->second);
+                moduleSubscriptions.erase(it);
             }
         }
+        for (const auto id : subscriptions)
+        {
+            Dispatcher().Unsubscribe(id);
+        }
         {
             std::unique_lock lock{ pressedKeyMutex };
             auto it = pressedKeyDescriptors.begin();
@@ -232,35 +202,36 @@ namespace CentralizedKeyboardHook
                     ++it;
                 }
             }
+            if (pressedKeyDescriptors.empty() && pressedKeySubscription)
+            {
+                Dispatcher().Unsubscribe(std::exchange(pressedKeySubscription, {}));
+            }
         }
     }
 
     void Start() noexcept
     {
-#if defined(DISABLE_LOWLEVEL_HOOKS_WHEN_DEBUGGED)
-        const bool hook_disabled = IsDebuggerPresent();
-#else
-        const bool hook_disabled = false;
-#endif
-        if (!hook_disabled)
+        if (!LowlevelKeyboardHookHost::Instance().Start())
         {
-            if (!hHook)
-            {
-                hHook = SetWindowsHookExW(WH_KEYBOARD_LL, KeyboardHookProc, NULL, NULL);
-                if (!hHook)
-                {
-                    DWORD errorCode = GetLastError();
-                    show_last_error_message(L"SetWindowsHookEx", errorCode, L"centralized_kb_hook");
-                }
-            }
+            DWORD errorCode = GetLastError();
+            show_last_error_message(L"SetWindowsHookEx", errorCode, L"centralized_kb_hook");
         }
     }
 
     void Stop() noexcept
     {
-        if (hHook && UnhookWindowsHookEx(hHook))
+        LowlevelKeyboardHookHost::Instance().Stop();
+
+        for (const auto& subscriber : Dispatcher().Statistics())
         {
-            hHook = NULL;
+            using std::chrono::duration_cast;
+            using std::chrono::microseconds;
+            Logger::info(L"Keyboard hook subscriber {}: {} events, {} swallowed, {}us total, {}us max",
+                         subscriber.name,
+                         subscriber.calls,
+                         subscriber.swallowed,
+                         duration_cast<microseconds>(subscriber.total).count(),
+                         duration_cast<microseconds>(subscriber.max).count());
         }
     }
 
@@ -1,6 +1,7 @@
 #include "pch.h"
 
 #include "../modules/interface/powertoy_module_interface.h"
+#include <common/hooks/KeyboardHookDispatcher.h>
 
 namespace CentralizedKeyboardHook
 {
@@ -12,4 +13,6 @@ namespace CentralizedKeyboardHook
     void AddPressedKeyAction(const std::wstring& moduleName, const DWORD vk, const UINT milliseconds, std::function<bool()>&& action) noexcept;
     void ClearModuleHotkeys(const std::wstring& moduleName) noexcept;
     void RegisterWindow(HWND hwnd) noexcept;
+    // Dispatcher of the runner keyboard hook, handed to the modules so they don't install their own
+    KeyboardHookDispatcher& Dispatcher() noexcept;
 };
@@ -113,7 +113,9 @@ int runner(bool isProcessElevated, bool openSettings, std::string settingsWindow
                     // Wait a bit, because Windows has a delay until it picks up toast notification registration in the registry
                     Sleep(10000);
                     Logger::info("Showing toast notification asking to restart PC");
-                    notifications::show_toast(GET_RESOURCE_STRING(IDS_PT_VERSION_CHANGE_ASK_FOR_COMPUTER_RESTART).c_str(), L"PowerToys");
+                    notifications::show_toast(GET_RESOURCE_STRING(IDS_PT_VERSION_CHANGE_ASK_FOR_COMPUTER_RESTART).c_str(),
+                                              L"PowerToys",
+                                              notifications::toast_params{ .module_name = notifications::RUNNER_TOAST_MODULE_NAME });
                 }
             }.detach();
         }
@@ -125,7 +127,9 @@ int runner(bool isProcessElevated, bool openSettings, std::string settingsWindow
         std::thread{ [] {
             if (updating::uninstall_previous_msix_version_async().get())
             {
-                notifications::show_toast(GET_RESOURCE_STRING(IDS_OLDER_MSIX_UNINSTALLED).c_str(), L"PowerToys");
+                notifications::show_toast(GET_RESOURCE_STRING(IDS_OLDER_MSIX_UNINSTALLED).c_str(),
+                                          L"PowerToys",
+                                          notifications::toast_params{ .module_name = notifications::RUNNER_TOAST_MODULE_NAME });
             }
         } }.detach();
 
@@ -211,6 +215,7 @@ int runner(bool isProcessElevated, bool openSettings, std::string settingsWindow
 
         settings_telemetry::init();
         result = run_message_loop();
+        CentralizedKeyboardHook::Stop();
     }
     catch (std::runtime_error& err)
     {
@@ -338,7 +343,8 @@ int WINAPI WinMain(HINSTANCE /*hInstance*/, HINSTANCE /*hPrevInstance*/, LPSTR l
         notifications::remove_all_scheduled_toasts();
         notifications::show_toast(GET_RESOURCE_STRING(IDS_PT_UPDATE_MESSAGE_BOX_TEXT),
                                   L"PowerToys",
-                                  notifications::toast_params{ notifications::UPDATING_PROCESS_TOAST_TAG });
+                                  notifications::toast_params{ .tag = notifications::UPDATING_PROCESS_TOAST_TAG,
+                                                               .module_name = notifications::RUNNER_TOAST_MODULE_NAME });
         break;
     }
 
@@ -47,6 +47,7 @@ PowertoyModule::PowertoyModule(PowertoyModuleIface* pt_module, HMODULE handle) :
         throw std::runtime_error("Module not initialized");
     }
 
+    pt_module->set_keyboard_hook_dispatcher(&CentralizedKeyboardHook::Dispatcher());
     update_hotkeys();
     UpdateHotkeyEx();
 }
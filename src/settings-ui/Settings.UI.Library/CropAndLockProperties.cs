@@ -16,6 +16,7 @@ namespace Microsoft.PowerToys.Settings.UI.Library
         {
             ReparentHotkey = new KeyboardKeysProperty(DefaultReparentHotkeyValue);
             ThumbnailHotkey = new KeyboardKeysProperty(DefaultThumbnailHotkeyValue);
+            CombineThumbnails = new BoolProperty(false);
         }
 
         [JsonPropertyName("reparent-hotkey")]
@@ -23,5 +24,8 @@ namespace Microsoft.PowerToys.Settings.UI.Library
 
         [JsonPropertyName("thumbnail-hotkey")]
         public KeyboardKeysProperty ThumbnailHotkey { get; set; }
+
+        [JsonPropertyName("combine-thumbnails")]
+        public BoolProperty CombineThumbnails { get; set; }
     }
 }
@@ -13,10 +13,20 @@ namespace Microsoft.PowerToys.Settings.UI.Library
         public PastePlainProperties()
         {
             ActivationShortcut = DefaultActivationShortcut;
+            TrimTrailingWhitespace = new BoolProperty(false);
+            NormalizeLineEndings = new BoolProperty(false);
+            StripZeroWidthCharacters = new BoolProperty(false);
         }
 
         public HotkeySettings ActivationShortcut { get; set; }
 
+        // Needs to be kept in sync with src\modules\pasteplain\PastePlainModuleInterface\dllmain.cpp
+        public BoolProperty TrimTrailingWhitespace { get; set; }
+
+        public BoolProperty NormalizeLineEndings { get; set; }
+
+        public BoolProperty StripZeroWidthCharacters { get; set; }
+
         public override string ToString()
             => JsonSerializer.Serialize(this);
     }
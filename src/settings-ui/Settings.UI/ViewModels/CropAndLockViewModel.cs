@@ -157,6 +157,20 @@ namespace Microsoft.PowerToys.Settings.UI.ViewModels
             }
         }
 
+        public bool CombineThumbnails
+        {
+            get => Settings.Properties.CombineThumbnails.Value;
+
+            set
+            {
+                if (value != Settings.Properties.CombineThumbnails.Value)
+                {
+                    Settings.Properties.CombineThumbnails.Value = value;
+                    NotifyPropertyChanged();
+                }
+            }
+        }
+
         public void NotifyPropertyChanged([CallerMemberName] string propertyName = null)
         {
             OnPropertyChanged(propertyName);
@@ -127,6 +127,54 @@ namespace Microsoft.PowerToys.Settings.UI.ViewModels
             }
         }
 
+        public bool TrimTrailingWhitespace
+        {
+            get => _pastePlainSettings.Properties.TrimTrailingWhitespace.Value;
+            set
+            {
+                if (_pastePlainSettings.Properties.TrimTrailingWhitespace.Value != value)
+                {
+                    _pastePlainSettings.Properties.TrimTrailingWhitespace.Value = value;
+                    OnPropertyChanged(nameof(TrimTrailingWhitespace));
+
+                    _settingsUtils.SaveSettings(_pastePlainSettings.ToJsonString(), PastePlainSettings.ModuleName);
+                    NotifySettingsChanged();
+                }
+            }
+        }
+
+        public bool NormalizeLineEndings
+        {
+            get => _pastePlainSettings.Properties.NormalizeLineEndings.Value;
+            set
+            {
+                if (_pastePlainSettings.Properties.NormalizeLineEndings.Value != value)
+                {
+                    _pastePlainSettings.Properties.NormalizeLineEndings.Value = value;
+                    OnPropertyChanged(nameof(NormalizeLineEndings));
+
+                    _settingsUtils.SaveSettings(_pastePlainSettings.ToJsonString(), PastePlainSettings.ModuleName);
+                    NotifySettingsChanged();
+                }
+            }
+        }
+
+        public bool StripZeroWidthCharacters
+        {
+            get => _pastePlainSettings.Properties.StripZeroWidthCharacters.Value;
+            set
+            {
+                if (_pastePlainSettings.Properties.StripZeroWidthCharacters.Value != value)
+                {
+                    _pastePlainSettings.Properties.StripZeroWidthCharacters.Value = value;
+                    OnPropertyChanged(nameof(StripZeroWidthCharacters));
+
+                    _settingsUtils.SaveSettings(_pastePlainSettings.ToJsonString(), PastePlainSettings.ModuleName);
+                    NotifySettingsChanged();
+                }
+            }
+        }
+
         public bool IsConflictingCopyShortcut
         {
             get